@@ -784,6 +784,112 @@ Transform(RGBDConfiguration *configuration, const R4Matrix& matrix)
 
 
 
+static int
+AlignConsecutiveImages(RGBDConfiguration *configuration)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Aligning consecutive images ...\n");
+    fflush(stdout);
+  }
+
+  // Check number of images
+  int nimages = configuration->NImages();
+  if (nimages < 2) return 1;
+
+  // Allocate transformations from world coordinates of each image to world coordinates of previous one
+  R3Affine *transformations = new R3Affine [ nimages ];
+  RNScalar *rms_errors = new RNScalar [ nimages ];
+  for (int i = 0; i < nimages; i++) {
+    transformations[i] = R3identity_affine;
+    rms_errors[i] = -1;
+  }
+
+  // Create frame cache (which reads depth images in parallel)
+  RGBDFrameCache frame_cache(configuration, RGBD_READ_DEPTH_CHANNEL, (size_t) 1024 * 1024 * 1024);
+
+  // Allocate arrays for batches of pairs
+  int batch_size = 2 * RNNThreads();
+  RGBDImage **images0 = new RGBDImage * [ batch_size ];
+  RGBDImage **images1 = new RGBDImage * [ batch_size ];
+  R3Affine *pair_transformations = new R3Affine [ batch_size ];
+  RNScalar *pair_rms_errors = new RNScalar [ batch_size ];
+  int *pair_indices = new int [ batch_size ];
+
+  // Align batches of consecutive pairs concurrently
+  for (int first = 1; first < nimages; first += batch_size) {
+    int npairs = (first + batch_size < nimages) ? batch_size : nimages - first;
+
+    // Read images
+    frame_cache.Prefetch(first - 1, npairs + 1);
+    RGBDImage *previous_image = frame_cache.AcquireImage(first - 1);
+    int nvalid_pairs = 0;
+    for (int k = 0; k < npairs; k++) {
+      RGBDImage *image = frame_cache.AcquireImage(first + k);
+      if (previous_image && image) {
+        images0[nvalid_pairs] = previous_image;
+        images1[nvalid_pairs] = image;
+        pair_transformations[nvalid_pairs] = R3identity_affine;
+        pair_indices[nvalid_pairs++] = first + k;
+      }
+      previous_image = image;
+    }
+
+    // Align pairs
+    RGBDAlignImagePairs(nvalid_pairs, images0, images1, pair_transformations,
+      0.25, 0.05, 16, 3, pair_rms_errors);
+    for (int k = 0; k < nvalid_pairs; k++) {
+      transformations[pair_indices[k]] = pair_transformations[k];
+      rms_errors[pair_indices[k]] = pair_rms_errors[k];
+    }
+
+    // Release images
+    for (int k = 0; k <= npairs; k++) {
+      frame_cache.ReleaseImage(first - 1 + k);
+    }
+
+    // Print progress
+    if (print_verbose) {
+      for (int k = 0; k < npairs; k++) {
+        printf("  %d/%d : RMS error = %g\n", first + k, nimages - 1, rms_errors[first + k]);
+      }
+      fflush(stdout);
+    }
+  }
+
+  // Chain transformations to update camera poses (first image stays fixed)
+  R4Matrix correction = R4identity_matrix;
+  for (int i = 1; i < nimages; i++) {
+    RGBDImage *image = configuration->Image(i);
+    correction = correction * transformations[i].Matrix();
+    R3Affine camera_to_world(correction * image->CameraToWorld().Matrix(), 0);
+    image->SetCameraToWorld(camera_to_world);
+  }
+
+  // Delete temporary data
+  delete [] transformations;
+  delete [] rms_errors;
+  delete [] images0;
+  delete [] images1;
+  delete [] pair_transformations;
+  delete [] pair_rms_errors;
+  delete [] pair_indices;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", nimages);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // PROGRAM ARGUMENT PARSING
 ////////////////////////////////////////////////////////////////////////
@@ -812,6 +918,7 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-texel_spacing")) { argc--; argv++; texel_spacing = atof(*argv); }
       else if (!strcmp(*argv, "-compute_surface_textures")) {}
       else if (!strcmp(*argv, "-negate_yz")) {}
+      else if (!strcmp(*argv, "-align_consecutive_images")) {}
       else if (!strcmp(*argv, "-transform")) { argc-=16; argv+=16; }
       else if (!strcmp(*argv, "-viewpoint_bbox")) {
         argc--; argv++; viewpoint_bbox[0][0] = atof(*argv);
@@ -913,6 +1020,9 @@ main(int argc, char **argv)
       else if (!strcmp(*argv, "-identity_transformations")) {
         if (!ResetTransformations(configuration)) exit(-1);
       }
+      else if (!strcmp(*argv, "-align_consecutive_images")) {
+        if (!AlignConsecutiveImages(configuration)) exit(-1);
+      }
       else if (!strcmp(*argv, "-transform")) {
         R4Matrix matrix;
         argv++; argc--; matrix[0][0] = atof(*argv);
@@ -0,0 +1,490 @@
+// Source file for the rgbd feature fusion program
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {}
+using namespace gaps;
+#include "RGBD/RGBD.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Program arguments
+////////////////////////////////////////////////////////////////////////
+
+// File input/output options
+
+static const char *input_configuration_name = NULL;
+static const char *input_points_name = NULL;
+static const char *input_feature_directory = NULL;
+static const char *output_feature_name = NULL;
+static const char *output_count_name = NULL;
+
+
+// Image selection options
+
+static int load_images_starting_at_index = 0;
+static int load_images_ending_at_index = INT_MAX;
+static int load_every_kth_image = 1;
+
+
+// Fusion options
+
+static int nfeatures = 0;
+static double visibility_threshold = 0.25;
+static int boundary_width = 0;
+
+
+// Frame cache options
+
+static int frame_cache_budget = 1024;
+
+
+// Printing options
+
+static int print_verbose = 0;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// I/O STUFF
+////////////////////////////////////////////////////////////////////////
+
+static RGBDConfiguration *
+ReadConfiguration(const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Reading configuration from %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Allocate configuration
+  RGBDConfiguration *configuration = new RGBDConfiguration();
+  if (!configuration) {
+    RNFail("Unable to allocate configuration for %s\n", filename);
+    return NULL;
+  }
+
+  // Read file
+  if (!configuration->ReadFile(filename)) {
+    RNFail("Unable to read configuration from %s\n", filename);
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", configuration->NImages());
+    fflush(stdout);
+  }
+
+  // Return configuration
+  return configuration;
+}
+
+
+
+static float *
+ReadNumpyPoints(const char *filename, int *npoints)
+{
+  // Map file
+  unsigned long long size = 0;
+  void *data = RNMapFile(filename, &size);
+  if (!data) {
+    RNFail("Unable to read points from %s\n", filename);
+    return NULL;
+  }
+
+  // Parse header
+  char value_kind = 0;
+  int value_size = 0, shape[2] = { 0, 0 };
+  unsigned long long values_offset = 0;
+  int ndims = RNParseNumpyHeader(data, size, &value_kind, &value_size, shape, 2, &values_offset);
+  if ((ndims != 2) || (shape[1] < 3) || (value_kind != 'f') || ((value_size != 4) && (value_size != 8)) ||
+      (values_offset + (unsigned long long) shape[0] * shape[1] * value_size > size)) {
+    RNFail("Points in %s must be float32 or float64 values with shape (npoints, >=3)\n", filename);
+    RNUnmapFile(data, size);
+    return NULL;
+  }
+
+  // Copy positions (ignoring extra columns, e.g., colors)
+  float *positions = new float [ 3 * shape[0] + 1 ];
+  const unsigned char *values = (const unsigned char *) data + values_offset;
+  for (int i = 0; i < shape[0]; i++) {
+    for (int c = 0; c < 3; c++) {
+      size_t k = (size_t) i * shape[1] + c;
+      if (value_size == 4) positions[3*i+c] = ((const float *) values)[k];
+      else positions[3*i+c] = (float) ((const double *) values)[k];
+    }
+  }
+
+  // Unmap file
+  RNUnmapFile(data, size);
+
+  // Return positions
+  *npoints = shape[0];
+  return positions;
+}
+
+
+
+static float *
+ReadMeshPoints(const char *filename, int *npoints)
+{
+  // Read mesh
+  R3Mesh mesh;
+  if (!mesh.ReadFile(filename)) {
+    RNFail("Unable to read mesh from %s\n", filename);
+    return NULL;
+  }
+
+  // Copy vertex positions
+  float *positions = new float [ 3 * mesh.NVertices() + 1 ];
+  for (int i = 0; i < mesh.NVertices(); i++) {
+    const R3Point& position = mesh.VertexPosition(mesh.Vertex(i));
+    for (int c = 0; c < 3; c++) positions[3*i+c] = position[c];
+  }
+
+  // Return positions
+  *npoints = mesh.NVertices();
+  return positions;
+}
+
+
+
+static float *
+ReadPoints(const char *filename, int *npoints)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Reading points from %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Read points from numpy array or mesh vertices
+  const char *extension = strrchr(filename, '.');
+  float *positions = NULL;
+  if (extension && !strcmp(extension, ".npy")) positions = ReadNumpyPoints(filename, npoints);
+  else positions = ReadMeshPoints(filename, npoints);
+  if (!positions) return NULL;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Points = %d\n", *npoints);
+    fflush(stdout);
+  }
+
+  // Return positions
+  return positions;
+}
+
+
+
+static int
+WriteFeatures(RGBDFeatureFusion *fusion, const char *feature_filename, const char *count_filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Writing features to %s ...\n", feature_filename);
+    fflush(stdout);
+  }
+
+  // Write features
+  if (!fusion->WriteFeatureFile(feature_filename)) return 0;
+
+  // Write observation counts
+  if (count_filename) {
+    if (!fusion->WriteObservationCountFile(count_filename)) return 0;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    int nobserved_points = 0;
+    for (int i = 0; i < fusion->NPoints(); i++) {
+      if (fusion->PointObservationCount(i) > 0) nobserved_points++;
+    }
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Points = %d\n", fusion->NPoints());
+    printf("  # Observed Points = %d\n", nobserved_points);
+    printf("  # Features = %d\n", fusion->NFeatures());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// FUSION STUFF
+////////////////////////////////////////////////////////////////////////
+
+static const char *
+FeatureFilename(RGBDImage *image, char *buffer)
+{
+  // Get image name (basename of color file without extension)
+  const char *name = image->ColorFilename();
+  if (!name) name = image->Name();
+  if (!name) return NULL;
+  const char *basename = strrchr(name, '/');
+  basename = (basename) ? basename + 1 : name;
+
+  // Create feature filename
+  sprintf(buffer, "%s/%s", input_feature_directory, basename);
+  char *extension = strrchr(buffer, '.');
+  if (extension && !strchr(extension, '/')) *extension = '\0';
+  strcat(buffer, ".npy");
+
+  // Return feature filename
+  return buffer;
+}
+
+
+
+static int
+HasImageAspect(RGBDImage *image, int feature_width, int feature_height)
+{
+  // Check whether feature map has aspect ratio of image (up to rounding of its size)
+  int image_width = image->NPixels(RN_X);
+  int image_height = image->NPixels(RN_Y);
+  if ((image_width <= 0) || (image_height <= 0)) return 0;
+  double error = fabs((double) feature_height * image_width - (double) feature_width * image_height);
+  return (error <= 0.5 * (image_width + image_height)) ? 1 : 0;
+}
+
+
+
+static int
+FindNFeatures(RGBDConfiguration *configuration)
+{
+  // Find first feature file
+  char feature_filename[4096];
+  for (int i = 0; i < configuration->NImages(); i++) {
+    if (!FeatureFilename(configuration->Image(i), feature_filename)) continue;
+    if (!RNFileExists(feature_filename)) continue;
+
+    // Map file
+    unsigned long long size = 0;
+    void *data = RNMapFile(feature_filename, &size);
+    if (!data) return 0;
+
+    // Parse header
+    char value_kind = 0;
+    int value_size = 0, shape[8];
+    unsigned long long values_offset = 0;
+    int ndims = RNParseNumpyHeader(data, size, &value_kind, &value_size, shape, 8, &values_offset);
+    RNUnmapFile(data, size);
+    if ((ndims < 0) || (ndims > 8)) return 0;
+
+    // Remove leading dimensions of size one (e.g., a batch dimension)
+    int first_dim = 0;
+    while ((ndims - first_dim > 3) && (shape[first_dim] == 1)) first_dim++;
+    if (ndims - first_dim != 3) return 0;
+    const int *dims = &shape[first_dim];
+
+    // Read depth channel if size of image is unknown
+    RGBDImage *image = configuration->Image(i);
+    if ((dims[0] != dims[2]) && ((image->NPixels(RN_X) <= 0) || (image->NPixels(RN_Y) <= 0))) {
+      if (!image->ReadDepthChannel()) return -1;
+      image->ReleaseDepthChannel();
+    }
+
+    // Determine layout of features by comparing both possible map sizes with aspect ratio of image
+    if (dims[0] == dims[2]) return dims[0];
+    RNBoolean channels_last = HasImageAspect(image, dims[1], dims[0]);
+    RNBoolean channels_first = HasImageAspect(image, dims[2], dims[1]);
+    if (channels_last && !channels_first) return dims[2];
+    if (channels_first && !channels_last) return dims[0];
+    RNFail("Layout of features in %s is ambiguous, use -nfeatures\n", feature_filename);
+    return -1;
+  }
+
+  // No feature files
+  return 0;
+}
+
+
+
+static int
+IntegrateFeatures(RGBDFeatureFusion *fusion, RGBDConfiguration *configuration)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  int nmissing_files = 0;
+  if (print_verbose) {
+    printf("Integrating features ...\n");
+    fflush(stdout);
+  }
+
+  // Set fusion parameters
+  fusion->SetVisibilityThreshold(visibility_threshold);
+  fusion->SetBoundaryWidth(boundary_width);
+
+  // Select images with feature files
+  char feature_filename[4096];
+  int nselected_images = 0;
+  int *selected_image_indices = new int [ configuration->NImages() + 1 ];
+  for (int i = 0; i < configuration->NImages(); i++) {
+    if ((load_every_kth_image > 1) && ((i % load_every_kth_image) != 0)) continue;
+    if (i < load_images_starting_at_index) continue;
+    if (i > load_images_ending_at_index) continue;
+    if (!FeatureFilename(configuration->Image(i), feature_filename)) continue;
+    if (!RNFileExists(feature_filename)) { nmissing_files++; continue; }
+    selected_image_indices[nselected_images++] = i;
+  }
+
+  // Create frame cache (which reads depth images in parallel)
+  RGBDFrameCache frame_cache(configuration, RGBD_READ_DEPTH_CHANNEL,
+    (size_t) frame_cache_budget * 1024 * 1024);
+
+  // Integrate features
+  int batch_size = 2 * RNNThreads();
+  for (int k = 0; k < nselected_images; k++) {
+    int i = selected_image_indices[k];
+
+    // Prefetch next batch of images
+    if ((k % batch_size) == 0) {
+      int nimages = (k + batch_size < nselected_images) ? batch_size : nselected_images - k;
+      frame_cache.Prefetch(&selected_image_indices[k], nimages);
+    }
+
+    // Read image
+    RGBDImage *image = frame_cache.AcquireImage(i);
+    if (!image) continue;
+
+    // Integrate features
+    FeatureFilename(image, feature_filename);
+    if (!fusion->IntegrateFeatureFile(image, feature_filename)) {
+      frame_cache.ReleaseImage(i);
+      delete [] selected_image_indices;
+      return 0;
+    }
+
+    // Release image
+    frame_cache.ReleaseImage(i);
+
+    // Print progress
+    if (print_verbose) {
+      printf("  %d/%d : %s\n", k+1, nselected_images, feature_filename);
+      fflush(stdout);
+    }
+  }
+
+  // Delete selected image indices
+  delete [] selected_image_indices;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", fusion->NIntegratedImages());
+    printf("  # Missing Feature Files = %d\n", nmissing_files);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PROGRAM ARGUMENT PARSING
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-output_counts")) { argc--; argv++; output_count_name = *argv; }
+      else if (!strcmp(*argv, "-nfeatures")) { argc--; argv++; nfeatures = atoi(*argv); }
+      else if (!strcmp(*argv, "-visibility_threshold")) { argc--; argv++; visibility_threshold = atof(*argv); }
+      else if (!strcmp(*argv, "-boundary_width")) { argc--; argv++; boundary_width = atoi(*argv); }
+      else if (!strcmp(*argv, "-frame_cache_budget")) { argc--; argv++; frame_cache_budget = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_image_at_index")) { argc--; argv++; load_images_starting_at_index = load_images_ending_at_index = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_images_starting_at_index")) { argc--; argv++; load_images_starting_at_index = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_images_ending_at_index")) { argc--; argv++; load_images_ending_at_index = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_every_kth_image")) { argc--; argv++; load_every_kth_image = atoi(*argv); }
+      else {
+        RNFail("Invalid program argument: %s", *argv);
+        exit(1);
+      }
+      argv++; argc--;
+    }
+    else {
+      if (!input_configuration_name) input_configuration_name = *argv;
+      else if (!input_points_name) input_points_name = *argv;
+      else if (!input_feature_directory) input_feature_directory = *argv;
+      else if (!output_feature_name) output_feature_name = *argv;
+      else { RNFail("Invalid program argument: %s", *argv); exit(1); }
+      argv++; argc--;
+    }
+  }
+
+  // Check filenames
+  if (!input_configuration_name || !input_points_name || !input_feature_directory || !output_feature_name) {
+    RNFail("Usage: conf2feat inputconfigurationfile inputpointsfile inputfeaturedirectory outputfeaturefile [options]\n");
+    return 0;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// MAIN
+////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  // Check number of arguments
+  if (!ParseArgs(argc, argv)) exit(1);
+
+  // Read configuration
+  RGBDConfiguration *configuration = ReadConfiguration(input_configuration_name);
+  if (!configuration) exit(-1);
+
+  // Read points
+  int npoints = 0;
+  float *positions = ReadPoints(input_points_name, &npoints);
+  if (!positions) exit(-1);
+
+  // Determine number of features
+  if (nfeatures <= 0) nfeatures = FindNFeatures(configuration);
+  if (nfeatures <= 0) {
+    RNFail("Unable to determine number of features from files in %s\n", input_feature_directory);
+    exit(-1);
+  }
+
+  // Integrate features
+  RGBDFeatureFusion fusion(npoints, positions, nfeatures);
+  if (!IntegrateFeatures(&fusion, configuration)) exit(-1);
+
+  // Write features
+  if (!WriteFeatures(&fusion, output_feature_name, output_count_name)) exit(-1);
+
+  // Delete points
+  delete [] positions;
+
+  // Return success
+  return 0;
+}
@@ -74,6 +74,8 @@ static RNRgb background(0,0,0);
 static RNScalar png_distance_scale = 4000;
 static int glut = 1;
 static int mesa = 0;
+static int rasterize = 0;
+static int compact_channel_cache = 0;
 
 
 // Printing program variables
@@ -150,6 +152,9 @@ ReadConfiguration(const char *filename)
     return 0;
   }
 
+  // Keep compact copies of released channels
+  if (compact_channel_cache) configuration.SetCompactChannelCache(TRUE);
+
 #if 0
   // Read all channels ... for now
   if (!configuration.ReadChannels()) {
@@ -389,7 +394,10 @@ WriteImages(const char *output_directory)
   // Create output directory
   char cmd[1024];
   sprintf(cmd, "mkdir -p %s", output_image_directory);
-  system(cmd);
+  if (system(cmd) != 0) {
+    RNFail("Unable to create output directory %s\n", output_image_directory);
+    return 0;
+  }
 
   // Write images
   for (int i = 0; i < configuration.NImages(); i++) {
@@ -1021,6 +1029,32 @@ RenderMesh(const R3Mesh& mesh, int rendering_scheme,
 
 
 
+static char *
+ImageName(int image_index, char *image_name_buffer)
+{
+  // Get image name (buffer must have 2048 characters)
+  char *name = image_name_buffer;
+  if (configuration.NImages() > 0) {
+    RGBDImage *image = configuration.Image(image_index);
+    const char *filename = image->DepthFilename();
+    if (!filename) filename = image->ColorFilename();
+    if (!filename) filename = "default";
+    strncpy(image_name_buffer, filename, 2047);
+    image_name_buffer[2047] = '\0';
+    if (strrchr(image_name_buffer, '/')) name = strrchr(image_name_buffer, '/')+1;
+    char *endp = strrchr(name, '.');
+    if (endp) *endp = '\0';
+  }
+  else {
+    sprintf(image_name_buffer, "%06d", image_index);
+  }
+
+  // Return pointer to name within buffer
+  return name;
+}
+
+
+
 static int
 LoadNextCamera(R3Point& viewpoint, R3Vector& towards, R3Vector& up)
 {
@@ -1090,20 +1124,7 @@ Redraw(void)
 
   // Get image name
   char image_name_buffer[2048];
-  char *name = image_name_buffer;
-  if (configuration.NImages() > 0) {
-    RGBDImage *image = configuration.Image(current_image_index);
-    const char *filename = image->DepthFilename();
-    if (!filename) filename = image->ColorFilename();
-    if (!filename) filename = "default";
-    strncpy(image_name_buffer, filename, 2047);
-    if (strrchr(image_name_buffer, '/')) name = strrchr(image_name_buffer, '/')+1;
-    char *endp = strrchr(name, '.');
-    if (endp) *endp = '\0';
-  }
-  else {
-    sprintf(image_name_buffer, "%06d", current_image_index);
-  }
+  char *name = ImageName(current_image_index, image_name_buffer);
 
   // Print debug statement
   if (print_debug) {
@@ -1486,6 +1507,382 @@ RenderImagesWithMesa(const char *output_image_directory)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Software rasterization functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+GetRasterizationCamera(int image_index, R4Matrix& world_to_camera, R3Matrix& intrinsics,
+  RNLength& neardist, RNLength& fardist, R3Point& viewpoint, R3Vector& towards, R3Vector& up)
+{
+  // Check input cameras
+  if (cameras.NEntries() > 0) {
+    if (image_index < cameras.NEntries()) {
+      // Get camera from input file
+      R3Camera *camera = cameras.Kth(image_index);
+      world_to_camera = camera->CoordSystem().InverseMatrix();
+      intrinsics = R3Matrix(0.5 * width / tan(camera->XFOV()), 0, 0.5 * width,
+        0, 0.5 * height / tan(camera->YFOV()), 0.5 * height, 0, 0, 1);
+      neardist = camera->Near();
+      fardist = camera->Far();
+      viewpoint = camera->Origin();
+      towards = camera->Towards();
+      up = camera->Up();
+      return 1;
+    }
+  }
+  else if (configuration.NImages() > 0) {
+    if (image_index < configuration.NImages()) {
+      // Get camera for image from configuration
+      RGBDImage *image = configuration.Image(image_index);
+      if (image->NPixels(RN_X) == 0) {
+        image->ReadChannels();  // Temporary, just to read width/height :(
+        image->ReleaseChannels();
+      }
+
+      // Scale intrinsics to output resolution (like the projection matrix)
+      RNScalar xscale = (RNScalar) width / (RNScalar) image->NPixels(RN_X);
+      RNScalar yscale = (RNScalar) height / (RNScalar) image->NPixels(RN_Y);
+      const R3Matrix& image_intrinsics = image->Intrinsics();
+      intrinsics = R3Matrix(xscale * image_intrinsics[0][0], 0, xscale * image_intrinsics[0][2],
+        0, yscale * image_intrinsics[1][1], yscale * image_intrinsics[1][2], 0, 0, 1);
+      world_to_camera = image->CameraToWorld().InverseMatrix();
+      neardist = 0.1;
+      fardist = 100.0;
+      viewpoint = image->WorldViewpoint();
+      towards = image->WorldTowards();
+      up = image->WorldUp();
+      return 1;
+    }
+  }
+
+  // Return failure - no more cameras
+  return 0;
+}
+
+
+
+static R3MeshFace *
+RasterizedFace(const R2Grid& face_image, int ix, int iy)
+{
+  // Return mesh face visible at pixel
+  RNScalar face_value = face_image.GridValue(ix, iy);
+  if (face_value < 0) return NULL;
+  int face_index = (int) (face_value + 0.5);
+  if (face_index >= mesh.NFaces()) return NULL;
+  return mesh.Face(face_index);
+}
+
+
+
+static void
+ComputeRasterizedMeshImage(int rendering_scheme, const R2Grid& depth_image, const R2Grid& face_image,
+  const R4Matrix& world_to_camera, const R3Matrix& intrinsics, const R3Point& viewpoint, R2Grid& image)
+{
+  // Get camera to world transformation
+  R4Matrix camera_to_world = world_to_camera.Inverse();
+
+  // Fill image with values encoded like the ones drawn by RenderMesh
+  image.Clear(0);
+  for (int iy = 0; iy < height; iy++) {
+    for (int ix = 0; ix < width; ix++) {
+      // Get face visible at pixel
+      R3MeshFace *face = RasterizedFace(face_image, ix, iy);
+      if (!face) continue;
+
+      // Compute positions of pixel
+      RNScalar depth = depth_image.GridValue(ix, iy);
+      R3Point camera_position(depth * (ix + 0.5 - intrinsics[0][2]) / intrinsics[0][0],
+        depth * (iy + 0.5 - intrinsics[1][2]) / intrinsics[1][1], -depth);
+      R3Point world_position = camera_to_world * camera_position;
+      R3Vector world_normal = mesh.FaceNormal(face);
+      R3Vector camera_normal = world_to_camera * world_normal; camera_normal.Normalize();
+
+      // Compute value
+      int value = 0;
+      if ((rendering_scheme >= CAMERA_PX_RENDERING) && (rendering_scheme <= WORLD_PZ_RENDERING)) {
+        RNScalar position_coordinate = 0;
+        if (rendering_scheme == CAMERA_PX_RENDERING) position_coordinate = camera_position.X();
+        else if (rendering_scheme == CAMERA_PY_RENDERING) position_coordinate = camera_position.Y();
+        else if (rendering_scheme == CAMERA_PZ_RENDERING) position_coordinate = camera_position.Z();
+        else if (rendering_scheme == WORLD_PX_RENDERING) position_coordinate = world_position.X() - viewpoint.X();
+        else if (rendering_scheme == WORLD_PY_RENDERING) position_coordinate = world_position.Y() - viewpoint.Y();
+        else if (rendering_scheme == WORLD_PZ_RENDERING) position_coordinate = world_position.Z() - viewpoint.Z();
+        value = png_distance_scale * position_coordinate + 32768;
+      }
+      else if (((rendering_scheme >= CAMERA_NX_RENDERING) && (rendering_scheme <= CAMERA_NZ_RENDERING)) ||
+               ((rendering_scheme >= WORLD_NX_RENDERING) && (rendering_scheme <= WORLD_NZ_RENDERING))) {
+        RNScalar normal_coordinate = 0;
+        if (rendering_scheme == CAMERA_NX_RENDERING) normal_coordinate = camera_normal.X();
+        else if (rendering_scheme == CAMERA_NY_RENDERING) normal_coordinate = camera_normal.Y();
+        else if (rendering_scheme == CAMERA_NZ_RENDERING) normal_coordinate = camera_normal.Z();
+        else if (rendering_scheme == WORLD_NX_RENDERING) normal_coordinate = world_normal.X();
+        else if (rendering_scheme == WORLD_NY_RENDERING) normal_coordinate = world_normal.Y();
+        else if (rendering_scheme == WORLD_NZ_RENDERING) normal_coordinate = world_normal.Z();
+        value = 32768 * (normal_coordinate + 1.0);
+      }
+      else if ((rendering_scheme == CAMERA_ND_RENDERING) || (rendering_scheme == WORLD_ND_RENDERING)) {
+        RNScalar offset_coordinate = 0;
+        R3Point centroid = mesh.FaceCentroid(face);
+        if (rendering_scheme == CAMERA_ND_RENDERING) {
+          R3Point camera_centroid = world_to_camera * centroid;
+          offset_coordinate = -camera_centroid.X()*camera_normal.X() - camera_centroid.Y()*camera_normal.Y() - camera_centroid.Z()*camera_normal.Z();
+        }
+        else if (rendering_scheme == WORLD_ND_RENDERING) {
+          offset_coordinate = -centroid.X()*world_normal.X() - centroid.Y()*world_normal.Y() - centroid.Z()*world_normal.Z();
+        }
+        value = png_distance_scale * offset_coordinate + 32768;
+      }
+      else if (rendering_scheme == NDOTV_RENDERING) {
+        R3Vector v = viewpoint - world_position; v.Normalize();
+        value = 32768 * (world_normal.Dot(v) + 1.0);
+      }
+      else if (rendering_scheme == FACE_INDEX_RENDERING) value = mesh.FaceID(face) + 1;
+      else if (rendering_scheme == FACE_MATERIAL_RENDERING) value = (mesh.FaceMaterial(face) + 1) % 65536;
+      else if (rendering_scheme == FACE_SEGMENT_RENDERING) value = (mesh.FaceSegment(face) + 1) % 65536;
+      else if (rendering_scheme == FACE_CATEGORY_RENDERING) value = (mesh.FaceCategory(face) + 1) % 65536;
+
+      // Clamp 16-bit encoded values
+      if ((rendering_scheme >= CAMERA_PX_RENDERING) && (rendering_scheme <= NDOTV_RENDERING)) {
+        if (value < 0) value = 0;
+        else if (value > 65535) value = 65535;
+      }
+
+      // Set value
+      image.SetGridValue(ix, iy, value);
+    }
+  }
+}
+
+
+
+static void
+WriteRasterizedMeshImage(int rendering_scheme, const char *filename,
+  const R2Grid& depth_image, const R2Grid& face_image, const R2Grid *mask_image,
+  const R4Matrix& world_to_camera, const R3Matrix& intrinsics, const R3Point& viewpoint)
+{
+  // Compute and write image
+  R2Grid image(width, height);
+  ComputeRasterizedMeshImage(rendering_scheme, depth_image, face_image, world_to_camera, intrinsics, viewpoint, image);
+  if (mask_image) image.Mask(*mask_image);
+  image.WriteFile(filename);
+}
+
+
+
+static int
+RenderImagesWithRasterizer(const char *output_image_directory)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read(); 
+  char output_image_filename[4096];
+
+  // Print message
+  if (print_verbose) {
+    printf("Rendering images with rasterizer to %s\n", output_image_directory);
+    fflush(stdout);
+  }
+
+  // Check capture options
+  if (capture_depth_images || capture_color_images) {
+    RNFail("Rasterizer renders meshes only, skipping configuration depth and color images\n");
+  }
+  
+  // Create rasterizer with mesh faces (identifier is face index)
+  R3Rasterizer rasterizer;
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    if (skip_removed_faces) {
+      // This is a hack to skip faces marked for removal in the matterport dataset
+      int category_index = mesh.FaceCategory(face);
+      if (category_index == 9) continue;
+      if (category_index == 64) continue;
+    }
+    R3MeshVertex *v0 = mesh.VertexOnFace(face, 0);
+    R3MeshVertex *v1 = mesh.VertexOnFace(face, 1);
+    R3MeshVertex *v2 = mesh.VertexOnFace(face, 2);
+    if (!capture_mesh_color_images) rasterizer.InsertTriangle(mesh.VertexPosition(v0), mesh.VertexPosition(v1), mesh.VertexPosition(v2), i);
+    else rasterizer.InsertTriangle(mesh.VertexPosition(v0), mesh.VertexPosition(v1), mesh.VertexPosition(v2),
+      mesh.VertexColor(v0), mesh.VertexColor(v1), mesh.VertexColor(v2), i);
+  }
+
+  // Render images for every camera
+  R4Matrix world_to_camera;
+  R3Matrix intrinsics;
+  RNLength neardist, fardist;
+  R3Point viewpoint;
+  R3Vector towards, up;
+  int image_index = 0;
+  while (GetRasterizationCamera(image_index, world_to_camera, intrinsics, neardist, fardist, viewpoint, towards, up)) {
+    // Get image name
+    char image_name_buffer[2048];
+    char *name = ImageName(image_index, image_name_buffer);
+
+    // Print debug statement
+    if (print_debug) {
+      printf("  Rasterizing %s ...\n", name);
+      fflush(stdout);
+    }
+
+    // Rasterize mesh
+    R2Grid depth_image(width, height);
+    R2Grid face_image(width, height);
+    R2Image color_image(width, height, 3);
+    face_image.Clear(-1);
+    rasterizer.Rasterize(world_to_camera, intrinsics, width, height, neardist, fardist,
+      &depth_image, &face_image, (capture_mesh_color_images) ? &color_image : NULL);
+
+    // Create mask image
+    R2Grid *mask_image = NULL;
+    if (mask_by_filled_depth && !mesh.IsEmpty()) {
+      // Get filled depth image
+      RGBDImage *image = configuration.Image(image_index);
+      if (!image->ReadDepthChannel()) RNAbort("Unable to read depth channel for %s", name);
+      R2Grid filled_depth_image(*image->DepthChannel());
+      if (!image->ReleaseDepthChannel()) RNAbort("Unable to release depth channel for %s", name);
+      filled_depth_image.Substitute(0.0, R2_GRID_UNKNOWN_VALUE);
+      filled_depth_image.FillHoles();
+
+      // Create mask
+      mask_image = new R2Grid(width, height);
+      for (int i = 0; i < width*height; i++) {
+        RNScalar filled_depth_value = filled_depth_image.GridValue(i);
+        if (filled_depth_value == R2_GRID_UNKNOWN_VALUE) continue;
+        if (filled_depth_value == 0) continue;
+        RNScalar rendered_depth_value = depth_image.GridValue(i);
+        if (rendered_depth_value == 0) continue;
+        RNScalar ratio = filled_depth_value / rendered_depth_value;
+        if ((ratio < 0.8) || (ratio > 1.25)) continue;
+        mask_image->SetGridValue(i, 1);
+      }
+    }
+
+    // Write mesh color image
+    sprintf(output_image_filename, "%s/%s_mesh_color.jpg", output_image_directory, name);
+    if (capture_mesh_color_images && !RNFileExists(output_image_filename)) {
+      color_image.Write(output_image_filename);
+    }
+
+    // Write mesh depth image
+    sprintf(output_image_filename, "%s/%s_mesh_depth.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_depth_images && !RNFileExists(output_image_filename)) {
+      R2Grid image(depth_image);
+      image.Multiply(png_distance_scale);
+      image.Threshold(65535, R2_GRID_KEEP_VALUE, 0);
+      if (mask_image) image.Mask(*mask_image);
+      image.WriteFile(output_image_filename);
+    }
+
+    // Write mesh position images (in camera coordinates)
+    sprintf(output_image_filename, "%s/%s_mesh_pz.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_position_images && !RNFileExists(output_image_filename)) {
+      const char *suffixes[3] = { "px", "py", "pz" };
+      for (int dim = 0; dim < 3; dim++) {
+        sprintf(output_image_filename, "%s/%s_mesh_%s.png", output_image_directory, name, suffixes[dim]);
+        WriteRasterizedMeshImage(CAMERA_PX_RENDERING + dim, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+      }
+    }
+
+    // Write mesh position images (in world coordinates)
+    sprintf(output_image_filename, "%s/%s_mesh_wpz.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_wposition_images && !RNFileExists(output_image_filename)) {
+      const char *suffixes[3] = { "wpx", "wpy", "wpz" };
+      for (int dim = 0; dim < 3; dim++) {
+        sprintf(output_image_filename, "%s/%s_mesh_%s.png", output_image_directory, name, suffixes[dim]);
+        WriteRasterizedMeshImage(WORLD_PX_RENDERING + dim, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+      }
+    }
+
+    // Write mesh normal images (in camera coordinates)
+    sprintf(output_image_filename, "%s/%s_mesh_nd.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_normal_images && !RNFileExists(output_image_filename)) {
+      const char *suffixes[4] = { "nx", "ny", "nz", "nd" };
+      for (int dim = 0; dim < 4; dim++) {
+        sprintf(output_image_filename, "%s/%s_mesh_%s.png", output_image_directory, name, suffixes[dim]);
+        WriteRasterizedMeshImage(CAMERA_NX_RENDERING + dim, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+      }
+    }
+
+    // Write mesh normal images (in world coordinates)
+    sprintf(output_image_filename, "%s/%s_mesh_wnd.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_wnormal_images && !RNFileExists(output_image_filename)) {
+      const char *suffixes[4] = { "wnx", "wny", "wnz", "wnd" };
+      for (int dim = 0; dim < 4; dim++) {
+        sprintf(output_image_filename, "%s/%s_mesh_%s.png", output_image_directory, name, suffixes[dim]);
+        WriteRasterizedMeshImage(WORLD_NX_RENDERING + dim, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+      }
+    }
+
+    // Write mesh ndotv image
+    sprintf(output_image_filename, "%s/%s_mesh_ndotv.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_ndotv_images && !RNFileExists(output_image_filename)) {
+      WriteRasterizedMeshImage(NDOTV_RENDERING, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+    }
+
+    // Write mesh face ID image
+    sprintf(output_image_filename, "%s/%s_mesh_face.pfm", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_face_images && !RNFileExists(output_image_filename)) {
+      WriteRasterizedMeshImage(FACE_INDEX_RENDERING, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+    }
+
+    // Write mesh material ID image
+    sprintf(output_image_filename, "%s/%s_mesh_material.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_material_images && !RNFileExists(output_image_filename)) {
+      WriteRasterizedMeshImage(FACE_MATERIAL_RENDERING, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+    }
+
+    // Write mesh segment ID image
+    sprintf(output_image_filename, "%s/%s_mesh_segment.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_segment_images && !RNFileExists(output_image_filename)) {
+      R2Image segment_image(width, height, 3);
+      for (int ix = 0; ix < width; ix++) {
+        for (int iy = 0; iy < height; iy++) { 
+          if (mask_image && (mask_image->GridValue(ix, iy) == 0)) continue;
+          R3MeshFace *face = RasterizedFace(face_image, ix, iy);
+          if (!face) continue;
+          int segment = mesh.FaceSegment(face);
+          if (segment < 0) continue;
+          int region_index = (segment / 1000000) + 1;
+          assert(region_index < 256);
+          int object_index = (segment % 1000000) + 1;
+          assert((object_index >> 8) < 256);
+          unsigned char pixel[4];
+          pixel[0] = region_index;
+          pixel[1] = (object_index>>8) & 0xFF;
+          pixel[2] = object_index & 0xFF;
+          segment_image.SetPixel(ix, iy, pixel);
+        }
+      }
+      segment_image.Write(output_image_filename);
+    }
+
+    // Write mesh category ID image
+    sprintf(output_image_filename, "%s/%s_mesh_category.png", output_image_directory, name);
+    if (!mesh.IsEmpty() && capture_mesh_category_images && !RNFileExists(output_image_filename)) {
+      WriteRasterizedMeshImage(FACE_CATEGORY_RENDERING, output_image_filename, depth_image, face_image, mask_image, world_to_camera, intrinsics, viewpoint);
+    }
+
+    // Delete mask image
+    if (mask_image) delete mask_image;
+
+    // Advance to next image
+    image_index++;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", image_index);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 static int
 RenderImages(const char *output_image_directory)
 {
@@ -1500,11 +1897,15 @@ RenderImages(const char *output_image_directory)
   // Create output directory
   char cmd[1024];
   sprintf(cmd, "mkdir -p %s", output_image_directory);
-  system(cmd);
+  if (system(cmd) != 0) {
+    RNFail("Unable to create output directory %s\n", output_image_directory);
+    return 0;
+  }
 
   // Render images
   if (glut) { if (!RenderImagesWithGlut(output_image_directory)) return 0; }
   else if (mesa) { if (!RenderImagesWithMesa(output_image_directory)) return 0; }
+  else if (rasterize) { if (!RenderImagesWithRasterizer(output_image_directory)) return 0; }
   else { RNAbort("Not implemented"); }
 
   // Return success
@@ -1529,9 +1930,11 @@ ParseArgs(int argc, char **argv)
     if ((*argv)[0] == '-') {
       if (!strcmp(*argv, "-v")) print_verbose = 1;
       else if (!strcmp(*argv, "-debug")) print_debug = 1;
-      else if (!strcmp(*argv, "-glut")) { mesa = 0; glut = 1; }
-      else if (!strcmp(*argv, "-mesa")) { mesa = 1; glut = 0; }
+      else if (!strcmp(*argv, "-glut")) { mesa = 0; glut = 1; rasterize = 0; }
+      else if (!strcmp(*argv, "-mesa")) { mesa = 1; glut = 0; rasterize = 0; }
+      else if (!strcmp(*argv, "-rasterize")) { mesa = 0; glut = 0; rasterize = 1; }
       else if (!strcmp(*argv, "-skip_removed_faces")) skip_removed_faces = 1;
+      else if (!strcmp(*argv, "-compact_channel_cache")) compact_channel_cache = 1;
       else if (!strcmp(*argv, "-mask_by_filled_depth")) mask_by_filled_depth = 1;
       else if (!strcmp(*argv, "-cameras")) { argc--; argv++; input_camera_filename = *argv; }
       else if (!strcmp(*argv, "-mesh")) { argc--; argv++; input_mesh_filename = *argv; }
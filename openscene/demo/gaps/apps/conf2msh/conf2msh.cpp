@@ -0,0 +1,290 @@
+// Source file for the rgbd fusion program
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {}
+using namespace gaps;
+#include "RGBD/RGBD.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Program arguments
+////////////////////////////////////////////////////////////////////////
+
+// File input/output options
+
+static const char *input_configuration_name = NULL;
+static const char *output_mesh_name = NULL;
+
+
+// Image selection options
+
+static int load_images_starting_at_index = 0;
+static int load_images_ending_at_index = INT_MAX;
+static int load_every_kth_image = 1;
+
+
+// Fusion options
+
+static double voxel_size = 0.01;
+static double truncation_distance = 0;
+static double max_weight = 0;
+static double min_depth = 0;
+static double max_depth = 0;
+static int update_mesh_every_kth_image = 0;
+
+
+// Frame cache options
+
+static int frame_cache_budget = 1024;
+
+
+// Printing options
+
+static int print_verbose = 0;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// I/O STUFF
+////////////////////////////////////////////////////////////////////////
+
+static RGBDConfiguration *
+ReadConfiguration(const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Reading configuration from %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Allocate configuration
+  RGBDConfiguration *configuration = new RGBDConfiguration();
+  if (!configuration) {
+    RNFail("Unable to allocate configuration for %s\n", filename);
+    return NULL;
+  }
+
+  // Read file
+  if (!configuration->ReadFile(filename)) {
+    RNFail("Unable to read configuration from %s\n", filename);
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", configuration->NImages());
+    fflush(stdout);
+  }
+
+  // Return configuration
+  return configuration;
+}
+
+
+
+static int
+WriteMesh(RGBDVolume *volume, const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Writing mesh to %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Write mesh (remeshing blocks changed since last update)
+  int ndirty_blocks = volume->NDirtyBlocks();
+  if (!volume->WriteMeshFile(filename)) return 0;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Remeshed Blocks = %d\n", ndirty_blocks);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// FUSION STUFF
+////////////////////////////////////////////////////////////////////////
+
+static int
+IntegrateImages(RGBDVolume *volume, RGBDConfiguration *configuration)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Integrating images ...\n");
+    fflush(stdout);
+  }
+
+  // Set volume parameters
+  if (max_weight > 0) volume->SetMaxWeight(max_weight);
+  volume->SetDepthRange(min_depth, (max_depth > 0) ? max_depth : FLT_MAX);
+
+  // Select images
+  int nselected_images = 0;
+  int *selected_image_indices = new int [ configuration->NImages() + 1 ];
+  for (int i = 0; i < configuration->NImages(); i++) {
+    if ((load_every_kth_image > 1) && ((i % load_every_kth_image) != 0)) continue;
+    if (i < load_images_starting_at_index) continue;
+    if (i > load_images_ending_at_index) continue;
+    selected_image_indices[nselected_images++] = i;
+  }
+
+  // Create frame cache (which reads images in parallel)
+  RGBDFrameCache frame_cache(configuration, RGBD_READ_COLOR_CHANNELS | RGBD_READ_DEPTH_CHANNEL,
+    (size_t) frame_cache_budget * 1024 * 1024);
+
+  // Integrate images
+  int batch_size = 2 * RNNThreads();
+  for (int k = 0; k < nselected_images; k++) {
+    int i = selected_image_indices[k];
+
+    // Prefetch next batch of images
+    if ((k % batch_size) == 0) {
+      int nimages = (k + batch_size < nselected_images) ? batch_size : nselected_images - k;
+      frame_cache.Prefetch(&selected_image_indices[k], nimages);
+    }
+
+    // Read image
+    RGBDImage *image = frame_cache.AcquireImage(i);
+    if (!image) continue;
+
+    // Integrate image
+    if (!volume->IntegrateImage(image)) {
+      frame_cache.ReleaseImage(i);
+      delete [] selected_image_indices;
+      return 0;
+    }
+
+    // Release image
+    frame_cache.ReleaseImage(i);
+
+    // Update mesh of changed blocks
+    if ((update_mesh_every_kth_image > 0) && ((k+1) % update_mesh_every_kth_image == 0)) {
+      if (!volume->UpdateMesh()) {
+        delete [] selected_image_indices;
+        return 0;
+      }
+    }
+
+    // Print progress
+    if (print_verbose) {
+      printf("  %d/%d : %d blocks\n", k+1, nselected_images, volume->NBlocks());
+      fflush(stdout);
+    }
+  }
+
+  // Delete selected image indices
+  delete [] selected_image_indices;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", volume->NIntegratedImages());
+    printf("  # Blocks = %d\n", volume->NBlocks());
+    printf("  Memory = %.1f MB\n", volume->MemoryUsage() / (1024.0 * 1024.0));
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PROGRAM ARGUMENT PARSING
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-voxel_size")) { argc--; argv++; voxel_size = atof(*argv); }
+      else if (!strcmp(*argv, "-truncation_distance")) { argc--; argv++; truncation_distance = atof(*argv); }
+      else if (!strcmp(*argv, "-max_weight")) { argc--; argv++; max_weight = atof(*argv); }
+      else if (!strcmp(*argv, "-min_depth")) { argc--; argv++; min_depth = atof(*argv); }
+      else if (!strcmp(*argv, "-max_depth")) { argc--; argv++; max_depth = atof(*argv); }
+      else if (!strcmp(*argv, "-update_mesh_every_kth_image")) { argc--; argv++; update_mesh_every_kth_image = atoi(*argv); }
+      else if (!strcmp(*argv, "-frame_cache_budget")) { argc--; argv++; frame_cache_budget = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_image_at_index")) { argc--; argv++; load_images_starting_at_index = load_images_ending_at_index = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_images_starting_at_index")) { argc--; argv++; load_images_starting_at_index = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_images_ending_at_index")) { argc--; argv++; load_images_ending_at_index = atoi(*argv); }
+      else if (!strcmp(*argv, "-load_every_kth_image")) { argc--; argv++; load_every_kth_image = atoi(*argv); }
+      else {
+        RNFail("Invalid program argument: %s", *argv);
+        exit(1);
+      }
+      argv++; argc--;
+    }
+    else {
+      if (!input_configuration_name) input_configuration_name = *argv;
+      else if (!output_mesh_name) output_mesh_name = *argv;
+      else { RNFail("Invalid program argument: %s", *argv); exit(1); }
+      argv++; argc--;
+    }
+  }
+
+  // Check filenames
+  if (!input_configuration_name || !output_mesh_name) {
+    RNFail("Usage: conf2msh inputconfigurationfile outputmeshfile [options]\n");
+    return 0;
+  }
+
+  // Check voxel size
+  if (voxel_size <= 0) {
+    RNFail("Invalid voxel size: %g\n", voxel_size);
+    return 0;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// MAIN
+////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  // Check number of arguments
+  if (!ParseArgs(argc, argv)) exit(1);
+
+  // Read configuration
+  RGBDConfiguration *configuration = ReadConfiguration(input_configuration_name);
+  if (!configuration) exit(-1);
+
+  // Integrate images
+  RGBDVolume volume(voxel_size, truncation_distance);
+  if (!IntegrateImages(&volume, configuration)) exit(-1);
+
+  // Write mesh
+  if (!WriteMesh(&volume, output_mesh_name)) exit(-1);
+
+  // Return success
+  return 0;
+}
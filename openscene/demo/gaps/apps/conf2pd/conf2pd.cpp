@@ -0,0 +1,385 @@
+// Source file for the program that packs rgbd images into pixel databases
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {}
+using namespace gaps;
+#include "RGBD/RGBD.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Program arguments
+////////////////////////////////////////////////////////////////////////
+
+// File input/output options
+
+static const char *input_configuration_name = NULL;
+static const char *output_configuration_name = NULL;
+static const char *output_color_database_name = NULL;
+static const char *output_depth_database_name = NULL;
+
+
+// Packing options
+
+static int compress_images = 0;
+static int skip_color_images = 0;
+static int skip_depth_images = 0;
+
+
+// Printing options
+
+static int print_verbose = 0;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// I/O STUFF
+////////////////////////////////////////////////////////////////////////
+
+static RGBDConfiguration *
+ReadConfiguration(const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Reading configuration from %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Allocate configuration
+  RGBDConfiguration *configuration = new RGBDConfiguration();
+  if (!configuration) {
+    RNFail("Unable to allocate configuration for %s\n", filename);
+    return NULL;
+  }
+
+  // Read file
+  if (!configuration->ReadFile(filename)) {
+    RNFail("Unable to read configuration from %s\n", filename);
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", configuration->NImages());
+    fflush(stdout);
+  }
+
+  // Return configuration
+  return configuration;
+}
+
+
+
+static int
+WriteConfiguration(RGBDConfiguration *configuration, const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Writing configuration to %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Point directories at pixel databases
+  if (output_color_database_name) configuration->SetColorDirectory(output_color_database_name);
+  if (output_depth_database_name) configuration->SetDepthDirectory(output_depth_database_name);
+
+  // Write file
+  if (!configuration->WriteFile(filename)) {
+    RNFail("Unable to write configuration to %s\n", filename);
+    return 0;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", configuration->NImages());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PACKING STUFF
+////////////////////////////////////////////////////////////////////////
+
+struct DecodeData {
+  RGBDConfiguration *configuration;
+  int *image_indices;
+  R2Image **color_images;
+  R2Grid **depth_images;
+};
+
+
+
+static void
+DecodeImagesCallback(int index, int thread_index, void *data)
+{
+  // Get convenient variables
+  DecodeData *decode = (DecodeData *) data;
+  RGBDConfiguration *configuration = decode->configuration;
+  RGBDImage *image = configuration->Image(decode->image_indices[index]);
+  char filename[4096];
+
+  // Decode color image
+  if (decode->color_images && image->ColorFilename()) {
+    const char *dirname = configuration->ColorDirectory();
+    if (dirname) sprintf(filename, "%s/%s", dirname, image->ColorFilename());
+    else sprintf(filename, "%s", image->ColorFilename());
+    R2Image *color_image = new R2Image();
+    if (color_image->ReadFile(filename)) decode->color_images[index] = color_image;
+    else delete color_image;
+  }
+
+  // Decode depth image
+  if (decode->depth_images && image->DepthFilename()) {
+    const char *dirname = configuration->DepthDirectory();
+    if (dirname) sprintf(filename, "%s/%s", dirname, image->DepthFilename());
+    else sprintf(filename, "%s", image->DepthFilename());
+    R2Grid *depth_image = new R2Grid();
+    if (depth_image->ReadFile(filename)) decode->depth_images[index] = depth_image;
+    else delete depth_image;
+  }
+}
+
+
+
+static int
+PackImages(RGBDConfiguration *configuration)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  int ncolor_images = 0;
+  int ndepth_images = 0;
+  if (print_verbose) {
+    printf("Packing images ...\n");
+    fflush(stdout);
+  }
+
+  // Check depth filenames (only 16-bit png depths are stored exactly)
+  if (output_depth_database_name) {
+    for (int i = 0; i < configuration->NImages(); i++) {
+      const char *filename = configuration->Image(i)->DepthFilename();
+      if (filename && !strstr(filename, ".png")) {
+        RNFail("Depth image %s is not a 16-bit png file, use -skip_depth\n", filename);
+        return 0;
+      }
+    }
+  }
+
+  // Open pixel databases
+  R2PixelDatabase color_database, depth_database;
+  if (output_color_database_name) {
+    if (!color_database.OpenFile(output_color_database_name, "w")) return 0;
+  }
+  if (output_depth_database_name) {
+    if (!depth_database.OpenFile(output_depth_database_name, "w")) return 0;
+  }
+
+  // Get formats
+  int color_format = (compress_images) ?
+    R2_PIXEL_DATABASE_3_8_PNG_FORMAT : R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT;
+  int depth_format = (compress_images) ?
+    R2_PIXEL_DATABASE_1_16_PNG_FORMAT : R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT;
+
+  // Allocate batch of decoded images
+  int batch_size = 2 * RNNThreads();
+  int *image_indices = new int [ batch_size ];
+  R2Image **color_images = new R2Image * [ batch_size ];
+  R2Grid **depth_images = new R2Grid * [ batch_size ];
+  DecodeData decode;
+  decode.configuration = configuration;
+  decode.image_indices = image_indices;
+  decode.color_images = (output_color_database_name) ? color_images : NULL;
+  decode.depth_images = (output_depth_database_name) ? depth_images : NULL;
+
+  // Pack images in batches (decoded in parallel, inserted in order)
+  int status = 1;
+  for (int k = 0; k < configuration->NImages(); k += batch_size) {
+    // Decode batch of images
+    int nimages = (k + batch_size < configuration->NImages()) ? batch_size : configuration->NImages() - k;
+    for (int i = 0; i < nimages; i++) {
+      image_indices[i] = k + i;
+      color_images[i] = NULL;
+      depth_images[i] = NULL;
+    }
+    RNParallelFor(nimages, DecodeImagesCallback, &decode);
+
+    // Insert decoded images into pixel databases
+    for (int i = 0; i < nimages; i++) {
+      RGBDImage *image = configuration->Image(image_indices[i]);
+
+      // Insert color image
+      if (color_images[i]) {
+        if (status && !color_database.FindImage(image->ColorFilename(), NULL)) {
+          if (color_database.InsertImage(image->ColorFilename(), *(color_images[i]), color_format)) ncolor_images++;
+          else {
+            RNFail("Unable to insert color image %s into %s\n", image->ColorFilename(), output_color_database_name);
+            status = 0;
+          }
+        }
+        delete color_images[i];
+      }
+      else if (decode.color_images && image->ColorFilename()) {
+        RNFail("Unable to read color image %s\n", image->ColorFilename());
+        status = 0;
+      }
+
+      // Insert depth image
+      if (depth_images[i]) {
+        if (status && !depth_database.FindGrid(image->DepthFilename(), NULL)) {
+          if (depth_database.InsertGrid(image->DepthFilename(), *(depth_images[i]),
+            0, 1, 1, FALSE, depth_format)) ndepth_images++;
+          else {
+            RNFail("Unable to insert depth image %s into %s\n", image->DepthFilename(), output_depth_database_name);
+            status = 0;
+          }
+        }
+        delete depth_images[i];
+      }
+      else if (decode.depth_images && image->DepthFilename()) {
+        RNFail("Unable to read depth image %s\n", image->DepthFilename());
+        status = 0;
+      }
+    }
+
+    // Check status
+    if (!status) break;
+
+    // Print progress
+    if (print_verbose) {
+      printf("  %d/%d\n", k + nimages, configuration->NImages());
+      fflush(stdout);
+    }
+  }
+
+  // Delete batch of decoded images
+  delete [] image_indices;
+  delete [] color_images;
+  delete [] depth_images;
+
+  // Check status
+  if (!status) return 0;
+
+  // Close pixel databases
+  if (output_color_database_name) {
+    if (!color_database.CloseFile()) return 0;
+  }
+  if (output_depth_database_name) {
+    if (!depth_database.CloseFile()) return 0;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Color Images = %d\n", ncolor_images);
+    printf("  # Depth Images = %d\n", ndepth_images);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PROGRAM ARGUMENT PARSING
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-png")) compress_images = 1;
+      else if (!strcmp(*argv, "-skip_color")) skip_color_images = 1;
+      else if (!strcmp(*argv, "-skip_depth")) skip_depth_images = 1;
+      else if (!strcmp(*argv, "-color_database")) { argc--; argv++; output_color_database_name = *argv; }
+      else if (!strcmp(*argv, "-depth_database")) { argc--; argv++; output_depth_database_name = *argv; }
+      else {
+        RNFail("Invalid program argument: %s", *argv);
+        exit(1);
+      }
+      argv++; argc--;
+    }
+    else {
+      if (!input_configuration_name) input_configuration_name = *argv;
+      else if (!output_configuration_name) output_configuration_name = *argv;
+      else { RNFail("Invalid program argument: %s", *argv); exit(1); }
+      argv++; argc--;
+    }
+  }
+
+  // Check filenames
+  if (!input_configuration_name || !output_configuration_name) {
+    RNFail("Usage: conf2pd inputconfigurationfile outputconfigurationfile [options]\n");
+    return 0;
+  }
+
+  // Choose database names (default is output configuration name with suffix)
+  static char color_database_name[4096], depth_database_name[4096];
+  char basename[4000];
+  strncpy(basename, output_configuration_name, 3999);
+  basename[3999] = '\0';
+  char *extension = strrchr(basename, '.');
+  if (extension && !strchr(extension, '/')) *extension = '\0';
+  if (skip_color_images) output_color_database_name = NULL;
+  else if (!output_color_database_name) {
+    sprintf(color_database_name, "%s_color.pd", basename);
+    output_color_database_name = color_database_name;
+  }
+  if (skip_depth_images) output_depth_database_name = NULL;
+  else if (!output_depth_database_name) {
+    sprintf(depth_database_name, "%s_depth.pd", basename);
+    output_depth_database_name = depth_database_name;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// MAIN
+////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+  // Check number of arguments
+  if (!ParseArgs(argc, argv)) exit(1);
+
+  // Read configuration
+  RGBDConfiguration *configuration = ReadConfiguration(input_configuration_name);
+  if (!configuration) exit(-1);
+
+  // Pack images into pixel databases
+  if (!PackImages(configuration)) exit(-1);
+
+  // Write configuration that reads from pixel databases
+  if (!WriteConfiguration(configuration, output_configuration_name)) exit(-1);
+
+  // Delete configuration
+  delete configuration;
+
+  // Return success
+  return 0;
+}
@@ -45,6 +45,17 @@ static int omit_corners = 0;
 static int pixel_stride = 1;
 
 
+// Normal estimation options
+
+static RNBoolean integral_image_normals = FALSE;
+
+
+// Frame cache options
+
+static const char *frame_cache_directory = NULL;
+static int frame_cache_budget = 2048;
+
+
 // Surfel processing options
 
 static RNBoolean create_multiresolution_hierarchy = FALSE;
@@ -801,32 +812,46 @@ LoadSurfels(R3SurfelScene *scene,
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Frame channels (computed in parallel by the frame cache)
+////////////////////////////////////////////////////////////////////////
+
+enum {
+  FRAME_DEPTH_CHANNEL,
+  FRAME_RED_CHANNEL,
+  FRAME_GREEN_CHANNEL,
+  FRAME_BLUE_CHANNEL,
+  FRAME_BOUNDARY_CHANNEL,
+  FRAME_PX_CHANNEL,
+  FRAME_PY_CHANNEL,
+  FRAME_PZ_CHANNEL,
+  FRAME_NX_CHANNEL,
+  FRAME_NY_CHANNEL,
+  FRAME_NZ_CHANNEL,
+  FRAME_TX_CHANNEL,
+  FRAME_TY_CHANNEL,
+  FRAME_TZ_CHANNEL,
+  FRAME_R1_CHANNEL,
+  FRAME_R2_CHANNEL,
+  FRAME_NUM_CHANNELS
+};
+
+static const char *frame_channel_names[FRAME_NUM_CHANNELS] = {
+  "depth", "red", "green", "blue", "boundary",
+  "px", "py", "pz", "nx", "ny", "nz", "tx", "ty", "tz", "r1", "r2"
+};
+
+
+
 static int
-LoadSurfels(R3SurfelScene *scene, RGBDImage *image)
+CreateFrameChannels(RGBDImage *image, R2Grid *channels, void *)
 {
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-  if (print_verbose) {
-    printf("  Processing %s\n", image->Name());
-    fflush(stdout);
-  }
-
   // Get useful variables
   R3Point viewpoint = image->WorldViewpoint();
   R3Vector towards = image->WorldTowards();
   R3Vector up = image->WorldUp();
   R3Matrix intrinsics = image->Intrinsics();
   R4Matrix camera_to_world = image->CameraToWorld().Matrix();
-  const char *scan_name = image->Name();
-  
-  // Print timing message
-  RNTime step_time;
-  if (print_debug) {
-    printf("    A\n");
-    fflush(stdout);
-    step_time.Read();
-  }
 
   // Get color and depth channels
   R2Grid *red_channel = image->RedChannel();
@@ -839,7 +864,8 @@ LoadSurfels(R3SurfelScene *scene, RGBDImage *image)
   }
 
   // Resample images
-  R2Grid depth_image(*depth_channel);
+  R2Grid& depth_image = channels[FRAME_DEPTH_CHANNEL];
+  depth_image = *depth_channel;
   R2Image color_image(*red_channel, *green_channel, *blue_channel);
   if ((max_image_resolution > 0) && (max_image_resolution != image->NPixels(RN_X))) {
     R3Matrix tmp = intrinsics;
@@ -848,50 +874,98 @@ LoadSurfels(R3SurfelScene *scene, RGBDImage *image)
     if (!RGBDResampleDepthImage(depth_image, intrinsics, xresolution, yresolution)) return 0;
     if (!RGBDResampleColorImage(color_image, tmp, xresolution, yresolution)) return 0;
   }
-  
-  // Print timing message
-  if (print_debug) {
-    printf("    B %g %d %d %g\n", step_time.Elapsed(), depth_image.XResolution(), depth_image.YResolution(), depth_image.Mean());
-    fflush(stdout);
-    step_time.Read();
+
+  // Copy color channels
+  for (int i = 0; i < 3; i++) {
+    R2Grid& color_channel = channels[FRAME_RED_CHANNEL + i];
+    color_channel = R2Grid(color_image.Width(), color_image.Height());
+    for (int iy = 0; iy < color_image.Height(); iy++) {
+      for (int ix = 0; ix < color_image.Width(); ix++) {
+        color_channel.SetGridValue(ix, iy, color_image.PixelRGB(ix, iy)[i]);
+      }
+    }
   }
 
   // Create boundary image
-  R2Grid boundary_image;
+  R2Grid& boundary_image = channels[FRAME_BOUNDARY_CHANNEL];
   if (!RGBDCreateBoundaryChannel(depth_image, boundary_image)) return 0;
 
-  // Print timing message
-  if (print_debug) {
-    printf("    E %g\n", step_time.Elapsed());
-    fflush(stdout);
-    step_time.Read();
+  // Create position images
+  if (!RGBDCreatePositionChannels(depth_image,
+    channels[FRAME_PX_CHANNEL], channels[FRAME_PY_CHANNEL], channels[FRAME_PZ_CHANNEL],
+    intrinsics, camera_to_world)) return 0;
+
+  // Create normal, tangent, and radius images
+  if (integral_image_normals) {
+    // Estimate from covariances of square pixel windows (fast)
+    if (!RGBDCreateIntegralImageTangentChannels(depth_image,
+      channels[FRAME_PX_CHANNEL], channels[FRAME_PY_CHANNEL], channels[FRAME_PZ_CHANNEL],
+      channels[FRAME_NX_CHANNEL], channels[FRAME_NY_CHANNEL], channels[FRAME_NZ_CHANNEL],
+      channels[FRAME_TX_CHANNEL], channels[FRAME_TY_CHANNEL], channels[FRAME_TZ_CHANNEL],
+      channels[FRAME_R1_CHANNEL], channels[FRAME_R2_CHANNEL],
+      viewpoint)) return 0;
   }
+  else if (!RGBDCreateTangentChannels(depth_image,
+    channels[FRAME_PX_CHANNEL], channels[FRAME_PY_CHANNEL], channels[FRAME_PZ_CHANNEL], boundary_image,
+    channels[FRAME_NX_CHANNEL], channels[FRAME_NY_CHANNEL], channels[FRAME_NZ_CHANNEL],
+    channels[FRAME_TX_CHANNEL], channels[FRAME_TY_CHANNEL], channels[FRAME_TZ_CHANNEL],
+    channels[FRAME_R1_CHANNEL], channels[FRAME_R2_CHANNEL],
+    viewpoint, towards, up)) return 0;
 
-  // Create position images
-  R2Grid px_image, py_image, pz_image;
-  if (!RGBDCreatePositionChannels(depth_image, px_image, py_image, pz_image, intrinsics, camera_to_world)) return 0;
+  // Return success
+  return 1;
+}
 
-  // Print timing message
-  if (print_debug) {
-    printf("    F %g\n", step_time.Elapsed());
+
+
+static int
+LoadSurfels(R3SurfelScene *scene, RGBDImage *image, const R2Grid *channels)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("  Processing %s\n", image->Name());
     fflush(stdout);
-    step_time.Read();
   }
 
-  // Create normal, tangent, and radius images
-  R2Grid nx_image, ny_image, nz_image;
-  R2Grid tx_image, ty_image, tz_image;
-  R2Grid r1_image, r2_image;
-  if (!RGBDCreateTangentChannels(depth_image, 
-    px_image, py_image, pz_image, boundary_image, 
-    nx_image, ny_image, nz_image,
-    tx_image, ty_image, tz_image,
-    r1_image, r2_image,
-    viewpoint, towards, up)) return 0;
-  
+  // Get useful variables
+  R3Point viewpoint = image->WorldViewpoint();
+  R3Vector towards = image->WorldTowards();
+  R3Vector up = image->WorldUp();
+  R3Matrix intrinsics = image->Intrinsics();
+  const char *scan_name = image->Name();
+
+  // Get frame channels
+  const R2Grid& depth_image = channels[FRAME_DEPTH_CHANNEL];
+  const R2Grid& boundary_image = channels[FRAME_BOUNDARY_CHANNEL];
+  const R2Grid& px_image = channels[FRAME_PX_CHANNEL];
+  const R2Grid& py_image = channels[FRAME_PY_CHANNEL];
+  const R2Grid& pz_image = channels[FRAME_PZ_CHANNEL];
+  const R2Grid& nx_image = channels[FRAME_NX_CHANNEL];
+  const R2Grid& ny_image = channels[FRAME_NY_CHANNEL];
+  const R2Grid& nz_image = channels[FRAME_NZ_CHANNEL];
+  const R2Grid& tx_image = channels[FRAME_TX_CHANNEL];
+  const R2Grid& ty_image = channels[FRAME_TY_CHANNEL];
+  const R2Grid& tz_image = channels[FRAME_TZ_CHANNEL];
+  const R2Grid& r1_image = channels[FRAME_R1_CHANNEL];
+  const R2Grid& r2_image = channels[FRAME_R2_CHANNEL];
+  R2Image color_image(channels[FRAME_RED_CHANNEL], channels[FRAME_GREEN_CHANNEL], channels[FRAME_BLUE_CHANNEL]);
+
+  // Scale intrinsics to resolution of frame channels (as done by RGBDResampleDepthImage)
+  if ((depth_image.XResolution() != image->NPixels(RN_X)) || (depth_image.YResolution() != image->NPixels(RN_Y))) {
+    double xscale = (double) image->NPixels(RN_X) / (double) depth_image.XResolution();
+    double yscale = (double) image->NPixels(RN_Y) / (double) depth_image.YResolution();
+    intrinsics[0][0] /= xscale;
+    intrinsics[0][2] /= xscale;
+    intrinsics[1][1] /= yscale;
+    intrinsics[1][2] /= yscale;
+  }
+
   // Print timing message
+  RNTime step_time;
   if (print_debug) {
-    printf("    G %g\n", step_time.Elapsed());
+    printf("    A %d %d %g\n", depth_image.XResolution(), depth_image.YResolution(), depth_image.Mean());
     fflush(stdout);
     step_time.Read();
   }
@@ -961,25 +1035,55 @@ LoadSurfels(R3SurfelScene *scene, RGBDConfiguration *configuration)
     fflush(stdout);
   }
 
-  // Load images
+  // Select images
+  int nselected_images = 0;
+  int *selected_image_indices = new int [ configuration->NImages() + 1 ];
   for (int i = 0; i < configuration->NImages(); i++) {
     RGBDImage *image = configuration->Image(i);
-   
-    // Check if should load image
     if ((load_every_kth_image > 1) && ((i % load_every_kth_image) != 0)) continue; 
     if (i < load_images_starting_at_index) continue;
     if (i > load_images_ending_at_index) continue;
     if (!load_images_bbox.IsEmpty() && !R3Contains(load_images_bbox, image->WorldViewpoint())) continue;
+    selected_image_indices[nselected_images++] = i;
+  }
+
+  // Create frame cache (which reads images and computes their channels in parallel)
+  RGBDFrameCache frame_cache(configuration, RGBD_READ_COLOR_CHANNELS | RGBD_READ_DEPTH_CHANNEL,
+    (size_t) frame_cache_budget * 1024 * 1024);
+  frame_cache.SetDerivedChannels(FRAME_NUM_CHANNELS, frame_channel_names, CreateFrameChannels);
+  if (frame_cache_directory) {
+    char frame_cache_parameters[256];
+    sprintf(frame_cache_parameters, "max_image_resolution=%d integral_image_normals=%d",
+      max_image_resolution, integral_image_normals);
+    frame_cache.SetDerivedChannelDirectory(frame_cache_directory);
+    frame_cache.SetDerivedChannelParameters(frame_cache_parameters);
+  }
+
+  // Load images
+  int batch_size = 2 * RNNThreads();
+  for (int k = 0; k < nselected_images; k++) {
+    int i = selected_image_indices[k];
+
+    // Prefetch next batch of images
+    if ((k % batch_size) == 0) {
+      int nimages = (k + batch_size < nselected_images) ? batch_size : nselected_images - k;
+      frame_cache.Prefetch(&selected_image_indices[k], nimages);
+    }
 
     // Read image
-    if (!image->ReadChannels()) continue;
+    RGBDImage *image = frame_cache.AcquireImage(i);
+    if (!image) continue;
 
     // Load image
-    if (!LoadSurfels(scene, image)) continue;
+    const R2Grid *channels = frame_cache.DerivedChannel(i, 0);
+    LoadSurfels(scene, image, channels);
 
     // Release image
-    if (!image->ReleaseChannels()) continue;
+    frame_cache.ReleaseImage(i);
   }
+
+  // Delete selected image indices
+  delete [] selected_image_indices;
   
   // Print statistics
   if (print_verbose) {
@@ -1069,6 +1173,9 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-max_depth")) { argc--; argv++; max_depth = atof(*argv); }
       else if (!strcmp(*argv, "-pixel_stride")) { argc--; argv++; pixel_stride = atoi(*argv); }
       else if (!strcmp(*argv, "-omit_corners")) omit_corners = 1;
+      else if (!strcmp(*argv, "-integral_image_normals")) integral_image_normals = TRUE;
+      else if (!strcmp(*argv, "-frame_cache_directory")) { argc--; argv++; frame_cache_directory = *argv; }
+      else if (!strcmp(*argv, "-frame_cache_budget")) { argc--; argv++; frame_cache_budget = atoi(*argv); }
       else if (!strcmp(*argv, "-load_image_at_index")) { argc--; argv++; load_images_starting_at_index = load_images_ending_at_index = atoi(*argv); }
       else if (!strcmp(*argv, "-load_images_starting_at_index")) { argc--; argv++; load_images_starting_at_index = atoi(*argv); }
       else if (!strcmp(*argv, "-load_images_ending_at_index")) { argc--; argv++; load_images_ending_at_index = atoi(*argv); }
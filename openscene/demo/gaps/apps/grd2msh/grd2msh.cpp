@@ -15,6 +15,7 @@ using namespace gaps;
 static char *grid_name = NULL;
 static char *mesh_name = NULL;
 static RNScalar threshold = 0;
+static RNBoolean dual_contouring = FALSE;
 static RNBoolean print_verbose = FALSE;
 
 
@@ -62,6 +63,49 @@ ReadGrid(char *grid_name)
 
 
 
+static R3SparseGrid *
+ReadSparseGrid(char *grid_name)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Allocate grid
+  R3SparseGrid *grid = new R3SparseGrid();
+  if (!grid) {
+    RNFail("Unable to allocated sparse grid");
+    return NULL;
+  }
+
+  // Read grid 
+  if (!grid->ReadFile(grid_name)) {
+    RNFail("Unable to read sparse grid file %s", grid_name);
+    delete grid;
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Read sparse grid ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  Resolution = %d %d %d\n", grid->XResolution(), grid->YResolution(), grid->ZResolution());
+    const R3Box bbox = grid->WorldBox();
+    printf("  World Box = ( %g %g %g ) ( %g %g %g )\n", bbox[0][0], bbox[0][1], bbox[0][2], bbox[1][0], bbox[1][1], bbox[1][2]);
+    printf("  Spacing = %g\n", grid->GridToWorldScaleFactor());
+    printf("  # Blocks = %d\n", grid->NBlocks());
+    printf("  Memory = %lld bytes\n", (long long) grid->MemoryUsage());
+    RNInterval grid_range = grid->Range();
+    printf("  Minimum = %g\n", grid_range.Min());
+    printf("  Maximum = %g\n", grid_range.Max());
+    fflush(stdout);
+  }
+
+  // Return success
+  return grid;
+}
+
+
+
 static R3Mesh *
 CreateMesh(R3Grid *grid, RNScalar threshold)
 {
@@ -76,24 +120,72 @@ CreateMesh(R3Grid *grid, RNScalar threshold)
     return NULL;
   }
 
-  // Extract isosurface from grid
-  const int max_points = 16 * 1024 * 1024;
-  static R3Point points[max_points];
-  int npoints = grid->GenerateIsoSurface(threshold, points, max_points);
-  if (npoints == 0) {
+  // Extract isosurface from grid (vertices are shared by adjacent triangles)
+  if (!grid->GenerateIsoSurface(threshold, mesh, dual_contouring)) {
+    RNFail("Unable to extract isosurface\n");
+    return NULL;
+  }
+
+  // Check isosurface
+  if (mesh->NFaces() == 0) {
     RNFail("Empty isosurface for threshold: %g\n", threshold);
     return NULL;
   }
 
+  // Reverse orientation of faces
+  mesh->FlipFaces();
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Created mesh ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Faces = %d\n", mesh->NFaces());
+    printf("  # Edges = %d\n", mesh->NEdges());
+    printf("  # Vertices = %d\n", mesh->NVertices());
+    fflush(stdout);
+  }
+
+  // Return mesh
+  return mesh;
+}
+
+
+
+static R3Mesh *
+CreateMesh(R3SparseGrid *grid, RNScalar threshold)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Check options
+  if (dual_contouring) {
+    RNFail("Dual contouring is not supported for sparse grids\n");
+    return NULL;
+  }
+
   // Create mesh
-  R3Point *pointsp = points;
-  for (int i = 0; i < npoints; i += 3) {
-    R3MeshVertex *v1 = mesh->CreateVertex(grid->WorldPosition(*(pointsp++)));
-    R3MeshVertex *v2 = mesh->CreateVertex(grid->WorldPosition(*(pointsp++)));
-    R3MeshVertex *v3 = mesh->CreateVertex(grid->WorldPosition(*(pointsp++)));
-    mesh->CreateFace(v3, v2, v1);
+  R3Mesh *mesh = new R3Mesh();
+  if (!mesh) {
+    RNFail("Unable to allocate mesh\n");
+    return NULL;
   }
 
+  // Extract isosurface from allocated blocks of grid
+  if (!grid->GenerateIsoSurface(threshold, mesh)) {
+    RNFail("Unable to extract isosurface\n");
+    return NULL;
+  }
+
+  // Check isosurface
+  if (mesh->NFaces() == 0) {
+    RNFail("Empty isosurface for threshold: %g\n", threshold);
+    return NULL;
+  }
+
+  // Reverse orientation of faces
+  mesh->FlipFaces();
+
   // Print statistics
   if (print_verbose) {
     printf("Created mesh ...\n");
@@ -141,7 +233,7 @@ ParseArgs(int argc, char **argv)
 {
   // Check number of arguments
   if ((argc == 2) && (*argv[1] == '-')) {
-    printf("Usage: grd2off gridfile meshfile -threshold <real> [-v]\n");
+    printf("Usage: grd2off gridfile meshfile -threshold <real> [-dual_contouring] [-v]\n");
     exit(0);
   }
 
@@ -151,6 +243,7 @@ ParseArgs(int argc, char **argv)
     if ((*argv)[0] == '-') {
       if (!strcmp(*argv, "-v")) print_verbose = TRUE; 
       else if (!strcmp(*argv, "-threshold")) { argc--; argv++; threshold = atof(*argv); }
+      else if (!strcmp(*argv, "-dual_contouring")) dual_contouring = TRUE;
       else { 
         RNFail("Invalid program argument: %s\n", *argv); 
         exit(1); 
@@ -180,13 +273,21 @@ main(int argc, char **argv)
   // Parse program arguments
   if (!ParseArgs(argc, argv)) exit(-1);
 
-  // Read grid
-  R3Grid *grid = ReadGrid(grid_name);
-  if (!grid) exit(-1);
-
-  // Create isosurface
-  R3Mesh *mesh = CreateMesh(grid, threshold);
-  if (!mesh) exit(-1);
+  // Create isosurface from sparse or dense grid
+  R3Mesh *mesh = NULL;
+  const char *extension = strrchr(grid_name, '.');
+  if (extension && !strcmp(extension, ".sgd")) {
+    R3SparseGrid *grid = ReadSparseGrid(grid_name);
+    if (!grid) exit(-1);
+    mesh = CreateMesh(grid, threshold);
+    if (!mesh) exit(-1);
+  }
+  else {
+    R3Grid *grid = ReadGrid(grid_name);
+    if (!grid) exit(-1);
+    mesh = CreateMesh(grid, threshold);
+    if (!mesh) exit(-1);
+  }
 
   // Write mesh
   int status = WriteMesh(mesh, mesh_name);
@@ -21,6 +21,7 @@ static RNArray<const char *> input_image_filenames;
 static RNArray<const char *> input_list_filenames;
 static RNArray<const char *> input_image_directories;
 static const char *output_pixel_database_filename = NULL;
+static int output_format = R2_PIXEL_DATABASE_3_8_PNG_FORMAT;
 static int print_verbose = 0;
 static int print_debug = 0;
 
@@ -44,7 +45,7 @@ AddImageToPixelDatabase(R2PixelDatabase& pd, const char *image_filename)
   // Add image to pixel database
   R2Image image;
   if (!image.ReadFile(image_filename)) return 0;
-  pd.InsertImage(image_filename, image);
+  pd.InsertImage(image_filename, image, output_format);
 
   // Increment image counter
   image_count++;
@@ -131,6 +132,9 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-debug")) {
         print_debug = 1;
       }
+      else if (!strcmp(*argv, "-uncompressed")) {
+        output_format = R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT;
+      }
       else if (!strcmp(*argv, "-list")) {
         argc--; argv++; input_list_filenames.Insert(*argv);
       }
@@ -30,6 +30,8 @@ RNScalar smooth_factor = 0;
 R3Affine xform(R4Matrix(1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1));
 RNLength min_edge_length = 0;
 RNLength max_edge_length = 0;
+int max_decimated_faces = -1;
+RNLength max_decimation_error = RN_INFINITY;
 RNLength min_component_area = 0;
 char *xform_name = NULL;
 int scale_by_area = 0;
@@ -491,6 +493,8 @@ int ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-xform")) { argv++; argc--; R4Matrix m;  if (ReadMatrix(m, *argv)) { xform = R3identity_affine; xform.Transform(R3Affine(m)); xform.Transform(prev_xform);} } 
       else if (!strcmp(*argv, "-min_edge_length")) { argv++; argc--; min_edge_length = atof(*argv); }
       else if (!strcmp(*argv, "-max_edge_length")) { argv++; argc--; max_edge_length = atof(*argv); }
+      else if (!strcmp(*argv, "-decimate")) { argv++; argc--; max_decimated_faces = atoi(*argv); }
+      else if (!strcmp(*argv, "-max_decimation_error")) { argv++; argc--; max_decimation_error = atof(*argv); }
       else if (!strcmp(*argv, "-remove_small_components")) { argv++; argc--; min_component_area = atof(*argv); }
       else if (!strcmp(*argv, "-source_mesh")) { argv++; argc--; source_mesh_name = *argv; }
       else if (!strcmp(*argv, "-merge_list")) { argv++; argc--; merge_list_name = *argv; }
@@ -646,6 +650,20 @@ int main(int argc, char **argv)
     mesh->CollapseShortEdges(min_edge_length);
   }
 
+  // Decimate
+  if ((max_decimated_faces >= 0) || (max_decimation_error < RN_INFINITY)) {
+    RNTime start_time;
+    start_time.Read();
+    int nfaces = mesh->NFaces();
+    mesh->Decimate((max_decimated_faces >= 0) ? max_decimated_faces : 0, max_decimation_error);
+    if (print_verbose) {
+      printf("Decimated mesh ...\n");
+      printf("  Time = %.2f seconds\n", start_time.Elapsed());
+      printf("  # Faces = %d -> %d\n", nfaces, mesh->NFaces());
+      fflush(stdout);
+    }
+  }
+
   // Swap edges
   if (swap_edges) {
     mesh->SwapEdges();
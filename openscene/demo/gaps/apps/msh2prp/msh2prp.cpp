@@ -33,6 +33,7 @@ static char *input_mturk_segmentation_name = NULL;
 static char *input_mturk_annotation_name = NULL;
 static char *input_mturk_label_mapping_name = NULL;
 static char *input_map_name = NULL;
+static int append_properties = 0;
 static int print_verbose = 0;
 static int print_debug = 0;
 
@@ -82,8 +83,18 @@ WriteProperties(R3MeshPropertySet *properties, char *filename)
   RNTime start_time;
   start_time.Read();
 
-  // Write properties to file
-  if (!properties->Write(filename)) {
+  // Write properties to file (or append columns to existing columnar file)
+  if (append_properties) {
+    if (!strstr(filename, ".prc")) {
+      RNFail("Properties can only be appended to columnar (.prc) files: %s\n", filename);
+      return 0;
+    }
+    if (!properties->AppendColumns(filename)) {
+      RNFail("Unable to append properties to %s\n", filename);
+      return 0;
+    }
+  }
+  else if (!properties->Write(filename)) {
     RNFail("Unable to write properties to %s\n", filename);
     return 0;
   }
@@ -297,36 +308,32 @@ CreateVertexSampling(R3Mesh *mesh, int num_vertices, RNScalar *weights)
     }
   }
   else {
+    // Build geodesic distance engine
+    R3MeshGeodesics geodesics(*mesh);
+
     // Select random starting vertex
-    int i = (int) (RNRandomScalar() * mesh->NVertices());
-    R3MeshVertex *vertex = mesh->Vertex(i);
-    selected_vertices->Insert(vertex);
-    
-    // Iteratively select furthest vertex
-    for (int i = 0; i < num_vertices; i++) {
-
-      // Compute distances from selected vertices to all vertices
-      RNLength *distances = mesh->DijkstraDistances(*selected_vertices);
-      
-      // Find furthest vertex
-      float furthest_distance = 0;
-      R3MeshVertex *furthest_vertex = NULL;
-      for (int j = 0; j < mesh->NVertices(); j++) {
-        if (distances[j] > furthest_distance) {
-          furthest_distance = distances[j];
-          furthest_vertex = mesh->Vertex(j);
-        }
+    int start_index = (int) (RNRandomScalar() * mesh->NVertices());
+
+    // Find vertex furthest from starting vertex
+    RNLength *distances = new RNLength [ mesh->NVertices() ];
+    geodesics.ComputeDistances(1, &start_index, distances);
+    int furthest_index = start_index;
+    RNLength furthest_distance = 0;
+    for (int j = 0; j < mesh->NVertices(); j++) {
+      if (distances[j] == FLT_MAX) continue;
+      if (distances[j] > furthest_distance) {
+        furthest_distance = distances[j];
+        furthest_index = j;
       }
-      
-      // Check if found furthest vertex
-      if (!furthest_vertex) break;
-      
-      // Add furthest vertex to selected set
-      if (i == 0) selected_vertices->Truncate(0);
-      selected_vertices->Insert(furthest_vertex);
-
-      // Delete distances
-      delete [] distances;
+    }
+    delete [] distances;
+    
+    // Iteratively select furthest vertex, starting from the furthest one
+    std::vector<int> samples;
+    samples.push_back(furthest_index);
+    geodesics.SelectFurthestVertices(num_vertices, samples);
+    for (unsigned int j = 0; j < samples.size(); j++) {
+      selected_vertices->Insert(mesh->Vertex(samples[j]));
     }
 
     // Assign weights equally (hoping that FPS spread points evenly)
@@ -582,6 +589,75 @@ static void diagonalize_curv(const R3Vector &old_u, const R3Vector &old_v,
 
 
 
+struct FaceCurvatureData {
+  R3Mesh *mesh;
+  R3Vector *tangents;
+  R3Vector *bitangents;
+  RNScalar *tensors;
+};
+
+
+
+static void
+EstimateFaceCurvature(int face_index, int, void *data)
+{
+  // Get face vertices
+  FaceCurvatureData *curvature_data = (FaceCurvatureData *) data;
+  R3Mesh *mesh = curvature_data->mesh;
+  R3MeshFace * face = mesh->Face(face_index);
+  R3MeshVertex * vertex[3];
+  vertex[0] = mesh->VertexOnFace(face, 0);
+  vertex[1] = mesh->VertexOnFace(face, 1);
+  vertex[2] = mesh->VertexOnFace(face, 2);
+  // Edges
+  R3Vector e[3];
+  e[0] = mesh->VertexPosition(vertex[2]) - mesh->VertexPosition(vertex[1]);
+  e[1] = mesh->VertexPosition(vertex[0]) - mesh->VertexPosition(vertex[2]);
+  e[2] = mesh->VertexPosition(vertex[1]) - mesh->VertexPosition(vertex[0]);
+  // N-T-B coordinate system per face
+  R3Vector t = e[0];
+  t.Normalize();
+  R3Vector n = e[0] % e[1];
+  R3Vector b = n % t;
+  b.Normalize();
+
+  // Estimate curvature based on variation of normals along edges
+  RNScalar m[3] = { 0.0, 0.0, 0.0 };
+  RNScalar w[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
+  for (int j = 0; j < 3; j++) {
+    RNScalar u = e[j].Dot(t);
+    RNScalar v = e[j].Dot(b);
+    w[0][0] += u*u;
+    w[0][1] += u*v;
+    w[2][2] += v*v;
+    R3Vector dn = mesh->VertexNormal(vertex[(j+2)%3]) -
+      mesh->VertexNormal(vertex[(j+1)%3]);
+    RNScalar dnu = dn.Dot(t);
+    RNScalar dnv = dn.Dot(b);
+    m[0] += dnu*u;
+    m[1] += dnu*v + dnv*u;
+    m[2] += dnv*v;
+  }
+  w[1][1] = w[0][0] + w[2][2];
+  w[1][2] = w[0][1];
+  w[1][0] = w[0][1];
+  w[2][1] = w[1][2];
+  RNScalar matrix_a[9];
+  for (int kk=0; kk<9; kk++) {
+    matrix_a[kk] = w[kk/3][kk%3];
+  }
+  RNScalar bp[3];
+  bp[0]=m[0];bp[1]=m[1];bp[2]=m[2];
+  RNSvdSolve(3, 3, matrix_a, bp, m, 0.0);
+
+  // Store curvature tensor and coordinate system for face
+  curvature_data->tangents[face_index] = t;
+  curvature_data->bitangents[face_index] = b;
+  for (int j = 0; j < 3; j++) curvature_data->tensors[3*face_index+j] = m[j];
+}
+
+
+
 static R3MeshPropertySet *
 ComputeCurvatureProperties(R3Mesh *mesh)
 {
@@ -612,6 +688,7 @@ ComputeCurvatureProperties(R3Mesh *mesh)
 
   // Compute Vertex Area
   double *pointareas = new double [ nv ];
+  for (int i = 0; i < nv; i++) pointareas[i] = 0;
   R3Vector *cornerareas = new R3Vector [ nf ];
   for (int i = 0; i < nf; i++) {
     // Edges
@@ -663,6 +740,7 @@ ComputeCurvatureProperties(R3Mesh *mesh)
   RNScalar *curv1 = new RNScalar [nv];
   RNScalar *curv2 = new RNScalar [nv];
   RNScalar *curv12 = new RNScalar [nv];
+  for (int i = 0; i < nv; i++) curv1[i] = curv2[i] = curv12[i] = 0;
   R3Vector *pdir1 = new R3Vector [nv];
   R3Vector *pdir2 = new R3Vector [nv];
 
@@ -688,58 +766,23 @@ ComputeCurvatureProperties(R3Mesh *mesh)
     pdir2[i] = mesh->VertexNormal(vertex) % pdir1[i];
   }
 
-  // Compute curvature per-face
+  // Compute curvature per-face (in parallel)
+  FaceCurvatureData curvature_data;
+  curvature_data.mesh = mesh;
+  curvature_data.tangents = new R3Vector [ nf ];
+  curvature_data.bitangents = new R3Vector [ nf ];
+  curvature_data.tensors = new RNScalar [ 3 * nf ];
+  RNParallelFor(nf, EstimateFaceCurvature, &curvature_data, 256);
+
+  // Accumulate face curvatures at vertices
   for (int i = 0; i < nf; i++) {
     R3MeshFace * face = mesh->Face(i);
-    R3MeshVertex * vertex[3];
-    vertex[0] = mesh->VertexOnFace(face, 0);
-    vertex[1] = mesh->VertexOnFace(face, 1);
-    vertex[2] = mesh->VertexOnFace(face, 2);
-    // Edges
-    R3Vector e[3];
-    e[0] = mesh->VertexPosition(vertex[2]) - mesh->VertexPosition(vertex[1]);
-    e[1] = mesh->VertexPosition(vertex[0]) - mesh->VertexPosition(vertex[2]);
-    e[2] = mesh->VertexPosition(vertex[1]) - mesh->VertexPosition(vertex[0]);
-    // N-T-B coordinate system per face
-    R3Vector t = e[0];
-    t.Normalize();
-    R3Vector n = e[0] % e[1];
-    R3Vector b = n % t;
-    b.Normalize();
-
-    // Estimate curvature based on variation of normals along edges
-    RNScalar m[3] = { 0.0, 0.0, 0.0 };
-    RNScalar w[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
-    for (int j = 0; j < 3; j++) {
-      RNScalar u = e[j].Dot(t);
-      RNScalar v = e[j].Dot(b);
-      w[0][0] += u*u;
-      w[0][1] += u*v;
-      w[2][2] += v*v;
-      R3Vector dn = mesh->VertexNormal(vertex[(j+2)%3]) -
-        mesh->VertexNormal(vertex[(j+1)%3]);
-      RNScalar dnu = dn.Dot(t);
-      RNScalar dnv = dn.Dot(b);
-      m[0] += dnu*u;
-      m[1] += dnu*v + dnv*u;
-      m[2] += dnv*v;
-    }
-    w[1][1] = w[0][0] + w[2][2];
-    w[1][2] = w[0][1];
-    w[1][0] = w[0][1];
-    w[2][1] = w[1][2];
-    RNScalar * matrix_a = new RNScalar[9];
-    for (int kk=0; kk<9; kk++) {
-      matrix_a[kk] = w[kk/3][kk%3];
-    }
-    RNScalar * bp = new RNScalar[3];
-    bp[0]=m[0];bp[1]=m[1];bp[2]=m[2];
-    RNSvdSolve(3, 3, matrix_a, bp, m, 0.0);
-    delete[] matrix_a;
-    delete[] bp;
+    const R3Vector& t = curvature_data.tangents[i];
+    const R3Vector& b = curvature_data.bitangents[i];
+    const RNScalar *m = &curvature_data.tensors[3*i];
     // Push it back out to the vertices
     for (int j = 0; j < 3; j++) {
-      int vj = mesh->VertexID(vertex[j]);
+      int vj = mesh->VertexID(mesh->VertexOnFace(face, j));
       RNScalar c1, c12, c2;
       proj_curv(t, b, m[0], m[1], m[2], pdir1[vj], pdir2[vj], c1, c12, c2);
       RNScalar wt = (pointareas[vj] > 0) ? cornerareas[i][j] / pointareas[vj] : 1;
@@ -776,6 +819,9 @@ ComputeCurvatureProperties(R3Mesh *mesh)
   delete [] curv12;
   delete [] pdir1;
   delete [] pdir2;
+  delete [] curvature_data.tangents;
+  delete [] curvature_data.bitangents;
+  delete [] curvature_data.tensors;
 
   // Print statistics
   if (print_verbose) {
@@ -1015,16 +1061,20 @@ ComputeBoundaryProperties(R3Mesh *mesh)
   }
 
   // Create array of boundary vertices
-  RNArray<R3MeshVertex *> boundary_vertices;
+  std::vector<int> boundary_vertices;
   for (int i = 0; i < mesh->NVertices(); i++) {
     R3MeshVertex *vertex = mesh->Vertex(i);
     if (!mesh->IsVertexOnBoundary(vertex)) continue;
-    boundary_vertices.Insert(vertex);
+    boundary_vertices.push_back(i);
   }
 
   // Compute dijkstra distances to closest boundary vertex
-  RNScalar *distances = mesh->DijkstraDistances(boundary_vertices);
-  if (!distances) return 0;
+  RNScalar *distances = new RNScalar [ mesh->NVertices() ];
+  for (int i = 0; i < mesh->NVertices(); i++) distances[i] = FLT_MAX;
+  if (!boundary_vertices.empty()) {
+    R3MeshGeodesics geodesics(*mesh);
+    geodesics.ComputeDistances(boundary_vertices.size(), &boundary_vertices[0], distances);
+  }
 
   // Fill property
   R3MeshProperty *property = new R3MeshProperty(mesh, "BoundaryDijkstraDistance");
@@ -1057,6 +1107,47 @@ ComputeBoundaryProperties(R3Mesh *mesh)
 // Dijkstra distance properties
 ////////////////////////////////////////////////////////////////////////
 
+struct DijkstraDistanceData {
+  int nvertices;
+  RNScalar *statistics[6];
+  std::vector<RNScalar> *scratch;
+};
+
+
+
+static void
+ComputeDijkstraDistanceStatistics(int source_index, int, const int *,
+  const float *distances, int thread_index, void *data)
+{
+  // Copy distances into scratch buffer for this thread
+  DijkstraDistanceData *dijkstra_data = (DijkstraDistanceData *) data;
+  int nvalues = dijkstra_data->nvertices;
+  std::vector<RNScalar>& values = dijkstra_data->scratch[thread_index];
+  values.resize(nvalues);
+  for (int i = 0; i < nvalues; i++) values[i] = distances[i];
+
+  // Compute mean and standard deviation
+  RNScalar mean = Mean(&values[0], nvalues);
+  RNScalar stddev = StandardDeviation(&values[0], nvalues);
+  RNScalar maximum = Maximum(&values[0], nvalues);
+
+  // Sort once for median and percentiles
+  std::sort(values.begin(), values.end());
+  int ten = (int) (10 * nvalues / 100.0); if (ten >= nvalues) ten = nvalues-1;
+  int fifty = (int) (50 * nvalues / 100.0); if (fifty >= nvalues) fifty = nvalues-1;
+  int ninety = (int) (90 * nvalues / 100.0); if (ninety >= nvalues) ninety = nvalues-1;
+
+  // Store statistics for source vertex
+  dijkstra_data->statistics[0][source_index] = mean;
+  dijkstra_data->statistics[1][source_index] = stddev;
+  dijkstra_data->statistics[2][source_index] = values[fifty];
+  dijkstra_data->statistics[3][source_index] = values[ten];
+  dijkstra_data->statistics[4][source_index] = values[ninety];
+  dijkstra_data->statistics[5][source_index] = maximum;
+}
+
+
+
 static R3MeshPropertySet *
 ComputeDijkstraDistanceProperties(R3Mesh *mesh)
 {
@@ -1075,26 +1166,32 @@ ComputeDijkstraDistanceProperties(R3Mesh *mesh)
     return NULL;
   }
 
-  // Allocate/insert properties
-  R3MeshProperty *mean_property = new R3MeshProperty(mesh, "DijkstraDistanceMean");
-  R3MeshProperty *stddev_property = new R3MeshProperty(mesh, "DijkstraDistanceStddev");
-  R3MeshProperty *median_property = new R3MeshProperty(mesh, "DijkstraDistanceMedian");
-  R3MeshProperty *ten_property = new R3MeshProperty(mesh, "DijkstraDistanceTen");
-  R3MeshProperty *ninety_property = new R3MeshProperty(mesh, "DijkstraDistanceNinety");
-  R3MeshProperty *maximum_property = new R3MeshProperty(mesh, "DijkstraDistanceMaximum");
- 
-  // Compute properties
-  for (int i = 0; i < mesh->NVertices(); i++) {
-    R3MeshVertex *vertex = mesh->Vertex(i);
-    RNLength *distances = mesh->DijkstraDistances(vertex);
-    mean_property->SetVertexValue(i, Mean(distances, mesh->NVertices()));
-    stddev_property->SetVertexValue(i, StandardDeviation(distances, mesh->NVertices()));
-    median_property->SetVertexValue(i, Median(distances, mesh->NVertices()));
-    ten_property->SetVertexValue(i, Percentile(distances, mesh->NVertices(), 10));
-    ninety_property->SetVertexValue(i, Percentile(distances, mesh->NVertices(), 90));
-    maximum_property->SetVertexValue(i, Maximum(distances, mesh->NVertices()));
-    delete [] distances;
-  }
+  // Allocate statistics
+  int nvertices = mesh->NVertices();
+  RNScalar *statistics = new RNScalar [ 6 * nvertices ];
+  std::vector<RNScalar> *scratch = new std::vector<RNScalar> [ RNNThreads() ];
+  DijkstraDistanceData dijkstra_data;
+  dijkstra_data.nvertices = nvertices;
+  for (int i = 0; i < 6; i++) dijkstra_data.statistics[i] = &statistics[i * nvertices];
+  dijkstra_data.scratch = scratch;
+
+  // Compute statistics of distances from every vertex (in parallel)
+  std::vector<int> sources(nvertices);
+  for (int i = 0; i < nvertices; i++) sources[i] = i;
+  R3MeshGeodesics geodesics(*mesh);
+  geodesics.ComputeDistances(nvertices, &sources[0], ComputeDijkstraDistanceStatistics, &dijkstra_data);
+
+  // Create properties
+  R3MeshProperty *mean_property = new R3MeshProperty(mesh, "DijkstraDistanceMean", dijkstra_data.statistics[0]);
+  R3MeshProperty *stddev_property = new R3MeshProperty(mesh, "DijkstraDistanceStddev", dijkstra_data.statistics[1]);
+  R3MeshProperty *median_property = new R3MeshProperty(mesh, "DijkstraDistanceMedian", dijkstra_data.statistics[2]);
+  R3MeshProperty *ten_property = new R3MeshProperty(mesh, "DijkstraDistanceTen", dijkstra_data.statistics[3]);
+  R3MeshProperty *ninety_property = new R3MeshProperty(mesh, "DijkstraDistanceNinety", dijkstra_data.statistics[4]);
+  R3MeshProperty *maximum_property = new R3MeshProperty(mesh, "DijkstraDistanceMaximum", dijkstra_data.statistics[5]);
+
+  // Delete statistics
+  delete [] statistics;
+  delete [] scratch;
 
   // Insert properties
   InsertProperty(properties, mean_property);
@@ -1117,6 +1214,59 @@ ComputeDijkstraDistanceProperties(R3Mesh *mesh)
 
 
 
+struct DijkstraHistogramData {
+  int nvertices;
+  int nbins;
+  RNScalar normalization;
+  int nsources;
+  const RNScalar *votes;
+  float *distances;
+  RNScalar *histogram;
+};
+
+
+
+static void
+CopyDijkstraHistogramDistances(int source_index, int, const int *,
+  const float *distances, int, void *data)
+{
+  // Copy distances from source into batch buffer
+  DijkstraHistogramData *histogram_data = (DijkstraHistogramData *) data;
+  int nvertices = histogram_data->nvertices;
+  float *batch_distances = &histogram_data->distances[source_index * nvertices];
+  for (int i = 0; i < nvertices; i++) batch_distances[i] = distances[i];
+}
+
+
+
+static void
+AddDijkstraHistogramVotes(int block_index, int, void *data)
+{
+  // Add votes from batch of sources to histograms of block of vertices
+  DijkstraHistogramData *histogram_data = (DijkstraHistogramData *) data;
+  int nvertices = histogram_data->nvertices;
+  int nbins = histogram_data->nbins;
+  int start = block_index * 4096;
+  int end = start + 4096;
+  if (end > nvertices) end = nvertices;
+  for (int i = 0; i < histogram_data->nsources; i++) {
+    RNScalar vote = histogram_data->votes[i];
+    const float *distances = &histogram_data->distances[i * nvertices];
+    for (int j = start; j < end; j++) {
+      RNScalar bin = histogram_data->normalization * distances[j];
+      int bin1 = (int) bin;
+      int bin2 = bin1 + 1;
+      RNScalar t = bin - bin1;
+      if (bin1 >= nbins) bin1 = nbins-1;
+      if (bin2 >= nbins) bin2 = nbins-1;
+      histogram_data->histogram[bin1 * nvertices + j] += (1-t) * vote;
+      histogram_data->histogram[bin2 * nvertices + j] += t * vote;
+    }
+  }
+}
+
+
+
 static R3MeshPropertySet *
 ComputeDijkstraHistogramProperties(R3Mesh *mesh)
 {
@@ -1142,14 +1292,6 @@ ComputeDijkstraHistogramProperties(R3Mesh *mesh)
     return NULL;
   }
 
-  // Allocate/insert properties
-  for (int i = 0; i < nbins; i++) {
-    char name[1024];
-    sprintf(name, "DijkstraHistogramBin%d", i);
-    R3MeshProperty *property = new R3MeshProperty(mesh, name);
-    properties->Insert(property);
-  }
- 
   // Create a sampled set of vertices
   RNScalar *weights = new RNScalar [ mesh->NVertices() ];
   RNArray<R3MeshVertex *> *samples = CreateVertexSampling(mesh, nsamples, weights);
@@ -1162,31 +1304,46 @@ ComputeDijkstraHistogramProperties(R3Mesh *mesh)
   RNScalar area = mesh->Area();
   RNScalar normalization = (area > 0) ? nbins / (1.5 * sqrt(area)) : 1;
 
-  // Compute histogram of distances
+  // Allocate histogram data
+  int nvertices = mesh->NVertices();
+  int batch_size = 4 * RNNThreads();
+  std::vector<int> sources(samples->NEntries());
+  for (int i = 0; i < samples->NEntries(); i++) sources[i] = mesh->VertexID(samples->Kth(i));
+  DijkstraHistogramData histogram_data;
+  histogram_data.nvertices = nvertices;
+  histogram_data.nbins = nbins;
+  histogram_data.normalization = normalization;
+  histogram_data.distances = new float [ batch_size * nvertices ];
+  histogram_data.histogram = new RNScalar [ nbins * nvertices ];
+  for (int i = 0; i < nbins * nvertices; i++) histogram_data.histogram[i] = 0;
+
+  // Compute histogram of distances (a batch of sources at a time)
+  R3MeshGeodesics geodesics(*mesh);
   RNScalar total_vote = 0;
-  for (int i = 0; i < samples->NEntries(); i++) {
-    R3MeshVertex *vertex = samples->Kth(i);
-    RNScalar vote = weights[i];
+  for (int i = 0; i < (int) sources.size(); i += batch_size) {
+    histogram_data.nsources = sources.size() - i;
+    if (histogram_data.nsources > batch_size) histogram_data.nsources = batch_size;
+    histogram_data.votes = &weights[i];
 
-    // Compute distances to other vertices
-    RNLength *distances = mesh->DijkstraDistances(vertex);
+    // Compute distances from batch of sources to all vertices
+    geodesics.ComputeDistances(histogram_data.nsources, &sources[i], CopyDijkstraHistogramDistances, &histogram_data);
 
     // Add values to histogram
-    for (int j = 0; j < mesh->NVertices(); j++) {
-      RNScalar bin = normalization * distances[j];
-      int bin1 = (int) bin;
-      int bin2 = bin1 + 1;
-      RNScalar t = bin - bin1;
-      if (bin1 >= nbins) bin1 = nbins-1;
-      if (bin2 >= nbins) bin2 = nbins-1;
-      properties->Property(bin1)->AddVertexValue(j, (1-t) * vote);
-      properties->Property(bin2)->AddVertexValue(j, t * vote);
-    }
+    RNParallelFor((nvertices + 4095) / 4096, AddDijkstraHistogramVotes, &histogram_data);
+  }
 
-    // Delete distances
-    delete [] distances;
+  // Create properties
+  for (int i = 0; i < nbins; i++) {
+    char name[1024];
+    sprintf(name, "DijkstraHistogramBin%d", i);
+    R3MeshProperty *property = new R3MeshProperty(mesh, name, &histogram_data.histogram[i * nvertices]);
+    properties->Insert(property);
   }
 
+  // Delete histogram data
+  delete [] histogram_data.distances;
+  delete [] histogram_data.histogram;
+
   // Normalize distribution by total_vote
   if (total_vote > 0) {
     for (int i = 1; i < nbins; i++) {
@@ -1226,6 +1383,83 @@ ComputeDijkstraHistogramProperties(R3Mesh *mesh)
 // Ray tracing properties
 ////////////////////////////////////////////////////////////////////////
 
+struct RayTracingData {
+  R3Mesh *mesh;
+  R3TriangleBVH *bvh;
+  RNScalar *statistics[4];
+};
+
+
+
+static RNScalar
+RandomJitter(unsigned int *state)
+{
+  // Return pseudo-random number in [0,1) from xorshift generator
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state / 4294967296.0;
+}
+
+
+
+static void
+TraceVertexRays(int vertex_index, int, void *data)
+{
+  // Get vertex info
+  RayTracingData *raytracing_data = (RayTracingData *) data;
+  R3Mesh *mesh = raytracing_data->mesh;
+  R3MeshVertex *vertex = mesh->Vertex(vertex_index);
+  const R3Point& vertex_position = mesh->VertexPosition(vertex);
+  const R3Vector& vertex_normal = mesh->VertexNormal(vertex);
+  R3Vector phi_rotation_axis = vertex_normal % R3xyz_triad.Axis(vertex_normal.MinDimension());
+  R3Vector theta_rotation_axis = vertex_normal;
+
+  // Seed random jitter with vertex index (so that results do not depend on thread schedule)
+  unsigned int random_state = 2654435761U * (vertex_index + 1);
+  if (random_state == 0) random_state = 1;
+
+  // Compute intersections of mesh with random rays from vertex 
+  const int nphis = 8;
+  const int nthetas = 8;
+  const int num_rays = nphis * nthetas;
+  double interior_distances[num_rays];
+  int num_intersections = 0;
+  int num_interior_distances = 0;
+  for (int j = 0; j < nthetas; j++) {
+    RNAngle theta = (j+RandomJitter(&random_state)) * RN_TWO_PI / nthetas;
+    for (int k = 0; k < nphis; k++) {
+      RNAngle phi = (k+RandomJitter(&random_state)) * RN_PI / nphis;
+
+      // Compute ray
+      R3Vector ray_direction = vertex_normal;
+      ray_direction.Rotate(phi_rotation_axis, phi);
+      ray_direction.Rotate(theta_rotation_axis, theta);
+      R3Point ray_source_position = vertex_position + 1000 * RN_EPSILON * ray_direction;
+      R3Ray ray(ray_source_position, ray_direction);
+
+      // Compute ray intersection
+      R3Vector hit_normal;
+      RNScalar hit_t;
+      if (raytracing_data->bvh->FindIntersection(ray, NULL, NULL, NULL, &hit_normal, &hit_t)) {
+        num_intersections++;
+        if (ray_direction.Dot(hit_normal) > 0) {
+          interior_distances[num_interior_distances] = hit_t;
+          num_interior_distances++;
+        }
+      }
+    }
+  }
+
+  // Compute properties
+  raytracing_data->statistics[0][vertex_index] = Median(interior_distances, num_interior_distances);
+  raytracing_data->statistics[1][vertex_index] = Percentile(interior_distances, num_interior_distances, 10);
+  raytracing_data->statistics[2][vertex_index] = Percentile(interior_distances, num_interior_distances, 90);
+  raytracing_data->statistics[3][vertex_index] = (RNScalar) num_intersections / (RNScalar) num_rays;
+}
+
+
+
 static R3MeshPropertySet *
 ComputeRayTracingProperties(R3Mesh *mesh)
 {
@@ -1244,59 +1478,26 @@ ComputeRayTracingProperties(R3Mesh *mesh)
     return NULL;
   }
 
-  // Allocate/insert properties
-  R3MeshProperty *median_property = new R3MeshProperty(mesh, "RayLengthMedian");
-  R3MeshProperty *ten_property = new R3MeshProperty(mesh, "RayLengthTen");
-  R3MeshProperty *ninety_property = new R3MeshProperty(mesh, "RayLengthNinety");
-  R3MeshProperty *coverage_property = new R3MeshProperty(mesh, "RayCoverage");
-    
-  // Compute properties based on intersections of random rays
-  const int nphis = 8;
-  const int nthetas = 8;
-  const int num_rays = nphis * nthetas;
-  double interior_distances[num_rays];
-  for (int i = 0; i < mesh->NVertices(); i++) {
-    // Get vertex info
-    R3MeshVertex *vertex = mesh->Vertex(i);
-    const R3Point& vertex_position = mesh->VertexPosition(vertex);
-    const R3Vector& vertex_normal = mesh->VertexNormal(vertex);
-    R3Vector phi_rotation_axis = vertex_normal % R3xyz_triad.Axis(vertex_normal.MinDimension());
-    R3Vector theta_rotation_axis = vertex_normal;
-
-    // Compute intersections of mesh with random rays from vertex 
-    int num_intersections = 0;
-    int num_interior_distances = 0;
-    for (int j = 0; j < nthetas; j++) {
-      RNAngle theta = (j+RNRandomScalar()) * RN_TWO_PI / nthetas;
-      for (int k = 0; k < nphis; k++) {
-        RNAngle phi = (k+RNRandomScalar()) * RN_PI / nphis;
-
-        // Compute ray
-        R3Vector ray_direction = vertex_normal;
-        ray_direction.Rotate(phi_rotation_axis, phi);
-        ray_direction.Rotate(theta_rotation_axis, theta);
-        R3Point ray_source_position = vertex_position + 1000 * RN_EPSILON * ray_direction;
-        R3Ray ray(ray_source_position, ray_direction);
-
-        // Compute ray intersection
-        R3MeshIntersection intersection;
-        if (mesh->Intersection(ray, &intersection)) {
-          num_intersections++;
-          const R3Vector& face_normal = mesh->FaceNormal(intersection.face);
-          if (ray_direction.Dot(face_normal) > 0) {
-            interior_distances[num_interior_distances] = intersection.t;
-            num_interior_distances++;
-          }
-        }
-      }
-    }
+  // Build bounding volume hierarchy for ray intersections
+  R3TriangleBVH bvh;
+  bvh.InsertMesh(*mesh);
+  bvh.Build();
 
-    // Compute properties
-    median_property->SetVertexValue(i, Median(interior_distances, num_interior_distances));
-    ten_property->SetVertexValue(i, Percentile(interior_distances, num_interior_distances, 10));
-    ninety_property->SetVertexValue(i, Percentile(interior_distances, num_interior_distances, 90));
-    coverage_property->SetVertexValue(i, (RNScalar) num_intersections / (RNScalar) num_rays);
-  }
+  // Compute properties based on intersections of random rays (in parallel)
+  int nvertices = mesh->NVertices();
+  RNScalar *statistics = new RNScalar [ 4 * nvertices ];
+  RayTracingData raytracing_data;
+  raytracing_data.mesh = mesh;
+  raytracing_data.bvh = &bvh;
+  for (int i = 0; i < 4; i++) raytracing_data.statistics[i] = &statistics[i * nvertices];
+  RNParallelFor(nvertices, TraceVertexRays, &raytracing_data, 64);
+
+  // Create properties
+  R3MeshProperty *median_property = new R3MeshProperty(mesh, "RayLengthMedian", raytracing_data.statistics[0]);
+  R3MeshProperty *ten_property = new R3MeshProperty(mesh, "RayLengthTen", raytracing_data.statistics[1]);
+  R3MeshProperty *ninety_property = new R3MeshProperty(mesh, "RayLengthNinety", raytracing_data.statistics[2]);
+  R3MeshProperty *coverage_property = new R3MeshProperty(mesh, "RayCoverage", raytracing_data.statistics[3]);
+  delete [] statistics;
 
   // Blur the properties to reduce effects of undersampling
   RNScalar sigma = Sigma(mesh);
@@ -1841,6 +2042,64 @@ ComputeSolidTextureProperties(R3Mesh *mesh)
 // Property set composition 
 ////////////////////////////////////////////////////////////////////////
 
+struct PropertyTask {
+  PropertyTask(void) : name(NULL), compute(NULL), concurrent(FALSE), properties(NULL), time(0) {};
+  PropertyTask(const char *name, R3MeshPropertySet *(*compute)(R3Mesh *mesh), RNBoolean concurrent)
+    : name(name), compute(compute), concurrent(concurrent), properties(NULL), time(0) {};
+  const char *name;
+  R3MeshPropertySet *(*compute)(R3Mesh *mesh);
+  RNBoolean concurrent;
+  R3MeshPropertySet *properties;
+  RNScalar time;
+};
+
+struct PropertyTaskData {
+  R3Mesh *mesh;
+  PropertyTask *tasks;
+  const int *task_indices;
+};
+
+
+
+static void
+PrepareMesh(R3Mesh *mesh)
+{
+  // Update geometry cached lazily by the mesh, so that tasks can read it concurrently
+  for (int i = 0; i < mesh->NFaces(); i++) {
+    R3MeshFace *face = mesh->Face(i);
+    mesh->FaceArea(face);
+    mesh->FaceNormal(face);
+    mesh->FaceBBox(face);
+  }
+  for (int i = 0; i < mesh->NEdges(); i++) {
+    R3MeshEdge *edge = mesh->Edge(i);
+    mesh->EdgeLength(edge);
+  }
+  for (int i = 0; i < mesh->NVertices(); i++) {
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    mesh->VertexNormal(vertex);
+  }
+
+  // Initialize cached sigma
+  Sigma(mesh);
+}
+
+
+
+static void
+RunPropertyTask(int index, int, void *data)
+{
+  // Compute one property set
+  PropertyTaskData *task_data = (PropertyTaskData *) data;
+  PropertyTask *task = &task_data->tasks[task_data->task_indices[index]];
+  RNTime start_time;
+  start_time.Read();
+  task->properties = (*task->compute)(task_data->mesh);
+  task->time = start_time.Elapsed();
+}
+
+
+
 static R3MeshPropertySet *
 ComputeProperties(R3Mesh *mesh)
 {
@@ -1851,76 +2110,62 @@ ComputeProperties(R3Mesh *mesh)
     return NULL;
   }
 
-  // Compute basic properties
-  if (compute_basic_properties) {
-    R3MeshPropertySet *basic_properties = ComputeBasicProperties(mesh);
-    if (!basic_properties) return NULL;
-    properties->Insert(basic_properties);
-    delete basic_properties;
-  }
-
-  // Compute coordinate properties
-  if (compute_coordinate_properties) {
-    R3MeshPropertySet *coordinate_properties = ComputeCoordinateProperties(mesh);
-    if (!coordinate_properties) return NULL;
-    properties->Insert(coordinate_properties);
-    delete coordinate_properties;
-  }
-
-  // Compute curvature properties
-  if (compute_curvature_properties) {
-    R3MeshPropertySet *curvature_properties = ComputeCurvatureProperties(mesh);
-    if (!curvature_properties) return NULL;
-    properties->Insert(curvature_properties);
-    delete curvature_properties;
-  }
-
-  // Compute laplacian properties
-  if (compute_laplacian_properties) {
-    R3MeshPropertySet *laplacian_properties = ComputeLaplacianProperties(mesh);
-    if (!laplacian_properties) return NULL;
-    properties->Insert(laplacian_properties);
-    delete laplacian_properties;
-  }
-
-  // Compute volume properties
-  if (compute_volume_properties) {
-    R3MeshPropertySet *volume_properties = ComputeVolumeProperties(mesh);
-    if (!volume_properties) return NULL;
-    properties->Insert(volume_properties);
-    delete volume_properties;
-  }
-
-  // Compute boundary properties
-  if (compute_boundary_properties) {
-    R3MeshPropertySet *boundary_properties = ComputeBoundaryProperties(mesh);
-    if (!boundary_properties) return NULL;
-    properties->Insert(boundary_properties);
-    delete boundary_properties;
-  }
+  // Make list of property computations that depend only on the mesh
+  // (concurrent ones have no parallel loops inside, the others have parallel kernels)
+  PropertyTask tasks[16];
+  int ntasks = 0;
+  if (compute_basic_properties) tasks[ntasks++] = PropertyTask("basic", ComputeBasicProperties, TRUE);
+  if (compute_coordinate_properties) tasks[ntasks++] = PropertyTask("coordinate", ComputeCoordinateProperties, TRUE);
+  if (compute_curvature_properties) tasks[ntasks++] = PropertyTask("curvature", ComputeCurvatureProperties, FALSE);
+  if (compute_laplacian_properties) tasks[ntasks++] = PropertyTask("laplacian", ComputeLaplacianProperties, TRUE);
+  if (compute_volume_properties) tasks[ntasks++] = PropertyTask("volume", ComputeVolumeProperties, FALSE);
+  if (compute_boundary_properties) tasks[ntasks++] = PropertyTask("boundary", ComputeBoundaryProperties, FALSE);
+  if (compute_dijkstra_distance_properties) tasks[ntasks++] = PropertyTask("dijkstra distance", ComputeDijkstraDistanceProperties, FALSE);
+  if (compute_dijkstra_histogram_properties) tasks[ntasks++] = PropertyTask("dijkstra histogram", ComputeDijkstraHistogramProperties, FALSE);
+  if (compute_raytrace_properties) tasks[ntasks++] = PropertyTask("ray tracing", ComputeRayTracingProperties, FALSE);
+
+  // Run property computations
+  if (ntasks > 0) {
+    // Gather concurrent and sequential computations
+    int concurrent_indices[16], sequential_indices[16];
+    int nconcurrent = 0, nsequential = 0;
+    for (int i = 0; i < ntasks; i++) {
+      if (tasks[i].concurrent) concurrent_indices[nconcurrent++] = i;
+      else sequential_indices[nsequential++] = i;
+    }
 
-  // Compute dijkstra distance properties
-  if (compute_dijkstra_distance_properties) {
-    R3MeshPropertySet *dijkstra_distance_properties = ComputeDijkstraDistanceProperties(mesh);
-    if (!dijkstra_distance_properties) return NULL;
-    properties->Insert(dijkstra_distance_properties);
-    delete dijkstra_distance_properties;
-  }
+    // Update geometry cached lazily by the mesh
+    PrepareMesh(mesh);
+    PropertyTaskData task_data;
+    task_data.mesh = mesh;
+    task_data.tasks = tasks;
+
+    // Run computations without parallel loops concurrently (printing statistics afterwards)
+    int saved_print_verbose = print_verbose;
+    print_verbose = 0;
+    task_data.task_indices = concurrent_indices;
+    RNParallelFor(nconcurrent, RunPropertyTask, &task_data);
+    print_verbose = saved_print_verbose;
+    if (print_verbose) {
+      for (int i = 0; i < nconcurrent; i++) {
+        PropertyTask *task = &tasks[concurrent_indices[i]];
+        printf("Computed %s properties ...\n", task->name);
+        printf("  Time = %.2f seconds\n", task->time);
+        if (task->properties) printf("  # Properties = %d\n", task->properties->NProperties());
+        fflush(stdout);
+      }
+    }
 
-  // Compute dijkstra histogram properties
-  if (compute_dijkstra_histogram_properties) {
-    R3MeshPropertySet *dijkstra_histogram_properties = ComputeDijkstraHistogramProperties(mesh);
-    if (!dijkstra_histogram_properties) return NULL;
-    properties->Insert(dijkstra_histogram_properties);
-    delete dijkstra_histogram_properties;
+    // Run computations with parallel kernels one at a time (so that each kernel gets all threads)
+    task_data.task_indices = sequential_indices;
+    for (int i = 0; i < nsequential; i++) RunPropertyTask(i, 0, &task_data);
   }
 
-  // Compute ray tracing properties
-  if (compute_raytrace_properties) {
-    R3MeshPropertySet *raytrace_properties = ComputeRayTracingProperties(mesh);
-    if (!raytrace_properties) return NULL;
-    properties->Insert(raytrace_properties);
-    delete raytrace_properties;
+  // Insert computed properties (in the order of the tasks)
+  for (int i = 0; i < ntasks; i++) {
+    if (!tasks[i].properties) return NULL;
+    properties->Insert(tasks[i].properties);
+    delete tasks[i].properties;
   }
 
   // Read mturk segmentation properties
@@ -1980,6 +2225,7 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-solidtexture")) { compute_solidtexture_properties = 1; }
       else if (!strcmp(*argv, "-output_mesh")) { argv++; argc--; output_mesh_name = *argv; }
       else if (!strcmp(*argv, "-map")) { argv++; argc--; input_map_name = *argv; }
+      else if (!strcmp(*argv, "-append")) { append_properties = 1; }
       else if (!strcmp(*argv, "-mturk_semantic_segmentation")) {
         argv++; argc--; input_mturk_segmentation_name = *argv; 
         argv++; argc--; input_mturk_annotation_name = *argv;         
@@ -9,6 +9,8 @@
 namespace gaps {}
 using namespace gaps;
 #include "R3Shapes/R3Shapes.h"
+#include <unordered_map>
+#include <queue>
 
 
 
@@ -32,6 +34,7 @@ enum {
   PROPERTY_EXTREMA,
   CENTER_OF_MASS,
   VERTEX_CLOSEST_TO_CENTER_OF_MASS,
+  FURTHEST_SURFACE_POINTS,
   NUM_SELECTION_METHODS
 };
 
@@ -57,6 +60,8 @@ static double near_surface_bias_exponent = 2;
 static double curvature_exponent = 0;
 static RNScalar curvature_max = 100;
 static RNBoolean binary_sdf = FALSE;
+static RNBoolean indexed_mesh = FALSE;
+static int geodesic_method = R3_MESH_DIJKSTRA_DISTANCES;
 static RNBoolean print_verbose = FALSE;
 static RNBoolean print_debug = FALSE;
 
@@ -119,6 +124,38 @@ ReadMesh(const char *filename)
 
 
 
+static R3IndexedMesh *
+ReadIndexedMesh(const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Allocate mesh
+  R3IndexedMesh *mesh = new R3IndexedMesh();
+  assert(mesh);
+
+  // Read mesh from file (without building edge topology)
+  if (!mesh->ReadFile(filename)) {
+    delete mesh;
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Read indexed mesh ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Faces = %d\n", mesh->NFaces());
+    printf("  # Vertices = %d\n", mesh->NVertices());
+    fflush(stdout);
+  }
+
+  // Return success
+  return mesh;
+}
+
+
+
 static R3MeshProperty *
 ReadProperty(R3Mesh *mesh, const char *filename)
 {
@@ -401,6 +438,226 @@ ComputeFaceSamplingWeights(R3Mesh *mesh, R3MeshProperty *property,
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Parallel sampling utility functions
+////////////////////////////////////////////////////////////////////////
+
+struct RandomStream {
+  // Independent random number stream for each (seed, stream) pair
+  // (splitmix64 seeding followed by xorshift64*)
+  RandomStream(unsigned long long seed, unsigned long long stream) {
+    unsigned long long z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    state = z ^ (z >> 31);
+    if (state == 0) state = 0x2545F4914F6CDD1DULL;
+  };
+  RNScalar Next(void) {
+    // Return random number in [0, 1)
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (RNScalar) ((state * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+  };
+  unsigned long long state;
+};
+
+
+
+struct PointSpacingGrid {
+  // Hashed grid of points with cells as large as the spacing,
+  // so that nearby points are found in the 27 surrounding cells
+  PointSpacingGrid(RNLength spacing)
+    : spacing(spacing) {};
+  long long CellKey(int ix, int iy, int iz) const {
+    return (((long long) (ix & 0x1FFFFF)) << 42) |
+      (((long long) (iy & 0x1FFFFF)) << 21) | ((long long) (iz & 0x1FFFFF));
+  };
+  void CellIndices(const R3Point& position, int& ix, int& iy, int& iz) const {
+    ix = (int) floor(position.X() / spacing);
+    iy = (int) floor(position.Y() / spacing);
+    iz = (int) floor(position.Z() / spacing);
+  };
+  RNBoolean IsNear(const R3Point& position) const {
+    // Check whether any point is within spacing of position
+    int ix, iy, iz;
+    CellIndices(position, ix, iy, iz);
+    RNScalar spacing_squared = spacing * spacing;
+    for (int dz = -1; dz <= 1; dz++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          std::unordered_map<long long, std::vector<R3Point> >::const_iterator it;
+          it = cells.find(CellKey(ix+dx, iy+dy, iz+dz));
+          if (it == cells.end()) continue;
+          const std::vector<R3Point>& cell_points = it->second;
+          for (size_t k = 0; k < cell_points.size(); k++) {
+            if (R3SquaredDistance(position, cell_points[k]) <= spacing_squared) return TRUE;
+          }
+        }
+      }
+    }
+    return FALSE;
+  };
+  void Insert(const R3Point& position) {
+    // Insert point into its cell
+    int ix, iy, iz;
+    CellIndices(position, ix, iy, iz);
+    cells[CellKey(ix, iy, iz)].push_back(position);
+  };
+  RNLength spacing;
+  std::unordered_map<long long, std::vector<R3Point> > cells;
+};
+
+
+
+static void
+RemoveNearbyPoints(RNArray<Point *> *points, RNLength min_spacing)
+{
+  // Check min spacing
+  if (min_spacing <= 0) return;
+
+  // Keep points in order unless within min_spacing of a kept point (Poisson-disk rejection)
+  int npoints = 0;
+  PointSpacingGrid spacing_grid(min_spacing);
+  for (int i = 0; i < points->NEntries(); i++) {
+    Point *point = points->Kth(i);
+    if (spacing_grid.IsNear(point->position)) { delete point; continue; }
+    spacing_grid.Insert(point->position);
+    (*points)[npoints++] = point;
+  }
+
+  // Remove rejected points from array
+  points->Truncate(npoints);
+}
+
+
+
+// Number of faces sampled with the same random number stream
+static const int surface_sampling_chunk_size = 1024;
+
+struct SurfaceSamplingData {
+  R3Mesh *mesh;
+  R3IndexedMesh *indexed_mesh;
+  int npoints;
+  RNScalar total_weight;
+  unsigned long long seed;
+  std::vector<std::vector<Point *> > chunk_points;
+};
+
+
+
+static void
+SampleSurfaceChunk(int chunk_index, int thread_index, void *data)
+{
+  // Get convenient variables
+  SurfaceSamplingData *sampling_data = (SurfaceSamplingData *) data;
+  R3Mesh *mesh = sampling_data->mesh;
+  R3IndexedMesh *indexed_mesh = sampling_data->indexed_mesh;
+  std::vector<Point *>& chunk_points = sampling_data->chunk_points[chunk_index];
+  int nfaces = (mesh) ? mesh->NFaces() : indexed_mesh->NFaces();
+  int start = chunk_index * surface_sampling_chunk_size;
+  int end = start + surface_sampling_chunk_size;
+  if (end > nfaces) end = nfaces;
+
+  // Random numbers depend only on seed and chunk, not on thread
+  RandomStream random(sampling_data->seed, chunk_index);
+
+  // Generate points on faces
+  for (int i = start; i < end; i++) {
+    // Get vertex positions, normals, and sampling weight
+    R3Point p0, p1, p2;
+    R3Vector n0, n1, n2;
+    RNScalar weight;
+    if (mesh) {
+      R3MeshFace *face = mesh->Face(i);
+      R3MeshVertex *v0 = mesh->VertexOnFace(face, 0);
+      R3MeshVertex *v1 = mesh->VertexOnFace(face, 1);
+      R3MeshVertex *v2 = mesh->VertexOnFace(face, 2);
+      p0 = mesh->VertexPosition(v0);
+      p1 = mesh->VertexPosition(v1);
+      p2 = mesh->VertexPosition(v2);
+      n0 = mesh->VertexNormal(v0);
+      n1 = mesh->VertexNormal(v1);
+      n2 = mesh->VertexNormal(v2);
+      weight = mesh->FaceValue(face);
+    }
+    else {
+      int i0 = indexed_mesh->VertexOnFace(i, 0);
+      int i1 = indexed_mesh->VertexOnFace(i, 1);
+      int i2 = indexed_mesh->VertexOnFace(i, 2);
+      p0 = indexed_mesh->VertexPosition(i0);
+      p1 = indexed_mesh->VertexPosition(i1);
+      p2 = indexed_mesh->VertexPosition(i2);
+      n0 = indexed_mesh->VertexNormal(i0);
+      n1 = indexed_mesh->VertexNormal(i1);
+      n2 = indexed_mesh->VertexNormal(i2);
+      weight = indexed_mesh->FaceArea(i);
+    }
+
+    // Determine number of points for face
+    RNScalar ideal_face_npoints = sampling_data->npoints * weight / sampling_data->total_weight;
+    int face_npoints = (int) ideal_face_npoints;
+    RNScalar remainder = ideal_face_npoints - face_npoints;
+    if (remainder > random.Next()) face_npoints++;
+
+    // Generate random points in face
+    for (int j = 0; j < face_npoints; j++) {
+      RNScalar r1 = sqrt(random.Next());
+      RNScalar r2 = random.Next();
+      RNScalar t0 = (1.0 - r1);
+      RNScalar t1 = r1 * (1.0 - r2);
+      RNScalar t2 = r1 * r2;
+      R3Point position = t0*p0 + t1*p1 + t2*p2;
+      R3Vector normal = t0*n0 + t1*n1 + t2*n2; normal.Normalize();
+      chunk_points.push_back(new Point(position, normal));
+    }
+  }
+}
+
+
+
+static void
+GenerateRandomSurfacePoints(R3Mesh *mesh, R3IndexedMesh *indexed_mesh,
+  RNScalar total_weight, int npoints, RNArray<Point *> *points)
+{
+  // Check total weight
+  if (total_weight <= 0) return;
+
+  // Compute vertex normals before reading them in parallel
+  if (mesh) {
+    for (int i = 0; i < mesh->NVertices(); i++) {
+      mesh->VertexNormal(mesh->Vertex(i));
+    }
+  }
+
+  // Initialize sampling data
+  int nfaces = (mesh) ? mesh->NFaces() : indexed_mesh->NFaces();
+  int nchunks = (nfaces + surface_sampling_chunk_size - 1) / surface_sampling_chunk_size;
+  SurfaceSamplingData sampling_data;
+  sampling_data.mesh = mesh;
+  sampling_data.indexed_mesh = indexed_mesh;
+  sampling_data.npoints = npoints;
+  sampling_data.total_weight = total_weight;
+  sampling_data.chunk_points.resize(nchunks);
+
+  // Seed chunk random number streams
+  RNSeedRandomScalar();
+  sampling_data.seed = (unsigned long long) (RNRandomScalar() * 9007199254740992.0);
+
+  // Generate points in chunks of faces
+  RNParallelFor(nchunks, SampleSurfaceChunk, &sampling_data);
+
+  // Concatenate points in face order
+  for (int i = 0; i < nchunks; i++) {
+    const std::vector<Point *>& chunk_points = sampling_data.chunk_points[i];
+    for (size_t j = 0; j < chunk_points.size(); j++) {
+      points->Insert(chunk_points[j]);
+    }
+  }
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Signed distance utility functions
 ////////////////////////////////////////////////////////////////////////
@@ -503,7 +760,7 @@ CreateSignedDistanceGrid(R3Mesh *mesh, const R3Box& b)
 ////////////////////////////////////////////////////////////////////////
 
 static RNArray<Point *> *
-SelectRandomSurfacePoints(R3Mesh *mesh, R3MeshProperty *property, int npoints)
+SelectRandomSurfacePoints(R3Mesh *mesh, R3MeshProperty *property, int npoints, double min_spacing)
 {
   // Allocate array of points
   RNArray<Point *> *points = new RNArray<Point *>();
@@ -518,41 +775,37 @@ SelectRandomSurfacePoints(R3Mesh *mesh, R3MeshProperty *property, int npoints)
   if (total_value == 0) return points;
   
   // Generate points
-  RNSeedRandomScalar();
-  for (int i = 0; i < mesh->NFaces(); i++) {
-    R3MeshFace *face = mesh->Face(i);
+  GenerateRandomSurfacePoints(mesh, NULL, total_value, npoints, points);
 
-    // Get vertex positions
-    R3MeshVertex *v0 = mesh->VertexOnFace(face, 0);
-    R3MeshVertex *v1 = mesh->VertexOnFace(face, 1);
-    R3MeshVertex *v2 = mesh->VertexOnFace(face, 2);
-    const R3Point& p0 = mesh->VertexPosition(v0);
-    const R3Point& p1 = mesh->VertexPosition(v1);
-    const R3Point& p2 = mesh->VertexPosition(v2);
-    const R3Vector& n0 = mesh->VertexNormal(v0);
-    const R3Vector& n1 = mesh->VertexNormal(v1);
-    const R3Vector& n2 = mesh->VertexNormal(v2);
-
-    // Determine number of points for face 
-    RNScalar ideal_face_npoints = npoints * mesh->FaceValue(face) / total_value;
-    int face_npoints = (int) ideal_face_npoints;
-    RNScalar remainder = ideal_face_npoints - face_npoints;
-    if (remainder > RNRandomScalar()) face_npoints++;
+  // Remove points closer than min_spacing
+  RemoveNearbyPoints(points, min_spacing);
 
-    // Generate random points in face
-    for (int j = 0; j < face_npoints; j++) {
-      RNScalar r1 = sqrt(RNRandomScalar());
-      RNScalar r2 = RNRandomScalar();
-      RNScalar t0 = (1.0 - r1);
-      RNScalar t1 = r1 * (1.0 - r2);
-      RNScalar t2 = r1 * r2;
-      R3Point position = t0*p0 + t1*p1 + t2*p2;
-      R3Vector normal = t0*n0 + t1*n1 + t2*n2; normal.Normalize();
-      Point *point = new Point(position, normal);
-      points->Insert(point);
-    }
+  // Return points
+  return points;
+}
+
+
+
+static RNArray<Point *> *
+SelectRandomSurfacePoints(R3IndexedMesh *mesh, int npoints, double min_spacing)
+{
+  // Allocate array of points
+  RNArray<Point *> *points = new RNArray<Point *>();
+  if (!points) {
+    RNFail("Unable to allocate array of points\n");
+    return NULL;
   }
 
+  // Count total area of faces
+  RNArea total_area = mesh->Area();
+  if (total_area == 0) return points;
+
+  // Generate points
+  GenerateRandomSurfacePoints(NULL, mesh, total_area, npoints, points);
+
+  // Remove points closer than min_spacing
+  RemoveNearbyPoints(points, min_spacing);
+
   // Return points
   return points;
 }
@@ -585,7 +838,15 @@ SelectVertexPoints(R3Mesh *mesh, int npoints, double min_spacing)
     total_value += value;
   }
 
+  // Build geodesic distance engine
+  R3MeshGeodesics geodesics;
+  if (min_spacing > 0) {
+    geodesics.SetMethod(geodesic_method);
+    geodesics.Build(*mesh);
+  }
+
   // Select vertices weighted by value
+  std::vector<int> nearby_vertices;
   R3mesh_mark++;
   int max_iterations = 100 * npoints;
   for (int i = 0; (npoints > 0) && (i < max_iterations); i++) {
@@ -608,18 +869,15 @@ SelectVertexPoints(R3Mesh *mesh, int npoints, double min_spacing)
 
           // Mark nearby points
           if (min_spacing > 0) {
-            RNLength *distances = mesh->DijkstraDistances(vertex, min_spacing);
-            for (int k = 0; k < mesh->NVertices(); k++) {
-              R3MeshVertex *nearby_vertex = mesh->Vertex(k);
+            geodesics.FindNeighbors(mesh->VertexID(vertex), min_spacing, nearby_vertices);
+            for (unsigned int k = 0; k < nearby_vertices.size(); k++) {
+              R3MeshVertex *nearby_vertex = mesh->Vertex(nearby_vertices[k]);
               if (mesh->VertexMark(nearby_vertex) != R3mesh_mark) {
-                if (distances[k] <= min_spacing) {
-                  // Mark point within min_spacing
-                  mesh->SetVertexMark(nearby_vertex, R3mesh_mark);
-                  total_value -= vertex_value;
-                }
+                // Mark point within min_spacing
+                mesh->SetVertexMark(nearby_vertex, R3mesh_mark);
+                total_value -= vertex_value;
               }
             }
-            delete [] distances;
           }
 
           // Break
@@ -639,65 +897,6 @@ SelectVertexPoints(R3Mesh *mesh, int npoints, double min_spacing)
 // Furthest surface point sampling
 ////////////////////////////////////////////////////////////////////////
 
-// Type definitions
-
-struct VertexData {
-  R3MeshVertex *vertex;
-  double distance;
-  R3MeshVertex *closest_seed;
-  VertexData **heappointer;
-};
-
-
-
-static R3MeshVertex *
-FindFurthestVertex(R3Mesh *mesh, const RNArray<R3MeshVertex *>& seeds, VertexData *vertex_data)
-{
-  // Initialize vertex data
-  for (int i = 0; i < mesh->NVertices(); i++) {
-    VertexData *data = &vertex_data[i];
-    data->distance = FLT_MAX;
-    data->closest_seed = NULL;
-    data->heappointer = NULL;
-  }
-
-  // Initialize heap
-  VertexData tmp;
-  RNHeap<VertexData *> heap(&tmp, &(tmp.distance), &(tmp.heappointer));
-  for (int i = 0; i < seeds.NEntries(); i++) {
-    R3MeshVertex *vertex = seeds.Kth(i);
-    VertexData *data = &vertex_data[mesh->VertexID(vertex)];
-    data->closest_seed = vertex;
-    data->distance = 0;
-    heap.Push(data);
-  }
-
-  // Iteratively pop off heap until find furthest vertex
-  R3MeshVertex *vertex = NULL;
-  while (!heap.IsEmpty()) {
-    VertexData *data = heap.Pop();
-    vertex = data->vertex;
-    for (int j = 0; j < mesh->VertexValence(vertex); j++) {
-      R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, j);
-      R3MeshVertex *neighbor_vertex = mesh->VertexAcrossEdge(edge, vertex);
-      VertexData *neighbor_data = (VertexData *) mesh->VertexData(neighbor_vertex);
-      RNScalar old_distance = neighbor_data->distance;
-      RNScalar new_distance = mesh->EdgeLength(edge) + data->distance;
-      if (new_distance < old_distance) {
-        neighbor_data->distance = new_distance;
-        neighbor_data->closest_seed = data->closest_seed;
-        if (old_distance < FLT_MAX) heap.Update(neighbor_data);
-        else heap.Push(neighbor_data);
-      }
-    }
-  }
-
-  // Return furthest vertex
-  return vertex;
-}
-
-
-
 static RNArray<Point *> *
 SelectFurthestPoints(R3Mesh *mesh, const RNArray<R3MeshVertex *>& seeds, int npoints, double min_spacing)
 {
@@ -711,80 +910,27 @@ SelectFurthestPoints(R3Mesh *mesh, const RNArray<R3MeshVertex *>& seeds, int npo
     return NULL;
   }
 
-  // Allocate vertex data
-  VertexData *vertex_data = new VertexData [ mesh->NVertices() ];
-  if (!vertex_data) {
-    RNFail("Unable to allocate vertex data\n");
-    return NULL;
-  }
-
-  // Initialize vertex data
-  for (int i = 0; i < mesh->NVertices(); i++) {
-    R3MeshVertex *vertex = mesh->Vertex(i);
-    VertexData *data = &vertex_data[i];
-    mesh->SetVertexData(vertex, data);
-    data->vertex = vertex;
-    data->distance = FLT_MAX;
-    data->closest_seed = NULL;
-    data->heappointer = NULL;
-  }
-
-  // Copy seeds 
-  RNArray<R3MeshVertex *> vertices;
+  // Copy seeds
+  std::vector<int> samples;
   for (int i = 0; i < seeds.NEntries(); i++) {
     R3MeshVertex *vertex = seeds.Kth(i);
     Point *point = new Point(mesh, vertex);
     points->Insert(point);
-    vertices.Insert(vertex);
+    samples.push_back(mesh->VertexID(vertex));
   }
 
-  // Create random starting vertex in each connected component, if none provided
-  RNArray<R3MeshVertex *> tmp;
-  if (seeds.IsEmpty()) {
-    int *marks = new int [ mesh->NVertices() ];
-    for (int i = 0; i < mesh->NVertices(); i++) marks[i] = 0;
-    for (int i = 0; i < mesh->NVertices(); i++) {
-      R3MeshVertex *vertex = mesh->Vertex(i);
-
-      // Check if already marked
-      if (marks[i] != 0) continue;
-      marks[i] = 1;
-
-      // Check if completely disconnected
-      if (mesh->VertexValence(vertex) == 0) continue;
-
-      // Select vertex as temporary seed
-      vertices.Insert(vertex);
-      tmp.Insert(vertex);
+  // Iteratively select furthest vertex (each connected component 
+  // without a seed starts from a temporary seed)
+  R3MeshGeodesics geodesics(*mesh, geodesic_method);
+  geodesics.SelectFurthestVertices(npoints, samples, min_spacing);
 
-      // Mark connected component
-      RNArray<R3MeshVertex *> connected_component;
-      mesh->FindConnectedVertices(vertex, connected_component);
-      for (int j = 0; j < connected_component.NEntries(); j++) {
-        R3MeshVertex *connected_vertex = connected_component.Kth(j);
-        marks[mesh->VertexID(connected_vertex)] = 1;
-      }
-    }
-  }
-
-  // Iteratively find furthest vertex
-  while (vertices.NEntries() - tmp.NEntries() < npoints) {
-    R3MeshVertex *vertex = FindFurthestVertex(mesh, vertices, vertex_data);
-    if (!vertex) break;
-    VertexData *data = &vertex_data[mesh->VertexID(vertex)];
-    if ((min_spacing > 0) && (data->distance < min_spacing)) break;
-    if (tmp.FindEntry(data->closest_seed)) { 
-      tmp.Remove(data->closest_seed); 
-      vertices.Remove(data->closest_seed);
-    }
+  // Create points at selected vertices
+  for (unsigned int i = seeds.NEntries(); i < samples.size(); i++) {
+    R3MeshVertex *vertex = mesh->Vertex(samples[i]);
     Point *point = new Point(mesh, vertex);
     points->Insert(point);
-    vertices.Insert(vertex);
   }
 
-  // Delete vertex data
-  delete [] vertex_data;
-
   // Return points
   return points;
 }
@@ -861,6 +1007,13 @@ SelectPropertyExtrema(R3Mesh *mesh, R3MeshProperty *prp,
   // Normalize property
   property.Normalize();
 
+  // Build geodesic distance engine
+  R3MeshGeodesics geodesics;
+  if (min_spacing > 0) {
+    geodesics.SetMethod(geodesic_method);
+    geodesics.Build(*mesh);
+  }
+
   // Select points from successively blurred property until number of extrema is npoints
   int max_blurs = 0;
   RNScalar epsilon = 0;
@@ -887,6 +1040,7 @@ SelectPropertyExtrema(R3Mesh *mesh, R3MeshProperty *prp,
     }
 
     // Select amongst extremum vertices taking into account min_spacing
+    std::vector<int> nearby_vertices;
     R3mesh_mark++;
     selected_vertices.Empty();
     for (int i = 0; i < extremum_vertices.NEntries(); i++) {
@@ -904,16 +1058,11 @@ SelectPropertyExtrema(R3Mesh *mesh, R3MeshProperty *prp,
       // Mark nearby vertices
       mesh->SetVertexMark(vertex, R3mesh_mark);
       if (min_spacing > 0) {
-        RNLength *distances = mesh->DijkstraDistances(vertex, min_spacing);
-        for (int j = 0; j < mesh->NVertices(); j++) {
-          R3MeshVertex *nearby_vertex = mesh->Vertex(j);
-          if (mesh->VertexMark(nearby_vertex) != R3mesh_mark) {
-            if (distances[j] <= min_spacing) {
-              mesh->SetVertexMark(nearby_vertex, R3mesh_mark);
-            }
-          }
-        } 
-        delete [] distances;
+        geodesics.FindNeighbors(mesh->VertexID(vertex), min_spacing, nearby_vertices);
+        for (unsigned int j = 0; j < nearby_vertices.size(); j++) {
+          R3MeshVertex *nearby_vertex = mesh->Vertex(nearby_vertices[j]);
+          mesh->SetVertexMark(nearby_vertex, R3mesh_mark);
+        }
       }
     }
 
@@ -1064,7 +1213,15 @@ SelectScaleSpaceExtrema(R3Mesh *mesh, R3MeshProperty *prp,
   // Sort vertices by score
   qsort(scores, mesh->NVertices(), sizeof(ScaleSpaceScore), CompareScaleSpaceScores);
 
+  // Build geodesic distance engine
+  R3MeshGeodesics geodesics;
+  if (min_spacing > 0) {
+    geodesics.SetMethod(geodesic_method);
+    geodesics.Build(*mesh);
+  }
+
   // Select vertices taking into account min_spacing
+  std::vector<int> nearby_vertices;
   R3mesh_mark++;
   RNArray<R3MeshVertex *> selected_vertices;
   for (int i = 0; i < mesh->NVertices(); i++) {
@@ -1082,16 +1239,11 @@ SelectScaleSpaceExtrema(R3Mesh *mesh, R3MeshProperty *prp,
     // Mark nearby vertices
     mesh->SetVertexMark(vertex, R3mesh_mark);
     if (min_spacing > 0) {
-      RNLength *distances = mesh->DijkstraDistances(vertex, min_spacing);
-      for (int j = 0; j < mesh->NVertices(); j++) {
-        R3MeshVertex *nearby_vertex = mesh->Vertex(j);
-        if (mesh->VertexMark(nearby_vertex) != R3mesh_mark) {
-          if (distances[j] <= min_spacing) {
-            mesh->SetVertexMark(nearby_vertex, R3mesh_mark);
-          }
-        }
-      } 
-      delete [] distances;
+      geodesics.FindNeighbors(mesh->VertexID(vertex), min_spacing, nearby_vertices);
+      for (unsigned int j = 0; j < nearby_vertices.size(); j++) {
+        R3MeshVertex *nearby_vertex = mesh->Vertex(nearby_vertices[j]);
+        mesh->SetVertexMark(nearby_vertex, R3mesh_mark);
+      }
     }
 
     // Check if found all points
@@ -1121,10 +1273,249 @@ SelectScaleSpaceExtrema(R3Mesh *mesh, R3MeshProperty *prp,
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Furthest surface point sampling
+////////////////////////////////////////////////////////////////////////
+
+struct FurthestPointData {
+  // Candidates sorted into cells of a regular grid
+  std::vector<R3Point> positions;
+  std::vector<float> distances;
+  std::vector<int> cell_offsets;
+  std::vector<float> cell_max_distances;
+  std::vector<int> cell_furthest_candidates;
+  int xres, yres, zres;
+  R3Point origin;
+  RNLength cell_size;
+
+  // Cells to update for latest sample
+  std::vector<int> update_cells;
+  R3Point sample_position;
+};
+
+
+
+static void
+UpdateFurthestPointCell(int index, int thread_index, void *data)
+{
+  // Get convenient variables
+  FurthestPointData *fps = (FurthestPointData *) data;
+  int cell_index = fps->update_cells[index];
+  const R3Point& sample_position = fps->sample_position;
+
+  // Update squared distances of candidates in cell and find furthest one
+  float max_distance = 0;
+  int furthest_candidate = -1;
+  for (int k = fps->cell_offsets[cell_index]; k < fps->cell_offsets[cell_index+1]; k++) {
+    float d = (float) R3SquaredDistance(fps->positions[k], sample_position);
+    if (d < fps->distances[k]) fps->distances[k] = d;
+    if (fps->distances[k] > max_distance) {
+      max_distance = fps->distances[k];
+      furthest_candidate = k;
+    }
+  }
+
+  // Update cell
+  fps->cell_max_distances[cell_index] = max_distance;
+  fps->cell_furthest_candidates[cell_index] = furthest_candidate;
+}
+
+
+
+static RNArray<Point *> *
+SelectFurthestSurfacePoints(R3Mesh *mesh, int npoints, double min_spacing)
+{
+  // Allocate array of points
+  RNArray<Point *> *points = new RNArray<Point *>();
+  if (!points) {
+    RNFail("Unable to allocate array of points\n");
+    return NULL;
+  }
+
+  // Generate dense area-weighted candidates
+  RNArea total_area = ComputeFaceSamplingWeights(mesh, NULL);
+  if ((total_area == 0) || (npoints <= 0)) return points;
+  RNArray<Point *> candidates;
+  GenerateRandomSurfacePoints(mesh, NULL, total_area, 8 * npoints, &candidates);
+  int ncandidates = candidates.NEntries();
+  if (ncandidates == 0) return points;
+
+  // Choose grid with about eight candidates per occupied cell (and not too many empty ones)
+  FurthestPointData fps;
+  R3Box candidate_bbox = R3null_box;
+  for (int i = 0; i < ncandidates; i++) candidate_bbox.Union(candidates[i]->position);
+  fps.origin = candidate_bbox.Min();
+  fps.cell_size = sqrt(8.0 * total_area / ncandidates);
+  if (fps.cell_size <= 0) fps.cell_size = candidate_bbox.LongestAxisLength() + RN_EPSILON;
+  while (TRUE) {
+    fps.xres = (int) (candidate_bbox.XLength() / fps.cell_size) + 1;
+    fps.yres = (int) (candidate_bbox.YLength() / fps.cell_size) + 1;
+    fps.zres = (int) (candidate_bbox.ZLength() / fps.cell_size) + 1;
+    if ((double) fps.xres * fps.yres * fps.zres <= 4.0 * ncandidates + 1) break;
+    fps.cell_size *= 1.25;
+  }
+
+  // Sort candidates into cells
+  int ncells = fps.xres * fps.yres * fps.zres;
+  std::vector<int> candidate_cells(ncandidates);
+  fps.cell_offsets.assign(ncells + 1, 0);
+  for (int i = 0; i < ncandidates; i++) {
+    R3Vector offset = (candidates[i]->position - fps.origin) / fps.cell_size;
+    int ix = (int) offset.X(); if (ix >= fps.xres) ix = fps.xres - 1;
+    int iy = (int) offset.Y(); if (iy >= fps.yres) iy = fps.yres - 1;
+    int iz = (int) offset.Z(); if (iz >= fps.zres) iz = fps.zres - 1;
+    candidate_cells[i] = (iz * fps.yres + iy) * fps.xres + ix;
+    fps.cell_offsets[candidate_cells[i] + 1]++;
+  }
+  for (int i = 0; i < ncells; i++) fps.cell_offsets[i+1] += fps.cell_offsets[i];
+  std::vector<int> sorted_candidates(ncandidates);
+  std::vector<int> cell_fill(fps.cell_offsets.begin(), fps.cell_offsets.end() - 1);
+  for (int i = 0; i < ncandidates; i++) sorted_candidates[cell_fill[candidate_cells[i]]++] = i;
+  fps.positions.resize(ncandidates);
+  for (int k = 0; k < ncandidates; k++) fps.positions[k] = candidates[sorted_candidates[k]]->position;
+  fps.distances.assign(ncandidates, FLT_MAX);
+  fps.cell_max_distances.assign(ncells, 0);
+  fps.cell_furthest_candidates.assign(ncells, -1);
+
+  // Start with candidate furthest from an arbitrary candidate
+  int sample = 0;
+  RNScalar sample_distance = -1;
+  for (int k = 0; k < ncandidates; k++) {
+    RNScalar d = R3SquaredDistance(fps.positions[k], fps.positions[0]);
+    if (d > sample_distance) { sample_distance = d; sample = k; }
+  }
+
+  // Iteratively select candidate furthest from all selected ones
+  std::vector<int> samples;
+  std::priority_queue<std::pair<float, int> > heap;
+  RNScalar min_spacing_squared = (min_spacing > 0) ? min_spacing * min_spacing : 0;
+  sample_distance = FLT_MAX;
+  while (TRUE) {
+    // Select sample
+    samples.push_back(sample);
+    if ((int) samples.size() >= npoints) break;
+
+    // Find cells whose candidates may be closer to sample than to previous samples
+    // (only cells within distance of the furthest candidate can change)
+    fps.sample_position = fps.positions[sample];
+    fps.update_cells.clear();
+    RNLength radius = (sample_distance < FLT_MAX) ? sqrt(sample_distance) : FLT_MAX;
+    R3Vector sample_offset = (fps.sample_position - fps.origin) / fps.cell_size;
+    RNScalar cell_radius = radius / fps.cell_size;
+    RNScalar x0 = sample_offset.X() - cell_radius, x1 = sample_offset.X() + cell_radius;
+    RNScalar y0 = sample_offset.Y() - cell_radius, y1 = sample_offset.Y() + cell_radius;
+    RNScalar z0 = sample_offset.Z() - cell_radius, z1 = sample_offset.Z() + cell_radius;
+    int ix0 = (x0 > 0) ? (int) x0 : 0, ix1 = (x1 < fps.xres) ? (int) x1 : fps.xres - 1;
+    int iy0 = (y0 > 0) ? (int) y0 : 0, iy1 = (y1 < fps.yres) ? (int) y1 : fps.yres - 1;
+    int iz0 = (z0 > 0) ? (int) z0 : 0, iz1 = (z1 < fps.zres) ? (int) z1 : fps.zres - 1;
+    for (int iz = iz0; iz <= iz1; iz++) {
+      for (int iy = iy0; iy <= iy1; iy++) {
+        for (int ix = ix0; ix <= ix1; ix++) {
+          int cell_index = (iz * fps.yres + iy) * fps.xres + ix;
+          if (fps.cell_offsets[cell_index] == fps.cell_offsets[cell_index+1]) continue;
+          if (fps.distances[fps.cell_offsets[cell_index]] < FLT_MAX) {
+            // Skip cell if it is further from sample than its furthest candidate is from samples
+            RNScalar dx = 0, dy = 0, dz = 0;
+            if (sample_offset.X() < ix) dx = ix - sample_offset.X();
+            else if (sample_offset.X() > ix + 1) dx = sample_offset.X() - (ix + 1);
+            if (sample_offset.Y() < iy) dy = iy - sample_offset.Y();
+            else if (sample_offset.Y() > iy + 1) dy = sample_offset.Y() - (iy + 1);
+            if (sample_offset.Z() < iz) dz = iz - sample_offset.Z();
+            else if (sample_offset.Z() > iz + 1) dz = sample_offset.Z() - (iz + 1);
+            RNScalar box_distance = (dx*dx + dy*dy + dz*dz) * fps.cell_size * fps.cell_size;
+            if (box_distance >= fps.cell_max_distances[cell_index]) continue;
+          }
+          fps.update_cells.push_back(cell_index);
+        }
+      }
+    }
+
+    // Update distances of candidates in cells
+    int nupdate_cells = (int) fps.update_cells.size();
+    if (nupdate_cells >= 256) RNParallelFor(nupdate_cells, UpdateFurthestPointCell, &fps, 16);
+    else for (int i = 0; i < nupdate_cells; i++) UpdateFurthestPointCell(i, 0, &fps);
+
+    // Update heap of cell maximum distances (entries that no longer match are stale)
+    for (int i = 0; i < nupdate_cells; i++) {
+      int cell_index = fps.update_cells[i];
+      if (fps.cell_max_distances[cell_index] > 0) {
+        heap.push(std::pair<float, int>(fps.cell_max_distances[cell_index], cell_index));
+      }
+    }
+
+    // Find furthest candidate
+    while (!heap.empty() && (heap.top().first != fps.cell_max_distances[heap.top().second])) heap.pop();
+    if (heap.empty()) break;
+    sample_distance = heap.top().first;
+    if (sample_distance < min_spacing_squared) break;
+    sample = fps.cell_furthest_candidates[heap.top().second];
+  }
+
+  // Insert selected candidates into points and delete others
+  std::vector<char> selected(ncandidates, 0);
+  for (size_t i = 0; i < samples.size(); i++) {
+    int candidate_index = sorted_candidates[samples[i]];
+    points->Insert(candidates[candidate_index]);
+    selected[candidate_index] = 1;
+  }
+  for (int i = 0; i < ncandidates; i++) {
+    if (!selected[i]) delete candidates[i];
+  }
+
+  // Return points
+  return points;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Exterior point sampling
 ////////////////////////////////////////////////////////////////////////
 
+struct ExteriorTraceData {
+  const R3TriangleBVH *bvh;
+  const R3Grid *grid;
+  std::vector<int> edge_cells0;
+  std::vector<int> edge_cells1;
+  std::vector<int> hit_faces;
+  std::vector<R3Point> hit_points;
+  std::vector<R3Vector> hit_normals;
+};
+
+
+
+static void
+TraceExteriorEdge(int index, int thread_index, void *data)
+{
+  // Get segment between cell centers
+  ExteriorTraceData *trace_data = (ExteriorTraceData *) data;
+  const R3Grid *grid = trace_data->grid;
+  int ix, iy, iz;
+  grid->IndexToIndices(trace_data->edge_cells0[index], ix, iy, iz);
+  R3Point p0 = grid->WorldPosition(ix, iy, iz);
+  grid->IndexToIndices(trace_data->edge_cells1[index], ix, iy, iz);
+  R3Point p1 = grid->WorldPosition(ix, iy, iz);
+  R3Ray ray(p0, p1);
+
+  // Find front-most surface crossing segment, with normal facing p0
+  int hit_face = -1;
+  R3Point hit_point;
+  R3Vector hit_normal;
+  if (trace_data->bvh->FindIntersection(ray, &hit_face, NULL, &hit_point, &hit_normal, NULL, 0, R3Distance(p0, p1))) {
+    if (hit_normal.Dot(ray.Vector()) > 0) hit_normal.Flip();
+    trace_data->hit_points[index] = hit_point;
+    trace_data->hit_normals[index] = hit_normal;
+  }
+  else {
+    hit_face = -1;
+  }
+
+  // Remember hit
+  trace_data->hit_faces[index] = hit_face;
+}
+
+
+
 static RNArray<Point *> *
 SelectExteriorSurfacePoints(R3Mesh *mesh, int npoints, double min_spacing)
 {
@@ -1140,19 +1531,18 @@ SelectExteriorSurfacePoints(R3Mesh *mesh, int npoints, double min_spacing)
   RNScalar grid_spacing = sqrt(area_per_point);
   if (grid_spacing < min_spacing) grid_spacing = min_spacing;
   R3Grid exterior_grid(mesh->BBox(), grid_spacing, 5, 1024, 2);
-  const RNScalar *exterior_grid_values = exterior_grid.GridValues();
-  grid_spacing = exterior_grid.GridToWorldScaleFactor();
 
-  // Initialize mesh search tree
-  R3MeshSearchTree search_tree(mesh);
+  // Initialize mesh ray tracer
+  R3TriangleBVH bvh;
+  bvh.InsertMesh(*mesh);
+  bvh.Build();
 
-  // Initialze point search tree
-  Point tmp; int position_offset = (unsigned char *) &(tmp.position) - (unsigned char *) &tmp;
-  R3Kdtree<Point *> kdtree(exterior_grid.WorldBox(), position_offset);
+  // Initialize point spacing grid
+  PointSpacingGrid spacing_grid(min_spacing);
 
   // Seed search with border voxels (assumed outside)
-  int ix, iy, iz, grid_index;
-  RNArray<const RNScalar *> stack;
+  int grid_index;
+  std::vector<int> frontier;
   for (int i = 0; i < exterior_grid.XResolution(); i++) {
     for (int j = 0; j < exterior_grid.YResolution(); j++) {
       for (int k = 0; k < exterior_grid.ZResolution(); k++) {
@@ -1160,98 +1550,71 @@ SelectExteriorSurfacePoints(R3Mesh *mesh, int npoints, double min_spacing)
             (j == 0) || (j == exterior_grid.YResolution()-1) ||
             (k == 0) || (k == exterior_grid.ZResolution()-1)) {
           exterior_grid.IndicesToIndex(i, j, k, grid_index);
-          stack.Insert(&exterior_grid_values[grid_index]);
+          frontier.push_back(grid_index);
           exterior_grid.SetGridValue(grid_index, 1.0);
         }
       }
     }
   }
 
-  // Flood fill
-  while (!stack.IsEmpty()) {
-    const RNScalar *exterior_grid_valuep = stack.Tail(); stack.RemoveTail();
-    int grid_index = exterior_grid_valuep - exterior_grid_values;
-    assert((grid_index >= 0) && (grid_index < exterior_grid.NEntries()));
-    assert(exterior_grid.GridValue(grid_index) > 0.5);
-    exterior_grid.IndexToIndices(grid_index, ix, iy, iz);
-    R3Point p0 = exterior_grid.WorldPosition(ix, iy, iz);
-    for (int dz = -1; dz <= 1; dz++) {
-      int gz = iz + dz;
-      if ((gz < 0) || (gz >= exterior_grid.ZResolution())) continue;
-      for (int dy = -1; dy <= 1; dy++) {
-        int gy = iy + dy;
-        if ((gy < 0) || (gy >= exterior_grid.YResolution())) continue;
-        for (int dx = -1; dx <= 1; dx++) {
-          int gx = ix + dx;
-          if ((gx < 0) || (gx >= exterior_grid.XResolution())) continue;
-          if (exterior_grid.GridValue(gx, gy, gz) > 0.5) continue;
-
-#if 1       
-          // Create point sample at front-most surface boundary separating cell from its neighbors
-          RNBoolean blocked = FALSE;
-          R3Point p1 = exterior_grid.WorldPosition(gx, gy, gz);
-          R3Ray ray(p0, p1);
-          R3Point midpoint = 0.5*(p0 + p1);
-          RNArray<R3MeshIntersection *> hits;
-          search_tree.FindAll(midpoint, hits, 0, grid_spacing);
-          RNScalar best_t = FLT_MAX;
-          R3Point best_position = R3zero_point;
-          R3Vector best_normal = R3zero_vector;
-          for (int k = 0; k < hits.NEntries(); k++) {
-            R3MeshIntersection *hit = hits.Kth(k);
-            R3Plane plane = mesh->FacePlane(hit->face);
-            RNScalar d0 = R3SignedDistance(plane, p0);
-            RNScalar d1 = R3SignedDistance(plane, p1);
-            if (RNIsNegativeOrZero(d0*d1)) {
-              if (mesh->Intersection(ray, hit->face, hit)) {
-                if (hit->t < best_t) {
-                  best_position = hit->point;
-                  best_normal = plane.Normal();
-                  if (d0 < 0) best_normal.Flip();
-                  best_t = hit->t;
-                }
-              }
-            }
-            delete hit;
-          }
-          if (best_t < FLT_MAX) {
-            if ((min_spacing == 0) || !kdtree.FindAny(best_position, 0, min_spacing)) {
-              Point *point = new Point(best_position, best_normal);
-              kdtree.InsertPoint(point);
-              points->Insert(point);
-            }
-            blocked = TRUE;
-          }
-#else
-          // FOR SOME REASON, THIS DOES NOT WORK
-          // Create point sample at front-most surface boundary separating cell from its neighbors
-          RNBoolean blocked = FALSE;
-          R3Point p1 = exterior_grid.WorldPosition(gx, gy, gz);
-          R3Ray ray(p0, p1);
-          R3MeshIntersection hit;
-          search_tree.FindIntersection(ray, hit, 0, grid_spacing);
-          if (hit.type != R3_MESH_NULL_TYPE) {
-            if ((min_spacing == 0) || !kdtree.FindAny(hit.point, 0, min_spacing)) {
-              R3Point p = hit.point;
-              R3Vector n = mesh->FaceNormal(hit.face);
-              if (n.Dot(ray.Vector()) > 0) n.Flip();
-              Point *point = new Point(p, n);
-              kdtree.InsertPoint(point);
-              points->Insert(point);
-            }
-            blocked = TRUE;
-          }
-#endif
-          
-          // Continue DFS 
-          if (!blocked) {
+  // Flood fill in breadth-first waves (grid values are one plus the wave in which cells were reached)
+  ExteriorTraceData trace_data;
+  trace_data.bvh = &bvh;
+  trace_data.grid = &exterior_grid;
+  RNScalar wave_value = 1.0;
+  while (!frontier.empty()) {
+    // Collect edges from frontier cells to neighbors not reached yet
+    int ix, iy, iz;
+    trace_data.edge_cells0.clear();
+    trace_data.edge_cells1.clear();
+    for (size_t i = 0; i < frontier.size(); i++) {
+      exterior_grid.IndexToIndices(frontier[i], ix, iy, iz);
+      for (int dz = -1; dz <= 1; dz++) {
+        int gz = iz + dz;
+        if ((gz < 0) || (gz >= exterior_grid.ZResolution())) continue;
+        for (int dy = -1; dy <= 1; dy++) {
+          int gy = iy + dy;
+          if ((gy < 0) || (gy >= exterior_grid.YResolution())) continue;
+          for (int dx = -1; dx <= 1; dx++) {
+            int gx = ix + dx;
+            if ((gx < 0) || (gx >= exterior_grid.XResolution())) continue;
+            if ((dx == 0) && (dy == 0) && (dz == 0)) continue;
+            if (exterior_grid.GridValue(gx, gy, gz) > 0.5) continue;
             exterior_grid.IndicesToIndex(gx, gy, gz, grid_index);
-            stack.Insert(&exterior_grid_values[grid_index]);
-            exterior_grid.SetGridValue(grid_index, 1.0);
+            trace_data.edge_cells0.push_back(frontier[i]);
+            trace_data.edge_cells1.push_back(grid_index);
           }
         }
       }
     }
+
+    // Trace edges in parallel
+    int nedges = (int) trace_data.edge_cells0.size();
+    trace_data.hit_faces.resize(nedges);
+    trace_data.hit_points.resize(nedges);
+    trace_data.hit_normals.resize(nedges);
+    RNParallelFor(nedges, TraceExteriorEdge, &trace_data, 64);
+
+    // Create point samples at surfaces blocking edges and continue search across others
+    std::vector<int> next_frontier;
+    for (int i = 0; i < nedges; i++) {
+      grid_index = trace_data.edge_cells1[i];
+      if (trace_data.hit_faces[i] >= 0) {
+        const R3Point& position = trace_data.hit_points[i];
+        if ((min_spacing > 0) && spacing_grid.IsNear(position)) continue;
+        Point *point = new Point(position, trace_data.hit_normals[i]);
+        if (min_spacing > 0) spacing_grid.Insert(position);
+        points->Insert(point);
+      }
+      else if (exterior_grid.GridValue(grid_index) < 0.5) {
+        exterior_grid.SetGridValue(grid_index, wave_value + 1.0);
+        next_frontier.push_back(grid_index);
+      }
+    }
+
+    // Advance to next wave
+    frontier.swap(next_frontier);
+    wave_value += 1.0;
   }
 
   // exterior_grid.WriteFile("exterior.grd");
@@ -1276,24 +1639,31 @@ SelectVisibleSurfacePoints(R3Mesh *mesh, int npoints, double min_spacing)
     return NULL;
   }
 
-  // Initialze point search tree
-  Point tmp; int position_offset = (unsigned char *) &(tmp.position) - (unsigned char *) &tmp;
-  R3Kdtree<Point *> kdtree(mesh->BBox(), position_offset);
+  // Initialize mesh ray tracer
+  R3TriangleBVH bvh;
+  bvh.InsertMesh(*mesh);
+  bvh.Build();
+
+  // Initialize point spacing grid
+  PointSpacingGrid spacing_grid(min_spacing);
 
   // Get convenient variables
-  // Need high resolution to avoid z-buffer quantization issues
   int resolution = 1024; 
   int nviews = npoints / (resolution * resolution);
   if (nviews < 128) nviews = 128;
   int npixels = resolution * resolution * nviews;
   RNScalar pixel_probability = (RNScalar) npoints / (RNScalar) npixels;
+  RNScalar log_pixel_miss_probability = (pixel_probability < 1) ? log(1.0 - pixel_probability) : 0;
   R3Point c = mesh->BBox().Centroid();
   RNScalar r = mesh->BBox().DiagonalRadius();
   R2Box bbox2d(-r, -r, r, r);
-  R2Grid face_image(bbox2d, r / resolution);
-  R2Grid depth_image(face_image);
+  R2Grid image(bbox2d, r / resolution);
+  if (pixel_probability <= 0) return points;
 
   // Insert points visible to random views
+  std::vector<R3Ray> rays;
+  std::vector<int> hit_faces;
+  std::vector<RNScalar> hit_ts;
   for (int k = 0; k < nviews; k++) {
     // Create transformation
     R3Affine transformation = R3identity_affine;
@@ -1302,51 +1672,46 @@ SelectVisibleSurfacePoints(R3Mesh *mesh, int npoints, double min_spacing)
     transformation.Rotate(R3RandomDirection(), RN_TWO_PI * RNRandomScalar());
     transformation.Translate(-c.Vector());
 
-    // Render image
-    face_image.Clear(-1);
-    depth_image.Clear(RN_INFINITY);
-    for (int i = 0; i < mesh->NFaces(); i++) {
-      R3MeshFace *face = mesh->Face(i);
-      R3MeshVertex *v0 = mesh->VertexOnFace(face, 0);
-      R3MeshVertex *v1 = mesh->VertexOnFace(face, 1);
-      R3MeshVertex *v2 = mesh->VertexOnFace(face, 2);
-      R3Point p0 = mesh->VertexPosition(v0);
-      R3Point p1 = mesh->VertexPosition(v1);
-      R3Point p2 = mesh->VertexPosition(v2);
-      p0.Transform(transformation);
-      p1.Transform(transformation);
-      p2.Transform(transformation);
-      face_image.RenderWorldTriangle(
-        R2Point(p0.X(), p0.Y()),
-        R2Point(p1.X(), p1.Y()),
-        R2Point(p2.X(), p2.Y()),
-        i, i, i,
-        p0.Z(), p1.Z(), p2.Z(),
-        depth_image);
+    // Get view direction (along +Z in view coordinates)
+    R3Vector view_direction(0, 0, 1);
+    view_direction.InverseTransform(transformation);
+    view_direction.Normalize();
+
+    // Create rays through randomly chosen pixels
+    // (skip counts are geometric, as if each pixel was chosen with pixel_probability)
+    rays.clear();
+    RNScalar pixel_index = -1;
+    while (TRUE) {
+      pixel_index += 1;
+      if (log_pixel_miss_probability < 0) pixel_index += floor(log(1.0 - RNRandomScalar()) / log_pixel_miss_probability);
+      if (pixel_index >= image.NEntries()) break;
+      int ix, iy;
+      image.IndexToIndices((int) pixel_index, ix, iy);
+      R2Point xy_position = image.WorldPosition(ix, iy);
+      R3Point origin(xy_position.X(), xy_position.Y(), -2 * r);
+      origin.InverseTransform(transformation);
+      rays.push_back(R3Ray(origin, view_direction, TRUE));
     }
 
+    // Trace rays in parallel
+    int nrays = (int) rays.size();
+    if (nrays == 0) continue;
+    hit_faces.resize(nrays);
+    hit_ts.resize(nrays);
+    bvh.FindIntersections(nrays, &rays[0], &hit_faces[0], &hit_ts[0], 0, 4 * r);
+
     // Generate points
-    for (int iy = 0; iy < depth_image.YResolution(); iy++) {
-      for (int ix = 0; ix < depth_image.XResolution(); ix++) {
-        if (RNRandomScalar() > pixel_probability) continue;
-        RNScalar face_value = face_image.GridValue(ix, iy);
-        if (face_value < 0)  continue;
-        RNScalar depth = depth_image.GridValue(ix, iy);
-        if (depth == RN_INFINITY) continue;
-        R2Point xy_position = depth_image.WorldPosition(ix, iy);
-        R3Point position(xy_position.X(), xy_position.Y(), depth);
-        position.InverseTransform(transformation);
-        if ((min_spacing > 0) && kdtree.FindAny(position, 0, min_spacing)) continue;
-        int face_index = (int) (face_value + 0.5);
-        if ((face_index < 0) || (face_index >= mesh->NFaces())) continue;
-        R3MeshFace *face = mesh->Face(face_index);
-        R3Vector normal = mesh->FaceNormal(face);
-        R3Vector n = normal; n.Transform(transformation);
-        if (n.Z() > 0) normal.Flip();
-        Point *point = new Point(position, normal);
-        if (min_spacing > 0) kdtree.InsertPoint(point);
-        points->Insert(point);
-      }
+    for (int i = 0; i < nrays; i++) {
+      int face_index = hit_faces[i];
+      if ((face_index < 0) || (face_index >= mesh->NFaces())) continue;
+      R3Point position = rays[i].Point(hit_ts[i]);
+      if ((min_spacing > 0) && spacing_grid.IsNear(position)) continue;
+      R3MeshFace *face = mesh->Face(face_index);
+      R3Vector normal = mesh->FaceNormal(face);
+      if (normal.Dot(view_direction) > 0) normal.Flip();
+      Point *point = new Point(position, normal);
+      if (min_spacing > 0) spacing_grid.Insert(position);
+      points->Insert(point);
     }
   }
 
@@ -1653,7 +2018,7 @@ SelectPoints(R3Mesh *mesh, R3MeshProperty *property, int selection_method)
   if (selection_method == RANDOM_VERTICES) 
     points = SelectVertexPoints(mesh, num_points, min_spacing);
   else if (selection_method == RANDOM_SURFACE_POINTS) 
-    points= SelectRandomSurfacePoints(mesh, property, num_points);
+    points= SelectRandomSurfacePoints(mesh, property, num_points, min_spacing);
   else if (selection_method == EXTERIOR_SURFACE_POINTS) 
     points= SelectExteriorSurfacePoints(mesh, num_points, min_spacing);
   else if (selection_method == NEAR_SURFACE_POINTS) 
@@ -1662,6 +2027,8 @@ SelectPoints(R3Mesh *mesh, R3MeshProperty *property, int selection_method)
     points= SelectVisibleSurfacePoints(mesh, num_points, min_spacing);
   else if (selection_method == ITERATIVE_FURTHEST_VERTEX) 
     points= SelectFurthestPoints(mesh, num_points, min_spacing);
+  else if (selection_method == FURTHEST_SURFACE_POINTS) 
+    points= SelectFurthestSurfacePoints(mesh, num_points, min_spacing);
   else if (selection_method == PROPERTY_MINIMA) 
     points= SelectPropertyExtrema(mesh, property, num_points, min_spacing, PROPERTY_MINIMA);
   else if (selection_method == PROPERTY_MAXIMA) 
@@ -1729,6 +2096,79 @@ SelectPoints(R3Mesh *mesh, R3MeshProperty *property, int selection_method)
 
 
 
+static RNArray<Point *> *
+SelectPoints(R3IndexedMesh *mesh, int selection_method)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Update number of points
+  if (num_points <= 0) {
+    if (min_spacing > 0) num_points = mesh->NVertices();
+    else num_points = 1024;
+  }
+
+  // Select points using requested selection method (only ones that do not need mesh topology)
+  RNArray<Point *> *points = NULL;
+  if (selection_method == RANDOM_SURFACE_POINTS) {
+    points = SelectRandomSurfacePoints(mesh, num_points, min_spacing);
+  }
+  else if (selection_method == CENTER_OF_MASS) {
+    points = new RNArray<Point *>();
+    points->Insert(new Point(mesh->Centroid(), R3zero_vector));
+  }
+  else {
+    RNFail("Selection method %d is not supported for indexed meshes\n", selection_method);
+    return NULL;
+  }
+
+  // Check points
+  if (!points) {
+    RNFail("Error selecting points\n");
+    return 0;
+  }
+
+  // Check if too few points
+  if ((min_points > 0) && (mesh->NFaces() > 0)) {
+    while (points->NEntries() < min_points) {
+      int face_index = (int) (RNRandomScalar() * mesh->NFaces());
+      R3Point position = mesh->RandomPointOnFace(face_index);
+      R3Vector normal = mesh->FaceNormal(face_index);
+      Point *point = new Point(position, normal);
+      points->Insert(point);
+    }
+  }
+
+  // Check if too many points
+  if (max_points > 0) {
+    while (points->NEntries() > max_points) {
+      int k = RNRandomScalar() * points->NEntries();
+      points->Swap(k, points->NEntries()-1);
+      Point *point = points->Tail();
+      points->RemoveTail();
+      delete point;
+    }
+  }
+
+  // Print message
+  if (print_verbose) {
+    fprintf(stdout, "Generated points ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Points = %d\n", points->NEntries());
+    printf("  Selection method = %d\n", selection_method);
+    if (min_points > 0) printf("  Minimum # points = %d\n", min_points);
+    if (max_points > 0) printf("  Maximum # points = %d\n", max_points);
+    printf("  Requested # points = %d\n", num_points);
+    fflush(stdout);
+  }
+
+  // Return array of points
+  return points;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Program argument parsing
 ////////////////////////////////////////////////////////////////////////
@@ -1760,6 +2200,7 @@ ParseArgs (int argc, char **argv)
       else if (!strcmp(*argv, "-near_surface_points")) { selection_method = NEAR_SURFACE_POINTS; }
       else if (!strcmp(*argv, "-random_vertices")) { selection_method = RANDOM_VERTICES; }
       else if (!strcmp(*argv, "-iterative_furthest_vertex")) { selection_method = ITERATIVE_FURTHEST_VERTEX; }
+      else if (!strcmp(*argv, "-furthest_surface_points")) { selection_method = FURTHEST_SURFACE_POINTS; }
       else if (!strcmp(*argv, "-center_of_mass")) { selection_method = CENTER_OF_MASS; }
       else if (!strcmp(*argv, "-vertex_closest_to_center_of_mass")) { selection_method = VERTEX_CLOSEST_TO_CENTER_OF_MASS; }
       else if (!strcmp(*argv, "-property_minima")) { selection_method = PROPERTY_MINIMA; }
@@ -1770,6 +2211,8 @@ ParseArgs (int argc, char **argv)
       else if (!strcmp(*argv, "-scale_space_extrema")) { selection_method = SCALE_SPACE_EXTREMA; }
       else if (!strcmp(*argv, "-uniform_in_bbox")) { selection_method = UNIFORM_IN_BBOX; }
       else if (!strcmp(*argv, "-binary_sdf")) { binary_sdf = TRUE; }
+      else if (!strcmp(*argv, "-indexed_mesh")) { indexed_mesh = TRUE; }
+      else if (!strcmp(*argv, "-fast_marching")) { geodesic_method = R3_MESH_FAST_MARCHING_DISTANCES; }
       else if (!strcmp(*argv, "-v")) { print_verbose = TRUE; }
       else if (!strcmp(*argv, "-debug")) { print_debug = TRUE; }
       else if (!strcmp(*argv, "-bbox")) {
@@ -1798,6 +2241,12 @@ ParseArgs (int argc, char **argv)
     return FALSE;
   }
 
+  // Check indexed mesh options (no properties or curvatures)
+  if (indexed_mesh && (property_name || (curvature_exponent > 0))) {
+    RNFail("Properties and curvatures are not supported with -indexed_mesh\n");
+    return FALSE;
+  }
+
   // Resolve binary sdf flag
   if (!strstr(points_name, ".sdf")) binary_sdf = TRUE;
 
@@ -1819,6 +2268,20 @@ main(int argc, char **argv)
   // Parse args
   if(!ParseArgs(argc, argv)) exit(-1);
 
+  // Sample indexed mesh (skips building edge topology)
+  if (indexed_mesh) {
+    R3IndexedMesh *mesh = ReadIndexedMesh(mesh_name);
+    if (!mesh) exit(-1);
+    RNArray<Point *> *points = SelectPoints(mesh, selection_method);
+    if (!points) exit(-1);
+    if (!WritePoints(NULL, *points, points_name)) exit(-1);
+    if (print_verbose) {
+      fprintf(stdout, "Finished in %6.3f seconds.\n", start_time.Elapsed());
+      fflush(stdout);
+    }
+    return 0;
+  }
+
   // Read mesh
   R3Mesh *mesh = ReadMesh(mesh_name);
   if (!mesh) exit(-1);
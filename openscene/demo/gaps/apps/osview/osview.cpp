@@ -137,8 +137,9 @@ static int GLUTmodifiers = 0;
 
 // Data variables
 
-static RNArray<R3Mesh *> meshes;
+static RNArray<R3IndexedMesh *> meshes;
 static RNArray<R3SurfelScene *> surfels;
+static RNArray<R3SurfelPointRenderer *> point_renderers;
 static RNArray<RNDenseMatrix *> point_features;
 static RNArray<RNVector *> mesh_affinities;
 static RNArray<RNVector *> mesh_segmentations;
@@ -164,6 +165,10 @@ static RNInterval value_range(default_value_range);
 static RNRgb background(0,0,0);
 static R3Point center(0, 0, 0);
 static R3Viewer viewer;
+static std::vector<R2Point> lasso_points;
+static std::vector<int> selected_points;
+static std::vector<GLfloat> selected_point_positions;
+static RNLength selection_radius = 0;
 
 
 // Display variables
@@ -178,6 +183,7 @@ static int show_category_names = 0;
 static int show_selected_position = 1;
 static int show_weak_affinities = 1;
 static int show_axes = 0;
+static int show_selected_points = 1;
 
 
 // VBO variables
@@ -189,6 +195,36 @@ static GLuint vbo_face_index_buffer = 0;
 static unsigned int vbo_nvertices = 0;
 static unsigned int vbo_nfaces = 0;
 static int vbo_color_scheme = -1;
+static std::vector<int> vbo_vertex_order;
+static std::vector<int> vbo_vertex_indices;
+static std::vector<GLfloat> vbo_point_positions;
+static std::vector<int> vbo_vertex_cluster_offsets;
+static std::vector<R3Box> vbo_vertex_cluster_bboxes;
+static std::vector<RNLength> vbo_vertex_cluster_spacings;
+static std::vector<int> vbo_face_cluster_offsets;
+static std::vector<R3Box> vbo_face_cluster_bboxes;
+
+
+// Culling variables
+
+static int frustum_culling = 1;
+static int occlusion_culling = 0;
+static RNScalar screen_space_error = 1;
+static R3ViewCuller draw_list_culler;
+static std::vector<GLint> draw_list_point_firsts;
+static std::vector<GLsizei> draw_list_point_counts;
+static std::vector<GLsizei> draw_list_face_counts;
+static std::vector<const GLvoid *> draw_list_face_offsets;
+static int draw_list_valid = 0;
+static int point_budget = 8 * 1024 * 1024;
+static int point_renderer_color_scheme = -1;
+
+
+// Picking variables
+
+static R3PointPicker point_picker;
+static std::vector<int> point_picker_offsets;
+static RNArray<R3TriangleBVH *> mesh_bvhs;
 
 
 // Query variables
@@ -207,15 +243,16 @@ static unsigned char CAMERA_ALPHA = 254;
 // Read/Write functions
 ////////////////////////////////////////////////////////////////////////
 
-static R3Mesh *
+static R3IndexedMesh *
 ReadMeshFile(const char *filename)
 {
   // Start statistics
   RNTime start_time;
   start_time.Read();
 
-  // Allocate mesh
-  R3Mesh *mesh = new R3Mesh();
+  // Allocate mesh (indexed, since no edge topology is needed;
+  // vertex index is row of point features)
+  R3IndexedMesh *mesh = new R3IndexedMesh();
   if (!mesh) {
     RNFail("Unable to allocate mesh for %s\n", filename);
     return 0;
@@ -227,18 +264,11 @@ ReadMeshFile(const char *filename)
     return 0;
   }
 
-  // Set vertex values (indicating row of point features)
-  for (int i = 0; i < mesh->NVertices(); i++) {
-    R3MeshVertex *vertex = mesh->Vertex(i);
-    mesh->SetVertexValue(vertex, i);
-  }
-
   // Print statistics
   if (print_verbose) {
     printf("Read mesh from %s ...\n", filename);
     printf("  Time = %.2f seconds\n", start_time.Elapsed());
     printf("  # Faces = %d\n", mesh->NFaces());
-    printf("  # Edges = %d\n", mesh->NEdges());
     printf("  # Vertices = %d\n", mesh->NVertices());
     fflush(stdout);
   }
@@ -330,56 +360,43 @@ CloseSurfelsFiles(R3SurfelScene *scene)
 
 
 
-static R3Mesh *
-CreateMeshFromSurfels(R3SurfelScene *scene)
+static R3SurfelPointRenderer *
+CreatePointRendererFromSurfels(R3SurfelScene *scene)
 {
   // Start statistics
   RNTime start_time;
   start_time.Read();
 
-  // Allocate mesh
-  R3Mesh *mesh = new R3Mesh();
-  if (!mesh) {
-    RNFail("Unable to allocate mesh\n");
+  // Allocate point renderer
+  R3SurfelPointRenderer *renderer = new R3SurfelPointRenderer();
+  if (!renderer) {
+    RNFail("Unable to allocate point renderer\n");
     return NULL;
   }
 
-  // Load surfels into mesh
-  R3SurfelTree *tree = scene->Tree();
-  R3SurfelDatabase *database = tree->Database();
-  for (int i = 0; i < tree->NNodes(); i++) {
-    R3SurfelNode *node = tree->Node(i);
-    if (node->NParts() > 0) continue;
-    R3SurfelObject *object = node->Object(TRUE, TRUE);
-    // while (object && object->Parent() && (object->Parent() != scene->RootObject()))  object = object->Parent();
-    for (int j = 0; j < node->NBlocks(); j++) {
-      R3SurfelBlock *block = node->Block(j);
-      database->ReadBlock(block);
-      for (int k = 0; k < block->NSurfels(); k++) {
-        R3Point position = block->SurfelPosition(k);
-        R3Vector normal = block->SurfelNormal(k);
-        RNRgb color = block->SurfelColor(k);
-        int index = block->SurfelIdentifier(k);
-        if (one_feature_vector_per_object) index = (object) ? object->SceneIndex() : scene->NObjects();
-        R3MeshVertex *vertex = mesh->CreateVertex(position, normal, color);
-        mesh->SetVertexValue(vertex, index);
-      }
-      database->ReleaseBlock(block);
-    }
+  // Load surfels into packed buffers and build octree
+  if (!renderer->Build(scene, one_feature_vector_per_object)) {
+    RNFail("Unable to build point renderer from surfels\n");
+    delete renderer;
+    return NULL;
   }
 
+  // Set rendering parameters
+  renderer->SetScreenSpaceError(screen_space_error);
+  renderer->SetFrustumCulling(frustum_culling);
+  renderer->SetPointBudget(point_budget);
+
   // Print statistics
   if (print_verbose) {
-    printf("Created mesh from surfels ...\n");
+    printf("Created point renderer from surfels ...\n");
     printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  # Faces = %d\n", mesh->NFaces());
-    printf("  # Edges = %d\n", mesh->NEdges());
-    printf("  # Vertices = %d\n", mesh->NVertices());
+    printf("  # Points = %d\n", renderer->NPoints());
+    printf("  # Nodes = %d\n", renderer->NNodes());
     fflush(stdout);
   }
 
-  // Return mesh
-  return mesh;
+  // Return point renderer
+  return renderer;
 }
 
 
@@ -923,13 +940,12 @@ EnableViewingExtent(void)
 ////////////////////////////////////////////////////////////////////////
 
 static int
-IsFaceVisible(R3Mesh *mesh, R3MeshFace *face, int m)
+IsFaceVisible(R3IndexedMesh *mesh, int face_index, int m)
 {
   // Check affinities
   if (!show_weak_affinities) {
     for (int i = 0; i < 3; i++) {
-      R3MeshVertex *vertex = mesh->VertexOnFace(face, i);
-      int index = mesh->VertexValue(vertex) + 0.5;      
+      int index = mesh->VertexOnFace(face_index, i);
       RNScalar affinity = (*mesh_affinities[m])[index];
       if (affinity < value_range.Min()) return 0;
     }
@@ -940,6 +956,92 @@ IsFaceVisible(R3Mesh *mesh, R3MeshFace *face, int m)
 }
 
 
+
+
+
+static unsigned int
+MortonCode(const R3Point& position, const R3Box& bbox)
+{
+  // Compute 30-bit morton code of position within bbox
+  int q[3];
+  for (int dim = 0; dim < 3; dim++) {
+    RNLength length = bbox.AxisLength(dim);
+    RNScalar t = (length > 0) ? (position[dim] - bbox[RN_LO][dim]) / length : 0;
+    q[dim] = (int) (1024 * t);
+    if (q[dim] < 0) q[dim] = 0;
+    else if (q[dim] > 1023) q[dim] = 1023;
+  }
+
+  // Interleave bits
+  unsigned int code = 0;
+  for (int bit = 9; bit >= 0; bit--) {
+    for (int dim = 0; dim < 3; dim++) {
+      code = (code << 1) | ((q[dim] >> bit) & 1);
+    }
+  }
+
+  // Return code
+  return code;
+}
+
+
+
+static void
+UpdateVertexOrder(void)
+{
+  // Count vertices
+  int nvertices = 0;
+  R3Box bbox = R3null_box;
+  for (int m = 0; m < meshes.NEntries(); m++) {
+    R3IndexedMesh *mesh = meshes.Kth(m);
+    nvertices += mesh->NVertices();
+    bbox.Union(mesh->BBox());
+  }
+
+  // Check if vertex order is uptodate (meshes do not change)
+  if ((int) vbo_vertex_indices.size() == nvertices) return;
+
+  // Sort vertices spatially
+  std::vector< std::pair<unsigned int, int> > keys;
+  keys.reserve(nvertices);
+  int offset = 0;
+  for (int m = 0; m < meshes.NEntries(); m++) {
+    R3IndexedMesh *mesh = meshes.Kth(m);
+    for (int i = 0; i < mesh->NVertices(); i++) {
+      R3Point position = mesh->VertexPosition(i);
+      keys.push_back(std::pair<unsigned int, int>(MortonCode(position, bbox), offset + i));
+    }
+    offset += mesh->NVertices();
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // Group sorted vertices into clusters, ordered progressively within each cluster
+  // (so that every prefix of a cluster is a uniform subsample)
+  static const int max_vertices_per_cluster = 4096;
+  vbo_vertex_order.resize(nvertices);
+  vbo_vertex_indices.resize(nvertices);
+  vbo_vertex_cluster_offsets.clear();
+  for (int start = 0; start < nvertices; start += max_vertices_per_cluster) {
+    int n = nvertices - start;
+    if (n > max_vertices_per_cluster) n = max_vertices_per_cluster;
+    int nbits = 0;
+    while ((1 << nbits) < n) nbits++;
+    int count = 0;
+    for (int index = 0; index < (1 << nbits); index++) {
+      int k = 0;
+      for (int b = 0; b < nbits; b++) if (index & (1 << b)) k |= 1 << (nbits - 1 - b);
+      if (k >= n) continue;
+      int global_index = keys[start + k].second;
+      vbo_vertex_order[start + count] = global_index;
+      vbo_vertex_indices[global_index] = start + count;
+      count++;
+    }
+    vbo_vertex_cluster_offsets.push_back(start);
+  }
+  vbo_vertex_cluster_offsets.push_back(nvertices);
+}
+
+
   
 static void
 UpdateVertexVBO(int color_scheme)
@@ -947,47 +1049,54 @@ UpdateVertexVBO(int color_scheme)
   // Check if VBO is uptodate
   if (vbo_nvertices > 0) return;
   
+  // Update spatial order of vertices
+  UpdateVertexOrder();
+
   // Count points
-  vbo_nvertices = 0;
-  for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes.Kth(m);
-    vbo_nvertices += mesh->NVertices();
-  }
+  vbo_nvertices = vbo_vertex_order.size();
 
   // Check point count
   if (vbo_nvertices <= 0) return;
 
-  // Allocate in-memory buffers
-  GLfloat *point_positions = new GLfloat [ 3 * vbo_nvertices ];
+  // Allocate in-memory buffers (positions are kept for occlusion culling)
+  vbo_point_positions.resize(3 * vbo_nvertices);
+  GLfloat *point_positions = &vbo_point_positions[0];
   GLfloat *point_normals = new GLfloat [ 3 * vbo_nvertices ];
   GLubyte *point_colors = new GLubyte [  3 * vbo_nvertices ];
 
-  // Fill buffers from mesh vertices
+  // Find mesh index of first vertex of each mesh
+  std::vector<int> mesh_offsets;
+  int offset = 0;
+  for (int m = 0; m < meshes.NEntries(); m++) {
+    mesh_offsets.push_back(offset);
+    offset += meshes.Kth(m)->NVertices();
+  }
+
+  // Fill buffers from mesh vertices (in spatial order)
   GLfloat *point_positionsp = point_positions;
   GLfloat *point_normalsp = point_normals;
   GLubyte *point_colorsp = point_colors;
-  for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes.Kth(m);
+  for (unsigned int j = 0; j < vbo_nvertices; j++) {
+    int global_index = vbo_vertex_order[j];
+    int m = (int) (std::upper_bound(mesh_offsets.begin(), mesh_offsets.end(), global_index) - mesh_offsets.begin()) - 1;
+    R3IndexedMesh *mesh = meshes.Kth(m);
     RNDenseMatrix *features = (m < point_features.NEntries()) ? point_features[m] : NULL;
     RNVector *affinities = (m < mesh_affinities.NEntries()) ? mesh_affinities[m] : NULL;
     RNVector *segmentation = (m < mesh_segmentations.NEntries()) ? mesh_segmentations[m] : NULL;
-    for (int i = 0; i < mesh->NVertices(); i++) {
-      R3MeshVertex *vertex = mesh->Vertex(i);
-      int index = mesh->VertexValue(vertex) + 0.5;
-      const R3Point& position = mesh->VertexPosition(vertex);
-      const R3Vector& normal = mesh->VertexNormal(vertex);
-      const RNRgb& rgb = mesh->VertexColor(vertex);
-      RNRgb color = ComputeColor(features, affinities, segmentation, index, rgb, color_scheme);
-      *(point_positionsp++) = position.X();
-      *(point_positionsp++) = position.Y();
-      *(point_positionsp++) = position.Z();
-      *(point_normalsp++) = normal.X();
-      *(point_normalsp++) = normal.Y();
-      *(point_normalsp++) = normal.Z();
-      *(point_colorsp++) = 255.0 * color.R();
-      *(point_colorsp++) = 255.0 * color.G();
-      *(point_colorsp++) = 255.0 * color.B();
-    }
+    int index = global_index - mesh_offsets[m];
+    R3Point position = mesh->VertexPosition(index);
+    R3Vector normal = mesh->VertexNormal(index);
+    RNRgb rgb = mesh->VertexColor(index);
+    RNRgb color = ComputeColor(features, affinities, segmentation, index, rgb, color_scheme);
+    *(point_positionsp++) = position.X();
+    *(point_positionsp++) = position.Y();
+    *(point_positionsp++) = position.Z();
+    *(point_normalsp++) = normal.X();
+    *(point_normalsp++) = normal.Y();
+    *(point_normalsp++) = normal.Z();
+    *(point_colorsp++) = 255.0 * color.R();
+    *(point_colorsp++) = 255.0 * color.G();
+    *(point_colorsp++) = 255.0 * color.B();
   }
   
   // Just checking
@@ -995,6 +1104,21 @@ UpdateVertexVBO(int color_scheme)
   assert(point_normalsp - point_normals == 3*vbo_nvertices);
   assert(point_colorsp - point_colors == 3*vbo_nvertices);
 
+  // Compute bounding box and average spacing of points in each cluster
+  int nclusters = (int) vbo_vertex_cluster_offsets.size() - 1;
+  vbo_vertex_cluster_bboxes.assign(nclusters, R3null_box);
+  vbo_vertex_cluster_spacings.assign(nclusters, 0.0);
+  for (int c = 0; c < nclusters; c++) {
+    R3Box& bbox = vbo_vertex_cluster_bboxes[c];
+    for (int j = vbo_vertex_cluster_offsets[c]; j < vbo_vertex_cluster_offsets[c+1]; j++) {
+      bbox.Union(R3Point(point_positions[3*j], point_positions[3*j+1], point_positions[3*j+2]));
+    }
+    int dim = bbox.ShortestAxis();
+    RNArea area = bbox.AxisLength((dim+1)%3) * bbox.AxisLength((dim+2)%3);
+    int n = vbo_vertex_cluster_offsets[c+1] - vbo_vertex_cluster_offsets[c];
+    vbo_vertex_cluster_spacings[c] = (n > 0) ? sqrt(area / n) : 0;
+  }
+
   // Generate VBO buffers (first time only)
   if (vbo_point_position_buffer == 0) glGenBuffers(1, &vbo_point_position_buffer);
   if (vbo_point_normal_buffer == 0) glGenBuffers(1, &vbo_point_normal_buffer);
@@ -1018,7 +1142,6 @@ UpdateVertexVBO(int color_scheme)
   }
 
   // Delete in-memory buffers
-  if (point_positions) delete [] point_positions;
   if (point_normals) delete [] point_normals;
   if (point_colors) delete [] point_colors;
 }
@@ -1031,16 +1154,25 @@ UpdateFaceVBO(int color_scheme)
   // Check if VBO is uptodate
   if (vbo_nfaces > 0) return;
 
-  // Count faces
-  vbo_nfaces = 0;
+  // Check vertex order
+  if (vbo_vertex_indices.empty()) return;
+
+  // Sort visible faces spatially
+  R3Box bbox = R3null_box;
+  for (int m = 0; m < meshes.NEntries(); m++) bbox.Union(meshes.Kth(m)->BBox());
+  std::vector< std::pair<unsigned int, std::pair<int, int> > > keys;
   for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes.Kth(m);
+    R3IndexedMesh *mesh = meshes.Kth(m);
     for (int i = 0; i < mesh->NFaces(); i++) {
-      R3MeshFace *face = mesh->Face(i);
-      if (!IsFaceVisible(mesh, face, m)) continue;
-      vbo_nfaces++;
+      if (!IsFaceVisible(mesh, i, m)) continue;
+      unsigned int code = MortonCode(mesh->FaceCentroid(i), bbox);
+      keys.push_back(std::pair<unsigned int, std::pair<int, int> >(code, std::pair<int, int>(m, i)));
     }
   }
+  std::sort(keys.begin(), keys.end());
+
+  // Count faces
+  vbo_nfaces = keys.size();
 
   // Check face count
   if (vbo_nfaces == 0) return;
@@ -1048,22 +1180,35 @@ UpdateFaceVBO(int color_scheme)
   // Allocate in-memory buffers
   GLint *face_index = new GLint [ 3 * vbo_nfaces ];
 
-  // Fill in-memory face buffers 
-  GLint *face_indexp = face_index;
+  // Find index of first vertex of each mesh
+  std::vector<int> mesh_offsets;
   int offset = 0;
   for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes.Kth(m);
-    for (int i = 0; i < mesh->NFaces(); i++) {
-      R3MeshFace *face = mesh->Face(i);
-      if (!IsFaceVisible(mesh, face, m)) continue;
-      for (int j = 0; j < 3; j++) {
-        R3MeshVertex *vertex = mesh->VertexOnFace(face, j);
-        int index = offset + mesh->VertexID(vertex);
-        *(face_indexp++) = index;
-      }
+    mesh_offsets.push_back(offset);
+    offset += meshes.Kth(m)->NVertices();
+  }
+
+  // Fill in-memory face buffers (in spatial order, grouped into clusters)
+  static const int max_faces_per_cluster = 2048;
+  vbo_face_cluster_offsets.clear();
+  vbo_face_cluster_bboxes.clear();
+  GLint *face_indexp = face_index;
+  for (unsigned int k = 0; k < vbo_nfaces; k++) {
+    if (k % max_faces_per_cluster == 0) {
+      vbo_face_cluster_offsets.push_back(k);
+      vbo_face_cluster_bboxes.push_back(R3null_box);
+    }
+    int m = keys[k].second.first;
+    R3IndexedMesh *mesh = meshes.Kth(m);
+    int face_index = keys[k].second.second;
+    for (int j = 0; j < 3; j++) {
+      int vertex_index = mesh->VertexOnFace(face_index, j);
+      int index = vbo_vertex_indices[mesh_offsets[m] + vertex_index];
+      *(face_indexp++) = index;
+      vbo_face_cluster_bboxes.back().Union(mesh->VertexPosition(vertex_index));
     }
-    offset += mesh->NVertices();
   }
+  vbo_face_cluster_offsets.push_back(vbo_nfaces);
   
   // Just checking
   assert(face_indexp - face_index == 3*vbo_nfaces);
@@ -1083,13 +1228,164 @@ UpdateFaceVBO(int color_scheme)
 
 
 
-static void 
-InvalidateVBO(void)
+static void
+InvalidateMeshVBO(void)
 {
   // Mark mesh VBOs as out of date
   vbo_nvertices = 0;
   vbo_nfaces = 0;
 
+  // Mark draw lists as out of date
+  draw_list_valid = 0;
+}
+
+
+
+static void
+InvalidateVBO(void)
+{
+  // Mark mesh VBOs as out of date
+  InvalidateMeshVBO();
+
+  // Mark colors of points streamed by point renderers as out of date
+  for (int i = 0; i < point_renderers.NEntries(); i++) {
+    point_renderers.Kth(i)->InvalidateColors();
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Draw list management functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+CullClusters(const std::vector<int>& offsets, const std::vector<R3Box>& bboxes,
+  const std::vector<RNLength> *spacings, std::vector<int>& counts)
+{
+  // Initialize number of elements to draw for each cluster
+  int nclusters = (int) bboxes.size();
+  counts.resize(nclusters);
+  for (int c = 0; c < nclusters; c++) counts[c] = offsets[c+1] - offsets[c];
+
+  // Cull groups of clusters (adjacent in spatial order), then clusters within groups
+  if (frustum_culling) {
+    static const int clusters_per_group = 16;
+    for (int start = 0; start < nclusters; start += clusters_per_group) {
+      int end = start + clusters_per_group;
+      if (end > nclusters) end = nclusters;
+      R3Box group_bbox = R3null_box;
+      for (int c = start; c < end; c++) group_bbox.Union(bboxes[c]);
+      int classification = draw_list_culler.FrustumClassification(group_bbox);
+      if (classification == R3_VIEW_CULLER_INSIDE) continue;
+      for (int c = start; c < end; c++) {
+        if ((classification == R3_VIEW_CULLER_OUTSIDE) ||
+            (draw_list_culler.FrustumClassification(bboxes[c]) == R3_VIEW_CULLER_OUTSIDE)) {
+          counts[c] = 0;
+        }
+      }
+    }
+  }
+
+  // Draw fewer points in clusters whose points are closer than screen space error
+  if (spacings && (screen_space_error > 0)) {
+    for (int c = 0; c < nclusters; c++) {
+      if (counts[c] == 0) continue;
+      RNScalar npixels = draw_list_culler.ProjectedLength(bboxes[c], (*spacings)[c]);
+      if (npixels >= screen_space_error) continue;
+      RNScalar fraction = (npixels * npixels) / (screen_space_error * screen_space_error);
+      counts[c] = (int) (fraction * counts[c] + 0.5);
+      if (counts[c] < 1) counts[c] = 1;
+    }
+  }
+}
+
+
+
+static void
+UpdateDrawLists(void)
+{
+  // Check if draw lists are uptodate (they are rebuilt only when camera moves)
+  if (draw_list_valid && !draw_list_culler.IsViewChanged(viewer)) return;
+  draw_list_valid = 1;
+
+  // Empty draw lists
+  draw_list_point_firsts.clear();
+  draw_list_point_counts.clear();
+  draw_list_face_counts.clear();
+  draw_list_face_offsets.clear();
+
+  // Set view for culling
+  static const int occlusion_resolution = 128;
+  draw_list_culler.SetView(viewer, (occlusion_culling) ? occlusion_resolution : 0);
+
+  // Cull clusters
+  std::vector<int> point_counts, face_counts;
+  CullClusters(vbo_vertex_cluster_offsets, vbo_vertex_cluster_bboxes, &vbo_vertex_cluster_spacings, point_counts);
+  CullClusters(vbo_face_cluster_offsets, vbo_face_cluster_bboxes, NULL, face_counts);
+
+  // Cull clusters hidden behind points
+  if (occlusion_culling) {
+    // Determine sampling rate for occluders
+    static const int max_occluder_samples = 256 * 1024;
+    int total_count = 0;
+    for (unsigned int c = 0; c < point_counts.size(); c++) total_count += point_counts[c];
+    int step = total_count / max_occluder_samples + 1;
+
+    // Insert sampled points as occluders
+    for (unsigned int c = 0; c < point_counts.size(); c++) {
+      if (point_counts[c] == 0) continue;
+      RNLength radius = sqrt((RNScalar) step) * vbo_vertex_cluster_spacings[c];
+      for (int j = vbo_vertex_cluster_offsets[c]; j < vbo_vertex_cluster_offsets[c+1]; j += step) {
+        const GLfloat *p = &vbo_point_positions[3*j];
+        draw_list_culler.InsertOccluder(R3Point(p[0], p[1], p[2]), radius);
+      }
+    }
+
+    // Build hierarchical depth buffer
+    draw_list_culler.UpdateOcclusionHierarchy();
+
+    // Remove occluded clusters
+    for (unsigned int c = 0; c < point_counts.size(); c++) {
+      if (point_counts[c] == 0) continue;
+      if (draw_list_culler.IsOccluded(vbo_vertex_cluster_bboxes[c])) point_counts[c] = 0;
+    }
+    for (unsigned int c = 0; c < face_counts.size(); c++) {
+      if (face_counts[c] == 0) continue;
+      if (draw_list_culler.IsOccluded(vbo_face_cluster_bboxes[c])) face_counts[c] = 0;
+    }
+  }
+
+  // Fill point draw list (merging adjacent clusters drawn completely)
+  for (unsigned int c = 0; c < point_counts.size(); c++) {
+    if (point_counts[c] == 0) continue;
+    GLint first = vbo_vertex_cluster_offsets[c];
+    GLsizei count = point_counts[c];
+    if (!draw_list_point_firsts.empty() &&
+        (draw_list_point_firsts.back() + draw_list_point_counts.back() == first)) {
+      draw_list_point_counts.back() += count;
+    }
+    else {
+      draw_list_point_firsts.push_back(first);
+      draw_list_point_counts.push_back(count);
+    }
+  }
+
+  // Fill face draw list (merging adjacent clusters)
+  GLsizei previous_end = -1;
+  for (unsigned int c = 0; c < face_counts.size(); c++) {
+    if (face_counts[c] == 0) continue;
+    GLsizei first = vbo_face_cluster_offsets[c];
+    GLsizei count = face_counts[c];
+    if (!draw_list_face_counts.empty() && (previous_end == first)) {
+      draw_list_face_counts.back() += 3 * count;
+    }
+    else {
+      draw_list_face_counts.push_back(3 * count);
+      draw_list_face_offsets.push_back((const GLvoid *) (3 * first * sizeof(unsigned int)));
+    }
+    previous_end = first + count;
+  }
 }
 
 
@@ -1316,7 +1612,7 @@ DrawMesh(int color_scheme)
   // Check if color scheme is different
   if (color_scheme != vbo_color_scheme) {
     vbo_color_scheme = color_scheme;
-    InvalidateVBO();
+    InvalidateMeshVBO();
   }
 
   // Update VBOs
@@ -1326,6 +1622,9 @@ DrawMesh(int color_scheme)
   // Check VBOs
   if (vbo_nvertices == 0) return;
 
+  // Update draw lists
+  UpdateDrawLists();
+
   // Set opengl modes
   glEnable(GL_LIGHTING);
   glPointSize(2.0);
@@ -1352,14 +1651,14 @@ DrawMesh(int color_scheme)
   }
 
   // Draw vertices
-  if (show_vertices) {
-    glDrawArrays(GL_POINTS, 0, vbo_nvertices);
+  if (show_vertices && !draw_list_point_firsts.empty()) {
+    glMultiDrawArrays(GL_POINTS, &draw_list_point_firsts[0], &draw_list_point_counts[0], draw_list_point_firsts.size());
   }
 
   // Draw faces
-  if (show_faces && (vbo_nfaces > 0) && (vbo_face_index_buffer > 0)) {
+  if (show_faces && (vbo_nfaces > 0) && (vbo_face_index_buffer > 0) && !draw_list_face_counts.empty()) {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo_face_index_buffer);
-    glDrawElements(GL_TRIANGLES, 3 * vbo_nfaces, GL_UNSIGNED_INT, 0);
+    glMultiDrawElements(GL_TRIANGLES, &draw_list_face_counts[0], GL_UNSIGNED_INT, &draw_list_face_offsets[0], draw_list_face_counts.size());
   }
 
   // Disable client state
@@ -1373,6 +1672,64 @@ DrawMesh(int color_scheme)
 
 
 
+static void
+ComputePointColors(int first_point_index, int npoints, unsigned char *rgb, void *data)
+{
+  // Get feature matrix index of point renderer (point renderers follow meshes)
+  R3SurfelPointRenderer *renderer = (R3SurfelPointRenderer *) data;
+  int m = meshes.NEntries() + point_renderers.EntryIndex(point_renderers.FindEntry(renderer));
+  RNDenseMatrix *features = (m < point_features.NEntries()) ? point_features[m] : NULL;
+  RNVector *affinities = (m < mesh_affinities.NEntries()) ? mesh_affinities[m] : NULL;
+  RNVector *segmentation = (m < mesh_segmentations.NEntries()) ? mesh_segmentations[m] : NULL;
+
+  // Compute colors of points
+  for (int i = 0; i < npoints; i++) {
+    int index = renderer->PointIdentifier(first_point_index + i);
+    RNRgb point_rgb = renderer->PointColor(first_point_index + i);
+    RNRgb color = ComputeColor(features, affinities, segmentation, index, point_rgb, point_renderer_color_scheme);
+    rgb[3*i+0] = 255.0 * color.R();
+    rgb[3*i+1] = 255.0 * color.G();
+    rgb[3*i+2] = 255.0 * color.B();
+  }
+}
+
+
+
+static void
+DrawPoints(int color_scheme)
+{
+  // Check display variables
+  if (!show_vertices) return;
+  if (point_renderers.IsEmpty()) return;
+
+  // Check if color scheme is different
+  if (color_scheme != point_renderer_color_scheme) {
+    point_renderer_color_scheme = color_scheme;
+    for (int i = 0; i < point_renderers.NEntries(); i++) {
+      point_renderers.Kth(i)->InvalidateColors();
+    }
+  }
+
+  // Set opengl modes
+  glEnable(GL_LIGHTING);
+  glPointSize(2.0);
+
+  // Draw points streamed by point renderers
+  RNBoolean complete = TRUE;
+  for (int i = 0; i < point_renderers.NEntries(); i++) {
+    R3SurfelPointRenderer *renderer = point_renderers.Kth(i);
+    if (!renderer->Draw(viewer)) complete = FALSE;
+  }
+
+  // Reset opengl modes
+  glPointSize(1);
+
+  // Redraw until all visible octree nodes have been streamed
+  if (!complete) glutPostRedisplay();
+}
+
+
+
 static void
 DrawQueryString()
 {
@@ -1513,9 +1870,13 @@ DrawCategoryNames()
   // Count vertices
   int vertex_count = 0;
   for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes[m];
+    R3IndexedMesh *mesh = meshes[m];
     vertex_count += mesh->NVertices();
   }
+  for (int p = 0; p < point_renderers.NEntries(); p++) {
+    R3SurfelPointRenderer *renderer = point_renderers[p];
+    vertex_count += renderer->NPoints();
+  }
 
   // Compute step to limit how many category names to draw
   int max_draw_count = 1000;
@@ -1525,14 +1886,13 @@ DrawCategoryNames()
   glDisable(GL_LIGHTING);
   void *font = RN_GRFX_BITMAP_HELVETICA_12;
   for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes[m];
+    R3IndexedMesh *mesh = meshes[m];
     if (m >= mesh_segmentations.NEntries()) break;
     RNVector *segmentation = mesh_segmentations[m];
     if (!segmentation) continue;
     for (int j = 0; j < mesh->NVertices(); j += step) {
-      R3MeshVertex *vertex = mesh->Vertex(j);
-      const R3Point& position = mesh->VertexPosition(vertex);
-      int index = mesh->VertexValue(vertex) + 0.5;
+      R3Point position = mesh->VertexPosition(j);
+      int index = j;
       if (index >= segmentation->NValues()) continue;
       int category = (*segmentation)[index] + 0.5;
       if (category >= category_names->NEntries()) continue;
@@ -1540,6 +1900,22 @@ DrawCategoryNames()
       R3DrawText(position, (*category_names)[category], font);
     }
   }
+  for (int p = 0; p < point_renderers.NEntries(); p++) {
+    R3SurfelPointRenderer *renderer = point_renderers[p];
+    int m = meshes.NEntries() + p;
+    if (m >= mesh_segmentations.NEntries()) break;
+    RNVector *segmentation = mesh_segmentations[m];
+    if (!segmentation) continue;
+    for (int j = 0; j < renderer->NPoints(); j += step) {
+      R3Point position = renderer->PointPosition(j);
+      int index = renderer->PointIdentifier(j);
+      if ((index < 0) || (index >= segmentation->NValues())) continue;
+      int category = (*segmentation)[index] + 0.5;
+      if (category >= category_names->NEntries()) continue;
+      RNLoadRgb(CategoryColor(category));
+      R3DrawText(position, (*category_names)[category], font);
+    }
+  }
 }
 
 
@@ -1588,6 +1964,35 @@ DrawAxes(void)
 
 
 
+static void
+DrawSelection(void)
+{
+  // Draw selected points
+  glDisable(GL_LIGHTING);
+  if (show_selected_points && !selected_point_positions.empty()) {
+    RNLoadRgb(1.0, 1.0, 0.0);
+    glPointSize(4);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, &selected_point_positions[0]);
+    glDrawArrays(GL_POINTS, 0, selected_point_positions.size() / 3);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPointSize(1);
+  }
+
+  // Draw lasso (just in front of near plane)
+  if (lasso_points.size() > 1) {
+    RNLoadRgb(1.0, 1.0, 0.0);
+    glBegin(GL_LINE_LOOP);
+    for (unsigned int i = 0; i < lasso_points.size(); i++) {
+      R3Ray ray = viewer.WorldRay(lasso_points[i].X(), lasso_points[i].Y());
+      R3LoadPoint(ray.Point(2 * viewer.Camera().Near()));
+    }
+    glEnd();
+  }
+}
+
+
+
 static void
 DrawSelectedPosition(void)
 {
@@ -1607,6 +2012,84 @@ DrawSelectedPosition(void)
 // Selection with cursor
 ////////////////////////////////////////////////////////////////////////
 
+static void
+UpdatePointPicker(void)
+{
+  // Empty point picker (it only references point positions, so it is cheap to rebuild)
+  point_picker.Empty();
+  point_picker_offsets.clear();
+
+  // Ignore points clipped by viewing extent
+  if (viewing_extent.IsEmpty() || R3Contains(viewing_extent, scene_extent)) point_picker.SetClipBox(R3null_box);
+  else point_picker.SetClipBox(viewing_extent);
+
+  // Insert clusters of mesh vertices (indices are positions in vertex VBO)
+  int offset = 0;
+  if (show_vertices && (vbo_point_positions.size() == 3 * vbo_vertex_order.size())) {
+    for (unsigned int c = 0; c < vbo_vertex_cluster_bboxes.size(); c++) {
+      int first = vbo_vertex_cluster_offsets[c];
+      int count = vbo_vertex_cluster_offsets[c+1] - first;
+      point_picker.InsertGroup(&vbo_point_positions[3*first], count, 3 * sizeof(GLfloat),
+        vbo_vertex_cluster_bboxes[c], R3zero_point, first);
+    }
+    offset = vbo_vertex_order.size();
+  }
+
+  // Insert octree nodes of point renderers (indices follow mesh vertices)
+  for (int i = 0; i < point_renderers.NEntries(); i++) {
+    R3SurfelPointRenderer *renderer = point_renderers.Kth(i);
+    point_picker_offsets.push_back(offset);
+    if (show_vertices) {
+      for (int j = 0; j < renderer->NNodes(); j++) {
+        int first = renderer->NodeFirstPoint(j);
+        point_picker.InsertGroup(renderer->PointPositionPtr(first), renderer->NodeNPoints(j),
+          renderer->PointPositionStride(), renderer->NodeBBox(j), renderer->Origin(), offset + first);
+      }
+    }
+    offset += renderer->NPoints();
+  }
+}
+
+
+
+static int
+PickedPointFeature(int point_index, int *feature_index, int *row_index, R3Point *position = NULL)
+{
+  // Check point index
+  if (point_index < 0) return 0;
+
+  // Check mesh vertices
+  if (point_index < (int) vbo_vertex_order.size()) {
+    int global_index = vbo_vertex_order[point_index];
+    for (int m = 0; m < meshes.NEntries(); m++) {
+      R3IndexedMesh *mesh = meshes.Kth(m);
+      if (global_index >= mesh->NVertices()) { global_index -= mesh->NVertices(); continue; }
+      *feature_index = m;
+      *row_index = global_index;
+      if (position) *position = mesh->VertexPosition(global_index);
+      return 1;
+    }
+    return 0;
+  }
+
+  // Check point renderers
+  for (int i = point_picker_offsets.size() - 1; i >= 0; i--) {
+    if (point_index < point_picker_offsets[i]) continue;
+    R3SurfelPointRenderer *renderer = point_renderers.Kth(i);
+    int index = point_index - point_picker_offsets[i];
+    if (index >= renderer->NPoints()) return 0;
+    *feature_index = meshes.NEntries() + i;
+    *row_index = renderer->PointIdentifier(index);
+    if (position) *position = renderer->PointPosition(index);
+    return 1;
+  }
+
+  // Not found
+  return 0;
+}
+
+
+
 static int
 Pick(int x, int y, R3Point *picked_position = NULL,
   R3SurfelImage **picked_image = NULL, int pick_tolerance = 10)
@@ -1615,61 +2098,74 @@ Pick(int x, int y, R3Point *picked_position = NULL,
   if (picked_position) *picked_position = R3unknown_point;
   if (picked_image) *picked_image = NULL;
 
-  // Draw everything
-  viewer.Load();
-  glClearColor(0.0, 0.0, 0.0, 1.0);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glPointSize(pick_tolerance);
-  glLineWidth(pick_tolerance);
-  EnableViewingExtent();
-  DrawMesh(PICK_COLOR);
-  DrawCameras(PICK_COLOR);
-  DisableViewingExtent();
-  glPointSize(1.0);
-  glLineWidth(1.0);
-  glFinish();
-
-  // Read color buffer at cursor position
-  unsigned char rgba[4];
-  glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
-  int r = rgba[0] & 0xFF;
-  int g = rgba[1] & 0xFF;
-  int b = rgba[2] & 0xFF;
-  int a = rgba[3] & 0xFF;
-  if ((r == 0) && (g == 0) && (b == 0)) return 0;
-
-  // Check hit type
-  if (a == CAMERA_ALPHA) {
-    if (picked_image) {
-      int scene_index = r-1;
-      if ((scene_index >= 0) && (scene_index < surfels.NEntries())) {
-        R3SurfelScene *scene = surfels.Kth(scene_index);
-        int image_index = (g << 8) | b;
-        if ((image_index >= 0) && (image_index < scene->NImages())) {
-          *picked_image = scene->Image(image_index);
-        }
+  // Get convenient variables
+  const R3Camera& camera = viewer.Camera();
+  R3Ray ray = viewer.WorldRay(x, y);
+  RNBoolean clip = !viewing_extent.IsEmpty() && !R3Contains(viewing_extent, scene_extent);
+  RNScalar best_depth = FLT_MAX;
+  R3Point best_position = R3unknown_point;
+  R3SurfelImage *best_image = NULL;
+
+  // Pick nearest point within tolerance of cursor
+  UpdatePointPicker();
+  if (point_picker.NPoints() > 0) {
+    R3Point position;
+    RNLength depth;
+    if (point_picker.PickPoint(viewer, x, y, pick_tolerance, &position, &depth) >= 0) {
+      best_depth = depth;
+      best_position = position;
+    }
+  }
+
+  // Pick nearest face intersected by ray (skipping faces clipped by viewing extent)
+  if (show_faces) {
+    for (int m = 0; m < meshes.NEntries(); m++) {
+      R3IndexedMesh *mesh = meshes.Kth(m);
+      if (mesh->NFaces() == 0) continue;
+      while (mesh_bvhs.NEntries() <= m) mesh_bvhs.Insert(NULL);
+      if (!mesh_bvhs[m]) {
+        mesh_bvhs[m] = new R3TriangleBVH();
+        mesh_bvhs[m]->InsertMesh(*mesh);
+        mesh_bvhs[m]->Build();
+      }
+      R3TriangleBVH *bvh = mesh_bvhs[m];
+      RNScalar min_t = 0;
+      for (int iteration = 0; iteration < 16; iteration++) {
+        R3Point hit_point;
+        RNScalar hit_t;
+        if (!bvh->FindIntersection(ray, NULL, NULL, &hit_point, NULL, &hit_t, min_t)) break;
+        if (clip && !R3Contains(viewing_extent, hit_point)) { min_t = hit_t + RN_EPSILON; continue; }
+        RNScalar depth = (hit_point - camera.Origin()).Dot(camera.Towards());
+        if (depth < best_depth) { best_depth = depth; best_position = hit_point; }
+        break;
       }
     }
   }
 
-  // Return position
-  if (picked_position) {
-    // Find hit position
-    GLfloat depth;
-    GLdouble p[3];
-    GLint viewport[4];
-    GLdouble modelview_matrix[16];
-    GLdouble projection_matrix[16];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    glGetDoublev(GL_MODELVIEW_MATRIX, modelview_matrix);
-    glGetDoublev(GL_PROJECTION_MATRIX, projection_matrix);
-    glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
-    gluUnProject(x, y, depth, modelview_matrix, projection_matrix, viewport, &(p[0]), &(p[1]), &(p[2]));
-    R3Point position(p[0], p[1], p[2]);
-    *picked_position = position;
+  // Pick nearest camera whose viewpoint is within tolerance of cursor
+  if (show_cameras) {
+    for (int i = 0; i < surfels.NEntries(); i++) {
+      R3SurfelScene *scene = surfels.Kth(i);
+      for (int j = 0; j < scene->NImages(); j++) {
+        R3SurfelImage *image = scene->Image(j);
+        const R3Point& viewpoint = image->Viewpoint();
+        RNScalar depth = (viewpoint - camera.Origin()).Dot(camera.Towards());
+        if ((depth <= camera.Near()) || (depth >= best_depth)) continue;
+        R2Point p = viewer.ViewportPoint(viewpoint);
+        if (R2SquaredDistance(p, R2Point(x, y)) > pick_tolerance * pick_tolerance) continue;
+        best_depth = depth;
+        best_position = viewpoint;
+        best_image = image;
+      }
+    }
   }
 
-  // Return success
+  // Check if hit anything
+  if (best_position == R3unknown_point) return 0;
+
+  // Return results
+  if (picked_position) *picked_position = best_position;
+  if (picked_image) *picked_image = best_image;
   return 1;
 }
 
@@ -1855,15 +2351,30 @@ UpdateMeshAffinities(void)
   // Update max affinity
   max_affinity = 0;
   for (int m = 0; m < meshes.NEntries(); m++) {
-    R3Mesh *mesh = meshes.Kth(m);
+    R3IndexedMesh *mesh = meshes.Kth(m);
     RNVector *affinities = mesh_affinities[m];
     if (!affinities) continue;
     for (int i = 0; i < mesh->NVertices(); i++) {
-      R3MeshVertex *vertex = mesh->Vertex(i);
-      int index = mesh->VertexValue(vertex) + 0.5;
+      RNScalar affinity = (*affinities)[i];
+      if (affinity > max_affinity) {
+        center = mesh->VertexPosition(i);
+        selected_position = center;
+        max_affinity = affinity;
+      }
+    }
+  }
+  for (int p = 0; p < point_renderers.NEntries(); p++) {
+    R3SurfelPointRenderer *renderer = point_renderers.Kth(p);
+    int m = meshes.NEntries() + p;
+    if (m >= mesh_affinities.NEntries()) break;
+    RNVector *affinities = mesh_affinities[m];
+    if (!affinities) continue;
+    for (int i = 0; i < renderer->NPoints(); i++) {
+      int index = renderer->PointIdentifier(i);
+      if ((index < 0) || (index >= affinities->NValues())) continue;
       RNScalar affinity = (*affinities)[index];
       if (affinity > max_affinity) {
-        center = mesh->VertexPosition(mesh->Vertex(i));
+        center = renderer->PointPosition(i);
         selected_position = center;
         max_affinity = affinity;
       }
@@ -1966,6 +2477,111 @@ SelectCategory(int category_index)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Point selection functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+UpdateSelectionQuery(void)
+{
+  // Remember positions of selected points for drawing
+  selected_point_positions.clear();
+
+  // Sum feature vectors of selected points
+  RNVector sum(0);
+  for (unsigned int i = 0; i < selected_points.size(); i++) {
+    int m, row;
+    R3Point position;
+    if (!PickedPointFeature(selected_points[i], &m, &row, &position)) continue;
+    selected_point_positions.push_back(position.X());
+    selected_point_positions.push_back(position.Y());
+    selected_point_positions.push_back(position.Z());
+    if (m >= point_features.NEntries()) continue;
+    RNDenseMatrix *features = point_features[m];
+    if ((row < 0) || (row >= features->NRows())) continue;
+    if (sum.NValues() == 0) sum.Reset(features->NColumns());
+    if (features->NColumns() != sum.NValues()) continue;
+    for (int j = 0; j < features->NColumns(); j++) sum[j] += (*features)[row][j];
+  }
+
+  // Use normalized average feature vector as query
+  RNScalar length = (sum.NValues() > 0) ? sum.Length() : 0;
+  if (length == 0) return;
+  query_features = sum / length;
+  char buffer[256];
+  sprintf(buffer, "[%d selected points]", (int) selected_points.size());
+  query_string = buffer;
+
+  // Update affinities to selection
+  UpdateMeshAffinities();
+}
+
+
+
+static int
+SelectPointsInLasso(void)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Find points projecting inside lasso
+  UpdatePointPicker();
+  int npoints = point_picker.FindPointsInLasso(viewer, &lasso_points[0], lasso_points.size(), selected_points);
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Selected points in lasso ...\n");
+    printf("  Time = %.4f seconds\n", start_time.Elapsed());
+    printf("  # Points = %d\n", npoints);
+    fflush(stdout);
+  }
+
+  // Update query
+  UpdateSelectionQuery();
+  return npoints;
+}
+
+
+
+static int
+SelectPointsInSphere(const R3Point& position)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Find points within selection radius
+  RNLength radius = (selection_radius > 0) ? selection_radius : 0.05 * scene_extent.DiagonalRadius();
+  UpdatePointPicker();
+  int npoints = point_picker.FindPointsInSphere(position, radius, selected_points);
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Selected points in sphere ...\n");
+    printf("  Time = %.4f seconds\n", start_time.Elapsed());
+    printf("  # Points = %d\n", npoints);
+    fflush(stdout);
+  }
+
+  // Update query
+  UpdateSelectionQuery();
+  return npoints;
+}
+
+
+
+static void
+ClearSelection(void)
+{
+  // Clear selected points and lasso
+  selected_points.clear();
+  selected_point_positions.clear();
+  lasso_points.clear();
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Utility functions
 ////////////////////////////////////////////////////////////////////////
@@ -1976,9 +2592,13 @@ ResetViewer(void)
   // Get bounding box
   scene_extent = R3null_box;
   for (int i = 0; i < meshes.NEntries(); i++) {
-    R3Mesh *mesh = meshes.Kth(i);
+    R3IndexedMesh *mesh = meshes.Kth(i);
     scene_extent.Union(mesh->BBox());
   }
+  for (int i = 0; i < point_renderers.NEntries(); i++) {
+    R3SurfelPointRenderer *renderer = point_renderers.Kth(i);
+    scene_extent.Union(renderer->BBox());
+  }
 
   // Initialize viewing center
   center = scene_extent.Centroid();
@@ -2013,6 +2633,11 @@ void GLUTStop(void)
   if (vbo_point_color_buffer > 0) glDeleteBuffers(1, &vbo_point_color_buffer);
   if (vbo_face_index_buffer > 0) glDeleteBuffers(1, &vbo_face_index_buffer);
 
+  // Delete point renderer buffers
+  for (int i = 0; i < point_renderers.NEntries(); i++) {
+    point_renderers.Kth(i)->ReleaseBuffers();
+  }
+
   // Destroy window 
   glutDestroyWindow(GLUTwindow);
 
@@ -2036,6 +2661,7 @@ void GLUTRedraw(void)
   DrawViewingExtent();
   EnableViewingExtent();
   DrawMesh(color_scheme);
+  DrawPoints(color_scheme);
   DrawCameras(color_scheme);
   DrawCategoryNames();
   DrawScene();
@@ -2044,6 +2670,7 @@ void GLUTRedraw(void)
   // Draw everything not being clipped by viewing extent
   DrawAxes();
   DrawQueryString();
+  DrawSelection();
   DrawSelectedPosition();
   DrawInsetImage(color_scheme);
 
@@ -2092,6 +2719,15 @@ void GLUTMotion(int x, int y)
   // Update mouse drag
   GLUTmouse_drag += dx*dx + dy*dy;
 
+  // Extend lasso with ctrl-left-drag
+  if (GLUTbutton[0] && (GLUTmodifiers & GLUT_ACTIVE_CTRL)) {
+    lasso_points.push_back(R2Point(x, y));
+    glutPostRedisplay();
+    GLUTmouse[0] = x;
+    GLUTmouse[1] = y;
+    return;
+  }
+
   // World in hand navigation 
   if (GLUTbutton[0]) viewer.RotateWorld(1.0, center, x, y, dx, dy);
   else if (GLUTbutton[1]) viewer.ScaleWorld(1.0, center, x, y, dx, dy);
@@ -2115,6 +2751,12 @@ void GLUTMouse(int button, int state, int x, int y)
     // Reset mouse drag
     GLUTmouse_drag = 0;
 
+    // Start lasso with ctrl-left-drag
+    lasso_points.clear();
+    if ((button == 0) && (glutGetModifiers() & GLUT_ACTIVE_CTRL)) {
+      lasso_points.push_back(R2Point(x, y));
+    }
+
     // Process thumbwheel
     if (button == 3) viewer.ScaleWorld(center, 0.9);
     else if (button == 4) viewer.ScaleWorld(center, 1.1);
@@ -2126,14 +2768,21 @@ void GLUTMouse(int button, int state, int x, int y)
     double_click = (!double_click) && (last_mouse_up_time.Elapsed() < 0.4);
     last_mouse_up_time.Read();
 
+    // Check for lasso selection
+    if (GLUTmodifiers & GLUT_ACTIVE_CTRL) {
+      if (lasso_points.size() > 2) SelectPointsInLasso();
+      lasso_points.clear();
+    }
+
     // Check for click (rather than drag)
-    if (GLUTmouse_drag < 100) {
+    else if (GLUTmouse_drag < 100) {
       // Select image or surface
       R3SurfelImage *picked_image = NULL;
       selected_position = R3unknown_point;
       if (Pick(x, y, &selected_position, &picked_image)) {
         if (picked_image) { printf("%s\n", picked_image->Name()); selected_image = picked_image; }
         else if (!surfels.IsEmpty()) selected_image = surfels[0]->FindImageByBestView(selected_position, R3zero_vector);
+        if (GLUTmodifiers & GLUT_ACTIVE_SHIFT) SelectPointsInSphere(selected_position);
         center = selected_position;
       }
     }
@@ -2308,6 +2957,11 @@ void GLUTKeyboard(unsigned char key, int x, int y)
       InvalidateVBO();
       break;
 
+    case 'S':
+    case 's':
+      show_selected_points = !show_selected_points;
+      break;
+
     case 'Y':
     case 'y':
       show_selected_position = !show_selected_position;
@@ -2368,6 +3022,7 @@ void GLUTKeyboard(unsigned char key, int x, int y)
     case 27: // ESCAPE
       // Reset everything
       value_range = default_value_range;
+      ClearSelection();
       query_string.clear();
       UpdateQueryFeatures();
       UpdateMeshAffinities();
@@ -2466,6 +3121,11 @@ ParseArgs(int argc, char **argv)
       if (!strcmp(*argv, "-v")) print_verbose = 1;
       else if (!strcmp(*argv, "-debug")) print_debug = 1;
       else if (!strcmp(*argv, "-tcp")) use_tcp = 1;
+      else if (!strcmp(*argv, "-no_frustum_culling")) frustum_culling = 0;
+      else if (!strcmp(*argv, "-occlusion_culling")) occlusion_culling = 1;
+      else if (!strcmp(*argv, "-screen_space_error")) { argc--; argv++; screen_space_error = atof(*argv); }
+      else if (!strcmp(*argv, "-point_budget")) { argc--; argv++; point_budget = atoi(*argv); }
+      else if (!strcmp(*argv, "-selection_radius")) { argc--; argv++; selection_radius = atof(*argv); }
       else if (!strcmp(*argv, "-one_feature_vector_per_object")) one_feature_vector_per_object = TRUE;
       else if (!strcmp(*argv, "-scene")) { argc--; argv++; input_scene_filename = *argv; }
       else if (!strcmp(*argv, "-category_names")) { argc--; argv++; input_category_names_filename = *argv; }
@@ -2533,7 +3193,7 @@ main(int argc, char **argv)
 
   // Read meshes
   for (int i = 0; i < input_mesh_filenames.NEntries(); i++) {
-    R3Mesh *mesh = ReadMeshFile(input_mesh_filenames[i]);
+    R3IndexedMesh *mesh = ReadMeshFile(input_mesh_filenames[i]);
     if (!mesh) exit(-1);
     meshes.Insert(mesh);
   }
@@ -2546,13 +3206,14 @@ main(int argc, char **argv)
     surfels.Insert(scene);
   }
 
-  // Create meshes from surfels
+  // Create point renderers from surfels (their features follow those of meshes)
   for (int i = 0; i < surfels.NEntries(); i++) {
     R3SurfelScene *scene = surfels.Kth(i);
     if (scene->NSurfels() == 0) continue;
-    R3Mesh *mesh = CreateMeshFromSurfels(scene);
-    if (!mesh) continue;
-    meshes.Insert(mesh);
+    R3SurfelPointRenderer *renderer = CreatePointRendererFromSurfels(scene);
+    if (!renderer) continue;
+    renderer->SetColorCallback(ComputePointColors, renderer);
+    point_renderers.Insert(renderer);
   }
 
   // Read configuration files
@@ -65,14 +65,16 @@ WriteImages(const R2PixelDatabase& pd, const char *output_image_directory)
     system(mkdir_cmd);
 
     // Write image/grid of appropriate format
-    if (format == R2_PIXEL_DATABASE_3_8_PNG_FORMAT) {
+    if ((format == R2_PIXEL_DATABASE_3_8_PNG_FORMAT) ||
+        (format == R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT)) {
       R2Image image;
       if (pd.FindImage(key, &image)) {
         image.Write(pathname);
         count++;
       }
     }
-    else if (format == R2_PIXEL_DATABASE_1_16_PNG_FORMAT) {
+    else if ((format == R2_PIXEL_DATABASE_1_16_PNG_FORMAT) ||
+             (format == R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT)) {
       R2Grid grid;
       if (pd.FindGrid(key, &grid, FALSE)) {
         grid.WriteFile(pathname);
@@ -48,6 +48,7 @@ typedef enum {
   DIVIDE_OPERATION,
   POW_OPERATION,
   BILATERAL_FILTER_OPERATION,
+  BILATERAL_GRID_FILTER_OPERATION,
   MIN_OPERATION,
   MAX_OPERATION,
   MEDIAN_OPERATION,
@@ -558,6 +559,7 @@ ApplyOperations(R2Grid *grid, Operation *operations, int noperations)
     case DIVIDE_OPERATION: grid->Divide(atof(operation->operand1)); break;
     case POW_OPERATION: grid->Pow(atof(operation->operand1)); break;
     case BILATERAL_FILTER_OPERATION: grid->BilateralFilter(atof(operation->operand1), atof(operation->operand2)); break;
+    case BILATERAL_GRID_FILTER_OPERATION: grid->BilateralGridFilter(atof(operation->operand1), atof(operation->operand2)); break;
     case MAX_OPERATION: grid->MaxFilter(atof(operation->operand1)); break;
     case MIN_OPERATION: grid->MinFilter(atof(operation->operand1)); break;
     case MEDIAN_OPERATION: grid->MedianFilter(atof(operation->operand1)); break;
@@ -878,6 +880,13 @@ ParseArgs(int argc, char **argv)
         argc--; argv++; operation->operand1 = *argv; 
         argc--; argv++; operation->operand2 = *argv; 
       }
+      else if (!strcmp(*argv, "-bilateral_grid")) {
+        assert(noperations < max_operations);
+        Operation *operation = &operations[noperations++];
+        operation->type = BILATERAL_GRID_FILTER_OPERATION;
+        argc--; argv++; operation->operand1 = *argv; 
+        argc--; argv++; operation->operand2 = *argv; 
+      }
       else if (!strcmp(*argv, "-min")) {
         assert(noperations < max_operations);
         Operation *operation = &operations[noperations++];
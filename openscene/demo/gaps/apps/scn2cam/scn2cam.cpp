@@ -83,6 +83,8 @@ static double min_score = 0;
 
 static int glut = 1;
 static int mesa = 0;
+static int rasterize = 0;
+static int nthreads = 0;
 
 
 // Informational program variables
@@ -147,6 +149,13 @@ static RNArray<Camera *> cameras;
 static R3PointSet *points = NULL;
 
 
+// Ray tracing variables
+
+static R3TriangleBVH *ray_tracer = NULL;
+static R3Rasterizer *rasterizer = NULL;
+static std::vector<R3Point> *node_samples = NULL;
+
+
 // Image types
 
 static const int NODE_INDEX_IMAGE = 0;
@@ -730,6 +739,146 @@ RenderImageWithOpenGL(R2Grid& image, const R3Camera& camera, R3Scene *scene, R3S
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Ray tracing functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+InsertNodeTriangles(R3TriangleBVH *tracer, R3Rasterizer *rasterizer, R3SceneNode *node, int& nother_shapes)
+{
+  // Insert triangles of elements (identifier is node index)
+  R3Affine transformation = node->CumulativeTransformation();
+  for (int j = 0; j < node->NElements(); j++) {
+    R3SceneElement *element = node->Element(j);
+    for (int k = 0; k < element->NShapes(); k++) {
+      R3Shape *shape = element->Shape(k);
+      if (shape->ClassID() == R3TriangleArray::CLASS_ID()) {
+        R3TriangleArray *triangles = (R3TriangleArray *) shape;
+        for (int m = 0; m < triangles->NTriangles(); m++) {
+          R3Triangle *triangle = triangles->Triangle(m);
+          R3Point p0 = triangle->V0()->Position();
+          R3Point p1 = triangle->V1()->Position();
+          R3Point p2 = triangle->V2()->Position();
+          p0.Transform(transformation);
+          p1.Transform(transformation);
+          p2.Transform(transformation);
+          if (tracer) tracer->InsertTriangle(p0, p1, p2, node->SceneIndex());
+          if (rasterizer) rasterizer->InsertTriangle(p0, p1, p2, node->SceneIndex());
+        }
+      }
+      else {
+        nother_shapes++;
+      }
+    }
+  }
+
+  // Count references (not supported by ray tracer)
+  nother_shapes += node->NReferences();
+
+  // Insert triangles of children
+  for (int i = 0; i < node->NChildren(); i++) {
+    InsertNodeTriangles(tracer, rasterizer, node->Child(i), nother_shapes);
+  }
+}
+
+
+
+static int
+CreateRayTracer(void)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Compute bounding boxes now (so that they are not updated lazily by threads)
+  scene->BBox();
+
+  // Insert triangles
+  int nother_shapes = 0;
+  R3TriangleBVH *tracer = new R3TriangleBVH();
+  InsertNodeTriangles(tracer, NULL, scene->Root(), nother_shapes);
+
+  // Check if there are shapes that the ray tracer cannot represent
+  if (nother_shapes > 0) {
+    if (print_verbose) printf("Not using ray tracer because scene has %d non-triangle shapes\n", nother_shapes);
+    delete tracer;
+    return 0;
+  }
+
+  // Build hierarchy
+  tracer->Build();
+  ray_tracer = tracer;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Created ray tracer ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Triangles = %d\n", ray_tracer->NTriangles());
+    printf("  # Nodes = %d\n", ray_tracer->NNodes());
+    printf("  # Threads = %d\n", RNNThreads());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+CreateRasterizer(void)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Insert triangles
+  int nother_shapes = 0;
+  R3Rasterizer *r = new R3Rasterizer();
+  InsertNodeTriangles(NULL, r, scene->Root(), nother_shapes);
+
+  // Check if there are shapes that the rasterizer cannot represent
+  if (nother_shapes > 0) {
+    if (print_verbose) printf("Not using rasterizer because scene has %d non-triangle shapes\n", nother_shapes);
+    delete r;
+    return 0;
+  }
+
+  // Remember rasterizer
+  rasterizer = r;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Created rasterizer ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Triangles = %d\n", rasterizer->NTriangles());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static RNBoolean
+IntersectScene(const R3Ray& ray, R3SceneNode **hit_node, RNScalar *hit_t,
+  RNScalar min_t = 0, RNScalar max_t = RN_INFINITY)
+{
+  // Use ray tracer, if there is one
+  if (ray_tracer) {
+    int hit_node_index = -1;
+    if (!ray_tracer->FindIntersection(ray, &hit_node_index, NULL, NULL, NULL, hit_t, min_t, max_t)) return FALSE;
+    if (hit_node) *hit_node = ((hit_node_index >= 0) && (hit_node_index < scene->NNodes())) ? scene->Node(hit_node_index) : NULL;
+    return TRUE;
+  }
+
+  // Otherwise, intersect scene graph
+  return scene->Intersects(ray, hit_node, NULL, NULL, NULL, NULL, hit_t, min_t, max_t);
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Raycasting image capture functions
 ////////////////////////////////////////////////////////////////////////
@@ -749,7 +898,7 @@ RenderImageWithRayCasting(R2Grid& image, const R3Camera& camera, R3Scene *scene,
     for (int ix = 0; ix < image.XResolution(); ix++) {
       R3Ray ray = viewer.WorldRay(ix, iy);
       R3SceneNode *intersection_node = NULL;
-      if (root_node->Intersects(ray, &intersection_node)) {
+      if ((root_node == scene->Root()) ? IntersectScene(ray, &intersection_node, NULL) : root_node->Intersects(ray, &intersection_node)) {
         if (intersection_node) {
           if (!selected_node || (selected_node == intersection_node)) {
             if (image_type == NODE_INDEX_IMAGE) {
@@ -764,6 +913,30 @@ RenderImageWithRayCasting(R2Grid& image, const R3Camera& camera, R3Scene *scene,
 
   
 
+////////////////////////////////////////////////////////////////////////
+// Software rasterization image capture functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+RenderImageWithRasterizer(R2Grid& image, const R3Camera& camera, R3Scene *scene, R3SceneNode *root_node, R3SceneNode *selected_node, int image_type)
+{
+  // Clear image
+  image.Clear(R2_GRID_UNKNOWN_VALUE);
+
+  // Rasterize node indices (serially, since candidate cameras are scored in parallel)
+  if (image_type != NODE_INDEX_IMAGE) return;
+  rasterizer->Rasterize(camera, image.XResolution(), image.YResolution(), NULL, &image, NULL, FALSE);
+
+  // Mask pixels of other nodes
+  if (selected_node) {
+    for (int i = 0; i < image.NEntries(); i++) {
+      if (image.GridValue(i) != selected_node->SceneIndex()) image.SetGridValue(i, R2_GRID_UNKNOWN_VALUE);
+    }
+  }
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Image capture functions
 ////////////////////////////////////////////////////////////////////////
@@ -773,6 +946,7 @@ RenderImage(R2Grid& image, const R3Camera& camera, R3Scene *scene, R3SceneNode *
 {
   // Check rendering method
   if (glut || mesa) RenderImageWithOpenGL(image, camera, scene, root_node, selected_node, image_type);
+  else if (rasterizer && (root_node == scene->Root())) RenderImageWithRasterizer(image, camera, scene, root_node, selected_node, image_type);
   else RenderImageWithRayCasting(image, camera, scene, root_node, selected_node, image_type);
 }
 
@@ -835,64 +1009,67 @@ IsObject(R3SceneNode *node)
 
 
 ////////////////////////////////////////////////////////////////////////
-// Camera scoring function
+// Camera scoring functions
 ////////////////////////////////////////////////////////////////////////
 
-static RNScalar
-ObjectCoverageScore(const R3Camera& camera, R3Scene *scene, R3SceneNode *node = NULL)
+static const std::vector<R3Point>&
+NodeSamples(R3SceneNode *node)
 {
-  // Allocate points
+  // Allocate per-node sample cache
   const int max_nsamples = 1024;
   const int target_nsamples = 512;
-  static R3Point samples[max_nsamples];
-  static int nsamples = 0;
-
-  // Check if same node as last time
-  // (NOTE: THIS WILL NOT PARALLELIZE)
-  static R3SceneNode *last_node = NULL;
-  if (last_node != node) {
-    last_node = node;
-    nsamples = 0;
-
-    // Generate samples on surface of node
-    RNArea total_area = 0;
-    for (int j = 0; j < node->NElements(); j++) {
-      R3SceneElement *element = node->Element(j);
-      for (int k = 0; k < element->NShapes(); k++) {
-        R3Shape *shape = element->Shape(k);
-        RNScalar area = shape->Area();
-        total_area += area;
-      }
+  if (!node_samples) node_samples = new std::vector<R3Point> [ scene->NNodes() ];
+  std::vector<R3Point>& samples = node_samples[node->SceneIndex()];
+  if (!samples.empty()) return samples;
+  
+  // Compute total area of node's surfaces
+  RNArea total_area = 0;
+  for (int j = 0; j < node->NElements(); j++) {
+    R3SceneElement *element = node->Element(j);
+    for (int k = 0; k < element->NShapes(); k++) {
+      R3Shape *shape = element->Shape(k);
+      RNScalar area = shape->Area();
+      total_area += area;
     }
+  }
 
-    // Check total area
-    if (RNIsZero(total_area)) return 0;
+  // Check total area
+  if (RNIsZero(total_area)) return samples;
 
-    // Generate samples 
-    for (int i = 0; i < node->NElements(); i++) {
-      R3SceneElement *element = node->Element(i);
-      for (int j = 0; j < element->NShapes(); j++) {
-        R3Shape *shape = element->Shape(j);
-        if (shape->ClassID() == R3TriangleArray::CLASS_ID()) {
-          R3TriangleArray *triangles = (R3TriangleArray *) shape;
-          for (int k = 0; k < triangles->NTriangles(); k++) {
-            R3Triangle *triangle = triangles->Triangle(k);
-            RNScalar area = triangle->Area();
-            RNScalar real_nsamples = target_nsamples * area / total_area;
-            int nsamples = (int) real_nsamples;
-            if (RNRandomScalar() < (real_nsamples - nsamples)) nsamples++;
-            for (int m = 0; m < nsamples; m++) {
-              if (nsamples >= max_nsamples) break;
-              R3Point sample = triangle->RandomPoint();
-              samples[nsamples++] = sample;
-            }
+  // Generate samples on surface of node
+  for (int i = 0; i < node->NElements(); i++) {
+    R3SceneElement *element = node->Element(i);
+    for (int j = 0; j < element->NShapes(); j++) {
+      R3Shape *shape = element->Shape(j);
+      if (shape->ClassID() == R3TriangleArray::CLASS_ID()) {
+        R3TriangleArray *triangles = (R3TriangleArray *) shape;
+        for (int k = 0; k < triangles->NTriangles(); k++) {
+          R3Triangle *triangle = triangles->Triangle(k);
+          RNScalar area = triangle->Area();
+          RNScalar real_nsamples = target_nsamples * area / total_area;
+          int triangle_nsamples = (int) real_nsamples;
+          if (RNRandomScalar() < (real_nsamples - triangle_nsamples)) triangle_nsamples++;
+          for (int m = 0; m < triangle_nsamples; m++) {
+            if ((int) samples.size() >= max_nsamples) break;
+            samples.push_back(triangle->RandomPoint());
           }
         }
       }
     }
   }
 
-  // Check number of samples
+  // Return samples
+  return samples;
+}
+
+
+
+static RNScalar
+ObjectCoverageScore(const R3Camera& camera, R3Scene *scene, R3SceneNode *node)
+{
+  // Get samples (must have been created already if called from multiple threads)
+  const std::vector<R3Point>& samples = NodeSamples(node);
+  int nsamples = (int) samples.size();
   if (nsamples == 0) return 0;
 
   // Count how many samples are visible
@@ -904,7 +1081,7 @@ ObjectCoverageScore(const R3Camera& camera, R3Scene *scene, R3SceneNode *node =
     RNScalar max_t = R3Distance(camera.Origin(), sample) + tolerance_t;
     RNScalar hit_t = FLT_MAX;
     R3SceneNode *hit_node = NULL;
-    if (scene->Intersects(ray, &hit_node, NULL, NULL, NULL, NULL, &hit_t, 0, max_t)) {
+    if (IntersectScene(ray, &hit_node, &hit_t, 0, max_t)) {
       if ((hit_node == node) && (RNIsEqual(hit_t, max_t, tolerance_t))) nvisible++;
     }
   }
@@ -972,6 +1149,69 @@ SceneCoverageScore(const R3Camera& camera, R3Scene *scene, R3SceneNode *subtree
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Camera scoring engine
+////////////////////////////////////////////////////////////////////////
+
+// Candidate cameras are generated serially (so that random numbers are
+// drawn in the same order) and then scored together, in parallel when
+// the scoring method is reentrant (ray casting or software rasterization)
+
+struct CameraCandidate {
+  CameraCandidate(const R3Camera& camera, R3SceneNode *node, int type, RNBoolean suncg = FALSE, int group = 0)
+    : camera(camera), node(node), type(type), suncg(suncg), group(group) {};
+  R3Camera camera;
+  R3SceneNode *node;
+  int type;
+  RNBoolean suncg;
+  int group;
+};
+
+static const int OBJECT_COVERAGE_SCORE = 0;
+static const int SCENE_COVERAGE_SCORE = 1;
+
+
+
+static void
+ScoreCameraCandidate(int index, int thread_index, void *data)
+{
+  // Compute score for one candidate camera
+  std::vector<CameraCandidate>& candidates = *((std::vector<CameraCandidate> *) data);
+  CameraCandidate& candidate = candidates[index];
+  if (candidate.type == OBJECT_COVERAGE_SCORE) {
+    candidate.camera.SetValue(ObjectCoverageScore(candidate.camera, scene, candidate.node));
+  }
+  else {
+    candidate.camera.SetValue(SceneCoverageScore(candidate.camera, scene, candidate.node, candidate.suncg));
+  }
+}
+
+
+
+static void
+ScoreCameraCandidates(std::vector<CameraCandidate>& candidates)
+{
+  // Check candidates
+  if (candidates.empty()) return;
+
+  // Create per-node samples serially (uses random number generator)
+  RNBoolean reentrant = TRUE;
+  for (unsigned int i = 0; i < candidates.size(); i++) {
+    if (candidates[i].type == OBJECT_COVERAGE_SCORE) NodeSamples(candidates[i].node);
+    else if (glut || mesa) reentrant = FALSE;
+  }
+
+  // Without the ray tracer, intersections go through the scene nodes,
+  // which update their bounding boxes lazily (not thread-safe)
+  if (!ray_tracer) reentrant = FALSE;
+
+  // Score candidates (OpenGL rendering requires the one context)
+  if (reentrant) RNParallelFor(candidates.size(), ScoreCameraCandidate, &candidates);
+  else for (unsigned int i = 0; i < candidates.size(); i++) ScoreCameraCandidate(i, 0, &candidates);
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Mask creation functions
 ////////////////////////////////////////////////////////////////////////
@@ -1281,13 +1521,13 @@ CreateObjectCameras(void)
   RNScalar aspect = (RNScalar) height / (RNScalar) width;
   RNAngle yfov = atan(aspect * tan(xfov));
 
-  // Create camera with close up view of each object
+  // Generate candidate cameras with close up view of each object
+  std::vector<CameraCandidate> candidates;
   for (int i = 0; i < scene->NNodes(); i++) {
     R3SceneNode *node = scene->Node(i);
     if (!node->Name()) continue;
     if (!IsObject(node)) continue;
     if (node->NElements() == 0) continue;
-    R3Camera best_camera;
 
     // Get node's centroid and radius in world coordinate system
     R3Point centroid = node->BBox().Centroid();
@@ -1325,7 +1565,7 @@ CreateObjectCameras(void)
       back.Normalize();
       R3Ray ray(centroid, back);
       RNScalar hit_t = FLT_MAX;
-      if (scene->Intersects(ray, NULL, NULL, NULL, NULL, NULL, &hit_t, min_distance, max_distance)) {
+      if (IntersectScene(ray, NULL, &hit_t, min_distance, max_distance)) {
         viewpoint = centroid + (hit_t - min_distance_from_obstacle) * back;
       }
 
@@ -1337,16 +1577,24 @@ CreateObjectCameras(void)
       R3Vector up = right % towards;
       up.Normalize();
       R3Camera camera(viewpoint, towards, up, xfov, yfov, neardist, fardist);
+      candidates.push_back(CameraCandidate(camera, node, OBJECT_COVERAGE_SCORE, FALSE, i));
+    }
+  }
 
-      // Compute score for camera
-      camera.SetValue(ObjectCoverageScore(camera, scene, node));
+  // Compute scores for all candidate cameras
+  ScoreCameraCandidates(candidates);
+
+  // Insert best camera for each object
+  unsigned int k = 0;
+  while (k < candidates.size()) {
+    // Find best camera among candidates for the same object
+    R3SceneNode *node = candidates[k].node;
+    R3Camera best_camera;
+    for ( ; (k < candidates.size()) && (candidates[k].node == node); k++) {
+      const R3Camera& camera = candidates[k].camera;
       if (camera.Value() == 0) continue;
       if (camera.Value() < min_score) continue;
-                            
-      // Remember best camera
-      if (camera.Value() > best_camera.Value()) {
-        best_camera = camera;
-      }
+      if (camera.Value() > best_camera.Value()) best_camera = camera;
     }
 
     // Insert best camera
@@ -1405,12 +1653,10 @@ CreateRoomCameras(void)
     }
 
     // Sample directions
+    std::vector<CameraCandidate> candidates;
     int nangles = (int) (RN_TWO_PI / angle_sampling + 0.5);
     RNScalar angle_spacing = (nangles > 1) ? RN_TWO_PI / nangles : RN_TWO_PI;
     for (int j = 0; j < nangles; j++) {
-      // Choose one camera for each direction in each room
-      R3Camera best_camera;
-
       // Sample positions
       for (RNScalar x = room_bbox.Min()[dim0]; x < room_bbox.Max()[dim0]; x += position_sampling) {
         for (RNScalar y = room_bbox.Min()[dim1]; y < room_bbox.Max()[dim1]; y += position_sampling) {
@@ -1452,17 +1698,24 @@ CreateRoomCameras(void)
           R3Vector up = right % towards;
           up.Normalize();
           R3Camera camera(viewpoint, towards, up, xfov, yfov, neardist, fardist);
+          candidates.push_back(CameraCandidate(camera, room_node, SCENE_COVERAGE_SCORE, TRUE, j));
+        }
+      }
+    }
 
-          // Compute score for camera
-          camera.SetValue(SceneCoverageScore(camera, scene, room_node, TRUE));
-          if (camera.Value() == 0) continue;
-          if (camera.Value() < min_score) continue;
+    // Compute scores for all candidate cameras in room
+    ScoreCameraCandidates(candidates);
 
-          // Remember best camera
-          if (camera.Value() > best_camera.Value()) {
-            best_camera = camera;
-          }
-        }
+    // Choose one camera for each direction in each room
+    for (int j = 0; j < nangles; j++) {
+      // Find best camera for direction
+      R3Camera best_camera;
+      for (unsigned int k = 0; k < candidates.size(); k++) {
+        if (candidates[k].group != j) continue;
+        const R3Camera& camera = candidates[k].camera;
+        if (camera.Value() == 0) continue;
+        if (camera.Value() < min_score) continue;
+        if (camera.Value() > best_camera.Value()) best_camera = camera;
       }
 
       // Insert best camera for direction in room
@@ -1618,11 +1871,9 @@ CreateInteriorCameras(void)
   int ny = (int) (bbox.AxisLength(dim1) / position_sampling) + 1;
   RNScalar dx = bbox.AxisLength(dim0) / nx;
   RNScalar dy = bbox.AxisLength(dim1) / ny;
+  std::vector<CameraCandidate> candidates;
   for (int ix = 0; ix < nx; ix++) {
     for (int iy = 0; iy < ny; iy++) {
-      // Choose one camera for each grid position
-      R3Camera best_camera;
-
       // Get coordinates
       RNScalar x = bbox.Min()[dim0] + ix * dx;
       RNScalar y = bbox.Min()[dim1] + iy * dy;
@@ -1658,27 +1909,36 @@ CreateInteriorCameras(void)
         R3Vector up = right % towards;
         up.Normalize();
         R3Camera camera(viewpoint, towards, up, xfov, yfov, neardist, fardist);
+        candidates.push_back(CameraCandidate(camera, NULL, SCENE_COVERAGE_SCORE, FALSE, ix*ny + iy));
+      }
+    }
+  }
 
-        // Compute score for camera
-        camera.SetValue(SceneCoverageScore(camera, scene));
-        if (camera.Value() == 0) continue;
-        if (camera.Value() < min_score) continue;
+  // Compute scores for all candidate cameras
+  ScoreCameraCandidates(candidates);
 
-        // Remember best camera
-        if (camera.Value() > best_camera.Value()) {
-          best_camera = camera;
-        }
-      }
+  // Insert best camera for each grid position
+  unsigned int k = 0;
+  while (k < candidates.size()) {
+    // Find best camera among candidates at same grid position
+    int group = candidates[k].group;
+    R3Camera best_camera;
+    for ( ; (k < candidates.size()) && (candidates[k].group == group); k++) {
+      const R3Camera& camera = candidates[k].camera;
+      if (camera.Value() == 0) continue;
+      if (camera.Value() < min_score) continue;
+      if (camera.Value() > best_camera.Value()) best_camera = camera;
+    }
 
-      // Insert best camera for direction
-      if (best_camera.Value() > 0) {
-        if (print_debug) printf("INTERIOR %d %d : %g\n", ix, iy, best_camera.Value());
-        char name[1024];
-        sprintf(name, "C_%d_%d", ix, iy);
-        Camera *camera = new Camera(best_camera, name);
-        cameras.Insert(camera);
-        camera_count++;
-      }
+    // Insert best camera for grid position
+    if (best_camera.Value() > 0) {
+      int ix = group / ny, iy = group % ny;
+      if (print_debug) printf("INTERIOR %d %d : %g\n", ix, iy, best_camera.Value());
+      char name[1024];
+      sprintf(name, "C_%d_%d", ix, iy);
+      Camera *camera = new Camera(best_camera, name);
+      cameras.Insert(camera);
+      camera_count++;
     }
   }
         
@@ -1715,6 +1975,7 @@ CreateSurfaceCameras(void)
   R3Kdtree<Camera *> kdtree(bbox, CameraPosition);
   
   // Sample positions on surface
+  std::vector<CameraCandidate> candidates;
   for (int i = 0; i < scene->NNodes(); i++) {
     R3SceneNode *node = scene->Node(i);
     if (node->NChildren() > 0) continue;
@@ -1745,7 +2006,7 @@ CreateSurfaceCameras(void)
               R3Ray ray(position, -towards);
               RNScalar hit_t = FLT_MAX;
               RNLength surface_distance = min_surface_distance + RNRandomScalar() * (max_surface_distance - min_surface_distance);
-              if (0 || scene->Intersects(ray, NULL, NULL, NULL, NULL, NULL, &hit_t, RN_EPSILON, surface_distance)) {
+              if (0 || IntersectScene(ray, NULL, &hit_t, RN_EPSILON, surface_distance)) {
                 if (0.9*hit_t < surface_distance) surface_distance = 0.9*hit_t;
                 if (surface_distance < min_surface_distance) continue;
               }
@@ -1757,35 +2018,41 @@ CreateSurfaceCameras(void)
               R3Vector up = right % towards;
               up.Normalize();
               R3Camera c(viewpoint, towards, up, xfov, yfov, neardist, fardist);
-              
-              // Compute score for camera
-              c.SetValue(SceneCoverageScore(c, scene));
-              if (c.Value() <= 0) continue;
-              if (c.Value() < min_score) continue;
-
-              // Create new camera
-              char name[1024];
-              sprintf(name, "C_%d", triangle_count);
-              Camera *camera = new Camera(c, name);
-              if (!camera) continue;
-
-              // Check if overlapping with any previous camera
-              if (kdtree.FindAny(camera, 0.0, position_sampling, IsDifferentCameraOrientation, NULL)) {
-                delete camera;
-                continue;
-              }
-              
-              // Insert camera 
-              if (print_debug) printf("SURFACE %d : %g\n", triangle_count, c.Value());
-              kdtree.InsertPoint(camera);
-              cameras.Insert(camera);
-              camera_count++;
+              candidates.push_back(CameraCandidate(c, NULL, SCENE_COVERAGE_SCORE, FALSE, triangle_count));
             }
           }
         }
       }
     }
   }
+
+  // Compute scores for all candidate cameras
+  ScoreCameraCandidates(candidates);
+
+  // Insert cameras in order of creation
+  for (unsigned int k = 0; k < candidates.size(); k++) {
+    const R3Camera& c = candidates[k].camera;
+    if (c.Value() <= 0) continue;
+    if (c.Value() < min_score) continue;
+
+    // Create new camera
+    char name[1024];
+    sprintf(name, "C_%d", candidates[k].group);
+    Camera *camera = new Camera(c, name);
+    if (!camera) continue;
+
+    // Check if overlapping with any previous camera
+    if (kdtree.FindAny(camera, 0.0, position_sampling, IsDifferentCameraOrientation, NULL)) {
+      delete camera;
+      continue;
+    }
+              
+    // Insert camera 
+    if (print_debug) printf("SURFACE %d : %g\n", candidates[k].group, c.Value());
+    kdtree.InsertPoint(camera);
+    cameras.Insert(camera);
+    camera_count++;
+  }
         
   // Print statistics
   if (print_verbose) {
@@ -1888,13 +2155,14 @@ CreateLookAtCameras(void)
   RNScalar yfov = atan(aspect * tan(xfov));
   RNScalar downward_angle = RN_PI/3.0;
   RNScalar downward_angle_cosine = cos(downward_angle);
+  int nangles = RN_TWO_PI / angle_sampling + 1;
 
   // Consider every point in pointset
+  std::vector<CameraCandidate> candidates;
   for (int i = 0; i < points->NPoints(); i++) {
     R3Point lookat_position = points->PointPosition(i);
   
     // Sample angles rotated around gravity dimension
-    int nangles = RN_TWO_PI / angle_sampling + 1;
     for (int j = 0; j < nangles; j++) {
       // Determine view direction
       RNAngle angle = j * (RN_TWO_PI / nangles);
@@ -1913,26 +2181,32 @@ CreateLookAtCameras(void)
       // Ensure lookat position is not occluded
       RNScalar hit_t = FLT_MAX;
       R3Ray ray(lookat_position, -towards);
-      if (scene->Intersects(ray, NULL, NULL, NULL, NULL, NULL, &hit_t, 0.1, max_surface_distance)) {
+      if (IntersectScene(ray, NULL, &hit_t, 0.1, max_surface_distance)) {
         if (hit_t < min_surface_distance) continue;
         viewpoint = lookat_position - hit_t * towards;
       }
 
-      // Create camera
+      // Create candidate camera
       R3Camera camera(viewpoint, towards, up, xfov, yfov, neardist, fardist);
+      candidates.push_back(CameraCandidate(camera, NULL, SCENE_COVERAGE_SCORE, TRUE, i*nangles + j));
+    }
+  }
 
-      // Compute score for camera
-      camera.SetValue(SceneCoverageScore(camera, scene, NULL, TRUE));
-      if (camera.Value() == 0) continue;
-      if (camera.Value() < min_score) continue;
+  // Compute scores for all candidate cameras
+  ScoreCameraCandidates(candidates);
 
-      // Insert camera
-      char camera_name[1024];
-      sprintf(camera_name, "%s#%d_%d", "LookAt", i, j);
-      Camera *insertable_camera = new Camera(camera, camera_name);
-      cameras.Insert(insertable_camera);
-      camera_count++;
-    }
+  // Insert cameras
+  for (unsigned int k = 0; k < candidates.size(); k++) {
+    const R3Camera& camera = candidates[k].camera;
+    if (camera.Value() == 0) continue;
+    if (camera.Value() < min_score) continue;
+    int i = candidates[k].group / nangles;
+    int j = candidates[k].group % nangles;
+    char camera_name[1024];
+    sprintf(camera_name, "%s#%d_%d", "LookAt", i, j);
+    Camera *insertable_camera = new Camera(camera, camera_name);
+    cameras.Insert(insertable_camera);
+    camera_count++;
   }
 
   // Print statistics
@@ -2055,6 +2329,12 @@ SortCameras(void)
 static void
 CreateAndWriteCameras(void)
 {
+  // Create ray tracer for scoring cameras
+  CreateRayTracer();
+
+  // Create software rasterizer for scoring cameras
+  if (rasterize) CreateRasterizer();
+
   // Create cameras
   if (create_object_cameras) CreateObjectCameras();
   if (create_interior_cameras) CreateInteriorCameras();
@@ -2078,6 +2358,14 @@ CreateAndWriteCameras(void)
   // Write cameras
   WriteCameras();
 
+  // Delete scoring data
+  if (node_samples) delete [] node_samples;
+  if (ray_tracer) delete ray_tracer;
+  if (rasterizer) delete rasterizer;
+  node_samples = NULL;
+  ray_tracer = NULL;
+  rasterizer = NULL;
+
   // Exit program
   exit(0);
 }
@@ -2182,9 +2470,11 @@ ParseArgs(int argc, char **argv)
     if ((*argv)[0] == '-') {
       if (!strcmp(*argv, "-v")) print_verbose = 1;
       else if (!strcmp(*argv, "-debug")) print_debug = 1;
-      else if (!strcmp(*argv, "-glut")) { mesa = 0; glut = 1; }
-      else if (!strcmp(*argv, "-mesa")) { mesa = 1; glut = 0; }
-      else if (!strcmp(*argv, "-raycast")) { mesa = 0; glut = 0; }
+      else if (!strcmp(*argv, "-glut")) { mesa = 0; glut = 1; rasterize = 0; }
+      else if (!strcmp(*argv, "-mesa")) { mesa = 1; glut = 0; rasterize = 0; }
+      else if (!strcmp(*argv, "-raycast")) { mesa = 0; glut = 0; rasterize = 0; }
+      else if (!strcmp(*argv, "-rasterize")) { mesa = 0; glut = 0; rasterize = 1; }
+      else if (!strcmp(*argv, "-threads")) { argc--; argv++; nthreads = atoi(*argv); }
       else if (!strcmp(*argv, "-yup")) { gravity_dimension = RN_Y; }
       else if (!strcmp(*argv, "-zup")) { gravity_dimension = RN_Z; }
       else if (!strcmp(*argv, "-categories")) { argc--; argv++; input_categories_filename = *argv; }
@@ -2285,6 +2575,9 @@ int main(int argc, char **argv)
   // Parse program arguments
   if (!ParseArgs(argc, argv)) exit(-1);
 
+  // Set number of threads for scoring cameras
+  if (nthreads > 0) RNSetNThreads(nthreads);
+
   // Read scene
   if (!ReadScene(input_scene_filename)) exit(-1);
 
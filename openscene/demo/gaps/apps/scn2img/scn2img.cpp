@@ -63,6 +63,7 @@ static double max_vertex_spacing = 0;
 static int headlight = 0;
 static int glut = 1;
 static int mesa = 0;
+static int rasterize = 0;
 
 
 // Image-specific program variables
@@ -118,6 +119,20 @@ static RNArray<R3Camera *> cameras;
 static int next_image_index = 0;
 
 
+// Software rasterization variables
+
+struct RasterizedTriangle {
+  R3SceneNode *node;
+  R3Material *material;
+  R3Vector normal;
+  int face_index;
+};
+
+static R3Rasterizer *rasterizer = NULL;
+static R3Rasterizer *room_rasterizer = NULL;
+static std::vector<RasterizedTriangle> rasterized_triangles;
+
+
 
 ////////////////////////////////////////////////////////////////////////
 // Input/output functions
@@ -393,6 +408,80 @@ ComputeBoundaryImage(const R2Grid& depth_image, const R2Grid& node_image,
 
 
 
+static int
+ComputeKinectImage(const R3Camera& camera, const R2Grid& depth_image, const R2Grid& ndotv_image,
+  const R2Grid& material_image, R2Grid& kinect_image)
+{
+  // Get convenient variables for stereo baseline checks
+  double ixc = 0.5 * width;  // x coordinate on center of image in image coordinates
+  double ixr = 0.5 * width;  // x coordinate on right side of image in image coordinates
+  double vxr = tan(camera.XFOV()); // x coordinate on right side of image on view plane at d=1m in camera coordinates
+  
+  // Fill kinect image
+  kinect_image.Clear(0);
+  for (int ix = 0; ix < width; ix++) {
+    for (int iy = 0; iy < height; iy++) {
+      // Get/check depth
+      RNScalar depth = depth_image.GridValue(ix, iy);
+      if (depth == 0) continue;
+      if ((kinect_min_depth > 0) && (depth < kinect_min_depth)) continue;
+      if ((kinect_max_depth > 0) && (depth > kinect_max_depth)) continue;
+
+      // Get/check material
+      if (kinect_min_reflection > 0) {
+        // Get/check angle
+        RNScalar ndotv = ndotv_image.GridValue(ix, iy);
+        if (ndotv < kinect_min_reflection) continue; 
+
+        // Get/check material
+        RNScalar material_index_value = material_image.GridValue(ix, iy);
+        int material_index = (int) (material_index_value - 1.0 + 0.5);
+        if (material_index < 0) continue;
+        if (material_index >= scene->NMaterials()) continue; 
+        const R3Material *material = scene->Material(material_index);
+        const R3Brdf *brdf = material->Brdf();
+        if (!brdf) continue;
+        RNScalar kd = brdf->Diffuse().Luminance();
+        RNScalar ks = brdf->Specular().Luminance();
+        RNScalar kt = brdf->Transmission().Luminance();
+        if (kd < 0.05) kd = 0.05; // this is a hack to compensate for black kd in materials
+        RNScalar sum = kd + ks + kt;
+        if (RNIsNegativeOrZero(sum)) continue;
+        if (sum > 1) kd = 1.0 - ks - kt;  // this is a hack to compensate for nonphysical BRDFs
+
+        // Get/check reflection of light back to camera
+        RNScalar reflection = kd / sum;  // this is a hack to compensate for bad kd in materials
+        if (reflection * ndotv < kinect_min_reflection) continue;
+      }
+
+
+      // Set depth value
+      kinect_image.SetGridValue(ix, iy, depth);
+
+      // Check whether projection of point towards projector camera (baseline to the right) is occluded
+      if (kinect_stereo_baseline > 0) {
+        double x = depth * vxr * (ix - ixc) / ixr; // x coordinate in camera coordinates
+        R2Halfspace h(R2Point(x, depth), R2Point(kinect_stereo_baseline, 0));
+        for (int ix2 = ix+1; ix2 < width; ix2++) {
+          RNScalar depth2 = depth_image.GridValue(ix2, iy);
+          if (depth2 > 0) {
+            double x2 = depth2 * vxr * (ix2 - ixc) / ixr; 
+            if (R2Contains(h, R2Point(x2, depth2))) {
+              kinect_image.SetGridValue(ix, iy, 0);
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Image capture functions
 ////////////////////////////////////////////////////////////////////////
@@ -1137,69 +1226,9 @@ void Redraw(void)
     DrawSceneWithOpenGL(*camera, scene, MATERIAL_COLOR_SCHEME);
     if (!CaptureInteger(material_image)) return;
 
-    // Get convenient variables for stereo baseline checks
-    double ixc = 0.5 * width;  // x coordinate on center of image in image coordinates
-    double ixr = 0.5 * width;  // x coordinate on right side of image in image coordinates
-    double vxr = tan(camera->XFOV()); // x coordinate on right side of image on view plane at d=1m in camera coordinates
-    
     // Create kinect image
     R2Grid kinect_image(width, height);
-    for (int ix = 0; ix < width; ix++) {
-      for (int iy = 0; iy < height; iy++) {
-        // Get/check depth
-        RNScalar depth = depth_image.GridValue(ix, iy);
-        if (depth == 0) continue;
-        if ((kinect_min_depth > 0) && (depth < kinect_min_depth)) continue;
-        if ((kinect_max_depth > 0) && (depth > kinect_max_depth)) continue;
-
-        // Get/check material
-        if (kinect_min_reflection > 0) {
-          // Get/check angle
-          RNScalar ndotv = ndotv_image.GridValue(ix, iy);
-          if (ndotv < kinect_min_reflection) continue; 
-
-          // Get/check material
-          RNScalar material_index_value = material_image.GridValue(ix, iy);
-          int material_index = (int) (material_index_value - 1.0 + 0.5);
-          if (material_index < 0) continue;
-          if (material_index >= scene->NMaterials()) continue; 
-          const R3Material *material = scene->Material(material_index);
-          const R3Brdf *brdf = material->Brdf();
-          if (!brdf) continue;
-          RNScalar kd = brdf->Diffuse().Luminance();
-          RNScalar ks = brdf->Specular().Luminance();
-          RNScalar kt = brdf->Transmission().Luminance();
-          if (kd < 0.05) kd = 0.05; // this is a hack to compensate for black kd in materials
-          RNScalar sum = kd + ks + kt;
-          if (RNIsNegativeOrZero(sum)) continue;
-          if (sum > 1) kd = 1.0 - ks - kt;  // this is a hack to compensate for nonphysical BRDFs
-
-          // Get/check reflection of light back to camera
-          RNScalar reflection = kd / sum;  // this is a hack to compensate for bad kd in materials
-          if (reflection * ndotv < kinect_min_reflection) continue;
-        }
-
-
-        // Set depth value
-        kinect_image.SetGridValue(ix, iy, depth);
-
-        // Check whether projection of point towards projector camera (baseline to the right) is occluded
-        if (kinect_stereo_baseline > 0) {
-          double x = depth * vxr * (ix - ixc) / ixr; // x coordinate in camera coordinates
-          R2Halfspace h(R2Point(x, depth), R2Point(kinect_stereo_baseline, 0));
-          for (int ix2 = ix+1; ix2 < width; ix2++) {
-            RNScalar depth2 = depth_image.GridValue(ix2, iy);
-            if (depth2 > 0) {
-              double x2 = depth2 * vxr * (ix2 - ixc) / ixr; 
-              if (R2Contains(h, R2Point(x2, depth2))) {
-                kinect_image.SetGridValue(ix, iy, 0);
-                break;
-              }
-            }
-          }
-        }
-      }
-    }
+    ComputeKinectImage(*camera, depth_image, ndotv_image, material_image, kinect_image);
 
     // Write kinect image
     kinect_image.Multiply(1000);
@@ -1241,7 +1270,10 @@ RenderImagesWithGlut(const char *output_image_directory)
   // Create output directory
   char cmd[1024];
   sprintf(cmd, "mkdir -p %s", output_image_directory);
-  system(cmd);
+  if (system(cmd) != 0) {
+    RNFail("Unable to create output directory %s\n", output_image_directory);
+    return 0;
+  }
 
   // Open window
   int argc = 1;
@@ -1289,7 +1321,10 @@ RenderImagesWithMesa(const char *output_image_directory)
   // Create output directory
   char cmd[1024];
   sprintf(cmd, "mkdir -p %s", output_image_directory);
-  system(cmd);
+  if (system(cmd) != 0) {
+    RNFail("Unable to create output directory %s\n", output_image_directory);
+    return 0;
+  }
 
   // Create mesa context
   OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 32, 0, 0, NULL);
@@ -1492,7 +1527,10 @@ RenderImagesWithRaycasting(const char *output_image_directory)
   // Create output directory
   char cmd[1024];
   sprintf(cmd, "mkdir -p %s", output_image_directory);
-  system(cmd);
+  if (system(cmd) != 0) {
+    RNFail("Unable to create output directory %s\n", output_image_directory);
+    return 0;
+  }
 
   // Raycast images for every camera
   for (int i = 0; i < cameras.NEntries(); i++) {
@@ -1513,6 +1551,515 @@ RenderImagesWithRaycasting(const char *output_image_directory)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Software rasterization
+////////////////////////////////////////////////////////////////////////
+
+static int
+InsertNodeTriangles(R3SceneNode *node, RNBoolean inside_object)
+{
+  // Check if node is an object (omitted from room images)
+  if (node->Name() && !strncmp(node->Name(), "Object#", 7)) inside_object = TRUE;
+
+  // Insert triangles of elements (identifier is index into rasterized triangles)
+  int nskipped_shapes = 0;
+  int face_index = 0;
+  R3Affine transformation = node->CumulativeTransformation();
+  for (int i = 0; i < node->NElements(); i++) {
+    R3SceneElement *element = node->Element(i);
+    for (int j = 0; j < element->NShapes(); j++) {
+      R3Shape *shape = element->Shape(j);
+      if (shape->ClassID() != R3TriangleArray::CLASS_ID()) { nskipped_shapes++; continue; }
+      R3TriangleArray *triangles = (R3TriangleArray *) shape;
+      for (int k = 0; k < triangles->NTriangles(); k++) {
+        R3Triangle *triangle = triangles->Triangle(k);
+
+        // Remember attributes of triangle
+        RasterizedTriangle t;
+        t.node = node;
+        t.material = element->Material();
+        t.normal = triangle->Normal();
+        t.normal.Transform(transformation);
+        t.normal.Normalize();
+        t.face_index = face_index++;
+        int identifier = (int) rasterized_triangles.size();
+        rasterized_triangles.push_back(t);
+
+        // Compute world positions and colors of vertices
+        R3Point p[3];
+        RNRgb c[3];
+        for (int m = 0; m < 3; m++) {
+          R3TriangleVertex *vertex = triangle->Vertex(m);
+          p[m] = vertex->Position();
+          p[m].Transform(transformation);
+          c[m] = (vertex->HasColor()) ? vertex->Color() : RNwhite_rgb;
+        }
+
+        // Insert triangle into rasterizers
+        if (capture_vrgb_images) rasterizer->InsertTriangle(p[0], p[1], p[2], c[0], c[1], c[2], identifier);
+        else rasterizer->InsertTriangle(p[0], p[1], p[2], identifier);
+        if (room_rasterizer && !inside_object) room_rasterizer->InsertTriangle(p[0], p[1], p[2], identifier);
+      }
+    }
+  }
+
+  // Insert triangles of children
+  for (int i = 0; i < node->NChildren(); i++) {
+    nskipped_shapes += InsertNodeTriangles(node->Child(i), inside_object);
+  }
+
+  // Return number of shapes that are not triangle arrays (and were not inserted)
+  return nskipped_shapes;
+}
+
+
+
+static int
+CreateRasterizers(void)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Create rasterizers
+  rasterizer = new R3Rasterizer();
+  if (capture_room_surface_images || capture_room_boundary_images) room_rasterizer = new R3Rasterizer();
+
+  // Insert triangles
+  int nskipped_shapes = InsertNodeTriangles(scene->Root(), FALSE);
+  if (nskipped_shapes > 0) {
+    RNWarning("%d shapes that are not triangle arrays are omitted from rasterized images\n", nskipped_shapes);
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Created rasterizers ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Triangles = %d\n", rasterizer->NTriangles());
+    printf("  # Threads = %d\n", RNNThreads());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static const RasterizedTriangle *
+RasterizedPixel(const R3Camera& camera, const R2Grid& depth_image, const R2Grid& triangle_image,
+  int ix, int iy, R3Point *position = NULL, R3Vector *normal = NULL)
+{
+  // Get triangle visible at pixel
+  RNScalar triangle_value = triangle_image.GridValue(ix, iy);
+  if (triangle_value < 0) return NULL;
+  int triangle_index = (int) (triangle_value + 0.5);
+  if (triangle_index >= (int) rasterized_triangles.size()) return NULL;
+  const RasterizedTriangle *triangle = &rasterized_triangles[triangle_index];
+
+  // Compute world position of pixel
+  RNScalar depth = depth_image.GridValue(ix, iy);
+  RNScalar dx = tan(camera.XFOV()) * (ix + 0.5 - 0.5 * width) / (0.5 * width);
+  RNScalar dy = tan(camera.YFOV()) * (iy + 0.5 - 0.5 * height) / (0.5 * height);
+  R3Point p = camera.Origin() + depth * (camera.Towards() + dx * camera.Right() + dy * camera.Up());
+  if (position) *position = p;
+
+  // Compute normal facing camera
+  if (normal) {
+    *normal = triangle->normal;
+    if (normal->Dot(camera.Origin() - p) < 0) normal->Flip();
+  }
+
+  // Return triangle
+  return triangle;
+}
+
+
+
+static void
+ComputeRasterizedImage(const R3Camera& camera, const R2Grid& depth_image, const R2Grid& triangle_image,
+  int color_scheme, R2Grid& image)
+{
+  // Fill image with values computed like the ones drawn with OpenGL
+  RNScalar ground_y = (color_scheme == HEIGHT_COLOR_SCHEME) ? EstimateGroundY(camera, scene) : 0;
+  image.Clear(0);
+  for (int iy = 0; iy < height; iy++) {
+    for (int ix = 0; ix < width; ix++) {
+      // Get triangle, position, and normal
+      R3Point position;
+      R3Vector normal;
+      const RasterizedTriangle *triangle = RasterizedPixel(camera, depth_image, triangle_image, ix, iy, &position, &normal);
+      if (!triangle) continue;
+      R3SceneNode *node = triangle->node;
+
+      // Compute value
+      RNScalar value = 0;
+      if (color_scheme == DEPTH_COLOR_SCHEME) {
+        value = depth_image.GridValue(ix, iy);
+      }
+      else if (color_scheme == HEIGHT_COLOR_SCHEME) {
+        value = 10000.0 * (position.Y() - ground_y);
+        if (value < 0) value = 0;
+        else if (value > 65535) value = 65535;
+      }
+      else if (color_scheme == ANGLE_COLOR_SCHEME) {
+        value = (int) (65535 * (RN_PI - acos(normal.Y())) / RN_PI);
+      }
+      else if ((color_scheme == XNORMAL_COLOR_SCHEME) || (color_scheme == YNORMAL_COLOR_SCHEME) || (color_scheme == ZNORMAL_COLOR_SCHEME)) {
+        value = (int) (65535 * (0.5*normal[color_scheme - XNORMAL_COLOR_SCHEME] + 0.5));
+      }
+      else if (color_scheme == NDOTV_COLOR_SCHEME) {
+        R3Vector v = camera.Origin() - position; v.Normalize();
+        value = 65535 * fabs(normal.Dot(v));
+      }
+      else if (color_scheme == MATERIAL_COLOR_SCHEME) {
+        value = (triangle->material) ? triangle->material->SceneIndex() + 1 : 0;
+      }
+      else if (color_scheme == NODE_COLOR_SCHEME) {
+        value = node->SceneIndex() + 1;
+      }
+      else if (color_scheme == CATEGORY_COLOR_SCHEME) {
+        const char *model_index = NULL;
+        R3SceneNode *ancestor = node;
+        while (!model_index && ancestor) { model_index = ancestor->Info("index"); ancestor = ancestor->Parent(); }
+        if (model_index) value = atoi(model_index);
+      }
+      else if (color_scheme == ROOM_SURFACE_COLOR_SCHEME) {
+        if (!node->Name()) value = 0;
+        else if (!strncmp(node->Name(), "Wall#", 5)) value = 1;
+        else if (!strncmp(node->Name(), "WallInside#", 11)) value = 1;
+        else if (!strncmp(node->Name(), "WallOutside#", 12)) value = 1;
+        else if (!strncmp(node->Name(), "Ceiling#", 8)) value = 2;
+        else if (!strncmp(node->Name(), "Floor#", 6)) value = 3;
+      }
+
+      // Set value
+      image.SetGridValue(ix, iy, value);
+    }
+  }
+}
+
+
+
+static void
+ComputeRasterizedImage(const R3Camera& camera, const R2Grid& depth_image, const R2Grid& triangle_image,
+  int color_scheme, R2Image& image)
+{
+  // Fill image with colors computed like the ones drawn with OpenGL (without textures)
+  for (int iy = 0; iy < height; iy++) {
+    for (int ix = 0; ix < width; ix++) {
+      // Get triangle, position, and normal
+      R3Point position;
+      R3Vector normal;
+      const RasterizedTriangle *triangle = RasterizedPixel(camera, depth_image, triangle_image, ix, iy, &position, &normal);
+      if (!triangle) {
+        if (color_scheme != FACE_COLOR_SCHEME) image.SetPixelRGB(ix, iy, background);
+        else image.SetPixelRGB(ix, iy, RNblack_rgb);
+        continue;
+      }
+
+      // Get brdf
+      const R3Brdf *brdf = (triangle->material) ? triangle->material->Brdf() : NULL;
+      if (!brdf) brdf = &R3default_brdf;
+
+      // Set color
+      if (color_scheme == RGB_COLOR_SCHEME) {
+        // Shade with headlight
+        R3Vector v = camera.Origin() - position; v.Normalize();
+        RNRgb color = brdf->Emission() + brdf->Ambient() * 0.2 + brdf->Diffuse() * fabs(normal.Dot(v));
+        image.SetPixelRGB(ix, iy, color);
+      }
+      else if (color_scheme == ALBEDO_COLOR_SCHEME) {
+        image.SetPixelRGB(ix, iy, brdf->Diffuse());
+      }
+      else if (color_scheme == BRDF_COLOR_SCHEME) {
+        RNScalar kd = brdf->Diffuse().Luminance();
+        RNScalar ks = brdf->Specular().Luminance();
+        RNScalar kt = brdf->Transmission().Luminance();
+        image.SetPixelRGB(ix, iy, RNRgb(kd, ks, kt));
+      }
+      else if (color_scheme == FACE_COLOR_SCHEME) {
+        int value = triangle->face_index + 1;
+        unsigned char pixel[4];
+        pixel[0] = (value >> 16) & 0xFF;
+        pixel[1] = (value >>  8) & 0xFF;
+        pixel[2] = (value      ) & 0xFF;
+        pixel[3] = 0xFF;
+        image.SetPixel(ix, iy, pixel);
+      }
+    }
+  }
+}
+
+
+
+static int
+RenderImagesWithRasterizer(const R3Camera& camera, const char *output_image_directory, int image_index)
+{
+  // Print debug message
+  if (print_debug) {
+    printf("  Rasterizing %06d ...\n", image_index);
+    fflush(stdout);
+  }
+
+  // Some useful variables
+  char name[64];
+  sprintf(name, "%06d", image_index);
+  char output_image_filename[1024];
+  R2Grid image(width, height);
+
+  // Rasterize visible triangles
+  R2Grid depth_image(width, height);
+  R2Grid triangle_image(width, height);
+  R2Image vrgb_image(width, height, 3);
+  triangle_image.Clear(-1);
+  if (capture_vrgb_images) {
+    for (int iy = 0; iy < height; iy++) {
+      for (int ix = 0; ix < width; ix++) {
+        vrgb_image.SetPixelRGB(ix, iy, background);
+      }
+    }
+  }
+  if (!rasterizer->Rasterize(camera, width, height, &depth_image, &triangle_image,
+    (capture_vrgb_images) ? &vrgb_image : NULL)) return 0;
+
+  // Write depth image
+  if (capture_depth_images) {
+    image = depth_image;
+    image.Multiply(1000);
+    image.Threshold(65535, R2_GRID_KEEP_VALUE, 0);
+    sprintf(output_image_filename, "%s/%s_depth.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write height image
+  if (capture_height_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, HEIGHT_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_height.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write angle image
+  if (capture_angle_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, ANGLE_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_angle.pfm", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write ndotv image
+  if (capture_ndotv_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, NDOTV_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_ndotv.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write albedo image
+  if (capture_albedo_images) {
+    R2Image albedo_image(width, height, 3);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, ALBEDO_COLOR_SCHEME, albedo_image);
+    sprintf(output_image_filename, "%s/%s_albedo.jpg", output_image_directory, name);
+    albedo_image.Write(output_image_filename);
+  }
+
+  // Write brdf image
+  if (capture_brdf_images) {
+    R2Image brdf_image(width, height, 3);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, BRDF_COLOR_SCHEME, brdf_image);
+    sprintf(output_image_filename, "%s/%s_brdf.jpg", output_image_directory, name);
+    brdf_image.Write(output_image_filename);
+  }
+
+  // Write material image
+  if (capture_material_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, MATERIAL_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_material.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write face image
+  if (capture_face_images) {
+    R2Image face_image(width, height, 3);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, FACE_COLOR_SCHEME, face_image);
+    sprintf(output_image_filename, "%s/%s_face.png", output_image_directory, name);
+    face_image.Write(output_image_filename);
+  }
+
+  // Write node image
+  if (capture_node_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, NODE_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_node.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write category image
+  if (capture_category_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, CATEGORY_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_category.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write room surface and room boundary images
+  if (room_rasterizer) {
+    // Rasterize visible triangles, omitting objects
+    R2Grid room_depth_image(width, height);
+    R2Grid room_triangle_image(width, height);
+    room_triangle_image.Clear(-1);
+    if (!room_rasterizer->Rasterize(camera, width, height, &room_depth_image, &room_triangle_image)) return 0;
+
+    // Write room surface images
+    if (capture_room_surface_images) {
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, ROOM_SURFACE_COLOR_SCHEME, image);
+      sprintf(output_image_filename, "%s/%s_room_surface.png", output_image_directory, name);
+      image.WriteFile(output_image_filename);
+      image = room_depth_image;
+      image.Multiply(1000);
+      image.Threshold(65535, R2_GRID_KEEP_VALUE, 0);
+      sprintf(output_image_filename, "%s/%s_room_surface_depth.png", output_image_directory, name);
+      image.WriteFile(output_image_filename);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, XNORMAL_COLOR_SCHEME, image);
+      sprintf(output_image_filename, "%s/%s_room_surface_xnormal.png", output_image_directory, name);
+      image.WriteFile(output_image_filename);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, YNORMAL_COLOR_SCHEME, image);
+      sprintf(output_image_filename, "%s/%s_room_surface_ynormal.png", output_image_directory, name);
+      image.WriteFile(output_image_filename);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, ZNORMAL_COLOR_SCHEME, image);
+      sprintf(output_image_filename, "%s/%s_room_surface_znormal.png", output_image_directory, name);
+      image.WriteFile(output_image_filename);
+    }
+
+    // Write room boundary image
+    if (capture_room_boundary_images) {
+      R2Grid node_image(width, height);
+      R2Grid xnormal_image(width, height), ynormal_image(width, height), znormal_image(width, height);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, NODE_COLOR_SCHEME, node_image);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, XNORMAL_COLOR_SCHEME, xnormal_image);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, YNORMAL_COLOR_SCHEME, ynormal_image);
+      ComputeRasterizedImage(camera, room_depth_image, room_triangle_image, ZNORMAL_COLOR_SCHEME, znormal_image);
+      xnormal_image.Multiply(1.0/65535.0); xnormal_image.Subtract(0.5); xnormal_image.Multiply(2.0); 
+      ynormal_image.Multiply(1.0/65535.0); ynormal_image.Subtract(0.5); ynormal_image.Multiply(2.0); 
+      znormal_image.Multiply(1.0/65535.0); znormal_image.Subtract(0.5); znormal_image.Multiply(2.0); 
+      if (ComputeBoundaryImage(room_depth_image, node_image, xnormal_image, ynormal_image, znormal_image, image)) {
+        sprintf(output_image_filename, "%s/%s_room_boundary.png", output_image_directory, name);
+        image.WriteFile(output_image_filename);
+      }
+    }
+  }
+
+  // Write vertex color image
+  if (capture_vrgb_images) {
+    sprintf(output_image_filename, "%s/%s_vrgb.png", output_image_directory, name);
+    vrgb_image.Write(output_image_filename);
+  }
+
+  // Write normal images
+  if (capture_normal_images) {
+    ComputeRasterizedImage(camera, depth_image, triangle_image, XNORMAL_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_xnormal.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, YNORMAL_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_ynormal.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, ZNORMAL_COLOR_SCHEME, image);
+    sprintf(output_image_filename, "%s/%s_znormal.png", output_image_directory, name);
+    image.WriteFile(output_image_filename);
+  }
+
+  // Write boundary image
+  if (capture_boundary_images) {
+    R2Grid node_image(width, height);
+    R2Grid xnormal_image(width, height), ynormal_image(width, height), znormal_image(width, height);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, NODE_COLOR_SCHEME, node_image);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, XNORMAL_COLOR_SCHEME, xnormal_image);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, YNORMAL_COLOR_SCHEME, ynormal_image);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, ZNORMAL_COLOR_SCHEME, znormal_image);
+    xnormal_image.Multiply(1.0/65535.0); xnormal_image.Subtract(0.5); xnormal_image.Multiply(2.0); 
+    ynormal_image.Multiply(1.0/65535.0); ynormal_image.Subtract(0.5); ynormal_image.Multiply(2.0); 
+    znormal_image.Multiply(1.0/65535.0); znormal_image.Subtract(0.5); znormal_image.Multiply(2.0); 
+    if (ComputeBoundaryImage(depth_image, node_image, xnormal_image, ynormal_image, znormal_image, image)) {
+      sprintf(output_image_filename, "%s/%s_boundary.png", output_image_directory, name);
+      image.WriteFile(output_image_filename);
+    }
+  }
+
+  // Write simulated kinect depth image
+  if (capture_kinect_images) {
+    // Compute depth, ndotv, and material images
+    R2Grid noisy_depth_image(depth_image);
+    R2Grid ndotv_image(width, height);
+    R2Grid material_image(width, height);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, NDOTV_COLOR_SCHEME, ndotv_image);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, MATERIAL_COLOR_SCHEME, material_image);
+    ndotv_image.Multiply(1.0/65535.0);
+
+    // Add noise
+    noisy_depth_image.AddNoise(kinect_noise_fraction);
+    ndotv_image.AddNoise(kinect_noise_fraction);
+
+    // Create kinect image
+    R2Grid kinect_image(width, height);
+    ComputeKinectImage(camera, noisy_depth_image, ndotv_image, material_image, kinect_image);
+
+    // Write kinect image
+    kinect_image.Multiply(1000);
+    sprintf(output_image_filename, "%s/%s_kinect.png", output_image_directory, name);
+    kinect_image.WriteFile(output_image_filename);
+  }
+
+  // Write color image
+  if (capture_color_images) {
+    R2Image color_image(width, height, 3);
+    ComputeRasterizedImage(camera, depth_image, triangle_image, RGB_COLOR_SCHEME, color_image);
+    sprintf(output_image_filename, "%s/%s_color.jpg", output_image_directory, name);
+    color_image.Write(output_image_filename);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+RenderImagesWithRasterizer(const char *output_image_directory)
+{
+  // Statistics variables
+  static RNTime start_time;
+  start_time.Read(); 
+  if (print_verbose) {
+    printf("Rendering images with RASTERIZER to %s\n", output_image_directory);
+    fflush(stdout);
+  }
+  
+  // Create output directory
+  char cmd[1024];
+  sprintf(cmd, "mkdir -p %s", output_image_directory);
+  if (system(cmd) != 0) {
+    RNFail("Unable to create output directory %s\n", output_image_directory);
+    return 0;
+  }
+
+  // Create rasterizers
+  if (!CreateRasterizers()) return 0;
+
+  // Rasterize images for every camera
+  for (int i = 0; i < cameras.NEntries(); i++) {
+    R3Camera *camera = cameras.Kth(i);
+    if (!RenderImagesWithRasterizer(*camera, output_image_directory, i)) return 0;
+  }
+
+  // Print message
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", cameras.NEntries());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 static int
 RenderImages(const char *output_image_directory)
 {
@@ -1522,6 +2069,7 @@ RenderImages(const char *output_image_directory)
   // Render images
   if (glut) { if (!RenderImagesWithGlut(output_image_directory)) exit(-1); }
   else if (mesa) { if (!RenderImagesWithMesa(output_image_directory)) exit(-1); }
+  else if (rasterize) { if (!RenderImagesWithRasterizer(output_image_directory)) exit(-1); }
   else { if (!RenderImagesWithRaycasting(output_image_directory)) exit(-1); }
 
   // Return success
@@ -1546,9 +2094,10 @@ ParseArgs(int argc, char **argv)
     if ((*argv)[0] == '-') {
       if (!strcmp(*argv, "-v")) print_verbose = 1;
       else if (!strcmp(*argv, "-debug")) print_debug = 1;
-      else if (!strcmp(*argv, "-glut")) { mesa = 0; glut = 1; }
-      else if (!strcmp(*argv, "-mesa")) { mesa = 1; glut = 0; }
-      else if (!strcmp(*argv, "-raycast")) { mesa = 0; glut = 0; }
+      else if (!strcmp(*argv, "-glut")) { mesa = 0; glut = 1; rasterize = 0; }
+      else if (!strcmp(*argv, "-mesa")) { mesa = 1; glut = 0; rasterize = 0; }
+      else if (!strcmp(*argv, "-raycast")) { mesa = 0; glut = 0; rasterize = 0; }
+      else if (!strcmp(*argv, "-rasterize")) { mesa = 0; glut = 0; rasterize = 1; }
       else if (!strcmp(*argv, "-lights")) { argc--; argv++; input_lights_name = *argv; }
       else if (!strcmp(*argv, "-output_nodes")) { argc--; argv++; output_nodes_filename = *argv; }
       else if (!strcmp(*argv, "-capture_color_images")) { capture_images = capture_color_images = 1; }
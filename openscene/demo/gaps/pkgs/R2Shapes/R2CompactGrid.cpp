@@ -0,0 +1,640 @@
+// Source file for GAPS compact grid class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// NOTE:
+// A compact grid stores the same samples as an R2Grid, but with
+// float32, float16, uint16, or uint8 values rather than RNScalar.
+// Integer values v represent value_offset + value_scale * v, and
+// R2_GRID_UNKNOWN_VALUE is stored as 0 in them (as in PNG files).
+// Float values are stored directly (R2_GRID_UNKNOWN_VALUE is exact).
+////////////////////////////////////////////////////////////////////////
+
+
+
+// Usage directives
+
+#define RN_USE_PNG
+
+#ifdef RN_NO_PNG
+#undef RN_USE_PNG
+#endif
+
+
+
+// Include files
+
+#include "R2Shapes.h"
+#include <vector>
+
+#ifdef RN_USE_PNG
+# include "png/png.h"
+#endif
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Value conversion functions
+////////////////////////////////////////////////////////////////////////
+
+// Number of values converted by each parallel task
+#define RN_GRID_VALUE_CHUNK_SIZE 65536
+
+
+
+struct RNGridValueConversionData {
+  const RNScalar *values;
+  RNScalar *decoded_values;
+  const void *encoded_data;
+  void *data;
+  int nvalues;
+  int value_type;
+  RNScalar value_scale;
+  RNScalar value_offset;
+};
+
+
+
+int
+RNGridValueTypeSize(int value_type)
+{
+  // Return number of bytes per value
+  switch (value_type) {
+  case RN_GRID_FLOAT32_VALUE_TYPE: return 4;
+  case RN_GRID_FLOAT16_VALUE_TYPE: return 2;
+  case RN_GRID_UINT16_VALUE_TYPE: return 2;
+  case RN_GRID_UINT8_VALUE_TYPE: return 1;
+  }
+  RNAbort("Invalid grid value type: %d", value_type);
+  return 0;
+}
+
+
+
+void
+RNEncodeGridValue(RNScalar value, void *data, int index,
+  int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Store value at index of data
+  if (value_type == RN_GRID_FLOAT32_VALUE_TYPE) {
+    ((float *) data)[index] = (float) value;
+  }
+  else if (value_type == RN_GRID_FLOAT16_VALUE_TYPE) {
+    ((unsigned short *) data)[index] = RNFloatToHalf((float) value);
+  }
+  else {
+    // Quantize value (unknown values are stored as zero)
+    RNScalar max_code = (value_type == RN_GRID_UINT16_VALUE_TYPE) ? 65535 : 255;
+    RNScalar code = 0;
+    if ((value != R2_GRID_UNKNOWN_VALUE) && (value_scale != 0)) {
+      code = floor((value - value_offset) / value_scale + 0.5);
+      if (code < 0) code = 0;
+      else if (code > max_code) code = max_code;
+    }
+    if (value_type == RN_GRID_UINT16_VALUE_TYPE) ((unsigned short *) data)[index] = (unsigned short) code;
+    else ((unsigned char *) data)[index] = (unsigned char) code;
+  }
+}
+
+
+
+RNScalar
+RNDecodeGridValue(const void *data, int index,
+  int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Return value at index of data
+  switch (value_type) {
+  case RN_GRID_FLOAT32_VALUE_TYPE: return ((const float *) data)[index];
+  case RN_GRID_FLOAT16_VALUE_TYPE: return RNHalfToFloat(((const unsigned short *) data)[index]);
+  case RN_GRID_UINT16_VALUE_TYPE: return value_offset + value_scale * ((const unsigned short *) data)[index];
+  case RN_GRID_UINT8_VALUE_TYPE: return value_offset + value_scale * ((const unsigned char *) data)[index];
+  }
+  return 0;
+}
+
+
+
+static void
+EncodeValueChunk(int chunk_index, int thread_index, void *ptr)
+{
+  // Get chunk of values
+  RNGridValueConversionData *data = (RNGridValueConversionData *) ptr;
+  int start = chunk_index * RN_GRID_VALUE_CHUNK_SIZE;
+  int end = start + RN_GRID_VALUE_CHUNK_SIZE;
+  if (end > data->nvalues) end = data->nvalues;
+  const RNScalar *values = data->values;
+
+  // Encode values
+  if (data->value_type == RN_GRID_FLOAT32_VALUE_TYPE) {
+    float *encoded = (float *) data->data;
+    for (int i = start; i < end; i++) encoded[i] = (float) values[i];
+  }
+  else if (data->value_type == RN_GRID_FLOAT16_VALUE_TYPE) {
+    unsigned short *encoded = (unsigned short *) data->data;
+    for (int i = start; i < end; i++) encoded[i] = RNFloatToHalf((float) values[i]);
+  }
+  else {
+    for (int i = start; i < end; i++) {
+      RNEncodeGridValue(values[i], data->data, i, data->value_type, data->value_scale, data->value_offset);
+    }
+  }
+}
+
+
+
+static void
+DecodeValueChunk(int chunk_index, int thread_index, void *ptr)
+{
+  // Get chunk of values
+  RNGridValueConversionData *data = (RNGridValueConversionData *) ptr;
+  int start = chunk_index * RN_GRID_VALUE_CHUNK_SIZE;
+  int end = start + RN_GRID_VALUE_CHUNK_SIZE;
+  if (end > data->nvalues) end = data->nvalues;
+  RNScalar *values = data->decoded_values;
+  RNScalar scale = data->value_scale;
+  RNScalar offset = data->value_offset;
+
+  // Decode values
+  if (data->value_type == RN_GRID_FLOAT32_VALUE_TYPE) {
+    const float *encoded = (const float *) data->encoded_data;
+    for (int i = start; i < end; i++) values[i] = encoded[i];
+  }
+  else if (data->value_type == RN_GRID_FLOAT16_VALUE_TYPE) {
+    const unsigned short *encoded = (const unsigned short *) data->encoded_data;
+    for (int i = start; i < end; i++) values[i] = RNHalfToFloat(encoded[i]);
+  }
+  else if (data->value_type == RN_GRID_UINT16_VALUE_TYPE) {
+    const unsigned short *encoded = (const unsigned short *) data->encoded_data;
+    for (int i = start; i < end; i++) values[i] = offset + scale * encoded[i];
+  }
+  else {
+    const unsigned char *encoded = (const unsigned char *) data->encoded_data;
+    for (int i = start; i < end; i++) values[i] = offset + scale * encoded[i];
+  }
+}
+
+
+
+void
+RNEncodeGridValues(const RNScalar *values, int nvalues, void *data,
+  int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Encode values in parallel
+  RNGridValueConversionData conversion;
+  conversion.values = values;
+  conversion.decoded_values = NULL;
+  conversion.encoded_data = NULL;
+  conversion.data = data;
+  conversion.nvalues = nvalues;
+  conversion.value_type = value_type;
+  conversion.value_scale = value_scale;
+  conversion.value_offset = value_offset;
+  int nchunks = (nvalues + RN_GRID_VALUE_CHUNK_SIZE - 1) / RN_GRID_VALUE_CHUNK_SIZE;
+  RNParallelFor(nchunks, EncodeValueChunk, &conversion);
+}
+
+
+
+void
+RNDecodeGridValues(const void *data, int nvalues, RNScalar *values,
+  int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Decode values in parallel
+  RNGridValueConversionData conversion;
+  conversion.values = NULL;
+  conversion.decoded_values = values;
+  conversion.encoded_data = data;
+  conversion.data = NULL;
+  conversion.nvalues = nvalues;
+  conversion.value_type = value_type;
+  conversion.value_scale = value_scale;
+  conversion.value_offset = value_offset;
+  int nchunks = (nvalues + RN_GRID_VALUE_CHUNK_SIZE - 1) / RN_GRID_VALUE_CHUNK_SIZE;
+  RNParallelFor(nchunks, DecodeValueChunk, &conversion);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R2CompactGrid::
+R2CompactGrid(int xresolution, int yresolution, int value_type, RNScalar value_scale, RNScalar value_offset)
+  : world_to_grid_transform(R2identity_affine),
+    grid_data(NULL),
+    grid_size(0),
+    value_type(RN_GRID_FLOAT32_VALUE_TYPE)
+{
+  // Allocate zero values
+  Reset(xresolution, yresolution, value_type, value_scale, value_offset);
+  if (grid_size > 0) memset(grid_data, 0, MemoryUsage());
+}
+
+
+
+R2CompactGrid::
+R2CompactGrid(const R2Grid& grid, int value_type, RNScalar value_scale, RNScalar value_offset)
+  : world_to_grid_transform(R2identity_affine),
+    grid_data(NULL),
+    grid_size(0),
+    value_type(RN_GRID_FLOAT32_VALUE_TYPE)
+{
+  // Encode grid values
+  SetGrid(grid, value_type, value_scale, value_offset);
+}
+
+
+
+R2CompactGrid::
+R2CompactGrid(const R2CompactGrid& grid)
+  : world_to_grid_transform(R2identity_affine),
+    grid_data(NULL),
+    grid_size(0),
+    value_type(RN_GRID_FLOAT32_VALUE_TYPE)
+{
+  // Copy grid
+  *this = grid;
+}
+
+
+
+R2CompactGrid::
+~R2CompactGrid(void)
+{
+  // Deallocate memory for grid values
+  if (grid_data) delete [] grid_data;
+}
+
+
+
+void R2CompactGrid::
+Reset(int xresolution, int yresolution, int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Check value type
+  assert((value_type >= 0) && (value_type < RN_GRID_NUM_VALUE_TYPES));
+
+  // Reallocate values if size changed
+  int size = xresolution * yresolution;
+  if ((size != grid_size) || (value_type != this->value_type) || !grid_data) {
+    if (grid_data) delete [] grid_data;
+    grid_data = (size > 0) ? new unsigned char [ (size_t) size * RNGridValueTypeSize(value_type) ] : NULL;
+  }
+
+  // Set grid variables
+  grid_resolution[0] = xresolution;
+  grid_resolution[1] = yresolution;
+  grid_size = size;
+  this->value_type = value_type;
+  this->value_scale = value_scale;
+  this->value_offset = value_offset;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Access/manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+RNScalar R2CompactGrid::
+GridValue(int index) const
+{
+  // Return value at grid index
+  assert((index >= 0) && (index < grid_size));
+  return RNDecodeGridValue(grid_data, index, value_type, value_scale, value_offset);
+}
+
+
+
+void R2CompactGrid::
+SetGridValue(int index, RNScalar value)
+{
+  // Set value at grid index
+  assert((index >= 0) && (index < grid_size));
+  RNEncodeGridValue(value, grid_data, index, value_type, value_scale, value_offset);
+}
+
+
+
+void R2CompactGrid::
+SetWorldToGridTransformation(const R2Affine& affine)
+{
+  // Set transformation from world coordinates to grid coordinates
+  world_to_grid_transform = affine;
+}
+
+
+
+R2CompactGrid& R2CompactGrid::
+operator=(const R2CompactGrid& grid)
+{
+  // Copy grid values
+  Reset(grid.grid_resolution[0], grid.grid_resolution[1], grid.value_type, grid.value_scale, grid.value_offset);
+  if (grid_size > 0) memcpy(grid_data, grid.grid_data, MemoryUsage());
+  world_to_grid_transform = grid.world_to_grid_transform;
+  return *this;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Conversion functions
+////////////////////////////////////////////////////////////////////////
+
+void R2CompactGrid::
+SetGrid(const R2Grid& grid, int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Encode grid values
+  Reset(grid.XResolution(), grid.YResolution(), value_type, value_scale, value_offset);
+  RNEncodeGridValues(grid.GridValues(), grid_size, grid_data, value_type, value_scale, value_offset);
+  world_to_grid_transform = grid.WorldToGridTransformation();
+}
+
+
+
+void R2CompactGrid::
+GetGrid(R2Grid& grid) const
+{
+  // Allocate grid values
+  if ((grid.grid_resolution[0] != grid_resolution[0]) || (grid.grid_resolution[1] != grid_resolution[1])) {
+    if (grid.grid_values) delete [] grid.grid_values;
+    grid.grid_values = (grid_size > 0) ? new RNScalar [ grid_size ] : NULL;
+    grid.grid_resolution[0] = grid_resolution[0];
+    grid.grid_resolution[1] = grid_resolution[1];
+    grid.grid_row_size = grid_resolution[0];
+    grid.grid_size = grid_size;
+  }
+
+  // Decode grid values
+  RNDecodeGridValues(grid_data, grid_size, grid.grid_values, value_type, value_scale, value_offset);
+  grid.SetWorldToGridTransformation(world_to_grid_transform);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// File reading/writing functions
+////////////////////////////////////////////////////////////////////////
+
+int R2CompactGrid::
+ReadFile(const char *filename)
+{
+  // Parse input filename extension
+  const char *input_extension;
+  if (!(input_extension = strrchr(filename, '.'))) {
+    RNFail("Input file has no extension (e.g., .pfm).\n");
+    return 0;
+  }
+
+  // Read file of appropriate type
+  if (!strncmp(input_extension, ".pfm", 4)) return ReadPFMFile(filename);
+  else if (!strncmp(input_extension, ".png", 4)) return ReadPNGFile(filename);
+
+  // Read other file types via R2Grid
+  R2Grid grid;
+  if (!grid.ReadFile(filename)) return 0;
+  SetGrid(grid, RN_GRID_FLOAT32_VALUE_TYPE);
+  return 1;
+}
+
+
+
+int R2CompactGrid::
+WriteFile(const char *filename) const
+{
+  // Parse output filename extension
+  const char *output_extension;
+  if (!(output_extension = strrchr(filename, '.'))) {
+    RNFail("Output file has no extension (e.g., .pfm).\n");
+    return 0;
+  }
+
+  // Write file of appropriate type
+  if (!strncmp(output_extension, ".pfm", 4)) return WritePFMFile(filename);
+  else if (!strncmp(output_extension, ".png", 4)) return WritePNGFile(filename);
+
+  // Write other file types via R2Grid
+  R2Grid grid;
+  GetGrid(grid);
+  return grid.WriteFile(filename);
+}
+
+
+
+int R2CompactGrid::
+ReadPFMFile(const char *filename)
+{
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    RNFail("Unable to open image: %s\n", filename);
+    return 0;
+  }
+
+  // Read header
+  int width, height;
+  float endian;
+  if ((fscanf(fp, "Pf %d %d %f", &width, &height, &endian) != 3) || (fgetc(fp) == EOF) ||
+      (width < 0) || (height < 0)) {
+    RNFail("Bad header in %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Read values directly into float32 storage
+  Reset(width, height, RN_GRID_FLOAT32_VALUE_TYPE, 1, 0);
+  world_to_grid_transform = R2identity_affine;
+  if (fread(grid_data, sizeof(float), grid_size, fp) != (size_t) grid_size) {
+    RNFail("Unable to read pixels from %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2CompactGrid::
+WritePFMFile(const char *filename) const
+{
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open pfm image file %s", filename);
+    return 0;
+  }
+
+  // Write header
+  fprintf(fp, "Pf\n");
+  fprintf(fp, "%d %d\n", grid_resolution[0], grid_resolution[1]);
+  fprintf(fp, "-1.0\n");
+
+  // Write values (converting to float32 if necessary)
+  std::vector<float> converted;
+  const float *values = (const float *) grid_data;
+  if (value_type != RN_GRID_FLOAT32_VALUE_TYPE) {
+    converted.resize(grid_size);
+    for (int i = 0; i < grid_size; i++) converted[i] = GridValue(i);
+    values = (grid_size > 0) ? &converted[0] : NULL;
+  }
+  if (fwrite(values, sizeof(float), grid_size, fp) != (size_t) grid_size) {
+    RNFail("Unable to write grid values to file %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2CompactGrid::
+ReadPNGFile(const char *filename)
+{
+#ifdef RN_USE_PNG
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    RNFail("Unable to open PNG file %s\n", filename);
+    return 0;
+  }
+
+  // Create and initialize the png_struct
+  png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (png_ptr == NULL) {
+    fclose(fp);
+    return 0;
+  }
+
+  // Allocate/initialize the memory for image information
+  png_infop info_ptr = png_create_info_struct(png_ptr);
+  if (info_ptr == NULL) {
+    png_destroy_read_struct(&png_ptr, NULL, NULL);
+    fclose(fp);
+    return 0;
+  }
+
+  // Read the png info
+  png_init_io(png_ptr, fp);
+  png_read_info(png_ptr, info_ptr);
+  png_byte color_type = png_get_color_type(png_ptr, info_ptr);
+  png_byte depth = png_get_bit_depth(png_ptr, info_ptr);
+  int width = png_get_image_width(png_ptr, info_ptr);
+  int height = png_get_image_height(png_ptr, info_ptr);
+
+  // Read other than 8 and 16 bit gray images via R2Grid
+  if ((color_type != PNG_COLOR_TYPE_GRAY) || ((depth != 8) && (depth != 16))) {
+    png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+    fclose(fp);
+    R2Grid grid;
+    if (!grid.ReadPNGFile(filename)) return 0;
+    SetGrid(grid, RN_GRID_FLOAT32_VALUE_TYPE);
+    return 1;
+  }
+
+  // Read pixels directly into uint8 or uint16 storage (PNG rows are top to bottom)
+  if (depth == 16) png_set_swap(png_ptr);
+  Reset(width, height, (depth == 16) ? RN_GRID_UINT16_VALUE_TYPE : RN_GRID_UINT8_VALUE_TYPE, 1, 0);
+  world_to_grid_transform = R2identity_affine;
+  int row_size = width * (depth / 8);
+  png_bytep *row_pointers = (png_bytep *) png_malloc(png_ptr, height * sizeof(png_bytep));
+  for (int i = 0; i < height; i++) row_pointers[i] = &grid_data[(size_t) (height - i - 1) * row_size];
+  png_read_image(png_ptr, row_pointers);
+  png_read_end(png_ptr, info_ptr);
+
+  // Clean up
+  png_free(png_ptr, row_pointers);
+  png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+  fclose(fp);
+
+  // Return success
+  return 1;
+#else
+  RNFail("PNG not supported");
+  return 0;
+#endif
+}
+
+
+
+int R2CompactGrid::
+WritePNGFile(const char *filename) const
+{
+  // Write float values via R2Grid (as 16 bit values)
+  if ((value_type != RN_GRID_UINT16_VALUE_TYPE) && (value_type != RN_GRID_UINT8_VALUE_TYPE)) {
+    R2Grid grid;
+    GetGrid(grid);
+    return grid.WritePNGFile(filename);
+  }
+
+#ifdef RN_USE_PNG
+  // Open the file
+  FILE *fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    RNFail("Unable to open PNG file %s\n", filename);
+    return 0;
+  }
+
+  // Create and initialize the png_struct
+  png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (png_ptr == NULL) {
+    fclose(fp);
+    return 0;
+  }
+
+  // Allocate/initialize the image information data
+  png_infop info_ptr = png_create_info_struct(png_ptr);
+  if (info_ptr == NULL) {
+    png_destroy_write_struct(&png_ptr, NULL);
+    fclose(fp);
+    return 0;
+  }
+
+  // Write stored integer values directly (value scale and offset are not saved)
+  int width = grid_resolution[0];
+  int height = grid_resolution[1];
+  int depth = (value_type == RN_GRID_UINT16_VALUE_TYPE) ? 16 : 8;
+  png_set_IHDR(png_ptr, info_ptr, width, height,
+    depth, PNG_COLOR_TYPE_GRAY, PNG_INTERLACE_NONE,
+    PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+  int row_size = width * (depth / 8);
+  png_bytep *row_pointers = (png_bytep *) png_malloc(png_ptr, height * sizeof(png_bytep));
+  for (int i = 0; i < height; i++) row_pointers[i] = &grid_data[(size_t) (height - i - 1) * row_size];
+  png_init_io(png_ptr, fp);
+  png_write_info(png_ptr, info_ptr);
+  if (depth == 16) png_set_swap(png_ptr);
+  png_write_image(png_ptr, row_pointers);
+  png_write_end(png_ptr, info_ptr);
+
+  // Clean up
+  png_free(png_ptr, row_pointers);
+  png_destroy_write_struct(&png_ptr, &info_ptr);
+  fclose(fp);
+
+  // Return success
+  return 1;
+#else
+  RNFail("PNG not supported");
+  return 0;
+#endif
+}
+
+
+
+} // namespace gaps
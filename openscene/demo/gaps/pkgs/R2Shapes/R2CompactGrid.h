@@ -0,0 +1,226 @@
+// Header file for GAPS compact grid class
+#ifndef __R2__COMPACT__GRID__H__
+#define __R2__COMPACT__GRID__H__
+
+
+
+/* Begin namespace */
+namespace gaps {
+
+
+
+// Value types
+
+#define RN_GRID_FLOAT32_VALUE_TYPE 0
+#define RN_GRID_FLOAT16_VALUE_TYPE 1
+#define RN_GRID_UINT16_VALUE_TYPE  2
+#define RN_GRID_UINT8_VALUE_TYPE   3
+#define RN_GRID_NUM_VALUE_TYPES    4
+
+
+
+// Class definition
+
+class R2CompactGrid {
+public:
+  // Constructors
+  R2CompactGrid(int xresolution = 0, int yresolution = 0, int value_type = RN_GRID_FLOAT32_VALUE_TYPE,
+    RNScalar value_scale = 1, RNScalar value_offset = 0);
+  R2CompactGrid(const R2Grid& grid, int value_type = RN_GRID_FLOAT32_VALUE_TYPE,
+    RNScalar value_scale = 1, RNScalar value_offset = 0);
+  R2CompactGrid(const R2CompactGrid& grid);
+  ~R2CompactGrid(void);
+
+  // Grid property functions
+  int NEntries(void) const;
+  int XResolution(void) const;
+  int YResolution(void) const;
+  int ValueType(void) const;
+  int NBytesPerValue(void) const;
+  RNScalar ValueScale(void) const;
+  RNScalar ValueOffset(void) const;
+  size_t MemoryUsage(void) const;
+  const R2Affine& WorldToGridTransformation(void) const;
+
+  // Grid value access functions
+  RNScalar GridValue(int index) const;
+  RNScalar GridValue(int i, int j) const;
+  const void *Data(void) const;
+
+  // Grid manipulation functions
+  void SetGridValue(int index, RNScalar value);
+  void SetGridValue(int i, int j, RNScalar value);
+  void SetWorldToGridTransformation(const R2Affine& affine);
+  R2CompactGrid& operator=(const R2CompactGrid& grid);
+
+  // Conversion functions
+  void SetGrid(const R2Grid& grid);
+  void SetGrid(const R2Grid& grid, int value_type, RNScalar value_scale = 1, RNScalar value_offset = 0);
+  void GetGrid(R2Grid& grid) const;
+
+  // File reading/writing functions
+  int ReadFile(const char *filename);
+  int WriteFile(const char *filename) const;
+  int ReadPNGFile(const char *filename);
+  int WritePNGFile(const char *filename) const;
+  int ReadPFMFile(const char *filename);
+  int WritePFMFile(const char *filename) const;
+
+private:
+  void Reset(int xresolution, int yresolution, int value_type, RNScalar value_scale, RNScalar value_offset);
+
+private:
+  R2Affine world_to_grid_transform;
+  unsigned char *grid_data;
+  int grid_resolution[2];
+  int grid_size;
+  int value_type;
+  RNScalar value_scale;
+  RNScalar value_offset;
+};
+
+
+
+// Value conversion functions (the array versions run in parallel)
+
+int RNGridValueTypeSize(int value_type);
+void RNEncodeGridValue(RNScalar value, void *data, int index,
+  int value_type, RNScalar value_scale = 1, RNScalar value_offset = 0);
+RNScalar RNDecodeGridValue(const void *data, int index,
+  int value_type, RNScalar value_scale = 1, RNScalar value_offset = 0);
+void RNEncodeGridValues(const RNScalar *values, int nvalues, void *data,
+  int value_type, RNScalar value_scale = 1, RNScalar value_offset = 0);
+void RNDecodeGridValues(const void *data, int nvalues, RNScalar *values,
+  int value_type, RNScalar value_scale = 1, RNScalar value_offset = 0);
+
+
+
+// Inline functions
+
+inline int R2CompactGrid::
+NEntries(void) const
+{
+  // Return total number of entries
+  return grid_size;
+}
+
+
+
+inline int R2CompactGrid::
+XResolution(void) const
+{
+  // Return resolution in X dimension
+  return grid_resolution[0];
+}
+
+
+
+inline int R2CompactGrid::
+YResolution(void) const
+{
+  // Return resolution in Y dimension
+  return grid_resolution[1];
+}
+
+
+
+inline int R2CompactGrid::
+ValueType(void) const
+{
+  // Return type of stored values
+  return value_type;
+}
+
+
+
+inline int R2CompactGrid::
+NBytesPerValue(void) const
+{
+  // Return number of bytes per stored value
+  return RNGridValueTypeSize(value_type);
+}
+
+
+
+inline RNScalar R2CompactGrid::
+ValueScale(void) const
+{
+  // Return scale applied to integer values
+  return value_scale;
+}
+
+
+
+inline RNScalar R2CompactGrid::
+ValueOffset(void) const
+{
+  // Return offset applied to integer values
+  return value_offset;
+}
+
+
+
+inline size_t R2CompactGrid::
+MemoryUsage(void) const
+{
+  // Return number of bytes used to store values
+  return (size_t) grid_size * NBytesPerValue();
+}
+
+
+
+inline const R2Affine& R2CompactGrid::
+WorldToGridTransformation(void) const
+{
+  // Return transformation from world coordinates to grid coordinates
+  return world_to_grid_transform;
+}
+
+
+
+inline RNScalar R2CompactGrid::
+GridValue(int i, int j) const
+{
+  // Return value at grid point
+  assert((i >= 0) && (i < grid_resolution[0]));
+  assert((j >= 0) && (j < grid_resolution[1]));
+  return GridValue(j * grid_resolution[0] + i);
+}
+
+
+
+inline const void *R2CompactGrid::
+Data(void) const
+{
+  // Return pointer to stored values
+  return grid_data;
+}
+
+
+
+inline void R2CompactGrid::
+SetGridValue(int i, int j, RNScalar value)
+{
+  // Set value at grid point
+  assert((i >= 0) && (i < grid_resolution[0]));
+  assert((j >= 0) && (j < grid_resolution[1]));
+  SetGridValue(j * grid_resolution[0] + i, value);
+}
+
+
+
+inline void R2CompactGrid::
+SetGrid(const R2Grid& grid)
+{
+  // Encode grid values with current value type
+  SetGrid(grid, value_type, value_scale, value_offset);
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
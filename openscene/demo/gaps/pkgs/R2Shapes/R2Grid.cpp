@@ -23,6 +23,8 @@
 // Include files
 
 #include "R2Shapes.h"
+#include <algorithm>
+#include <vector>
 
 #ifdef RN_USE_PNG
 # include "png/png.h"
@@ -716,50 +718,59 @@ FillHoles(void)
 
 
 
-void R2Grid::
-FillHoles(int max_hole_size)
+struct R2GridFillData {
+  RNScalar *values;
+  int max_hole_size;
+  int line_stride;
+  int element_stride;
+  int line_length;
+};
+
+
+
+static void
+FillHolesLine(int line, int, void *ptr)
 {
-  // Interpolate vertically
-  for (int ix = 0; ix < XResolution(); ix++) {
-    int iy0 = -1;
-    for (int iy1 = 0; iy1 < YResolution(); iy1++) {
-      if (GridValue(ix, iy1) != R2_GRID_UNKNOWN_VALUE) { 
-        if ((iy0 >= 0) && (iy0 < iy1-1) && (iy1-iy0 < max_hole_size)) {
-          RNScalar value0 = GridValue(ix, iy0);
-          if (value0 == R2_GRID_UNKNOWN_VALUE) continue;
-          RNScalar value1 = GridValue(ix, iy1);
-          if (value1 == R2_GRID_UNKNOWN_VALUE) continue;
-          for (int iy = iy0+1; iy < iy1; iy++) {
-            RNScalar t = (double) (iy - iy0) / (double) (iy1 - iy0);
-            RNScalar value = (1-t)*value0 + t*value1;
-            SetGridValue(ix, iy, value);
-          }
-        }
-        iy0 = iy1;
+  // Interpolate across short runs of unknown values along one line
+  R2GridFillData *data = (R2GridFillData *) ptr;
+  RNScalar *values = data->values + line * data->line_stride;
+  int stride = data->element_stride;
+  int i0 = -1;
+  for (int i1 = 0; i1 < data->line_length; i1++) {
+    RNScalar value1 = values[i1 * stride];
+    if (value1 == R2_GRID_UNKNOWN_VALUE) continue;
+    if ((i0 >= 0) && (i0 < i1-1) && (i1-i0 < data->max_hole_size)) {
+      RNScalar value0 = values[i0 * stride];
+      for (int i = i0+1; i < i1; i++) {
+        RNScalar t = (double) (i - i0) / (double) (i1 - i0);
+        values[i * stride] = (1-t)*value0 + t*value1;
       }
     }
+    i0 = i1;
   }
+}
+
+
+
+void R2Grid::
+FillHoles(int max_hole_size)
+{
+  // Initialize data
+  R2GridFillData data;
+  data.values = grid_values;
+  data.max_hole_size = max_hole_size;
+
+  // Interpolate vertically
+  data.line_length = YResolution();
+  data.line_stride = 1;
+  data.element_stride = XResolution();
+  RNParallelFor(XResolution(), FillHolesLine, &data, 16);
 
   // Interpolate horizontally
-  for (int iy = 0; iy < YResolution(); iy++) {
-    int ix0 = -1;
-    for (int ix1 = 0; ix1 < XResolution(); ix1++) {
-      if (GridValue(ix1, iy) != R2_GRID_UNKNOWN_VALUE) { 
-        if ((ix0 >= 0) && (ix0 < ix1-1) && (ix1-ix0 < max_hole_size)) {
-          RNScalar value0 = GridValue(ix0, iy);
-          if (value0 == R2_GRID_UNKNOWN_VALUE) continue;
-          RNScalar value1 = GridValue(ix1, iy);
-          if (value1 == R2_GRID_UNKNOWN_VALUE) continue;
-          for (int ix = ix0+1; ix < ix1; ix++) {
-            RNScalar t = (double) (ix - ix0) / (double) (ix1 - ix0);
-            RNScalar value = (1-t)*value0 + t*value1;
-            SetGridValue(ix, iy, value);
-          }
-        }
-        ix0 = ix1;
-      }
-    }
-  }
+  data.line_length = XResolution();
+  data.line_stride = XResolution();
+  data.element_stride = 1;
+  RNParallelFor(YResolution(), FillHolesLine, &data);
 }
 
 
@@ -817,21 +828,69 @@ Erode(RNLength grid_distance)
 
 
 
-void R2Grid::
-Blur(RNDimension dim, RNLength grid_sigma) 
+////////////////////////////////////////////////////////////////////////
+// Filter utility functions
+////////////////////////////////////////////////////////////////////////
+
+// The filters below process rows of the grid in parallel.  Convolutions
+// in Y combine whole rows at once, so that inner loops run over
+// contiguous memory, and min/max filters decompose the disc into
+// horizontal spans that are processed with running extrema.  All of
+// them compute the same values as a direct per-sample evaluation.
+
+struct R2GridFilterData {
+  RNScalar *values;
+  const RNScalar *source;
+  int xres, yres;
+  const RNScalar *filter;
+  int radius;
+  const int *span_widths;
+  RNScalar percentile;
+  RNBoolean maximum;
+  RNScalar value_denom;
+  RNBoolean value_sigma_is_fraction;
+  std::vector<std::vector<RNScalar> > buffers;
+};
+
+
+
+static void
+InitializeFilterData(R2GridFilterData& data, RNScalar *values, const RNScalar *source, int xres, int yres)
 {
-  // Build filter
-  RNScalar sigma = grid_sigma;
-  int filter_radius = (int) (3 * sigma + 0.5);
-  RNScalar *filter = new RNScalar [ filter_radius + 1 ];
-  assert(filter);
+  // Initialize filter data
+  data.values = values;
+  data.source = source;
+  data.xres = xres;
+  data.yres = yres;
+  data.filter = NULL;
+  data.radius = 0;
+  data.span_widths = NULL;
+  data.percentile = 0;
+  data.maximum = FALSE;
+  data.value_denom = 0;
+  data.value_sigma_is_fraction = FALSE;
+  data.buffers.resize(RNNThreads());
+}
+
 
-  // Make buffer for temporary copy of row
-  int res = Resolution(dim);
-  RNScalar *buffer = new RNScalar [ res ];
-  assert(buffer);
 
-  // Fill filter with Gaussian 
+static RNScalar *
+FilterBuffer(R2GridFilterData *data, int thread_index, int size)
+{
+  // Return scratch buffer for thread
+  std::vector<RNScalar>& buffer = data->buffers[thread_index];
+  if ((int) buffer.size() < size) buffer.resize(size);
+  return &buffer[0];
+}
+
+
+
+static RNScalar *
+CreateGaussianFilter(RNScalar sigma, int filter_radius)
+{
+  // Fill filter with Gaussian
+  RNScalar *filter = new RNScalar [ filter_radius + 1 ];
+  assert(filter);
   const RNScalar sqrt_two_pi = sqrt(RN_TWO_PI);
   double a = sqrt_two_pi * sigma;
   double fac = 1.0 / (a * a * a);
@@ -839,150 +898,342 @@ Blur(RNDimension dim, RNLength grid_sigma)
   for (int i = 0; i <= filter_radius; i++) {
     filter[i] = fac * exp(-i * i / denom);
   }
+  return filter;
+}
 
-  // Convolve grid with filter 
-  for (int j = 0; j < Resolution(1-dim); j++) { 
-    for (int i = 0; i < Resolution(dim); i++) 
-      buffer[i] = (dim == RN_X) ? GridValue(i, j) : GridValue(j, i); 
-    for (int i = 0; i < Resolution(dim); i++) { 
-      if (buffer[i] == R2_GRID_UNKNOWN_VALUE) continue;
-      RNScalar sum = 0;
-      RNScalar weight = 0;
-      RNScalar value = buffer[i];
-      if (value != R2_GRID_UNKNOWN_VALUE) {
-        sum += filter[0] * value;
-        weight += filter[0];
-      }
-      int nsamples = i;
-      if (nsamples > filter_radius) nsamples = filter_radius;
-      for (int m = 1; m <= nsamples; m++) {
-        RNScalar value = buffer[i - m];;
-        if (value != R2_GRID_UNKNOWN_VALUE) {
-          sum += filter[m] * value;
-          weight += filter[m];
-        }
-      }
-      nsamples = XResolution() - 1 - i;
-      if (nsamples > filter_radius) nsamples = filter_radius;
-      for (int m = 1; m <= nsamples; m++) {
-        RNScalar value = buffer[i + m];
-        if (value != R2_GRID_UNKNOWN_VALUE) {
-          sum += filter[m] * value;
-          weight += filter[m];
-        }
+
+
+static void
+ComputeSpanWidths(RNScalar radius_squared, int r, int *span_widths)
+{
+  // Compute half width of disc in every row (dx*dx + dy*dy <= radius_squared)
+  for (int dy = 0; dy <= r; dy++) {
+    span_widths[dy] = 0;
+    for (int dx = r; dx > 0; dx--) {
+      if (dx*dx + dy*dy <= radius_squared) { span_widths[dy] = dx; break; }
+    }
+  }
+}
+
+
+
+static void
+BlurGridRow(int j, int thread_index, void *ptr)
+{
+  // Convolve one row with filter in X direction
+  R2GridFilterData *data = (R2GridFilterData *) ptr;
+  const RNScalar *filter = data->filter;
+  int filter_radius = data->radius;
+  int nx = data->xres;
+  RNScalar *row = data->values + j * nx;
+  RNScalar *buffer = FilterBuffer(data, thread_index, nx);
+  for (int i = 0; i < nx; i++) buffer[i] = row[i];
+  for (int i = 0; i < nx; i++) {
+    // Skip unknown values (unknown samples get zero weight below)
+    if (buffer[i] == R2_GRID_UNKNOWN_VALUE) continue;
+    RNScalar sum = 0;
+    RNScalar weight = 0;
+    sum += filter[0] * buffer[i];
+    weight += filter[0];
+    int nsamples = i;
+    if (nsamples > filter_radius) nsamples = filter_radius;
+    for (int m = 1; m <= nsamples; m++) {
+      RNScalar value = buffer[i - m];
+      RNScalar w = (value != R2_GRID_UNKNOWN_VALUE) ? filter[m] : 0.0;
+      sum += w * value;
+      weight += w;
+    }
+    nsamples = nx - 1 - i;
+    if (nsamples > filter_radius) nsamples = filter_radius;
+    for (int m = 1; m <= nsamples; m++) {
+      RNScalar value = buffer[i + m];
+      RNScalar w = (value != R2_GRID_UNKNOWN_VALUE) ? filter[m] : 0.0;
+      sum += w * value;
+      weight += w;
+    }
+    if (weight > 0) row[i] = sum / weight;
+  }
+}
+
+
+
+static void
+BlurGridColumns(int j, int thread_index, void *ptr)
+{
+  // Convolve one row with filter in Y direction, combining whole rows of source
+  R2GridFilterData *data = (R2GridFilterData *) ptr;
+  const RNScalar *filter = data->filter;
+  int filter_radius = data->radius;
+  int nx = data->xres;
+  const RNScalar *source = data->source + j * nx;
+  RNScalar *sums = FilterBuffer(data, thread_index, 2 * nx);
+  RNScalar *weights = sums + nx;
+
+  // Add center sample
+  for (int i = 0; i < nx; i++) {
+    RNScalar w = (source[i] != R2_GRID_UNKNOWN_VALUE) ? filter[0] : 0.0;
+    sums[i] = 0.0 + w * source[i];
+    weights[i] = 0.0 + w;
+  }
+
+  // Add samples in rows before
+  int nsamples = j;
+  if (nsamples > filter_radius) nsamples = filter_radius;
+  for (int m = 1; m <= nsamples; m++) {
+    const RNScalar *samples = source - m * nx;
+    for (int i = 0; i < nx; i++) {
+      RNScalar w = (samples[i] != R2_GRID_UNKNOWN_VALUE) ? filter[m] : 0.0;
+      sums[i] += w * samples[i];
+      weights[i] += w;
+    }
+  }
+
+  // Add samples in rows after
+  nsamples = data->yres - 1 - j;
+  if (nsamples > filter_radius) nsamples = filter_radius;
+  for (int m = 1; m <= nsamples; m++) {
+    const RNScalar *samples = source + m * nx;
+    for (int i = 0; i < nx; i++) {
+      RNScalar w = (samples[i] != R2_GRID_UNKNOWN_VALUE) ? filter[m] : 0.0;
+      sums[i] += w * samples[i];
+      weights[i] += w;
+    }
+  }
+
+  // Set values (unknown values are left unchanged)
+  RNScalar *row = data->values + j * nx;
+  for (int i = 0; i < nx; i++) {
+    if (source[i] == R2_GRID_UNKNOWN_VALUE) continue;
+    if (weights[i] > 0) row[i] = sums[i] / weights[i];
+  }
+}
+
+
+
+static void
+RunningMinimum(const RNScalar *values, int n, int w, RNBoolean negate,
+  RNScalar *result, RNScalar *prefix, RNScalar *suffix)
+{
+  // Compute minimum of values within w of every index with the van Herk/Gil-Werman
+  // algorithm (three comparisons per value for any w).  Unknown values are ignored,
+  // and values are negated first if negate is set (to compute maxima).
+  int k = 2*w + 1;
+  int npadded = ((n + 2*w + k - 1) / k) * k;
+
+  // Compute prefix minima within blocks of k padded values
+  for (int i = 0; i < npadded; i++) {
+    int index = i - w;
+    RNScalar value = DBL_MAX;
+    if ((index >= 0) && (index < n) && (values[index] != R2_GRID_UNKNOWN_VALUE)) {
+      value = (negate) ? -values[index] : values[index];
+    }
+    suffix[i] = value;
+    if ((i % k) == 0) prefix[i] = value;
+    else prefix[i] = (value < prefix[i-1]) ? value : prefix[i-1];
+  }
+
+  // Compute suffix minima within blocks
+  for (int i = npadded - 2; i >= 0; i--) {
+    if ((i % k) == (k - 1)) continue;
+    if (suffix[i+1] < suffix[i]) suffix[i] = suffix[i+1];
+  }
+
+  // Combine suffix and prefix minima to get minimum of window [index-w, index+w]
+  for (int i = 0; i < n; i++) {
+    result[i] = (suffix[i] < prefix[i + 2*w]) ? suffix[i] : prefix[i + 2*w];
+  }
+}
+
+
+
+static void
+MinMaxFilterRow(int cy, int thread_index, void *ptr)
+{
+  // Compute min/max of disc around every sample in one row
+  R2GridFilterData *data = (R2GridFilterData *) ptr;
+  int r = data->radius;
+  int nx = data->xres;
+  RNScalar *extrema = FilterBuffer(data, thread_index, 4*nx + 8*r + 2);
+  RNScalar *line = extrema + nx;
+  RNScalar *prefix = line + nx;
+  RNScalar *suffix = prefix + nx + 4*r + 1;
+  for (int cx = 0; cx < nx; cx++) extrema[cx] = DBL_MAX;
+
+  // Combine running extrema of spans in rows within radius
+  int ymin = cy - r;
+  int ymax = cy + r;
+  if (ymin < 0) ymin = 0;
+  if (ymax >= data->yres) ymax = data->yres - 1;
+  for (int y = ymin; y <= ymax; y++) {
+    int w = data->span_widths[(y < cy) ? cy - y : y - cy];
+    RunningMinimum(data->source + y * nx, nx, w, data->maximum, line, prefix, suffix);
+    for (int cx = 0; cx < nx; cx++) {
+      if (line[cx] < extrema[cx]) extrema[cx] = line[cx];
+    }
+  }
+
+  // Set values (unknown values are left unchanged)
+  const RNScalar *source = data->source + cy * nx;
+  RNScalar *row = data->values + cy * nx;
+  for (int cx = 0; cx < nx; cx++) {
+    if (source[cx] == R2_GRID_UNKNOWN_VALUE) continue;
+    row[cx] = (data->maximum) ? -extrema[cx] : extrema[cx];
+  }
+}
+
+
+
+static void
+PercentileFilterRow(int cy, int thread_index, void *ptr)
+{
+  // Compute percentile of disc around every sample in one row
+  R2GridFilterData *data = (R2GridFilterData *) ptr;
+  int r = data->radius;
+  int nx = data->xres;
+  RNScalar *samples = FilterBuffer(data, thread_index, (2*r+1) * (2*r+1));
+  int ymin = cy - r;
+  int ymax = cy + r;
+  if (ymin < 0) ymin = 0;
+  if (ymax >= data->yres) ymax = data->yres - 1;
+  for (int cx = 0; cx < nx; cx++) {
+    // Check if current value is unknown - if so, don't update
+    if (data->source[cy * nx + cx] == R2_GRID_UNKNOWN_VALUE) continue;
+
+    // Build list of grid values in neighborhood
+    int nsamples = 0;
+    for (int y = ymin; y <= ymax; y++) {
+      int w = data->span_widths[(y < cy) ? cy - y : y - cy];
+      int xmin = cx - w;
+      int xmax = cx + w;
+      if (xmin < 0) xmin = 0;
+      if (xmax >= nx) xmax = nx - 1;
+      const RNScalar *row = data->source + y * nx;
+      for (int x = xmin; x <= xmax; x++) {
+        if (row[x] == R2_GRID_UNKNOWN_VALUE) continue;
+        samples[nsamples++] = row[x];
       }
-      if (weight > 0) {
-        RNScalar value = sum / weight;
-        if (dim == RN_X) SetGridValue(i, j, value);
-        else SetGridValue(j, i, value);
+    }
+
+    // Check number of grid values in neighborhood
+    RNScalar *value = &data->values[cy * nx + cx];
+    if (nsamples == 0) {
+      *value = R2_GRID_UNKNOWN_VALUE;
+    }
+    else {
+      // Set grid value to percentile of neighborhood
+      int index = (int) (data->percentile * nsamples);
+      if (index < 0) index = 0;
+      else if (index >= nsamples) index = nsamples-1;
+      std::nth_element(samples, samples + index, samples + nsamples);
+      *value = samples[index];
+    }
+  }
+}
+
+
+
+static void
+BilateralFilterRow(int cy, int thread_index, void *ptr)
+{
+  // Compute bilateral filter of disc around every sample in one row
+  R2GridFilterData *data = (R2GridFilterData *) ptr;
+  const RNScalar *grid_weights = data->filter;
+  int r = data->radius;
+  int nx = data->xres;
+  int ymin = cy - r;
+  int ymax = cy + r;
+  if (ymin < 0) ymin = 0;
+  if (ymax >= data->yres) ymax = data->yres - 1;
+  for (int cx = 0; cx < nx; cx++) {
+    // Check if current value is unknown - if so, don't update
+    RNScalar value = data->source[cy * nx + cx];
+    if (value == R2_GRID_UNKNOWN_VALUE) continue;
+    RNScalar value_denom = data->value_denom;
+    if (data->value_sigma_is_fraction && (value > 0)) {
+      value_denom = data->value_denom * value * value;
+    }
+
+    // Sum samples in neighborhood weighted by grid and value distances
+    RNScalar sum = 0;
+    RNScalar weight = 0;
+    for (int y = ymin; y <= ymax; y++) {
+      int dy = y - cy;
+      int w = data->span_widths[(dy < 0) ? -dy : dy];
+      int xmin = cx - w;
+      int xmax = cx + w;
+      if (xmin < 0) xmin = 0;
+      if (xmax >= nx) xmax = nx - 1;
+      const RNScalar *row = data->source + y * nx;
+      const RNScalar *row_weights = grid_weights + (dy + r) * (2*r + 1) + r;
+      for (int x = xmin; x <= xmax; x++) {
+        RNScalar sample = row[x];
+        if (sample == R2_GRID_UNKNOWN_VALUE) continue;
+        RNScalar value_distance_squared = value - sample;
+        value_distance_squared *= value_distance_squared;
+        RNScalar w = row_weights[x - cx] * exp(value_distance_squared/value_denom);
+        sum += w * sample;
+        weight += w;
       }
     }
+
+    // Set grid value
+    if (weight == 0) data->values[cy * nx + cx] = R2_GRID_UNKNOWN_VALUE;
+    else data->values[cy * nx + cx] = sum / weight;
+  }
+}
+
+
+
+void R2Grid::
+Blur(RNDimension dim, RNLength grid_sigma)
+{
+  // Build filter
+  RNScalar sigma = grid_sigma;
+  int filter_radius = (int) (3 * sigma + 0.5);
+  RNScalar *filter = CreateGaussianFilter(sigma, filter_radius);
+
+  // Convolve grid with filter
+  R2GridFilterData data;
+  InitializeFilterData(data, grid_values, grid_values, XResolution(), YResolution());
+  data.filter = filter;
+  data.radius = filter_radius;
+  if (dim == RN_X) {
+    RNParallelFor(YResolution(), BlurGridRow, &data);
+  }
+  else {
+    R2Grid copy(*this);
+    data.source = copy.grid_values;
+    RNParallelFor(YResolution(), BlurGridColumns, &data);
   }
 
   // Deallocate memory
   delete [] filter;
-  delete [] buffer;
 }
 
 
 
 void R2Grid::
-Blur(RNLength grid_sigma) 
+Blur(RNLength grid_sigma)
 {
   // Build filter
   RNScalar sigma = grid_sigma;
   int filter_radius = (int) (3 * sigma + 0.5);
-  RNScalar *filter = new RNScalar [ filter_radius + 1 ];
-  assert(filter);
-
-  // Make buffer for temporary copy of row
-  int res = XResolution();
-  if (res < YResolution()) res = YResolution();
-  RNScalar *buffer = new RNScalar [ res ];
-  assert(buffer);
-
-  // Fill filter with Gaussian 
-  const RNScalar sqrt_two_pi = sqrt(RN_TWO_PI);
-  double a = sqrt_two_pi * sigma;
-  double fac = 1.0 / (a * a * a);
-  double denom = 2.0 * sigma * sigma;
-  for (int i = 0; i <= filter_radius; i++) {
-    filter[i] = fac * exp(-i * i / denom);
-  }
+  RNScalar *filter = CreateGaussianFilter(sigma, filter_radius);
 
   // Convolve grid with filter in X direction
-  for (int j = 0; j < YResolution(); j++) { 
-    for (int i = 0; i < XResolution(); i++) 
-      buffer[i] = GridValue(i, j); 
-    for (int i = 0; i < XResolution(); i++) { 
-      if (buffer[i] == R2_GRID_UNKNOWN_VALUE) continue;
-      RNScalar sum = 0;
-      RNScalar weight = 0;
-      RNScalar value = buffer[i];
-      if (value != R2_GRID_UNKNOWN_VALUE) {
-        sum += filter[0] * value;
-        weight += filter[0];
-      }
-      int nsamples = i;
-      if (nsamples > filter_radius) nsamples = filter_radius;
-      for (int m = 1; m <= nsamples; m++) {
-        RNScalar value = buffer[i - m];;
-        if (value != R2_GRID_UNKNOWN_VALUE) {
-          sum += filter[m] * value;
-          weight += filter[m];
-        }
-      }
-      nsamples = XResolution() - 1 - i;
-      if (nsamples > filter_radius) nsamples = filter_radius;
-      for (int m = 1; m <= nsamples; m++) {
-        RNScalar value = buffer[i + m];
-        if (value != R2_GRID_UNKNOWN_VALUE) {
-          sum += filter[m] * value;
-          weight += filter[m];
-        }
-      }
-      if (weight > 0) SetGridValue(i, j, sum / weight);
-    }
-  }
+  R2GridFilterData data;
+  InitializeFilterData(data, grid_values, grid_values, XResolution(), YResolution());
+  data.filter = filter;
+  data.radius = filter_radius;
+  RNParallelFor(YResolution(), BlurGridRow, &data);
 
   // Convolve grid with filter in Y direction
-  for (int j = 0; j < XResolution(); j++) { 
-    for (int i = 0; i < YResolution(); i++) 
-      buffer[i] = GridValue(j, i); 
-    for (int i = 0; i < YResolution(); i++) { 
-      if (buffer[i] == R2_GRID_UNKNOWN_VALUE) continue;
-      RNScalar sum = 0;
-      RNScalar weight = 0;
-      RNScalar value = buffer[i];
-      if (value != R2_GRID_UNKNOWN_VALUE) {
-        sum += filter[0] * value;
-        weight += filter[0];
-      }
-      int nsamples = i;
-      if (nsamples > filter_radius) nsamples = filter_radius;
-      for (int m = 1; m <= nsamples; m++) {
-        RNScalar value = buffer[i - m];
-        if (value != R2_GRID_UNKNOWN_VALUE) {
-          sum += filter[m] * value;
-          weight += filter[m];
-        }
-      }
-      nsamples = YResolution() - 1 - i;
-      if (nsamples > filter_radius) nsamples = filter_radius;
-      for (int m = 1; m <= nsamples; m++) {
-        RNScalar value = buffer[i + m];
-        if (value != R2_GRID_UNKNOWN_VALUE) {
-          sum += filter[m] * value;
-          weight += filter[m];
-        }
-      }
-      if (weight > 0) SetGridValue(j, i, sum / weight);
-    }
-  }
+  R2Grid copy(*this);
+  data.source = copy.grid_values;
+  RNParallelFor(YResolution(), BlurGridColumns, &data);
 
   // Deallocate memory
   delete [] filter;
-  delete [] buffer;
 }
 
 
@@ -1018,50 +1269,136 @@ BilateralFilter(RNLength grid_sigma, RNLength value_sigma, RNBoolean value_sigma
 
   // Get convenient variables
   double grid_denom = -2.0 * grid_sigma * grid_sigma;
-  double value_denom = -2.0 * value_sigma * value_sigma;
   RNScalar grid_radius = 3 * grid_sigma;
   int r = (int) (grid_radius + 1);
   int r_squared = r * r;
 
+  // Tabulate weights for grid distances
+  int *span_widths = new int [ r + 1 ];
+  ComputeSpanWidths(r_squared, r, span_widths);
+  RNScalar *grid_weights = new RNScalar [ (2*r+1) * (2*r+1) ];
+  for (int dy = -r; dy <= r; dy++) {
+    for (int dx = -r; dx <= r; dx++) {
+      int grid_distance_squared = dx*dx + dy*dy;
+      grid_weights[(dy+r)*(2*r+1) + (dx+r)] = exp(grid_distance_squared/grid_denom);
+    }
+  }
+
   // Set every sample to be filter of surrounding region in input grid
-  for (int cy = 0; cy < YResolution(); cy++) {
-    for (int cx = 0; cx < XResolution(); cx++) {
-      // Check if current value is unknown - if so, don't update
-      RNScalar value = copy.GridValue(cx, cy);
-      if (value != R2_GRID_UNKNOWN_VALUE) {
-        if (value_sigma_is_fraction && (value > 0)) {
-          value_denom = -2.0 * value_sigma * value_sigma * value * value;
-        }
-        RNScalar sum = 0;
-        RNScalar weight = 0;
-        int ymin = cy - r;
-        int ymax = cy + r;
-        if (ymin < 0) ymin = 0;
-        if (ymax >= YResolution()) ymax = YResolution() - 1;
-        for (int y = ymin; y <= ymax; y++) {
-          int xmin = cx - r;
-          int xmax = cx + r;
-          if (xmin < 0) xmin = 0;
-          if (xmax >= XResolution()) xmax = XResolution() - 1;
-          int dy = y - cy;
-          for (int x = xmin; x <= xmax; x++) {
-            int dx = x - cx;
-            int grid_distance_squared = dx*dx + dy*dy;
-            if (grid_distance_squared > r_squared) continue;
-            RNScalar sample = copy.GridValue(x, y);
-            if (sample == R2_GRID_UNKNOWN_VALUE) continue;
-            RNScalar value_distance_squared = value - sample;
-            value_distance_squared *= value_distance_squared;
-            RNScalar w = exp(grid_distance_squared/grid_denom) * exp(value_distance_squared/value_denom);
-            sum += w * sample;
-            weight += w;
+  R2GridFilterData data;
+  InitializeFilterData(data, grid_values, copy.grid_values, XResolution(), YResolution());
+  data.filter = grid_weights;
+  data.radius = r;
+  data.span_widths = span_widths;
+  data.value_denom = -2.0 * value_sigma * value_sigma;
+  data.value_sigma_is_fraction = value_sigma_is_fraction;
+  RNParallelFor(YResolution(), BilateralFilterRow, &data);
+
+  // Delete temporary memory
+  delete [] span_widths;
+  delete [] grid_weights;
+}
+
+
+
+void R2Grid::
+BilateralGridFilter(RNLength grid_sigma, RNLength value_sigma)
+{
+  // Approximate bilateral filter by splatting samples into a coarse
+  // (x, y, value) grid with cells grid_sigma by value_sigma in size,
+  // blurring it, and slicing it with trilinear interpolation (Paris and
+  // Durand, 2006).  The cost is linear in the number of samples and does
+  // not depend on grid_sigma, which makes this much faster than
+  // BilateralFilter for large grid_sigma.
+
+  // Determine reasonable value sigma
+  RNInterval range = Range();
+  if (range.IsEmpty()) return;
+  if (value_sigma == -1) value_sigma = 0.01 * (range.Max() - range.Min());
+  if ((grid_sigma <= 0) || (value_sigma <= 0)) return;
+
+  // Allocate coarse grid of homogeneous (value * weight, weight) pairs
+  const int border = 2;
+  int nx = (int) ((XResolution() - 1) / grid_sigma) + 1 + 2*border;
+  int ny = (int) ((YResolution() - 1) / grid_sigma) + 1 + 2*border;
+  int nv = (int) ((range.Max() - range.Min()) / value_sigma) + 1 + 2*border;
+  int nxy = nx * ny;
+  std::vector<float> cells(2 * nv * nxy, 0.0f);
+
+  // Splat samples into coarse grid with trilinear weights
+  for (int iy = 0; iy < YResolution(); iy++) {
+    for (int ix = 0; ix < XResolution(); ix++) {
+      RNScalar value = GridValue(ix, iy);
+      if (value == R2_GRID_UNKNOWN_VALUE) continue;
+      RNScalar p[3];
+      p[0] = ix / grid_sigma + border;
+      p[1] = iy / grid_sigma + border;
+      p[2] = (value - range.Min()) / value_sigma + border;
+      int i0[3]; RNScalar t[3];
+      for (int d = 0; d < 3; d++) { i0[d] = (int) p[d]; t[d] = p[d] - i0[d]; }
+      for (int c = 0; c < 8; c++) {
+        RNScalar w = 1;
+        for (int d = 0; d < 3; d++) w *= (c & (1 << d)) ? t[d] : 1.0 - t[d];
+        int i = i0[0] + (c & 1);
+        int j = i0[1] + ((c >> 1) & 1);
+        int k = i0[2] + ((c >> 2) & 1);
+        float *cell = &cells[2 * (k*nxy + j*nx + i)];
+        cell[0] += w * value;
+        cell[1] += w;
+      }
+    }
+  }
+
+  // Blur coarse grid with [1 4 6 4 1]/16 in each dimension
+  const float filter[5] = { 1/16.0f, 4/16.0f, 6/16.0f, 4/16.0f, 1/16.0f };
+  const int strides[3] = { 1, nx, nxy };
+  const int resolutions[3] = { nx, ny, nv };
+  std::vector<float> copy(cells.size());
+  for (int dim = 0; dim < 3; dim++) {
+    copy = cells;
+    int stride = strides[dim];
+    for (int k = 0; k < nv; k++) {
+      for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+          int index[3] = { i, j, k };
+          int cell_index = k*nxy + j*nx + i;
+          float sum[2] = { 0, 0 };
+          for (int m = -2; m <= 2; m++) {
+            if ((index[dim] + m < 0) || (index[dim] + m >= resolutions[dim])) continue;
+            const float *cell = &copy[2 * (cell_index + m*stride)];
+            sum[0] += filter[m+2] * cell[0];
+            sum[1] += filter[m+2] * cell[1];
           }
+          cells[2*cell_index+0] = sum[0];
+          cells[2*cell_index+1] = sum[1];
         }
+      }
+    }
+  }
 
-        // Set grid value
-        if (weight == 0) SetGridValue(cx, cy, R2_GRID_UNKNOWN_VALUE);
-        else SetGridValue(cx, cy, sum / weight);
+  // Slice coarse grid at every known sample with trilinear interpolation
+  for (int iy = 0; iy < YResolution(); iy++) {
+    for (int ix = 0; ix < XResolution(); ix++) {
+      RNScalar value = GridValue(ix, iy);
+      if (value == R2_GRID_UNKNOWN_VALUE) continue;
+      RNScalar p[3];
+      p[0] = ix / grid_sigma + border;
+      p[1] = iy / grid_sigma + border;
+      p[2] = (value - range.Min()) / value_sigma + border;
+      int i0[3]; RNScalar t[3];
+      for (int d = 0; d < 3; d++) { i0[d] = (int) p[d]; t[d] = p[d] - i0[d]; }
+      RNScalar sum = 0, weight = 0;
+      for (int c = 0; c < 8; c++) {
+        RNScalar w = 1;
+        for (int d = 0; d < 3; d++) w *= (c & (1 << d)) ? t[d] : 1.0 - t[d];
+        int i = i0[0] + (c & 1);
+        int j = i0[1] + ((c >> 1) & 1);
+        int k = i0[2] + ((c >> 2) & 1);
+        const float *cell = &cells[2 * (k*nxy + j*nx + i)];
+        sum += w * cell[0];
+        weight += w * cell[1];
       }
+      if (weight > 0) SetGridValue(ix, iy, sum / weight);
     }
   }
 }
@@ -1086,57 +1423,27 @@ PercentileFilter(RNLength grid_radius, RNScalar percentile)
   RNScalar grid_radius_squared = grid_radius * grid_radius;
   int r = (int) grid_radius;
   assert(r >= 0);
-  int max_samples = (2*r+1) * (2*r+1);
-  RNScalar *samples = new RNScalar [ max_samples ];
-  assert(samples);
+  int *span_widths = new int [ r + 1 ];
+  ComputeSpanWidths(grid_radius_squared, r, span_widths);
 
   // Set every sample to be Kth percentile of surrounding region in input grid
-  for (int cy = 0; cy < YResolution(); cy++) {
-    for (int cx = 0; cx < XResolution(); cx++) {
-      // Check if current value is unknown - if so, don't update
-      if (GridValue(cx, cy) != R2_GRID_UNKNOWN_VALUE) {
-        // Build list of grid values in neighborhood
-        int nsamples = 0;
-        int ymin = cy - r;
-        int ymax = cy + r;
-        if (ymin < 0) ymin = 0;
-        if (ymax >= YResolution()) ymax = YResolution() - 1;
-        for (int y = ymin; y <= ymax; y++) {
-          int xmin = cx - r;
-          int xmax = cx + r;
-          if (xmin < 0) xmin = 0;
-          if (xmax >= XResolution()) xmax = XResolution() - 1;
-          int dy = y - cy;
-          for (int x = xmin; x <= xmax; x++) {
-            int dx = x - cx;
-            int d_squared = dx*dx + dy*dy;
-            if (d_squared > grid_radius_squared) continue;
-            RNScalar sample = copy.GridValue(x, y);
-            if (sample == R2_GRID_UNKNOWN_VALUE) continue;
-            samples[nsamples++] = sample;
-          }
-        }
-
-        // Check number of grid values in neighborhood
-        if (nsamples == 0) {
-          SetGridValue(cx, cy, R2_GRID_UNKNOWN_VALUE);
-        }
-        else {
-          // Sort samples found in neighborhood
-          qsort(samples, nsamples, sizeof(RNScalar), RNCompareScalars);
-
-          // Set grid value to percentile of neighborhood
-          int index = (int) (percentile * nsamples);
-          if (index < 0) index = 0;
-          else if (index >= nsamples) index = nsamples-1;
-          SetGridValue(cx, cy, samples[index]);
-        }
-      }
-    }
+  R2GridFilterData data;
+  InitializeFilterData(data, grid_values, copy.grid_values, XResolution(), YResolution());
+  data.radius = r;
+  data.span_widths = span_widths;
+  data.percentile = percentile;
+  if ((percentile <= 0) || (percentile >= 1)) {
+    // Minimum or maximum (running extrema of spans)
+    data.maximum = (percentile >= 1) ? TRUE : FALSE;
+    RNParallelFor(YResolution(), MinMaxFilterRow, &data);
+  }
+  else {
+    // General percentile (selection in every neighborhood)
+    RNParallelFor(YResolution(), PercentileFilterRow, &data);
   }
 
   // Delete temporary memory
-  delete [] samples;
+  delete [] span_widths;
 }
 
 
@@ -1789,118 +2096,133 @@ SignedDistanceTransform(void)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Distance transform utility functions
+////////////////////////////////////////////////////////////////////////
+
+// The distance transforms below use the separable algorithm of
+// Felzenszwalb and Huttenlocher ("Distance Transforms of Sampled
+// Functions"), which computes the exact squared Euclidean distance
+// by taking the lower envelope of parabolas along each line of the
+// grid, one axis at a time.  Lines are processed in parallel.
+
+struct R2GridDistanceData {
+  RNScalar *distances;
+  RNScalar *labels;
+  int line_length;
+  int line_stride;
+  int element_stride;
+  std::vector<std::vector<RNScalar> > buffers;
+  std::vector<std::vector<int> > index_buffers;
+};
+
+
+
+static void
+InitializeDistanceData(R2GridDistanceData& data, RNScalar *distances, RNScalar *labels)
+{
+  // Initialize distance transform data
+  data.distances = distances;
+  data.labels = labels;
+  data.line_length = 0;
+  data.line_stride = 0;
+  data.element_stride = 0;
+  data.buffers.resize(RNNThreads());
+  data.index_buffers.resize(RNNThreads());
+}
+
+
+
+static void
+DistanceTransformLine(int line, int thread_index, void *ptr)
+{
+  // Get data
+  R2GridDistanceData *data = (R2GridDistanceData *) ptr;
+  int n = data->line_length;
+  int stride = data->element_stride;
+  RNScalar *distances = data->distances + line * data->line_stride;
+  RNScalar *labels = (data->labels) ? data->labels + line * data->line_stride : NULL;
+
+  // Get scratch buffers
+  std::vector<RNScalar>& buffer = data->buffers[thread_index];
+  if ((int) buffer.size() < 3*n + 1) buffer.resize(3*n + 1);
+  std::vector<int>& index_buffer = data->index_buffers[thread_index];
+  if ((int) index_buffer.size() < n) index_buffer.resize(n);
+  RNScalar *f = &buffer[0];
+  RNScalar *g = f + n;
+  RNScalar *z = g + n;
+  int *v = &index_buffer[0];
+
+  // Copy values along line
+  for (int q = 0; q < n; q++) f[q] = distances[q * stride];
+  if (labels) for (int q = 0; q < n; q++) g[q] = labels[q * stride];
+
+  // Compute lower envelope of parabolas rooted at (q, f[q])
+  int k = 0;
+  v[0] = 0;
+  z[0] = -DBL_MAX;
+  z[1] = DBL_MAX;
+  for (int q = 1; q < n; q++) {
+    RNScalar s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2.0 * (q - v[k]));
+    while (s <= z[k]) {
+      k--;
+      s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2.0 * (q - v[k]));
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k+1] = DBL_MAX;
+  }
+
+  // Evaluate lower envelope (and copy label of closest sample)
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k+1] < q) k++;
+    int dq = q - v[k];
+    distances[q * stride] = dq*dq + f[v[k]];
+    if (labels) labels[q * stride] = g[v[k]];
+  }
+}
+
+
+
+static void
+DistanceTransform(int xres, int yres, RNScalar *distances, RNScalar *labels)
+{
+  // Initialize data
+  R2GridDistanceData data;
+  InitializeDistanceData(data, distances, labels);
+
+  // Transform rows
+  data.line_length = xres;
+  data.line_stride = xres;
+  data.element_stride = 1;
+  RNParallelFor(yres, DistanceTransformLine, &data);
+
+  // Transform columns (neighboring columns share cache lines, so hand them out in chunks)
+  data.line_length = yres;
+  data.line_stride = 1;
+  data.element_stride = xres;
+  RNParallelFor(xres, DistanceTransformLine, &data, 16);
+}
+
+
+
 void R2Grid::
 SquaredDistanceTransform(void)
 {
-  int x,y,s,t;
-  int dist,square,new_dist;
-  int* oldBuffer;
-  int* newBuffer;
-  int first;
-  int i;
-
-  // Allocate temporary buffers
+  // Initalize values (0 if was set, max_value if not)
   int res = XResolution();
   if (res < YResolution()) res = YResolution();
-  oldBuffer = new int[res];
-  assert(oldBuffer);
-  newBuffer = new int[res];
-  assert(newBuffer);
-
-  // Initalize values (0 if was set, max_value if not)
   RNScalar max_value = 2 * (res+1) * (res+1);
-  RNScalar *grid_valuesp = grid_values;
-  for (i = 0; i < grid_size; i++) {
-    if (*grid_valuesp == 0.0) *grid_valuesp = max_value;
-    else if (*grid_valuesp == R2_GRID_UNKNOWN_VALUE) *grid_valuesp = max_value;
-    else *grid_valuesp = 0.0;
-    grid_valuesp++;
-  }
-
-  // Scan along x axis
-  for (y = 0; y < YResolution(); y++) {
-    first = 1;
-    dist = 0;
-    for (x = 0; x < XResolution(); x++) {
-      if (GridValue(x,y) == 0.0) {
-        dist=0;
-        first=0;
-        SetGridValue(x, y, 0);
-      }
-      else if (first == 0) {
-        dist++;
-        square = dist*dist;
-        SetGridValue(x, y, square);
-      }
-    }
-      		
-    // backward scan
-    dist = 0;
-    first = 1;
-    for (x = XResolution()-1; x >= 0; x--) {
-      if (GridValue(x,y) == 0.0) {
-        dist = 0;
-        first = 0;
-        SetGridValue(x, y, 0);
-      }
-      else if (first == 0) {
-        dist++;
-        square = dist*dist;
-        if (square < GridValue(x, y)) {
-          SetGridValue(x, y, square);
-        }
-      }
-    }
+  for (int i = 0; i < grid_size; i++) {
+    if (grid_values[i] == 0.0) grid_values[i] = max_value;
+    else if (grid_values[i] == R2_GRID_UNKNOWN_VALUE) grid_values[i] = max_value;
+    else grid_values[i] = 0.0;
   }
 
-  // Scan along y axis
-  for (x = 0; x < XResolution(); x++) {
-    // Copy grid values
-    for (y = 0; y < YResolution(); y++) 
-      oldBuffer[y] = (int) (GridValue(x, y) + 0.5);
-      		
-    // forward scan
-    s = 0;
-    for (y = 0; y < YResolution(); y++) {
-      dist = oldBuffer[y];
-      if (dist) {
-        for (t = s; t <= y ; t++) {
-          new_dist = oldBuffer[t] + (y - t) * (y - t);
-          if (new_dist <= dist){
-            dist = new_dist;
-            s = t;
-          }
-        }
-      }
-      else { 
-        s = y;
-      }
-      newBuffer[y] = dist;
-    }
-  
-    // backward scan
-    s = YResolution() - 1;
-    for(y = YResolution()-1; y >=0 ; y--) {
-      dist = newBuffer[y];
-      if (dist) {
-        for (t = s; t > y ; t--) {
-          new_dist = oldBuffer[t] + (y - t) * (y - t);
-          if (new_dist <= dist){
-            dist = new_dist;
-            s = t;
-          }
-        }
-        SetGridValue(x, y, dist);
-      }
-      else { 
-        s = y; 
-      }
-    }
-  }
-	
-  // Delete temporary buffers
-  delete[] oldBuffer;
-  delete[] newBuffer;
+  // Compute squared distances
+  DistanceTransform(XResolution(), YResolution(), grid_values, NULL);
 }
 
 
@@ -1908,140 +2230,27 @@ SquaredDistanceTransform(void)
 void R2Grid::
 Voronoi(R2Grid *squared_distance_grid)
 {
-  int dist;
-  int* old_dist;
-  int* new_dist;
-  RNScalar value;
-  RNScalar *old_value;
-  RNScalar *new_value;
-  R2Grid *dgrid;
-  int res,square,tmp_dist,first;
-  int x,y,s,t,i;
-
   // Allocate distance grid
+  R2Grid *dgrid;
   if (squared_distance_grid) dgrid = squared_distance_grid;
   else dgrid = new R2Grid(XResolution(), YResolution());
   assert(dgrid);
   dgrid->SetWorldToGridTransformation(WorldToGridTransformation());
 
-  // Allocate temporary buffers
-  res = XResolution();
-  if (res < YResolution()) res = YResolution();
-  old_dist = new int[res];
-  new_dist = new int[res];
-  old_value = new RNScalar[res];
-  new_value = new RNScalar[res];
-  assert(old_dist && new_dist && old_value && new_value);
-
   // Initalize distance grid values (0 if was set, max_value if not)
+  int res = XResolution();
+  if (res < YResolution()) res = YResolution();
   RNScalar max_value = 3 * (res+1) * (res+1);
-  for (i = 0; i < grid_size; i++) {
+  for (int i = 0; i < grid_size; i++) {
     if (grid_values[i] == 0.0) dgrid->grid_values[i] = max_value;
     else dgrid->grid_values[i] = 0.0;
   }
 
-  // Scan along x axis
-  for (y = 0; y < YResolution(); y++) {
-    first = 1;
-    value = 0;
-    dist = 0;
-    for (x = 0; x < XResolution(); x++) {
-      if (dgrid->GridValue(x,y) == 0.0) {
-        first=0;
-        dist=0;
-        value = GridValue(x,y);
-        assert(value != 0);
-      }
-      else if (first == 0) {
-        dist++;
-        square = dist*dist;
-        dgrid->SetGridValue(x, y, square);
-        SetGridValue(x, y, value);
-        assert(value != 0);
-      }
-    }
-			
-    // backward scan
-    dist = 0;
-    first = 1;
-    for (x = XResolution()-1; x >= 0; x--) {
-      if (dgrid->GridValue(x,y) == 0.0){
-        dist = 0;
-        first = 0;
-        value = GridValue(x,y);
-        assert(value != 0);
-      }
-      else if (first == 0) {
-        dist++;
-        square = dist*dist;
-        if (square < dgrid->GridValue(x, y)) {
-          dgrid->SetGridValue(x, y, square);
-          SetGridValue(x, y, value);
-          assert(value != 0);
-        }
-      }
-    }
-  }
-
-  // Scan along y axis
-  for (x = 0; x < XResolution(); x++) {
-    // Copy grid values
-    for (y = 0; y < YResolution(); y++) {
-      old_dist[y] = (int) (dgrid->GridValue(x, y));
-      old_value[y] = GridValue(x, y);
-    }
-			
-    // forward scan
-    s = 0;
-    for (y = 0; y < YResolution(); y++) {
-      dist = old_dist[y];
-      value = old_value[y];
-      if (dist) {
-        for (t = s; t <= y ; t++) {
-          tmp_dist = old_dist[t] + (y - t) * (y - t);
-          if (tmp_dist <= dist){
-            dist = tmp_dist;
-            value = old_value[t];
-            s = t;
-          }
-        }
-      }
-      else { 
-        s = y;
-      }
-      new_dist[y] = dist;
-      new_value[y] = value;
-    }
+  // Compute squared distances and propagate values of closest set grid cells
+  DistanceTransform(XResolution(), YResolution(), dgrid->grid_values, grid_values);
 
-    // backward scan
-    s = YResolution() - 1;
-    for(y = YResolution()-1; y >=0 ; y--) {
-      dist = new_dist[y];
-      value = new_value[y];
-      if (dist) {
-        for (t = s; t > y ; t--) {
-          tmp_dist = old_dist[t] + (y - t) * (y - t);
-          if (tmp_dist <= dist){
-            dist = tmp_dist;
-            value = old_value[t];
-            s = t;
-          }
-        }
-        dgrid->SetGridValue(x, y, dist);
-        SetGridValue(x, y, value);
-      }
-      else { 
-        s = y; 
-      }
-    }
-  }
-	
-  // Delete temporary buffers
+  // Delete temporary distance grid
   if (!squared_distance_grid) delete dgrid;
-  delete[] old_dist;
-  delete[] new_dist;
-  delete[] old_value;
-  delete[] new_value;
 }
 
 
@@ -3188,6 +3397,88 @@ ConnectedComponentFilter(RNScalar isolevel, RNArea min_grid_area, RNArea max_gri
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Connected component utility functions
+////////////////////////////////////////////////////////////////////////
+
+// Connected components are found with union-find.  Blocks of rows are
+// labeled in parallel, then sets are merged across block boundaries.
+// Every set is rooted at its smallest grid index, so parents always
+// precede their children, and a final pass in index order numbers the
+// components in the same order as a scan for unmarked seeds would.
+
+struct R2GridComponentData {
+  const RNScalar *values;
+  int *parents;
+  int xres, yres;
+  int rows_per_block;
+  RNScalar isolevel;
+};
+
+
+
+static int
+FindComponentRoot(int *parents, int index)
+{
+  // Find root with path halving
+  while (parents[index] != index) {
+    parents[index] = parents[parents[index]];
+    index = parents[index];
+  }
+  return index;
+}
+
+
+
+static void
+UnionComponents(int *parents, int index1, int index2)
+{
+  // Merge sets, keeping smallest index as root
+  int root1 = FindComponentRoot(parents, index1);
+  int root2 = FindComponentRoot(parents, index2);
+  if (root1 < root2) parents[root2] = root1;
+  else if (root2 < root1) parents[root1] = root2;
+}
+
+
+
+static int
+IsComponentValue(RNScalar value, RNScalar isolevel)
+{
+  // Return whether grid value belongs to some component
+  return ((value != R2_GRID_UNKNOWN_VALUE) && (value > isolevel));
+}
+
+
+
+static void
+LabelComponentBlock(int block, int, void *ptr)
+{
+  // Union 8-connected grid cells within block of rows
+  R2GridComponentData *data = (R2GridComponentData *) ptr;
+  const RNScalar *values = data->values;
+  int *parents = data->parents;
+  int xres = data->xres;
+  int y0 = block * data->rows_per_block;
+  int y1 = y0 + data->rows_per_block;
+  if (y1 > data->yres) y1 = data->yres;
+  for (int y = y0; y < y1; y++) {
+    int index = y * xres;
+    for (int x = 0; x < xres; x++, index++) {
+      if (!IsComponentValue(values[index], data->isolevel)) { parents[index] = -1; continue; }
+      parents[index] = index;
+      if ((x > 0) && (parents[index-1] >= 0)) UnionComponents(parents, index, index-1);
+      if (y == y0) continue;
+      int below = index - xres;
+      if ((x > 0) && (parents[below-1] >= 0)) UnionComponents(parents, index, below-1);
+      if (parents[below] >= 0) UnionComponents(parents, index, below);
+      if ((x < xres-1) && (parents[below+1] >= 0)) UnionComponents(parents, index, below+1);
+    }
+  }
+}
+
+
+
 int R2Grid::
 ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *sizes, int *grid_components)
 {
@@ -3198,116 +3489,50 @@ ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *size
     assert(components);
   }
 
-  // Initialize array of components
-  for (int i = 0; i < grid_size; i++) 
-    components[i] = -1;
-
-  // Find connected components
-  int ncomponents = 0;
-  int next_seed = 0;
-  while (TRUE){
-    // Find unmarked seed
-    int seed = next_seed;
-    while (seed < grid_size) { 
-      if ((components[seed] < 0) && (grid_values[seed] != R2_GRID_UNKNOWN_VALUE)&& (grid_values[seed] > isolevel)) break;
-      seed++;
+  // Union 8-connected grid cells within blocks of rows (components array holds parents)
+  int xres = XResolution();
+  int yres = YResolution();
+  R2GridComponentData data;
+  data.values = grid_values;
+  data.parents = components;
+  data.xres = xres;
+  data.yres = yres;
+  data.isolevel = isolevel;
+  data.rows_per_block = yres / (4 * RNNThreads()) + 1;
+  int nblocks = (yres + data.rows_per_block - 1) / data.rows_per_block;
+  RNParallelFor(nblocks, LabelComponentBlock, &data);
+
+  // Union 8-connected grid cells across block boundaries
+  for (int y = data.rows_per_block; y < yres; y += data.rows_per_block) {
+    for (int x = 0; x < xres; x++) {
+      int index = y * xres + x;
+      if (components[index] < 0) continue;
+      int below = index - xres;
+      if ((x > 0) && (components[below-1] >= 0)) UnionComponents(components, index, below-1);
+      if (components[below] >= 0) UnionComponents(components, index, below);
+      if ((x < xres-1) && (components[below+1] >= 0)) UnionComponents(components, index, below+1);
     }
+  }
 
-    // Check if found a seed
-    if (seed >= grid_size) break;
-
-    // Flood fill marking all grid entries 8-connected to seed
-    int x, y, neighbor;
-    int size = 0;
-    RNArray<RNScalar *> stack;
-    stack.Insert(&grid_values[seed]);
-    components[seed] = ncomponents;
-    while (!stack.IsEmpty()) {
-      // Pop top of stack
-      RNScalar *c = stack.Tail();
-      stack.RemoveTail();
-
-      // Add grid entry to component
-      int index = c - grid_values;
-      assert(index >= 0);
-      assert(index < grid_size);
-      assert(components[index] == ncomponents);
-      assert(grid_values[index] > isolevel);
-
-      // Add neighbors to stack
-      IndexToIndices(index, x, y);
-      if (x > 0) {
-        IndicesToIndex(x-1, y, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (x < XResolution()-1) {
-        IndicesToIndex(x+1, y, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE)&& (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (y > 0) {
-        IndicesToIndex(x, y-1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE)&& (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (y < YResolution()-1) {
-        IndicesToIndex(x, y+1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE)&& (grid_values[neighbor] > isolevel)) { 
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if ((x > 0) && (y > 0)) {
-        IndicesToIndex(x-1, y-1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if ((x > 0) && (y < YResolution()-1)) {
-        IndicesToIndex(x-1, y+1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if ((x < XResolution()-1) && (y > 0)) {
-        IndicesToIndex(x+1, y-1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if ((x < XResolution()-1) && (y < YResolution()-1)) {
-        IndicesToIndex(x+1, y+1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] != R2_GRID_UNKNOWN_VALUE) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
+  // Number components in order of their first grid cell
+  int ncomponents = 0;
+  for (int i = 0; i < grid_size; i++) {
+    int parent = components[i];
+    if (parent < 0) continue;
+    if (parent == i) {
+      if (ncomponents < max_components) {
+        if (seeds) seeds[ncomponents] = i;
+        if (sizes) sizes[ncomponents] = 0;
       }
-
-      // Increment component_size
-      size++;
+      components[i] = ncomponents++;
     }
-
-    // Update output variables
-    if (ncomponents < max_components) {
-      if (seeds) seeds[ncomponents] = seed;
-      if (sizes) sizes[ncomponents] = size;
+    else {
+      // Parents precede children, so parent already has its component identifier
+      components[i] = components[parent];
     }
-
-    // Increment the number of components
-    ncomponents++;
+    if (sizes && (components[i] < max_components)) sizes[components[i]]++;
   }
 
-
   // Delete components
   if (!grid_components) delete [] components;
 
@@ -4136,6 +4361,49 @@ WriteGridBuffer(char **buffer, size_t *buffer_length) const
 // PNG READ/WRITE
 ////////////////////////////////////////////////////////////////////////
 
+static void
+UnpackPNGRow(RNScalar *values, const unsigned char *row,
+  int width, int ncomponents, int bytes_per_component)
+{
+  // Unpack one decoded png row into grid values
+  // (written as branch-free loops over contiguous memory so that
+  // the compiler can vectorize the byte unpacking and color conversion)
+  int stride = ncomponents * bytes_per_component;
+  if (bytes_per_component == 1) {
+    if (ncomponents < 3) {
+      for (int i = 0; i < width; i++) {
+        values[i] = row[i*stride];
+      }
+    }
+    else {
+      for (int i = 0; i < width; i++) {
+        const unsigned char *p = &row[i*stride];
+        values[i] = 0.3*p[0] + 0.59*p[1] + 0.11*p[2];
+      }
+    }
+  }
+  else {
+    // Sixteen-bit png samples are big-endian
+    if (ncomponents < 3) {
+      for (int i = 0; i < width; i++) {
+        const unsigned char *p = &row[i*stride];
+        values[i] = (p[0] << 8) | p[1];
+      }
+    }
+    else {
+      for (int i = 0; i < width; i++) {
+        const unsigned char *p = &row[i*stride];
+        int r = (p[0] << 8) | p[1];
+        int g = (p[2] << 8) | p[3];
+        int b = (p[4] << 8) | p[5];
+        values[i] = 0.3*r + 0.59*g + 0.11*b;
+      }
+    }
+  }
+}
+
+
+
 int R2Grid::
 ReadPNGStream(FILE *fp)
 {
@@ -4165,11 +4433,7 @@ ReadPNGStream(FILE *fp)
   png_byte color_type = png_get_color_type(png_ptr, info_ptr);
   int width = png_get_image_width(png_ptr, info_ptr);
   int height = png_get_image_height(png_ptr, info_ptr);
-  int rowsize = png_get_rowbytes(png_ptr, info_ptr);
-  if ((rowsize % 4) != 0) rowsize = (rowsize / 4 + 1) * 4;
   png_byte depth = png_get_bit_depth(png_ptr, info_ptr);
-  int bytes_per_pixel = depth / 8;
-  assert(rowsize >= bytes_per_pixel * width);
 
   // Set ncomponents
   int ncomponents = 0;
@@ -4183,12 +4447,17 @@ ReadPNGStream(FILE *fp)
     return 0;
   }
 
-  // Allocate the pixels and row pointers 
+  // Unpack sub-byte samples into one byte each (without rescaling)
+  if (depth < 8) png_set_packing(png_ptr);
+  png_read_update_info(png_ptr, info_ptr);
+  int bytes_per_component = (depth > 8) ? 2 : 1;
+  int rowsize = png_get_rowbytes(png_ptr, info_ptr);
+  assert(rowsize >= ncomponents * bytes_per_component * width);
+
+  // Decode all rows into one contiguous buffer (first png row is top)
   unsigned char *pixels = new unsigned char [ height * rowsize ]; 
   png_bytep *row_pointers = (png_bytep *) png_malloc(png_ptr, height * sizeof(png_bytep));
-  for (int i = 0; i < height; i++) row_pointers[i] = &pixels[ (height - i - 1) * rowsize ];
-
-  // Read the pixels 
+  for (int i = 0; i < height; i++) row_pointers[i] = &pixels[ i * rowsize ];
   png_read_image(png_ptr, row_pointers);
 
   // Finish reading 
@@ -4204,25 +4473,11 @@ ReadPNGStream(FILE *fp)
   grid_to_world_transform = R2identity_affine;
   if (grid_values) delete [] grid_values;
   grid_values = new RNScalar [ grid_size ];
-  for (int j = 0; j < height; j++) {
-    for (int i = 0; i < width; i++) {
-      int rgba[4];
-      for (int k = 0; k < ncomponents; k++) {
-        rgba[k] = 0;
-        for (int d = 0; d < bytes_per_pixel; d++) {
-          rgba[k] = rgba[k] << 8;
-          rgba[k] += row_pointers[height - 1 - j][bytes_per_pixel*i+d];
-        }
-      }
 
-      // Compute value
-      RNScalar value = 0;
-      if (ncomponents == 1) value = rgba[0];
-      else if (ncomponents == 2) value = rgba[0];
-      else if (ncomponents == 3) value = 0.3*rgba[0] + 0.59*rgba[1] + 0.11*rgba[2];
-      else if (ncomponents == 4) value = 0.3*rgba[0] + 0.59*rgba[1] + 0.11*rgba[2];
-      SetGridValue(i, j, value);
-    }
+  // Unpack rows directly into grid values (first grid row is bottom)
+  for (int j = 0; j < height; j++) {
+    UnpackPNGRow(&grid_values[j * width], row_pointers[height - 1 - j],
+      width, ncomponents, bytes_per_component);
   }
 
   // Free the row pointers 
@@ -4422,6 +4677,194 @@ WritePNGBuffer(char **buffer, size_t *buffer_length) const
 
 
 
+////////////////////////////////////////////////////////////////////////
+// UNCOMPRESSED READ/WRITE
+////////////////////////////////////////////////////////////////////////
+
+// Uncompressed grids have a 16-byte header (magic, xres, yres, bytes
+// per value) followed by 16-bit values in native byte order, quantized
+// the same way as in WritePNGStream, so that they can be copied (or mapped)
+// directly from a pixel database without decoding
+
+static const unsigned int uncompressed_grid_magic = 0x36314752;
+
+
+
+static void
+UnpackUInt16Values(RNScalar *values, const RNUInt16 *data, int count)
+{
+  // Convert 16-bit values to scalars (vectorizable loop)
+  for (int i = 0; i < count; i++) values[i] = data[i];
+}
+
+
+
+static int
+CheckUncompressedGridHeader(const unsigned int header[4], size_t length)
+{
+  // Check dimensions (number of values must fit in an int)
+  unsigned int width = header[1];
+  unsigned int height = header[2];
+  if ((width == 0) || (height == 0) || (width > INT_MAX) || (height > INT_MAX) || (width > INT_MAX / height)) {
+    RNFail("Invalid resolution in uncompressed grid header: %u %u\n", width, height);
+    return 0;
+  }
+
+  // Check length of entry (if known)
+  if ((length > 0) && (length != 4 * sizeof(unsigned int) + (size_t) width * height * sizeof(RNUInt16))) {
+    RNFail("Size of uncompressed grid does not match length of entry\n");
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2Grid::
+ReadUncompressedBuffer(const char *buffer, size_t buffer_length)
+{
+  // Parse header
+  unsigned int header[4];
+  if (buffer_length < sizeof(header)) {
+    RNFail("Invalid uncompressed grid buffer\n");
+    return 0;
+  }
+  memcpy(header, buffer, sizeof(header));
+  if ((header[0] != uncompressed_grid_magic) || (header[3] != sizeof(RNUInt16))) {
+    RNFail("Invalid header in uncompressed grid buffer\n");
+    return 0;
+  }
+
+  // Check resolution and buffer length
+  if (!CheckUncompressedGridHeader(header, buffer_length)) return 0;
+  int width = header[1];
+  int height = header[2];
+
+  // Fill in grid info
+  grid_resolution[0] = width;
+  grid_resolution[1] = height;
+  grid_row_size = width;
+  grid_size = width * height;
+  world_to_grid_scale_factor = 1;
+  world_to_grid_transform = R2identity_affine;
+  grid_to_world_transform = R2identity_affine;
+  if (grid_values) delete [] grid_values;
+  grid_values = (grid_size > 0) ? new RNScalar [ grid_size ] : NULL;
+
+  // Unpack values
+  const char *data = buffer + sizeof(header);
+  if (((size_t) data % sizeof(RNUInt16)) == 0) {
+    UnpackUInt16Values(grid_values, (const RNUInt16 *) data, grid_size);
+  }
+  else {
+    for (int i = 0; i < grid_size; i++) {
+      RNUInt16 value;
+      memcpy(&value, &data[i * sizeof(RNUInt16)], sizeof(RNUInt16));
+      grid_values[i] = value;
+    }
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2Grid::
+ReadUncompressedStream(FILE *fp, size_t stream_length)
+{
+  // Use stdin if no fp provided
+  if (!fp) fp = stdin;
+
+  // Read header
+  unsigned int header[4];
+  if (fread(header, sizeof(unsigned int), 4, fp) != 4) {
+    RNFail("Unable to read uncompressed grid header\n");
+    return 0;
+  }
+  if ((header[0] != uncompressed_grid_magic) || (header[3] != sizeof(RNUInt16))) {
+    RNFail("Invalid header in uncompressed grid stream\n");
+    return 0;
+  }
+
+  // Check resolution
+  if (!CheckUncompressedGridHeader(header, stream_length)) return 0;
+
+  // Read values
+  int width = header[1];
+  int height = header[2];
+  RNUInt16 *data = new RNUInt16 [ width * height + 1 ];
+  if (fread(data, sizeof(RNUInt16), width * height, fp) != (size_t) (width * height)) {
+    RNFail("Unable to read uncompressed grid values\n");
+    delete [] data;
+    return 0;
+  }
+
+  // Fill in grid info
+  grid_resolution[0] = width;
+  grid_resolution[1] = height;
+  grid_row_size = width;
+  grid_size = width * height;
+  world_to_grid_scale_factor = 1;
+  world_to_grid_transform = R2identity_affine;
+  grid_to_world_transform = R2identity_affine;
+  if (grid_values) delete [] grid_values;
+  grid_values = (grid_size > 0) ? new RNScalar [ grid_size ] : NULL;
+
+  // Unpack values
+  UnpackUInt16Values(grid_values, data, grid_size);
+
+  // Delete values
+  delete [] data;
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2Grid::
+WriteUncompressedStream(FILE *fp) const
+{
+  // Use stdout if no fp provided
+  if (!fp) fp = stdout;
+
+  // Write header
+  unsigned int header[4] = { uncompressed_grid_magic,
+    (unsigned int) grid_resolution[0], (unsigned int) grid_resolution[1],
+    (unsigned int) sizeof(RNUInt16) };
+  if (fwrite(header, sizeof(unsigned int), 4, fp) != 4) {
+    RNFail("Unable to write uncompressed grid header\n");
+    return 0;
+  }
+
+  // Quantize values (as in WritePNGStream)
+  RNUInt16 *data = new RNUInt16 [ grid_size + 1 ];
+  for (int i = 0; i < grid_size; i++) {
+    RNScalar value = grid_values[i];
+    if (value == R2_GRID_UNKNOWN_VALUE) data[i] = 0;
+    else if (value > 65535) data[i] = 65535;
+    else data[i] = (unsigned int) value;
+  }
+
+  // Write values
+  if (fwrite(data, sizeof(RNUInt16), grid_size, fp) != (size_t) grid_size) {
+    RNFail("Unable to write uncompressed grid values\n");
+    delete [] data;
+    return 0;
+  }
+
+  // Delete values
+  delete [] data;
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // IMAGE READ/WRITE
 ////////////////////////////////////////////////////////////////////////
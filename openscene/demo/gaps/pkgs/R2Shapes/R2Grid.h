@@ -90,6 +90,7 @@ public:
   void AddNoise(RNScalar sigma_fraction = 0.05);
   void HarrisCornerFilter(int grid_radius = 3, RNScalar kappa = 0.05);
   void BilateralFilter(RNLength grid_sigma = 2, RNScalar value_sigma = -1, RNBoolean value_sigma_is_fraction = FALSE);
+  void BilateralGridFilter(RNLength grid_sigma = 8, RNScalar value_sigma = -1);
   void AnisotropicDiffusion(RNLength grid_sigma = 2, RNScalar gradient_sigma = -1);
   void PercentileFilter(RNLength grid_radius, RNScalar percentile);
   void MinFilter(RNLength grid_radius);
@@ -205,12 +206,15 @@ public:
   int ReadPNGBuffer(char *buffer, size_t buffer_length);
   int WriteGridBuffer(char **buffer, size_t *buffer_length) const;
   int WritePNGBuffer(char **buffer, size_t *buffer_length) const;
+  int ReadUncompressedBuffer(const char *buffer, size_t buffer_length);
 
   // Stream reading/writing
   int ReadGridStream(FILE *fp = NULL);
   int ReadPNGStream(FILE *fp = NULL);
   int WriteGridStream(FILE *fp = NULL) const;
   int WritePNGStream(FILE *fp = NULL) const;
+  int ReadUncompressedStream(FILE *fp = NULL, size_t stream_length = 0);
+  int WriteUncompressedStream(FILE *fp = NULL) const;
 
   // Frame buffer capture functions
   void Capture(void);
@@ -247,6 +251,7 @@ public:
   int WriteGrid(FILE *fp = NULL) const { return WriteGridStream(fp); }
 
 private:
+  friend class R2CompactGrid;
   R2Affine grid_to_world_transform;
   R2Affine world_to_grid_transform;
   RNScalar world_to_grid_scale_factor;
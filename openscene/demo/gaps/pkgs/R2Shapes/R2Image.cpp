@@ -1337,6 +1337,7 @@ ReadJPEGStream(FILE *fp)
 
   // Allocate image pixels
   int nbytes = rowsize * height;
+  if (this->pixels) delete [] this->pixels;
   this->pixels = new unsigned char [nbytes];
   if (!this->pixels) {
     RNFail("Unable to allocate memory for JPEG file");
@@ -1344,12 +1345,18 @@ ReadJPEGStream(FILE *fp)
     return 0;
   }
 
-  // Read scan lines 
+  // Read scan lines directly into pixels, several at a time
   // First jpeg pixel is top-left, so read pixels in opposite scan-line order
+  const int max_scanlines = 16;
+  unsigned char *row_pointers[max_scanlines];
   while (cinfo.output_scanline < cinfo.output_height) {
-    int scanline = cinfo.output_height - cinfo.output_scanline - 1;
-    unsigned char *row_pointer = &pixels[scanline * rowsize];
-    jpeg_read_scanlines(&cinfo, &row_pointer, 1);
+    int nscanlines = cinfo.output_height - cinfo.output_scanline;
+    if (nscanlines > max_scanlines) nscanlines = max_scanlines;
+    for (int i = 0; i < nscanlines; i++) {
+      int scanline = cinfo.output_height - cinfo.output_scanline - i - 1;
+      row_pointers[i] = &pixels[scanline * rowsize];
+    }
+    jpeg_read_scanlines(&cinfo, row_pointers, nscanlines);
   }
 
   // Free everything
@@ -1676,15 +1683,20 @@ ReadPNGStream(FILE *fp)
   png_byte color_type = png_get_color_type(png_ptr, info_ptr);
   width = png_get_image_width(png_ptr, info_ptr);
   height = png_get_image_height(png_ptr, info_ptr);
+
+  // Have libpng decode directly to 8-bit samples
+  if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png_ptr);
+  else if ((color_type == PNG_COLOR_TYPE_GRAY) && (bit_depth < 8)) png_set_expand_gray_1_2_4_to_8(png_ptr);
+  if (bit_depth == 16) png_set_strip_16(png_ptr);
+  png_read_update_info(png_ptr, info_ptr);
+  color_type = png_get_color_type(png_ptr, info_ptr);
   rowsize = png_get_rowbytes(png_ptr, info_ptr);
   if ((rowsize % 4) != 0) rowsize = (rowsize / 4 + 1) * 4;
 
   // Set ncomponents
-  // ncomponents = bit_depth/8; ???
   ncomponents = 0;
   if (color_type == PNG_COLOR_TYPE_GRAY) ncomponents = 1;
   else if (color_type == PNG_COLOR_TYPE_GRAY_ALPHA) ncomponents = 2;
-  else if (color_type == PNG_COLOR_TYPE_PALETTE) ncomponents = bit_depth/8;
   else if (color_type == PNG_COLOR_TYPE_RGB) ncomponents = 3;
   else if (color_type == PNG_COLOR_TYPE_RGB_ALPHA) ncomponents = 4;
   else { 
@@ -1694,6 +1706,7 @@ ReadPNGStream(FILE *fp)
   }
 
   // Allocate the pixels and row pointers
+  if (pixels) delete [] pixels;
   pixels = new unsigned char [ height * rowsize ]; 
   png_bytep *row_pointers = (png_bytep *) png_malloc(png_ptr, height * sizeof(png_bytep));
   for (int i = 0; i < height; i++) row_pointers[i] = &pixels[ (height - i - 1) * rowsize ];
@@ -1884,6 +1897,161 @@ WritePNGBuffer(char **buffer, size_t *buffer_length) const
 
 
 
+////////////////////////////////////////////////////////////////////////
+// UNCOMPRESSED I/O
+////////////////////////////////////////////////////////////////////////
+
+// Uncompressed images have a 16-byte header (magic, width, height,
+// ncomponents) followed by the pixel rows exactly as stored in memory
+// (first row is bottom, rows padded to four bytes)
+
+static const unsigned int uncompressed_image_magic = 0x38304952;
+
+
+
+static int
+UncompressedImageRowSize(const unsigned int header[4], size_t length)
+{
+  // Check dimensions
+  unsigned int w = header[1];
+  unsigned int h = header[2];
+  unsigned int c = header[3];
+  if ((w == 0) || (h == 0) || (c == 0) || (c > 4) || (w > INT_MAX) || (h > INT_MAX)) {
+    RNFail("Invalid dimensions in uncompressed image header: %u %u %u\n", w, h, c);
+    return 0;
+  }
+
+  // Compute row size (padded to four bytes) and check that pixels fit in an int
+  unsigned long long r = (unsigned long long) c * w;
+  if ((r % 4) != 0) r = (r / 4 + 1) * 4;
+  if (r > (unsigned long long) (INT_MAX / h)) {
+    RNFail("Uncompressed image is too large: %u x %u x %u\n", w, h, c);
+    return 0;
+  }
+
+  // Check length of entry (if known)
+  if ((length > 0) && (length != 4 * sizeof(unsigned int) + r * h)) {
+    RNFail("Size of uncompressed image does not match length of entry\n");
+    return 0;
+  }
+
+  // Return row size
+  return (int) r;
+}
+
+
+
+int R2Image::
+ReadUncompressedBuffer(const char *buffer, size_t buffer_length)
+{
+  // Parse header
+  unsigned int header[4];
+  if (buffer_length < sizeof(header)) {
+    RNFail("Invalid uncompressed image buffer\n");
+    return 0;
+  }
+  memcpy(header, buffer, sizeof(header));
+  if (header[0] != uncompressed_image_magic) {
+    RNFail("Invalid header in uncompressed image buffer\n");
+    return 0;
+  }
+
+  // Check dimensions and compute row size
+  int r = UncompressedImageRowSize(header, buffer_length);
+  if (r == 0) return 0;
+  int w = header[1];
+  int h = header[2];
+  int c = header[3];
+
+  // Reallocate pixels if size changed
+  if (!pixels || (r * h != rowsize * height)) {
+    if (pixels) delete [] pixels;
+    pixels = (r * h > 0) ? new unsigned char [ r * h ] : NULL;
+  }
+
+  // Fill in image info
+  width = w;
+  height = h;
+  ncomponents = c;
+  rowsize = r;
+
+  // Copy pixels
+  if (pixels) memcpy(pixels, buffer + sizeof(header), rowsize * height);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2Image::
+ReadUncompressedStream(FILE *fp, size_t stream_length)
+{
+  // Read header
+  unsigned int header[4];
+  if (fread(header, sizeof(unsigned int), 4, fp) != 4) {
+    RNFail("Unable to read uncompressed image header\n");
+    return 0;
+  }
+  if (header[0] != uncompressed_image_magic) {
+    RNFail("Invalid header in uncompressed image stream\n");
+    return 0;
+  }
+
+  // Check dimensions and compute row size
+  int r = UncompressedImageRowSize(header, stream_length);
+  if (r == 0) return 0;
+  int w = header[1];
+  int h = header[2];
+  int c = header[3];
+
+  // Reallocate pixels if size changed
+  if (!pixels || (r * h != rowsize * height)) {
+    if (pixels) delete [] pixels;
+    pixels = (r * h > 0) ? new unsigned char [ r * h ] : NULL;
+  }
+
+  // Fill in image info
+  width = w;
+  height = h;
+  ncomponents = c;
+  rowsize = r;
+
+  // Read pixels
+  if (fread(pixels, 1, rowsize * height, fp) != (size_t) (rowsize * height)) {
+    RNFail("Unable to read uncompressed image pixels\n");
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R2Image::
+WriteUncompressedStream(FILE *fp) const
+{
+  // Write header
+  unsigned int header[4] = { uncompressed_image_magic,
+    (unsigned int) width, (unsigned int) height, (unsigned int) ncomponents };
+  if (fwrite(header, sizeof(unsigned int), 4, fp) != 4) {
+    RNFail("Unable to write uncompressed image header\n");
+    return 0;
+  }
+
+  // Write pixels
+  if (fwrite(pixels, 1, rowsize * height, fp) != (size_t) (rowsize * height)) {
+    RNFail("Unable to write uncompressed image pixels\n");
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // RAW I/O
 ////////////////////////////////////////////////////////////////////////
@@ -68,6 +68,7 @@ class R2Image {
   int WriteBuffer(char **buffer, size_t *buffer_length) const;
   int WritePNGBuffer(char **buffer, size_t *buffer_length) const;
   int WriteJPEGBuffer(char **buffer, size_t *buffer_length) const;
+  int ReadUncompressedBuffer(const char *buffer, size_t buffer_length);
   
   // Stream reading/writing
   int ReadStream(FILE *fp);
@@ -76,6 +77,8 @@ class R2Image {
   int WriteStream(FILE *fp) const;
   int WritePNGStream(FILE *fp) const;
   int WriteJPEGStream(FILE *fp) const;
+  int ReadUncompressedStream(FILE *fp, size_t stream_length = 0);
+  int WriteUncompressedStream(FILE *fp) const;
   
   // Capture functions
   void Capture(void);
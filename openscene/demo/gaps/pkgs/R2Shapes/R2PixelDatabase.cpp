@@ -8,6 +8,7 @@
 
 #include "R2Shapes.h"
 #include <algorithm>
+#include <mutex>
 
 
 
@@ -24,7 +25,10 @@ namespace gaps {
 ////////////////////////////////////////////////////////////////////////
 
 static const unsigned int current_major_version = 0;
-static const unsigned int current_minor_version = 1;
+static const unsigned int current_minor_version = 2;
+
+// Serializes entries read by seeking on the shared file pointer
+static std::mutex stream_mutex;
 
 
 
@@ -77,7 +81,9 @@ R2PixelDatabase(void)
     entries_count(0),
     entries_seek(0),
     map(),
-    keys()
+    keys(),
+    mapped_data(NULL),
+    mapped_size(0)
 {
 }
 
@@ -95,7 +101,9 @@ R2PixelDatabase(const R2PixelDatabase& database)
     entries_count(0),
     entries_seek(0),
     map(),
-    keys()
+    keys(),
+    mapped_data(NULL),
+    mapped_size(0)
 {
   RNAbort("Not implemented");
 }
@@ -113,6 +121,9 @@ R2PixelDatabase::
 
   // Delete rwaccess
   if (rwaccess) free(rwaccess);
+
+  // Unmap file
+  if (mapped_data) RNUnmapFile(mapped_data, mapped_size);
 }
 
 
@@ -144,14 +155,37 @@ FindImage(const char *key, R2Image *image) const
 
   // Read image
   if (image) {
-    // Seek to start of entry
-    RNFileSeek(fp, entry.seek, RN_FILE_SEEK_SET);
-  
-    // Read entry
-    if (!image->ReadPNGStream(fp)) {
-      RNFail("Error reading %s from pixel database\n", key);
+    // Check byte order (uncompressed entries are stored in byte order of writer)
+    if (swap_endian && (entry.format == R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT)) {
+      RNFail("Unable to read uncompressed %s from pixel database with different byte order\n", key);
       return FALSE;
     }
+
+    if (mapped_data && (entry.seek + entry.size <= mapped_size)) {
+      // Read entry from mapped file (safe to do concurrently)
+      const char *buffer = &mapped_data[entry.seek];
+      int status = (entry.format == R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT) ?
+        image->ReadUncompressedBuffer(buffer, entry.size) :
+        image->ReadPNGBuffer(buffer, entry.size);
+      if (!status) {
+        RNFail("Error reading %s from pixel database\n", key);
+        return FALSE;
+      }
+    }
+    else {
+      // Seek to start of entry (one thread at a time, because the file pointer is shared)
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      RNFileSeek(fp, entry.seek, RN_FILE_SEEK_SET);
+  
+      // Read entry
+      int status = (entry.format == R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT) ?
+        image->ReadUncompressedStream(fp, entry.size) :
+        image->ReadPNGStream(fp);
+      if (!status) {
+        RNFail("Error reading %s from pixel database\n", key);
+        return FALSE;
+      }
+    }
   }
 
   // Return success
@@ -169,15 +203,38 @@ FindGrid(const char *key, R2Grid *grid, RNBoolean apply_transformation) const
 
   // Read grid
   if (grid) {
-    // Seek to start of entry
-    RNFileSeek(fp, entry.seek, RN_FILE_SEEK_SET);
-  
-    // Read entry
-    if (!grid->ReadPNGStream(fp)) {
-      RNFail("Error reading %s from pixel database\n", key);
+    // Check byte order (uncompressed entries are stored in byte order of writer)
+    if (swap_endian && (entry.format == R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT)) {
+      RNFail("Unable to read uncompressed %s from pixel database with different byte order\n", key);
       return FALSE;
     }
 
+    if (mapped_data && (entry.seek + entry.size <= mapped_size)) {
+      // Read entry from mapped file (safe to do concurrently)
+      char *buffer = &mapped_data[entry.seek];
+      int status = (entry.format == R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT) ?
+        grid->ReadUncompressedBuffer(buffer, entry.size) :
+        grid->ReadPNGBuffer(buffer, entry.size);
+      if (!status) {
+        RNFail("Error reading %s from pixel database\n", key);
+        return FALSE;
+      }
+    }
+    else {
+      // Seek to start of entry (one thread at a time, because the file pointer is shared)
+      std::lock_guard<std::mutex> lock(stream_mutex);
+      RNFileSeek(fp, entry.seek, RN_FILE_SEEK_SET);
+  
+      // Read entry
+      int status = (entry.format == R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT) ?
+        grid->ReadUncompressedStream(fp, entry.size) :
+        grid->ReadPNGStream(fp);
+      if (!status) {
+        RNFail("Error reading %s from pixel database\n", key);
+        return FALSE;
+      }
+    }
+
     // Check if should apply transformation
     if (apply_transformation) {
       // Apply offset 
@@ -218,22 +275,47 @@ GetFormat(const char *key) const
 // ENTRY MANIPULATION FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
 
+static int
+AlignEntry(FILE *fp, unsigned long long *seek)
+{
+  // Pad file so that uncompressed entries start on 16-byte boundaries
+  // (then their values are aligned when the file is mapped)
+  static const char zeros[16] = { '\0' };
+  int npad = (int) ((16 - (*seek % 16)) % 16);
+  if ((npad > 0) && (fwrite(zeros, 1, npad, fp) != (size_t) npad)) return 0;
+  *seek += npad;
+  return 1;
+}
+
+
+
 int R2PixelDatabase::
-InsertImage(const char *key, const R2Image& image)
+InsertImage(const char *key, const R2Image& image, int format)
 {
   // Seek to end of entries
   unsigned long long seek = entries_seek;
   RNFileSeek(fp, seek, RN_FILE_SEEK_SET);
 
   // Write pixels to file
-  if (!image.WritePNGStream(fp)) return FALSE;
+  if (format == R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT) {
+    if (swap_endian) {
+      RNFail("Unable to insert uncompressed %s into pixel database with different byte order\n", key);
+      return FALSE;
+    }
+    if (!AlignEntry(fp, &seek)) return FALSE;
+    if (!image.WriteUncompressedStream(fp)) return FALSE;
+  }
+  else {
+    format = R2_PIXEL_DATABASE_3_8_PNG_FORMAT;
+    if (!image.WritePNGStream(fp)) return FALSE;
+  }
 
   // Update entries seek
   entries_seek = RNFileTell(fp);
   unsigned int size = entries_seek - seek;
   
   // Insert entry into map
-  R2PixelDatabaseEntry entry(key, R2_PIXEL_DATABASE_3_8_PNG_FORMAT, size, seek);
+  R2PixelDatabaseEntry entry(key, format, size, seek);
   map.Insert(key, entry);
 
   // Insert key
@@ -250,12 +332,22 @@ InsertImage(const char *key, const R2Image& image)
 
 int R2PixelDatabase::
 InsertGrid(const char *key, const R2Grid& grid,
-  double offset, double scale, double exponent, RNBoolean apply_transformation)
+  double offset, double scale, double exponent, RNBoolean apply_transformation,
+  int format)
 {
   // Seek to end of entries
   unsigned long long seek = entries_seek;
   RNFileSeek(fp, seek, RN_FILE_SEEK_SET);
 
+  // Check format
+  RNBoolean uncompressed = (format == R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT);
+  if (!uncompressed) format = R2_PIXEL_DATABASE_1_16_PNG_FORMAT;
+  if (uncompressed && swap_endian) {
+    RNFail("Unable to insert uncompressed %s into pixel database with different byte order\n", key);
+    return FALSE;
+  }
+  if (uncompressed && !AlignEntry(fp, &seek)) return FALSE;
+
   // Check if need to apply offset, scale, or exponent
   if ((apply_transformation) &&
       ((offset != 0) || (scale != 1) || (exponent != 1))) {
@@ -264,11 +356,13 @@ InsertGrid(const char *key, const R2Grid& grid,
     if (exponent != 1) tmp.Pow(exponent);
     if (scale != 1) tmp.Multiply(scale);
     if (offset != 0) tmp.Add(offset);
-    if (!tmp.WritePNGStream(fp)) return FALSE;
+    if (uncompressed && !tmp.WriteUncompressedStream(fp)) return FALSE;
+    if (!uncompressed && !tmp.WritePNGStream(fp)) return FALSE;
   }
   else {
     // Write original pixels to file
-    if (!grid.WritePNGStream(fp)) return FALSE;
+    if (uncompressed && !grid.WriteUncompressedStream(fp)) return FALSE;
+    if (!uncompressed && !grid.WritePNGStream(fp)) return FALSE;
   }
 
   // Update entries seek
@@ -276,7 +370,7 @@ InsertGrid(const char *key, const R2Grid& grid,
   unsigned int size = entries_seek - seek;
   
   // Insert entry into map
-  R2PixelDatabaseEntry entry(key, R2_PIXEL_DATABASE_1_16_PNG_FORMAT, size, seek, offset, scale, exponent);
+  R2PixelDatabaseEntry entry(key, format, size, seek, offset, scale, exponent);
   map.Insert(key, entry);
   
   // Insert key
@@ -354,6 +448,12 @@ OpenFile(const char *filename, const char *rwaccess)
 
     // Read entries
     if (!ReadEntries(fp, swap_endian)) return 0;
+
+    // Map read-only file, so that entries can be read without
+    // seeking the shared file pointer (NULL if mapping is not supported)
+    if (!strcmp(this->rwaccess, "rb") && !swap_endian) {
+      mapped_data = (char *) RNMapFile(filename, &mapped_size);
+    }
   }
 
   // Return success
@@ -374,6 +474,11 @@ CloseFile(void)
     if (!WriteHeader(fp, swap_endian)) return 0;
   }
 
+  // Unmap file
+  if (mapped_data) RNUnmapFile(mapped_data, mapped_size);
+  mapped_data = NULL;
+  mapped_size = 0;
+
   // Close file
   fclose(fp);
   fp = NULL;
@@ -8,7 +8,18 @@
 namespace gaps {
 
 
+
+////////////////////////////////////////////////////////////////////////
+// FORMAT CONSTANTS
+////////////////////////////////////////////////////////////////////////
+
+#define R2_PIXEL_DATABASE_3_8_PNG_FORMAT  0
+#define R2_PIXEL_DATABASE_1_16_PNG_FORMAT 1
+#define R2_PIXEL_DATABASE_3_8_UNCOMPRESSED_FORMAT  2
+#define R2_PIXEL_DATABASE_1_16_UNCOMPRESSED_FORMAT 3
+
   
+
 // Class definition
 
 class R2PixelDatabase {
@@ -33,10 +44,12 @@ public:
   virtual void SetName(const char *name);
 
   // Entry manipulation functions
-  virtual int InsertImage(const char *key, const R2Image& image);
+  virtual int InsertImage(const char *key, const R2Image& image,
+    int format = R2_PIXEL_DATABASE_3_8_PNG_FORMAT);
   virtual int InsertGrid(const char *key, const R2Grid& grid,
     double offset = 0, double scale = 1, double exponent = 1,
-    RNBoolean apply_transformation = TRUE);
+    RNBoolean apply_transformation = TRUE,
+    int format = R2_PIXEL_DATABASE_1_16_PNG_FORMAT);
   virtual int Remove(const char *key);
 
   // File I/O functions
@@ -70,19 +83,12 @@ private:
   unsigned long long entries_seek;
   RNSymbolTable<struct R2PixelDatabaseEntry> map;
   std::vector<std::string> keys;
+  char *mapped_data;
+  unsigned long long mapped_size;
 };
 
 
 
-////////////////////////////////////////////////////////////////////////
-// FORMAT CONSTANTS
-////////////////////////////////////////////////////////////////////////
-
-#define R2_PIXEL_DATABASE_3_8_PNG_FORMAT  0
-#define R2_PIXEL_DATABASE_1_16_PNG_FORMAT 1
-
-  
-
 ////////////////////////////////////////////////////////////////////////
 // INLINE FUNCTION DEFINITIONS
 ////////////////////////////////////////////////////////////////////////
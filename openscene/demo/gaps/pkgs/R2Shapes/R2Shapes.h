@@ -35,6 +35,7 @@ class R2Box;
 class R2Circle;
 class R2Polygon;
 class R2Grid;
+class R2CompactGrid;
 class R2PixelDatabase;
 }
 
@@ -92,6 +93,7 @@ class R2PixelDatabase;
 /* Image/grid include files */
 
 #include "R2Grid.h"
+#include "R2CompactGrid.h"
 #include "R2PixelDatabase.h"
 
 
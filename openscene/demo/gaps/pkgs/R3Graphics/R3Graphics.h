@@ -48,6 +48,9 @@ class R3SceneElement;
 #include "R2Viewport.h"
 #include "R3Camera.h"
 #include "R3Viewer.h"
+#include "R3Rasterizer.h"
+#include "R3ViewCuller.h"
+#include "R3PointPicker.h"
 
 
 
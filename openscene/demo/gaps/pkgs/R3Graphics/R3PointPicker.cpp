@@ -0,0 +1,357 @@
+// Source file for CPU-side point picking and selection (ray, lasso, and sphere queries)
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Graphics.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Projection utility functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3PointPickerProjection {
+  R3Point eye;
+  R3Vector towards, right, up;
+  RNScalar neardist;
+  RNScalar cx, cy, fx, fy;
+};
+
+
+
+static void
+InitializeProjection(R3PointPickerProjection& projection, const R3Viewer& viewer)
+{
+  // Remember camera frame and viewport mapping (matches R3Viewer::WorldRay)
+  const R3Camera& camera = viewer.Camera();
+  const R2Viewport& viewport = viewer.Viewport();
+  projection.eye = camera.Origin();
+  projection.towards = camera.Towards();
+  projection.right = camera.Right();
+  projection.up = camera.Up();
+  projection.neardist = camera.Near();
+  projection.cx = viewport.XCenter();
+  projection.cy = viewport.YCenter();
+  projection.fx = 0.5 * viewport.Width() / tan(camera.XFOV());
+  projection.fy = 0.5 * viewport.Height() / tan(camera.YFOV());
+}
+
+
+
+static RNBoolean
+ProjectBox(const R3PointPickerProjection& projection, const R3Box& box,
+  RNScalar *xmin, RNScalar *ymin, RNScalar *xmax, RNScalar *ymax, RNScalar *zmin, RNScalar *zmax)
+{
+  // Compute depth range and extent of projection of box corners
+  // (returns FALSE if box crosses near plane, in which case extent is unknown)
+  RNBoolean in_front = TRUE;
+  *xmin = *ymin = *zmin = FLT_MAX;
+  *xmax = *ymax = *zmax = -FLT_MAX;
+  for (int octant = 0; octant < 8; octant++) {
+    R3Vector v = box.Corner(octant) - projection.eye;
+    RNScalar z = v.Dot(projection.towards);
+    if (z < *zmin) *zmin = z;
+    if (z > *zmax) *zmax = z;
+    if (z <= projection.neardist) { in_front = FALSE; continue; }
+    RNScalar x = projection.cx + projection.fx * v.Dot(projection.right) / z;
+    RNScalar y = projection.cy + projection.fy * v.Dot(projection.up) / z;
+    if (x < *xmin) *xmin = x;
+    if (x > *xmax) *xmax = x;
+    if (y < *ymin) *ymin = y;
+    if (y > *ymax) *ymax = y;
+  }
+
+  // Return whether whole box is in front of near plane
+  return in_front;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor functions
+////////////////////////////////////////////////////////////////////////
+
+R3PointPicker::
+R3PointPicker(void)
+  : groups(),
+    npoints(0),
+    bbox(R3null_box),
+    clip_box(R3null_box)
+{
+}
+
+
+
+R3PointPicker::
+~R3PointPicker(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Insert functions
+////////////////////////////////////////////////////////////////////////
+
+void R3PointPicker::
+InsertGroup(const float *positions, int npoints, int stride, const R3Box& bbox,
+  const R3Point& origin, int first_index)
+{
+  // Check group
+  if (npoints <= 0) return;
+
+  // Insert group
+  Group group;
+  group.positions = (const unsigned char *) positions;
+  group.npoints = npoints;
+  group.stride = (stride > 0) ? stride : 3 * sizeof(float);
+  group.bbox = bbox;
+  group.origin = origin;
+  group.first_index = (first_index >= 0) ? first_index : this->npoints;
+  groups.push_back(group);
+
+  // Update totals
+  this->npoints += npoints;
+  this->bbox.Union(bbox);
+}
+
+
+
+void R3PointPicker::
+Empty(void)
+{
+  // Remove all groups
+  groups.clear();
+  npoints = 0;
+  bbox = R3null_box;
+}
+
+
+
+void R3PointPicker::
+SetClipBox(const R3Box& box)
+{
+  // Set box outside of which points are ignored
+  clip_box = box;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Query functions
+////////////////////////////////////////////////////////////////////////
+
+int R3PointPicker::
+PickPoint(const R3Viewer& viewer, RNScalar x, RNScalar y, RNScalar tolerance,
+  R3Point *position, RNLength *depth) const
+{
+  // Initialize projection
+  R3PointPickerProjection projection;
+  InitializeProjection(projection, viewer);
+
+  // Find groups whose projection is within tolerance of (x,y)
+  std::vector< std::pair<RNScalar, int> > candidates;
+  for (unsigned int i = 0; i < groups.size(); i++) {
+    const Group& group = groups[i];
+    if (!clip_box.IsEmpty() && !R3Intersects(clip_box, group.bbox)) continue;
+    RNScalar xmin, ymin, xmax, ymax, zmin, zmax;
+    RNBoolean in_front = ProjectBox(projection, group.bbox, &xmin, &ymin, &xmax, &ymax, &zmin, &zmax);
+    if (zmax <= projection.neardist) continue;
+    if (in_front) {
+      if ((x < xmin - tolerance) || (x > xmax + tolerance)) continue;
+      if ((y < ymin - tolerance) || (y > ymax + tolerance)) continue;
+    }
+    candidates.push_back(std::pair<RNScalar, int>(zmin, i));
+  }
+
+  // Visit groups front to back, stopping when nearest depth of group is behind best point
+  std::sort(candidates.begin(), candidates.end());
+  RNScalar best_depth = FLT_MAX;
+  int best_index = -1;
+  R3Point best_position = R3unknown_point;
+  RNScalar tolerance_squared = tolerance * tolerance;
+  RNBoolean clip = !clip_box.IsEmpty();
+  for (unsigned int c = 0; c < candidates.size(); c++) {
+    if (candidates[c].first >= best_depth) break;
+    const Group& group = groups[candidates[c].second];
+    R3Vector e = projection.eye - group.origin;
+    for (int k = 0; k < group.npoints; k++) {
+      const float *p = (const float *) (group.positions + k * group.stride);
+      R3Vector v(p[0] - e.X(), p[1] - e.Y(), p[2] - e.Z());
+      RNScalar z = v.Dot(projection.towards);
+      if ((z <= projection.neardist) || (z >= best_depth)) continue;
+      RNScalar dx = projection.cx + projection.fx * v.Dot(projection.right) / z - x;
+      RNScalar dy = projection.cy + projection.fy * v.Dot(projection.up) / z - y;
+      if (dx*dx + dy*dy > tolerance_squared) continue;
+      R3Point world_position(group.origin.X() + p[0], group.origin.Y() + p[1], group.origin.Z() + p[2]);
+      if (clip && !R3Contains(clip_box, world_position)) continue;
+      best_depth = z;
+      best_index = group.first_index + k;
+      best_position = world_position;
+    }
+  }
+
+  // Return results
+  if (position) *position = best_position;
+  if (depth) *depth = (best_index >= 0) ? best_depth : RN_INFINITY;
+  return best_index;
+}
+
+
+
+int R3PointPicker::
+FindPointsInSphere(const R3Point& center, RNLength radius,
+  std::vector<int>& point_indices) const
+{
+  // Check each group
+  point_indices.clear();
+  RNLength radius_squared = radius * radius;
+  RNBoolean clip = !clip_box.IsEmpty();
+  for (unsigned int i = 0; i < groups.size(); i++) {
+    const Group& group = groups[i];
+    if (clip && !R3Intersects(clip_box, group.bbox)) continue;
+    if (R3Distance(center, group.bbox) > radius) continue;
+
+    // Insert all points if group is entirely inside sphere
+    if (!clip || R3Contains(clip_box, group.bbox)) {
+      RNBoolean inside = TRUE;
+      for (int octant = 0; octant < 8; octant++) {
+        if (R3SquaredDistance(center, group.bbox.Corner(octant)) > radius_squared) { inside = FALSE; break; }
+      }
+      if (inside) {
+        for (int k = 0; k < group.npoints; k++) point_indices.push_back(group.first_index + k);
+        continue;
+      }
+    }
+
+    // Insert points within radius
+    R3Vector c = center - group.origin;
+    for (int k = 0; k < group.npoints; k++) {
+      const float *p = (const float *) (group.positions + k * group.stride);
+      RNScalar dx = p[0] - c.X(), dy = p[1] - c.Y(), dz = p[2] - c.Z();
+      if (dx*dx + dy*dy + dz*dz > radius_squared) continue;
+      if (clip && !R3Contains(clip_box, R3Point(group.origin.X() + p[0], group.origin.Y() + p[1], group.origin.Z() + p[2]))) continue;
+      point_indices.push_back(group.first_index + k);
+    }
+  }
+
+  // Return number of points found
+  return (int) point_indices.size();
+}
+
+
+
+int R3PointPicker::
+FindPointsInLasso(const R3Viewer& viewer, const R2Point *lasso_points, int nlasso_points,
+  std::vector<int>& point_indices) const
+{
+  // Check lasso
+  point_indices.clear();
+  if (nlasso_points < 3) return 0;
+
+  // Compute extent of lasso in pixels
+  R2Box lasso_box = R2null_box;
+  for (int i = 0; i < nlasso_points; i++) lasso_box.Union(lasso_points[i]);
+  int x0 = (int) floor(lasso_box.XMin());
+  int y0 = (int) floor(lasso_box.YMin());
+  int width = (int) floor(lasso_box.XMax()) - x0 + 1;
+  int height = (int) floor(lasso_box.YMax()) - y0 + 1;
+
+  // Rasterize lasso into mask with even-odd rule (pixel centers are at half-integers)
+  std::vector<unsigned char> mask(width * height, 0);
+  std::vector<RNScalar> crossings;
+  for (int j = 0; j < height; j++) {
+    RNScalar yc = y0 + j + 0.5;
+    crossings.clear();
+    for (int i = 0; i < nlasso_points; i++) {
+      const R2Point& p0 = lasso_points[i];
+      const R2Point& p1 = lasso_points[(i+1) % nlasso_points];
+      if ((p0.Y() <= yc) == (p1.Y() <= yc)) continue;
+      crossings.push_back(p0.X() + (yc - p0.Y()) * (p1.X() - p0.X()) / (p1.Y() - p0.Y()));
+    }
+    std::sort(crossings.begin(), crossings.end());
+    for (unsigned int k = 0; k + 1 < crossings.size(); k += 2) {
+      int i0 = (int) ceil(crossings[k] - 0.5) - x0;
+      int i1 = (int) ceil(crossings[k+1] - 0.5) - x0;
+      if (i0 < 0) i0 = 0;
+      if (i1 > width) i1 = width;
+      for (int i = i0; i < i1; i++) mask[j * width + i] = 1;
+    }
+  }
+
+  // Compute summed area table of mask (to detect groups projecting entirely inside lasso)
+  std::vector<int> sums((width + 1) * (height + 1), 0);
+  for (int j = 0; j < height; j++) {
+    int row_sum = 0;
+    for (int i = 0; i < width; i++) {
+      row_sum += mask[j * width + i];
+      sums[(j+1) * (width+1) + (i+1)] = sums[j * (width+1) + (i+1)] + row_sum;
+    }
+  }
+
+  // Initialize projection
+  R3PointPickerProjection projection;
+  InitializeProjection(projection, viewer);
+
+  // Check each group
+  RNBoolean clip = !clip_box.IsEmpty();
+  for (unsigned int g = 0; g < groups.size(); g++) {
+    const Group& group = groups[g];
+    if (clip && !R3Intersects(clip_box, group.bbox)) continue;
+    RNScalar xmin, ymin, xmax, ymax, zmin, zmax;
+    RNBoolean in_front = ProjectBox(projection, group.bbox, &xmin, &ymin, &xmax, &ymax, &zmin, &zmax);
+    if (zmax <= projection.neardist) continue;
+    if (in_front) {
+      // Skip group if projection is outside lasso extent
+      int i0 = (int) floor(xmin) - x0, i1 = (int) floor(xmax) - x0;
+      int j0 = (int) floor(ymin) - y0, j1 = (int) floor(ymax) - y0;
+      if ((i1 < 0) || (j1 < 0) || (i0 >= width) || (j0 >= height)) continue;
+
+      // Insert all points if projection is entirely inside lasso
+      if ((i0 >= 0) && (j0 >= 0) && (i1 < width) && (j1 < height) &&
+          (!clip || R3Contains(clip_box, group.bbox))) {
+        int count = sums[(j1+1) * (width+1) + (i1+1)] - sums[j0 * (width+1) + (i1+1)]
+          - sums[(j1+1) * (width+1) + i0] + sums[j0 * (width+1) + i0];
+        if (count == (i1 - i0 + 1) * (j1 - j0 + 1)) {
+          for (int k = 0; k < group.npoints; k++) point_indices.push_back(group.first_index + k);
+          continue;
+        }
+      }
+    }
+
+    // Insert points projecting inside lasso
+    R3Vector e = projection.eye - group.origin;
+    for (int k = 0; k < group.npoints; k++) {
+      const float *p = (const float *) (group.positions + k * group.stride);
+      R3Vector v(p[0] - e.X(), p[1] - e.Y(), p[2] - e.Z());
+      RNScalar z = v.Dot(projection.towards);
+      if (z <= projection.neardist) continue;
+      RNScalar px = projection.cx + projection.fx * v.Dot(projection.right) / z;
+      RNScalar py = projection.cy + projection.fy * v.Dot(projection.up) / z;
+      int i = (int) floor(px) - x0, j = (int) floor(py) - y0;
+      if ((i < 0) || (j < 0) || (i >= width) || (j >= height)) continue;
+      if (!mask[j * width + i]) continue;
+      if (clip && !R3Contains(clip_box, R3Point(group.origin.X() + p[0], group.origin.Y() + p[1], group.origin.Z() + p[2]))) continue;
+      point_indices.push_back(group.first_index + k);
+    }
+  }
+
+  // Return number of points found
+  return (int) point_indices.size();
+}
+
+
+
+} // namespace gaps
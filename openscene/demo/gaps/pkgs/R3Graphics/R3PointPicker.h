@@ -0,0 +1,112 @@
+// Include file for CPU-side point picking and selection (ray, lasso, and sphere queries)
+#ifndef __R3__POINT__PICKER__H__
+#define __R3__POINT__PICKER__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Class definition
+
+class R3PointPicker {
+public:
+  // Constructor/deconstructor
+  R3PointPicker(void);
+  ~R3PointPicker(void);
+
+  // Property functions
+  int NGroups(void) const;
+  int NPoints(void) const;
+  const R3Box& BBox(void) const;
+  const R3Box& ClipBox(void) const;
+
+  // Insert functions (positions are float triples spaced stride bytes apart, relative to origin;
+  // they are referenced rather than copied, and point k of group is reported as first_index + k)
+  void InsertGroup(const float *positions, int npoints, int stride, const R3Box& bbox,
+    const R3Point& origin = R3zero_point, int first_index = -1);
+  void Empty(void);
+
+  // Clip functions (points outside clip box are ignored, empty box means no clipping)
+  void SetClipBox(const R3Box& box);
+
+  // Query functions (viewport coordinates have origin at bottom left)
+  int PickPoint(const R3Viewer& viewer, RNScalar x, RNScalar y, RNScalar tolerance = 5,
+    R3Point *position = NULL, RNLength *depth = NULL) const;
+  int FindPointsInSphere(const R3Point& center, RNLength radius,
+    std::vector<int>& point_indices) const;
+  int FindPointsInLasso(const R3Viewer& viewer, const R2Point *lasso_points, int nlasso_points,
+    std::vector<int>& point_indices) const;
+
+private:
+  struct Group {
+    const unsigned char *positions;
+    int npoints;
+    int stride;
+    R3Box bbox;
+    R3Point origin;
+    int first_index;
+  };
+
+private:
+  std::vector<Group> groups;
+  int npoints;
+  R3Box bbox;
+  R3Box clip_box;
+};
+
+
+
+// Inline functions
+
+inline int R3PointPicker::
+NGroups(void) const
+{
+  // Return number of point groups
+  return (int) groups.size();
+}
+
+
+
+inline int R3PointPicker::
+NPoints(void) const
+{
+  // Return number of points in all groups
+  return npoints;
+}
+
+
+
+inline const R3Box& R3PointPicker::
+BBox(void) const
+{
+  // Return bounding box of all groups
+  return bbox;
+}
+
+
+
+inline const R3Box& R3PointPicker::
+ClipBox(void) const
+{
+  // Return box outside of which points are ignored
+  return clip_box;
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
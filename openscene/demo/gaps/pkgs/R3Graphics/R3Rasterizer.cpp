@@ -0,0 +1,621 @@
+// Source file for software triangle rasterizer class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Graphics.h"
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Internal types
+////////////////////////////////////////////////////////////////////////
+
+// Size of square screen tiles (in pixels)
+
+static const int R3_RASTERIZER_TILE_SIZE = 32;
+
+
+// Number of triangles transformed by each setup task
+
+static const int R3_RASTERIZER_SETUP_CHUNK_SIZE = 4096;
+
+
+// Triangle after transformation to screen coordinates
+
+struct R3RasterizerTriangle {
+  double x[3], y[3];    // screen coordinates (counter-clockwise)
+  double iz[3];         // inverse of depth
+  float c[3][3];        // vertex colors
+  int triangle_index;   // index of input triangle
+  int xmin, ymin;       // first pixel covered by bounding box
+  int xmax, ymax;       // last pixel covered by bounding box
+  RNBoolean front;      // whether triangle faces the camera
+};
+
+
+// Data shared by setup and tile tasks
+
+struct R3RasterizerContext {
+  // Input triangles
+  const float *positions;
+  const float *colors;
+  const int *identifiers;
+  int ntriangles;
+
+  // Projection
+  double m[3][4];
+  double fx, fy, cx, cy;
+  double neardist, fardist;
+  int width, height;
+
+  // Screen triangles (grouped by setup chunk, then concatenated)
+  std::vector< std::vector<R3RasterizerTriangle> > chunk_triangles;
+  std::vector<R3RasterizerTriangle> triangles;
+
+  // Bins of screen triangles per tile
+  int ntiles_x, ntiles_y;
+  std::vector<int> bin_offsets;
+  std::vector<int> bin_entries;
+
+  // Output images
+  R2Grid *depth_image;
+  R2Grid *identifier_image;
+  R2Image *color_image;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor functions
+////////////////////////////////////////////////////////////////////////
+
+R3Rasterizer::
+R3Rasterizer(void)
+  : positions(),
+    colors(),
+    identifiers(),
+    bbox(R3null_box)
+{
+}
+
+
+
+R3Rasterizer::
+~R3Rasterizer(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Insert functions
+////////////////////////////////////////////////////////////////////////
+
+int R3Rasterizer::
+InsertTriangle(const R3Point& p0, const R3Point& p1, const R3Point& p2, int identifier)
+{
+  // Insert vertex positions
+  const R3Point *p[3] = { &p0, &p1, &p2 };
+  for (int k = 0; k < 3; k++) {
+    for (int dim = 0; dim < 3; dim++) {
+      positions.push_back((float) (*p[k])[dim]);
+    }
+    bbox.Union(*p[k]);
+  }
+
+  // Insert white vertex colors, if other triangles have colors
+  if (!colors.empty()) colors.resize(positions.size(), 1.0F);
+
+  // Insert identifier
+  identifiers.push_back(identifier);
+
+  // Return index of triangle
+  return (int) identifiers.size() - 1;
+}
+
+
+
+int R3Rasterizer::
+InsertTriangle(const R3Point& p0, const R3Point& p1, const R3Point& p2,
+  const RNRgb& c0, const RNRgb& c1, const RNRgb& c2, int identifier)
+{
+  // Insert white vertex colors for previous triangles without colors
+  colors.resize(positions.size(), 1.0F);
+
+  // Insert vertex colors
+  const RNRgb *c[3] = { &c0, &c1, &c2 };
+  for (int k = 0; k < 3; k++) {
+    colors.push_back((float) c[k]->R());
+    colors.push_back((float) c[k]->G());
+    colors.push_back((float) c[k]->B());
+  }
+
+  // Insert vertex positions
+  const R3Point *p[3] = { &p0, &p1, &p2 };
+  for (int k = 0; k < 3; k++) {
+    for (int dim = 0; dim < 3; dim++) {
+      positions.push_back((float) (*p[k])[dim]);
+    }
+    bbox.Union(*p[k]);
+  }
+
+  // Insert identifier
+  identifiers.push_back(identifier);
+
+  // Return index of triangle
+  return (int) identifiers.size() - 1;
+}
+
+
+
+void R3Rasterizer::
+InsertMesh(const R3Mesh& mesh, RNBoolean vertex_colors)
+{
+  // Insert all faces of mesh (identifier is face index)
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    R3MeshVertex *v0 = mesh.VertexOnFace(face, 0);
+    R3MeshVertex *v1 = mesh.VertexOnFace(face, 1);
+    R3MeshVertex *v2 = mesh.VertexOnFace(face, 2);
+    const R3Point& p0 = mesh.VertexPosition(v0);
+    const R3Point& p1 = mesh.VertexPosition(v1);
+    const R3Point& p2 = mesh.VertexPosition(v2);
+    if (!vertex_colors) InsertTriangle(p0, p1, p2, i);
+    else InsertTriangle(p0, p1, p2, mesh.VertexColor(v0), mesh.VertexColor(v1), mesh.VertexColor(v2), i);
+  }
+}
+
+
+
+void R3Rasterizer::
+Empty(void)
+{
+  // Remove all triangles
+  positions.clear();
+  colors.clear();
+  identifiers.clear();
+  bbox = R3null_box;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Triangle setup functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+SetupScreenTriangle(R3RasterizerContext *context, int triangle_index,
+  const double screen[3][3], const float color[3][3],
+  std::vector<R3RasterizerTriangle>& result)
+{
+  // Compute signed area (positive if counter-clockwise on screen)
+  double area = (screen[1][0] - screen[0][0]) * (screen[2][1] - screen[0][1]) -
+    (screen[2][0] - screen[0][0]) * (screen[1][1] - screen[0][1]);
+  if (area == 0) return;
+
+  // Fill triangle with counter-clockwise vertex order
+  R3RasterizerTriangle triangle;
+  int order[3] = { 0, 1, 2 };
+  if (area < 0) { order[1] = 2; order[2] = 1; }
+  for (int k = 0; k < 3; k++) {
+    triangle.x[k] = screen[order[k]][0];
+    triangle.y[k] = screen[order[k]][1];
+    triangle.iz[k] = screen[order[k]][2];
+    for (int c = 0; c < 3; c++) triangle.c[k][c] = color[order[k]][c];
+  }
+  triangle.triangle_index = triangle_index;
+  triangle.front = (area > 0) ? TRUE : FALSE;
+
+  // Compute range of pixel centers inside bounding box
+  double xmin = triangle.x[0], xmax = triangle.x[0];
+  double ymin = triangle.y[0], ymax = triangle.y[0];
+  for (int k = 1; k < 3; k++) {
+    if (triangle.x[k] < xmin) xmin = triangle.x[k];
+    if (triangle.x[k] > xmax) xmax = triangle.x[k];
+    if (triangle.y[k] < ymin) ymin = triangle.y[k];
+    if (triangle.y[k] > ymax) ymax = triangle.y[k];
+  }
+  if ((xmax < 0) || (ymax < 0)) return;
+  if ((xmin > context->width) || (ymin > context->height)) return;
+  if (xmin < 0) xmin = 0;
+  if (ymin < 0) ymin = 0;
+  if (xmax > context->width) xmax = context->width;
+  if (ymax > context->height) ymax = context->height;
+  triangle.xmin = (int) ceil(xmin - 0.5);
+  triangle.ymin = (int) ceil(ymin - 0.5);
+  triangle.xmax = (int) floor(xmax - 0.5);
+  triangle.ymax = (int) floor(ymax - 0.5);
+  if ((triangle.xmin > triangle.xmax) || (triangle.ymin > triangle.ymax)) return;
+
+  // Insert triangle
+  result.push_back(triangle);
+}
+
+
+
+static void
+SetupTriangles(int chunk_index, int thread_index, void *data)
+{
+  // Get context and chunk of triangles
+  R3RasterizerContext *context = (R3RasterizerContext *) data;
+  std::vector<R3RasterizerTriangle>& result = context->chunk_triangles[chunk_index];
+  int start = chunk_index * R3_RASTERIZER_SETUP_CHUNK_SIZE;
+  int end = start + R3_RASTERIZER_SETUP_CHUNK_SIZE;
+  if (end > context->ntriangles) end = context->ntriangles;
+
+  // Setup every triangle in chunk
+  for (int t = start; t < end; t++) {
+    // Transform vertices into camera coordinates (depth is along -Z)
+    double camera[3][3];
+    float color[3][3];
+    int nbehind = 0, nbeyond = 0;
+    for (int k = 0; k < 3; k++) {
+      const float *p = &context->positions[9*t + 3*k];
+      for (int i = 0; i < 3; i++) {
+        camera[k][i] = context->m[i][0]*p[0] + context->m[i][1]*p[1] + context->m[i][2]*p[2] + context->m[i][3];
+      }
+      camera[k][2] = -camera[k][2];
+      if (camera[k][2] < context->neardist) nbehind++;
+      if (camera[k][2] > context->fardist) nbeyond++;
+      for (int c = 0; c < 3; c++) {
+        color[k][c] = (context->colors) ? context->colors[9*t + 3*k + c] : 1.0F;
+      }
+    }
+
+    // Check if triangle is entirely outside depth range
+    if ((nbehind == 3) || (nbeyond == 3)) continue;
+
+    // Clip triangle against near plane
+    double polygon[4][3];
+    float polygon_color[4][3];
+    int npolygon = 0;
+    if (nbehind == 0) {
+      for (int k = 0; k < 3; k++) {
+        for (int i = 0; i < 3; i++) polygon[k][i] = camera[k][i];
+        for (int c = 0; c < 3; c++) polygon_color[k][c] = color[k][c];
+      }
+      npolygon = 3;
+    }
+    else {
+      for (int k = 0; k < 3; k++) {
+        int k1 = (k + 1) % 3;
+        double d0 = camera[k][2] - context->neardist;
+        double d1 = camera[k1][2] - context->neardist;
+        if (d0 >= 0) {
+          for (int i = 0; i < 3; i++) polygon[npolygon][i] = camera[k][i];
+          for (int c = 0; c < 3; c++) polygon_color[npolygon][c] = color[k][c];
+          npolygon++;
+        }
+        if ((d0 >= 0) != (d1 >= 0)) {
+          double s = d0 / (d0 - d1);
+          for (int i = 0; i < 3; i++) polygon[npolygon][i] = camera[k][i] + s * (camera[k1][i] - camera[k][i]);
+          for (int c = 0; c < 3; c++) polygon_color[npolygon][c] = color[k][c] + s * (color[k1][c] - color[k][c]);
+          polygon[npolygon][2] = context->neardist;
+          npolygon++;
+        }
+      }
+    }
+
+    // Project polygon vertices onto screen
+    double screen[4][3];
+    for (int k = 0; k < npolygon; k++) {
+      double iz = 1.0 / polygon[k][2];
+      screen[k][0] = context->fx * polygon[k][0] * iz + context->cx;
+      screen[k][1] = context->fy * polygon[k][1] * iz + context->cy;
+      screen[k][2] = iz;
+    }
+
+    // Setup screen triangles (fan triangulation of clipped polygon)
+    for (int k = 1; k < npolygon - 1; k++) {
+      const double fan_screen[3][3] = {
+        { screen[0][0], screen[0][1], screen[0][2] },
+        { screen[k][0], screen[k][1], screen[k][2] },
+        { screen[k+1][0], screen[k+1][1], screen[k+1][2] } };
+      const float fan_color[3][3] = {
+        { polygon_color[0][0], polygon_color[0][1], polygon_color[0][2] },
+        { polygon_color[k][0], polygon_color[k][1], polygon_color[k][2] },
+        { polygon_color[k+1][0], polygon_color[k+1][1], polygon_color[k+1][2] } };
+      SetupScreenTriangle(context, t, fan_screen, fan_color, result);
+    }
+  }
+}
+
+
+
+static void
+BinTriangles(R3RasterizerContext *context)
+{
+  // Concatenate screen triangles in input order
+  int ntriangles = 0;
+  for (unsigned int i = 0; i < context->chunk_triangles.size(); i++) {
+    ntriangles += (int) context->chunk_triangles[i].size();
+  }
+  context->triangles.reserve(ntriangles);
+  for (unsigned int i = 0; i < context->chunk_triangles.size(); i++) {
+    std::vector<R3RasterizerTriangle>& chunk = context->chunk_triangles[i];
+    context->triangles.insert(context->triangles.end(), chunk.begin(), chunk.end());
+    std::vector<R3RasterizerTriangle>().swap(chunk);
+  }
+
+  // Count triangles overlapping each tile
+  int ntiles = context->ntiles_x * context->ntiles_y;
+  context->bin_offsets.assign(ntiles + 1, 0);
+  for (int i = 0; i < ntriangles; i++) {
+    const R3RasterizerTriangle& triangle = context->triangles[i];
+    for (int ty = triangle.ymin / R3_RASTERIZER_TILE_SIZE; ty <= triangle.ymax / R3_RASTERIZER_TILE_SIZE; ty++) {
+      for (int tx = triangle.xmin / R3_RASTERIZER_TILE_SIZE; tx <= triangle.xmax / R3_RASTERIZER_TILE_SIZE; tx++) {
+        context->bin_offsets[ty*context->ntiles_x + tx + 1]++;
+      }
+    }
+  }
+
+  // Compute offsets of bins
+  for (int i = 0; i < ntiles; i++) {
+    context->bin_offsets[i+1] += context->bin_offsets[i];
+  }
+
+  // Fill bins (triangles stay in input order within each bin)
+  std::vector<int> bin_sizes(ntiles, 0);
+  context->bin_entries.resize(context->bin_offsets[ntiles]);
+  for (int i = 0; i < ntriangles; i++) {
+    const R3RasterizerTriangle& triangle = context->triangles[i];
+    for (int ty = triangle.ymin / R3_RASTERIZER_TILE_SIZE; ty <= triangle.ymax / R3_RASTERIZER_TILE_SIZE; ty++) {
+      for (int tx = triangle.xmin / R3_RASTERIZER_TILE_SIZE; tx <= triangle.xmax / R3_RASTERIZER_TILE_SIZE; tx++) {
+        int tile_index = ty*context->ntiles_x + tx;
+        context->bin_entries[context->bin_offsets[tile_index] + bin_sizes[tile_index]++] = i;
+      }
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Tile rasterization functions
+////////////////////////////////////////////////////////////////////////
+
+static inline void
+EdgeValues(const R3RasterizerTriangle& triangle, double px, double py, double w[3])
+{
+  // Compute edge functions (w[k] is opposite vertex k, positive inside)
+  for (int k = 0; k < 3; k++) {
+    int a = (k + 1) % 3, b = (k + 2) % 3;
+    w[k] = (triangle.x[b] - triangle.x[a]) * (py - triangle.y[a]) -
+      (triangle.y[b] - triangle.y[a]) * (px - triangle.x[a]);
+  }
+}
+
+
+
+static void
+RasterizeTile(int tile_index, int thread_index, void *data)
+{
+  // Get context and tile extent
+  R3RasterizerContext *context = (R3RasterizerContext *) data;
+  const int tile_size = R3_RASTERIZER_TILE_SIZE;
+  int tx = tile_index % context->ntiles_x;
+  int ty = tile_index / context->ntiles_x;
+  int x0 = tx * tile_size, y0 = ty * tile_size;
+  int x1 = x0 + tile_size - 1, y1 = y0 + tile_size - 1;
+  if (x1 > context->width - 1) x1 = context->width - 1;
+  if (y1 > context->height - 1) y1 = context->height - 1;
+
+  // Initialize tile buffers
+  float keys[tile_size * tile_size];
+  float depths[tile_size * tile_size];
+  int winners[tile_size * tile_size];
+  for (int i = 0; i < tile_size * tile_size; i++) {
+    keys[i] = FLT_MAX;
+    depths[i] = 0;
+    winners[i] = -1;
+  }
+
+  // Rasterize triangles in bin (earlier triangles win ties)
+  for (int b = context->bin_offsets[tile_index]; b < context->bin_offsets[tile_index+1]; b++) {
+    int triangle_index = context->bin_entries[b];
+    const R3RasterizerTriangle& triangle = context->triangles[triangle_index];
+
+    // Clip bounding box to tile
+    int xmin = (triangle.xmin > x0) ? triangle.xmin : x0;
+    int ymin = (triangle.ymin > y0) ? triangle.ymin : y0;
+    int xmax = (triangle.xmax < x1) ? triangle.xmax : x1;
+    int ymax = (triangle.ymax < y1) ? triangle.ymax : y1;
+    if ((xmin > xmax) || (ymin > ymax)) continue;
+
+    // Setup edge function increments and fill rule (top-left edges own boundary pixels)
+    double dwdx[3], dwdy[3];
+    RNBoolean owns_edge[3];
+    for (int k = 0; k < 3; k++) {
+      int a = (k + 1) % 3, b = (k + 2) % 3;
+      double dx = triangle.x[b] - triangle.x[a];
+      double dy = triangle.y[b] - triangle.y[a];
+      dwdx[k] = -dy;
+      dwdy[k] = dx;
+      owns_edge[k] = ((dy < 0) || ((dy == 0) && (dx < 0))) ? TRUE : FALSE;
+    }
+
+    // Compute constants for interpolating inverse depth
+    double w_row[3];
+    EdgeValues(triangle, xmin + 0.5, ymin + 0.5, w_row);
+    double area = w_row[0] + w_row[1] + w_row[2];
+    if (area <= 0) continue;
+    double iz_scale[3];
+    for (int k = 0; k < 3; k++) iz_scale[k] = triangle.iz[k] / area;
+    float front_scale = (triangle.front) ? 1.0F - 1.0E-6F : 1.0F;
+
+    // Visit pixels in bounding box
+    for (int iy = ymin; iy <= ymax; iy++) {
+      double w[3] = { w_row[0], w_row[1], w_row[2] };
+      for (int ix = xmin; ix <= xmax; ix++) {
+        // Check if pixel center is inside triangle
+        if (((w[0] > 0) || ((w[0] == 0) && owns_edge[0])) &&
+            ((w[1] > 0) || ((w[1] == 0) && owns_edge[1])) &&
+            ((w[2] > 0) || ((w[2] == 0) && owns_edge[2]))) {
+          // Compute depth
+          double iz = w[0]*iz_scale[0] + w[1]*iz_scale[1] + w[2]*iz_scale[2];
+          if (iz > 0) {
+            double depth = 1.0 / iz;
+            if (depth <= context->fardist) {
+              // Test depth (front faces win near-coincident back faces)
+              int pixel_index = (iy - y0) * tile_size + (ix - x0);
+              float key = front_scale * (float) depth;
+              if (key < keys[pixel_index]) {
+                keys[pixel_index] = key;
+                depths[pixel_index] = (float) depth;
+                winners[pixel_index] = triangle_index;
+              }
+            }
+          }
+        }
+
+        // Step to next pixel
+        w[0] += dwdx[0]; w[1] += dwdx[1]; w[2] += dwdx[2];
+      }
+
+      // Step to next row
+      w_row[0] += dwdy[0]; w_row[1] += dwdy[1]; w_row[2] += dwdy[2];
+    }
+  }
+
+  // Write visible surfaces into output images
+  for (int iy = y0; iy <= y1; iy++) {
+    for (int ix = x0; ix <= x1; ix++) {
+      int pixel_index = (iy - y0) * tile_size + (ix - x0);
+      int triangle_index = winners[pixel_index];
+      if (triangle_index < 0) continue;
+      const R3RasterizerTriangle& triangle = context->triangles[triangle_index];
+
+      // Write depth
+      if (context->depth_image) {
+        context->depth_image->SetGridValue(ix, iy, depths[pixel_index]);
+      }
+
+      // Write identifier
+      if (context->identifier_image) {
+        context->identifier_image->SetGridValue(ix, iy, context->identifiers[triangle.triangle_index]);
+      }
+
+      // Write color (perspective-correct interpolation)
+      if (context->color_image) {
+        double w[3];
+        EdgeValues(triangle, ix + 0.5, iy + 0.5, w);
+        double b[3], sum = 0;
+        for (int k = 0; k < 3; k++) { b[k] = w[k] * triangle.iz[k]; sum += b[k]; }
+        if (sum <= 0) continue;
+        RNRgb color(0, 0, 0);
+        for (int k = 0; k < 3; k++) {
+          color[0] += b[k] * triangle.c[k][0];
+          color[1] += b[k] * triangle.c[k][1];
+          color[2] += b[k] * triangle.c[k][2];
+        }
+        color /= sum;
+        context->color_image->SetPixelRGB(ix, iy, color);
+      }
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Rasterization functions
+////////////////////////////////////////////////////////////////////////
+
+int R3Rasterizer::
+Rasterize(const R3Camera& camera, int width, int height,
+  R2Grid *depth_image, R2Grid *identifier_image, R2Image *color_image,
+  RNBoolean parallel) const
+{
+  // Compute intrinsics matrix from field of view
+  RNScalar fx = 0.5 * width / tan(camera.XFOV());
+  RNScalar fy = 0.5 * height / tan(camera.YFOV());
+  R3Matrix intrinsics(fx, 0, 0.5 * width, 0, fy, 0.5 * height, 0, 0, 1);
+
+  // Rasterize with camera coordinate system
+  return Rasterize(camera.CoordSystem().InverseMatrix(), intrinsics, width, height,
+    camera.Near(), camera.Far(), depth_image, identifier_image, color_image, parallel);
+}
+
+
+
+int R3Rasterizer::
+Rasterize(const R4Matrix& world_to_camera, const R3Matrix& intrinsics, int width, int height,
+  RNScalar neardist, RNScalar fardist,
+  R2Grid *depth_image, R2Grid *identifier_image, R2Image *color_image,
+  RNBoolean parallel) const
+{
+  // Check image dimensions
+  if ((width <= 0) || (height <= 0)) return 0;
+  if (depth_image && ((depth_image->XResolution() != width) || (depth_image->YResolution() != height))) {
+    RNFail("Depth image has wrong dimensions for rasterization\n");
+    return 0;
+  }
+  if (identifier_image && ((identifier_image->XResolution() != width) || (identifier_image->YResolution() != height))) {
+    RNFail("Identifier image has wrong dimensions for rasterization\n");
+    return 0;
+  }
+  if (color_image && ((color_image->Width() != width) || (color_image->Height() != height))) {
+    RNFail("Color image has wrong dimensions for rasterization\n");
+    return 0;
+  }
+
+  // Check near distance
+  if (neardist <= 0) neardist = RN_EPSILON;
+  if (fardist <= neardist) fardist = RN_INFINITY;
+
+  // Initialize context
+  R3RasterizerContext context;
+  context.positions = (positions.empty()) ? NULL : &positions[0];
+  context.colors = (colors.empty()) ? NULL : &colors[0];
+  context.identifiers = (identifiers.empty()) ? NULL : &identifiers[0];
+  context.ntriangles = NTriangles();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      context.m[i][j] = world_to_camera[i][j];
+    }
+  }
+  context.fx = intrinsics[0][0];
+  context.fy = intrinsics[1][1];
+  context.cx = intrinsics[0][2];
+  context.cy = intrinsics[1][2];
+  context.neardist = neardist;
+  context.fardist = fardist;
+  context.width = width;
+  context.height = height;
+  context.ntiles_x = (width + R3_RASTERIZER_TILE_SIZE - 1) / R3_RASTERIZER_TILE_SIZE;
+  context.ntiles_y = (height + R3_RASTERIZER_TILE_SIZE - 1) / R3_RASTERIZER_TILE_SIZE;
+  context.depth_image = depth_image;
+  context.identifier_image = identifier_image;
+  context.color_image = color_image;
+
+  // Transform, clip, and project triangles
+  int nchunks = (context.ntriangles + R3_RASTERIZER_SETUP_CHUNK_SIZE - 1) / R3_RASTERIZER_SETUP_CHUNK_SIZE;
+  context.chunk_triangles.resize(nchunks);
+  if (parallel) RNParallelFor(nchunks, SetupTriangles, &context);
+  else for (int i = 0; i < nchunks; i++) SetupTriangles(i, 0, &context);
+
+  // Assign triangles to tiles
+  BinTriangles(&context);
+
+  // Rasterize tiles
+  int ntiles = context.ntiles_x * context.ntiles_y;
+  if (parallel) RNParallelFor(ntiles, RasterizeTile, &context);
+  else for (int i = 0; i < ntiles; i++) RasterizeTile(i, 0, &context);
+
+  // Return success
+  return 1;
+}
+
+
+
+} // namespace gaps
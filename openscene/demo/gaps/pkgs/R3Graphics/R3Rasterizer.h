@@ -0,0 +1,114 @@
+// Include file for software triangle rasterizer
+#ifndef __R3__RASTERIZER__H__
+#define __R3__RASTERIZER__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Class definition
+
+class R3Rasterizer {
+public:
+  // Constructor/deconstructor
+  R3Rasterizer(void);
+  ~R3Rasterizer(void);
+
+  // Property functions
+  int NTriangles(void) const;
+  RNBoolean HasColors(void) const;
+  const R3Box& BBox(void) const;
+
+  // Triangle access functions
+  R3Point TrianglePosition(int triangle_index, int k) const;
+  int TriangleIdentifier(int triangle_index) const;
+
+  // Insert functions
+  int InsertTriangle(const R3Point& p0, const R3Point& p1, const R3Point& p2, int identifier = -1);
+  int InsertTriangle(const R3Point& p0, const R3Point& p1, const R3Point& p2,
+    const RNRgb& c0, const RNRgb& c1, const RNRgb& c2, int identifier = -1);
+  void InsertMesh(const R3Mesh& mesh, RNBoolean vertex_colors = FALSE);
+  void Empty(void);
+
+  // Rasterization functions (thread safe, pixels not covered by triangles are left unchanged)
+  int Rasterize(const R3Camera& camera, int width, int height,
+    R2Grid *depth_image = NULL, R2Grid *identifier_image = NULL, R2Image *color_image = NULL,
+    RNBoolean parallel = TRUE) const;
+  int Rasterize(const R4Matrix& world_to_camera, const R3Matrix& intrinsics, int width, int height,
+    RNScalar neardist, RNScalar fardist,
+    R2Grid *depth_image = NULL, R2Grid *identifier_image = NULL, R2Image *color_image = NULL,
+    RNBoolean parallel = TRUE) const;
+
+private:
+  std::vector<float> positions;
+  std::vector<float> colors;
+  std::vector<int> identifiers;
+  R3Box bbox;
+};
+
+
+
+// Inline functions
+
+inline int R3Rasterizer::
+NTriangles(void) const
+{
+  // Return number of triangles
+  return (int) identifiers.size();
+}
+
+
+
+inline RNBoolean R3Rasterizer::
+HasColors(void) const
+{
+  // Return whether triangles have vertex colors
+  return (colors.size() > 0) ? TRUE : FALSE;
+}
+
+
+
+inline const R3Box& R3Rasterizer::
+BBox(void) const
+{
+  // Return bounding box of all triangles
+  return bbox;
+}
+
+
+
+inline R3Point R3Rasterizer::
+TrianglePosition(int triangle_index, int k) const
+{
+  // Return position of kth vertex of triangle
+  const float *p = &positions[9*triangle_index + 3*k];
+  return R3Point(p[0], p[1], p[2]);
+}
+
+
+
+inline int R3Rasterizer::
+TriangleIdentifier(int triangle_index) const
+{
+  // Return identifier of triangle
+  return identifiers[triangle_index];
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
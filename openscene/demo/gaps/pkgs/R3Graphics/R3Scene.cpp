@@ -1857,9 +1857,9 @@ ReadPlyFile(const char *filename, R3SceneNode *parent_node)
   // Check/set parent node
   if (!parent_node) parent_node = root;
 
-  // Read ply file
-  R3Mesh mesh;
-  if (!mesh.ReadFile(filename)) {
+  // Read ply file (binary files are decoded without building an R3Mesh)
+  R3PlyMesh mesh;
+  if (!R3ReadPlyMeshFile(filename, &mesh)) {
     RNFail("Unable to read mesh %s\n", filename);
     return 0;
   }
@@ -1867,42 +1867,31 @@ ReadPlyFile(const char *filename, R3SceneNode *parent_node)
   // Create array of vertices
   RNArray<R3TriangleVertex *> vertices;
   for (int i = 0; i < mesh.NVertices(); i++) {
-    R3MeshVertex *mesh_vertex = mesh.Vertex(i);
-    const R3Point& position = mesh.VertexPosition(mesh_vertex);
-    R3TriangleVertex *triangle_vertex = new R3TriangleVertex(position);
-    if (!mesh.VertexColor(mesh_vertex).IsBlack()) triangle_vertex->SetColor(mesh.VertexColor(mesh_vertex));
-    triangle_vertex->SetTextureCoords(mesh.VertexTextureCoords(mesh_vertex));
+    const float *p = &mesh.positions[3*i];
+    R3TriangleVertex *triangle_vertex = new R3TriangleVertex(R3Point(p[0], p[1], p[2]));
+    if (!mesh.colors.empty()) {
+      const unsigned char *c = &mesh.colors[3*i];
+      RNRgb color(c[0] / 255.0, c[1] / 255.0, c[2] / 255.0);
+      if (!color.IsBlack()) triangle_vertex->SetColor(color);
+    }
+    if (!mesh.texcoords.empty()) triangle_vertex->SetTextureCoords(R2Point(mesh.texcoords[2*i], mesh.texcoords[2*i+1]));
+    else triangle_vertex->SetTextureCoords(R2zero_point);
     triangle_vertex->SetSharedFlag();
     vertices.Insert(triangle_vertex);
   }
 
-  // Check face segments and materials
-  int max_face_segment = 0;
-  int max_face_material = 0;
-  for (int i = 0; i < mesh.NFaces(); i++) {
-    R3MeshFace *face = mesh.Face(i);
-    int face_segment = mesh.FaceSegment(face);
-    int face_material = mesh.FaceMaterial(face);
-    if (face_segment > max_face_segment) max_face_segment = face_segment;
-    if (face_material > max_face_material) max_face_material = face_material;
-  }
-
   // Create arrays of triangles
   char node_name[1024];
   RNArray<R3Triangle *> *tris_0_0 = NULL;
   RNSymbolTable<RNArray<R3Triangle *> *> triangles;
   for (int i = 0; i < mesh.NFaces(); i++) {
-    R3MeshFace *mesh_face = mesh.Face(i);
-    int face_segment = mesh.FaceSegment(mesh_face);
+    int face_segment = (mesh.segments.empty()) ? 0 : mesh.segments[i];
     if (face_segment < 0) face_segment = 0;
-    int face_category = mesh.FaceCategory(mesh_face);
+    int face_category = (mesh.categories.empty()) ? 0 : mesh.categories[i];
     if (face_category < 0) face_category = 0;
-    int i0 = mesh.VertexID(mesh.VertexOnFace(mesh_face, 0));
-    int i1 = mesh.VertexID(mesh.VertexOnFace(mesh_face, 1));
-    int i2 = mesh.VertexID(mesh.VertexOnFace(mesh_face, 2));
-    R3TriangleVertex *v0 = vertices.Kth(i0);
-    R3TriangleVertex *v1 = vertices.Kth(i1);
-    R3TriangleVertex *v2 = vertices.Kth(i2);
+    R3TriangleVertex *v0 = vertices.Kth(mesh.indices[3*i+0]);
+    R3TriangleVertex *v1 = vertices.Kth(mesh.indices[3*i+1]);
+    R3TriangleVertex *v2 = vertices.Kth(mesh.indices[3*i+2]);
     R3Triangle *triangle = new R3Triangle(v0, v1, v2);
     RNArray<R3Triangle *> *tris = ((face_segment == 0) && (face_category == 0)) ? tris_0_0 : NULL; 
     if (!tris) {
@@ -0,0 +1,294 @@
+// Source file for view culling (frustum, screen-space size, and hierarchical-z occlusion)
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Graphics.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor functions
+////////////////////////////////////////////////////////////////////////
+
+R3ViewCuller::
+R3ViewCuller(void)
+  : viewer(),
+    frustum(),
+    eye(0, 0, 0),
+    towards(0, 0, -1),
+    up(0, 1, 0),
+    right(1, 0, 0),
+    tan_xfov(1),
+    tan_yfov(1),
+    neardist(0),
+    focal_length(1),
+    occlusion_width(0),
+    occlusion_height(0),
+    occluder_depths(),
+    occlusion_levels(),
+    level_widths(),
+    level_heights()
+{
+}
+
+
+
+R3ViewCuller::
+~R3ViewCuller(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// View update functions
+////////////////////////////////////////////////////////////////////////
+
+void R3ViewCuller::
+SetView(const R3Viewer& viewer, int occlusion_resolution)
+{
+  // Remember viewer
+  this->viewer = viewer;
+
+  // Get camera parameters
+  const R3Camera& camera = viewer.Camera();
+  eye = camera.Origin();
+  towards = camera.Towards();
+  up = camera.Up();
+  right = camera.Right();
+  tan_xfov = tan(camera.XFOV());
+  tan_yfov = tan(camera.YFOV());
+  neardist = camera.Near();
+  frustum = R3Frustum(eye, towards, up, camera.XFOV(), camera.YFOV(), camera.Near(), camera.Far());
+
+  // Compute focal length in pixels
+  int viewport_height = viewer.Viewport().Height();
+  focal_length = (tan_yfov > 0) ? 0.5 * viewport_height / tan_yfov : 1;
+
+  // Clear occlusion buffers
+  occlusion_width = occlusion_height = 0;
+  occluder_depths.clear();
+  occlusion_levels.clear();
+  level_widths.clear();
+  level_heights.clear();
+
+  // Allocate occluder depth buffer (FLT_MAX means no occluder)
+  int viewport_width = viewer.Viewport().Width();
+  if ((occlusion_resolution > 0) && (viewport_width > 0) && (viewport_height > 0)) {
+    occlusion_width = occlusion_resolution;
+    occlusion_height = (int) (occlusion_resolution * (double) viewport_height / (double) viewport_width + 0.5);
+    if (occlusion_height < 1) occlusion_height = 1;
+    occluder_depths.assign(occlusion_width * occlusion_height, FLT_MAX);
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Frustum culling functions
+////////////////////////////////////////////////////////////////////////
+
+int R3ViewCuller::
+FrustumClassification(const R3Box& box) const
+{
+  // Check box
+  if (box.IsEmpty()) return R3_VIEW_CULLER_OUTSIDE;
+
+  // Check box against each halfspace
+  RNBoolean inside = TRUE;
+  for (int dir = 0; dir < 2; dir++) {
+    for (int dim = 0; dim < 3; dim++) {
+      // Check corner furthest along halfspace normal
+      const R3Halfspace& halfspace = frustum.Halfspace(dir, dim);
+      const R3Vector& normal = halfspace.Normal();
+      if (!R3Contains(halfspace, box.Corner(normal.Octant()))) return R3_VIEW_CULLER_OUTSIDE;
+
+      // Check corner furthest against halfspace normal
+      if (inside && !R3Contains(halfspace, box.Corner((-normal).Octant()))) inside = FALSE;
+    }
+  }
+
+  // Return classification
+  return (inside) ? R3_VIEW_CULLER_INSIDE : R3_VIEW_CULLER_INTERSECTING;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Screen-space size functions
+////////////////////////////////////////////////////////////////////////
+
+RNScalar R3ViewCuller::
+ProjectedLength(const R3Box& box, RNLength length) const
+{
+  // Return number of pixels spanned by length at point of box closest to eye
+  RNLength distance = R3Distance(eye, box);
+  if (distance < neardist) distance = neardist;
+  if (distance <= 0) return RN_INFINITY;
+  return length * focal_length / distance;
+}
+
+
+
+RNScalar R3ViewCuller::
+ProjectedLength(const R3Point& point, RNLength length) const
+{
+  // Return number of pixels spanned by length at point
+  RNLength distance = R3Distance(eye, point);
+  if (distance < neardist) distance = neardist;
+  if (distance <= 0) return RN_INFINITY;
+  return length * focal_length / distance;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Occlusion culling functions
+////////////////////////////////////////////////////////////////////////
+
+void R3ViewCuller::
+InsertOccluder(const R3Point& point, RNLength radius)
+{
+  // Check occlusion buffer
+  if (occluder_depths.empty()) return;
+
+  // Compute camera coordinates
+  R3Vector v = point - eye;
+  RNScalar z = v.Dot(towards);
+  if (z <= neardist) return;
+  RNScalar x = v.Dot(right);
+  RNScalar y = v.Dot(up);
+
+  // Compute cells whose centers are covered by footprint in occlusion buffer
+  // (footprint covers at least one cell, so that dense distant surfaces have no gaps)
+  RNScalar cx = (0.5 + 0.5 * x / (z * tan_xfov)) * occlusion_width;
+  RNScalar cy = (0.5 + 0.5 * y / (z * tan_yfov)) * occlusion_height;
+  RNScalar r = 0.5 * radius / (z * tan_xfov) * occlusion_width;
+  if (r < 0.5) r = 0.5;
+  if ((cx + r < 0) || (cx - r > occlusion_width)) return;
+  if ((cy + r < 0) || (cy - r > occlusion_height)) return;
+  int ix0 = (int) ceil(cx - r - 0.5); if (ix0 < 0) ix0 = 0;
+  int iy0 = (int) ceil(cy - r - 0.5); if (iy0 < 0) iy0 = 0;
+  int ix1 = (int) floor(cx + r - 0.5); if (ix1 >= occlusion_width) ix1 = occlusion_width - 1;
+  int iy1 = (int) floor(cy + r - 0.5); if (iy1 >= occlusion_height) iy1 = occlusion_height - 1;
+
+  // Remember nearest occluder covering each cell
+  for (int iy = iy0; iy <= iy1; iy++) {
+    float *depths = &occluder_depths[iy * occlusion_width];
+    for (int ix = ix0; ix <= ix1; ix++) {
+      if (z < depths[ix]) depths[ix] = z;
+    }
+  }
+}
+
+
+
+void R3ViewCuller::
+UpdateOcclusionHierarchy(void)
+{
+  // Check occlusion buffer
+  occlusion_levels.clear();
+  level_widths.clear();
+  level_heights.clear();
+  if (occluder_depths.empty()) return;
+
+  // Insert finest level
+  int w = occlusion_width;
+  int h = occlusion_height;
+  occlusion_levels.push_back(occluder_depths);
+  level_widths.push_back(w);
+  level_heights.push_back(h);
+
+  // Create coarser levels with maximum depth of children
+  while ((w > 1) || (h > 1)) {
+    const std::vector<float>& finer = occlusion_levels.back();
+    int fw = w, fh = h;
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+    std::vector<float> coarser(w * h, 0.0F);
+    for (int iy = 0; iy < h; iy++) {
+      for (int ix = 0; ix < w; ix++) {
+        float depth = 0;
+        for (int jy = 2*iy; (jy <= 2*iy+1) && (jy < fh); jy++) {
+          for (int jx = 2*ix; (jx <= 2*ix+1) && (jx < fw); jx++) {
+            float d = finer[jy * fw + jx];
+            if (d > depth) depth = d;
+          }
+        }
+        coarser[iy * w + ix] = depth;
+      }
+    }
+    occlusion_levels.push_back(coarser);
+    level_widths.push_back(w);
+    level_heights.push_back(h);
+  }
+}
+
+
+
+RNBoolean R3ViewCuller::
+IsOccluded(const R3Box& box) const
+{
+  // Check occlusion hierarchy
+  if (occlusion_levels.empty()) return FALSE;
+
+  // Compute nearest depth and extent of projection in finest level
+  RNScalar min_depth = FLT_MAX;
+  RNScalar xmin = FLT_MAX, ymin = FLT_MAX;
+  RNScalar xmax = -FLT_MAX, ymax = -FLT_MAX;
+  for (int octant = 0; octant < 8; octant++) {
+    R3Vector v = box.Corner(octant) - eye;
+    RNScalar z = v.Dot(towards);
+    if (z <= neardist) return FALSE;
+    RNScalar x = (0.5 + 0.5 * v.Dot(right) / (z * tan_xfov)) * occlusion_width;
+    RNScalar y = (0.5 + 0.5 * v.Dot(up) / (z * tan_yfov)) * occlusion_height;
+    if (z < min_depth) min_depth = z;
+    if (x < xmin) xmin = x;
+    if (x > xmax) xmax = x;
+    if (y < ymin) ymin = y;
+    if (y > ymax) ymax = y;
+  }
+
+  // Clamp extent to occlusion buffer
+  if ((xmax < 0) || (ymax < 0)) return FALSE;
+  if ((xmin >= occlusion_width) || (ymin >= occlusion_height)) return FALSE;
+  int ix0 = (xmin < 0) ? 0 : (int) xmin;
+  int iy0 = (ymin < 0) ? 0 : (int) ymin;
+  int ix1 = (xmax >= occlusion_width) ? occlusion_width - 1 : (int) xmax;
+  int iy1 = (ymax >= occlusion_height) ? occlusion_height - 1 : (int) ymax;
+
+  // Find level where extent spans at most two cells in each dimension
+  int level = 0;
+  while ((level < (int) occlusion_levels.size() - 1) && ((ix1 - ix0 > 1) || (iy1 - iy0 > 1))) {
+    ix0 /= 2; iy0 /= 2; ix1 /= 2; iy1 /= 2;
+    level++;
+  }
+
+  // Check whether nearest point of box is behind all occluders in extent
+  const std::vector<float>& depths = occlusion_levels[level];
+  int w = level_widths[level];
+  for (int iy = iy0; iy <= iy1; iy++) {
+    for (int ix = ix0; ix <= ix1; ix++) {
+      if (min_depth <= depths[iy * w + ix]) return FALSE;
+    }
+  }
+
+  // Box is occluded
+  return TRUE;
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,117 @@
+// Include file for view culling (frustum, screen-space size, and hierarchical-z occlusion)
+#ifndef __R3__VIEW__CULLER__H__
+#define __R3__VIEW__CULLER__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Frustum classification constants
+
+enum {
+  R3_VIEW_CULLER_OUTSIDE,
+  R3_VIEW_CULLER_INTERSECTING,
+  R3_VIEW_CULLER_INSIDE
+};
+
+
+
+// Class definition
+
+class R3ViewCuller {
+public:
+  // Constructor/deconstructor
+  R3ViewCuller(void);
+  ~R3ViewCuller(void);
+
+  // Property functions
+  const R3Viewer& Viewer(void) const;
+  const R3Frustum& Frustum(void) const;
+  int OcclusionResolution(int dim) const;
+
+  // View update functions (occlusion buffer is cleared when view is set)
+  RNBoolean IsViewChanged(const R3Viewer& viewer) const;
+  void SetView(const R3Viewer& viewer, int occlusion_resolution = 0);
+
+  // Frustum culling functions
+  int FrustumClassification(const R3Box& box) const;
+
+  // Screen-space size functions (in pixels, for length at nearest point of box)
+  RNScalar ProjectedLength(const R3Box& box, RNLength length) const;
+  RNScalar ProjectedLength(const R3Point& point, RNLength length) const;
+
+  // Occlusion culling functions (insert occluders, then update, then query)
+  void InsertOccluder(const R3Point& point, RNLength radius);
+  void UpdateOcclusionHierarchy(void);
+  RNBoolean IsOccluded(const R3Box& box) const;
+
+private:
+  R3Viewer viewer;
+  R3Frustum frustum;
+  R3Point eye;
+  R3Vector towards, up, right;
+  RNScalar tan_xfov, tan_yfov;
+  RNScalar neardist;
+  RNScalar focal_length;
+  int occlusion_width, occlusion_height;
+  std::vector<float> occluder_depths;
+  std::vector< std::vector<float> > occlusion_levels;
+  std::vector<int> level_widths, level_heights;
+};
+
+
+
+// Inline functions
+
+inline const R3Viewer& R3ViewCuller::
+Viewer(void) const
+{
+  // Return viewer used for culling
+  return viewer;
+}
+
+
+
+inline const R3Frustum& R3ViewCuller::
+Frustum(void) const
+{
+  // Return view frustum
+  return frustum;
+}
+
+
+
+inline int R3ViewCuller::
+OcclusionResolution(int dim) const
+{
+  // Return resolution of finest level of occlusion hierarchy
+  return (dim == RN_X) ? occlusion_width : occlusion_height;
+}
+
+
+
+inline RNBoolean R3ViewCuller::
+IsViewChanged(const R3Viewer& viewer) const
+{
+  // Return whether camera or viewport is different than the one used for culling
+  return (viewer != this->viewer) ? TRUE : FALSE;
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
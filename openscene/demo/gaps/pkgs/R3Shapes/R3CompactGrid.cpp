@@ -0,0 +1,311 @@
+// Source file for GAPS compact grid class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// NOTE:
+// A compact grid stores the same samples as an R3Grid, but with
+// float32, float16, uint16, or uint8 values rather than RNScalar
+// (see R2CompactGrid.cpp for the value encodings).  Grid files
+// (.grd) store float32 values, so they are read into float32
+// compact grids without conversion.
+////////////////////////////////////////////////////////////////////////
+
+
+
+// Include files
+
+#include "R3Shapes.h"
+#include <vector>
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3CompactGrid::
+R3CompactGrid(int xresolution, int yresolution, int zresolution, int value_type, RNScalar value_scale, RNScalar value_offset)
+  : world_to_grid_transform(R3identity_affine),
+    grid_data(NULL),
+    grid_size(0),
+    value_type(RN_GRID_FLOAT32_VALUE_TYPE)
+{
+  // Allocate zero values
+  Reset(xresolution, yresolution, zresolution, value_type, value_scale, value_offset);
+  if (grid_size > 0) memset(grid_data, 0, MemoryUsage());
+}
+
+
+
+R3CompactGrid::
+R3CompactGrid(const R3Grid& grid, int value_type, RNScalar value_scale, RNScalar value_offset)
+  : world_to_grid_transform(R3identity_affine),
+    grid_data(NULL),
+    grid_size(0),
+    value_type(RN_GRID_FLOAT32_VALUE_TYPE)
+{
+  // Encode grid values
+  SetGrid(grid, value_type, value_scale, value_offset);
+}
+
+
+
+R3CompactGrid::
+R3CompactGrid(const R3CompactGrid& grid)
+  : world_to_grid_transform(R3identity_affine),
+    grid_data(NULL),
+    grid_size(0),
+    value_type(RN_GRID_FLOAT32_VALUE_TYPE)
+{
+  // Copy grid
+  *this = grid;
+}
+
+
+
+R3CompactGrid::
+~R3CompactGrid(void)
+{
+  // Deallocate memory for grid values
+  if (grid_data) delete [] grid_data;
+}
+
+
+
+void R3CompactGrid::
+Reset(int xresolution, int yresolution, int zresolution, int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Check value type
+  assert((value_type >= 0) && (value_type < RN_GRID_NUM_VALUE_TYPES));
+
+  // Reallocate values if size changed
+  int size = xresolution * yresolution * zresolution;
+  if ((size != grid_size) || (value_type != this->value_type) || !grid_data) {
+    if (grid_data) delete [] grid_data;
+    grid_data = (size > 0) ? new unsigned char [ (size_t) size * RNGridValueTypeSize(value_type) ] : NULL;
+  }
+
+  // Set grid variables
+  grid_resolution[0] = xresolution;
+  grid_resolution[1] = yresolution;
+  grid_resolution[2] = zresolution;
+  grid_size = size;
+  this->value_type = value_type;
+  this->value_scale = value_scale;
+  this->value_offset = value_offset;
+}
+
+
+
+R3CompactGrid& R3CompactGrid::
+operator=(const R3CompactGrid& grid)
+{
+  // Copy grid values
+  Reset(grid.grid_resolution[0], grid.grid_resolution[1], grid.grid_resolution[2],
+    grid.value_type, grid.value_scale, grid.value_offset);
+  if (grid_size > 0) memcpy(grid_data, grid.grid_data, MemoryUsage());
+  world_to_grid_transform = grid.world_to_grid_transform;
+  return *this;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Conversion functions
+////////////////////////////////////////////////////////////////////////
+
+void R3CompactGrid::
+SetGrid(const R3Grid& grid, int value_type, RNScalar value_scale, RNScalar value_offset)
+{
+  // Encode grid values
+  Reset(grid.XResolution(), grid.YResolution(), grid.ZResolution(), value_type, value_scale, value_offset);
+  RNEncodeGridValues(grid.GridValues(), grid_size, grid_data, value_type, value_scale, value_offset);
+  world_to_grid_transform = grid.WorldToGridTransformation();
+}
+
+
+
+void R3CompactGrid::
+GetGrid(R3Grid& grid) const
+{
+  // Allocate grid values
+  if ((grid.grid_resolution[0] != grid_resolution[0]) ||
+      (grid.grid_resolution[1] != grid_resolution[1]) ||
+      (grid.grid_resolution[2] != grid_resolution[2])) {
+    if (grid.grid_values) delete [] grid.grid_values;
+    grid.grid_values = (grid_size > 0) ? new RNScalar [ grid_size ] : NULL;
+    grid.grid_resolution[0] = grid_resolution[0];
+    grid.grid_resolution[1] = grid_resolution[1];
+    grid.grid_resolution[2] = grid_resolution[2];
+    grid.grid_row_size = grid_resolution[0];
+    grid.grid_sheet_size = grid_resolution[0] * grid_resolution[1];
+    grid.grid_size = grid_size;
+  }
+
+  // Decode grid values
+  RNDecodeGridValues(grid_data, grid_size, grid.grid_values, value_type, value_scale, value_offset);
+  grid.SetWorldToGridTransformation(world_to_grid_transform);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// File reading/writing functions
+////////////////////////////////////////////////////////////////////////
+
+int R3CompactGrid::
+ReadFile(const char *filename)
+{
+  // Parse input filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    RNFail("Filename %s has no extension (e.g., .grd)\n", filename);
+    return 0;
+  }
+
+  // Read grid files directly
+  if (!strncmp(extension, ".grd", 4)) return ReadGridFile(filename);
+
+  // Read other file types via R3Grid
+  R3Grid grid;
+  if (!grid.ReadFile(filename)) return 0;
+  SetGrid(grid, RN_GRID_FLOAT32_VALUE_TYPE);
+  return 1;
+}
+
+
+
+int R3CompactGrid::
+WriteFile(const char *filename) const
+{
+  // Parse output filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    RNFail("Filename %s has no extension (e.g., .grd)\n", filename);
+    return 0;
+  }
+
+  // Write grid files directly
+  if (!strncmp(extension, ".grd", 4)) return WriteGridFile(filename);
+
+  // Write other file types via R3Grid
+  R3Grid grid;
+  GetGrid(grid);
+  return grid.WriteFile(filename);
+}
+
+
+
+int R3CompactGrid::
+ReadGridFile(const char *filename)
+{
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    RNFail("Unable to open grid file %s\n", filename);
+    return 0;
+  }
+
+  // Read grid resolution
+  int res[3];
+  if ((fread(res, sizeof(int), 3, fp) != 3) || (res[0] <= 0) || (res[1] <= 0) || (res[2] <= 0)) {
+    RNFail("Unable to read resolution from %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Read world_to_grid transformation
+  float m[16];
+  if (fread(m, sizeof(float), 16, fp) != 16) {
+    RNFail("Unable to read transformation from %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Read grid values directly into float32 storage
+  Reset(res[0], res[1], res[2], RN_GRID_FLOAT32_VALUE_TYPE, 1, 0);
+  if (fread(grid_data, sizeof(float), grid_size, fp) != (size_t) grid_size) {
+    RNFail("Unable to read grid values from %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Set transformation
+  world_to_grid_transform = R3Affine(R4Matrix(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7],
+    m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15]), 0);
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3CompactGrid::
+WriteGridFile(const char *filename) const
+{
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open grid file %s\n", filename);
+    return 0;
+  }
+
+  // Write grid resolution
+  if (fwrite(grid_resolution, sizeof(int), 3, fp) != 3) {
+    RNFail("Unable to write resolution to %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Write world_to_grid transformation
+  float m[16];
+  const RNScalar *matrix = &(world_to_grid_transform.Matrix()[0][0]);
+  for (int i = 0; i < 16; i++) m[i] = (float) matrix[i];
+  if (fwrite(m, sizeof(float), 16, fp) != 16) {
+    RNFail("Unable to write transformation to %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Write grid values (converting to float32 in chunks if necessary)
+  if (value_type == RN_GRID_FLOAT32_VALUE_TYPE) {
+    if (fwrite(grid_data, sizeof(float), grid_size, fp) != (size_t) grid_size) {
+      RNFail("Unable to write grid values to %s\n", filename);
+      fclose(fp);
+      return 0;
+    }
+  }
+  else {
+    const int chunk_size = 65536;
+    std::vector<float> values(chunk_size);
+    for (int start = 0; start < grid_size; start += chunk_size) {
+      int count = (start + chunk_size < grid_size) ? chunk_size : grid_size - start;
+      for (int i = 0; i < count; i++) values[i] = (float) GridValue(start + i);
+      if (fwrite(&values[0], sizeof(float), count, fp) != (size_t) count) {
+        RNFail("Unable to write grid values to %s\n", filename);
+        fclose(fp);
+        return 0;
+      }
+    }
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+} // namespace gaps
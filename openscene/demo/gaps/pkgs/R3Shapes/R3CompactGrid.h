@@ -0,0 +1,241 @@
+// Header file for GAPS compact grid class
+#ifndef __R3__COMPACT__GRID__H__
+#define __R3__COMPACT__GRID__H__
+
+
+
+/* Begin namespace */
+namespace gaps {
+
+
+
+// Class definition
+
+class R3CompactGrid {
+public:
+  // Constructors
+  R3CompactGrid(int xresolution = 0, int yresolution = 0, int zresolution = 0,
+    int value_type = RN_GRID_FLOAT32_VALUE_TYPE, RNScalar value_scale = 1, RNScalar value_offset = 0);
+  R3CompactGrid(const R3Grid& grid, int value_type = RN_GRID_FLOAT32_VALUE_TYPE,
+    RNScalar value_scale = 1, RNScalar value_offset = 0);
+  R3CompactGrid(const R3CompactGrid& grid);
+  ~R3CompactGrid(void);
+
+  // Grid property functions
+  int NEntries(void) const;
+  int XResolution(void) const;
+  int YResolution(void) const;
+  int ZResolution(void) const;
+  int ValueType(void) const;
+  int NBytesPerValue(void) const;
+  RNScalar ValueScale(void) const;
+  RNScalar ValueOffset(void) const;
+  size_t MemoryUsage(void) const;
+  const R3Affine& WorldToGridTransformation(void) const;
+
+  // Grid value access functions
+  RNScalar GridValue(int index) const;
+  RNScalar GridValue(int i, int j, int k) const;
+  const void *Data(void) const;
+
+  // Grid manipulation functions
+  void SetGridValue(int index, RNScalar value);
+  void SetGridValue(int i, int j, int k, RNScalar value);
+  void SetWorldToGridTransformation(const R3Affine& affine);
+  R3CompactGrid& operator=(const R3CompactGrid& grid);
+
+  // Conversion functions
+  void SetGrid(const R3Grid& grid);
+  void SetGrid(const R3Grid& grid, int value_type, RNScalar value_scale = 1, RNScalar value_offset = 0);
+  void GetGrid(R3Grid& grid) const;
+
+  // File reading/writing functions
+  int ReadFile(const char *filename);
+  int WriteFile(const char *filename) const;
+  int ReadGridFile(const char *filename);
+  int WriteGridFile(const char *filename) const;
+
+private:
+  void Reset(int xresolution, int yresolution, int zresolution, int value_type, RNScalar value_scale, RNScalar value_offset);
+
+private:
+  R3Affine world_to_grid_transform;
+  unsigned char *grid_data;
+  int grid_resolution[3];
+  int grid_size;
+  int value_type;
+  RNScalar value_scale;
+  RNScalar value_offset;
+};
+
+
+
+// Inline functions
+
+inline int R3CompactGrid::
+NEntries(void) const
+{
+  // Return total number of entries
+  return grid_size;
+}
+
+
+
+inline int R3CompactGrid::
+XResolution(void) const
+{
+  // Return resolution in X dimension
+  return grid_resolution[0];
+}
+
+
+
+inline int R3CompactGrid::
+YResolution(void) const
+{
+  // Return resolution in Y dimension
+  return grid_resolution[1];
+}
+
+
+
+inline int R3CompactGrid::
+ZResolution(void) const
+{
+  // Return resolution in Z dimension
+  return grid_resolution[2];
+}
+
+
+
+inline int R3CompactGrid::
+ValueType(void) const
+{
+  // Return type of stored values
+  return value_type;
+}
+
+
+
+inline int R3CompactGrid::
+NBytesPerValue(void) const
+{
+  // Return number of bytes per stored value
+  return RNGridValueTypeSize(value_type);
+}
+
+
+
+inline RNScalar R3CompactGrid::
+ValueScale(void) const
+{
+  // Return scale applied to integer values
+  return value_scale;
+}
+
+
+
+inline RNScalar R3CompactGrid::
+ValueOffset(void) const
+{
+  // Return offset applied to integer values
+  return value_offset;
+}
+
+
+
+inline size_t R3CompactGrid::
+MemoryUsage(void) const
+{
+  // Return number of bytes used to store values
+  return (size_t) grid_size * NBytesPerValue();
+}
+
+
+
+inline const R3Affine& R3CompactGrid::
+WorldToGridTransformation(void) const
+{
+  // Return transformation from world coordinates to grid coordinates
+  return world_to_grid_transform;
+}
+
+
+
+inline RNScalar R3CompactGrid::
+GridValue(int index) const
+{
+  // Return value at grid index
+  assert((index >= 0) && (index < grid_size));
+  return RNDecodeGridValue(grid_data, index, value_type, value_scale, value_offset);
+}
+
+
+
+inline RNScalar R3CompactGrid::
+GridValue(int i, int j, int k) const
+{
+  // Return value at grid point
+  assert((i >= 0) && (i < grid_resolution[0]));
+  assert((j >= 0) && (j < grid_resolution[1]));
+  assert((k >= 0) && (k < grid_resolution[2]));
+  return GridValue((k * grid_resolution[1] + j) * grid_resolution[0] + i);
+}
+
+
+
+inline const void *R3CompactGrid::
+Data(void) const
+{
+  // Return pointer to stored values
+  return grid_data;
+}
+
+
+
+inline void R3CompactGrid::
+SetGridValue(int index, RNScalar value)
+{
+  // Set value at grid index
+  assert((index >= 0) && (index < grid_size));
+  RNEncodeGridValue(value, grid_data, index, value_type, value_scale, value_offset);
+}
+
+
+
+inline void R3CompactGrid::
+SetGridValue(int i, int j, int k, RNScalar value)
+{
+  // Set value at grid point
+  assert((i >= 0) && (i < grid_resolution[0]));
+  assert((j >= 0) && (j < grid_resolution[1]));
+  assert((k >= 0) && (k < grid_resolution[2]));
+  SetGridValue((k * grid_resolution[1] + j) * grid_resolution[0] + i, value);
+}
+
+
+
+inline void R3CompactGrid::
+SetWorldToGridTransformation(const R3Affine& affine)
+{
+  // Set transformation from world coordinates to grid coordinates
+  world_to_grid_transform = affine;
+}
+
+
+
+inline void R3CompactGrid::
+SetGrid(const R3Grid& grid)
+{
+  // Encode grid values with current value type
+  SetGrid(grid, value_type, value_scale, value_offset);
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -14,6 +14,9 @@
 // Include files
 
 #include "R3Shapes.h"
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 
 
@@ -672,8 +675,351 @@ Erode(RNLength grid_distance)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Filter utility functions
+////////////////////////////////////////////////////////////////////////
+
+// The filters below process rows of the grid in parallel.  Convolutions
+// in Y and Z combine whole rows at once, so that inner loops run over
+// contiguous memory, and min/max filters decompose the sphere into spans
+// along X that are processed with running extrema.  All of them compute
+// the same values as a direct per-sample evaluation.
+
+struct R3GridFilterData {
+  RNScalar *values;
+  const RNScalar *source;
+  int xres, yres, zres;
+  const RNScalar *filter;
+  int radius;
+  int dim;
+  const int *span_widths;
+  RNScalar percentile;
+  RNBoolean maximum;
+  RNScalar value_denom;
+  std::vector<std::vector<RNScalar> > buffers;
+};
+
+
+
+static void
+InitializeFilterData(R3GridFilterData& data, RNScalar *values, const RNScalar *source, int xres, int yres, int zres)
+{
+  // Initialize filter data
+  data.values = values;
+  data.source = source;
+  data.xres = xres;
+  data.yres = yres;
+  data.zres = zres;
+  data.filter = NULL;
+  data.radius = 0;
+  data.dim = RN_X;
+  data.span_widths = NULL;
+  data.percentile = 0;
+  data.maximum = FALSE;
+  data.value_denom = 0;
+  data.buffers.resize(RNNThreads());
+}
+
+
+
+static RNScalar *
+FilterBuffer(R3GridFilterData *data, int thread_index, int size)
+{
+  // Return scratch buffer for thread
+  std::vector<RNScalar>& buffer = data->buffers[thread_index];
+  if ((int) buffer.size() < size) buffer.resize(size);
+  return &buffer[0];
+}
+
+
+
+static void
+ComputeSpanWidths(RNScalar radius_squared, int r, int *span_widths)
+{
+  // Compute half width of sphere in every row (dx*dx + dy*dy + dz*dz <= radius_squared),
+  // or -1 if row (dy, dz) does not intersect the sphere
+  for (int dz = 0; dz <= r; dz++) {
+    for (int dy = 0; dy <= r; dy++) {
+      int *span_width = &span_widths[dz*(r+1) + dy];
+      *span_width = -1;
+      for (int dx = r; dx >= 0; dx--) {
+        if (dx*dx + dy*dy + dz*dz <= radius_squared) { *span_width = dx; break; }
+      }
+    }
+  }
+}
+
+
+
+static void
+BlurGridRow(int index, int thread_index, void *ptr)
+{
+  // Convolve one row with filter in X direction
+  R3GridFilterData *data = (R3GridFilterData *) ptr;
+  const RNScalar *filter = data->filter;
+  int filter_radius = data->radius;
+  int nx = data->xres;
+  RNScalar *row = data->values + index * nx;
+  RNScalar *buffer = FilterBuffer(data, thread_index, nx);
+  for (int i = 0; i < nx; i++) buffer[i] = row[i];
+  for (int i = 0; i < nx; i++) {
+    RNScalar sum = filter[0] * buffer[i];
+    RNScalar weight = filter[0];
+    int nsamples = i;
+    if (nsamples > filter_radius) nsamples = filter_radius;
+    for (int m = 1; m <= nsamples; m++) {
+      sum += filter[m] * buffer[i - m];
+      weight += filter[m];
+    }
+    nsamples = nx - 1 - i;
+    if (nsamples > filter_radius) nsamples = filter_radius;
+    for (int m = 1; m <= nsamples; m++) {
+      sum += filter[m] * buffer[i + m];
+      weight += filter[m];
+    }
+    row[i] = sum / weight;
+  }
+}
+
+
+
+static void
+BlurGridAcrossRows(int index, int thread_index, void *ptr)
+{
+  // Convolve one row with filter in Y or Z direction, combining whole rows of source
+  R3GridFilterData *data = (R3GridFilterData *) ptr;
+  const RNScalar *filter = data->filter;
+  int filter_radius = data->radius;
+  int nx = data->xres;
+  int position = (data->dim == RN_Y) ? index % data->yres : index / data->yres;
+  int resolution = (data->dim == RN_Y) ? data->yres : data->zres;
+  int stride = (data->dim == RN_Y) ? nx : nx * data->yres;
+  const RNScalar *source = data->source + index * nx;
+  RNScalar *sums = FilterBuffer(data, thread_index, nx);
+
+  // Add center sample
+  RNScalar weight = filter[0];
+  for (int i = 0; i < nx; i++) sums[i] = filter[0] * source[i];
+
+  // Add samples in rows before
+  int nsamples = position;
+  if (nsamples > filter_radius) nsamples = filter_radius;
+  for (int m = 1; m <= nsamples; m++) {
+    const RNScalar *samples = source - m * stride;
+    for (int i = 0; i < nx; i++) sums[i] += filter[m] * samples[i];
+    weight += filter[m];
+  }
+
+  // Add samples in rows after
+  nsamples = resolution - 1 - position;
+  if (nsamples > filter_radius) nsamples = filter_radius;
+  for (int m = 1; m <= nsamples; m++) {
+    const RNScalar *samples = source + m * stride;
+    for (int i = 0; i < nx; i++) sums[i] += filter[m] * samples[i];
+    weight += filter[m];
+  }
+
+  // Set values
+  RNScalar *row = data->values + index * nx;
+  for (int i = 0; i < nx; i++) row[i] = sums[i] / weight;
+}
+
+
+
+static void
+RunningMinimum(const RNScalar *values, int n, int w, RNBoolean negate,
+  RNScalar *result, RNScalar *prefix, RNScalar *suffix)
+{
+  // Compute minimum of values within w of every index with the van Herk/Gil-Werman
+  // algorithm (three comparisons per value for any w).  Values are negated first
+  // if negate is set (to compute maxima).
+  int k = 2*w + 1;
+  int npadded = ((n + 2*w + k - 1) / k) * k;
+
+  // Compute prefix minima within blocks of k padded values
+  for (int i = 0; i < npadded; i++) {
+    int index = i - w;
+    RNScalar value = DBL_MAX;
+    if ((index >= 0) && (index < n)) value = (negate) ? -values[index] : values[index];
+    suffix[i] = value;
+    if ((i % k) == 0) prefix[i] = value;
+    else prefix[i] = (value < prefix[i-1]) ? value : prefix[i-1];
+  }
+
+  // Compute suffix minima within blocks
+  for (int i = npadded - 2; i >= 0; i--) {
+    if ((i % k) == (k - 1)) continue;
+    if (suffix[i+1] < suffix[i]) suffix[i] = suffix[i+1];
+  }
+
+  // Combine suffix and prefix minima to get minimum of window [index-w, index+w]
+  for (int i = 0; i < n; i++) {
+    result[i] = (suffix[i] < prefix[i + 2*w]) ? suffix[i] : prefix[i + 2*w];
+  }
+}
+
+
+
+static void
+MinMaxFilterRow(int index, int thread_index, void *ptr)
+{
+  // Compute min/max of sphere around every sample in one row
+  R3GridFilterData *data = (R3GridFilterData *) ptr;
+  int r = data->radius;
+  int nx = data->xres;
+  int ny = data->yres;
+  int cy = index % ny;
+  int cz = index / ny;
+  RNScalar *extrema = FilterBuffer(data, thread_index, 4*nx + 8*r + 2);
+  RNScalar *line = extrema + nx;
+  RNScalar *prefix = line + nx;
+  RNScalar *suffix = prefix + nx + 4*r + 1;
+  for (int cx = 0; cx < nx; cx++) extrema[cx] = DBL_MAX;
+
+  // Combine running extrema of spans in rows within radius
+  int zmin = cz - r;
+  int zmax = cz + r;
+  if (zmin < 0) zmin = 0;
+  if (zmax >= data->zres) zmax = data->zres - 1;
+  int ymin = cy - r;
+  int ymax = cy + r;
+  if (ymin < 0) ymin = 0;
+  if (ymax >= ny) ymax = ny - 1;
+  for (int z = zmin; z <= zmax; z++) {
+    int dz = (z < cz) ? cz - z : z - cz;
+    for (int y = ymin; y <= ymax; y++) {
+      int dy = (y < cy) ? cy - y : y - cy;
+      int w = data->span_widths[dz*(r+1) + dy];
+      if (w < 0) continue;
+      RunningMinimum(data->source + (z*ny + y) * nx, nx, w, data->maximum, line, prefix, suffix);
+      for (int cx = 0; cx < nx; cx++) {
+        if (line[cx] < extrema[cx]) extrema[cx] = line[cx];
+      }
+    }
+  }
+
+  // Set values
+  RNScalar *row = data->values + index * nx;
+  for (int cx = 0; cx < nx; cx++) {
+    row[cx] = (data->maximum) ? -extrema[cx] : extrema[cx];
+  }
+}
+
+
+
+static void
+PercentileFilterRow(int index, int thread_index, void *ptr)
+{
+  // Compute percentile of sphere around every sample in one row
+  R3GridFilterData *data = (R3GridFilterData *) ptr;
+  int r = data->radius;
+  int nx = data->xres;
+  int ny = data->yres;
+  int cy = index % ny;
+  int cz = index / ny;
+  RNScalar *samples = FilterBuffer(data, thread_index, (2*r+1) * (2*r+1) * (2*r+1));
+  int zmin = cz - r;
+  int zmax = cz + r;
+  if (zmin < 0) zmin = 0;
+  if (zmax >= data->zres) zmax = data->zres - 1;
+  int ymin = cy - r;
+  int ymax = cy + r;
+  if (ymin < 0) ymin = 0;
+  if (ymax >= ny) ymax = ny - 1;
+  for (int cx = 0; cx < nx; cx++) {
+    // Build list of grid values in neighborhood
+    int nsamples = 0;
+    for (int z = zmin; z <= zmax; z++) {
+      int dz = (z < cz) ? cz - z : z - cz;
+      for (int y = ymin; y <= ymax; y++) {
+        int dy = (y < cy) ? cy - y : y - cy;
+        int w = data->span_widths[dz*(r+1) + dy];
+        if (w < 0) continue;
+        int xmin = cx - w;
+        int xmax = cx + w;
+        if (xmin < 0) xmin = 0;
+        if (xmax >= nx) xmax = nx - 1;
+        const RNScalar *row = data->source + (z*ny + y) * nx;
+        for (int x = xmin; x <= xmax; x++) samples[nsamples++] = row[x];
+      }
+    }
+
+    // Check number of grid values in neighborhood
+    RNScalar *value = &data->values[index * nx + cx];
+    if (nsamples == 0) {
+      *value = 0;
+    }
+    else {
+      // Set grid value to percentile of neighborhood
+      int k = (int) (data->percentile * nsamples);
+      if (k < 0) k = 0;
+      else if (k >= nsamples) k = nsamples-1;
+      std::nth_element(samples, samples + k, samples + nsamples);
+      *value = samples[k];
+    }
+  }
+}
+
+
+
+static void
+BilateralFilterRow(int index, int thread_index, void *ptr)
+{
+  // Compute bilateral filter of sphere around every sample in one row
+  R3GridFilterData *data = (R3GridFilterData *) ptr;
+  const RNScalar *grid_weights = data->filter;
+  int r = data->radius;
+  int nx = data->xres;
+  int ny = data->yres;
+  int cy = index % ny;
+  int cz = index / ny;
+  int zmin = cz - r;
+  int zmax = cz + r;
+  if (zmin < 0) zmin = 0;
+  if (zmax >= data->zres) zmax = data->zres - 1;
+  int ymin = cy - r;
+  int ymax = cy + r;
+  if (ymin < 0) ymin = 0;
+  if (ymax >= ny) ymax = ny - 1;
+  for (int cx = 0; cx < nx; cx++) {
+    // Get current value
+    RNScalar value = data->source[index * nx + cx];
+
+    // Sum samples in neighborhood weighted by grid and value distances
+    RNScalar sum = 0;
+    RNScalar weight = 0;
+    for (int z = zmin; z <= zmax; z++) {
+      int dz = z - cz;
+      for (int y = ymin; y <= ymax; y++) {
+        int dy = y - cy;
+        int w = data->span_widths[((dz < 0) ? -dz : dz)*(r+1) + ((dy < 0) ? -dy : dy)];
+        if (w < 0) continue;
+        int xmin = cx - w;
+        int xmax = cx + w;
+        if (xmin < 0) xmin = 0;
+        if (xmax >= nx) xmax = nx - 1;
+        const RNScalar *row = data->source + (z*ny + y) * nx;
+        const RNScalar *row_weights = grid_weights + ((dz + r) * (2*r + 1) + (dy + r)) * (2*r + 1) + r;
+        for (int x = xmin; x <= xmax; x++) {
+          RNScalar sample = row[x];
+          RNScalar value_distance_squared = value - sample;
+          value_distance_squared *= value_distance_squared;
+          RNScalar w = row_weights[x - cx] * exp(value_distance_squared/data->value_denom);
+          sum += w * sample;
+          weight += w;
+        }
+      }
+    }
+
+    // Set new value
+    if (weight > 0) data->values[index * nx + cx] = sum / weight;
+  }
+}
+
+
+
 void R3Grid::
-Blur(RNLength grid_sigma) 
+Blur(RNLength grid_sigma)
 {
   // Check sigma
   if (RNIsZero(grid_sigma)) return;
@@ -684,14 +1030,7 @@ Blur(RNLength grid_sigma)
   RNScalar *filter = new RNScalar [ filter_radius + 1 ];
   assert(filter);
 
-  // Make buffer for temporary copy of row
-  int res = XResolution();
-  if (res < YResolution()) res = YResolution();
-  if (res < ZResolution()) res = ZResolution();
-  RNScalar *buffer = new RNScalar [ res ];
-  assert(buffer);
-
-  // Fill filter with Gaussian 
+  // Fill filter with Gaussian
   const RNScalar sqrt_two_pi = sqrt(RN_TWO_PI);
   double a = sqrt_two_pi * sigma;
   double fac = 1.0 / (a * a * a);
@@ -701,83 +1040,24 @@ Blur(RNLength grid_sigma)
   }
 
   // Convolve grid with filter in X direction
-  for (int k = 0; k < ZResolution(); k++) {
-    for (int j = 0; j < YResolution(); j++) { 
-      for (int i = 0; i < XResolution(); i++) 
-        buffer[i] = GridValue(i, j, k); 
-      for (int i = 0; i < XResolution(); i++) { 
-        RNScalar sum = filter[0] * buffer[i];
-        RNScalar weight = filter[0];
-        int nsamples = i;
-        if (nsamples > filter_radius) nsamples = filter_radius;
-        for (int m = 1; m <= nsamples; m++) {
-          sum += filter[m] * buffer[i - m];
-          weight += filter[m];
-        }
-        nsamples = XResolution() - 1 - i;
-        if (nsamples > filter_radius) nsamples = filter_radius;
-        for (int m = 1; m <= nsamples; m++) {
-          sum += filter[m] * buffer[i + m];
-          weight += filter[m];
-        }
-        SetGridValue(i, j, k, sum / weight);
-      }
-    }
-  }
-
-  // Convolve grid with filter in Y direction
-  for (int k = 0; k < ZResolution(); k++) {
-    for (int j = 0; j < XResolution(); j++) { 
-      for (int i = 0; i < YResolution(); i++) 
-        buffer[i] = GridValue(j, i, k); 
-      for (int i = 0; i < YResolution(); i++) { 
-        RNScalar sum = filter[0] * buffer[i];
-        RNScalar weight = filter[0];
-        int nsamples = i;
-        if (nsamples > filter_radius) nsamples = filter_radius;
-        for (int m = 1; m <= nsamples; m++) {
-          sum += filter[m] * buffer[i - m];
-          weight += filter[m];
-        }
-        nsamples = YResolution() - 1 - i;
-        if (nsamples > filter_radius) nsamples = filter_radius;
-        for (int m = 1; m <= nsamples; m++) {
-          sum += filter[m] * buffer[i + m];
-          weight += filter[m];
-        }
-        SetGridValue(j, i, k, sum / weight);
-      }
-    }
-  }
-
-  // Convolve grid with filter in Z direction
-  for (int k = 0; k < YResolution(); k++) {
-    for (int j = 0; j < XResolution(); j++) { 
-      for (int i = 0; i < ZResolution(); i++) 
-        buffer[i] = GridValue(j, k, i); 
-      for (int i = 0; i < ZResolution(); i++) { 
-        RNScalar sum = filter[0] * buffer[i];
-        RNScalar weight = filter[0];
-        int nsamples = i;
-        if (nsamples > filter_radius) nsamples = filter_radius;
-        for (int m = 1; m <= nsamples; m++) {
-          sum += filter[m] * buffer[i - m];
-          weight += filter[m];
-        }
-        nsamples = ZResolution() - 1 - i;
-        if (nsamples > filter_radius) nsamples = filter_radius;
-        for (int m = 1; m <= nsamples; m++) {
-          sum += filter[m] * buffer[i + m];
-          weight += filter[m];
-        }
-        SetGridValue(j, k, i, sum / weight);
-      }
-    }
+  int nrows = YResolution() * ZResolution();
+  R3GridFilterData data;
+  InitializeFilterData(data, grid_values, grid_values, XResolution(), YResolution(), ZResolution());
+  data.filter = filter;
+  data.radius = filter_radius;
+  RNParallelFor(nrows, BlurGridRow, &data);
+
+  // Convolve grid with filter in Y and Z directions
+  R3Grid copy(*this);
+  data.source = copy.grid_values;
+  for (int dim = RN_Y; dim <= RN_Z; dim++) {
+    if (dim == RN_Z) copy = *this;
+    data.dim = dim;
+    RNParallelFor(nrows, BlurGridAcrossRows, &data);
   }
 
   // Deallocate memory
   delete [] filter;
-  delete [] buffer;
 }
 
 
@@ -796,56 +1076,35 @@ BilateralFilter(RNLength grid_sigma, RNLength value_sigma)
 
   // Get convenient variables
   double grid_denom = -2.0 * grid_sigma * grid_sigma;
-  double value_denom = -2.0 * value_sigma * value_sigma;
   RNScalar grid_radius = 3 * grid_sigma;
   int r = (int) (grid_radius + 1);
   int r_squared = r * r;
 
-  // Set every sample to be median of surrounding region in input grid
-  for (int cz = 0; cz < ZResolution(); cz++) {
-    for (int cy = 0; cy < YResolution(); cy++) {
-      for (int cx = 0; cx < XResolution(); cx++) {
-        // Get current value
-        RNScalar value = copy.GridValue(cx, cy, cz);
-
-        // Compute new value
-        RNScalar sum = 0;
-        RNScalar weight = 0;
-        int zmin = cz - r;
-        int zmax = cz + r;
-        if (zmin < 0) zmin = 0;
-        if (zmax >= ZResolution()) zmax = ZResolution() - 1;
-        for (int z = zmin; z <= zmax; z++) {
-          int ymin = cy - r;
-          int ymax = cy + r;
-          if (ymin < 0) ymin = 0;
-          if (ymax >= YResolution()) ymax = YResolution() - 1;
-          int dz = z - cz;
-          for (int y = ymin; y <= ymax; y++) {
-            int xmin = cx - r;
-            int xmax = cx + r;
-            if (xmin < 0) xmin = 0;
-            if (xmax >= XResolution()) xmax = XResolution() - 1;
-            int dy = y - cy;
-            for (int x = xmin; x <= xmax; x++) {
-              int dx = x - cx;
-              int grid_distance_squared = dx*dx + dy*dy + dz*dz;
-              if (grid_distance_squared > r_squared) continue;
-              RNScalar sample = copy.GridValue(x, y, z);
-              RNScalar value_distance_squared = value - sample;
-              value_distance_squared *= value_distance_squared;
-              RNScalar w = exp(grid_distance_squared/grid_denom) * exp(value_distance_squared/value_denom);
-              sum += w * sample;
-              weight += w;
-            }
-          }
-        }
-
-        // Set new value
-        if (weight > 0) SetGridValue(cx, cy, cz, sum / weight);
+  // Tabulate weights for grid distances
+  int *span_widths = new int [ (r + 1) * (r + 1) ];
+  ComputeSpanWidths(r_squared, r, span_widths);
+  RNScalar *grid_weights = new RNScalar [ (2*r+1) * (2*r+1) * (2*r+1) ];
+  for (int dz = -r; dz <= r; dz++) {
+    for (int dy = -r; dy <= r; dy++) {
+      for (int dx = -r; dx <= r; dx++) {
+        int grid_distance_squared = dx*dx + dy*dy + dz*dz;
+        grid_weights[((dz+r)*(2*r+1) + (dy+r))*(2*r+1) + (dx+r)] = exp(grid_distance_squared/grid_denom);
       }
     }
   }
+
+  // Set every sample to be filter of surrounding region in input grid
+  R3GridFilterData data;
+  InitializeFilterData(data, grid_values, copy.grid_values, XResolution(), YResolution(), ZResolution());
+  data.filter = grid_weights;
+  data.radius = r;
+  data.span_widths = span_widths;
+  data.value_denom = -2.0 * value_sigma * value_sigma;
+  RNParallelFor(YResolution() * ZResolution(), BilateralFilterRow, &data);
+
+  // Delete temporary memory
+  delete [] span_widths;
+  delete [] grid_weights;
 }
 
 
@@ -981,62 +1240,27 @@ PercentileFilter(RNLength grid_radius, RNScalar percentile)
   RNScalar grid_radius_squared = grid_radius * grid_radius;
   int r = (int) grid_radius;
   assert(r >= 0);
-  int max_samples = (2*r+1) * (2*r+1) * (2*r+1);
-  RNScalar *samples = new RNScalar [ max_samples ];
-  assert(samples);
+  int *span_widths = new int [ (r + 1) * (r + 1) ];
+  ComputeSpanWidths(grid_radius_squared, r, span_widths);
 
   // Set every sample to be Kth percentile of surrounding region in input grid
-  for (int cz = 0; cz < ZResolution(); cz++) {
-    for (int cy = 0; cy < YResolution(); cy++) {
-      for (int cx = 0; cx < XResolution(); cx++) {
-        // Build list of grid values in neighborhood
-        int nsamples = 0;
-        int zmin = cz - r;
-        int zmax = cz + r;
-        if (zmin < 0) zmin = 0;
-        if (zmax >= ZResolution()) zmax = ZResolution() - 1;
-        for (int z = zmin; z <= zmax; z++) {
-          int dz = z - cz;
-          int ymin = cy - r;
-          int ymax = cy + r;
-          if (ymin < 0) ymin = 0;
-          if (ymax >= YResolution()) ymax = YResolution() - 1;
-          for (int y = ymin; y <= ymax; y++) {
-            int dy = y - cy;
-            int xmin = cx - r;
-            int xmax = cx + r;
-            if (xmin < 0) xmin = 0;
-            if (xmax >= XResolution()) xmax = XResolution() - 1;
-            for (int x = xmin; x <= xmax; x++) {
-              int dx = x - cx;
-              int d_squared = dx*dx + dy*dy + dz*dz;
-              if (d_squared > grid_radius_squared) continue;
-              RNScalar sample = copy.GridValue(x, y, z);
-              samples[nsamples++] = sample;
-            }
-          }
-        }
-
-        // Check number of grid values in neighborhood
-        if (nsamples == 0) {
-          SetGridValue(cx, cy, cz, 0);
-        }
-        else {
-          // Sort samples found in neighborhood
-          qsort(samples, nsamples, sizeof(RNScalar), RNCompareScalars);
-
-          // Set grid value to percentile of neighborhood
-          int index = (int) (percentile * nsamples);
-          if (index < 0) index = 0;
-          else if (index >= nsamples) index = nsamples-1;
-          SetGridValue(cx, cy, cz, samples[index]);
-        }
-      }
-    }
+  R3GridFilterData data;
+  InitializeFilterData(data, grid_values, copy.grid_values, XResolution(), YResolution(), ZResolution());
+  data.radius = r;
+  data.span_widths = span_widths;
+  data.percentile = percentile;
+  if ((percentile <= 0) || (percentile >= 1)) {
+    // Minimum or maximum (running extrema of spans)
+    data.maximum = (percentile >= 1) ? TRUE : FALSE;
+    RNParallelFor(YResolution() * ZResolution(), MinMaxFilterRow, &data);
+  }
+  else {
+    // General percentile (selection in every neighborhood)
+    RNParallelFor(YResolution() * ZResolution(), PercentileFilterRow, &data);
   }
 
   // Delete temporary memory
-  delete [] samples;
+  delete [] span_widths;
 }
 
 
@@ -1071,77 +1295,76 @@ MaskNonMaxima(RNLength grid_radius)
 
 
 
-void R3Grid::
-FillHoles(int max_hole_size)
+struct R3GridFillData {
+  RNScalar *values;
+  int max_hole_size;
+  int line_length;
+  int line_group_size;
+  int line_group_stride;
+  int line_stride;
+  int element_stride;
+};
+
+
+
+static void
+FillHolesLine(int line, int, void *ptr)
 {
-  // Interpolate in z
-  for (int ix = 0; ix < XResolution(); ix++) {
-    for (int iy = 0; iy < YResolution(); iy++) {
-      int iz0 = -1;
-      for (int iz1 = 0; iz1 < ZResolution(); iz1++) {
-        if (GridValue(ix, iy, iz1) != 0.0) { 
-          if ((iz0 >= 0) && (iz0 < iz1-1) && (iz1-iz0 < max_hole_size)) {
-            RNScalar value0 = GridValue(ix, iy, iz0);
-            if (value0 == 0.0) continue;
-            RNScalar value1 = GridValue(ix, iy, iz1);
-            if (value1 == 0.0) continue;
-            for (int iz = iz0+1; iz < iz1; iz++) {
-              RNScalar t = (double) (iz - iz0) / (double) (iz1 - iz0);
-              RNScalar value = (1-t)*value0 + t*value1;
-              SetGridValue(ix, iy, iz, value);
-            }
-          }
-          iz0 = iz1;
-        }
+  // Interpolate across short runs of zero values along one line
+  R3GridFillData *data = (R3GridFillData *) ptr;
+  size_t start = (size_t) (line % data->line_group_size) * data->line_stride +
+    (size_t) (line / data->line_group_size) * data->line_group_stride;
+  RNScalar *values = data->values + start;
+  size_t stride = data->element_stride;
+  int i0 = -1;
+  for (int i1 = 0; i1 < data->line_length; i1++) {
+    RNScalar value1 = values[i1 * stride];
+    if (value1 == 0.0) continue;
+    if ((i0 >= 0) && (i0 < i1-1) && (i1-i0 < data->max_hole_size)) {
+      RNScalar value0 = values[i0 * stride];
+      for (int i = i0+1; i < i1; i++) {
+        RNScalar t = (double) (i - i0) / (double) (i1 - i0);
+        values[i * stride] = (1-t)*value0 + t*value1;
       }
     }
+    i0 = i1;
   }
-  
+}
+
+
+
+void R3Grid::
+FillHoles(int max_hole_size)
+{
+  // Initialize data
+  R3GridFillData data;
+  data.values = grid_values;
+  data.max_hole_size = max_hole_size;
+  int sheet_size = XResolution() * YResolution();
+
+  // Interpolate in z
+  data.line_length = ZResolution();
+  data.line_group_size = sheet_size;
+  data.line_group_stride = 0;
+  data.line_stride = 1;
+  data.element_stride = sheet_size;
+  RNParallelFor(sheet_size, FillHolesLine, &data, 16);
+
   // Interpolate in y
-  for (int iz = 0; iz < ZResolution(); iz++) {
-    for (int ix = 0; ix < XResolution(); ix++) {
-      int iy0 = -1;
-      for (int iy1 = 0; iy1 < YResolution(); iy1++) {
-        if (GridValue(ix, iy1, iz) != 0.0) { 
-          if ((iy0 >= 0) && (iy0 < iy1-1) && (iy1-iy0 < max_hole_size)) {
-            RNScalar value0 = GridValue(ix, iy0, iz);
-            if (value0 == 0.0) continue;
-            RNScalar value1 = GridValue(ix, iy1, iz);
-            if (value1 == 0.0) continue;
-            for (int iy = iy0+1; iy < iy1; iy++) {
-              RNScalar t = (double) (iy - iy0) / (double) (iy1 - iy0);
-              RNScalar value = (1-t)*value0 + t*value1;
-              SetGridValue(ix, iy, iz, value);
-            }
-          }
-          iy0 = iy1;
-        }
-      }
-    }
-  }
-  
+  data.line_length = YResolution();
+  data.line_group_size = XResolution();
+  data.line_group_stride = sheet_size;
+  data.line_stride = 1;
+  data.element_stride = XResolution();
+  RNParallelFor(XResolution() * ZResolution(), FillHolesLine, &data, 16);
+
   // Interpolate in x
-  for (int iy = 0; iy < YResolution(); iy++) {
-    for (int iz = 0; iz < ZResolution(); iz++) {
-      int ix0 = -1;
-      for (int ix1 = 0; ix1 < XResolution(); ix1++) {
-        if (GridValue(ix1, iy, iz) != 0.0) { 
-          if ((ix0 >= 0) && (ix0 < ix1-1) && (ix1-ix0 < max_hole_size)) {
-            RNScalar value0 = GridValue(ix0, iy, iz);
-            if (value0 == 0.0) continue;
-            RNScalar value1 = GridValue(ix1, iy, iz);
-            if (value1 == 0.0) continue;
-            for (int ix = ix0+1; ix < ix1; ix++) {
-              RNScalar t = (double) (ix - ix0) / (double) (ix1 - ix0);
-              RNScalar value = (1-t)*value0 + t*value1;
-              SetGridValue(ix, iy, iz, value);
-            }
-          }
-          ix0 = ix1;
-        }
-      }
-    }
-  }
+  data.line_length = XResolution();
+  data.line_group_size = 1;
+  data.line_group_stride = XResolution();
+  data.line_stride = 0;
+  data.element_stride = 1;
+  RNParallelFor(YResolution() * ZResolution(), FillHolesLine, &data);
 }
 
 
@@ -1416,218 +1639,150 @@ Threshold(RNScalar threshold, RNScalar low, RNScalar high)
 
 
 void R3Grid::
-Voronoi(R3Grid *squared_distance_grid)
+SignedDistanceTransform(void)
 {
-  int dist;
-  int* old_dist;
-  int* new_dist;
-  RNScalar value;
-  RNScalar *old_value;
-  RNScalar *new_value;
-  R3Grid *dgrid;
-  int res,square,tmp_dist,first;
-  int x,y,z,s,t,i;
+  // Compute distance from boundary into interior (negative) and into exterior (positive)
+  R3Grid copy(*this);
+  SquaredDistanceTransform();
+  Sqrt();
+  copy.Threshold(0, 1, 0);
+  copy.Substitute(R2_GRID_UNKNOWN_VALUE, 1);
+  copy.SquaredDistanceTransform();
+  copy.Sqrt();
+  Subtract(copy);
+}
 
-  // Allocate distance grid
-  if (squared_distance_grid) dgrid = squared_distance_grid;
-  else dgrid = new R3Grid(XResolution(), YResolution(), ZResolution());
-  assert(dgrid);
-  dgrid->SetWorldToGridTransformation(WorldToGridTransformation());
 
-  // Allocate temporary buffers
-  res = XResolution();
-  if (res < YResolution()) res = YResolution();
-  if (res < ZResolution()) res = ZResolution();
-  old_dist = new int[res];
-  new_dist = new int[res];
-  old_value = new RNScalar[res];
-  new_value = new RNScalar[res];
-  assert(old_dist && new_dist && old_value && new_value);
 
-  // Initalize distance grid values (0 if was set, max_value if not)
-  RNScalar max_value = 3 * (res+1) * (res+1) * (res+1);
-  for (i = 0; i < grid_size; i++) {
-    if (grid_values[i] == 0.0) dgrid->grid_values[i] = max_value;
-    else dgrid->grid_values[i] = 0.0;
-  }
+////////////////////////////////////////////////////////////////////////
+// Distance transform utility functions
+////////////////////////////////////////////////////////////////////////
 
-  // Scan along z axis
-  for (x = 0; x < XResolution(); x++) {
-    for (y = 0; y < YResolution(); y++) {
-      first = 1;
-      value = 0;
-      dist = 0;
-      for (z = 0; z < ZResolution(); z++) {
-        if (dgrid->GridValue(x,y,z) == 0.0) {
-          first=0;
-          dist=0;
-          value = GridValue(x,y,z);
-          assert(value != 0);
-        }
-        else if (first == 0) {
-          dist++;
-          square = dist*dist;
-          dgrid->SetGridValue(x, y, z, square);
-          SetGridValue(x, y, z, value);
-          assert(value != 0);
-        }
-      }
-			
-      // backward scan
-      dist = 0;
-      first = 1;
-      for (z = ZResolution()-1; z >= 0; z--) {
-        if (dgrid->GridValue(x,y,z) == 0.0){
-          dist = 0;
-          first = 0;
-          value = GridValue(x,y,z);
-          assert(value != 0);
-        }
-        else if (first == 0) {
-          dist++;
-          square = dist*dist;
-          if (square < dgrid->GridValue(x, y, z)) {
-            dgrid->SetGridValue(x, y, z, square);
-            SetGridValue(x, y, z, value);
-            assert(value != 0);
-          }
-        }
-      }
-    }
-  } 
-
-  // Scan along x axis
-  for (z = 0; z < ZResolution(); z++) {
-    for (y = 0; y < YResolution(); y++) {
-      // Copy grid values
-      for(x = 0; x < XResolution(); x++) {
-        old_dist[x] = (int) (dgrid->GridValue(x, y, z) + 0.5);
-        old_value[x] = GridValue(x, y, z);
-      }
-		
-      // forward scan
-      s = 0;
-      for (x = 0; x < XResolution(); x++) {
-        dist = old_dist[x];
-        value = old_value[x];
-        if (dist) {
-          for(t = s; t <= x; t++) {
-            tmp_dist = old_dist[t] + (x - t) * (x - t);
-            if (tmp_dist <= dist) {
-              dist = tmp_dist;
-              value = old_value[t];
-              s = t;
-            }
-          }
-        }
-        else {
-          s = x;
-        }
-        new_dist[x] = dist;
-        new_value[x] = value;
-      }
-			
-      // backwards scan
-      s = XResolution() - 1;
-      for (x = XResolution()-1; x >= 0 ; x--) {
-        dist = new_dist[x];
-        value = new_value[x];
-        if (dist) {
-          for (t = s; t >= x; t--) {
-            tmp_dist = old_dist[t] + (x - t) * (x - t);
-            if (tmp_dist <= dist) {
-              dist = tmp_dist;
-              value = old_value[t];
-              s = t;
-            }
-          }
-          dgrid->SetGridValue(x, y, z, dist);
-          SetGridValue(x, y, z, value);
-        }
-        else {
-          s=x;
-        }
-      }
+// The distance transforms below use the separable algorithm of
+// Felzenszwalb and Huttenlocher ("Distance Transforms of Sampled
+// Functions"), which computes the exact squared Euclidean distance
+// by taking the lower envelope of parabolas along each line of the
+// grid, one axis at a time.  Lines are processed in parallel.  Line l
+// starts at grid index (l % line_group_size) * line_stride +
+// (l / line_group_size) * line_group_stride.
+
+struct R3GridDistanceData {
+  RNScalar *distances;
+  RNScalar *labels;
+  int line_length;
+  int line_group_size;
+  int line_group_stride;
+  int line_stride;
+  int element_stride;
+  std::vector<std::vector<RNScalar> > buffers;
+  std::vector<std::vector<int> > index_buffers;
+};
+
+
+
+static void
+InitializeDistanceData(R3GridDistanceData& data, RNScalar *distances, RNScalar *labels)
+{
+  // Initialize distance transform data
+  data.distances = distances;
+  data.labels = labels;
+  data.line_length = 0;
+  data.line_group_size = 1;
+  data.line_group_stride = 0;
+  data.line_stride = 0;
+  data.element_stride = 0;
+  data.buffers.resize(RNNThreads());
+  data.index_buffers.resize(RNNThreads());
+}
+
+
+
+static void
+DistanceTransformLine(int line, int thread_index, void *ptr)
+{
+  // Get data
+  R3GridDistanceData *data = (R3GridDistanceData *) ptr;
+  int n = data->line_length;
+  int stride = data->element_stride;
+  size_t start = (size_t) (line % data->line_group_size) * data->line_stride +
+    (size_t) (line / data->line_group_size) * data->line_group_stride;
+  RNScalar *distances = data->distances + start;
+  RNScalar *labels = (data->labels) ? data->labels + start : NULL;
+
+  // Get scratch buffers
+  std::vector<RNScalar>& buffer = data->buffers[thread_index];
+  if ((int) buffer.size() < 3*n + 1) buffer.resize(3*n + 1);
+  std::vector<int>& index_buffer = data->index_buffers[thread_index];
+  if ((int) index_buffer.size() < n) index_buffer.resize(n);
+  RNScalar *f = &buffer[0];
+  RNScalar *g = f + n;
+  RNScalar *z = g + n;
+  int *v = &index_buffer[0];
+
+  // Copy values along line
+  for (int q = 0; q < n; q++) f[q] = distances[(size_t) q * stride];
+  if (labels) for (int q = 0; q < n; q++) g[q] = labels[(size_t) q * stride];
+
+  // Compute lower envelope of parabolas rooted at (q, f[q])
+  int k = 0;
+  v[0] = 0;
+  z[0] = -DBL_MAX;
+  z[1] = DBL_MAX;
+  for (int q = 1; q < n; q++) {
+    RNScalar s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2.0 * (q - v[k]));
+    while (s <= z[k]) {
+      k--;
+      s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2.0 * (q - v[k]));
     }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k+1] = DBL_MAX;
   }
-		
-  // along y axis
-  for (z = 0; z < ZResolution(); z++) {
-    for (x = 0; x < XResolution(); x++) {
-      // Copy grid values
-      for (y = 0; y < YResolution(); y++) {
-        old_dist[y] = (int) (dgrid->GridValue(x, y, z));
-        old_value[y] = GridValue(x, y, z);
-      }
-			
-      // forward scan
-      s = 0;
-      for (y = 0; y < YResolution(); y++) {
-        dist = old_dist[y];
-        value = old_value[y];
-        if (dist) {
-          for (t = s; t <= y ; t++) {
-            tmp_dist = old_dist[t] + (y - t) * (y - t);
-            if (tmp_dist <= dist){
-              dist = tmp_dist;
-              value = old_value[t];
-              s = t;
-            }
-          }
-        }
-        else { 
-          s = y;
-        }
-        new_dist[y] = dist;
-        new_value[y] = value;
-      }
 
-      // backward scan
-      s = YResolution() - 1;
-      for(y = YResolution()-1; y >=0 ; y--) {
-        dist = new_dist[y];
-        value = new_value[y];
-        if (dist) {
-          for (t = s; t > y ; t--) {
-            tmp_dist = old_dist[t] + (y - t) * (y - t);
-            if (tmp_dist <= dist){
-              dist = tmp_dist;
-              value = old_value[t];
-              s = t;
-            }
-          }
-          dgrid->SetGridValue(x, y, z, dist);
-          SetGridValue(x, y, z, value);
-        }
-        else { 
-          s = y; 
-        }
-      }
-    }
+  // Evaluate lower envelope (and copy label of closest sample)
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k+1] < q) k++;
+    int dq = q - v[k];
+    distances[(size_t) q * stride] = dq*dq + f[v[k]];
+    if (labels) labels[(size_t) q * stride] = g[v[k]];
   }
-	
-  // Delete temporary buffers
-  if (!squared_distance_grid) delete dgrid;
-  delete[] old_dist;
-  delete[] new_dist;
-  delete[] old_value;
-  delete[] new_value;
 }
 
 
 
-void R3Grid::
-SignedDistanceTransform(void)
+static void
+DistanceTransform(int xres, int yres, int zres, RNScalar *distances, RNScalar *labels)
 {
-  // Compute distance from boundary into interior (negative) and into exterior (positive)
-  R3Grid copy(*this);
-  SquaredDistanceTransform();
-  Sqrt();
-  copy.Threshold(0, 1, 0);
-  copy.Substitute(R2_GRID_UNKNOWN_VALUE, 1);
-  copy.SquaredDistanceTransform();
-  copy.Sqrt();
-  Subtract(copy);
+  // Initialize data
+  R3GridDistanceData data;
+  InitializeDistanceData(data, distances, labels);
+  int sheet_size = xres * yres;
+
+  // Transform along z axis (neighboring lines share cache lines, so hand them out in chunks)
+  data.line_length = zres;
+  data.line_group_size = sheet_size;
+  data.line_group_stride = 0;
+  data.line_stride = 1;
+  data.element_stride = sheet_size;
+  RNParallelFor(sheet_size, DistanceTransformLine, &data, 16);
+
+  // Transform along y axis
+  data.line_length = yres;
+  data.line_group_size = xres;
+  data.line_group_stride = sheet_size;
+  data.line_stride = 1;
+  data.element_stride = xres;
+  RNParallelFor(xres * zres, DistanceTransformLine, &data, 16);
+
+  // Transform along x axis
+  data.line_length = xres;
+  data.line_group_size = 1;
+  data.line_group_stride = xres;
+  data.line_stride = 0;
+  data.element_stride = 1;
+  RNParallelFor(yres * zres, DistanceTransformLine, &data);
 }
 
 
@@ -1635,166 +1790,47 @@ SignedDistanceTransform(void)
 void R3Grid::
 SquaredDistanceTransform(void)
 {
-  int x,y,z,s,t;
-  long long dist,square,new_dist;
-  long long* oldBuffer;
-  long long* newBuffer;
-  int first;
-  int i;
-
-  // Allocate temporary buffers
+  // Initalize values (0 if was set, max_value if not)
   int res = XResolution();
   if (res < YResolution()) res = YResolution();
   if (res < ZResolution()) res = ZResolution();
-  oldBuffer = new long long [res];
-  assert(oldBuffer);
-  newBuffer = new long long[res];
-  assert(newBuffer);
-
-  // Initalize values (0 if was set, max_value if not)
   RNScalar max_value = 3.0 * (res+1) * (res+1);
-  RNScalar *grid_valuesp = grid_values;
-  for (i = 0; i < grid_size; i++) {
-    if (*grid_valuesp == 0.0) *grid_valuesp = max_value;
-    else *grid_valuesp = 0.0;
-    grid_valuesp++;
-  }
-
-  // Scan along z axis
-  for (x = 0; x < XResolution(); x++) {
-    for (y = 0; y < YResolution(); y++) {
-      first = 1;
-      dist = 0;
-      for (z = 0; z < ZResolution(); z++) {
-        if (GridValue(x,y,z) == 0.0) {
-          dist=0;
-          first=0;
-          SetGridValue(x, y, z, 0);
-        }
-        else if (first == 0) {
-          dist++;
-          square = dist*dist;
-          SetGridValue(x, y, z, square);
-        }
-      }
-			
-      // backward scan
-      dist = 0;
-      first = 1;
-      for (z = ZResolution()-1; z >= 0; z--) {
-        if (GridValue(x,y,z) == 0.0){
-          dist = 0;
-          first = 0;
-          SetGridValue(x, y, z, 0);
-        }
-        else if (first == 0) {
-          dist++;
-          square = dist*dist;
-          if (square < GridValue(x, y, z)) {
-            SetGridValue(x, y, z, square);
-          }
-        }
-      }
-    }
+  for (int i = 0; i < grid_size; i++) {
+    if (grid_values[i] == 0.0) grid_values[i] = max_value;
+    else grid_values[i] = 0.0;
   }
 
-  // Scan along x axis
-  for (z = 0; z < ZResolution(); z++) {
-    for (y = 0; y < YResolution(); y++) {
-      // Copy grid values
-      for(x = 0; x < XResolution(); x++) 
-        oldBuffer[x] = (int) (GridValue(x, y, z) + 0.5);
-		
-      // forward scan
-      s = 0;
-      for (x = 0; x < XResolution(); x++) {
-        dist = oldBuffer[x];
-        if (dist) {
-          for(t = s; t <= x; t++) {
-            new_dist = oldBuffer[t] + (x - t) * (x - t);
-            if (new_dist <= dist) {
-              dist = new_dist;
-              s = t;
-            }
-          }
-        }
-        else {
-          s = x;
-        }
-        newBuffer[x] = dist;
-      }
-			
-      // backwards scan
-      s = XResolution() - 1;
-      for (x = XResolution()-1; x >= 0 ; x--) {
-        dist = newBuffer[x];
-        if (dist) {
-          for (t = s; t >= x; t--) {
-            new_dist = oldBuffer[t] + (x - t) * (x - t);
-            if (new_dist <= dist) {
-              dist = new_dist;
-              s = t;
-            }
-          }
-          SetGridValue(x, y, z, dist);
-        }
-        else {
-          s=x;
-        }
-      }
-    }
-  }
-		
-  // along y axis
-  for (z = 0; z < ZResolution(); z++) {
-    for (x = 0; x < XResolution(); x++) {
-      // Copy grid values
-      for (y = 0; y < YResolution(); y++)
-        oldBuffer[y] = (int) (GridValue(x, y, z) + 0.5);
-			
-      // forward scan
-      s = 0;
-      for (y = 0; y < YResolution(); y++) {
-        dist = oldBuffer[y];
-        if (dist) {
-          for (t = s; t <= y ; t++) {
-            new_dist = oldBuffer[t] + (y - t) * (y - t);
-            if (new_dist <= dist){
-              dist = new_dist;
-              s = t;
-            }
-          }
-        }
-        else { 
-          s = y;
-        }
-        newBuffer[y] = dist;
-      }
+  // Compute squared distances
+  DistanceTransform(XResolution(), YResolution(), ZResolution(), grid_values, NULL);
+}
 
-      // backward scan
-      s = YResolution() - 1;
-      for(y = YResolution()-1; y >=0 ; y--) {
-        dist = newBuffer[y];
-        if (dist) {
-          for (t = s; t > y ; t--) {
-            new_dist = oldBuffer[t] + (y - t) * (y - t);
-            if (new_dist <= dist){
-              dist = new_dist;
-              s = t;
-            }
-          }
-          SetGridValue(x, y, z, dist);
-        }
-        else { 
-          s = y; 
-        }
-      }
-    }
+
+
+void R3Grid::
+Voronoi(R3Grid *squared_distance_grid)
+{
+  // Allocate distance grid
+  R3Grid *dgrid;
+  if (squared_distance_grid) dgrid = squared_distance_grid;
+  else dgrid = new R3Grid(XResolution(), YResolution(), ZResolution());
+  assert(dgrid);
+  dgrid->SetWorldToGridTransformation(WorldToGridTransformation());
+
+  // Initalize distance grid values (0 if was set, max_value if not)
+  int res = XResolution();
+  if (res < YResolution()) res = YResolution();
+  if (res < ZResolution()) res = ZResolution();
+  RNScalar max_value = 3.0 * (res+1) * (res+1) * (res+1);
+  for (int i = 0; i < grid_size; i++) {
+    if (grid_values[i] == 0.0) dgrid->grid_values[i] = max_value;
+    else dgrid->grid_values[i] = 0.0;
   }
-	
-  // Delete temporary buffers
-  delete[] oldBuffer;
-  delete[] newBuffer;
+
+  // Compute squared distances and propagate values of closest set grid cells
+  DistanceTransform(XResolution(), YResolution(), ZResolution(), dgrid->grid_values, grid_values);
+
+  // Delete temporary distance grid
+  if (!squared_distance_grid) delete dgrid;
 }
 
 
@@ -3153,18 +3189,21 @@ ReadGrid(FILE *fp)
     }
   }
 
-  // Read grid values
-  RNScalar *grid_valuesp = grid_values;
-  for (int i = 0; i < grid_size; i++) {
-    float value;
-    if (fread(&value, sizeof(float), 1, fp) != 1) {
-      RNFail("Unable to read grid value %d of %d from file", i, grid_size);
+  // Read grid values (in chunks of floats)
+  const int chunk_size = 65536;
+  float *values = new float [ chunk_size ];
+  for (int start = 0; start < grid_size; start += chunk_size) {
+    int count = (start + chunk_size < grid_size) ? chunk_size : grid_size - start;
+    if (fread(values, sizeof(float), count, fp) != (size_t) count) {
+      RNFail("Unable to read grid values %d-%d of %d from file", start, start + count, grid_size);
+      delete [] values;
       return 0;
     }
-    else {
-      *(grid_valuesp++) = (RNScalar) value;
+    for (int i = 0; i < count; i++) {
+      grid_values[start + i] = (RNScalar) values[i];
     }
   }
+  delete [] values;
 
   // Update transformation variables
   world_to_grid_scale_factor = world_to_grid_transform.ScaleFactor();
@@ -3199,15 +3238,21 @@ WriteGrid(FILE *fp) const
     }
   }
 
-  // Write grid values to file
-  const RNScalar *grid_valuesp = grid_values;
-  for (int i = 0; i < grid_size; i++) {
-    float value = (float) *(grid_valuesp++);
-    if (fwrite(&value, sizeof(float), 1, fp) != 1) {
+  // Write grid values to file (in chunks of floats)
+  const int chunk_size = 65536;
+  float *values = new float [ chunk_size ];
+  for (int start = 0; start < grid_size; start += chunk_size) {
+    int count = (start + chunk_size < grid_size) ? chunk_size : grid_size - start;
+    for (int i = 0; i < count; i++) {
+      values[i] = (float) grid_values[start + i];
+    }
+    if (fwrite(values, sizeof(float), count, fp) != (size_t) count) {
       RNFail("Unable to write grid value to file");
+      delete [] values;
       return 0;
     }
   }
+  delete [] values;
 
   // Return number of grid values written
   return grid_size;
@@ -3733,18 +3778,21 @@ ReadDelphiFile(const char *filename)
     return 0;
   }
 
-  // Read grid values
-  RNScalar *grid_valuesp = grid_values;
-  for (int i = 0; i < grid_size; i++) {
-    float value;
-    if (fread(&value, sizeof(float), 1, fp) != 1) {
-      RNFail("Unable to read grid value %d of %d from file", i, grid_size);
+  // Read grid values (in chunks of floats)
+  const int chunk_size = 65536;
+  float *values = new float [ chunk_size ];
+  for (int start = 0; start < grid_size; start += chunk_size) {
+    int count = (start + chunk_size < grid_size) ? chunk_size : grid_size - start;
+    if (fread(values, sizeof(float), count, fp) != (size_t) count) {
+      RNFail("Unable to read grid values %d-%d of %d from file", start, start + count, grid_size);
+      delete [] values;
       return 0;
     }
-    else {
-      *(grid_valuesp++) = (RNScalar) value;
+    for (int i = 0; i < count; i++) {
+      grid_values[start + i] = (RNScalar) values[i];
     }
   }
+  delete [] values;
 
   // Read trailing record size for grid values
   if (fread(&values_record_size, sizeof(int), 1, fp) != 1) {
@@ -4597,6 +4645,80 @@ Print(FILE *fp) const
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Connected component utility functions
+////////////////////////////////////////////////////////////////////////
+
+// Connected components are found with union-find.  Blocks of z slices
+// are labeled in parallel, then sets are merged across block boundaries.
+// Every set is rooted at its smallest grid index, so parents always
+// precede their children, and a final pass in index order numbers the
+// components in the same order as a scan for unmarked seeds would.
+
+struct R3GridComponentData {
+  const RNScalar *values;
+  int *parents;
+  int xres, yres, zres;
+  int slices_per_block;
+  RNScalar isolevel;
+};
+
+
+
+static int
+FindComponentRoot(int *parents, int index)
+{
+  // Find root with path halving
+  while (parents[index] != index) {
+    parents[index] = parents[parents[index]];
+    index = parents[index];
+  }
+  return index;
+}
+
+
+
+static void
+UnionComponents(int *parents, int index1, int index2)
+{
+  // Merge sets, keeping smallest index as root
+  int root1 = FindComponentRoot(parents, index1);
+  int root2 = FindComponentRoot(parents, index2);
+  if (root1 < root2) parents[root2] = root1;
+  else if (root2 < root1) parents[root1] = root2;
+}
+
+
+
+static void
+LabelComponentBlock(int block, int, void *ptr)
+{
+  // Union 6-connected grid cells within block of z slices
+  R3GridComponentData *data = (R3GridComponentData *) ptr;
+  const RNScalar *values = data->values;
+  int *parents = data->parents;
+  int xres = data->xres;
+  int yres = data->yres;
+  int sheet_size = xres * yres;
+  int z0 = block * data->slices_per_block;
+  int z1 = z0 + data->slices_per_block;
+  if (z1 > data->zres) z1 = data->zres;
+  for (int z = z0; z < z1; z++) {
+    for (int y = 0; y < yres; y++) {
+      int index = z * sheet_size + y * xres;
+      for (int x = 0; x < xres; x++, index++) {
+        if (values[index] <= data->isolevel) { parents[index] = -1; continue; }
+        parents[index] = index;
+        if ((x > 0) && (parents[index-1] >= 0)) UnionComponents(parents, index, index-1);
+        if ((y > 0) && (parents[index-xres] >= 0)) UnionComponents(parents, index, index-xres);
+        if ((z > z0) && (parents[index-sheet_size] >= 0)) UnionComponents(parents, index, index-sheet_size);
+      }
+    }
+  }
+}
+
+
+
 int R3Grid::
 ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *sizes, int *grid_components)
 {
@@ -4607,102 +4729,47 @@ ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *size
     assert(components);
   }
 
-  // Initialize array of components
-  for (int i = 0; i < grid_size; i++) 
-    components[i] = -1;
-
-  // Find connected components
-  int ncomponents = 0;
-  int next_seed = 0;
-  while (TRUE){
-    // Find unmarked seed
-    int seed = next_seed;
-    while (seed < grid_size) { 
-      if ((components[seed] < 0) && (grid_values[seed] > isolevel)) break;
-      seed++;
+  // Union 6-connected grid cells within blocks of z slices (components array holds parents)
+  R3GridComponentData data;
+  data.values = grid_values;
+  data.parents = components;
+  data.xres = XResolution();
+  data.yres = YResolution();
+  data.zres = ZResolution();
+  data.isolevel = isolevel;
+  data.slices_per_block = ZResolution() / (4 * RNNThreads()) + 1;
+  int nblocks = (ZResolution() + data.slices_per_block - 1) / data.slices_per_block;
+  RNParallelFor(nblocks, LabelComponentBlock, &data);
+
+  // Union 6-connected grid cells across block boundaries
+  int sheet_size = XResolution() * YResolution();
+  for (int z = data.slices_per_block; z < ZResolution(); z += data.slices_per_block) {
+    for (int index = z * sheet_size; index < (z+1) * sheet_size; index++) {
+      if (components[index] < 0) continue;
+      if (components[index-sheet_size] < 0) continue;
+      UnionComponents(components, index, index-sheet_size);
     }
+  }
 
-    // Check if found a seed
-    if (seed >= grid_size) break;
-
-    // Flood fill marking all grid entries 6-connected to seed
-    int x, y, z, neighbor;
-    int size = 0;
-    RNArray<RNScalar *> stack;
-    stack.Insert(&grid_values[seed]);
-    components[seed] = ncomponents;
-    while (!stack.IsEmpty()) {
-      // Pop top of stack
-      RNScalar *c = stack.Tail();
-      stack.RemoveTail();
-
-      // Add grid entry to component
-      int index = c - grid_values;
-      assert(index >= 0);
-      assert(index < grid_size);
-      assert(components[index] == ncomponents);
-      assert(grid_values[index] > isolevel);
-
-      // Add neighbors to stack
-      IndexToIndices(index, x, y, z);
-      if (x > 0) {
-        IndicesToIndex(x-1, y, z, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (x < XResolution()-1) {
-        IndicesToIndex(x+1, y, z, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (y > 0) {
-        IndicesToIndex(x, y-1, z, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (y < YResolution()-1) {
-        IndicesToIndex(x, y+1, z, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] > isolevel)) { 
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (z > 0) {
-        IndicesToIndex(x, y, z-1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
-      }
-      if (z < ZResolution()-1) {
-        IndicesToIndex(x, y, z+1, neighbor);
-        if ((components[neighbor] < 0) && (grid_values[neighbor] > isolevel)) {
-          components[neighbor] = ncomponents;
-          stack.Insert(&grid_values[neighbor]);
-        }
+  // Number components in order of their first grid cell
+  int ncomponents = 0;
+  for (int i = 0; i < grid_size; i++) {
+    int parent = components[i];
+    if (parent < 0) continue;
+    if (parent == i) {
+      if (ncomponents < max_components) {
+        if (seeds) seeds[ncomponents] = i;
+        if (sizes) sizes[ncomponents] = 0;
       }
-
-      // Increment component_size
-      size++;
+      components[i] = ncomponents++;
     }
-
-    // Update output variables
-    if (ncomponents < max_components) {
-      if (seeds) seeds[ncomponents] = seed;
-      if (sizes) sizes[ncomponents] = size;
+    else {
+      // Parents precede children, so parent already has its component identifier
+      components[i] = components[parent];
     }
-
-    // Increment the number of components
-    ncomponents++;
+    if (sizes && (components[i] < max_components)) sizes[components[i]]++;
   }
 
-
   // Delete components
   if (!grid_components) delete [] components;
 
@@ -4712,83 +4779,12 @@ ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *size
 
 
 
-static R3MeshVertex *
-InterpolatedVertex(const R3Grid *grid, int ix0, int iy0, int iz0, int dim,
-  R3Mesh *mesh, R3MeshVertex **vertices, RNScalar isolevel)
-{
-  // Check indices
-  assert(dim < 3);
-  int grid_index;
-  int ix1 = (dim == 0) ? ix0+1 : ix0;
-  int iy1 = (dim == 1) ? iy0+1 : iy0;
-  int iz1 = (dim == 2) ? iz0+1 : iz0;
-  assert(ix0 < grid->XResolution());
-  assert(iy0 < grid->YResolution());
-  assert(iz0 < grid->ZResolution());
-  assert(ix1 < grid->XResolution());
-  assert(iy1 < grid->YResolution());
-  assert(iz1 < grid->ZResolution());
-  grid->IndicesToIndex(ix0, iy0, iz0, grid_index);
-  if (!vertices[3*grid_index+dim]) {
-    RNScalar value0 = grid->GridValue(ix0, iy0, iz0);
-    RNScalar value1 = grid->GridValue(ix1, iy1, iz1);
-    RNScalar delta0 = fabs(value0 - isolevel);
-    RNScalar delta1 = fabs(value1 - isolevel);
-    RNScalar denom = delta0 + delta1;
-    RNScalar t = (RNIsNotZero(denom)) ? delta0 / denom : 0.5;
-    R3Point p0 = grid->WorldPosition(ix0, iy0, iz0);
-    R3Point p1 = grid->WorldPosition(ix1, iy1, iz1);
-    R3Point p = (1.0-t)*p0 + t*p1;
-    vertices[3*grid_index+dim] = mesh->CreateVertex(p);
-  }
-
-  // Return vertex
-  return vertices[3*grid_index+dim];
-}
-
-
-
-int R3Grid::
-GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const
-{
-  // Initialize marching cubes edge table
-  static int edgeTable[256]={
-    0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
-    0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
-    0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
-    0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
-    0x230, 0x339, 0x33 , 0x13a, 0x636, 0x73f, 0x435, 0x53c,
-    0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
-    0x3a0, 0x2a9, 0x1a3, 0xaa , 0x7a6, 0x6af, 0x5a5, 0x4ac,
-    0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
-    0x460, 0x569, 0x663, 0x76a, 0x66 , 0x16f, 0x265, 0x36c,
-    0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
-    0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0xff , 0x3f5, 0x2fc,
-    0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
-    0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x55 , 0x15c,
-    0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
-    0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0xcc ,
-    0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
-    0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
-    0xcc , 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
-    0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
-    0x15c, 0x55 , 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
-    0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
-    0x2fc, 0x3f5, 0xff , 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
-    0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
-    0x36c, 0x265, 0x16f, 0x66 , 0x76a, 0x663, 0x569, 0x460,
-    0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
-    0x4ac, 0x5a5, 0x6af, 0x7a6, 0xaa , 0x1a3, 0x2a9, 0x3a0,
-    0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
-    0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x33 , 0x339, 0x230,
-    0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
-    0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99 , 0x190,
-    0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
-    0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0   
-  };
+////////////////////////////////////////////////////////////////////////
+// Isosurface extraction code
+////////////////////////////////////////////////////////////////////////
 
-  // Initialize marching cubes triangle table
-  static int triTable[256][16] =
+// Marching cubes triangle table (edges are numbered as in GenerateIsoSurface below)
+const int R3grid_isosurface_triangle_table[256][16] =
     {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
      {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
      {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
@@ -5046,93 +5042,510 @@ GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const
      {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
      {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
 
-  // Allocate vertex pointers
-  R3MeshVertex **vertices = new R3MeshVertex * [3*NEntries()];
-  for (int i = 0; i < 3*NEntries(); i++) vertices[i] = NULL;
-  
-  // Create faces
-  RNScalar corner_levels[8];
-  for (int iz0 = 0; iz0 < ZResolution()-1; iz0++) {
-    for (int iy0 = 0; iy0 < YResolution()-1; iy0++) {
-      for (int ix0 = 0; ix0 < XResolution()-1; ix0++) {
-
-        // Compute cube corner values
-        corner_levels[0] = GridValue(ix0,iy0,iz0);
-        corner_levels[1] = GridValue(ix0+1,iy0,iz0);
-        corner_levels[2] = GridValue(ix0+1,iy0,iz0+1);
-        corner_levels[3] = GridValue(ix0,iy0,iz0+1);
-        corner_levels[4] = GridValue(ix0,iy0+1,iz0);
-        corner_levels[5] = GridValue(ix0+1,iy0+1,iz0);
-        corner_levels[6] = GridValue(ix0+1,iy0+1,iz0+1);
-        corner_levels[7] = GridValue(ix0,iy0+1,iz0+1);
+
+
+// Polygons are stored with slab vertex indices, or with -2-key for
+// vertices owned by a neighboring slab (found in its boundary_vertices)
+
+struct R3GridIsoSurfaceSlab {
+  int first_plane, end_plane;
+  int first_vertex, first_index;
+  std::vector<float> positions;
+  std::vector<int> polygons;
+  std::unordered_map<int, int> boundary_vertices;
+};
+
+struct R3GridIsoSurfaceData {
+  const R3Grid *grid;
+  RNScalar isolevel;
+  int polygon_size;
+  std::vector<R3GridIsoSurfaceSlab> slabs;
+  R3PlyMesh *mesh;
+};
+
+
+
+static int
+CreateEdgeVertex(R3GridIsoSurfaceSlab *slab, RNScalar value0, RNScalar value1,
+  RNScalar isolevel, int i, int j, int k, int dim)
+{
+  // Compute interpolation parameter along edge
+  RNScalar delta0 = fabs(value0 - isolevel);
+  RNScalar delta1 = fabs(value1 - isolevel);
+  RNScalar t = delta0 / (delta0 + delta1);
+
+  // Create vertex (in grid coordinates)
+  int vertex_index = (int) (slab->positions.size() / 3);
+  slab->positions.push_back((dim == 0) ? i + t : i);
+  slab->positions.push_back((dim == 1) ? j + t : j);
+  slab->positions.push_back((dim == 2) ? k + t : k);
+
+  // Return index of vertex within slab
+  return vertex_index;
+}
+
+
+
+static void
+CreatePlaneVertices(R3GridIsoSurfaceSlab *slab, const R3Grid *grid, RNScalar isolevel,
+  int k, int *vertex_ids, unsigned char *inside, RNBoolean owned, RNBoolean boundary)
+{
+  // Get grid values in plane
+  int nx = grid->XResolution();
+  int ny = grid->YResolution();
+  const RNScalar *values = grid->GridValues() + k * nx * ny;
+
+  // Classify grid points
+  for (int index = 0; index < nx*ny; index++) {
+    inside[index] = (values[index] < isolevel) ? 1 : 0;
+  }
+
+  // Create vertices on x and y edges leaving each grid point
+  for (int j = 0; j < ny; j++) {
+    for (int i = 0; i < nx; i++) {
+      int index = j*nx + i;
+      for (int dim = 0; dim < 2; dim++) {
+        int key = 2*index + dim;
+        vertex_ids[key] = -1;
+
+        // Check if isosurface crosses edge
+        if ((dim == 0) && (i == nx-1)) continue;
+        if ((dim == 1) && (j == ny-1)) continue;
+        int index1 = (dim == 0) ? index+1 : index+nx;
+        if (inside[index] == inside[index1]) continue;
+
+        // Refer to vertex created by next slab
+        if (!owned) { vertex_ids[key] = -2 - key; continue; }
+
+        // Create vertex
+        vertex_ids[key] = CreateEdgeVertex(slab, values[index], values[index1], isolevel, i, j, k, dim);
+        if (boundary) slab->boundary_vertices[key] = vertex_ids[key];
+      }
+    }
+  }
+}
+
+
+
+static void
+ExtractMarchingCubesSlab(int slab_index, int, void *data)
+{
+  // Get convenient variables
+  R3GridIsoSurfaceData *iso = (R3GridIsoSurfaceData *) data;
+  R3GridIsoSurfaceSlab *slab = &iso->slabs[slab_index];
+  const R3Grid *grid = iso->grid;
+  RNScalar isolevel = iso->isolevel;
+  int nx = grid->XResolution();
+  int ny = grid->YResolution();
+  int nz = grid->ZResolution();
+  int sheet = nx * ny;
+
+  // Allocate vertex indices and inside flags for planes below and above current layer of cells
+  std::vector<int> bottom_ids(2*sheet), top_ids(2*sheet), vertical_ids(sheet);
+  std::vector<unsigned char> bottom_inside(sheet), top_inside(sheet);
+
+  // Create vertices in first plane (they are shared with previous slab)
+  CreatePlaneVertices(slab, grid, isolevel, slab->first_plane, &bottom_ids[0], &bottom_inside[0], TRUE, slab_index > 0);
+
+  // Visit layers of cells
+  int end_layer = (slab->end_plane < nz) ? slab->end_plane : nz-1;
+  for (int k = slab->first_plane; k < end_layer; k++) {
+    const RNScalar *values0 = grid->GridValues() + k * sheet;
+    const RNScalar *values1 = values0 + sheet;
+
+    // Create vertices in plane above (first plane of next slab is owned by next slab)
+    CreatePlaneVertices(slab, grid, isolevel, k+1, &top_ids[0], &top_inside[0], k+1 < slab->end_plane, FALSE);
+    const unsigned char *inside0 = &bottom_inside[0];
+    const unsigned char *inside1 = &top_inside[0];
+
+    // Create vertices on vertical edges between planes
+    for (int index = 0; index < sheet; index++) {
+      vertical_ids[index] = -1;
+      if (inside0[index] == inside1[index]) continue;
+      vertical_ids[index] = CreateEdgeVertex(slab, values0[index], values1[index], isolevel, index % nx, index / nx, k, 2);
+    }
+
+    // Create triangles in cells
+    for (int j = 0; j < ny-1; j++) {
+      for (int i = 0; i < nx-1; i++) {
+        int index = j*nx + i;
 
         // Compute cube index
-        int cubeindex = 0;
-        if (corner_levels[0] < isolevel) cubeindex |= 1;
-        if (corner_levels[1] < isolevel) cubeindex |= 2;
-        if (corner_levels[2] < isolevel) cubeindex |= 4;
-        if (corner_levels[3] < isolevel) cubeindex |= 8;
-        if (corner_levels[4] < isolevel) cubeindex |= 16;
-        if (corner_levels[5] < isolevel) cubeindex |= 32;
-        if (corner_levels[6] < isolevel) cubeindex |= 64;
-        if (corner_levels[7] < isolevel) cubeindex |= 128;
-
-        // Check if cube is entirely above/below the surface
-        if (edgeTable[cubeindex] == 0) continue;
-
-        // Find the vertices where the surface intersects the cube 
-        R3MeshVertex *vertlist[12];
-        if (edgeTable[cubeindex] & 1) {
-          vertlist[0] = InterpolatedVertex(this, ix0, iy0, iz0, 0, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 2) {
-          vertlist[1] = InterpolatedVertex(this, ix0+1, iy0, iz0, 2, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 4) {
-          vertlist[2] = InterpolatedVertex(this, ix0, iy0, iz0+1, 0, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 8) {
-          vertlist[3] = InterpolatedVertex(this, ix0, iy0, iz0, 2, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 16) {
-          vertlist[4] = InterpolatedVertex(this, ix0, iy0+1, iz0, 0, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 32) {
-          vertlist[5] = InterpolatedVertex(this, ix0+1, iy0+1, iz0, 2, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 64) {
-          vertlist[6] = InterpolatedVertex(this, ix0, iy0+1, iz0+1, 0, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 128) {
-          vertlist[7] = InterpolatedVertex(this, ix0, iy0+1, iz0, 2, mesh, vertices, isolevel);
-        }
-        if (edgeTable[cubeindex] & 256) {
-          vertlist[8] = InterpolatedVertex(this, ix0, iy0, iz0, 1, mesh, vertices, isolevel);
+        int cubeindex = inside0[index] | (inside0[index+1] << 1) |
+          (inside1[index+1] << 2) | (inside1[index] << 3) |
+          (inside0[index+nx] << 4) | (inside0[index+nx+1] << 5) |
+          (inside1[index+nx+1] << 6) | (inside1[index+nx] << 7);
+        if ((cubeindex == 0) || (cubeindex == 255)) continue;
+
+        // Gather vertices on cube edges
+        int edge_ids[12];
+        edge_ids[0] = bottom_ids[2*index];
+        edge_ids[1] = vertical_ids[index+1];
+        edge_ids[2] = top_ids[2*index];
+        edge_ids[3] = vertical_ids[index];
+        edge_ids[4] = bottom_ids[2*(index+nx)];
+        edge_ids[5] = vertical_ids[index+nx+1];
+        edge_ids[6] = top_ids[2*(index+nx)];
+        edge_ids[7] = vertical_ids[index+nx];
+        edge_ids[8] = bottom_ids[2*index+1];
+        edge_ids[9] = bottom_ids[2*(index+1)+1];
+        edge_ids[10] = top_ids[2*(index+1)+1];
+        edge_ids[11] = top_ids[2*index+1];
+
+        // Create triangles
+        const int *triangle_edges = R3grid_isosurface_triangle_table[cubeindex];
+        for (int t = 0; triangle_edges[t] != -1; t++) {
+          slab->polygons.push_back(edge_ids[triangle_edges[t]]);
         }
-        if (edgeTable[cubeindex] & 512) {
-          vertlist[9] = InterpolatedVertex(this, ix0+1, iy0, iz0, 1, mesh, vertices, isolevel);
+      }
+    }
+
+    // Plane above becomes plane below next layer
+    bottom_ids.swap(top_ids);
+    bottom_inside.swap(top_inside);
+  }
+}
+
+
+
+static void
+ComputeGridGradient(const R3Grid *grid, int i, int j, int k, RNScalar gradient[3])
+{
+  // Compute gradient with central differences (one-sided at borders)
+  const RNScalar *values = grid->GridValues();
+  int resolution[3] = { grid->XResolution(), grid->YResolution(), grid->ZResolution() };
+  int coords[3] = { i, j, k };
+  int strides[3] = { 1, resolution[0], resolution[0] * resolution[1] };
+  int index = k*strides[2] + j*strides[1] + i;
+  for (int dim = 0; dim < 3; dim++) {
+    int s = strides[dim];
+    if (resolution[dim] < 2) gradient[dim] = 0;
+    else if (coords[dim] == 0) gradient[dim] = values[index+s] - values[index];
+    else if (coords[dim] == resolution[dim]-1) gradient[dim] = values[index] - values[index-s];
+    else gradient[dim] = 0.5 * (values[index+s] - values[index-s]);
+  }
+}
+
+
+
+static int
+CreateCellVertex(R3GridIsoSurfaceSlab *slab, const R3Grid *grid, RNScalar isolevel, int i, int j, int k)
+{
+  // Corner c of cell is at offset (c&1, (c>>1)&1, (c>>2)&1)
+  static const int cell_edges[12][2] = {
+    {0,1}, {2,3}, {4,5}, {6,7}, {0,2}, {1,3},
+    {4,6}, {5,7}, {0,4}, {1,5}, {2,6}, {3,7} };
+
+  // Get corner values
+  int nx = grid->XResolution();
+  int sheet = nx * grid->YResolution();
+  const RNScalar *values = grid->GridValues() + k*sheet + j*nx + i;
+  RNScalar corner_values[8];
+  int inside = 0;
+  for (int c = 0; c < 8; c++) {
+    corner_values[c] = values[(c & 1) + ((c >> 1) & 1)*nx + ((c >> 2) & 1)*sheet];
+    if (corner_values[c] < isolevel) inside |= (1 << c);
+  }
+
+  // Check if isosurface crosses cell
+  if ((inside == 0) || (inside == 255)) return -1;
+
+  // Compute gradients at corners
+  RNScalar corner_gradients[8][3];
+  for (int c = 0; c < 8; c++) {
+    ComputeGridGradient(grid, i + (c & 1), j + ((c >> 1) & 1), k + ((c >> 2) & 1), corner_gradients[c]);
+  }
+
+  // Compute points and normals where isosurface crosses edges (in cell coordinates)
+  RNScalar points[12][3], normals[12][3];
+  RNScalar mass_point[3] = { 0, 0, 0 };
+  int npoints = 0;
+  for (int e = 0; e < 12; e++) {
+    int c0 = cell_edges[e][0];
+    int c1 = cell_edges[e][1];
+    if (((inside >> c0) & 1) == ((inside >> c1) & 1)) continue;
+    RNScalar delta0 = fabs(corner_values[c0] - isolevel);
+    RNScalar delta1 = fabs(corner_values[c1] - isolevel);
+    RNScalar t = delta0 / (delta0 + delta1);
+    RNScalar length = 0;
+    for (int dim = 0; dim < 3; dim++) {
+      RNScalar p0 = (c0 >> dim) & 1;
+      RNScalar p1 = (c1 >> dim) & 1;
+      points[npoints][dim] = (1-t)*p0 + t*p1;
+      normals[npoints][dim] = (1-t)*corner_gradients[c0][dim] + t*corner_gradients[c1][dim];
+      length += normals[npoints][dim] * normals[npoints][dim];
+      mass_point[dim] += points[npoints][dim];
+    }
+    length = sqrt(length);
+    for (int dim = 0; dim < 3; dim++) {
+      normals[npoints][dim] = (length > 0) ? normals[npoints][dim] / length : 0;
+    }
+    npoints++;
+  }
+  for (int dim = 0; dim < 3; dim++) mass_point[dim] /= npoints;
+
+  // Build quadric error function relative to mass point (regularized towards it)
+  RNScalar a[3][3] = { { 0.05, 0, 0 }, { 0, 0.05, 0 }, { 0, 0, 0.05 } };
+  RNScalar b[3] = { 0, 0, 0 };
+  for (int p = 0; p < npoints; p++) {
+    const RNScalar *n = normals[p];
+    RNScalar d = n[0]*(points[p][0] - mass_point[0]) + n[1]*(points[p][1] - mass_point[1]) + n[2]*(points[p][2] - mass_point[2]);
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) a[r][c] += n[r] * n[c];
+      b[r] += n[r] * d;
+    }
+  }
+
+  // Minimize quadric error function with Cramer's rule
+  RNScalar position[3] = { mass_point[0], mass_point[1], mass_point[2] };
+  RNScalar c00 = a[1][1]*a[2][2] - a[1][2]*a[2][1];
+  RNScalar c01 = a[1][2]*a[2][0] - a[1][0]*a[2][2];
+  RNScalar c02 = a[1][0]*a[2][1] - a[1][1]*a[2][0];
+  RNScalar det = a[0][0]*c00 + a[0][1]*c01 + a[0][2]*c02;
+  if (fabs(det) > 1.0E-12) {
+    position[0] += (b[0]*c00 + a[0][1]*(a[1][2]*b[2] - b[1]*a[2][2]) + a[0][2]*(b[1]*a[2][1] - a[1][1]*b[2])) / det;
+    position[1] += (a[0][0]*(b[1]*a[2][2] - a[1][2]*b[2]) + b[0]*c01 + a[0][2]*(a[1][0]*b[2] - b[1]*a[2][0])) / det;
+    position[2] += (a[0][0]*(a[1][1]*b[2] - b[1]*a[2][1]) + a[0][1]*(b[1]*a[2][0] - a[1][0]*b[2]) + b[0]*c02) / det;
+  }
+
+  // Create vertex (clamped to cell, in grid coordinates)
+  int vertex_index = (int) (slab->positions.size() / 3);
+  int cell_coords[3] = { i, j, k };
+  for (int dim = 0; dim < 3; dim++) {
+    RNScalar x = position[dim];
+    if (x < 0) x = 0;
+    else if (x > 1) x = 1;
+    slab->positions.push_back(cell_coords[dim] + x);
+  }
+
+  // Return index of vertex within slab
+  return vertex_index;
+}
+
+
+
+static void
+CreateQuad(R3GridIsoSurfaceSlab *slab, RNBoolean increasing, int id0, int id1, int id2, int id3)
+{
+  // Create quad facing towards larger values (as marching cubes triangles do)
+  if (increasing) {
+    slab->polygons.push_back(id0);
+    slab->polygons.push_back(id1);
+    slab->polygons.push_back(id2);
+    slab->polygons.push_back(id3);
+  }
+  else {
+    slab->polygons.push_back(id3);
+    slab->polygons.push_back(id2);
+    slab->polygons.push_back(id1);
+    slab->polygons.push_back(id0);
+  }
+}
+
+
+
+static void
+ExtractDualContouringSlab(int slab_index, int, void *data)
+{
+  // Get convenient variables
+  R3GridIsoSurfaceData *iso = (R3GridIsoSurfaceData *) data;
+  R3GridIsoSurfaceSlab *slab = &iso->slabs[slab_index];
+  const R3Grid *grid = iso->grid;
+  RNScalar isolevel = iso->isolevel;
+  int nx = grid->XResolution();
+  int ny = grid->YResolution();
+  int nz = grid->ZResolution();
+  int sheet = nx * ny;
+  RNBoolean last_slab = (slab_index == (int) iso->slabs.size() - 1);
+
+  // Allocate vertex indices for cells in previous and current layers
+  // (cells in layer below first plane are owned by previous slab)
+  std::vector<int> previous_ids(sheet), current_ids(sheet, -1);
+  for (int index = 0; index < sheet; index++) previous_ids[index] = -2 - index;
+
+  // Visit planes of grid points
+  for (int k = slab->first_plane; k < slab->end_plane; k++) {
+    const RNScalar *values = grid->GridValues() + k * sheet;
+
+    // Create vertices in cells of layer above plane
+    if (k < nz-1) {
+      RNBoolean boundary = (!last_slab) && (k == slab->end_plane-1);
+      for (int j = 0; j < ny-1; j++) {
+        for (int i = 0; i < nx-1; i++) {
+          int index = j*nx + i;
+          current_ids[index] = CreateCellVertex(slab, grid, isolevel, i, j, k);
+          if (boundary && (current_ids[index] >= 0)) slab->boundary_vertices[index] = current_ids[index];
         }
-        if (edgeTable[cubeindex] & 1024) {
-          vertlist[10] = InterpolatedVertex(this, ix0+1, iy0, iz0+1, 1, mesh, vertices, isolevel);
+      }
+    }
+
+    // Create quads crossing edges leaving grid points in plane
+    for (int j = 0; j < ny; j++) {
+      for (int i = 0; i < nx; i++) {
+        int index = j*nx + i;
+        RNBoolean inside = (values[index] < isolevel);
+
+        // Quad crossing x edge
+        if ((i < nx-1) && (j > 0) && (j < ny-1) && (k > 0) && (k < nz-1)) {
+          if ((values[index+1] < isolevel) != inside) {
+            CreateQuad(slab, inside, previous_ids[index-nx], previous_ids[index], current_ids[index], current_ids[index-nx]);
+          }
         }
-        if (edgeTable[cubeindex] & 2048) {
-          vertlist[11] = InterpolatedVertex(this, ix0, iy0, iz0+1, 1, mesh, vertices, isolevel);
+
+        // Quad crossing y edge
+        if ((j < ny-1) && (i > 0) && (i < nx-1) && (k > 0) && (k < nz-1)) {
+          if ((values[index+nx] < isolevel) != inside) {
+            CreateQuad(slab, inside, previous_ids[index-1], current_ids[index-1], current_ids[index], previous_ids[index]);
+          }
         }
 
-        // Create the triangles
-        for (int i = 0; triTable[cubeindex][i] != -1; i+=3) {
-          R3MeshVertex *v0 = vertlist[triTable[cubeindex][i  ]];
-          R3MeshVertex *v1 = vertlist[triTable[cubeindex][i+1]];
-          R3MeshVertex *v2 = vertlist[triTable[cubeindex][i+2]];
-          if (!v0 || !v1 || !v2) continue;
-          mesh->CreateFace(v0, v1, v2);
+        // Quad crossing z edge
+        if ((k < nz-1) && (i > 0) && (i < nx-1) && (j > 0) && (j < ny-1)) {
+          if ((values[index+sheet] < isolevel) != inside) {
+            CreateQuad(slab, inside, current_ids[index-nx-1], current_ids[index-nx], current_ids[index], current_ids[index-1]);
+          }
         }
       }
     }
+
+    // Current layer becomes previous layer
+    previous_ids.swap(current_ids);
+  }
+}
+
+
+
+static const float *
+IsoSurfaceVertexPosition(const R3GridIsoSurfaceData *iso, int slab_index, int id, int *mesh_vertex_index)
+{
+  // Find slab that owns vertex
+  const R3GridIsoSurfaceSlab *slab = &iso->slabs[slab_index];
+  if (id < -1) {
+    slab = &iso->slabs[(iso->polygon_size == 3) ? slab_index+1 : slab_index-1];
+    std::unordered_map<int, int>::const_iterator it = slab->boundary_vertices.find(-2 - id);
+    assert(it != slab->boundary_vertices.end());
+    id = it->second;
+  }
+
+  // Return position (in grid coordinates) and index of vertex in mesh
+  assert((id >= 0) && (3*id < (int) slab->positions.size()));
+  *mesh_vertex_index = slab->first_vertex + id;
+  return &slab->positions[3*id];
+}
+
+
+
+static void
+FinishIsoSurfaceSlab(int slab_index, int, void *data)
+{
+  // Get convenient variables
+  R3GridIsoSurfaceData *iso = (R3GridIsoSurfaceData *) data;
+  const R3GridIsoSurfaceSlab *slab = &iso->slabs[slab_index];
+  const R3Grid *grid = iso->grid;
+
+  // Copy vertex positions (in world coordinates)
+  float *positions = &iso->mesh->positions[3*slab->first_vertex];
+  for (unsigned int i = 0; i < slab->positions.size(); i += 3) {
+    R3Point position = grid->WorldPosition(slab->positions[i], slab->positions[i+1], slab->positions[i+2]);
+    *(positions++) = position.X();
+    *(positions++) = position.Y();
+    *(positions++) = position.Z();
+  }
+
+  // Copy triangles (quads are split along their shorter diagonal)
+  int *indices = &iso->mesh->indices[slab->first_index];
+  for (unsigned int i = 0; i < slab->polygons.size(); i += iso->polygon_size) {
+    int ids[4];
+    const float *p[4];
+    for (int j = 0; j < iso->polygon_size; j++) {
+      p[j] = IsoSurfaceVertexPosition(iso, slab_index, slab->polygons[i+j], &ids[j]);
+    }
+    if (iso->polygon_size == 3) {
+      *(indices++) = ids[0]; *(indices++) = ids[1]; *(indices++) = ids[2];
+    }
+    else {
+      RNScalar d02 = 0, d13 = 0;
+      for (int dim = 0; dim < 3; dim++) {
+        d02 += (p[2][dim] - p[0][dim]) * (p[2][dim] - p[0][dim]);
+        d13 += (p[3][dim] - p[1][dim]) * (p[3][dim] - p[1][dim]);
+      }
+      if (d02 <= d13) {
+        *(indices++) = ids[0]; *(indices++) = ids[1]; *(indices++) = ids[2];
+        *(indices++) = ids[0]; *(indices++) = ids[2]; *(indices++) = ids[3];
+      }
+      else {
+        *(indices++) = ids[0]; *(indices++) = ids[1]; *(indices++) = ids[3];
+        *(indices++) = ids[1]; *(indices++) = ids[2]; *(indices++) = ids[3];
+      }
+    }
+  }
+}
+
+
+
+static int
+ExtractIsoSurface(const R3Grid *grid, RNScalar isolevel, RNBoolean dual_contouring, R3PlyMesh *mesh)
+{
+  // Check grid
+  mesh->Empty();
+  int nz = grid->ZResolution();
+  if ((grid->XResolution() < 2) || (grid->YResolution() < 2) || (nz < 2)) return 1;
+
+  // Partition planes of grid points into slabs
+  R3GridIsoSurfaceData iso;
+  iso.grid = grid;
+  iso.isolevel = isolevel;
+  iso.polygon_size = (dual_contouring) ? 4 : 3;
+  iso.mesh = mesh;
+  int nslabs = 4 * RNNThreads();
+  if (nslabs > nz-1) nslabs = nz-1;
+  iso.slabs.resize(nslabs);
+  for (int i = 0; i < nslabs; i++) {
+    iso.slabs[i].first_plane = (int) ((RNInt64) i * nz / nslabs);
+    iso.slabs[i].end_plane = (int) ((RNInt64) (i+1) * nz / nslabs);
+  }
+
+  // Extract vertices and polygons of slabs in parallel
+  if (dual_contouring) RNParallelFor(nslabs, ExtractDualContouringSlab, &iso);
+  else RNParallelFor(nslabs, ExtractMarchingCubesSlab, &iso);
+
+  // Compute offsets of slabs in mesh
+  int nvertices = 0, nindices = 0;
+  for (int i = 0; i < nslabs; i++) {
+    R3GridIsoSurfaceSlab& slab = iso.slabs[i];
+    slab.first_vertex = nvertices;
+    slab.first_index = nindices;
+    nvertices += (int) (slab.positions.size() / 3);
+    nindices += (int) (slab.polygons.size() / iso.polygon_size) * 3 * (iso.polygon_size - 2);
+  }
+
+  // Copy vertices and triangles into mesh in parallel
+  mesh->positions.resize(3 * nvertices);
+  mesh->indices.resize(nindices);
+  RNParallelFor(nslabs, FinishIsoSurfaceSlab, &iso);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3Grid::
+GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh, RNBoolean dual_contouring) const
+{
+  // Extract isosurface
+  R3PlyMesh isosurface;
+  if (!ExtractIsoSurface(this, isolevel, dual_contouring, &isosurface)) return 0;
+  if (isosurface.NFaces() == 0) return 1;
+
+  // Create vertices
+  int first_vertex_id = mesh->CreateVertices(isosurface.NVertices(), &isosurface.positions[0]);
+  if (first_vertex_id > 0) {
+    for (unsigned int i = 0; i < isosurface.indices.size(); i++) isosurface.indices[i] += first_vertex_id;
   }
 
-  // Delete vertex pointers
-  delete [] vertices;
+  // Create faces
+  mesh->CreateFaces(isosurface.NFaces(), &isosurface.indices[0]);
 
   // Return success
   return 1;
@@ -5140,6 +5553,19 @@ GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const
 
 
 
+int R3Grid::
+GenerateIsoSurface(RNScalar isolevel, R3IndexedMesh *mesh, RNBoolean dual_contouring) const
+{
+  // Extract isosurface
+  R3PlyMesh isosurface;
+  if (!ExtractIsoSurface(this, isolevel, dual_contouring, &isosurface)) return 0;
+
+  // Load mesh
+  return mesh->LoadPlyMesh(isosurface);
+}
+
+
+
 int R3Grid::
 GenerateIsoSurface(RNScalar isolevel, R3Point *points, int max_points) const
 {
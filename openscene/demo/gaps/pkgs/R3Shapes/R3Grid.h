@@ -188,7 +188,8 @@ public:
 
   // Utility functions
   int ConnectedComponents(RNScalar isolevel = 0, int max_components = 0, int *seeds = NULL, int *sizes = NULL, int *grid_components = NULL);
-  int GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const;
+  int GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh, RNBoolean dual_contouring = FALSE) const;
+  int GenerateIsoSurface(RNScalar isolevel, R3IndexedMesh *mesh, RNBoolean dual_contouring = FALSE) const;
 
   // Debugging functions
   const RNScalar *GridValues(void) const;
@@ -206,6 +207,7 @@ public:
   int GenerateIsoSurface(RNScalar isolevel, R3Point *points, int max_points) const;
 
 private:
+  friend class R3CompactGrid;
   R3Affine grid_to_world_transform;
   R3Affine world_to_grid_transform;
   RNScalar world_to_grid_scale_factor;
@@ -222,6 +224,7 @@ private:
 // Useful constants
 
 extern const float R3_GRID_KEEP_VALUE;
+extern const int R3grid_isosurface_triangle_table[256][16];
 
 const int R3_GRID_ADD_OPERATION = 0;
 const int R3_GRID_SUBTRACT_OPERATION = 1;
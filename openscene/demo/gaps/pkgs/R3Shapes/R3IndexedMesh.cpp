@@ -0,0 +1,827 @@
+// Source file for the R3 indexed triangle mesh class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes.h"
+#include "ply.h"
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor functions
+////////////////////////////////////////////////////////////////////////
+
+R3IndexedMesh::
+R3IndexedMesh(void)
+  : positions(),
+    normals(),
+    colors(),
+    indices(),
+    materials(),
+    segments(),
+    categories(),
+    bbox(R3null_box)
+{
+}
+
+
+
+R3IndexedMesh::
+R3IndexedMesh(const R3Mesh& mesh)
+  : positions(),
+    normals(),
+    colors(),
+    indices(),
+    materials(),
+    segments(),
+    categories(),
+    bbox(R3null_box)
+{
+  // Copy vertices and faces from mesh
+  LoadMesh(mesh);
+}
+
+
+
+R3IndexedMesh::
+~R3IndexedMesh(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Property functions
+////////////////////////////////////////////////////////////////////////
+
+R3Point R3IndexedMesh::
+Centroid(void) const
+{
+  // Return area-weighted centroid of faces
+  RNArea total_area = 0;
+  R3Point centroid(0, 0, 0);
+  for (int i = 0; i < NFaces(); i++) {
+    RNArea area = FaceArea(i);
+    centroid += area * FaceCentroid(i);
+    total_area += area;
+  }
+
+  // Return centroid of vertices if no area
+  if (total_area == 0) {
+    if (NVertices() == 0) return R3zero_point;
+    for (int i = 0; i < NVertices(); i++) centroid += VertexPosition(i);
+    return centroid / NVertices();
+  }
+
+  // Return centroid
+  return centroid / total_area;
+}
+
+
+
+RNArea R3IndexedMesh::
+Area(void) const
+{
+  // Sum areas of faces
+  RNArea area = 0;
+  for (int i = 0; i < NFaces(); i++) area += FaceArea(i);
+  return area;
+}
+
+
+
+RNBoolean R3IndexedMesh::
+HasColors(void) const
+{
+  // Return whether any vertex has a non-black color
+  for (unsigned int i = 0; i < colors.size(); i++) {
+    if (colors[i] != 0) return TRUE;
+  }
+
+  // All colors are black
+  return FALSE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Face property functions
+////////////////////////////////////////////////////////////////////////
+
+R3Vector R3IndexedMesh::
+FaceNormal(int face_index) const
+{
+  // Return normal of face
+  R3Point p0 = VertexPosition(VertexOnFace(face_index, 0));
+  R3Point p1 = VertexPosition(VertexOnFace(face_index, 1));
+  R3Point p2 = VertexPosition(VertexOnFace(face_index, 2));
+  R3Vector normal = (p1 - p0) % (p2 - p0);
+  normal.Normalize();
+  return normal;
+}
+
+
+
+RNArea R3IndexedMesh::
+FaceArea(int face_index) const
+{
+  // Return area of face
+  R3Point p0 = VertexPosition(VertexOnFace(face_index, 0));
+  R3Point p1 = VertexPosition(VertexOnFace(face_index, 1));
+  R3Point p2 = VertexPosition(VertexOnFace(face_index, 2));
+  return 0.5 * ((p1 - p0) % (p2 - p0)).Length();
+}
+
+
+
+R3Point R3IndexedMesh::
+RandomPointOnFace(int face_index) const
+{
+  // Return point sampled uniformly from face
+  R3Point p0 = VertexPosition(VertexOnFace(face_index, 0));
+  R3Point p1 = VertexPosition(VertexOnFace(face_index, 1));
+  R3Point p2 = VertexPosition(VertexOnFace(face_index, 2));
+  RNScalar r1 = sqrt(RNRandomScalar());
+  RNScalar r2 = RNRandomScalar();
+  return (1.0 - r1) * p0 + r1 * (1.0 - r2) * p1 + r1 * r2 * p2;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+static short
+PackNormalCoordinate(RNScalar value)
+{
+  // Return normal coordinate scaled to range of short
+  if (value >= 1.0) return 32767;
+  if (value <= -1.0) return -32767;
+  return (short) floor(32767.0 * value + 0.5);
+}
+
+
+
+static unsigned char
+PackColorComponent(RNScalar value)
+{
+  // Return color component scaled to range of unsigned char
+  if (value >= 1.0) return 255;
+  if (value <= 0.0) return 0;
+  return (unsigned char) (255.0 * value + 0.5);
+}
+
+
+
+int R3IndexedMesh::
+CreateVertex(const R3Point& position, const R3Vector& normal, const RNRgb& color)
+{
+  // Insert vertex
+  int vertex_index = NVertices();
+  positions.push_back(position.X());
+  positions.push_back(position.Y());
+  positions.push_back(position.Z());
+  normals.resize(normals.size() + 3);
+  colors.resize(colors.size() + 3);
+  SetVertexNormal(vertex_index, normal);
+  SetVertexColor(vertex_index, color);
+
+  // Update bounding box
+  bbox.Union(position);
+
+  // Return index of vertex
+  return vertex_index;
+}
+
+
+
+int R3IndexedMesh::
+CreateFace(int i0, int i1, int i2, int material, int segment, int category)
+{
+  // Check vertex indices
+  assert((i0 >= 0) && (i0 < NVertices()));
+  assert((i1 >= 0) && (i1 < NVertices()));
+  assert((i2 >= 0) && (i2 < NVertices()));
+
+  // Insert face
+  int face_index = NFaces();
+  indices.push_back(i0);
+  indices.push_back(i1);
+  indices.push_back(i2);
+
+  // Insert face attributes (allocated when first needed)
+  if (materials.empty() && ((material != -1) || (segment != -1) || (category != -1))) {
+    materials.assign(face_index, -1);
+    segments.assign(face_index, -1);
+    categories.assign(face_index, -1);
+  }
+  if (!materials.empty()) {
+    materials.push_back(material);
+    segments.push_back(segment);
+    categories.push_back(category);
+  }
+
+  // Return index of face
+  return face_index;
+}
+
+
+
+void R3IndexedMesh::
+SetVertexPosition(int vertex_index, const R3Point& position)
+{
+  // Set vertex position (bounding box only grows)
+  float *p = &positions[3*vertex_index];
+  p[0] = position.X();
+  p[1] = position.Y();
+  p[2] = position.Z();
+  bbox.Union(position);
+}
+
+
+
+void R3IndexedMesh::
+SetVertexNormal(int vertex_index, const R3Vector& normal)
+{
+  // Set packed vertex normal
+  short *n = &normals[3*vertex_index];
+  n[0] = PackNormalCoordinate(normal.X());
+  n[1] = PackNormalCoordinate(normal.Y());
+  n[2] = PackNormalCoordinate(normal.Z());
+}
+
+
+
+void R3IndexedMesh::
+SetVertexColor(int vertex_index, const RNRgb& color)
+{
+  // Set packed vertex color
+  unsigned char *c = &colors[3*vertex_index];
+  c[0] = PackColorComponent(color.R());
+  c[1] = PackColorComponent(color.G());
+  c[2] = PackColorComponent(color.B());
+}
+
+
+
+void R3IndexedMesh::
+UpdateVertexNormals(void)
+{
+  // Accumulate face normals at vertices (unweighted, as in R3Mesh)
+  std::vector<double> sums(positions.size(), 0.0);
+  for (int i = 0; i < NFaces(); i++) {
+    const unsigned int *f = &indices[3*i];
+    const float *p0 = &positions[3*f[0]];
+    const float *p1 = &positions[3*f[1]];
+    const float *p2 = &positions[3*f[2]];
+    double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    double n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+    double length = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if (length == 0) continue;
+    n[0] /= length; n[1] /= length; n[2] /= length;
+    for (int k = 0; k < 3; k++) {
+      double *sum = &sums[3*f[k]];
+      sum[0] += n[0]; sum[1] += n[1]; sum[2] += n[2];
+    }
+  }
+
+  // Normalize and pack vertex normals
+  for (int i = 0; i < NVertices(); i++) {
+    R3Vector normal(sums[3*i], sums[3*i+1], sums[3*i+2]);
+    normal.Normalize();
+    SetVertexNormal(i, normal);
+  }
+}
+
+
+
+void R3IndexedMesh::
+Transform(const R3Transformation& transformation)
+{
+  // Transform vertex positions and normals
+  bbox = R3null_box;
+  for (int i = 0; i < NVertices(); i++) {
+    R3Point position = VertexPosition(i);
+    transformation.Apply(position);
+    SetVertexPosition(i, position);
+    R3Vector normal = VertexNormal(i);
+    transformation.ApplyInverseTranspose(normal);
+    normal.Normalize();
+    SetVertexNormal(i, normal);
+  }
+}
+
+
+
+void R3IndexedMesh::
+Reserve(int nvertices, int nfaces)
+{
+  // Allocate storage for vertices and faces
+  positions.reserve(3 * nvertices);
+  normals.reserve(3 * nvertices);
+  colors.reserve(3 * nvertices);
+  indices.reserve(3 * nfaces);
+}
+
+
+
+void R3IndexedMesh::
+Empty(void)
+{
+  // Remove all vertices and faces
+  positions.clear();
+  normals.clear();
+  colors.clear();
+  indices.clear();
+  materials.clear();
+  segments.clear();
+  categories.clear();
+  bbox = R3null_box;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Conversion functions
+////////////////////////////////////////////////////////////////////////
+
+int R3IndexedMesh::
+LoadMesh(const R3Mesh& mesh)
+{
+  // Remove previous contents
+  Empty();
+  Reserve(mesh.NVertices(), mesh.NFaces());
+
+  // Copy vertices
+  for (int i = 0; i < mesh.NVertices(); i++) {
+    R3MeshVertex *vertex = mesh.Vertex(i);
+    CreateVertex(mesh.VertexPosition(vertex), mesh.VertexNormal(vertex), mesh.VertexColor(vertex));
+  }
+
+  // Copy faces
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    int i0 = mesh.VertexID(mesh.VertexOnFace(face, 0));
+    int i1 = mesh.VertexID(mesh.VertexOnFace(face, 1));
+    int i2 = mesh.VertexID(mesh.VertexOnFace(face, 2));
+    CreateFace(i0, i1, i2, mesh.FaceMaterial(face), mesh.FaceSegment(face), mesh.FaceCategory(face));
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3IndexedMesh::
+CreateMesh(R3Mesh *mesh) const
+{
+  // Create vertices
+  int nvertices = NVertices();
+  int first_vertex_id = mesh->CreateVertices(nvertices, VertexPositions());
+  RNBoolean has_colors = HasColors();
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = mesh->Vertex(first_vertex_id + i);
+    mesh->SetVertexNormal(vertex, VertexNormal(i));
+    if (has_colors) mesh->SetVertexColor(vertex, VertexColor(i));
+  }
+
+  // Create faces
+  int nfaces = NFaces();
+  if (nfaces == 0) return 1;
+  std::vector<int> vertex_ids(3 * nfaces);
+  for (int i = 0; i < 3 * nfaces; i++) vertex_ids[i] = first_vertex_id + (int) indices[i];
+  std::vector<R3MeshFace *> faces(nfaces);
+  mesh->CreateFaces(nfaces, &vertex_ids[0], &faces[0]);
+
+  // Set face attributes
+  for (int i = 0; i < nfaces; i++) {
+    R3MeshFace *face = faces[i];
+    if (!face) continue;
+    mesh->SetFaceMaterial(face, FaceMaterial(i));
+    mesh->SetFaceSegment(face, FaceSegment(i));
+    mesh->SetFaceCategory(face, FaceCategory(i));
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3IndexedMesh::
+LoadPlyMesh(const R3PlyMesh& ply_mesh)
+{
+  // Remove previous contents
+  Empty();
+
+  // Copy vertices
+  int nvertices = ply_mesh.NVertices();
+  positions = ply_mesh.positions;
+  normals.assign(3 * nvertices, 0);
+  colors.assign(3 * nvertices, 0);
+  if (!ply_mesh.normals.empty()) {
+    for (int i = 0; i < 3 * nvertices; i++) normals[i] = PackNormalCoordinate(ply_mesh.normals[i]);
+  }
+  if (!ply_mesh.colors.empty()) {
+    colors = ply_mesh.colors;
+  }
+
+  // Copy faces
+  indices.assign(ply_mesh.indices.begin(), ply_mesh.indices.end());
+  if (!ply_mesh.materials.empty() || !ply_mesh.segments.empty() || !ply_mesh.categories.empty()) {
+    int nfaces = ply_mesh.NFaces();
+    materials = (ply_mesh.materials.empty()) ? std::vector<int>(nfaces, -1) : ply_mesh.materials;
+    segments = (ply_mesh.segments.empty()) ? std::vector<int>(nfaces, -1) : ply_mesh.segments;
+    categories = (ply_mesh.categories.empty()) ? std::vector<int>(nfaces, -1) : ply_mesh.categories;
+  }
+
+  // Compute bounding box
+  for (int i = 0; i < nvertices; i++) {
+    const float *p = &positions[3*i];
+    bbox.Union(R3Point(p[0], p[1], p[2]));
+  }
+
+  // Compute vertex normals if none were read
+  if (ply_mesh.normals.empty()) UpdateVertexNormals();
+
+  // Return success
+  return 1;
+}
+
+
+
+void R3IndexedMesh::
+FillPlyMesh(R3PlyMesh *ply_mesh) const
+{
+  // Copy vertices
+  ply_mesh->Empty();
+  ply_mesh->positions = positions;
+  ply_mesh->normals.resize(normals.size());
+  for (unsigned int i = 0; i < normals.size(); i++) ply_mesh->normals[i] = normals[i] / 32767.0F;
+  if (HasColors()) ply_mesh->colors = colors;
+
+  // Copy faces
+  ply_mesh->indices.assign(indices.begin(), indices.end());
+  ply_mesh->materials = materials;
+  ply_mesh->segments = segments;
+  ply_mesh->categories = categories;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// I/O functions
+////////////////////////////////////////////////////////////////////////
+
+int R3IndexedMesh::
+ReadFile(const char *filename)
+{
+  // Parse input filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    printf("Filename %s has no extension (e.g., .ply)\n", filename);
+    return 0;
+  }
+
+  // Read ply files directly
+  if (!strncmp(extension, ".ply", 4)) {
+    return ReadPlyFile(filename);
+  }
+
+  // Read other formats with R3Mesh
+  R3Mesh mesh;
+  if (!mesh.ReadFile(filename)) return 0;
+  return LoadMesh(mesh);
+}
+
+
+
+int R3IndexedMesh::
+WriteFile(const char *filename) const
+{
+  // Parse output filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    printf("Filename %s has no extension (e.g., .ply)\n", filename);
+    return 0;
+  }
+
+  // Write ply files directly
+  if (!strncmp(extension, ".ply", 4)) {
+    return WritePlyFile(filename);
+  }
+
+  // Write other formats with R3Mesh
+  R3Mesh mesh;
+  if (!CreateMesh(&mesh)) return 0;
+  return mesh.WriteFile(filename);
+}
+
+
+
+int R3IndexedMesh::
+ReadPlyFile(const char *filename)
+{
+  typedef struct PlyVertex {
+    float x, y, z;
+    float nx, ny, nz;
+    unsigned char red, green, blue;
+  } PlyVertex;
+
+  typedef struct PlyFace {
+    unsigned char nverts;
+    int *verts;
+    int material;
+    int segment;
+    int category;
+  } PlyFace;
+
+  // List of property information for a vertex
+  static PlyProperty vert_props[] = {
+    {(char *) "x", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,x), 0, 0, 0, 0},
+    {(char *) "y", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,y), 0, 0, 0, 0},
+    {(char *) "z", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,z), 0, 0, 0, 0},
+    {(char *) "nx", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,nx), 0, 0, 0, 0},
+    {(char *) "ny", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,ny), 0, 0, 0, 0},
+    {(char *) "nz", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,nz), 0, 0, 0, 0},
+    {(char *) "red", PLY_UCHAR, PLY_UCHAR, offsetof(PlyVertex,red), 0, 0, 0, 0},
+    {(char *) "green", PLY_UCHAR, PLY_UCHAR, offsetof(PlyVertex,green), 0, 0, 0, 0},
+    {(char *) "blue", PLY_UCHAR, PLY_UCHAR, offsetof(PlyVertex,blue), 0, 0, 0, 0}
+  };
+
+  // List of property information for a face
+  static PlyProperty face_props[] = {
+    {(char *) "vertex_indices", PLY_INT, PLY_INT, offsetof(PlyFace,verts), 1, PLY_UCHAR, PLY_UCHAR, offsetof(PlyFace,nverts)},
+    {(char *) "vertex_index", PLY_INT, PLY_INT, offsetof(PlyFace,verts), 1, PLY_UCHAR, PLY_UCHAR, offsetof(PlyFace,nverts)},
+    {(char *) "material_id", PLY_INT, PLY_INT, offsetof(PlyFace,material), 0, 0, 0, 0},
+    {(char *) "segment_id", PLY_INT, PLY_INT, offsetof(PlyFace,segment), 0, 0, 0, 0},
+    {(char *) "category_id", PLY_INT, PLY_INT, offsetof(PlyFace,category), 0, 0, 0, 0}
+  };
+
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    RNFail("Unable to open file: %s", filename);
+    return 0;
+  }
+
+  // Read binary files with fast codec
+  R3PlyMesh ply_mesh;
+  int status = R3ReadBinaryPlyMesh(fp, &ply_mesh);
+  if (status >= 0) {
+    fclose(fp);
+    if (status == 0) return 0;
+    return LoadPlyMesh(ply_mesh);
+  }
+
+  // Read PLY header
+  int nelems;
+  char **elist;
+  PlyFile *ply = ply_read(fp, &nelems, &elist);
+  if (!ply) {
+    RNFail("Unable to read ply file header");
+    fclose(fp);
+    return 0;
+  }
+
+  // Remove previous contents
+  Empty();
+
+  // Read all elements
+  RNBoolean has_normals = FALSE;
+  for (int i = 0; i < nelems; i++) {
+    // Get the description of the element
+    int num_elems, nprops;
+    char *elem_name = elist[i];
+    PlyProperty **plist = ply_get_element_description(ply, elem_name, &num_elems, &nprops);
+
+    // Check element type
+    if (equal_strings("vertex", elem_name)) {
+      // Allocate vertices
+      positions.reserve(3 * num_elems);
+      normals.reserve(3 * num_elems);
+      colors.reserve(3 * num_elems);
+
+      // Set up for getting vertex elements
+      for (int j = 0; j < nprops; j++) {
+        for (int k = 0; k < 9; k++) {
+          if (equal_strings(vert_props[k].name, plist[j]->name)) ply_get_property(ply, elem_name, &vert_props[k]);
+        }
+        if (equal_strings("nx", plist[j]->name)) has_normals = TRUE;
+      }
+
+      // Read vertex elements
+      for (int j = 0; j < num_elems; j++) {
+        PlyVertex plyvertex;
+        memset(&plyvertex, 0, sizeof(PlyVertex));
+        ply_get_element(ply, (void *) &plyvertex);
+        positions.push_back(plyvertex.x);
+        positions.push_back(plyvertex.y);
+        positions.push_back(plyvertex.z);
+        normals.push_back(PackNormalCoordinate(plyvertex.nx));
+        normals.push_back(PackNormalCoordinate(plyvertex.ny));
+        normals.push_back(PackNormalCoordinate(plyvertex.nz));
+        colors.push_back(plyvertex.red);
+        colors.push_back(plyvertex.green);
+        colors.push_back(plyvertex.blue);
+        bbox.Union(R3Point(plyvertex.x, plyvertex.y, plyvertex.z));
+      }
+    }
+    else if (equal_strings("face", elem_name)) {
+      // Allocate faces (polygons are split into fans of triangles)
+      indices.reserve(3 * num_elems);
+
+      // Set up for getting face elements
+      for (int j = 0; j < nprops; j++) {
+        for (int k = 0; k < 5; k++) {
+          if (equal_strings(face_props[k].name, plist[j]->name)) ply_get_property(ply, elem_name, &face_props[k]);
+        }
+      }
+
+      // Read face elements
+      int nvertices = NVertices();
+      for (int j = 0; j < num_elems; j++) {
+        PlyFace plyface;
+        plyface.nverts = 0;
+        plyface.verts = NULL;
+        plyface.material = -1;
+        plyface.segment = -1;
+        plyface.category = -1;
+        ply_get_element(ply, (void *) &plyface);
+
+        // Create triangles (skipping ones with repeated or invalid vertices)
+        for (int k = 2; k < plyface.nverts; k++) {
+          int i0 = plyface.verts[0];
+          int i1 = plyface.verts[k-1];
+          int i2 = plyface.verts[k];
+          if ((i0 < 0) || (i1 < 0) || (i2 < 0)) continue;
+          if ((i0 >= nvertices) || (i1 >= nvertices) || (i2 >= nvertices)) continue;
+          if ((i0 == i1) || (i1 == i2) || (i0 == i2)) continue;
+          CreateFace(i0, i1, i2, plyface.material, plyface.segment, plyface.category);
+        }
+
+        // Free face data allocated by ply
+        if (plyface.verts) free(plyface.verts);
+      }
+    }
+    else {
+      ply_get_other_element(ply, elem_name, num_elems);
+    }
+  }
+
+  // Free the memory
+  free(ply);
+
+  // Close file
+  fclose(fp);
+
+  // Compute vertex normals if none were read
+  if (!has_normals) UpdateVertexNormals();
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3IndexedMesh::
+WritePlyFile(const char *filename, RNBoolean binary) const
+{
+  typedef struct PlyVertex {
+    float x, y, z;
+    float nx, ny, nz;
+    unsigned char red, green, blue;
+  } PlyVertex;
+
+  typedef struct PlyFace {
+    unsigned char nverts;
+    int *verts;
+    int material;
+    int segment;
+    int category;
+  } PlyFace;
+
+  // Element names
+  char *elem_names[] = { (char *) "vertex", (char *) "face" };
+
+  // List of property information for a vertex
+  static PlyProperty vert_props[] = {
+    {(char *) "x", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,x), 0, 0, 0, 0},
+    {(char *) "y", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,y), 0, 0, 0, 0},
+    {(char *) "z", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,z), 0, 0, 0, 0},
+    {(char *) "nx", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,nx), 0, 0, 0, 0},
+    {(char *) "ny", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,ny), 0, 0, 0, 0},
+    {(char *) "nz", PLY_FLOAT, PLY_FLOAT, offsetof(PlyVertex,nz), 0, 0, 0, 0},
+    {(char *) "red", PLY_UCHAR, PLY_UCHAR, offsetof(PlyVertex,red), 0, 0, 0, 0},
+    {(char *) "green", PLY_UCHAR, PLY_UCHAR, offsetof(PlyVertex,green), 0, 0, 0, 0},
+    {(char *) "blue", PLY_UCHAR, PLY_UCHAR, offsetof(PlyVertex,blue), 0, 0, 0, 0}
+  };
+
+  // List of property information for a face
+  static PlyProperty face_props[] = {
+    {(char *) "vertex_indices", PLY_INT, PLY_INT, offsetof(PlyFace,verts), 1, PLY_UCHAR, PLY_UCHAR, offsetof(PlyFace,nverts)},
+    {(char *) "material_id", PLY_INT, PLY_INT, offsetof(PlyFace,material), 0, 0, 0, 0},
+    {(char *) "segment_id", PLY_INT, PLY_INT, offsetof(PlyFace,segment), 0, 0, 0, 0},
+    {(char *) "category_id", PLY_INT, PLY_INT, offsetof(PlyFace,category), 0, 0, 0, 0}
+  };
+
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open file: %s", filename);
+    return 0;
+  }
+
+  // Write binary files with fast codec
+  if (binary) {
+    R3PlyMesh ply_mesh;
+    FillPlyMesh(&ply_mesh);
+    int status = R3WriteBinaryPlyMesh(fp, ply_mesh);
+    fclose(fp);
+    return status;
+  }
+
+  // Open ply file
+  int file_type = (binary) ? PLY_BINARY_NATIVE : PLY_ASCII;
+  PlyFile *ply = ply_write(fp, 2, elem_names, file_type);
+  if (!ply) { fclose(fp); return 0; }
+
+  // Describe vertex properties
+  RNBoolean has_colors = HasColors();
+  ply_element_count(ply, (char *) "vertex", NVertices());
+  for (int k = 0; k < 6; k++) ply_describe_property(ply, (char *) "vertex", &vert_props[k]);
+  if (has_colors) {
+    for (int k = 6; k < 9; k++) ply_describe_property(ply, (char *) "vertex", &vert_props[k]);
+  }
+
+  // Describe face properties
+  ply_element_count(ply, (char *) "face", NFaces());
+  ply_describe_property(ply, (char *) "face", &face_props[0]);
+  if (HasFaceAttributes()) {
+    for (int k = 1; k < 4; k++) ply_describe_property(ply, (char *) "face", &face_props[k]);
+  }
+
+  // Complete header
+  ply_header_complete(ply);
+
+  // Write vertices
+  ply_put_element_setup(ply, (char *) "vertex");
+  for (int i = 0; i < NVertices(); i++) {
+    const float *p = &positions[3*i];
+    const short *n = &normals[3*i];
+    const unsigned char *c = &colors[3*i];
+    PlyVertex ply_vertex;
+    ply_vertex.x = p[0];
+    ply_vertex.y = p[1];
+    ply_vertex.z = p[2];
+    ply_vertex.nx = n[0] / 32767.0;
+    ply_vertex.ny = n[1] / 32767.0;
+    ply_vertex.nz = n[2] / 32767.0;
+    ply_vertex.red = c[0];
+    ply_vertex.green = c[1];
+    ply_vertex.blue = c[2];
+    ply_put_element(ply, (void *) &ply_vertex);
+  }
+
+  // Write faces
+  ply_put_element_setup(ply, (char *) "face");
+  for (int i = 0; i < NFaces(); i++) {
+    int verts[3];
+    PlyFace ply_face;
+    ply_face.nverts = 3;
+    ply_face.verts = verts;
+    verts[0] = VertexOnFace(i, 0);
+    verts[1] = VertexOnFace(i, 1);
+    verts[2] = VertexOnFace(i, 2);
+    ply_face.material = FaceMaterial(i);
+    ply_face.segment = FaceSegment(i);
+    ply_face.category = FaceCategory(i);
+    ply_put_element(ply, (void *) &ply_face);
+  }
+
+  // Free the memory
+  free(ply);
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+} // namespace gaps
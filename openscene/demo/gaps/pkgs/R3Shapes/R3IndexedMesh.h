@@ -0,0 +1,252 @@
+// Include file for the R3 indexed triangle mesh class
+#ifndef __R3__INDEXED__MESH__H__
+#define __R3__INDEXED__MESH__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Class definition
+
+class R3IndexedMesh {
+public:
+  // Constructor/deconstructor
+  R3IndexedMesh(void);
+  R3IndexedMesh(const R3Mesh& mesh);
+  ~R3IndexedMesh(void);
+
+  // Property functions
+  int NVertices(void) const;
+  int NFaces(void) const;
+  const R3Box& BBox(void) const;
+  R3Point Centroid(void) const;
+  RNArea Area(void) const;
+  RNBoolean HasColors(void) const;
+  RNBoolean HasFaceAttributes(void) const;
+
+  // Vertex access functions
+  R3Point VertexPosition(int vertex_index) const;
+  R3Vector VertexNormal(int vertex_index) const;
+  RNRgb VertexColor(int vertex_index) const;
+
+  // Face access functions
+  int VertexOnFace(int face_index, int k) const;
+  R3Point FaceCentroid(int face_index) const;
+  R3Vector FaceNormal(int face_index) const;
+  RNArea FaceArea(int face_index) const;
+  int FaceMaterial(int face_index) const;
+  int FaceSegment(int face_index) const;
+  int FaceCategory(int face_index) const;
+  R3Point RandomPointOnFace(int face_index) const;
+
+  // Array access functions (positions are float triples, normals are short triples
+  // scaled by 32767, colors are unsigned char triples, and faces are index triples)
+  const float *VertexPositions(void) const;
+  const short *VertexNormals(void) const;
+  const unsigned char *VertexColors(void) const;
+  const unsigned int *FaceIndices(void) const;
+
+  // Manipulation functions
+  int CreateVertex(const R3Point& position, const R3Vector& normal = R3zero_vector, const RNRgb& color = RNblack_rgb);
+  int CreateFace(int i0, int i1, int i2, int material = -1, int segment = -1, int category = -1);
+  void SetVertexPosition(int vertex_index, const R3Point& position);
+  void SetVertexNormal(int vertex_index, const R3Vector& normal);
+  void SetVertexColor(int vertex_index, const RNRgb& color);
+  void UpdateVertexNormals(void);
+  void Transform(const R3Transformation& transformation);
+  void Reserve(int nvertices, int nfaces);
+  void Empty(void);
+
+  // Conversion functions (R3Mesh vertices keep their indices, and so do faces except non-manifold ones)
+  int LoadMesh(const R3Mesh& mesh);
+  int CreateMesh(R3Mesh *mesh) const;
+  int LoadPlyMesh(const R3PlyMesh& ply_mesh);
+  void FillPlyMesh(R3PlyMesh *ply_mesh) const;
+
+  // I/O functions (ply files are read directly, other formats through R3Mesh)
+  int ReadFile(const char *filename);
+  int ReadPlyFile(const char *filename);
+  int WriteFile(const char *filename) const;
+  int WritePlyFile(const char *filename, RNBoolean binary = TRUE) const;
+
+private:
+  std::vector<float> positions;
+  std::vector<short> normals;
+  std::vector<unsigned char> colors;
+  std::vector<unsigned int> indices;
+  std::vector<int> materials;
+  std::vector<int> segments;
+  std::vector<int> categories;
+  R3Box bbox;
+};
+
+
+
+// Inline functions
+
+inline int R3IndexedMesh::
+NVertices(void) const
+{
+  // Return number of vertices
+  return (int) (positions.size() / 3);
+}
+
+
+
+inline int R3IndexedMesh::
+NFaces(void) const
+{
+  // Return number of faces
+  return (int) (indices.size() / 3);
+}
+
+
+
+inline const R3Box& R3IndexedMesh::
+BBox(void) const
+{
+  // Return bounding box of vertices
+  return bbox;
+}
+
+
+
+inline RNBoolean R3IndexedMesh::
+HasFaceAttributes(void) const
+{
+  // Return whether faces have material, segment, and category identifiers
+  return !materials.empty();
+}
+
+
+
+inline R3Point R3IndexedMesh::
+VertexPosition(int vertex_index) const
+{
+  // Return position of vertex
+  const float *p = &positions[3*vertex_index];
+  return R3Point(p[0], p[1], p[2]);
+}
+
+
+
+inline R3Vector R3IndexedMesh::
+VertexNormal(int vertex_index) const
+{
+  // Return normal of vertex
+  const short *n = &normals[3*vertex_index];
+  return R3Vector(n[0] / 32767.0, n[1] / 32767.0, n[2] / 32767.0);
+}
+
+
+
+inline RNRgb R3IndexedMesh::
+VertexColor(int vertex_index) const
+{
+  // Return color of vertex
+  const unsigned char *c = &colors[3*vertex_index];
+  return RNRgb(c[0] / 255.0, c[1] / 255.0, c[2] / 255.0);
+}
+
+
+
+inline int R3IndexedMesh::
+VertexOnFace(int face_index, int k) const
+{
+  // Return index of kth vertex of face
+  return (int) indices[3*face_index + k];
+}
+
+
+
+inline R3Point R3IndexedMesh::
+FaceCentroid(int face_index) const
+{
+  // Return centroid of face
+  R3Point centroid = VertexPosition(VertexOnFace(face_index, 0));
+  centroid += VertexPosition(VertexOnFace(face_index, 1));
+  centroid += VertexPosition(VertexOnFace(face_index, 2));
+  return centroid / 3.0;
+}
+
+
+
+inline int R3IndexedMesh::
+FaceMaterial(int face_index) const
+{
+  // Return material identifier of face
+  return (materials.empty()) ? -1 : materials[face_index];
+}
+
+
+
+inline int R3IndexedMesh::
+FaceSegment(int face_index) const
+{
+  // Return segment identifier of face
+  return (segments.empty()) ? -1 : segments[face_index];
+}
+
+
+
+inline int R3IndexedMesh::
+FaceCategory(int face_index) const
+{
+  // Return category identifier of face
+  return (categories.empty()) ? -1 : categories[face_index];
+}
+
+
+
+inline const float *R3IndexedMesh::
+VertexPositions(void) const
+{
+  // Return array of vertex positions
+  return (positions.empty()) ? NULL : &positions[0];
+}
+
+
+
+inline const short *R3IndexedMesh::
+VertexNormals(void) const
+{
+  // Return array of packed vertex normals
+  return (normals.empty()) ? NULL : &normals[0];
+}
+
+
+
+inline const unsigned char *R3IndexedMesh::
+VertexColors(void) const
+{
+  // Return array of vertex colors
+  return (colors.empty()) ? NULL : &colors[0];
+}
+
+
+
+inline const unsigned int *R3IndexedMesh::
+FaceIndices(void) const
+{
+  // Return array of face vertex indices
+  return (indices.empty()) ? NULL : &indices[0];
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -1577,6 +1577,242 @@ CreateFace(R3MeshVertex *v1, R3MeshVertex *v2, R3MeshVertex *v3,
 
 
 
+int R3Mesh::
+CreateVertices(int nvertices, const float *positions)
+{
+  // Remember ID of first new vertex
+  int first_vertex_id = vertices.NEntries();
+  if (nvertices <= 0) return first_vertex_id;
+
+  // Allocate block of vertices (if mesh does not already have one)
+  R3MeshVertex *block = NULL;
+  if (!vertex_block) block = vertex_block = new R3MeshVertex [ nvertices ];
+
+  // Resize array of vertices
+  vertices.Resize(first_vertex_id + nvertices);
+
+  // Create vertices
+  for (int i = 0; i < nvertices; i++) {
+    const float *p = &positions[3*i];
+    CreateVertex(R3Point(p[0], p[1], p[2]), (block) ? &block[i] : NULL);
+  }
+
+  // Return ID of first new vertex
+  return first_vertex_id;
+}
+
+
+
+int R3Mesh::
+CreateVertices(int nvertices, const double *positions)
+{
+  // Remember ID of first new vertex
+  int first_vertex_id = vertices.NEntries();
+  if (nvertices <= 0) return first_vertex_id;
+
+  // Allocate block of vertices (if mesh does not already have one)
+  R3MeshVertex *block = NULL;
+  if (!vertex_block) block = vertex_block = new R3MeshVertex [ nvertices ];
+
+  // Resize array of vertices
+  vertices.Resize(first_vertex_id + nvertices);
+
+  // Create vertices
+  for (int i = 0; i < nvertices; i++) {
+    const double *p = &positions[3*i];
+    CreateVertex(R3Point(p[0], p[1], p[2]), (block) ? &block[i] : NULL);
+  }
+
+  // Return ID of first new vertex
+  return first_vertex_id;
+}
+
+
+
+struct R3MeshEdgeSortData {
+  const int *vertex_ids;
+  const int *bucket_offsets;
+  int *halfedges;
+  int *leaders;
+};
+
+
+
+static int
+HalfEdgeOtherVertex(const int *vertex_ids, int halfedge)
+{
+  // Return the larger vertex ID of a halfedge (3*face+k goes from corner k to corner k+1)
+  int face = halfedge / 3, k = halfedge % 3;
+  int v0 = vertex_ids[3*face + k];
+  int v1 = vertex_ids[3*face + (k+1)%3];
+  return (v0 > v1) ? v0 : v1;
+}
+
+
+
+static void
+SortEdgeBucket(int vertex_id, int, void *data)
+{
+  // Get bucket of halfedges whose smaller vertex ID is vertex_id
+  R3MeshEdgeSortData *sort_data = (R3MeshEdgeSortData *) data;
+  const int *vertex_ids = sort_data->vertex_ids;
+  int *halfedges = sort_data->halfedges;
+  int start = sort_data->bucket_offsets[vertex_id];
+  int end = sort_data->bucket_offsets[vertex_id+1];
+
+  // Insertion sort by larger vertex ID (buckets are small and already in halfedge order)
+  for (int i = start + 1; i < end; i++) {
+    int halfedge = halfedges[i];
+    int other = HalfEdgeOtherVertex(vertex_ids, halfedge);
+    int j = i - 1;
+    while ((j >= start) && (HalfEdgeOtherVertex(vertex_ids, halfedges[j]) > other)) {
+      halfedges[j+1] = halfedges[j];
+      j--;
+    }
+    halfedges[j+1] = halfedge;
+  }
+
+  // Point every halfedge at the first halfedge with the same vertices
+  for (int i = start; i < end; ) {
+    int other = HalfEdgeOtherVertex(vertex_ids, halfedges[i]);
+    int j = i;
+    while ((j < end) && (HalfEdgeOtherVertex(vertex_ids, halfedges[j]) == other)) {
+      sort_data->leaders[halfedges[j]] = halfedges[i];
+      j++;
+    }
+    i = j;
+  }
+}
+
+
+
+int R3Mesh::
+CreateFaces(int nfaces, const int *vertex_ids, R3MeshFace **created_faces)
+{
+  // Check number of faces
+  if (nfaces <= 0) return 0;
+  int nvertices = vertices.NEntries();
+  RNBoolean had_edges = (edges.NEntries() > 0);
+
+  // Check which faces are valid
+  std::vector<unsigned char> valid(nfaces, 0);
+  for (int i = 0; i < nfaces; i++) {
+    const int *f = &vertex_ids[3*i];
+    if (created_faces) created_faces[i] = NULL;
+    if ((f[0] < 0) || (f[1] < 0) || (f[2] < 0)) continue;
+    if ((f[0] >= nvertices) || (f[1] >= nvertices) || (f[2] >= nvertices)) continue;
+    if ((f[0] == f[1]) || (f[1] == f[2]) || (f[0] == f[2])) continue;
+    valid[i] = 1;
+  }
+
+  // Count halfedges in buckets indexed by smaller vertex ID
+  std::vector<int> bucket_offsets(nvertices + 1, 0);
+  for (int i = 0; i < nfaces; i++) {
+    if (!valid[i]) continue;
+    for (int k = 0; k < 3; k++) {
+      int v0 = vertex_ids[3*i + k];
+      int v1 = vertex_ids[3*i + (k+1)%3];
+      bucket_offsets[((v0 < v1) ? v0 : v1) + 1]++;
+    }
+  }
+  for (int i = 0; i < nvertices; i++) {
+    bucket_offsets[i+1] += bucket_offsets[i];
+  }
+
+  // Fill buckets with halfedges in order
+  std::vector<int> halfedges(bucket_offsets[nvertices]);
+  std::vector<int> bucket_counts(bucket_offsets.begin(), bucket_offsets.end() - 1);
+  for (int i = 0; i < nfaces; i++) {
+    if (!valid[i]) continue;
+    for (int k = 0; k < 3; k++) {
+      int v0 = vertex_ids[3*i + k];
+      int v1 = vertex_ids[3*i + (k+1)%3];
+      halfedges[bucket_counts[(v0 < v1) ? v0 : v1]++] = 3*i + k;
+    }
+  }
+
+  // Sort buckets in parallel to find the first halfedge of each edge
+  std::vector<int> leaders(3 * nfaces, -1);
+  R3MeshEdgeSortData sort_data;
+  sort_data.vertex_ids = vertex_ids;
+  sort_data.bucket_offsets = &bucket_offsets[0];
+  sort_data.halfedges = (halfedges.empty()) ? NULL : &halfedges[0];
+  sort_data.leaders = &leaders[0];
+  RNParallelFor(nvertices, SortEdgeBucket, &sort_data, 4096);
+
+  // Count new edges 
+  int nedges = 0;
+  for (int i = 0; i < 3 * nfaces; i++) {
+    if (leaders[i] == i) nedges++;
+  }
+
+  // Allocate block of edges (if mesh does not already have one)
+  R3MeshEdge *block = NULL;
+  if (!edge_block && !had_edges && (nedges > 0)) block = edge_block = new R3MeshEdge [ nedges ];
+  edges.Resize(edges.NEntries() + nedges);
+
+  // Create edges in order of first use (as CreateFace would)
+  int edge_count = 0;
+  std::vector<R3MeshEdge *> halfedge_edges(3 * nfaces, (R3MeshEdge *) NULL);
+  for (int i = 0; i < 3 * nfaces; i++) {
+    if (leaders[i] < 0) continue;
+    if (leaders[i] == i) {
+      R3MeshVertex *v0 = vertices[vertex_ids[i]];
+      R3MeshVertex *v1 = vertices[vertex_ids[3*(i/3) + (i%3+1)%3]];
+      R3MeshEdge *e = (had_edges) ? EdgeBetweenVertices(v0, v1) : NULL;
+      if (!e) e = CreateEdge(v0, v1, (block) ? &block[edge_count++] : NULL);
+      halfedge_edges[i] = e;
+    }
+    else {
+      halfedge_edges[i] = halfedge_edges[leaders[i]];
+    }
+  }
+
+  // Allocate block of faces (if mesh does not already have one)
+  R3MeshFace *fblock = NULL;
+  if (!face_block) fblock = face_block = new R3MeshFace [ nfaces ];
+  faces.Resize(faces.NEntries() + nfaces);
+
+  // Create faces (degenerate ones at end to preserve face ordering)
+  int count = 0;
+  std::vector<int> degenerate_faces;
+  for (int i = 0; i < nfaces; i++) {
+    if (!valid[i]) continue;
+    R3MeshVertex *v1 = vertices[vertex_ids[3*i+0]];
+    R3MeshVertex *v2 = vertices[vertex_ids[3*i+1]];
+    R3MeshVertex *v3 = vertices[vertex_ids[3*i+2]];
+    R3MeshEdge *e1 = halfedge_edges[3*i+0];
+    R3MeshEdge *e2 = halfedge_edges[3*i+1];
+    R3MeshEdge *e3 = halfedge_edges[3*i+2];
+    R3MeshFace *face = CreateFace(v1, v2, v3, e1, e2, e3, (fblock) ? &fblock[i] : NULL);
+    if (!face) { degenerate_faces.push_back(i); continue; }
+    if (created_faces) created_faces[i] = face;
+    count++;
+  }
+
+  // Create degenerate faces (e.g., flips or three faces sharing an edge)
+  for (unsigned int j = 0; j < degenerate_faces.size(); j++) {
+    int i = degenerate_faces[j];
+    R3MeshVertex *v1 = vertices[vertex_ids[3*i+0]];
+    R3MeshVertex *v2 = vertices[vertex_ids[3*i+1]];
+    R3MeshVertex *v3 = vertices[vertex_ids[3*i+2]];
+    R3MeshFace *face = CreateFace(v1, v3, v2);
+    if (!face) {
+      R3MeshVertex *v1a = CreateVertex(VertexPosition(v1));
+      R3MeshVertex *v2a = CreateVertex(VertexPosition(v2));
+      R3MeshVertex *v3a = CreateVertex(VertexPosition(v3));
+      face = CreateFace(v1a, v2a, v3a);
+    }
+    if (created_faces) created_faces[i] = face;
+    if (face) count++;
+  }
+
+  // Return number of faces created
+  return count;
+}
+
+
+
 void R3Mesh::
 DeallocateVertex(R3MeshVertex *v)
 {
@@ -2597,6 +2833,297 @@ CollapseShortEdges(RNLength min_edge_length)
 
 
 
+struct R3MeshDecimationVertex {
+  RNScalar quadric[10];
+  void *data;
+};
+
+struct R3MeshDecimationEdge {
+  R3MeshEdge *edge;
+  R3Point point;
+  RNScalar error;
+  R3MeshDecimationEdge **heappointer;
+  void *data;
+};
+
+struct R3MeshDecimationData {
+  R3Mesh *mesh;
+  R3MeshDecimationVertex *vertex_records;
+  R3MeshDecimationEdge *edge_records;
+};
+
+
+
+static void
+AddPlaneQuadric(RNScalar *q, RNScalar a, RNScalar b, RNScalar c, RNScalar d, RNScalar weight)
+{
+  // Add weighted quadric of squared distance to plane ax + by + cz + d = 0
+  q[0] += weight*a*a; q[1] += weight*a*b; q[2] += weight*a*c; q[3] += weight*a*d;
+  q[4] += weight*b*b; q[5] += weight*b*c; q[6] += weight*b*d;
+  q[7] += weight*c*c; q[8] += weight*c*d;
+  q[9] += weight*d*d;
+}
+
+
+
+static RNScalar
+QuadricError(const RNScalar *q, const R3Point& p)
+{
+  // Return value of quadric at point
+  RNScalar x = p.X(), y = p.Y(), z = p.Z();
+  return q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x
+    + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y
+    + q[7]*z*z + 2*q[8]*z
+    + q[9];
+}
+
+
+
+static void
+UpdateDecimationEdge(R3Mesh *mesh, R3MeshDecimationEdge *record)
+{
+  // Get vertices and their quadrics
+  R3MeshEdge *edge = record->edge;
+  R3MeshVertex *v0 = mesh->VertexOnEdge(edge, 0);
+  R3MeshVertex *v1 = mesh->VertexOnEdge(edge, 1);
+  const RNScalar *q0 = ((R3MeshDecimationVertex *) mesh->VertexData(v0))->quadric;
+  const RNScalar *q1 = ((R3MeshDecimationVertex *) mesh->VertexData(v1))->quadric;
+  RNScalar q[10];
+  for (int i = 0; i < 10; i++) q[i] = q0[i] + q1[i];
+
+  // Find point minimizing quadric (solve 3x3 system with Cramer's rule)
+  const R3Point& p0 = mesh->VertexPosition(v0);
+  const R3Point& p1 = mesh->VertexPosition(v1);
+  RNScalar det = q[0]*(q[4]*q[7] - q[5]*q[5]) - q[1]*(q[1]*q[7] - q[5]*q[2]) + q[2]*(q[1]*q[5] - q[4]*q[2]);
+  RNScalar scale = q[0]*q[4]*q[7];
+  if ((scale > 0) && (fabs(det) > 1E-6 * scale)) {
+    RNScalar bx = -q[3], by = -q[6], bz = -q[8];
+    RNScalar x = (bx*(q[4]*q[7] - q[5]*q[5]) - q[1]*(by*q[7] - q[5]*bz) + q[2]*(by*q[5] - q[4]*bz)) / det;
+    RNScalar y = (q[0]*(by*q[7] - q[5]*bz) - bx*(q[1]*q[7] - q[5]*q[2]) + q[2]*(q[1]*bz - by*q[2])) / det;
+    RNScalar z = (q[0]*(q[4]*bz - by*q[5]) - q[1]*(q[1]*bz - by*q[2]) + bx*(q[1]*q[5] - q[4]*q[2])) / det;
+    record->point.Reset(x, y, z);
+
+    // Do not let point stray far from edge (happens for nearly singular quadrics)
+    RNLength length = R3Distance(p0, p1);
+    R3Point midpoint = 0.5 * (p0 + p1);
+    if (R3Distance(record->point, midpoint) > length) record->point = midpoint;
+    record->error = QuadricError(q, record->point);
+  }
+  else {
+    // Choose best of endpoints and midpoint
+    R3Point candidates[3] = { p0, p1, 0.5 * (p0 + p1) };
+    record->error = FLT_MAX;
+    for (int i = 0; i < 3; i++) {
+      RNScalar error = QuadricError(q, candidates[i]);
+      if (error < record->error) { record->error = error; record->point = candidates[i]; }
+    }
+  }
+
+  // Clamp roundoff
+  if (record->error < 0) record->error = 0;
+}
+
+
+
+static void
+ComputeDecimationFacePlane(int face_index, int, void *data)
+{
+  // Update cached plane of face (so that it can be read by several threads later)
+  R3MeshDecimationData *decimation_data = (R3MeshDecimationData *) data;
+  R3Mesh *mesh = decimation_data->mesh;
+  mesh->FacePlane(mesh->Face(face_index));
+}
+
+
+
+static void
+ComputeDecimationVertexQuadric(int vertex_index, int, void *data)
+{
+  // Get vertex record
+  R3MeshDecimationData *decimation_data = (R3MeshDecimationData *) data;
+  R3Mesh *mesh = decimation_data->mesh;
+  R3MeshVertex *vertex = mesh->Vertex(vertex_index);
+  R3MeshDecimationVertex *record = &decimation_data->vertex_records[vertex_index];
+  for (int i = 0; i < 10; i++) record->quadric[i] = 0;
+
+  // Add planes of adjacent faces (each face is found through two edges)
+  const R3Point& position = mesh->VertexPosition(vertex);
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+    for (int j = 0; j < 2; j++) {
+      R3MeshFace *face = mesh->FaceOnEdge(edge, j);
+      if (!face) continue;
+      const R3Plane& plane = mesh->FacePlane(face);
+      AddPlaneQuadric(record->quadric, plane.A(), plane.B(), plane.C(), plane.D(), 0.5);
+    }
+
+    // Add plane perpendicular to face along boundary edges (to preserve boundaries)
+    if (mesh->IsEdgeOnBoundary(edge)) {
+      R3MeshFace *face = (mesh->FaceOnEdge(edge, 0)) ? mesh->FaceOnEdge(edge, 0) : mesh->FaceOnEdge(edge, 1);
+      if (!face) continue;
+      R3Vector direction = mesh->EdgeDirection(edge);
+      R3Vector normal = direction % mesh->FaceNormal(face);
+      if (normal.Length() == 0) continue;
+      normal.Normalize();
+      RNScalar d = -normal.Dot(position.Vector());
+      AddPlaneQuadric(record->quadric, normal.X(), normal.Y(), normal.Z(), d, 1000.0);
+    }
+  }
+}
+
+
+
+static void
+ComputeDecimationEdgeError(int edge_index, int, void *data)
+{
+  // Compute collapse point and error of edge
+  R3MeshDecimationData *decimation_data = (R3MeshDecimationData *) data;
+  UpdateDecimationEdge(decimation_data->mesh, &decimation_data->edge_records[edge_index]);
+}
+
+
+
+static RNBoolean
+IsDecimationCollapseValid(R3Mesh *mesh, R3MeshEdge *edge, const R3Point& point)
+{
+  // Do not pinch mesh between two boundaries
+  R3MeshVertex *v0 = mesh->VertexOnEdge(edge, 0);
+  R3MeshVertex *v1 = mesh->VertexOnEdge(edge, 1);
+  if (!mesh->IsEdgeOnBoundary(edge) && mesh->IsVertexOnBoundary(v0) && mesh->IsVertexOnBoundary(v1)) return FALSE;
+
+  // Check that no remaining face flips or becomes degenerate
+  R3MeshFace *f0 = mesh->FaceOnEdge(edge, 0);
+  R3MeshFace *f1 = mesh->FaceOnEdge(edge, 1);
+  for (int k = 0; k < 2; k++) {
+    R3MeshVertex *vertex = (k == 0) ? v0 : v1;
+    for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+      R3MeshEdge *e = mesh->EdgeOnVertex(vertex, i);
+      for (int j = 0; j < 2; j++) {
+        R3MeshFace *face = mesh->FaceOnEdge(e, j);
+        if (!face || (face == f0) || (face == f1)) continue;
+        R3Point p[3];
+        for (int m = 0; m < 3; m++) {
+          R3MeshVertex *v = mesh->VertexOnFace(face, m);
+          p[m] = ((v == v0) || (v == v1)) ? point : mesh->VertexPosition(v);
+        }
+        R3Vector normal = (p[1] - p[0]) % (p[2] - p[0]);
+        RNLength length = normal.Length();
+        if (length == 0) return FALSE;
+        if (normal.Dot(mesh->FaceNormal(face)) < 0.2 * length) return FALSE;
+      }
+    }
+  }
+
+  // Passed all tests
+  return TRUE;
+}
+
+
+
+void R3Mesh::
+Decimate(int max_faces, RNLength max_error)
+{
+  // Check mesh
+  if (NFaces() <= max_faces) return;
+  int nvertices = NVertices();
+  int nedges = NEdges();
+  RNScalar max_quadric_error = (max_error < RN_INFINITY) ? max_error * max_error : RN_INFINITY;
+
+  // Allocate records (stored in data pointers during decimation)
+  std::vector<R3MeshDecimationVertex> vertex_records(nvertices);
+  std::vector<R3MeshDecimationEdge> edge_records(nedges);
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = Vertex(i);
+    vertex_records[i].data = VertexData(vertex);
+    SetVertexData(vertex, &vertex_records[i]);
+  }
+  for (int i = 0; i < nedges; i++) {
+    R3MeshEdge *edge = Edge(i);
+    edge_records[i].edge = edge;
+    edge_records[i].heappointer = NULL;
+    edge_records[i].data = EdgeData(edge);
+    SetEdgeData(edge, &edge_records[i]);
+  }
+
+  // Compute quadrics and edge errors in parallel
+  R3MeshDecimationData decimation_data;
+  decimation_data.mesh = this;
+  decimation_data.vertex_records = (nvertices > 0) ? &vertex_records[0] : NULL;
+  decimation_data.edge_records = (nedges > 0) ? &edge_records[0] : NULL;
+  RNParallelFor(NFaces(), ComputeDecimationFacePlane, &decimation_data, 4096);
+  RNParallelFor(nvertices, ComputeDecimationVertexQuadric, &decimation_data, 4096);
+  RNParallelFor(nedges, ComputeDecimationEdgeError, &decimation_data, 4096);
+
+  // Create priority queue of edges
+  R3MeshDecimationEdge tmp;
+  RNHeap<R3MeshDecimationEdge *> heap(&tmp, &(tmp.error), &(tmp.heappointer));
+  for (int i = 0; i < nedges; i++) heap.Push(&edge_records[i]);
+
+  // Collapse edges in order of increasing error
+  while (!heap.IsEmpty() && (NFaces() > max_faces)) {
+    R3MeshDecimationEdge *record = heap.Pop();
+    if (record->error > max_quadric_error) break;
+    R3MeshEdge *edge = record->edge;
+
+    // Check collapse (rejected edges are reconsidered when neighbors change)
+    if (!IsDecimationCollapseValid(this, edge, record->point)) continue;
+
+    // Remove edges to be deleted from queue (e01, e11)
+    R3MeshVertex *v0 = VertexOnEdge(edge, 0);
+    R3MeshVertex *v1 = VertexOnEdge(edge, 1);
+    R3MeshFace *f0 = FaceOnEdge(edge, 0);
+    R3MeshFace *f1 = FaceOnEdge(edge, 1);
+    R3MeshEdge *e01 = (f0) ? EdgeAcrossVertex(v1, edge, f0) : NULL;
+    R3MeshEdge *e11 = (f1) ? EdgeAcrossVertex(v1, edge, f1) : NULL;
+    R3MeshDecimationEdge *r01 = (e01) ? (R3MeshDecimationEdge *) EdgeData(e01) : NULL;
+    R3MeshDecimationEdge *r11 = (e11) ? (R3MeshDecimationEdge *) EdgeData(e11) : NULL;
+    RNBoolean r01_queued = (r01 && r01->heappointer);
+    RNBoolean r11_queued = (r11 && r11->heappointer);
+    if (r01_queued) heap.Remove(r01);
+    if (r11_queued) heap.Remove(r11);
+
+    // Remember quadric and value (e.g., feature index) of nearest vertex
+    R3MeshDecimationVertex *vr0 = (R3MeshDecimationVertex *) VertexData(v0);
+    R3MeshDecimationVertex *vr1 = (R3MeshDecimationVertex *) VertexData(v1);
+    RNScalar d0 = R3SquaredDistance(record->point, VertexPosition(v0));
+    RNScalar d1 = R3SquaredDistance(record->point, VertexPosition(v1));
+    RNScalar value = (d1 < d0) ? VertexValue(v1) : VertexValue(v0);
+
+    // Collapse edge
+    R3MeshVertex *vertex = CollapseEdge(edge, record->point);
+    if (!vertex) {
+      if (r01_queued) heap.Push(r01);
+      if (r11_queued) heap.Push(r11);
+      continue;
+    }
+
+    // Update vertex
+    assert(vertex == v0);
+    for (int i = 0; i < 10; i++) vr0->quadric[i] += vr1->quadric[i];
+    SetVertexValue(vertex, value);
+
+    // Update adjacent edges
+    for (int i = 0; i < VertexValence(vertex); i++) {
+      R3MeshDecimationEdge *r = (R3MeshDecimationEdge *) EdgeData(EdgeOnVertex(vertex, i));
+      UpdateDecimationEdge(this, r);
+      if (r->heappointer) heap.Update(r);
+      else heap.Push(r);
+    }
+  }
+
+  // Restore data pointers
+  for (int i = 0; i < NVertices(); i++) {
+    R3MeshVertex *vertex = Vertex(i);
+    SetVertexData(vertex, ((R3MeshDecimationVertex *) VertexData(vertex))->data);
+  }
+  for (int i = 0; i < NEdges(); i++) {
+    R3MeshEdge *edge = Edge(i);
+    SetEdgeData(edge, ((R3MeshDecimationEdge *) EdgeData(edge))->data);
+  }
+}
+
+
+
 void R3Mesh::
 SubdivideLongEdges(RNLength max_edge_length)
 {
@@ -5389,9 +5916,9 @@ ReadObjFile(const char *filename)
   RNArray<R2Point *> texture_coords;
   RNArray<R3Vector *> normals;
   RNArray<R3MeshVertex *> verts;
-  RNArray<R3MeshVertex *> degenerate_triangle_vertices;
-  std::vector<int> degenerate_triangle_materials;
-  std::vector<int> degenerate_triangle_segments;
+  std::vector<int> triangle_vertex_ids;
+  std::vector<int> triangle_materials;
+  std::vector<int> triangle_segments;
   while (fgets(buffer, 1023, fp)) {
     // Increment line counter
     line_count++;
@@ -5494,21 +6021,11 @@ ReadObjFile(const char *filename)
       if (RNIsPositive(R3Distance(VertexPosition(v[0]), VertexPosition(v[1]))) &&
           RNIsPositive(R3Distance(VertexPosition(v[1]), VertexPosition(v[2]))) &&
           RNIsPositive(R3Distance(VertexPosition(v[2]), VertexPosition(v[0])))) {
-        R3MeshFace *face = CreateFace(v[0], v[1], v[2]);
-        if (face) {
-          // Set segment and face
-          SetFaceSegment(face, segment_index);
-          SetFaceMaterial(face, material_index);
-        }
-        else {
-          // Must have been degeneracy (e.g., flips or three faces sharing an edge)
-          // Remember for later processing (to preserve vertex indices)
-          degenerate_triangle_vertices.Insert(v[0]);
-          degenerate_triangle_vertices.Insert(v[1]);
-          degenerate_triangle_vertices.Insert(v[2]);
-          degenerate_triangle_materials.push_back(material_index);
-          degenerate_triangle_segments.push_back(segment_index);
-        }
+        triangle_vertex_ids.push_back(VertexID(v[0]));
+        triangle_vertex_ids.push_back(VertexID(v[1]));
+        triangle_vertex_ids.push_back(VertexID(v[2]));
+        triangle_materials.push_back(material_index);
+        triangle_segments.push_back(segment_index);
       }
 
       // Create second triangle
@@ -5516,21 +6033,11 @@ ReadObjFile(const char *filename)
         if (RNIsPositive(R3Distance(VertexPosition(v[0]), VertexPosition(v[2]))) &&
             RNIsPositive(R3Distance(VertexPosition(v[2]), VertexPosition(v[3]))) &&
             RNIsPositive(R3Distance(VertexPosition(v[0]), VertexPosition(v[3])))) {
-          R3MeshFace *face = CreateFace(v[0], v[2], v[3]);
-          if (face) {
-            // Set segment and face
-            SetFaceSegment(face, segment_index);
-            SetFaceMaterial(face, material_index);
-          }
-          else {
-            // Must have been degeneracy (e.g., flips or three faces sharing an edge)
-            // Remember for later processing (to preserve vertex indices)
-            degenerate_triangle_vertices.Insert(v[0]);
-            degenerate_triangle_vertices.Insert(v[2]);
-            degenerate_triangle_vertices.Insert(v[3]);
-            degenerate_triangle_materials.push_back(material_index);
-            degenerate_triangle_segments.push_back(segment_index);
-          }
+          triangle_vertex_ids.push_back(VertexID(v[0]));
+          triangle_vertex_ids.push_back(VertexID(v[2]));
+          triangle_vertex_ids.push_back(VertexID(v[3]));
+          triangle_materials.push_back(material_index);
+          triangle_segments.push_back(segment_index);
         }
       }
     }
@@ -5560,32 +6067,16 @@ ReadObjFile(const char *filename)
     }
   }
 
-  // Create degenerate triangles
-  for (int i = 0; i <= degenerate_triangle_vertices.NEntries()-3; i+=3) {
-    // Get vertices
-    R3MeshVertex *v1 = degenerate_triangle_vertices.Kth(i+0);
-    R3MeshVertex *v2 = degenerate_triangle_vertices.Kth(i+1);
-    R3MeshVertex *v3 = degenerate_triangle_vertices.Kth(i+2);
-
-    // Create face
-    R3MeshFace *face = CreateFace(v1, v2, v3);
-    if (!face) {
-      face = CreateFace(v1, v3, v2);
-      if (!face) {
-        // Note: these vertices are allocated separately, and so they will not be deleted (memory leak)
-        R3MeshVertex *v1a = CreateVertex(VertexPosition(v1));
-        R3MeshVertex *v2a = CreateVertex(VertexPosition(v2));
-        R3MeshVertex *v3a = CreateVertex(VertexPosition(v3));
-        face = CreateFace(v1a, v2a, v3a);
-      }
-    }
-
-    // Set material and segment
-    if (face) {
-      if ((int) degenerate_triangle_materials.size() > i/3) 
-        SetFaceMaterial(face, degenerate_triangle_materials[i/3]);
-      if ((int) degenerate_triangle_segments.size() > i/3) 
-        SetFaceSegment(face, degenerate_triangle_segments[i/3]);
+  // Create faces
+  int ntriangles = (int) triangle_materials.size();
+  if (ntriangles > 0) {
+    std::vector<R3MeshFace *> created_faces(ntriangles);
+    CreateFaces(ntriangles, &triangle_vertex_ids[0], &created_faces[0]);
+    for (int i = 0; i < ntriangles; i++) {
+      R3MeshFace *face = created_faces[i];
+      if (!face) continue;
+      SetFaceSegment(face, triangle_segments[i]);
+      SetFaceMaterial(face, triangle_materials[i]);
     }
   }
 
@@ -5617,7 +6108,8 @@ ReadOffFile(const char *filename)
   int face_count = 0;
   char buffer[1024];
   char header[64];
-  RNArray<R3MeshVertex *> degenerate_triangle_vertices;
+  std::vector<double> positions;
+  std::vector<int> face_vertex_ids;
   while (fgets(buffer, 1023, fp)) {
     // Increment line counter
     line_count++;
@@ -5658,8 +6150,10 @@ ReadOffFile(const char *filename)
         return 0;
       }
 
-      // Create vertex
-      CreateVertex(R3Point(x, y, z));
+      // Remember vertex
+      positions.push_back(x);
+      positions.push_back(y);
+      positions.push_back(z);
 
       // Increment counter
       vertex_count++;
@@ -5676,14 +6170,14 @@ ReadOffFile(const char *filename)
       }
 
       // Read vertex indices for face
-      R3MeshVertex *v1 = NULL;
-      R3MeshVertex *v2 = NULL;
-      R3MeshVertex *v3 = NULL;
+      int v1 = -1;
+      int v2 = -1;
+      int v3 = -1;
       for (int i = 0; i < face_nverts; i++) {
         bufferp = strtok(NULL, " \t");
         if (bufferp) {
-          R3MeshVertex *v = Vertex(atoi(bufferp));
-          if (!v1) v1 = v;
+          int v = atoi(bufferp);
+          if (v1 < 0) v1 = v;
           else v3 = v;
         }
         else {
@@ -5692,15 +6186,11 @@ ReadOffFile(const char *filename)
           return 0;
         }
 
-        // Create triangle
-        if (v1 && v2 && v3 && (v1 != v2) && (v2 != v3) && (v1 != v3)) {
-          if (!CreateFace(v1, v2, v3)) {
-            // Must have been degeneracy (e.g., flips or three faces sharing an edge)
-            // Remember for later processing (to preserve vertex indices)
-            degenerate_triangle_vertices.Insert(v1);
-            degenerate_triangle_vertices.Insert(v2);
-            degenerate_triangle_vertices.Insert(v3);
-          }
+        // Remember triangle
+        if ((v1 >= 0) && (v2 >= 0) && (v3 >= 0)) {
+          face_vertex_ids.push_back(v1);
+          face_vertex_ids.push_back(v2);
+          face_vertex_ids.push_back(v3);
         }
 
         // Move to next triangle
@@ -5717,21 +6207,12 @@ ReadOffFile(const char *filename)
     }
   }
 
-  // Create degenerate triangles
-  for (int i = 0; i <= degenerate_triangle_vertices.NEntries()-3; i+=3) {
-    R3MeshVertex *v1 = degenerate_triangle_vertices.Kth(i+0);
-    R3MeshVertex *v2 = degenerate_triangle_vertices.Kth(i+1);
-    R3MeshVertex *v3 = degenerate_triangle_vertices.Kth(i+2);
-    if (!CreateFace(v1, v2, v3)) {
-      if (!CreateFace(v1, v3, v2)) {
-        // Note: these vertices are allocated separately, and so they will not be deleted (memory leak)
-        R3MeshVertex *v1a = CreateVertex(VertexPosition(v1));
-        R3MeshVertex *v2a = CreateVertex(VertexPosition(v2));
-        R3MeshVertex *v3a = CreateVertex(VertexPosition(v3));
-        CreateFace(v1a, v2a, v3a);
-      }
-    }
-  }
+  // Create vertices and faces
+  int nvertices = (int) (positions.size() / 3);
+  int first_vertex_id = CreateVertices(nvertices, (nvertices > 0) ? &positions[0] : NULL);
+  int ntriangles = (int) (face_vertex_ids.size() / 3);
+  for (int i = 0; i < 3 * ntriangles; i++) face_vertex_ids[i] += first_vertex_id;
+  if (ntriangles > 0) CreateFaces(ntriangles, &face_vertex_ids[0]);
 
   // Close file
   fclose(fp);
@@ -5961,6 +6442,54 @@ ReadPlyStream(FILE *fp)
     {(char *) "vertex_indices", PLY_INT, PLY_INT, offsetof(PlyFace,verts), 1, PLY_UCHAR, PLY_UCHAR, offsetof(PlyFace,nverts)},
   };
 
+  // Read binary files with fast codec
+  R3PlyMesh ply_mesh;
+  int status = R3ReadBinaryPlyMesh(fp, &ply_mesh);
+  if (status == 0) {
+    fclose(fp);
+    return 0;
+  }
+  if (status > 0) {
+    // Create vertices
+    int nvertices = ply_mesh.NVertices();
+    int first_vertex_id = CreateVertices(nvertices, (nvertices > 0) ? &ply_mesh.positions[0] : NULL);
+    for (j = 0; j < nvertices; j++) {
+      R3MeshVertex *v = vertices[first_vertex_id + j];
+      if (!ply_mesh.normals.empty()) {
+        const float *n = &ply_mesh.normals[3*j];
+        SetVertexNormal(v, R3Vector(n[0], n[1], n[2]));
+      }
+      if (!ply_mesh.texcoords.empty()) {
+        const float *t = &ply_mesh.texcoords[2*j];
+        SetVertexTextureCoords(v, R2Point(t[0], t[1]));
+      }
+      if (!ply_mesh.colors.empty()) {
+        const unsigned char *c = &ply_mesh.colors[3*j];
+        SetVertexColor(v, RNRgb(c[0]/255.0, c[1]/255.0, c[2]/255.0));
+      }
+    }
+
+    // Create faces
+    int nfaces = ply_mesh.NFaces();
+    if (nfaces > 0) {
+      std::vector<R3MeshFace *> created_faces(nfaces);
+      if (first_vertex_id > 0) {
+        for (j = 0; j < 3 * nfaces; j++) ply_mesh.indices[j] += first_vertex_id;
+      }
+      CreateFaces(nfaces, &ply_mesh.indices[0], &created_faces[0]);
+      for (j = 0; j < nfaces; j++) {
+        R3MeshFace *face = created_faces[j];
+        if (!face) continue;
+        if (!ply_mesh.materials.empty()) SetFaceMaterial(face, ply_mesh.materials[j]);
+        if (!ply_mesh.segments.empty()) SetFaceSegment(face, ply_mesh.segments[j]);
+        if (!ply_mesh.categories.empty()) SetFaceCategory(face, ply_mesh.categories[j]);
+      }
+    }
+
+    // Return success
+    return 1;
+  }
+
   // Read PLY header
   ply = ply_read (fp, &nelems, &elist);
   if (!ply) {
@@ -6043,12 +6572,12 @@ ReadPlyStream(FILE *fp)
 	else if (equal_strings("category_id", plist[j]->name)) ply_get_property (ply, elem_name, &face_props[4]);
       }
 
-      // Create stuff for degenerate triangles
-      RNArray<R3MeshVertex *> degenerate_triangle_vertices;
-      int *degenerate_triangle_materials = new int [ num_elems ];
-      int *degenerate_triangle_segments = new int [ num_elems ];
-      int *degenerate_triangle_categories = new int [ num_elems ];
-      int num_degenerate_triangles = 0;
+      // Allocate arrays of triangles
+      std::vector<int> triangle_vertex_ids;
+      std::vector<int> triangle_materials;
+      std::vector<int> triangle_segments;
+      std::vector<int> triangle_categories;
+      triangle_vertex_ids.reserve(3 * num_elems);
 
       // grab all the face elements 
       for (j = 0; j < num_elems; j++) {
@@ -6061,13 +6590,8 @@ ReadPlyStream(FILE *fp)
         plyface.category = -1;
         ply_get_element(ply, (void *) &plyface);
 
-        // Create mesh face(s)
-        R3MeshVertex *v1 = vertices[plyface.verts[0]];
+        // Split face into triangles
         for (int k = 2; k < plyface.nverts; k++) {
-          // Get vertices
-          R3MeshVertex *v2 = vertices[plyface.verts[k-1]];
-          R3MeshVertex *v3 = vertices[plyface.verts[k]];
-
           // Check plyface
           assert(plyface.verts[0] >= 0);
           assert(plyface.verts[k-1] >= 0);
@@ -6076,61 +6600,32 @@ ReadPlyStream(FILE *fp)
           assert(plyface.verts[k-1] < vertices.NEntries());
           assert(plyface.verts[k] < vertices.NEntries());
 
-          // Check vertices
-          if ((v1 == v2) || (v2 == v3) || (v1 == v3)) continue;
-
-          // Create face
-          R3MeshFace *f = CreateFace(v1, v2, v3);
-          if (f) {
-            // Set material/segment/category
-            SetFaceMaterial(f, plyface.material);
-            SetFaceSegment(f, plyface.segment);
-            SetFaceCategory(f, plyface.category);
-          }
-          else {
-            // Must have been degeneracy (e.g., three faces sharing an edge)
-            // Remember for later processing (to preserve vertex indices)
-            degenerate_triangle_vertices.Insert(v1);
-            degenerate_triangle_vertices.Insert(v2);
-            degenerate_triangle_vertices.Insert(v3);
-            degenerate_triangle_materials[num_degenerate_triangles] = plyface.material;
-            degenerate_triangle_segments[num_degenerate_triangles] = plyface.segment;
-            degenerate_triangle_categories[num_degenerate_triangles] = plyface.category;
-            num_degenerate_triangles++;
-          }
+          // Remember triangle
+          triangle_vertex_ids.push_back(plyface.verts[0]);
+          triangle_vertex_ids.push_back(plyface.verts[k-1]);
+          triangle_vertex_ids.push_back(plyface.verts[k]);
+          triangle_materials.push_back(plyface.material);
+          triangle_segments.push_back(plyface.segment);
+          triangle_categories.push_back(plyface.category);
         }
 
         // Free face data allocated by ply
         if (plyface.verts) free(plyface.verts);
       }
-      
-      // Create degenerate triangles (do this at end to preserve face ordering)
-      for (int i = 0; i < num_degenerate_triangles; i++) {
-        R3MeshVertex *v1 = degenerate_triangle_vertices.Kth(3*i + 0);
-        R3MeshVertex *v2 = degenerate_triangle_vertices.Kth(3*i + 1);
-        R3MeshVertex *v3 = degenerate_triangle_vertices.Kth(3*i + 2);
-        R3MeshFace *f = CreateFace(v1, v2, v3);
-        if (!f) {
-          f = CreateFace(v1, v3, v2);
-          if (!f) {
-            // Note: these vertices are allocated separately, and so they will not be deleted (memory leak)
-            R3MeshVertex *v1a = CreateVertex(VertexPosition(v1));
-            R3MeshVertex *v2a = CreateVertex(VertexPosition(v2));
-            R3MeshVertex *v3a = CreateVertex(VertexPosition(v3));
-            f = CreateFace(v1a, v2a, v3a);
-          }
-        }
-        if (f) {
-          SetFaceMaterial(f, degenerate_triangle_materials[i]);
-          SetFaceSegment(f, degenerate_triangle_segments[i]);
-          SetFaceCategory(f, degenerate_triangle_categories[i]);
+
+      // Create mesh faces
+      int ntriangles = (int) triangle_materials.size();
+      if (ntriangles > 0) {
+        std::vector<R3MeshFace *> created_faces(ntriangles);
+        CreateFaces(ntriangles, &triangle_vertex_ids[0], &created_faces[0]);
+        for (int k = 0; k < ntriangles; k++) {
+          R3MeshFace *f = created_faces[k];
+          if (!f) continue;
+          SetFaceMaterial(f, triangle_materials[k]);
+          SetFaceSegment(f, triangle_segments[k]);
+          SetFaceCategory(f, triangle_categories[k]);
         }
       }
-
-      // Delete memory for degenerate triangles
-      delete [] degenerate_triangle_materials;
-      delete [] degenerate_triangle_segments;
-      delete [] degenerate_triangle_categories;
     }
     else if (equal_strings ("range_grid", elem_name)) {
       // Get num_cols and num_rows for range_grid
@@ -6548,27 +7043,16 @@ ReadIfsFile(const char *filename)
     return 0;
   }
 
-  // Allocate block of vertices
-  vertex_block = new R3MeshVertex [nverts];
-  
-  // Resize array of vertices
-  vertices.Resize(nverts);
-
   // Read vertices
-  for (unsigned int i = 0; i < nverts; i++) {
-    float p[3];
-    if (fread(p, sizeof(float), 3, fp) != 3) {
-      RNFail("Unable to read vertex %d in %s", i, filename);
-      return 0;
-    }
-
-    // Create mesh vertex
-    if (!CreateVertex(R3Point(p[0], p[1], p[2]), &vertex_block[i])) {
-      RNFail("Unable to create vertex %d in %s", i, filename);
-      return 0;
-    }
+  std::vector<float> positions(3 * nverts);
+  if ((nverts > 0) && (fread(&positions[0], sizeof(float), 3 * nverts, fp) != 3 * nverts)) {
+    RNFail("Unable to read vertices in %s", filename);
+    return 0;
   }
 
+  // Create mesh vertices
+  int first_vertex_id = CreateVertices(nverts, (nverts > 0) ? &positions[0] : NULL);
+
   // Read triangle header
   if (ReadIfsString(fp, buffer, 1024) < 0) {
     RNFail("Unable to read vertex header of %s", filename);
@@ -6586,56 +7070,16 @@ ReadIfsFile(const char *filename)
     return 0;
   }
 
-  // Allocate block of faces
-  face_block = new R3MeshFace [nfaces];
-
-  // Resize array of faces
-  faces.Resize(nfaces);
-
-  // Allocate array for degenerate triangles
-  RNArray<R3MeshVertex *> degenerate_triangle_vertices;
-
   // Read triangles
-  for (unsigned int i = 0; i < nfaces; i++) {
-    int v[3];
-    if (fread(v, sizeof(unsigned int), 3, fp) != 3) {
-      RNFail("Unable to read vertex index in triangle %d of %s", i, filename);
-      return 0;
-    }
-
-    // Get vertices
-    R3MeshVertex *v0 = vertices[v[0]];
-    R3MeshVertex *v1 = vertices[v[1]];
-    R3MeshVertex *v2 = vertices[v[2]];
-
-    // Check vertices
-    if ((v0 == v1) || (v1 == v2) || (v0 == v2)) continue;
-
-    // Create mesh face
-    if (!CreateFace(v0, v1, v2, &face_block[i])) {
-      // Must have been degeneracy (e.g., flips or three faces sharing an edge)
-      // Remember for later processing (to preserve vertex indices)
-      degenerate_triangle_vertices.Insert(v0);
-      degenerate_triangle_vertices.Insert(v1);
-      degenerate_triangle_vertices.Insert(v2);
-    }
+  std::vector<int> face_vertex_ids(3 * nfaces);
+  if ((nfaces > 0) && (fread(&face_vertex_ids[0], sizeof(int), 3 * nfaces, fp) != 3 * nfaces)) {
+    RNFail("Unable to read triangles in %s", filename);
+    return 0;
   }
 
-  // Create degenerate triangles
-  for (int i = 0; i <= degenerate_triangle_vertices.NEntries()-3; i+=3) {
-    R3MeshVertex *v1 = degenerate_triangle_vertices.Kth(i+0);
-    R3MeshVertex *v2 = degenerate_triangle_vertices.Kth(i+1);
-    R3MeshVertex *v3 = degenerate_triangle_vertices.Kth(i+2);
-    if (!CreateFace(v1, v2, v3)) {
-      if (!CreateFace(v1, v3, v2)) {
-        // Note: these vertices are allocated separately, and so they will not be deleted (memory leak)
-        R3MeshVertex *v1a = CreateVertex(VertexPosition(v1));
-        R3MeshVertex *v2a = CreateVertex(VertexPosition(v2));
-        R3MeshVertex *v3a = CreateVertex(VertexPosition(v3));
-        CreateFace(v1a, v2a, v3a);
-      }
-    }
-  }
+  // Create mesh faces
+  for (unsigned int i = 0; i < 3 * nfaces; i++) face_vertex_ids[i] += first_vertex_id;
+  if (nfaces > 0) CreateFaces(nfaces, &face_vertex_ids[0]);
 
   // Close file
   fclose(fp);
@@ -6965,6 +7409,68 @@ WritePlyStream(FILE *fp, RNBoolean binary)  const
     int category;
   } PlyFace;
 
+  // Write binary files with fast codec
+  if (binary) {
+    // Gather info about what to write
+    RNBoolean has_vertex_normals = FALSE;
+    RNBoolean has_vertex_texcoords = FALSE;
+    RNBoolean has_vertex_colors = FALSE;
+    for (int i = 0; i < NVertices(); i++) {
+      R3MeshVertex *v = Vertex(i);
+      if (v->flags[R3_MESH_VERTEX_NORMAL_UPTODATE]) has_vertex_normals = TRUE;
+      if (!v->texcoords.IsZero()) has_vertex_texcoords = TRUE;
+      if (!v->color.IsBlack()) has_vertex_colors = TRUE;
+    }
+
+    RNBoolean has_face_materials = FALSE;
+    RNBoolean has_face_segments = FALSE;
+    RNBoolean has_face_categories = FALSE;
+    for (int i = 0; i < NFaces(); i++) {
+      R3MeshFace *f = Face(i);
+      if (f->material != -1) has_face_materials = TRUE;
+      if (f->segment != -1) has_face_segments = TRUE;
+      if (f->category != -1) has_face_categories = TRUE;
+    }
+
+    // Fill vertex arrays
+    R3PlyMesh ply_mesh;
+    ply_mesh.positions.resize(3 * NVertices());
+    if (has_vertex_normals) ply_mesh.normals.resize(3 * NVertices());
+    if (has_vertex_texcoords) ply_mesh.texcoords.resize(2 * NVertices());
+    if (has_vertex_colors) ply_mesh.colors.resize(3 * NVertices());
+    for (int i = 0; i < NVertices(); i++) {
+      R3MeshVertex *v = Vertex(i);
+      for (int k = 0; k < 3; k++) ply_mesh.positions[3*i+k] = v->position[k];
+      if (has_vertex_normals) {
+        const R3Vector& n = VertexNormal(v);
+        for (int k = 0; k < 3; k++) ply_mesh.normals[3*i+k] = n[k];
+      }
+      if (has_vertex_texcoords) {
+        ply_mesh.texcoords[2*i+0] = v->texcoords.X();
+        ply_mesh.texcoords[2*i+1] = v->texcoords.Y();
+      }
+      if (has_vertex_colors) {
+        for (int k = 0; k < 3; k++) ply_mesh.colors[3*i+k] = (unsigned char) (255.0 * v->color[k]);
+      }
+    }
+
+    // Fill face arrays
+    ply_mesh.indices.resize(3 * NFaces());
+    if (has_face_materials) ply_mesh.materials.resize(NFaces());
+    if (has_face_segments) ply_mesh.segments.resize(NFaces());
+    if (has_face_categories) ply_mesh.categories.resize(NFaces());
+    for (int i = 0; i < NFaces(); i++) {
+      R3MeshFace *f = Face(i);
+      for (int k = 0; k < 3; k++) ply_mesh.indices[3*i+k] = VertexID(VertexOnFace(f, k));
+      if (has_face_materials) ply_mesh.materials[i] = f->material;
+      if (has_face_segments) ply_mesh.segments[i] = f->segment;
+      if (has_face_categories) ply_mesh.categories[i] = f->category;
+    }
+
+    // Write ply mesh
+    return R3WriteBinaryPlyMesh(fp, ply_mesh);
+  }
+
   // Gather info about what vertex info to write
   RNBoolean has_vertex_normals = FALSE;
   RNBoolean has_vertex_texcoords = FALSE;
@@ -461,6 +461,13 @@ class R3Mesh {
       // Create a face with edges (e1, e2, e3)
     virtual R3MeshFace *CreateFace(R3MeshVertex *v1, R3MeshVertex *v2, R3MeshVertex *v3, R3MeshEdge *e1, R3MeshEdge *e2, R3MeshEdge *e3, R3MeshFace *face = NULL);
       // Create a face with vertices (v1, v2, v3) and edges (e1, e2, e3)
+    int CreateVertices(int nvertices, const float *positions);
+    int CreateVertices(int nvertices, const double *positions);
+      // Create vertices at xyz positions (returns ID of first new vertex)
+    int CreateFaces(int nfaces, const int *vertex_ids, R3MeshFace **created_faces = NULL);
+      // Create faces from triples of vertex IDs, matching edges by sorting rather than searching
+      // (faces with repeated vertices are skipped, faces that would share a side of an edge are created
+      // at the end flipped or with copies of vertices, and created_faces is filled in input order)
     virtual void DeleteVertex(R3MeshVertex *v);
       // Delete a vertex and all edges/faces attached to it
     virtual void DeleteEdge(R3MeshEdge *e);
@@ -502,6 +509,9 @@ class R3Mesh {
       // Splits face into four by subdividing each edge at midpoint (returns middle face)
     void CollapseShortEdges(RNLength min_edge_length);
       // Collapse edges shorter than min_edge_length
+    void Decimate(int max_faces, RNLength max_error = RN_INFINITY);
+      // Collapse edges in order of quadric error until at most max_faces remain or errors exceed max_error
+      // (boundaries are preserved, colors and texture coordinates are interpolated, values come from the nearest vertex)
     void SubdivideLongEdges(RNLength max_edge_length);
       // Subdivide edges longer than max_edge_length
     void FlipFaces(void);
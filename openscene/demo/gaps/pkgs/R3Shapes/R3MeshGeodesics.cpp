@@ -0,0 +1,680 @@
+// Source file for mesh geodesic distance engine
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes.h"
+#include <queue>
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Radix heap
+////////////////////////////////////////////////////////////////////////
+
+// Monotone priority queue keyed by the bits of non-negative floats (which
+// order the same way as the floats), with bucket i holding keys that first
+// differ from the last popped key in bit i-1
+
+struct R3MeshRadixHeap {
+  std::vector< std::pair<unsigned int, int> > buckets[33];
+  unsigned int last_key;
+  int nentries;
+};
+
+
+
+static inline unsigned int
+RadixKey(float value)
+{
+  // Return bits of non-negative float
+  unsigned int key;
+  memcpy(&key, &value, sizeof(key));
+  return key;
+}
+
+
+
+static inline int
+RadixBucket(unsigned int key, unsigned int last_key)
+{
+  // Return index of bucket for key (one plus highest bit differing from last key)
+  unsigned int bits = key ^ last_key;
+  if (bits == 0) return 0;
+#if defined(__GNUC__)
+  return 32 - __builtin_clz(bits);
+#else
+  int bucket = 0;
+  while (bits) { bucket++; bits >>= 1; }
+  return bucket;
+#endif
+}
+
+
+
+static void
+ClearRadixHeap(R3MeshRadixHeap *heap)
+{
+  // Remove all entries
+  for (int i = 0; i < 33; i++) heap->buckets[i].clear();
+  heap->last_key = 0;
+  heap->nentries = 0;
+}
+
+
+
+static inline void
+PushRadixHeap(R3MeshRadixHeap *heap, float value, int vertex_index)
+{
+  // Insert entry (value must not be less than last popped value)
+  unsigned int key = RadixKey(value);
+  assert(key >= heap->last_key);
+  heap->buckets[RadixBucket(key, heap->last_key)].push_back(std::pair<unsigned int, int>(key, vertex_index));
+  heap->nentries++;
+}
+
+
+
+static inline RNBoolean
+PopRadixHeap(R3MeshRadixHeap *heap, unsigned int *key, int *vertex_index)
+{
+  // Check if empty
+  if (heap->nentries == 0) return FALSE;
+
+  // Refill bucket 0 from first non-empty bucket
+  if (heap->buckets[0].empty()) {
+    int b = 1;
+    while (heap->buckets[b].empty()) b++;
+    std::vector< std::pair<unsigned int, int> >& bucket = heap->buckets[b];
+    unsigned int min_key = bucket[0].first;
+    for (unsigned int i = 1; i < bucket.size(); i++) {
+      if (bucket[i].first < min_key) min_key = bucket[i].first;
+    }
+    heap->last_key = min_key;
+    for (unsigned int i = 0; i < bucket.size(); i++) {
+      heap->buckets[RadixBucket(bucket[i].first, min_key)].push_back(bucket[i]);
+    }
+    bucket.clear();
+  }
+
+  // Pop entry with smallest key
+  *key = heap->buckets[0].back().first;
+  *vertex_index = heap->buckets[0].back().second;
+  heap->buckets[0].pop_back();
+  heap->nentries--;
+  return TRUE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Workspace
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshGeodesicsWorkspace {
+  std::vector<float> distances;   // FLT_MAX if not reached
+  std::vector<int> labels;        // index of closest source (-1 if not reached)
+  std::vector<int> stamps;        // propagation in which vertex was last changed
+  std::vector<int> visited;       // vertices changed by last propagation
+  std::vector<int> settled;       // vertices popped by last propagation
+  R3MeshRadixHeap heap;
+  int stamp;
+};
+
+
+
+R3MeshGeodesicsWorkspace *R3MeshGeodesics::
+Workspace(int thread_index) const
+{
+  // Allocate workspace on first use (by the thread that uses it)
+  assert(thread_index < (int) workspaces.size());
+  R3MeshGeodesicsWorkspace *workspace = workspaces[thread_index];
+  if (!workspace) {
+    workspace = new R3MeshGeodesicsWorkspace();
+    workspace->distances.assign(NVertices(), FLT_MAX);
+    workspace->labels.assign(NVertices(), -1);
+    workspace->stamps.assign(NVertices(), 0);
+    ClearRadixHeap(&workspace->heap);
+    workspace->stamp = 0;
+    workspaces[thread_index] = workspace;
+  }
+
+  // Return workspace
+  return workspace;
+}
+
+
+
+void R3MeshGeodesics::
+Reset(R3MeshGeodesicsWorkspace *workspace) const
+{
+  // Reset data of vertices changed by last propagation
+  for (unsigned int i = 0; i < workspace->visited.size(); i++) {
+    int vertex_index = workspace->visited[i];
+    workspace->distances[vertex_index] = FLT_MAX;
+    workspace->labels[vertex_index] = -1;
+  }
+
+  // Empty lists
+  workspace->visited.clear();
+  workspace->settled.clear();
+  ClearRadixHeap(&workspace->heap);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor functions
+////////////////////////////////////////////////////////////////////////
+
+R3MeshGeodesics::
+R3MeshGeodesics(void)
+  : positions(),
+    neighbor_offsets(1, 0),
+    neighbor_indices(),
+    neighbor_lengths(),
+    face_offsets(1, 0),
+    face_corners(),
+    method(R3_MESH_DIJKSTRA_DISTANCES),
+    workspaces()
+{
+}
+
+
+
+R3MeshGeodesics::
+R3MeshGeodesics(const R3Mesh& mesh, int method)
+  : positions(),
+    neighbor_offsets(1, 0),
+    neighbor_indices(),
+    neighbor_lengths(),
+    face_offsets(1, 0),
+    face_corners(),
+    method(method),
+    workspaces()
+{
+  // Build adjacency arrays
+  Build(mesh);
+}
+
+
+
+R3MeshGeodesics::
+~R3MeshGeodesics(void)
+{
+  // Delete workspaces
+  Empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Build functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshGeodesicsBuildData {
+  const R3Mesh *mesh;
+  const int *neighbor_offsets;
+  int *neighbor_indices;
+  float *neighbor_lengths;
+};
+
+
+
+static void
+FillVertexNeighbors(int vertex_index, int, void *data)
+{
+  // Copy neighbors of vertex and lengths of edges to them
+  // (lengths are computed from positions because EdgeLength updates edges lazily)
+  R3MeshGeodesicsBuildData *build = (R3MeshGeodesicsBuildData *) data;
+  const R3Mesh *mesh = build->mesh;
+  R3MeshVertex *vertex = mesh->Vertex(vertex_index);
+  const R3Point& position = mesh->VertexPosition(vertex);
+  int k = build->neighbor_offsets[vertex_index];
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+    R3MeshVertex *neighbor_vertex = mesh->VertexAcrossEdge(edge, vertex);
+    build->neighbor_indices[k] = mesh->VertexID(neighbor_vertex);
+    build->neighbor_lengths[k] = R3Distance(position, mesh->VertexPosition(neighbor_vertex));
+    k++;
+  }
+}
+
+
+
+int R3MeshGeodesics::
+Build(const R3Mesh& mesh)
+{
+  // Remove previous contents
+  Empty();
+
+  // Copy vertex positions
+  int nvertices = mesh.NVertices();
+  positions.resize(3 * nvertices);
+  for (int i = 0; i < nvertices; i++) {
+    const R3Point& position = mesh.VertexPosition(mesh.Vertex(i));
+    positions[3*i+0] = position.X();
+    positions[3*i+1] = position.Y();
+    positions[3*i+2] = position.Z();
+  }
+
+  // Compute offsets of vertex neighbors
+  neighbor_offsets.resize(nvertices + 1);
+  neighbor_offsets[0] = 0;
+  for (int i = 0; i < nvertices; i++) {
+    neighbor_offsets[i+1] = neighbor_offsets[i] + mesh.VertexValence(mesh.Vertex(i));
+  }
+
+  // Fill vertex neighbors in parallel
+  neighbor_indices.resize(neighbor_offsets[nvertices]);
+  neighbor_lengths.resize(neighbor_offsets[nvertices]);
+  if (nvertices > 0) {
+    R3MeshGeodesicsBuildData build;
+    build.mesh = &mesh;
+    build.neighbor_offsets = &neighbor_offsets[0];
+    build.neighbor_indices = (neighbor_indices.empty()) ? NULL : &neighbor_indices[0];
+    build.neighbor_lengths = (neighbor_lengths.empty()) ? NULL : &neighbor_lengths[0];
+    RNParallelFor(nvertices, FillVertexNeighbors, &build, 4096);
+  }
+
+  // Compute offsets of faces on vertices
+  face_offsets.assign(nvertices + 1, 0);
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    for (int k = 0; k < 3; k++) {
+      face_offsets[mesh.VertexID(mesh.VertexOnFace(face, k)) + 1]++;
+    }
+  }
+  for (int i = 0; i < nvertices; i++) {
+    face_offsets[i+1] += face_offsets[i];
+  }
+
+  // Fill the other two corners of each face on each vertex
+  std::vector<int> counts(face_offsets.begin(), face_offsets.end() - 1);
+  face_corners.resize(2 * face_offsets[nvertices]);
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    int ids[3];
+    for (int k = 0; k < 3; k++) ids[k] = mesh.VertexID(mesh.VertexOnFace(face, k));
+    for (int k = 0; k < 3; k++) {
+      int slot = counts[ids[k]]++;
+      face_corners[2*slot+0] = ids[(k+1)%3];
+      face_corners[2*slot+1] = ids[(k+2)%3];
+    }
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+void R3MeshGeodesics::
+SetMethod(int method)
+{
+  // Set method used to compute distances
+  this->method = method;
+}
+
+
+
+void R3MeshGeodesics::
+Empty(void)
+{
+  // Delete workspaces
+  for (unsigned int i = 0; i < workspaces.size(); i++) {
+    if (workspaces[i]) delete workspaces[i];
+  }
+  workspaces.clear();
+
+  // Empty arrays
+  positions.clear();
+  neighbor_offsets.assign(1, 0);
+  neighbor_indices.clear();
+  neighbor_lengths.clear();
+  face_offsets.assign(1, 0);
+  face_corners.clear();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Propagation functions
+////////////////////////////////////////////////////////////////////////
+
+static inline void
+RelaxVertex(R3MeshGeodesicsWorkspace *workspace, int vertex_index,
+  float distance, int label, int replaced_label)
+{
+  // Check if distance improves (vertices closest to a replaced source are always overwritten)
+  if ((distance >= workspace->distances[vertex_index]) &&
+      ((replaced_label < 0) || (workspace->labels[vertex_index] != replaced_label))) return;
+
+  // Update vertex
+  workspace->distances[vertex_index] = distance;
+  workspace->labels[vertex_index] = label;
+  if (workspace->stamps[vertex_index] != workspace->stamp) {
+    workspace->stamps[vertex_index] = workspace->stamp;
+    workspace->visited.push_back(vertex_index);
+  }
+
+  // Insert into heap
+  PushRadixHeap(&workspace->heap, distance, vertex_index);
+}
+
+
+
+static float
+UnfoldedDistance(const float *pa, const float *pb, const float *pc, float da, float db)
+{
+  // Compute edge lengths of triangle
+  double c2 = 0, b2 = 0, a2 = 0;
+  for (int dim = 0; dim < 3; dim++) {
+    c2 += (pb[dim] - pa[dim]) * (pb[dim] - pa[dim]);
+    b2 += (pc[dim] - pa[dim]) * (pc[dim] - pa[dim]);
+    a2 += (pc[dim] - pb[dim]) * (pc[dim] - pb[dim]);
+  }
+  double c = sqrt(c2);
+  if (c == 0) return FLT_MAX;
+
+  // Unfold triangle into plane with A at origin, B on x axis, and C above it
+  double cx = (b2 + c2 - a2) / (2 * c);
+  double cy2 = b2 - cx * cx;
+  if (cy2 <= 0) return FLT_MAX;
+  double cy = sqrt(cy2);
+
+  // Find virtual source below AB at distance da from A and db from B
+  double sx = ((double) da * da - (double) db * db + c2) / (2 * c);
+  double sy2 = (double) da * da - sx * sx;
+  if (sy2 < 0) return FLT_MAX;
+  double sy = -sqrt(sy2);
+
+  // Check that straight path from virtual source to C crosses AB
+  double x = sx + (cx - sx) * (-sy / (cy - sy));
+  if ((x < 0) || (x > c)) return FLT_MAX;
+
+  // Return length of path
+  return (float) sqrt((cx - sx) * (cx - sx) + (cy - sy) * (cy - sy));
+}
+
+
+
+void R3MeshGeodesics::
+Propagate(R3MeshGeodesicsWorkspace *workspace, int nsources, const int *source_indices,
+  int first_label, RNLength max_distance, int replaced_label) const
+{
+  // Start new propagation
+  workspace->stamp++;
+  workspace->visited.clear();
+  workspace->settled.clear();
+  ClearRadixHeap(&workspace->heap);
+
+  // Insert sources
+  for (int i = 0; i < nsources; i++) {
+    RelaxVertex(workspace, source_indices[i], 0.0F, first_label + i, replaced_label);
+  }
+
+  // Pop vertices in order of increasing distance
+  float *distances = &workspace->distances[0];
+  int *labels = &workspace->labels[0];
+  unsigned int key;
+  int vertex_index;
+  while (PopRadixHeap(&workspace->heap, &key, &vertex_index)) {
+    // Skip entries replaced by shorter distances
+    float distance = distances[vertex_index];
+    if (key != RadixKey(distance)) continue;
+    if ((max_distance > 0) && (distance > max_distance)) break;
+    workspace->settled.push_back(vertex_index);
+    int label = labels[vertex_index];
+
+    // Relax neighbors along edges
+    for (int k = neighbor_offsets[vertex_index]; k < neighbor_offsets[vertex_index+1]; k++) {
+      RelaxVertex(workspace, neighbor_indices[k], distance + neighbor_lengths[k], label, replaced_label);
+    }
+
+    // Relax opposite corners of faces whose other corner was reached from same source
+    if (method == R3_MESH_FAST_MARCHING_DISTANCES) {
+      const float *pa = &positions[3*vertex_index];
+      for (int k = face_offsets[vertex_index]; k < face_offsets[vertex_index+1]; k++) {
+        for (int j = 0; j < 2; j++) {
+          int b = face_corners[2*k+j];
+          int c = face_corners[2*k+1-j];
+          if ((labels[b] != label) || (distances[b] > distance)) continue;
+          float d = UnfoldedDistance(pa, &positions[3*b], &positions[3*c], distance, distances[b]);
+          if (d == FLT_MAX) continue;
+          if (d < distance) d = distance;
+          RelaxVertex(workspace, c, d, label, replaced_label);
+        }
+      }
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Distance functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshGeodesics::
+ComputeDistances(int nsources, const int *source_indices, RNLength *distances,
+  RNLength max_distance, int *closest_sources) const
+{
+  // Get workspace
+  if (workspaces.empty()) workspaces.resize(1, NULL);
+  R3MeshGeodesicsWorkspace *workspace = Workspace(0);
+
+  // Propagate distances from sources
+  Propagate(workspace, nsources, source_indices, 0, max_distance);
+
+  // Fill results
+  for (int i = 0; i < NVertices(); i++) {
+    RNLength distance = workspace->distances[i];
+    int label = workspace->labels[i];
+    if ((max_distance > 0) && (distance > max_distance)) { distance = FLT_MAX; label = -1; }
+    if (distances) distances[i] = distance;
+    if (closest_sources) closest_sources[i] = (label >= 0) ? source_indices[label] : -1;
+  }
+
+  // Reset workspace
+  Reset(workspace);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3MeshGeodesics::
+FindNeighbors(int source_index, RNLength max_distance,
+  std::vector<int>& neighbor_indices, std::vector<RNLength> *neighbor_distances) const
+{
+  // Get workspace
+  if (workspaces.empty()) workspaces.resize(1, NULL);
+  R3MeshGeodesicsWorkspace *workspace = Workspace(0);
+
+  // Propagate distances from source
+  Propagate(workspace, 1, &source_index, 0, max_distance);
+
+  // Fill results (in order of increasing distance)
+  neighbor_indices = workspace->settled;
+  if (neighbor_distances) {
+    neighbor_distances->resize(neighbor_indices.size());
+    for (unsigned int i = 0; i < neighbor_indices.size(); i++) {
+      (*neighbor_distances)[i] = workspace->distances[neighbor_indices[i]];
+    }
+  }
+
+  // Reset workspace
+  Reset(workspace);
+
+  // Return number of neighbors
+  return (int) neighbor_indices.size();
+}
+
+
+
+struct R3MeshGeodesicsBatchData {
+  const R3MeshGeodesics *geodesics;
+  const int *source_indices;
+  R3MeshGeodesicsCallback callback;
+  void *data;
+  RNLength max_distance;
+};
+
+
+
+static void
+ComputeDistancesCallback(int index, int thread_index, void *data)
+{
+  // Propagate distances from one source
+  R3MeshGeodesicsBatchData *batch = (R3MeshGeodesicsBatchData *) data;
+  R3MeshGeodesicsWorkspace *workspace = batch->geodesics->Workspace(thread_index);
+  batch->geodesics->Propagate(workspace, 1, &batch->source_indices[index], 0, batch->max_distance);
+
+  // Pass vertices within max_distance to callback
+  const int *settled = (workspace->settled.empty()) ? NULL : &workspace->settled[0];
+  (*batch->callback)(index, (int) workspace->settled.size(), settled,
+    &workspace->distances[0], thread_index, batch->data);
+
+  // Reset workspace
+  batch->geodesics->Reset(workspace);
+}
+
+
+
+int R3MeshGeodesics::
+ComputeDistances(int nsources, const int *source_indices,
+  R3MeshGeodesicsCallback callback, void *data, RNLength max_distance) const
+{
+  // Check number of vertices
+  if ((nsources <= 0) || (NVertices() == 0)) return 1;
+
+  // Make sure there is a workspace slot for every thread
+  if ((int) workspaces.size() < RNNThreads()) workspaces.resize(RNNThreads(), NULL);
+
+  // Propagate distances from sources in parallel
+  R3MeshGeodesicsBatchData batch;
+  batch.geodesics = this;
+  batch.source_indices = source_indices;
+  batch.callback = callback;
+  batch.data = data;
+  batch.max_distance = max_distance;
+  RNParallelFor(nsources, ComputeDistancesCallback, &batch);
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Sampling functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshGeodesics::
+SelectFurthestVertices(int max_samples, std::vector<int>& samples, RNLength min_spacing) const
+{
+  // Get workspace
+  int nvertices = NVertices();
+  if (workspaces.empty()) workspaces.resize(1, NULL);
+  R3MeshGeodesicsWorkspace *workspace = Workspace(0);
+
+  // Initialize sources with seeds (labels are indices into sources)
+  std::vector<int> sources(samples);
+  std::vector<char> temporary(sources.size(), 0);
+
+  // Find connected components without seeds
+  std::vector<int> components(nvertices, -1);
+  for (unsigned int i = 0; i < sources.size(); i++) components[sources[i]] = 0;
+  std::vector<int> stack;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < nvertices; i++) {
+      // Check if vertex starts a new component (seeded components are visited first)
+      if (NNeighbors(i) == 0) continue;
+      if (pass == 0) { if (components[i] != 0) continue; components[i] = 1; }
+      else { if (components[i] >= 0) continue; components[i] = 1; }
+
+      // Add temporary seed for component without seed
+      if (pass == 1) {
+        sources.push_back(i);
+        temporary.push_back(1);
+      }
+
+      // Mark vertices in component
+      stack.push_back(i);
+      while (!stack.empty()) {
+        int vertex_index = stack.back();
+        stack.pop_back();
+        for (int k = neighbor_offsets[vertex_index]; k < neighbor_offsets[vertex_index+1]; k++) {
+          int neighbor_index = neighbor_indices[k];
+          if (components[neighbor_index] == 1) continue;
+          components[neighbor_index] = 1;
+          stack.push_back(neighbor_index);
+        }
+      }
+    }
+  }
+
+  // Propagate distances from all sources
+  std::priority_queue< std::pair<float, int> > furthest;
+  if (!sources.empty()) {
+    Propagate(workspace, (int) sources.size(), &sources[0], 0, 0);
+    for (unsigned int i = 0; i < workspace->visited.size(); i++) {
+      int vertex_index = workspace->visited[i];
+      furthest.push(std::pair<float, int>(workspace->distances[vertex_index], vertex_index));
+    }
+  }
+
+  // Iteratively add furthest vertex
+  while ((int) samples.size() < max_samples) {
+    // Find furthest vertex (skipping entries whose distance has changed)
+    while (!furthest.empty() && (furthest.top().first != workspace->distances[furthest.top().second])) furthest.pop();
+    if (furthest.empty()) break;
+    int vertex_index = furthest.top().second;
+    float distance = furthest.top().first;
+    if (distance <= 0) break;
+    if ((min_spacing > 0) && (distance < min_spacing)) break;
+
+    // Add sample
+    samples.push_back(vertex_index);
+
+    // Check if sample replaces temporary seed of its component
+    int replaced_label = workspace->labels[vertex_index];
+    if (!temporary[replaced_label]) replaced_label = -1;
+    else temporary[replaced_label] = 0;
+
+    // Update distances from new sample
+    int label = (int) sources.size();
+    sources.push_back(vertex_index);
+    temporary.push_back(0);
+    Propagate(workspace, 1, &vertex_index, label, 0, replaced_label);
+    for (unsigned int i = 0; i < workspace->visited.size(); i++) {
+      int changed_index = workspace->visited[i];
+      furthest.push(std::pair<float, int>(workspace->distances[changed_index], changed_index));
+    }
+  }
+
+  // Reset workspace
+  workspace->distances.assign(nvertices, FLT_MAX);
+  workspace->labels.assign(nvertices, -1);
+  workspace->visited.clear();
+  workspace->settled.clear();
+  ClearRadixHeap(&workspace->heap);
+
+  // Return number of samples
+  return (int) samples.size();
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,133 @@
+// Include file for mesh geodesic distance engine
+#ifndef __R3__MESH__GEODESICS__H__
+#define __R3__MESH__GEODESICS__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Distance methods
+
+#define R3_MESH_DIJKSTRA_DISTANCES       0
+#define R3_MESH_FAST_MARCHING_DISTANCES  1
+
+
+
+// Callback for batched distance computations (vertex_indices lists the nvertices
+// vertices within max_distance of the source in order of increasing distance,
+// and distances is indexed by vertex index)
+
+typedef void (*R3MeshGeodesicsCallback)(int source_index, int nvertices, const int *vertex_indices,
+  const float *distances, int thread_index, void *data);
+
+
+
+// Scratch data for one propagation (defined in R3MeshGeodesics.cpp)
+
+struct R3MeshGeodesicsWorkspace;
+
+
+
+// Class definition (functions share scratch data, so they must not be called
+// concurrently -- the batched functions parallelize internally instead)
+
+class R3MeshGeodesics {
+public:
+  // Constructor/deconstructor
+  R3MeshGeodesics(void);
+  R3MeshGeodesics(const R3Mesh& mesh, int method = R3_MESH_DIJKSTRA_DISTANCES);
+  ~R3MeshGeodesics(void);
+
+  // Property functions
+  int NVertices(void) const;
+  int NNeighbors(int vertex_index) const;
+  int Method(void) const;
+
+  // Build functions
+  int Build(const R3Mesh& mesh);
+  void SetMethod(int method);
+  void Empty(void);
+
+  // Distance functions (vertices further than max_distance from all sources, or
+  // not connected to any source, get FLT_MAX and closest source -1)
+  int ComputeDistances(int nsources, const int *source_indices, RNLength *distances,
+    RNLength max_distance = 0, int *closest_sources = NULL) const;
+  int FindNeighbors(int source_index, RNLength max_distance,
+    std::vector<int>& neighbor_indices, std::vector<RNLength> *neighbor_distances = NULL) const;
+
+  // Batched distance functions (distances from each source are computed
+  // independently, in parallel, and passed to the callback)
+  int ComputeDistances(int nsources, const int *source_indices,
+    R3MeshGeodesicsCallback callback, void *data, RNLength max_distance = 0) const;
+
+  // Sampling functions (samples is extended up to max_samples vertices, keeping the
+  // vertices already in it as seeds, and stopping early if the furthest vertex is
+  // closer than min_spacing -- each connected component without a seed gets a
+  // temporary seed that is replaced by the furthest vertex from it)
+  int SelectFurthestVertices(int max_samples, std::vector<int>& samples, RNLength min_spacing = 0) const;
+
+public:
+  // Internal functions
+  R3MeshGeodesicsWorkspace *Workspace(int thread_index) const;
+  void Propagate(R3MeshGeodesicsWorkspace *workspace, int nsources, const int *source_indices,
+    int first_label, RNLength max_distance, int replaced_label = -1) const;
+  void Reset(R3MeshGeodesicsWorkspace *workspace) const;
+
+private:
+  std::vector<float> positions;
+  std::vector<int> neighbor_offsets;
+  std::vector<int> neighbor_indices;
+  std::vector<float> neighbor_lengths;
+  std::vector<int> face_offsets;
+  std::vector<int> face_corners;
+  int method;
+  mutable std::vector<R3MeshGeodesicsWorkspace *> workspaces;
+};
+
+
+
+// Inline functions
+
+inline int R3MeshGeodesics::
+NVertices(void) const
+{
+  // Return number of vertices
+  return (int) (positions.size() / 3);
+}
+
+
+
+inline int R3MeshGeodesics::
+NNeighbors(int vertex_index) const
+{
+  // Return number of vertices connected to vertex by an edge
+  return neighbor_offsets[vertex_index+1] - neighbor_offsets[vertex_index];
+}
+
+
+
+inline int R3MeshGeodesics::
+Method(void) const
+{
+  // Return method used to compute distances
+  return method;
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -1351,6 +1351,45 @@ Erode(RNScalar radius)
 
 
 
+struct R3MeshPropertyBlurData {
+  RNScalar radius;
+  RNScalar denom;
+  const int *vertex_indices;
+  const RNScalar *old_values;
+  RNScalar *values;
+};
+
+
+
+static void
+BlurVertexValue(int source_index, int nvertices, const int *vertex_indices,
+  const float *distances, int, void *data)
+{
+  // Get convenient variables
+  R3MeshPropertyBlurData *blur_data = (R3MeshPropertyBlurData *) data;
+  
+  // Compute blurred value
+  RNScalar total_value = 0;
+  RNScalar total_weight = 0;
+  for (int j = 0; j < nvertices; j++) {
+    int neighbor_id = vertex_indices[j];
+    RNScalar value = blur_data->old_values[neighbor_id];
+    if (value == RN_UNKNOWN) continue;
+    RNLength distance = distances[neighbor_id];
+    if (distance > blur_data->radius) continue;
+    RNScalar weight = exp(distance * distance / blur_data->denom); 
+    total_value += weight * value;
+    total_weight += weight;
+  }
+
+  // Assign blurred value (normalized by total weight)
+  if (total_weight > 0) {
+    blur_data->values[blur_data->vertex_indices[source_index]] = total_value / total_weight;
+  }
+}
+
+
+
 void R3MeshProperty::
 Blur(RNScalar sigma)
 {
@@ -1365,39 +1404,24 @@ Blur(RNScalar sigma)
   RNScalar *old_values = new RNScalar [ mesh->NVertices() ];
   for (int i = 0; i < mesh->NVertices(); i++) old_values[i] = values[i];
 
-  // Allocate array of vertices within blur filter
-  RNArray<R3MeshVertex *> neighbor_vertices;
-
-  // Blur value at every vertex
+  // Make list of vertices with known values
+  std::vector<int> vertex_indices;
   for (int i = 0; i < mesh->NVertices(); i++) {
-    R3MeshVertex *vertex = mesh->Vertex(i);
     if (values[i] == RN_UNKNOWN) continue;
+    vertex_indices.push_back(i);
+  }
 
-    // Compute distances
-    RNLength *distances = mesh->DijkstraDistances(vertex, radius, neighbor_vertices);
-
-    // Compute blurred value
-    RNScalar total_value = 0;
-    RNScalar total_weight = 0;
-    for (int j = 0; j < neighbor_vertices.NEntries(); j++) {
-      R3MeshVertex *neighbor_vertex = neighbor_vertices.Kth(j);
-      int neighbor_id = mesh->VertexID(neighbor_vertex);
-      RNScalar value = old_values[neighbor_id];
-      if (value == RN_UNKNOWN) continue;
-      RNLength distance = distances[neighbor_id];
-      if (distance > radius) continue;
-      RNScalar weight = exp(distance * distance / denom); 
-      total_value += weight * value;
-      total_weight += weight;
-    }
-
-    // Assign blurred value (normalized by total weight)
-    if (total_weight > 0) {
-      values[i] = total_value / total_weight;
-    }
-
-    // Delete distances
-    delete [] distances;
+  // Blur value at every vertex (in parallel)
+  if (!vertex_indices.empty()) {
+    R3MeshPropertyBlurData blur_data;
+    blur_data.radius = radius;
+    blur_data.denom = denom;
+    blur_data.vertex_indices = &vertex_indices[0];
+    blur_data.old_values = old_values;
+    blur_data.values = values;
+    R3MeshGeodesics geodesics(*mesh);
+    geodesics.ComputeDistances(vertex_indices.size(), &vertex_indices[0],
+      BlurVertexValue, &blur_data, radius);
   }
 
   // Delete copy of values
@@ -1537,6 +1561,7 @@ Read(const char *filename)
   else if (!strcmp(extension, ".val")) return ReadValues(filename);
   else if (!strcmp(extension, ".dat")) return ReadValues(filename);
   else if (!strcmp(extension, ".pid")) return ReadPoints(filename);
+  else if (!strcmp(extension, ".prc")) return ReadColumn(filename);
 
   // Reset statistics
   ResetStatistics();
@@ -1676,6 +1701,40 @@ ReadValues(const char *filename)
 
 
 
+int R3MeshProperty::
+ReadColumn(const char *filename, const char *column_name)
+{
+  // Map columnar property file
+  R3MeshPropertyFile file;
+  if (!file.Open(filename)) return 0;
+
+  // Check number of vertices
+  if (file.NVertices() != mesh->NVertices()) {
+    RNFail("Mismatching number of vertices in %s\n", filename);
+    return 0;
+  }
+
+  // Find column (first one if no name is given)
+  int column_index = (column_name) ? file.ColumnIndex(column_name) : 0;
+  if ((column_index < 0) || (column_index >= file.NColumns())) {
+    RNFail("Unable to find column %s in %s\n", (column_name) ? column_name : "0", filename);
+    return 0;
+  }
+
+  // Copy name and values (only pages of this column are read)
+  SetName(file.ColumnName(column_index));
+  const float *column_values = file.ColumnValues(column_index);
+  for (int i = 0; i < nvalues; i++) values[i] = column_values[i];
+
+  // Reset statistics
+  ResetStatistics();
+
+  // Return success
+  return 1;
+}
+
+
+
 int R3MeshProperty::
 ReadPoints(const char *filename)
 {
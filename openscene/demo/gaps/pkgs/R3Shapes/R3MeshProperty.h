@@ -114,6 +114,7 @@ public:
   int ReadValues(const char *filename);
   int ReadARFF(const char *filename);
   int ReadPoints(const char *filename);
+  int ReadColumn(const char *filename, const char *column_name = NULL);
   int Write(const char *filename) const;
   int WriteValues(const char *filename) const;
   int WriteARFF(const char *filename) const;
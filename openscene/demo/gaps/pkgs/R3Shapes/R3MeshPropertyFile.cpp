@@ -0,0 +1,177 @@
+// Source file for memory-mapped columnar mesh property file
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes.h"
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Header functions
+////////////////////////////////////////////////////////////////////////
+
+void
+R3InitMeshPropertyFileHeader(R3MeshPropertyFileHeader *header, int vertex_count, int column_count)
+{
+  // Fill header fields
+  memcpy(header->magic, "R3PRPCOL", 8);
+  header->version = R3_MESH_PROPERTY_FILE_VERSION;
+  header->byte_order = 0x01020304;
+  header->vertex_count = vertex_count;
+  header->column_count = column_count;
+  header->name_size = R3_MESH_PROPERTY_FILE_NAME_SIZE;
+  header->reserved = 0;
+}
+
+
+
+int
+R3CheckMeshPropertyFileHeader(const R3MeshPropertyFileHeader *header, const char *filename)
+{
+  // Check magic string and version
+  if (memcmp(header->magic, "R3PRPCOL", 8)) {
+    RNFail("Not a columnar property file: %s\n", filename);
+    return 0;
+  }
+  if (header->version != R3_MESH_PROPERTY_FILE_VERSION) {
+    RNFail("Unsupported version %d in columnar property file: %s\n", header->version, filename);
+    return 0;
+  }
+
+  // Check layout
+  if (header->byte_order != 0x01020304) {
+    RNFail("Columnar property file has different byte order: %s\n", filename);
+    return 0;
+  }
+  if ((header->name_size != R3_MESH_PROPERTY_FILE_NAME_SIZE) ||
+      (header->vertex_count < 0) || (header->column_count < 0)) {
+    RNFail("Invalid header in columnar property file: %s\n", filename);
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor
+////////////////////////////////////////////////////////////////////////
+
+R3MeshPropertyFile::
+R3MeshPropertyFile(void)
+  : data(NULL),
+    size(0),
+    nvertices(0),
+    ncolumns(0)
+{
+}
+
+
+
+R3MeshPropertyFile::
+~R3MeshPropertyFile(void)
+{
+  // Unmap file
+  Close();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Access functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshPropertyFile::
+ColumnIndex(const char *name) const
+{
+  // Return index of first column with name (only column names are touched)
+  for (int k = 0; k < ncolumns; k++) {
+    if (!strncmp(ColumnName(k), name, R3_MESH_PROPERTY_FILE_NAME_SIZE)) return k;
+  }
+
+  // Column not found
+  return -1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Open/close functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshPropertyFile::
+Open(const char *filename)
+{
+  // Unmap previous file
+  Close();
+
+  // Map file
+  data = (unsigned char *) RNMapFile(filename, &size);
+  if (!data || (size < R3_MESH_PROPERTY_FILE_HEADER_SIZE)) {
+    RNFail("Unable to map columnar property file: %s\n", filename);
+    Close();
+    return 0;
+  }
+
+  // Check header
+  R3MeshPropertyFileHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (!R3CheckMeshPropertyFileHeader(&header, filename)) {
+    Close();
+    return 0;
+  }
+
+  // Check that all columns are in file
+  if (size < R3MeshPropertyFileColumnOffset(header.column_count, header.vertex_count)) {
+    RNFail("Columnar property file is truncated: %s\n", filename);
+    Close();
+    return 0;
+  }
+
+  // Check that column names are terminated (so that they can be used as strings)
+  for (int k = 0; k < header.column_count; k++) {
+    const unsigned char *name = &data[R3MeshPropertyFileColumnOffset(k, header.vertex_count)];
+    if (!memchr(name, '\0', R3_MESH_PROPERTY_FILE_NAME_SIZE)) {
+      RNFail("Unterminated name of column %d in columnar property file: %s\n", k, filename);
+      Close();
+      return 0;
+    }
+  }
+
+  // Remember counts
+  nvertices = header.vertex_count;
+  ncolumns = header.column_count;
+
+  // Return success
+  return 1;
+}
+
+
+
+void R3MeshPropertyFile::
+Close(void)
+{
+  // Unmap file
+  if (data) RNUnmapFile(data, size);
+  data = NULL;
+  size = 0;
+  nvertices = 0;
+  ncolumns = 0;
+}
+
+
+
+// End namespace
+}
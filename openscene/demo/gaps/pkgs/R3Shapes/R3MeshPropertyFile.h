@@ -0,0 +1,142 @@
+// Include file for memory-mapped columnar mesh property file
+#ifndef __R3__MESH__PROPERTY__FILE__H__
+#define __R3__MESH__PROPERTY__FILE__H__
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Columnar property file layout (.prc, native byte order of the writing host,
+// files with a different byte_order are rejected when opened):
+//   header: char magic[8] ("R3PRPCOL"), int version, int byte_order (0x01020304),
+//           int vertex_count, int column_count, int name_size (128), int reserved
+//   column k (at R3MeshPropertyFileColumnOffset(k, vertex_count)):
+//           char name[name_size], float values[vertex_count]
+// Columns all have the same size, so any column can be located without reading
+// the others, and new columns are appended by writing past the last one and
+// then updating column_count in the header.
+
+#define R3_MESH_PROPERTY_FILE_HEADER_SIZE  32
+#define R3_MESH_PROPERTY_FILE_NAME_SIZE   128
+#define R3_MESH_PROPERTY_FILE_VERSION       1
+
+struct R3MeshPropertyFileHeader {
+  char magic[8];
+  int version;
+  int byte_order;
+  int vertex_count;
+  int column_count;
+  int name_size;
+  int reserved;
+};
+
+
+
+// Class definition (read-only view of a mapped file)
+
+class R3MeshPropertyFile {
+public:
+  // Constructor/deconstructor
+  R3MeshPropertyFile(void);
+  ~R3MeshPropertyFile(void);
+
+  // Property functions
+  int NVertices(void) const;
+  int NColumns(void) const;
+  RNBoolean IsOpen(void) const;
+
+  // Column access functions (values point into the mapped file)
+  const char *ColumnName(int k) const;
+  const float *ColumnValues(int k) const;
+  int ColumnIndex(const char *name) const;
+
+  // Open/close functions
+  int Open(const char *filename);
+  void Close(void);
+
+private:
+  unsigned char *data;
+  unsigned long long size;
+  int nvertices;
+  int ncolumns;
+};
+
+
+
+// Utility functions
+
+unsigned long long R3MeshPropertyFileColumnOffset(int column_index, int vertex_count);
+void R3InitMeshPropertyFileHeader(R3MeshPropertyFileHeader *header, int vertex_count, int column_count);
+int R3CheckMeshPropertyFileHeader(const R3MeshPropertyFileHeader *header, const char *filename);
+
+
+
+// Inline functions
+
+inline int R3MeshPropertyFile::
+NVertices(void) const
+{
+  // Return number of values in each column
+  return nvertices;
+}
+
+
+
+inline int R3MeshPropertyFile::
+NColumns(void) const
+{
+  // Return number of columns
+  return ncolumns;
+}
+
+
+
+inline RNBoolean R3MeshPropertyFile::
+IsOpen(void) const
+{
+  // Return whether file is mapped
+  return (data) ? TRUE : FALSE;
+}
+
+
+
+inline const char *R3MeshPropertyFile::
+ColumnName(int k) const
+{
+  // Return name of kth column
+  assert((k >= 0) && (k < ncolumns));
+  return (const char *) &data[R3MeshPropertyFileColumnOffset(k, nvertices)];
+}
+
+
+
+inline const float *R3MeshPropertyFile::
+ColumnValues(int k) const
+{
+  // Return values of kth column
+  assert((k >= 0) && (k < ncolumns));
+  return (const float *) &data[R3MeshPropertyFileColumnOffset(k, nvertices) + R3_MESH_PROPERTY_FILE_NAME_SIZE];
+}
+
+
+
+inline unsigned long long
+R3MeshPropertyFileColumnOffset(int column_index, int vertex_count)
+{
+  // Return byte offset of column in file
+  unsigned long long column_size = R3_MESH_PROPERTY_FILE_NAME_SIZE + (unsigned long long) vertex_count * sizeof(float);
+  return R3_MESH_PROPERTY_FILE_HEADER_SIZE + column_index * column_size;
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -198,6 +198,7 @@ Read(const char *filename)
   if (!strcmp(extension, ".arff")) return ReadARFF(filename);
   else if (!strcmp(extension, ".npy")) return ReadNumpy(filename);
   else if (!strcmp(extension, ".prp")) return ReadBinary(filename);
+  else if (!strcmp(extension, ".prc")) return ReadColumns(filename);
   else if (!strcmp(extension, ".trt")) return ReadToronto(filename);
   else return ReadProperty(filename);
 }
@@ -576,6 +577,59 @@ ReadBinary(const char *filename)
 
 
 
+int R3MeshPropertySet::
+ReadColumns(const char *filename)
+{
+  // Just checking
+  if (!mesh) return 0;
+  
+  // Map columnar property file
+  R3MeshPropertyFile file;
+  if (!file.Open(filename)) return 0;
+
+  // Check number of vertices
+  if (file.NVertices() != mesh->NVertices()) {
+    RNFail("Mismatching number of vertices in %s\n", filename);
+    return 0;
+  }
+
+  // Create properties from columns
+  std::vector<RNScalar> values(file.NVertices());
+  for (int j = 0; j < file.NColumns(); j++) {
+    const float *column_values = file.ColumnValues(j);
+    for (int i = 0; i < file.NVertices(); i++) values[i] = column_values[i];
+    R3MeshProperty *property = new R3MeshProperty(mesh, file.ColumnName(j), values.data());
+    Insert(property);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3MeshPropertySet::
+ReadColumn(const char *filename, const char *property_name)
+{
+  // Just checking
+  if (!mesh) return 0;
+  
+  // Read one column from columnar property file
+  R3MeshProperty *property = new R3MeshProperty(mesh, property_name);
+  if (!property->ReadColumn(filename, property_name)) {
+    delete property;
+    return 0;
+  }
+
+  // Insert property
+  Insert(property);
+
+  // Return success
+  return 1;
+}
+
+
+
 int R3MeshPropertySet::
 ReadToronto(const char *filename)
 {
@@ -724,6 +778,7 @@ Write(const char *filename) const
   else if (!strcmp(extension, ".npy")) return WriteNumpy(filename);
   else if (!strcmp(extension, ".txt")) return WriteValues(filename);
   else if (!strcmp(extension, ".prp")) return WriteBinary(filename);
+  else if (!strcmp(extension, ".prc")) return WriteColumns(filename);
   else if (!strcmp(extension, ".val")) return WriteValues(filename);
   else if (!strcmp(extension, ".dat")) return WriteValues(filename);
 
@@ -894,6 +949,161 @@ WriteBinary(const char *filename) const
 
 
 
+static int
+WriteColumn(FILE *fp, R3MeshProperty *property, float *buffer, const char *filename)
+{
+  // Write property name
+  char property_name[R3_MESH_PROPERTY_FILE_NAME_SIZE];
+  memset(property_name, 0, R3_MESH_PROPERTY_FILE_NAME_SIZE);
+  if (property->Name()) {
+    size_t length = strlen(property->Name());
+    if (length >= R3_MESH_PROPERTY_FILE_NAME_SIZE) length = R3_MESH_PROPERTY_FILE_NAME_SIZE-1;
+    memcpy(property_name, property->Name(), length);
+  }
+  if (fwrite(property_name, sizeof(char), R3_MESH_PROPERTY_FILE_NAME_SIZE, fp) != (unsigned int) R3_MESH_PROPERTY_FILE_NAME_SIZE) {
+    RNFail("Unable to write property name to columnar file: %s\n", filename);
+    return 0;
+  }
+
+  // Write property values
+  int nvalues = property->NVertexValues();
+  for (int i = 0; i < nvalues; i++) buffer[i] = property->VertexValue(i);
+  if (fwrite(buffer, sizeof(float), nvalues, fp) != (unsigned int) nvalues) {
+    RNFail("Unable to write property values to columnar file: %s\n", filename);
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3MeshPropertySet::
+WriteColumns(const char *filename) const
+{
+  // Just checking
+  if (!mesh) return 0;
+  
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open columnar property file: %s\n", filename);
+    return 0;
+  }
+
+  // Write header
+  R3MeshPropertyFileHeader header;
+  R3InitMeshPropertyFileHeader(&header, mesh->NVertices(), NProperties());
+  if (fwrite(&header, sizeof(header), 1, fp) != (unsigned int) 1) {
+    RNFail("Unable to write header to columnar file: %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Write columns
+  std::vector<float> buffer(mesh->NVertices() + 1);
+  for (int j = 0; j < NProperties(); j++) {
+    if (!WriteColumn(fp, Property(j), buffer.data(), filename)) {
+      fclose(fp);
+      return 0;
+    }
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3MeshPropertySet::
+AppendColumns(const char *filename) const
+{
+  // Just checking
+  if (!mesh) return 0;
+
+  // Write new file if there is none yet
+  if (!RNFileExists(filename)) return WriteColumns(filename);
+  
+  // Open file
+  FILE *fp = fopen(filename, "r+b");
+  if (!fp) {
+    RNFail("Unable to open columnar property file: %s\n", filename);
+    return 0;
+  }
+
+  // Read and check header
+  R3MeshPropertyFileHeader header;
+  if (fread(&header, sizeof(header), 1, fp) != (unsigned int) 1) {
+    RNFail("Unable to read header from columnar file: %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+  if (!R3CheckMeshPropertyFileHeader(&header, filename)) {
+    fclose(fp);
+    return 0;
+  }
+  if (header.vertex_count != mesh->NVertices()) {
+    RNFail("Mismatching number of vertices in %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Check that names of new columns are not in file already
+  char column_name[R3_MESH_PROPERTY_FILE_NAME_SIZE + 1];
+  for (int k = 0; k < header.column_count; k++) {
+    if (!RNFileSeek(fp, R3MeshPropertyFileColumnOffset(k, header.vertex_count), RN_FILE_SEEK_SET) ||
+        (fread(column_name, sizeof(char), R3_MESH_PROPERTY_FILE_NAME_SIZE, fp) != (unsigned int) R3_MESH_PROPERTY_FILE_NAME_SIZE)) {
+      RNFail("Unable to read name of column %d from columnar file: %s\n", k, filename);
+      fclose(fp);
+      return 0;
+    }
+    column_name[R3_MESH_PROPERTY_FILE_NAME_SIZE-1] = '\0';
+    for (int j = 0; j < NProperties(); j++) {
+      const char *property_name = Property(j)->Name();
+      if (!property_name || strncmp(property_name, column_name, R3_MESH_PROPERTY_FILE_NAME_SIZE-1)) continue;
+      RNFail("Column %s is already in columnar file: %s\n", column_name, filename);
+      fclose(fp);
+      return 0;
+    }
+  }
+
+  // Write new columns after existing ones
+  if (!RNFileSeek(fp, R3MeshPropertyFileColumnOffset(header.column_count, header.vertex_count), RN_FILE_SEEK_SET)) {
+    RNFail("Unable to seek to end of columns in columnar file: %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+  std::vector<float> buffer(mesh->NVertices() + 1);
+  for (int j = 0; j < NProperties(); j++) {
+    if (!WriteColumn(fp, Property(j), buffer.data(), filename)) {
+      fclose(fp);
+      return 0;
+    }
+  }
+
+  // Update column count in header (after column data, so file is always consistent)
+  fflush(fp);
+  header.column_count += NProperties();
+  if (!RNFileSeek(fp, 0, RN_FILE_SEEK_SET) ||
+      (fwrite(&header, sizeof(header), 1, fp) != (unsigned int) 1)) {
+    RNFail("Unable to write header to columnar file: %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
 int R3MeshPropertySet::
 WriteValues(const char *filename) const
 {
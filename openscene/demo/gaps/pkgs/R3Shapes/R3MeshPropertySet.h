@@ -48,11 +48,15 @@ public:
   int ReadBinary(const char *filename);
   int ReadToronto(const char *filename);
   int ReadProperty(const char *filename);
+  int ReadColumns(const char *filename);
+  int ReadColumn(const char *filename, const char *property_name);
   int Write(const char *filename) const;
   int WriteARFF(const char *filename) const;
   int WriteNumpy(const char *filename) const;
   int WriteBinary(const char *filename) const;
   int WriteValues(const char *filename) const;
+  int WriteColumns(const char *filename) const;
+  int AppendColumns(const char *filename) const;
 
 public:
   R3Mesh *mesh;
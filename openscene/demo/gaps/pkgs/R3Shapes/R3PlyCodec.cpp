@@ -0,0 +1,1020 @@
+// Source file for fast binary ply mesh reading and writing
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes.h"
+#include "ply.h"
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Type definitions
+////////////////////////////////////////////////////////////////////////
+
+struct R3PlyCodecProperty {
+  std::string name;
+  int type;           // PLY_CHAR ... PLY_DOUBLE
+  int count_type;     // type of list count, or zero for scalar properties
+  int offset;         // byte offset within record (for fixed size records)
+};
+
+struct R3PlyCodecElement {
+  std::string name;
+  int count;
+  std::vector<R3PlyCodecProperty> properties;
+};
+
+struct R3PlyCodecColumn {
+  const unsigned char *data;      // property of first record
+  int type;                       // type of property
+  double scale;                   // scale applied to decoded values
+  float *float_values;            // destination (one of three)
+  unsigned char *uchar_values;
+  int *int_values;
+  int value_stride;               // destination values per record
+};
+
+struct R3PlyCodecDecodeJob {
+  std::vector<R3PlyCodecColumn> columns;
+  int nrecords;
+  int stride;
+  int swap;
+  int chunk_size;
+
+  // Face list data (for face element only)
+  const unsigned char *list_data;
+  int list_count_type;
+  int list_index_type;
+  int list_count;
+  int nvertices;
+  int *indices;
+  std::vector<int> chunk_status;  // 1 = all triangles valid, 0 = some invalid, -1 = bad list count
+};
+
+struct R3PlyCodecEncodeJob {
+  const R3PlyMesh *mesh;
+  unsigned char *buffer;          // packed records starting at first_record
+  int stride;
+  int first_record;
+  int nrecords;
+  int chunk_size;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Scalar type utility functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParsePlyType(const char *name)
+{
+  // Return ply type code for type name
+  if (!strcmp(name, "char") || !strcmp(name, "int8")) return PLY_CHAR;
+  if (!strcmp(name, "uchar") || !strcmp(name, "uint8")) return PLY_UCHAR;
+  if (!strcmp(name, "short") || !strcmp(name, "int16")) return PLY_SHORT;
+  if (!strcmp(name, "ushort") || !strcmp(name, "uint16")) return PLY_USHORT;
+  if (!strcmp(name, "int") || !strcmp(name, "int32")) return PLY_INT;
+  if (!strcmp(name, "uint") || !strcmp(name, "uint32")) return PLY_UINT;
+  if (!strcmp(name, "float") || !strcmp(name, "float32")) return PLY_FLOAT;
+  if (!strcmp(name, "double") || !strcmp(name, "float64")) return PLY_DOUBLE;
+  return 0;
+}
+
+
+
+static int
+PlyTypeSize(int type)
+{
+  // Return number of bytes of ply type
+  switch (type) {
+  case PLY_CHAR: case PLY_UCHAR: return 1;
+  case PLY_SHORT: case PLY_USHORT: return 2;
+  case PLY_INT: case PLY_UINT: case PLY_FLOAT: return 4;
+  case PLY_DOUBLE: return 8;
+  }
+  return 0;
+}
+
+
+
+static int
+IsHostLittleEndian(void)
+{
+  // Return whether this machine stores the low byte first
+  unsigned int value = 1;
+  return (*((unsigned char *) &value) == 1) ? 1 : 0;
+}
+
+
+
+template <class T> static inline T
+LoadScalar(const unsigned char *p, int swap)
+{
+  // Load value, reversing bytes if file and host endianness differ
+  T value;
+  if (swap) {
+    unsigned char bytes[sizeof(T)];
+    for (unsigned int k = 0; k < sizeof(T); k++) bytes[k] = p[sizeof(T) - 1 - k];
+    memcpy(&value, bytes, sizeof(T));
+  }
+  else {
+    memcpy(&value, p, sizeof(T));
+  }
+  return value;
+}
+
+
+
+static inline double
+LoadValue(const unsigned char *p, int type, int swap)
+{
+  // Load value of any ply type
+  switch (type) {
+  case PLY_CHAR: return (double) *((const signed char *) p);
+  case PLY_UCHAR: return (double) *p;
+  case PLY_SHORT: return (double) LoadScalar<short>(p, swap);
+  case PLY_USHORT: return (double) LoadScalar<unsigned short>(p, swap);
+  case PLY_INT: return (double) LoadScalar<int>(p, swap);
+  case PLY_UINT: return (double) LoadScalar<unsigned int>(p, swap);
+  case PLY_FLOAT: return (double) LoadScalar<float>(p, swap);
+  case PLY_DOUBLE: return LoadScalar<double>(p, swap);
+  }
+  return 0;
+}
+
+
+
+static inline int
+LoadIndex(const unsigned char *p, int type, int swap)
+{
+  // Load integer value (fast paths for common index types)
+  switch (type) {
+  case PLY_INT: return LoadScalar<int>(p, swap);
+  case PLY_UINT: return (int) LoadScalar<unsigned int>(p, swap);
+  case PLY_UCHAR: return *p;
+  }
+  return (int) LoadValue(p, type, swap);
+}
+
+
+
+static inline void
+StoreValue(double value, float *p)
+{
+  *p = (float) value;
+}
+
+
+
+static inline void
+StoreValue(double value, int *p)
+{
+  *p = (int) value;
+}
+
+
+
+static inline void
+StoreValue(double value, unsigned char *p)
+{
+  // Store value clamped to range of unsigned char
+  if (value <= 0) *p = 0;
+  else if (value >= 255) *p = 255;
+  else *p = (unsigned char) (value + 0.5);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Column decoding functions
+////////////////////////////////////////////////////////////////////////
+
+template <class T, class S> static void
+DecodeColumnRange(const unsigned char *data, int stride, int start, int end,
+  int swap, double scale, S *values, int value_stride)
+{
+  // Decode one property of a range of fixed size records
+  const unsigned char *p = data + (size_t) start * stride;
+  S *v = values + (size_t) start * value_stride;
+  if (scale == 1) {
+    for (int i = start; i < end; i++, p += stride, v += value_stride) {
+      StoreValue((double) LoadScalar<T>(p, swap), v);
+    }
+  }
+  else {
+    for (int i = start; i < end; i++, p += stride, v += value_stride) {
+      StoreValue(scale * (double) LoadScalar<T>(p, swap), v);
+    }
+  }
+}
+
+
+
+template <class S> static void
+DecodeColumnRange(const R3PlyCodecColumn& column, int stride, int start, int end, int swap, S *values)
+{
+  // Decode one property of a range of records with type-specific loop
+  const unsigned char *d = column.data;
+  double s = column.scale;
+  int vs = column.value_stride;
+  switch (column.type) {
+  case PLY_CHAR: DecodeColumnRange<signed char, S>(d, stride, start, end, 0, s, values, vs); break;
+  case PLY_UCHAR: DecodeColumnRange<unsigned char, S>(d, stride, start, end, 0, s, values, vs); break;
+  case PLY_SHORT: DecodeColumnRange<short, S>(d, stride, start, end, swap, s, values, vs); break;
+  case PLY_USHORT: DecodeColumnRange<unsigned short, S>(d, stride, start, end, swap, s, values, vs); break;
+  case PLY_INT: DecodeColumnRange<int, S>(d, stride, start, end, swap, s, values, vs); break;
+  case PLY_UINT: DecodeColumnRange<unsigned int, S>(d, stride, start, end, swap, s, values, vs); break;
+  case PLY_FLOAT: DecodeColumnRange<float, S>(d, stride, start, end, swap, s, values, vs); break;
+  case PLY_DOUBLE: DecodeColumnRange<double, S>(d, stride, start, end, swap, s, values, vs); break;
+  }
+}
+
+
+
+static void
+DecodeChunk(int chunk, int /* thread_index */, void *data)
+{
+  // Get range of records
+  R3PlyCodecDecodeJob *job = (R3PlyCodecDecodeJob *) data;
+  int start = chunk * job->chunk_size;
+  int end = start + job->chunk_size;
+  if (end > job->nrecords) end = job->nrecords;
+
+  // Decode scalar properties (one column at a time)
+  for (unsigned int c = 0; c < job->columns.size(); c++) {
+    const R3PlyCodecColumn& column = job->columns[c];
+    if (column.float_values) DecodeColumnRange(column, job->stride, start, end, job->swap, column.float_values);
+    else if (column.uchar_values) DecodeColumnRange(column, job->stride, start, end, job->swap, column.uchar_values);
+    else if (column.int_values) DecodeColumnRange(column, job->stride, start, end, job->swap, column.int_values);
+  }
+
+  // Decode vertex index lists (all with list_count vertices, split into fans)
+  if (!job->list_data) return;
+  int status = 1;
+  int ntriangles = job->list_count - 2;
+  int index_size = PlyTypeSize(job->list_index_type);
+  int count_size = PlyTypeSize(job->list_count_type);
+  const unsigned char *p = job->list_data + (size_t) start * job->stride;
+  int *indices = job->indices + 3 * (size_t) start * ntriangles;
+  for (int i = start; i < end; i++, p += job->stride) {
+    // Check list count
+    if (LoadIndex(p, job->list_count_type, job->swap) != job->list_count) { status = -1; break; }
+
+    // Fill triangle indices
+    const unsigned char *q = p + count_size;
+    int i0 = LoadIndex(q, job->list_index_type, job->swap);
+    int i1 = LoadIndex(q + index_size, job->list_index_type, job->swap);
+    for (int k = 0; k < ntriangles; k++) {
+      int i2 = LoadIndex(q + (k + 2) * index_size, job->list_index_type, job->swap);
+      *(indices++) = i0;
+      *(indices++) = i1;
+      *(indices++) = i2;
+      if ((i0 < 0) || (i1 < 0) || (i2 < 0)) status = 0;
+      else if ((i0 >= job->nvertices) || (i1 >= job->nvertices) || (i2 >= job->nvertices)) status = 0;
+      else if ((i0 == i1) || (i1 == i2) || (i0 == i2)) status = 0;
+      i1 = i2;
+    }
+  }
+
+  // Remember status of chunk
+  job->chunk_status[chunk] = status;
+}
+
+
+
+static void
+RunDecodeJob(R3PlyCodecDecodeJob& job)
+{
+  // Decode records in parallel chunks
+  job.chunk_size = 64 * 1024;
+  int nchunks = (job.nrecords + job.chunk_size - 1) / job.chunk_size;
+  job.chunk_status.assign(nchunks, 1);
+  RNParallelFor(nchunks, DecodeChunk, &job);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Header parsing functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ReadPlyHeader(FILE *fp, int *file_type, std::vector<R3PlyCodecElement>& elements)
+{
+  // Read magic line
+  char buffer[4096];
+  if (!fgets(buffer, 4096, fp)) return 0;
+  if (strncmp(buffer, "ply", 3)) return 0;
+
+  // Read header lines
+  while (fgets(buffer, 4096, fp)) {
+    // Split line into tokens
+    char *tokens[8];
+    int ntokens = 0;
+    char *token = strtok(buffer, " \t\r\n");
+    while (token && (ntokens < 8)) { tokens[ntokens++] = token; token = strtok(NULL, " \t\r\n"); }
+    if (ntokens == 0) continue;
+
+    // Parse line
+    if (!strcmp(tokens[0], "end_header")) {
+      return 1;
+    }
+    else if (!strcmp(tokens[0], "format")) {
+      if (ntokens < 2) return 0;
+      if (!strcmp(tokens[1], "ascii")) *file_type = PLY_ASCII;
+      else if (!strcmp(tokens[1], "binary_little_endian")) *file_type = PLY_BINARY_LE;
+      else if (!strcmp(tokens[1], "binary_big_endian")) *file_type = PLY_BINARY_BE;
+      else return 0;
+    }
+    else if (!strcmp(tokens[0], "element")) {
+      if (ntokens < 3) return 0;
+      R3PlyCodecElement element;
+      element.name = tokens[1];
+      element.count = atoi(tokens[2]);
+      elements.push_back(element);
+    }
+    else if (!strcmp(tokens[0], "property")) {
+      if (elements.empty()) return 0;
+      R3PlyCodecProperty property;
+      if ((ntokens >= 5) && !strcmp(tokens[1], "list")) {
+        property.count_type = ParsePlyType(tokens[2]);
+        property.type = ParsePlyType(tokens[3]);
+        property.name = tokens[4];
+        if (!property.count_type || !property.type) return 0;
+      }
+      else if (ntokens >= 3) {
+        property.count_type = 0;
+        property.type = ParsePlyType(tokens[1]);
+        property.name = tokens[2];
+        if (!property.type) return 0;
+      }
+      else {
+        return 0;
+      }
+      property.offset = 0;
+      elements.back().properties.push_back(property);
+    }
+  }
+
+  // Did not find end of header
+  return 0;
+}
+
+
+
+static int
+FixedRecordSize(R3PlyCodecElement& element)
+{
+  // Compute property offsets and return record size (or 0 if record has lists)
+  int size = 0;
+  for (unsigned int j = 0; j < element.properties.size(); j++) {
+    R3PlyCodecProperty& property = element.properties[j];
+    if (property.count_type) return 0;
+    property.offset = size;
+    size += PlyTypeSize(property.type);
+  }
+  return size;
+}
+
+
+
+static const unsigned char *
+SkipRecord(const R3PlyCodecElement& element, const unsigned char *p, const unsigned char *end, int swap)
+{
+  // Return pointer past record (or NULL if record extends beyond end)
+  for (unsigned int j = 0; j < element.properties.size(); j++) {
+    const R3PlyCodecProperty& property = element.properties[j];
+    if (property.count_type) {
+      if (p + PlyTypeSize(property.count_type) > end) return NULL;
+      int count = LoadIndex(p, property.count_type, swap);
+      if (count < 0) return NULL;
+      p += PlyTypeSize(property.count_type) + (size_t) count * PlyTypeSize(property.type);
+    }
+    else {
+      p += PlyTypeSize(property.type);
+    }
+    if (p > end) return NULL;
+  }
+  return p;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Element decoding functions
+////////////////////////////////////////////////////////////////////////
+
+static const unsigned char *
+DecodeVertices(R3PlyCodecElement& element, const unsigned char *p, const unsigned char *end,
+  int swap, R3PlyMesh *mesh)
+{
+  // Check records (vertices with list properties are not supported)
+  int stride = FixedRecordSize(element);
+  if (stride == 0) return NULL;
+  int n = element.count;
+  if (p + (size_t) n * stride > end) return NULL;
+
+  // Find properties
+  const R3PlyCodecProperty *props[11] = { NULL };
+  const char *names[11] = { "x", "y", "z", "nx", "ny", "nz", "tx", "ty", "red", "green", "blue" };
+  for (unsigned int j = 0; j < element.properties.size(); j++) {
+    for (int k = 0; k < 11; k++) {
+      if (element.properties[j].name == names[k]) props[k] = &element.properties[j];
+    }
+  }
+
+  // Allocate arrays
+  mesh->positions.assign(3 * (size_t) n, 0.0F);
+  if (props[3] || props[4] || props[5]) mesh->normals.assign(3 * (size_t) n, 0.0F);
+  if (props[6] || props[7]) mesh->texcoords.assign(2 * (size_t) n, 0.0F);
+  if (props[8] || props[9] || props[10]) mesh->colors.assign(3 * (size_t) n, 0);
+
+  // Create columns
+  R3PlyCodecDecodeJob job;
+  job.nrecords = n;
+  job.stride = stride;
+  job.swap = swap;
+  job.list_data = NULL;
+  for (int k = 0; k < 11; k++) {
+    if (!props[k]) continue;
+    R3PlyCodecColumn column;
+    column.data = p + props[k]->offset;
+    column.type = props[k]->type;
+    column.scale = 1;
+    column.float_values = NULL;
+    column.uchar_values = NULL;
+    column.int_values = NULL;
+    if (k < 3) { column.float_values = &mesh->positions[k]; column.value_stride = 3; }
+    else if (k < 6) { column.float_values = &mesh->normals[k-3]; column.value_stride = 3; }
+    else if (k < 8) { column.float_values = &mesh->texcoords[k-6]; column.value_stride = 2; }
+    else {
+      column.uchar_values = &mesh->colors[k-8]; column.value_stride = 3;
+      if ((column.type == PLY_FLOAT) || (column.type == PLY_DOUBLE)) column.scale = 255.0;
+    }
+    job.columns.push_back(column);
+  }
+
+  // Decode records
+  RunDecodeJob(job);
+
+  // Return pointer past vertices
+  return p + (size_t) n * stride;
+}
+
+
+
+static const unsigned char *
+DecodeFacesWithFixedLayout(R3PlyCodecElement& element, const unsigned char *p, const unsigned char *end,
+  int swap, int nvertices, R3PlyMesh *mesh)
+{
+  // Compute layout assuming every list has same count as first one
+  int stride = 0;
+  int list_count = 0;
+  const R3PlyCodecProperty *list_property = NULL;
+  const R3PlyCodecProperty *props[3] = { NULL, NULL, NULL };
+  const char *names[3] = { "material_id", "segment_id", "category_id" };
+  for (unsigned int j = 0; j < element.properties.size(); j++) {
+    R3PlyCodecProperty& property = element.properties[j];
+    property.offset = stride;
+    if (property.count_type) {
+      if (list_property) return NULL;
+      if ((property.name != "vertex_indices") && (property.name != "vertex_index")) return NULL;
+      if (p + stride + PlyTypeSize(property.count_type) > end) return NULL;
+      list_count = LoadIndex(p + stride, property.count_type, swap);
+      if (list_count < 3) return NULL;
+      stride += PlyTypeSize(property.count_type) + list_count * PlyTypeSize(property.type);
+      list_property = &property;
+    }
+    else {
+      for (int k = 0; k < 3; k++) if (property.name == names[k]) props[k] = &property;
+      stride += PlyTypeSize(property.type);
+    }
+  }
+
+  // Check layout
+  int n = element.count;
+  if (!list_property) return NULL;
+  if (p + (size_t) n * stride > end) return NULL;
+
+  // Allocate arrays
+  int ntriangles = list_count - 2;
+  mesh->indices.assign(3 * (size_t) n * ntriangles, 0);
+  std::vector<int> face_attributes[3];
+  for (int k = 0; k < 3; k++) if (props[k]) face_attributes[k].assign(n, -1);
+
+  // Create decode job
+  R3PlyCodecDecodeJob job;
+  job.nrecords = n;
+  job.stride = stride;
+  job.swap = swap;
+  job.list_data = p + list_property->offset;
+  job.list_count_type = list_property->count_type;
+  job.list_index_type = list_property->type;
+  job.list_count = list_count;
+  job.nvertices = nvertices;
+  job.indices = (n > 0) ? &mesh->indices[0] : NULL;
+  for (int k = 0; k < 3; k++) {
+    if (!props[k] || (n == 0)) continue;
+    R3PlyCodecColumn column;
+    column.data = p + props[k]->offset;
+    column.type = props[k]->type;
+    column.scale = 1;
+    column.float_values = NULL;
+    column.uchar_values = NULL;
+    column.int_values = &face_attributes[k][0];
+    column.value_stride = 1;
+    job.columns.push_back(column);
+  }
+
+  // Decode records
+  RunDecodeJob(job);
+
+  // Check whether all lists had same count
+  RNBoolean all_valid = TRUE;
+  for (unsigned int c = 0; c < job.chunk_status.size(); c++) {
+    if (job.chunk_status[c] < 0) { mesh->indices.clear(); return NULL; }
+    if (job.chunk_status[c] == 0) all_valid = FALSE;
+  }
+
+  // Copy face attributes to triangles
+  std::vector<int> *triangle_attributes[3] = { &mesh->materials, &mesh->segments, &mesh->categories };
+  for (int k = 0; k < 3; k++) {
+    if (face_attributes[k].empty()) continue;
+    if (ntriangles == 1) { triangle_attributes[k]->swap(face_attributes[k]); continue; }
+    triangle_attributes[k]->resize((size_t) n * ntriangles);
+    for (int i = 0; i < n; i++) {
+      for (int t = 0; t < ntriangles; t++) (*triangle_attributes[k])[i*ntriangles + t] = face_attributes[k][i];
+    }
+  }
+
+  // Remove triangles with repeated or invalid vertices
+  if (!all_valid) {
+    int count = 0;
+    int ntotal = n * ntriangles;
+    for (int t = 0; t < ntotal; t++) {
+      int i0 = mesh->indices[3*t+0], i1 = mesh->indices[3*t+1], i2 = mesh->indices[3*t+2];
+      if ((i0 < 0) || (i1 < 0) || (i2 < 0)) continue;
+      if ((i0 >= nvertices) || (i1 >= nvertices) || (i2 >= nvertices)) continue;
+      if ((i0 == i1) || (i1 == i2) || (i0 == i2)) continue;
+      mesh->indices[3*count+0] = i0;
+      mesh->indices[3*count+1] = i1;
+      mesh->indices[3*count+2] = i2;
+      for (int k = 0; k < 3; k++) {
+        if (!triangle_attributes[k]->empty()) (*triangle_attributes[k])[count] = (*triangle_attributes[k])[t];
+      }
+      count++;
+    }
+    mesh->indices.resize(3 * (size_t) count);
+    for (int k = 0; k < 3; k++) {
+      if (!triangle_attributes[k]->empty()) triangle_attributes[k]->resize(count);
+    }
+  }
+
+  // Return pointer past faces
+  return p + (size_t) n * stride;
+}
+
+
+
+static const unsigned char *
+DecodeFaces(R3PlyCodecElement& element, const unsigned char *p, const unsigned char *end,
+  int swap, int nvertices, R3PlyMesh *mesh)
+{
+  // Try fast path (all faces have same number of vertices)
+  const unsigned char *next = DecodeFacesWithFixedLayout(element, p, end, swap, nvertices, mesh);
+  if (next) return next;
+
+  // Clear arrays
+  mesh->indices.clear();
+  mesh->materials.clear();
+  mesh->segments.clear();
+  mesh->categories.clear();
+
+  // Check which attributes are present
+  RNBoolean has_attribute[3] = { FALSE, FALSE, FALSE };
+  const char *names[3] = { "material_id", "segment_id", "category_id" };
+  for (unsigned int j = 0; j < element.properties.size(); j++) {
+    for (int k = 0; k < 3; k++) if (element.properties[j].name == names[k]) has_attribute[k] = TRUE;
+  }
+
+  // Decode records one at a time
+  std::vector<int> *triangle_attributes[3] = { &mesh->materials, &mesh->segments, &mesh->categories };
+  mesh->indices.reserve(3 * (size_t) element.count);
+  for (int i = 0; i < element.count; i++) {
+    // Read properties of record
+    int attributes[3] = { -1, -1, -1 };
+    const unsigned char *list = NULL;
+    int list_count = 0, list_index_type = 0, list_index_size = 0;
+    for (unsigned int j = 0; j < element.properties.size(); j++) {
+      const R3PlyCodecProperty& property = element.properties[j];
+      if (property.count_type) {
+        int count_size = PlyTypeSize(property.count_type);
+        if (p + count_size > end) return NULL;
+        int count = LoadIndex(p, property.count_type, swap);
+        int index_size = PlyTypeSize(property.type);
+        if ((count < 0) || (p + count_size + (size_t) count * index_size > end)) return NULL;
+        if ((property.name == "vertex_indices") || (property.name == "vertex_index")) {
+          list = p + count_size;
+          list_count = count;
+          list_index_type = property.type;
+          list_index_size = index_size;
+        }
+        p += count_size + (size_t) count * index_size;
+      }
+      else {
+        if (p + PlyTypeSize(property.type) > end) return NULL;
+        for (int k = 0; k < 3; k++) {
+          if (property.name == names[k]) attributes[k] = LoadIndex(p, property.type, swap);
+        }
+        p += PlyTypeSize(property.type);
+      }
+    }
+
+    // Create triangles (fan around first vertex)
+    if (!list) continue;
+    int i0 = LoadIndex(list, list_index_type, swap);
+    for (int k = 2; k < list_count; k++) {
+      int i1 = LoadIndex(list + (k - 1) * list_index_size, list_index_type, swap);
+      int i2 = LoadIndex(list + k * list_index_size, list_index_type, swap);
+      if ((i0 < 0) || (i1 < 0) || (i2 < 0)) continue;
+      if ((i0 >= nvertices) || (i1 >= nvertices) || (i2 >= nvertices)) continue;
+      if ((i0 == i1) || (i1 == i2) || (i0 == i2)) continue;
+      mesh->indices.push_back(i0);
+      mesh->indices.push_back(i1);
+      mesh->indices.push_back(i2);
+      for (int a = 0; a < 3; a++) {
+        if (has_attribute[a]) triangle_attributes[a]->push_back(attributes[a]);
+      }
+    }
+  }
+
+  // Return pointer past faces
+  return p;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// R3PlyMesh member functions
+////////////////////////////////////////////////////////////////////////
+
+R3PlyMesh::
+R3PlyMesh(void)
+  : positions(),
+    normals(),
+    texcoords(),
+    colors(),
+    indices(),
+    materials(),
+    segments(),
+    categories()
+{
+}
+
+
+
+int R3PlyMesh::
+LoadMesh(const R3Mesh& mesh)
+{
+  // Remove previous contents
+  Empty();
+
+  // Check which optional data is present
+  RNBoolean has_texcoords = FALSE, has_colors = FALSE;
+  for (int i = 0; i < mesh.NVertices(); i++) {
+    R3MeshVertex *vertex = mesh.Vertex(i);
+    if (!mesh.VertexTextureCoords(vertex).IsZero()) has_texcoords = TRUE;
+    if (!mesh.VertexColor(vertex).IsBlack()) has_colors = TRUE;
+  }
+  RNBoolean has_attribute[3] = { FALSE, FALSE, FALSE };
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    if (mesh.FaceMaterial(face) != -1) has_attribute[0] = TRUE;
+    if (mesh.FaceSegment(face) != -1) has_attribute[1] = TRUE;
+    if (mesh.FaceCategory(face) != -1) has_attribute[2] = TRUE;
+  }
+
+  // Copy vertices
+  positions.reserve(3 * mesh.NVertices());
+  normals.reserve(3 * mesh.NVertices());
+  for (int i = 0; i < mesh.NVertices(); i++) {
+    R3MeshVertex *vertex = mesh.Vertex(i);
+    const R3Point& position = mesh.VertexPosition(vertex);
+    const R3Vector& normal = mesh.VertexNormal(vertex);
+    for (int dim = 0; dim < 3; dim++) positions.push_back(position[dim]);
+    for (int dim = 0; dim < 3; dim++) normals.push_back(normal[dim]);
+    if (has_texcoords) {
+      const R2Point& t = mesh.VertexTextureCoords(vertex);
+      texcoords.push_back(t.X());
+      texcoords.push_back(t.Y());
+    }
+    if (has_colors) {
+      const RNRgb& c = mesh.VertexColor(vertex);
+      for (int k = 0; k < 3; k++) {
+        unsigned char value;
+        StoreValue(255.0 * c[k], &value);
+        colors.push_back(value);
+      }
+    }
+  }
+
+  // Copy faces
+  indices.reserve(3 * mesh.NFaces());
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    for (int k = 0; k < 3; k++) indices.push_back(mesh.VertexID(mesh.VertexOnFace(face, k)));
+    if (has_attribute[0]) materials.push_back(mesh.FaceMaterial(face));
+    if (has_attribute[1]) segments.push_back(mesh.FaceSegment(face));
+    if (has_attribute[2]) categories.push_back(mesh.FaceCategory(face));
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+void R3PlyMesh::
+Empty(void)
+{
+  // Remove all data
+  positions.clear();
+  normals.clear();
+  texcoords.clear();
+  colors.clear();
+  indices.clear();
+  materials.clear();
+  segments.clear();
+  categories.clear();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Read functions
+////////////////////////////////////////////////////////////////////////
+
+int
+R3ReadBinaryPlyMesh(FILE *fp, R3PlyMesh *mesh)
+{
+  // Remember start of stream (unseekable streams are left to ply.cpp)
+  unsigned long long start = RNFileTell(fp);
+  if (!RNFileSeek(fp, start, SEEK_SET)) return -1;
+
+  // Read header
+  int file_type = 0;
+  std::vector<R3PlyCodecElement> elements;
+  if (!ReadPlyHeader(fp, &file_type, elements)) {
+    RNFail("Unable to read ply file header");
+    return 0;
+  }
+
+  // Check whether file can be decoded here
+  RNBoolean supported = (file_type == PLY_BINARY_LE) || (file_type == PLY_BINARY_BE);
+  for (unsigned int i = 0; i < elements.size(); i++) {
+    if (elements[i].name == "range_grid") supported = FALSE;
+    if ((elements[i].name == "vertex") && !FixedRecordSize(elements[i])) supported = FALSE;
+  }
+  if (!supported) {
+    RNFileSeek(fp, start, SEEK_SET);
+    return -1;
+  }
+
+  // Determine size of data following header
+  unsigned long long data_start = RNFileTell(fp);
+  if (!RNFileSeek(fp, 0, SEEK_END)) return 0;
+  unsigned long long data_end = RNFileTell(fp);
+  if (!RNFileSeek(fp, data_start, SEEK_SET)) return 0;
+  size_t data_size = (data_end > data_start) ? (size_t) (data_end - data_start) : 0;
+
+  // Read all data with one bulk read
+  unsigned char *data = new unsigned char [ data_size + 1 ];
+  if (!data) {
+    RNFail("Unable to allocate %lu bytes for ply file", (unsigned long) data_size);
+    return 0;
+  }
+  if (fread(data, 1, data_size, fp) != data_size) {
+    RNFail("Unable to read ply file data");
+    delete [] data;
+    return 0;
+  }
+
+  // Decode elements
+  mesh->Empty();
+  int swap = ((file_type == PLY_BINARY_LE) != IsHostLittleEndian()) ? 1 : 0;
+  const unsigned char *p = data;
+  const unsigned char *end = data + data_size;
+  for (unsigned int i = 0; i < elements.size(); i++) {
+    R3PlyCodecElement& element = elements[i];
+    if (element.name == "vertex") {
+      p = DecodeVertices(element, p, end, swap, mesh);
+    }
+    else if (element.name == "face") {
+      p = DecodeFaces(element, p, end, swap, mesh->NVertices(), mesh);
+    }
+    else {
+      int stride = FixedRecordSize(element);
+      if (stride > 0) p = (p + (size_t) element.count * stride <= end) ? p + (size_t) element.count * stride : NULL;
+      else for (int j = 0; p && (j < element.count); j++) p = SkipRecord(element, p, end, swap);
+    }
+    if (!p) {
+      RNFail("Unexpected end of ply file data in element %s", element.name.c_str());
+      delete [] data;
+      return 0;
+    }
+  }
+
+  // Leave stream just past the mesh data (the bulk read went to the end of file)
+  unsigned long long mesh_end = data_start + (unsigned long long) (p - data);
+  if (!RNFileSeek(fp, mesh_end, SEEK_SET)) {
+    RNFail("Unable to seek to end of ply mesh data");
+    delete [] data;
+    return 0;
+  }
+
+  // Delete data
+  delete [] data;
+
+  // Return success
+  return 1;
+}
+
+
+
+int
+R3ReadPlyMesh(FILE *fp, R3PlyMesh *mesh)
+{
+  // Read binary files directly
+  int status = R3ReadBinaryPlyMesh(fp, mesh);
+  if (status >= 0) return status;
+
+  // Read other files with ply.cpp
+  R3Mesh tmp;
+  if (!tmp.ReadPlyStream(fp)) return 0;
+  return mesh->LoadMesh(tmp);
+}
+
+
+
+int
+R3ReadPlyMeshFile(const char *filename, R3PlyMesh *mesh)
+{
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    RNFail("Unable to open file: %s", filename);
+    return 0;
+  }
+
+  // Read file
+  int status = R3ReadPlyMesh(fp, mesh);
+
+  // Close file
+  fclose(fp);
+
+  // Return status
+  return status;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Write functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+EncodeVertexChunk(int chunk, int /* thread_index */, void *data)
+{
+  // Get range of vertices
+  R3PlyCodecEncodeJob *job = (R3PlyCodecEncodeJob *) data;
+  const R3PlyMesh *mesh = job->mesh;
+  int start = job->first_record + chunk * job->chunk_size;
+  int end = start + job->chunk_size;
+  if (end > job->first_record + job->nrecords) end = job->first_record + job->nrecords;
+
+  // Pack vertex records (in native byte order)
+  unsigned char *p = job->buffer + (size_t) (start - job->first_record) * job->stride;
+  for (int i = start; i < end; i++) {
+    memcpy(p, &mesh->positions[3*i], 3 * sizeof(float)); p += 3 * sizeof(float);
+    if (!mesh->normals.empty()) { memcpy(p, &mesh->normals[3*i], 3 * sizeof(float)); p += 3 * sizeof(float); }
+    if (!mesh->texcoords.empty()) { memcpy(p, &mesh->texcoords[2*i], 2 * sizeof(float)); p += 2 * sizeof(float); }
+    if (!mesh->colors.empty()) { memcpy(p, &mesh->colors[3*i], 3); p += 3; }
+  }
+}
+
+
+
+static void
+EncodeFaceChunk(int chunk, int /* thread_index */, void *data)
+{
+  // Get range of faces
+  R3PlyCodecEncodeJob *job = (R3PlyCodecEncodeJob *) data;
+  const R3PlyMesh *mesh = job->mesh;
+  int start = job->first_record + chunk * job->chunk_size;
+  int end = start + job->chunk_size;
+  if (end > job->first_record + job->nrecords) end = job->first_record + job->nrecords;
+
+  // Pack face records (in native byte order)
+  unsigned char *p = job->buffer + (size_t) (start - job->first_record) * job->stride;
+  for (int i = start; i < end; i++) {
+    *(p++) = 3;
+    memcpy(p, &mesh->indices[3*i], 3 * sizeof(int)); p += 3 * sizeof(int);
+    if (!mesh->materials.empty()) { memcpy(p, &mesh->materials[i], sizeof(int)); p += sizeof(int); }
+    if (!mesh->segments.empty()) { memcpy(p, &mesh->segments[i], sizeof(int)); p += sizeof(int); }
+    if (!mesh->categories.empty()) { memcpy(p, &mesh->categories[i], sizeof(int)); p += sizeof(int); }
+  }
+}
+
+
+
+static int
+WriteRecords(FILE *fp, const R3PlyMesh& mesh, int nrecords, int stride,
+  void (*callback)(int, int, void *))
+{
+  // Write records in blocks, each packed in parallel chunks
+  const int block_size = 1024 * 1024;
+  std::vector<unsigned char> buffer((size_t) stride * ((nrecords < block_size) ? nrecords : block_size));
+  for (int block_start = 0; block_start < nrecords; block_start += block_size) {
+    int n = nrecords - block_start;
+    if (n > block_size) n = block_size;
+    R3PlyCodecEncodeJob job;
+    job.mesh = &mesh;
+    job.buffer = &buffer[0];
+    job.stride = stride;
+    job.first_record = block_start;
+    job.nrecords = n;
+    job.chunk_size = 64 * 1024;
+    int nchunks = (n + job.chunk_size - 1) / job.chunk_size;
+    RNParallelFor(nchunks, callback, &job);
+    if (fwrite(&buffer[0], 1, (size_t) n * stride, fp) != (size_t) n * stride) {
+      RNFail("Unable to write ply file data");
+      return 0;
+    }
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int
+R3WriteBinaryPlyMesh(FILE *fp, const R3PlyMesh& mesh)
+{
+  // Check arrays
+  int nvertices = mesh.NVertices();
+  int nfaces = mesh.NFaces();
+  if (!mesh.normals.empty() && ((int) mesh.normals.size() != 3*nvertices)) return 0;
+  if (!mesh.texcoords.empty() && ((int) mesh.texcoords.size() != 2*nvertices)) return 0;
+  if (!mesh.colors.empty() && ((int) mesh.colors.size() != 3*nvertices)) return 0;
+  if (!mesh.materials.empty() && ((int) mesh.materials.size() != nfaces)) return 0;
+  if (!mesh.segments.empty() && ((int) mesh.segments.size() != nfaces)) return 0;
+  if (!mesh.categories.empty() && ((int) mesh.categories.size() != nfaces)) return 0;
+
+  // Write header
+  fprintf(fp, "ply\n");
+  fprintf(fp, "format %s 1.0\n", (IsHostLittleEndian()) ? "binary_little_endian" : "binary_big_endian");
+  fprintf(fp, "element vertex %d\n", nvertices);
+  fprintf(fp, "property float x\nproperty float y\nproperty float z\n");
+  if (!mesh.normals.empty()) fprintf(fp, "property float nx\nproperty float ny\nproperty float nz\n");
+  if (!mesh.texcoords.empty()) fprintf(fp, "property float tx\nproperty float ty\n");
+  if (!mesh.colors.empty()) fprintf(fp, "property uchar red\nproperty uchar green\nproperty uchar blue\n");
+  fprintf(fp, "element face %d\n", nfaces);
+  fprintf(fp, "property list uchar int vertex_indices\n");
+  if (!mesh.materials.empty()) fprintf(fp, "property int material_id\n");
+  if (!mesh.segments.empty()) fprintf(fp, "property int segment_id\n");
+  if (!mesh.categories.empty()) fprintf(fp, "property int category_id\n");
+  fprintf(fp, "end_header\n");
+
+  // Compute record sizes
+  int vertex_stride = 3 * sizeof(float);
+  if (!mesh.normals.empty()) vertex_stride += 3 * sizeof(float);
+  if (!mesh.texcoords.empty()) vertex_stride += 2 * sizeof(float);
+  if (!mesh.colors.empty()) vertex_stride += 3;
+  int face_stride = 1 + 3 * sizeof(int);
+  if (!mesh.materials.empty()) face_stride += sizeof(int);
+  if (!mesh.segments.empty()) face_stride += sizeof(int);
+  if (!mesh.categories.empty()) face_stride += sizeof(int);
+
+  // Write records
+  if (!WriteRecords(fp, mesh, nvertices, vertex_stride, EncodeVertexChunk)) return 0;
+  if (!WriteRecords(fp, mesh, nfaces, face_stride, EncodeFaceChunk)) return 0;
+
+  // Return success
+  return 1;
+}
+
+
+
+} // namespace gaps
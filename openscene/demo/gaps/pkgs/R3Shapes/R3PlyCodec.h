@@ -0,0 +1,90 @@
+// Include file for fast binary ply mesh reading and writing
+#ifndef __R3__PLY__CODEC__H__
+#define __R3__PLY__CODEC__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Mesh data read from or written to a ply file
+
+struct R3PlyMesh {
+  // Constructor
+  R3PlyMesh(void);
+
+  // Property functions
+  int NVertices(void) const;
+  int NFaces(void) const;
+
+  // Manipulation functions
+  int LoadMesh(const R3Mesh& mesh);
+  void Empty(void);
+
+  // Vertex data (optional arrays are empty if not in file)
+  std::vector<float> positions;       // three per vertex
+  std::vector<float> normals;         // three per vertex (optional)
+  std::vector<float> texcoords;       // two per vertex (optional)
+  std::vector<unsigned char> colors;  // three per vertex (optional)
+
+  // Face data (polygons are split into fans of triangles, and
+  // triangles with repeated or invalid vertex indices are skipped)
+  std::vector<int> indices;           // three per triangle
+  std::vector<int> materials;         // one per triangle (optional)
+  std::vector<int> segments;          // one per triangle (optional)
+  std::vector<int> categories;        // one per triangle (optional)
+};
+
+
+
+// Binary ply functions (read leaves the stream just past the last element,
+// or returns -1 and restores the stream position if the file is ascii or
+// has elements that only the ply.cpp reader handles)
+
+int R3ReadBinaryPlyMesh(FILE *fp, R3PlyMesh *mesh);
+int R3WriteBinaryPlyMesh(FILE *fp, const R3PlyMesh& mesh);
+
+
+
+// General ply functions (ascii files are read with ply.cpp through R3Mesh)
+
+int R3ReadPlyMesh(FILE *fp, R3PlyMesh *mesh);
+int R3ReadPlyMeshFile(const char *filename, R3PlyMesh *mesh);
+
+
+
+// Inline functions
+
+inline int R3PlyMesh::
+NVertices(void) const
+{
+  // Return number of vertices
+  return (int) (positions.size() / 3);
+}
+
+
+
+inline int R3PlyMesh::
+NFaces(void) const
+{
+  // Return number of triangles
+  return (int) (indices.size() / 3);
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -46,11 +46,14 @@ class R3Circle;
 class R3Ellipse;
 class R3Rectangle;
 class R3Mesh;
+struct R3PlyMesh;
 class R3Curve;
 class R3Polyline;
 class R3CatmullRomSpline;
 class R3PlanarGrid;
 class R3Grid;
+class R3SparseGrid;
+class R3CompactGrid;
 }
 
 
@@ -106,6 +109,7 @@ class R3Grid;
 #include "R3Ellipse.h"
 #include "R3Rectangle.h"
 #include "R3Mesh.h"
+#include "R3IndexedMesh.h"
 #include "R3PlanarGrid.h"        
 
 
@@ -133,6 +137,8 @@ class R3Grid;
 #include "R3Ellipsoid.h"
 #include "R3Frustum.h"
 #include "R3Grid.h"        
+#include "R3SparseGrid.h"
+#include "R3CompactGrid.h"
 
 
 
@@ -146,6 +152,7 @@ class R3Grid;
 #include "R3Relate.h"
 #include "R3Align.h"
 #include "R3Kdtree.h"
+#include "R3TriangleBVH.h"
 
 
 /* Mesh utility include files */
@@ -153,6 +160,9 @@ class R3Grid;
 #include "R3MeshSearchTree.h"
 #include "R3MeshProperty.h"
 #include "R3MeshPropertySet.h"
+#include "R3MeshPropertyFile.h"
+#include "R3MeshGeodesics.h"
+#include "R3PlyCodec.h"
 
 
 
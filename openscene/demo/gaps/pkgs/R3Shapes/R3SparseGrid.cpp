@@ -0,0 +1,1712 @@
+// Source file for GAPS sparse scalar grid class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes.h"
+#include <algorithm>
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Utility macros
+////////////////////////////////////////////////////////////////////////
+
+#define R3_SPARSE_GRID_BLOCK_MASK (R3_SPARSE_GRID_BLOCK_SIZE - 1)
+#define R3_SPARSE_GRID_MAX_RESOLUTION ((1 << (21 + R3_SPARSE_GRID_BLOCK_BITS)) - R3_SPARSE_GRID_BLOCK_SIZE)
+
+static inline RNInt64
+BlockKey(int bi, int bj, int bk)
+{
+  // Return hash key for block coordinates (21 bits each)
+  return ((RNInt64) bk << 42) | ((RNInt64) bj << 21) | (RNInt64) bi;
+}
+
+
+
+static inline int
+BlockValueIndex(int li, int lj, int lk)
+{
+  // Return index of value at local coordinates within block
+  return ((lk << R3_SPARSE_GRID_BLOCK_BITS) + lj) * R3_SPARSE_GRID_BLOCK_SIZE + li;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3SparseGrid::
+R3SparseGrid(int xresolution, int yresolution, int zresolution, RNScalar background_value)
+  : grid_to_world_transform(R3identity_affine),
+    world_to_grid_transform(R3identity_affine),
+    world_to_grid_scale_factor(1.0),
+    grid_to_world_scale_factor(1.0),
+    background_value(background_value)
+{
+  // Set grid resolution
+  assert(xresolution <= R3_SPARSE_GRID_MAX_RESOLUTION);
+  assert(yresolution <= R3_SPARSE_GRID_MAX_RESOLUTION);
+  assert(zresolution <= R3_SPARSE_GRID_MAX_RESOLUTION);
+  grid_resolution[0] = xresolution;
+  grid_resolution[1] = yresolution;
+  grid_resolution[2] = zresolution;
+}
+
+
+
+R3SparseGrid::
+R3SparseGrid(const R3Box& bbox, RNLength spacing, int min_border, RNScalar background_value)
+  : grid_to_world_transform(R3identity_affine),
+    world_to_grid_transform(R3identity_affine),
+    world_to_grid_scale_factor(1.0),
+    grid_to_world_scale_factor(1.0),
+    background_value(background_value)
+{
+  // Initialize resolution
+  grid_resolution[0] = 0;
+  grid_resolution[1] = 0;
+  grid_resolution[2] = 0;
+
+  // Check for empty bounding box
+  if (bbox.IsEmpty() || (RNIsZero(spacing))) return;
+
+  // Compute inflated bbox (with room for border)
+  R3Box inflated_bbox = bbox;
+  if (min_border > 0) {
+    inflated_bbox[0] -= spacing * min_border * R3ones_vector;
+    inflated_bbox[1] += spacing * min_border * R3ones_vector;
+  }
+
+  // Compute inflated box (if would otherwise have zero volume)
+  for (int i = 0; i < 3; i++) {
+    if (inflated_bbox[0][i] == inflated_bbox[1][i]) {
+      inflated_bbox[0][i] -= RN_EPSILON;
+      inflated_bbox[1][i] += RN_EPSILON;
+    }
+  }
+
+  // Compute resolution (no volume is allocated, so it only has to fit block coordinates)
+  for (int i = 0; i < 3; i++) {
+    RNScalar resolution = inflated_bbox.AxisLength((RNAxis) i) / spacing + 0.5;
+    if (resolution > R3_SPARSE_GRID_MAX_RESOLUTION) {
+      RNFail("Sparse grid resolution is too large: %g\n", resolution);
+      grid_resolution[0] = grid_resolution[1] = grid_resolution[2] = 0;
+      return;
+    }
+    grid_resolution[i] = (int) resolution;
+  }
+
+  // Set transformations
+  SetWorldToGridTransformation(inflated_bbox);
+}
+
+
+
+R3SparseGrid::
+R3SparseGrid(const R3Grid& grid, RNScalar background_value)
+  : background_value(background_value)
+{
+  // Copy resolution and transformations
+  grid_resolution[0] = grid.XResolution();
+  grid_resolution[1] = grid.YResolution();
+  grid_resolution[2] = grid.ZResolution();
+  SetWorldToGridTransformation(grid.WorldToGridTransformation());
+
+  // Allocate blocks that have values different from background
+  for (int k0 = 0; k0 < grid_resolution[2]; k0 += R3_SPARSE_GRID_BLOCK_SIZE) {
+    for (int j0 = 0; j0 < grid_resolution[1]; j0 += R3_SPARSE_GRID_BLOCK_SIZE) {
+      for (int i0 = 0; i0 < grid_resolution[0]; i0 += R3_SPARSE_GRID_BLOCK_SIZE) {
+        int i1 = i0 + R3_SPARSE_GRID_BLOCK_SIZE;
+        int j1 = j0 + R3_SPARSE_GRID_BLOCK_SIZE;
+        int k1 = k0 + R3_SPARSE_GRID_BLOCK_SIZE;
+        if (i1 > grid_resolution[0]) i1 = grid_resolution[0];
+        if (j1 > grid_resolution[1]) j1 = grid_resolution[1];
+        if (k1 > grid_resolution[2]) k1 = grid_resolution[2];
+
+        // Check if any value is different from background
+        RNBoolean empty = TRUE;
+        for (int k = k0; empty && (k < k1); k++) {
+          for (int j = j0; empty && (j < j1); j++) {
+            for (int i = i0; i < i1; i++) {
+              if ((float) grid.GridValue(i, j, k) != this->background_value) { empty = FALSE; break; }
+            }
+          }
+        }
+        if (empty) continue;
+
+        // Copy values into block
+        R3SparseGridBlock *block = AllocateBlock(i0, j0, k0);
+        for (int k = k0; k < k1; k++) {
+          for (int j = j0; j < j1; j++) {
+            for (int i = i0; i < i1; i++) {
+              block->values[BlockValueIndex(i - i0, j - j0, k - k0)] = grid.GridValue(i, j, k);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+
+
+R3SparseGrid::
+R3SparseGrid(const R3SparseGrid& grid)
+  : background_value(0)
+{
+  // Copy everything
+  grid_resolution[0] = grid_resolution[1] = grid_resolution[2] = 0;
+  *this = grid;
+}
+
+
+
+R3SparseGrid::
+~R3SparseGrid(void)
+{
+  // Deallocate blocks
+  for (unsigned int i = 0; i < blocks.size(); i++) delete blocks[i];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Property functions
+////////////////////////////////////////////////////////////////////////
+
+RNInterval R3SparseGrid::
+Range(void) const
+{
+  // Find range of values in allocated blocks
+  RNScalar minimum = FLT_MAX;
+  RNScalar maximum = -FLT_MAX;
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    const float *values = blocks[b]->values;
+    for (int i = 0; i < R3_SPARSE_GRID_BLOCK_VOLUME; i++) {
+      if (values[i] < minimum) minimum = values[i];
+      if (values[i] > maximum) maximum = values[i];
+    }
+  }
+
+  // Include background value if some grid points are not allocated
+  RNInt64 nvalues = (RNInt64) grid_resolution[0] * grid_resolution[1] * grid_resolution[2];
+  if (NAllocatedValues() < nvalues) {
+    if (background_value < minimum) minimum = background_value;
+    if (background_value > maximum) maximum = background_value;
+  }
+
+  // Return range of values
+  if (minimum > maximum) return RNnull_interval;
+  return RNInterval(minimum, maximum);
+}
+
+
+
+RNInt64 R3SparseGrid::
+MemoryUsage(void) const
+{
+  // Return approximate number of bytes used by blocks and hash table
+  RNInt64 nbytes = sizeof(R3SparseGrid);
+  nbytes += (RNInt64) blocks.capacity() * sizeof(R3SparseGridBlock *);
+  nbytes += (RNInt64) blocks.size() * sizeof(R3SparseGridBlock);
+  nbytes += (RNInt64) block_indices.bucket_count() * sizeof(void *);
+  nbytes += (RNInt64) block_indices.size() * (sizeof(std::pair<RNInt64, int>) + sizeof(void *));
+  return nbytes;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Value access functions
+////////////////////////////////////////////////////////////////////////
+
+RNScalar R3SparseGrid::
+GridValue(RNCoord x, RNCoord y, RNCoord z) const
+{
+  // Check if within bounds
+  if ((x < 0) || (x > grid_resolution[0]-1)) return background_value;
+  if ((y < 0) || (y > grid_resolution[1]-1)) return background_value;
+  if ((z < 0) || (z > grid_resolution[2]-1)) return background_value;
+
+  // Trilinear interpolation
+  int ix1 = (int) x;
+  int iy1 = (int) y;
+  int iz1 = (int) z;
+  int ix2 = ix1 + 1;
+  int iy2 = iy1 + 1;
+  int iz2 = iz1 + 1;
+  if (ix2 >= grid_resolution[0]) ix2 = ix1;
+  if (iy2 >= grid_resolution[1]) iy2 = iy1;
+  if (iz2 >= grid_resolution[2]) iz2 = iz1;
+  RNScalar dx = x - ix1;
+  RNScalar dy = y - iy1;
+  RNScalar dz = z - iz1;
+  RNScalar value = 0.0;
+  value += GridValue(ix1, iy1, iz1) * (1.0-dx) * (1.0-dy) * (1.0-dz);
+  value += GridValue(ix1, iy1, iz2) * (1.0-dx) * (1.0-dy) * dz;
+  value += GridValue(ix1, iy2, iz1) * (1.0-dx) * dy * (1.0-dz);
+  value += GridValue(ix1, iy2, iz2) * (1.0-dx) * dy * dz;
+  value += GridValue(ix2, iy1, iz1) * dx * (1.0-dy) * (1.0-dz);
+  value += GridValue(ix2, iy1, iz2) * dx * (1.0-dy) * dz;
+  value += GridValue(ix2, iy2, iz1) * dx * dy * (1.0-dz);
+  value += GridValue(ix2, iy2, iz2) * dx * dy * dz;
+  return value;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Block manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+R3SparseGridBlock *R3SparseGrid::
+AllocateBlock(int i, int j, int k)
+{
+  // Return block containing grid point if it is already allocated
+  int bi = i >> R3_SPARSE_GRID_BLOCK_BITS;
+  int bj = j >> R3_SPARSE_GRID_BLOCK_BITS;
+  int bk = k >> R3_SPARSE_GRID_BLOCK_BITS;
+  RNInt64 key = BlockKey(bi, bj, bk);
+  std::unordered_map<RNInt64, int>::const_iterator it = block_indices.find(key);
+  if (it != block_indices.end()) return blocks[it->second];
+
+  // Allocate block filled with background value
+  R3SparseGridBlock *block = new R3SparseGridBlock();
+  block->origin[0] = bi << R3_SPARSE_GRID_BLOCK_BITS;
+  block->origin[1] = bj << R3_SPARSE_GRID_BLOCK_BITS;
+  block->origin[2] = bk << R3_SPARSE_GRID_BLOCK_BITS;
+  for (int v = 0; v < R3_SPARSE_GRID_BLOCK_VOLUME; v++) block->values[v] = background_value;
+
+  // Insert block
+  block_indices[key] = (int) blocks.size();
+  blocks.push_back(block);
+
+  // Return block
+  return block;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Grid manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+R3SparseGrid& R3SparseGrid::
+operator=(const R3SparseGrid& grid)
+{
+  // Check for self assignment
+  if (this == &grid) return *this;
+
+  // Delete blocks
+  Clear(grid.background_value);
+
+  // Copy resolution and transformations
+  grid_resolution[0] = grid.grid_resolution[0];
+  grid_resolution[1] = grid.grid_resolution[1];
+  grid_resolution[2] = grid.grid_resolution[2];
+  grid_to_world_transform = grid.grid_to_world_transform;
+  world_to_grid_transform = grid.world_to_grid_transform;
+  world_to_grid_scale_factor = grid.world_to_grid_scale_factor;
+  grid_to_world_scale_factor = grid.grid_to_world_scale_factor;
+
+  // Copy blocks
+  blocks.resize(grid.blocks.size());
+  for (unsigned int i = 0; i < grid.blocks.size(); i++) {
+    blocks[i] = new R3SparseGridBlock(*(grid.blocks[i]));
+  }
+  block_indices = grid.block_indices;
+
+  // Return this
+  return *this;
+}
+
+
+
+void R3SparseGrid::
+Clear(RNScalar value)
+{
+  // Deallocate all blocks, so that every grid point has value
+  for (unsigned int i = 0; i < blocks.size(); i++) delete blocks[i];
+  blocks.clear();
+  block_indices.clear();
+  background_value = value;
+}
+
+
+
+void R3SparseGrid::
+Prune(RNScalar tolerance)
+{
+  // Deallocate blocks whose values are all within tolerance of background
+  int nblocks = 0;
+  block_indices.clear();
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    R3SparseGridBlock *block = blocks[b];
+    RNBoolean empty = TRUE;
+    for (int i = 0; i < R3_SPARSE_GRID_BLOCK_VOLUME; i++) {
+      if (fabs(block->values[i] - background_value) > tolerance) { empty = FALSE; break; }
+    }
+    if (empty) { delete block; continue; }
+    int bi = block->origin[0] >> R3_SPARSE_GRID_BLOCK_BITS;
+    int bj = block->origin[1] >> R3_SPARSE_GRID_BLOCK_BITS;
+    int bk = block->origin[2] >> R3_SPARSE_GRID_BLOCK_BITS;
+    block_indices[BlockKey(bi, bj, bk)] = nblocks;
+    blocks[nblocks++] = block;
+  }
+  blocks.resize(nblocks);
+}
+
+
+
+void R3SparseGrid::
+Threshold(RNScalar threshold, RNScalar low, RNScalar high)
+{
+  // Set grid value to low (high) if less/equal (greater) than threshold
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    float *values = blocks[b]->values;
+    for (int i = 0; i < R3_SPARSE_GRID_BLOCK_VOLUME; i++) {
+      if (values[i] <= threshold) {
+        if (low != R3_GRID_KEEP_VALUE) values[i] = low;
+      }
+      else {
+        if (high != R3_GRID_KEEP_VALUE) values[i] = high;
+      }
+    }
+  }
+
+  // Update background value
+  if (background_value <= threshold) {
+    if (low != R3_GRID_KEEP_VALUE) background_value = low;
+  }
+  else {
+    if (high != R3_GRID_KEEP_VALUE) background_value = high;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Filtering functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3SparseGridFilterData {
+  const R3SparseGrid *grid;
+  int dim;
+  int radius;
+  const RNScalar *filter;
+  std::vector<float> *new_values;
+};
+
+
+
+static void
+DilateBlocks(R3SparseGrid *grid, int dim, int block_radius, RNBoolean (*is_seed)(const R3SparseGridBlock *, RNScalar), RNScalar value)
+{
+  // Gather origins of seed blocks (allocating blocks changes the block array)
+  std::vector<int> origins;
+  for (int b = 0; b < grid->NBlocks(); b++) {
+    const R3SparseGridBlock *block = grid->Block(b);
+    if (is_seed && !(*is_seed)(block, value)) continue;
+    origins.insert(origins.end(), block->origin, block->origin + 3);
+  }
+
+  // Allocate blocks within block_radius of seed blocks (along dim, or in all dimensions if dim is negative)
+  int lo[3] = { 0, 0, 0 }, hi[3] = { 0, 0, 0 };
+  for (int d = 0; d < 3; d++) {
+    if ((dim >= 0) && (d != dim)) continue;
+    lo[d] = -block_radius;
+    hi[d] = block_radius;
+  }
+  for (unsigned int o = 0; o < origins.size(); o += 3) {
+    for (int dk = lo[2]; dk <= hi[2]; dk++) {
+      int k = origins[o+2] + dk * R3_SPARSE_GRID_BLOCK_SIZE;
+      if ((k < 0) || (k >= grid->ZResolution())) continue;
+      for (int dj = lo[1]; dj <= hi[1]; dj++) {
+        int j = origins[o+1] + dj * R3_SPARSE_GRID_BLOCK_SIZE;
+        if ((j < 0) || (j >= grid->YResolution())) continue;
+        for (int di = lo[0]; di <= hi[0]; di++) {
+          int i = origins[o] + di * R3_SPARSE_GRID_BLOCK_SIZE;
+          if ((i < 0) || (i >= grid->XResolution())) continue;
+          grid->AllocateBlock(i, j, k);
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+ConvolveBlock(int block_index, int, void *data)
+{
+  // Get convenient variables
+  R3SparseGridFilterData *filter_data = (R3SparseGridFilterData *) data;
+  const R3SparseGrid *grid = filter_data->grid;
+  const R3SparseGridBlock *block = grid->Block(block_index);
+  const RNScalar *filter = filter_data->filter;
+  int dim = filter_data->dim;
+  int radius = filter_data->radius;
+  int resolution = grid->Resolution(dim);
+  float background_value = grid->BackgroundValue();
+  const int block_size = R3_SPARSE_GRID_BLOCK_SIZE;
+
+  // Find blocks along dim within filter radius
+  int block_radius = (radius + block_size - 1) / block_size;
+  int nneighbors = 2*block_radius + 1;
+  std::vector<const R3SparseGridBlock *> neighbors(nneighbors);
+  for (int n = 0; n < nneighbors; n++) {
+    int origin[3] = { block->origin[0], block->origin[1], block->origin[2] };
+    origin[dim] += (n - block_radius) * block_size;
+    neighbors[n] = ((origin[dim] >= 0) && (origin[dim] < resolution)) ? grid->FindBlock(origin[0], origin[1], origin[2]) : NULL;
+  }
+
+  // Convolve each line of block along dim
+  int stride = (dim == 0) ? 1 : ((dim == 1) ? block_size : block_size * block_size);
+  int line_size = nneighbors * block_size;
+  std::vector<float> line(line_size);
+  float *new_values = &(*filter_data->new_values)[block_index * R3_SPARSE_GRID_BLOCK_VOLUME];
+  for (int a = 0; a < block_size; a++) {
+    for (int b = 0; b < block_size; b++) {
+      // Compute index of first value in line
+      int first = 0;
+      if (dim == 0) first = BlockValueIndex(0, a, b);
+      else if (dim == 1) first = BlockValueIndex(a, 0, b);
+      else first = BlockValueIndex(a, b, 0);
+
+      // Gather values along line from neighbor blocks
+      for (int n = 0; n < nneighbors; n++) {
+        const R3SparseGridBlock *neighbor = neighbors[n];
+        for (int t = 0; t < block_size; t++) {
+          line[n*block_size + t] = (neighbor) ? neighbor->values[first + t*stride] : background_value;
+        }
+      }
+
+      // Compute weighted average of values inside grid
+      int center = block_radius * block_size;
+      for (int t = 0; t < block_size; t++) {
+        int c = block->origin[dim] + t;
+        if (c >= resolution) break;
+        int m0 = (c < radius) ? c : radius;
+        int m1 = (resolution - 1 - c < radius) ? resolution - 1 - c : radius;
+        RNScalar sum = filter[0] * line[center + t];
+        RNScalar weight = filter[0];
+        for (int m = 1; m <= m0; m++) { sum += filter[m] * line[center + t - m]; weight += filter[m]; }
+        for (int m = 1; m <= m1; m++) { sum += filter[m] * line[center + t + m]; weight += filter[m]; }
+        new_values[first + t*stride] = sum / weight;
+      }
+    }
+  }
+}
+
+
+
+void R3SparseGrid::
+Blur(RNScalar grid_sigma)
+{
+  // Check sigma
+  if (RNIsZero(grid_sigma)) return;
+
+  // Build filter (normalized by total weight inside grid, so constant factors do not matter)
+  RNScalar sigma = grid_sigma;
+  int filter_radius = (int) (3 * sigma + 0.5);
+  std::vector<RNScalar> filter(filter_radius + 1);
+  double denom = 2.0 * sigma * sigma;
+  for (int i = 0; i <= filter_radius; i++) {
+    filter[i] = exp(-i * i / denom);
+  }
+
+  // Convolve grid with filter in each dimension
+  int block_radius = (filter_radius + R3_SPARSE_GRID_BLOCK_SIZE - 1) / R3_SPARSE_GRID_BLOCK_SIZE;
+  for (int dim = 0; dim < 3; dim++) {
+    // Allocate blocks that the filter spreads values into
+    DilateBlocks(this, dim, block_radius, NULL, 0);
+
+    // Convolve blocks in parallel
+    std::vector<float> new_values(blocks.size() * R3_SPARSE_GRID_BLOCK_VOLUME);
+    R3SparseGridFilterData data;
+    data.grid = this;
+    data.dim = dim;
+    data.radius = filter_radius;
+    data.filter = &filter[0];
+    data.new_values = &new_values;
+    RNParallelFor(NBlocks(), ConvolveBlock, &data, 16);
+
+    // Copy new values into blocks (values beyond grid boundary keep background value)
+    for (unsigned int b = 0; b < blocks.size(); b++) {
+      R3SparseGridBlock *block = blocks[b];
+      const float *values = &new_values[b * R3_SPARSE_GRID_BLOCK_VOLUME];
+      for (int k = 0; k < R3_SPARSE_GRID_BLOCK_SIZE; k++) {
+        if (block->origin[2] + k >= grid_resolution[2]) break;
+        for (int j = 0; j < R3_SPARSE_GRID_BLOCK_SIZE; j++) {
+          if (block->origin[1] + j >= grid_resolution[1]) break;
+          for (int i = 0; i < R3_SPARSE_GRID_BLOCK_SIZE; i++) {
+            if (block->origin[0] + i >= grid_resolution[0]) break;
+            int index = BlockValueIndex(i, j, k);
+            block->values[index] = values[index];
+          }
+        }
+      }
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Distance transform functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3SparseGridDistanceData {
+  const R3SparseGrid *grid;
+  int radius;
+  float max_squared_distance;
+  std::vector<float> *new_values;
+  std::vector<std::vector<float> > thread_windows;
+  std::vector<std::vector<float> > thread_buffers;
+  std::vector<std::vector<int> > thread_indices;
+};
+
+
+
+static RNBoolean
+HasNonZeroValue(const R3SparseGridBlock *block, RNScalar)
+{
+  // Return whether block has any seed value
+  for (int i = 0; i < R3_SPARSE_GRID_BLOCK_VOLUME; i++) {
+    if (block->values[i] != 0) return TRUE;
+  }
+  return FALSE;
+}
+
+
+
+static void
+SquaredDistanceTransform1D(float *f, int n, int stride, float *buffer, int *v)
+{
+  // Compute lower envelope of parabolas rooted at samples (Felzenszwalb and Huttenlocher)
+  float *values = buffer;
+  float *z = values + n;
+  for (int q = 0; q < n; q++) values[q] = f[q*stride];
+  int k = 0;
+  v[0] = 0;
+  z[0] = -FLT_MAX;
+  z[1] = FLT_MAX;
+  for (int q = 1; q < n; q++) {
+    float s = ((values[q] + q*q) - (values[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+    while (s <= z[k]) {
+      k--;
+      s = ((values[q] + q*q) - (values[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k+1] = FLT_MAX;
+  }
+
+  // Fill in values of lower envelope
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k+1] < q) k++;
+    f[q*stride] = (q - v[k])*(q - v[k]) + values[v[k]];
+  }
+}
+
+
+
+static void
+TransformBlockDistances(int block_index, int thread_index, void *data)
+{
+  // Get convenient variables
+  R3SparseGridDistanceData *distance_data = (R3SparseGridDistanceData *) data;
+  const R3SparseGrid *grid = distance_data->grid;
+  const R3SparseGridBlock *block = grid->Block(block_index);
+  int radius = distance_data->radius;
+  float max_squared_distance = distance_data->max_squared_distance;
+  float *new_values = &(*distance_data->new_values)[block_index * R3_SPARSE_GRID_BLOCK_VOLUME];
+  const int block_size = R3_SPARSE_GRID_BLOCK_SIZE;
+
+  // Compute window of grid points within radius of block
+  int lo[3], hi[3], size[3];
+  for (int dim = 0; dim < 3; dim++) {
+    lo[dim] = block->origin[dim] - radius;
+    hi[dim] = block->origin[dim] + block_size - 1 + radius;
+    if (lo[dim] < 0) lo[dim] = 0;
+    if (hi[dim] > grid->Resolution(dim) - 1) hi[dim] = grid->Resolution(dim) - 1;
+    size[dim] = hi[dim] - lo[dim] + 1;
+  }
+
+  // Initialize window with zero at seeds and infinity elsewhere
+  const float infinity = 1.0E20;
+  std::vector<float>& window = distance_data->thread_windows[thread_index];
+  window.assign(size[0] * size[1] * size[2], infinity);
+  RNBoolean found_seed = FALSE;
+  for (int bk = lo[2] >> R3_SPARSE_GRID_BLOCK_BITS; bk <= hi[2] >> R3_SPARSE_GRID_BLOCK_BITS; bk++) {
+    for (int bj = lo[1] >> R3_SPARSE_GRID_BLOCK_BITS; bj <= hi[1] >> R3_SPARSE_GRID_BLOCK_BITS; bj++) {
+      for (int bi = lo[0] >> R3_SPARSE_GRID_BLOCK_BITS; bi <= hi[0] >> R3_SPARSE_GRID_BLOCK_BITS; bi++) {
+        int neighbor_index = grid->FindBlockIndex(bi, bj, bk);
+        if (neighbor_index < 0) continue;
+        const R3SparseGridBlock *neighbor = grid->Block(neighbor_index);
+        for (int lk = 0; lk < block_size; lk++) {
+          int k = neighbor->origin[2] + lk - lo[2];
+          if ((k < 0) || (k >= size[2])) continue;
+          for (int lj = 0; lj < block_size; lj++) {
+            int j = neighbor->origin[1] + lj - lo[1];
+            if ((j < 0) || (j >= size[1])) continue;
+            for (int li = 0; li < block_size; li++) {
+              int i = neighbor->origin[0] + li - lo[0];
+              if ((i < 0) || (i >= size[0])) continue;
+              if (neighbor->values[BlockValueIndex(li, lj, lk)] == 0) continue;
+              window[(k*size[1] + j)*size[0] + i] = 0;
+              found_seed = TRUE;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Check if there is any seed within radius
+  if (!found_seed) {
+    for (int v = 0; v < R3_SPARSE_GRID_BLOCK_VOLUME; v++) new_values[v] = max_squared_distance;
+    return;
+  }
+
+  // Compute offsets of block within window
+  int offset[3], extent[3];
+  for (int dim = 0; dim < 3; dim++) {
+    offset[dim] = block->origin[dim] - lo[dim];
+    extent[dim] = grid->Resolution(dim) - block->origin[dim];
+    if (extent[dim] > block_size) extent[dim] = block_size;
+  }
+
+  // Transform along x for all lines, along y for lines crossing block in x,
+  // and along z for lines crossing block in x and y
+  float *buffer = &distance_data->thread_buffers[thread_index][0];
+  int *v = &distance_data->thread_indices[thread_index][0];
+  int sheet = size[0] * size[1];
+  for (int k = 0; k < size[2]; k++) {
+    for (int j = 0; j < size[1]; j++) {
+      SquaredDistanceTransform1D(&window[k*sheet + j*size[0]], size[0], 1, buffer, v);
+    }
+  }
+  for (int k = 0; k < size[2]; k++) {
+    for (int i = offset[0]; i < offset[0] + extent[0]; i++) {
+      SquaredDistanceTransform1D(&window[k*sheet + i], size[1], size[0], buffer, v);
+    }
+  }
+  for (int j = offset[1]; j < offset[1] + extent[1]; j++) {
+    for (int i = offset[0]; i < offset[0] + extent[0]; i++) {
+      SquaredDistanceTransform1D(&window[j*size[0] + i], size[2], sheet, buffer, v);
+    }
+  }
+
+  // Copy squared distances of block (truncated at max distance)
+  for (int v = 0; v < R3_SPARSE_GRID_BLOCK_VOLUME; v++) new_values[v] = max_squared_distance;
+  for (int lk = 0; lk < extent[2]; lk++) {
+    for (int lj = 0; lj < extent[1]; lj++) {
+      for (int li = 0; li < extent[0]; li++) {
+        float d = window[((offset[2] + lk)*size[1] + offset[1] + lj)*size[0] + offset[0] + li];
+        new_values[BlockValueIndex(li, lj, lk)] = (d < max_squared_distance) ? d : max_squared_distance;
+      }
+    }
+  }
+}
+
+
+
+void R3SparseGrid::
+SquaredDistanceTransform(RNLength max_grid_distance)
+{
+  // Replace each value with squared distance (in grid units) to nearest
+  // nonzero value, truncated at max_grid_distance (which also becomes the
+  // squared background value, since unallocated points are never seeds)
+  int radius = (int) ceil(max_grid_distance);
+  if (radius < 0) radius = 0;
+
+  // Allocate blocks within radius of blocks with seeds
+  int block_radius = (radius + R3_SPARSE_GRID_BLOCK_SIZE - 1) / R3_SPARSE_GRID_BLOCK_SIZE;
+  DilateBlocks(this, -1, block_radius, HasNonZeroValue, 0);
+
+  // Compute distances for blocks in parallel
+  int window_size = R3_SPARSE_GRID_BLOCK_SIZE + 2*radius;
+  std::vector<float> new_values(blocks.size() * R3_SPARSE_GRID_BLOCK_VOLUME);
+  R3SparseGridDistanceData data;
+  data.grid = this;
+  data.radius = radius;
+  data.max_squared_distance = max_grid_distance * max_grid_distance;
+  data.new_values = &new_values;
+  data.thread_windows.resize(RNNThreads());
+  data.thread_buffers.resize(RNNThreads(), std::vector<float>(2*window_size + 1));
+  data.thread_indices.resize(RNNThreads(), std::vector<int>(window_size));
+  RNParallelFor(NBlocks(), TransformBlockDistances, &data, 4);
+
+  // Copy new values into blocks
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    memcpy(blocks[b]->values, &new_values[b * R3_SPARSE_GRID_BLOCK_VOLUME], R3_SPARSE_GRID_BLOCK_VOLUME * sizeof(float));
+  }
+  background_value = data.max_squared_distance;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Rasterization functions
+////////////////////////////////////////////////////////////////////////
+
+void R3SparseGrid::
+RasterizeGridValue(int ix, int iy, int iz, RNScalar value, int operation)
+{
+  // Check if within bounds
+  if ((ix < 0) || (ix > grid_resolution[0]-1)) return;
+  if ((iy < 0) || (iy > grid_resolution[1]-1)) return;
+  if ((iz < 0) || (iz > grid_resolution[2]-1)) return;
+
+  // Update grid based on operation
+  if (operation == R3_GRID_ADD_OPERATION) AddGridValue(ix, iy, iz, value);
+  else if (operation == R3_GRID_SUBTRACT_OPERATION) AddGridValue(ix, iy, iz, -value);
+  else if (operation == R3_GRID_REPLACE_OPERATION) SetGridValue(ix, iy, iz, value);
+  else RNAbort("Unrecognized grid rasterization operation\n");
+}
+
+
+
+void R3SparseGrid::
+RasterizeGridPoint(RNCoord x, RNCoord y, RNCoord z, RNScalar value, int operation)
+{
+  // Check if within bounds
+  if ((x < 0) || (x > grid_resolution[0]-1)) return;
+  if ((y < 0) || (y > grid_resolution[1]-1)) return;
+  if ((z < 0) || (z > grid_resolution[2]-1)) return;
+
+  // Trilinear interpolation
+  int ix1 = (int) x;
+  int iy1 = (int) y;
+  int iz1 = (int) z;
+  int ix2 = ix1 + 1;
+  int iy2 = iy1 + 1;
+  int iz2 = iz1 + 1;
+  if (ix2 >= grid_resolution[0]) ix2 = ix1;
+  if (iy2 >= grid_resolution[1]) iy2 = iy1;
+  if (iz2 >= grid_resolution[2]) iz2 = iz1;
+  RNScalar dx = x - ix1;
+  RNScalar dy = y - iy1;
+  RNScalar dz = z - iz1;
+  RasterizeGridValue(ix1, iy1, iz1, value * (1.0-dx) * (1.0-dy) * (1.0-dz), operation);
+  RasterizeGridValue(ix1, iy1, iz2, value * (1.0-dx) * (1.0-dy) * dz, operation);
+  RasterizeGridValue(ix1, iy2, iz1, value * (1.0-dx) * dy * (1.0-dz), operation);
+  RasterizeGridValue(ix1, iy2, iz2, value * (1.0-dx) * dy * dz, operation);
+  RasterizeGridValue(ix2, iy1, iz1, value * dx * (1.0-dy) * (1.0-dz), operation);
+  RasterizeGridValue(ix2, iy1, iz2, value * dx * (1.0-dy) * dz, operation);
+  RasterizeGridValue(ix2, iy2, iz1, value * dx * dy * (1.0-dz), operation);
+  RasterizeGridValue(ix2, iy2, iz2, value * dx * dy * dz, operation);
+}
+
+
+
+void R3SparseGrid::
+RasterizeGridSpan(const int p1[3], const int p2[3], RNScalar value, int operation)
+{
+  // Get some convenient variables
+  int d[3],p[3],dd[3],s[3];
+  for (int i = 0; i < 3; i++) {
+    d[i]= p2[i] - p1[i];
+    if(d[i]<0){
+      dd[i] = -d[i];
+      s[i] = -1;
+    }
+    else{
+      dd[i] = d[i];
+      s[i] = 1;
+    }
+    p[i] = p1[i];
+  }
+
+  // Choose dimensions
+  int i1=0;
+  if(dd[1]>dd[i1]){i1=1;}
+  if(dd[2]>dd[i1]){i1=2;}
+  int i2=(i1+1)%3;
+  int i3=(i1+2)%3;
+
+  // Check span extent
+  if(dd[i1]==0){
+    // Span is a point - rasterize it
+    RasterizeGridValue(p[0], p[1], p[2], value, operation);
+  }
+  else {
+    // Step along span
+    int off[3] = { 0, 0, 0 };
+    for (int i = 0; i <= dd[i1]; i++) {
+      RasterizeGridValue(p[0], p[1], p[2], value, operation);
+      off[i2]+=dd[i2];
+      off[i3]+=dd[i3];
+      p[i1]+=s[i1];
+      p[i2]+=s[i2]*off[i2]/dd[i1];
+      p[i3]+=s[i3]*off[i3]/dd[i1];
+      off[i2]%=dd[i1];
+      off[i3]%=dd[i1];
+    }
+  }
+}
+
+
+
+void R3SparseGrid::
+RasterizeGridTriangle(const int p1[3], const int p2[3], const int p3[3], RNScalar value, int operation)
+{
+  int i,j;
+
+  // Figure out the min, max, and delta in each dimension
+  int mn[3], mx[3], delta[3];
+  for (i = 0; i < 3; i++) {
+    mx[i]=mn[i]=p1[i];
+    if (p2[i] < mn[i]) mn[i]=p2[i];
+    if (p3[i] < mn[i]) mn[i]=p3[i];
+    if (p2[i] > mx[i]) mx[i]=p2[i];
+    if (p3[i] > mx[i]) mx[i]=p3[i];
+    delta[i] = mx[i] - mn[i];
+  }
+
+  // Check if triangle is outside grid
+  for (i = 0; i < 3; i++) {
+    if ((mx[i] < 0) || (mn[i] > grid_resolution[i]-1)) return;
+  }
+
+  // Determine direction of maximal delta
+  int d = 0;
+  if ((delta[1] > delta[0]) && (delta[1] > delta[2])) d = 1;
+  else if (delta[2] > delta[0]) d = 2;
+
+  // Sort by d-value
+  const int *q1,*q2,*q3;
+  if(p1[d]>=p2[d] && p1[d]>=p3[d]){
+    q1=p1;
+    if(p2[d]>=p3[d]){
+      q2=p2;
+      q3=p3;
+    }
+    else{
+      q2=p3;
+      q3=p2;
+    }
+  }
+  else if(p2[d]>=p1[d] && p2[d]>=p3[d]){
+    q1=p2;
+    if(p1[d]>=p3[d]){
+      q2=p1;
+      q3=p3;
+    }
+    else{
+      q2=p3;
+      q3=p1;
+    }
+  }
+  else{
+    q1=p3;
+    if(p1[d]>=p2[d]){
+      q2=p1;
+      q3=p2;
+    }
+    else{
+      q2=p2;
+      q3=p1;
+    }
+  }
+
+  // Init state
+  int dx,dx1,dx2,ddx;
+  dx=q1[d]-q2[d];
+  dx1=q1[d]-q2[d];
+  dx2=q1[d]-q3[d];
+  ddx=dx1*dx2;
+
+  int r1[3],r2[3];
+  int last1[3],last2[3];
+  int off1[3],off2[3];
+  for(i=0;i<3;i++){
+    last1[i]=q1[i];
+    last2[i]=q1[i];
+
+    off1[i]=0;
+    off2[i]=0;
+
+    r1[i]=(-q1[i]+q2[i])*dx2;
+    r2[i]=(-q1[i]+q3[i])*dx1;
+  }
+
+  // Draw Top triangle
+  if(dx==0){
+    for(i=0;i<3;i++){
+      last1[i]=q1[i];
+      last2[i]=q2[i];
+    }
+  }
+  else{
+    for(i=0;i<dx;i++){
+      RasterizeGridSpan(last1,last2,value, operation);
+      for(j=0;j<3;j++){
+        off1[j]+=r1[j];
+        off2[j]+=r2[j];
+
+        last1[j]+=off1[j]/ddx;
+        if(off1[j]<0){off1[j]=-((-off1[j])%ddx);}
+        else{off1[j]%=ddx;}
+
+        last2[j]+=off2[j]/ddx;
+        if(off2[j]<0){off2[j]=-((-off2[j])%ddx);}
+        else{off2[j]%=ddx;}
+      }
+    }
+  }
+
+  // Init
+  dx=q2[d]-q3[d];
+  dx1=last1[d]-q3[d];
+  dx2=last2[d]-q3[d];
+  ddx=dx1*dx2;
+  if(dx==0){
+    RasterizeGridSpan(q2,q3,value,operation);
+    return;
+  }
+
+  for(i=0;i<3;i++){
+    off1[i]=0;
+    off2[i]=0;
+    r1[i]=(-last1[i]+q3[i])*dx2;
+    r2[i]=(-last2[i]+q3[i])*dx1;
+  }
+
+  // Draw Bottom parrallelogram
+  for(i=0;i<=dx;i++){
+    RasterizeGridSpan(last1,last2,value,operation);
+    for(j=0;j<3;j++){
+      off1[j]+=r1[j];
+      off2[j]+=r2[j];
+
+      last1[j]+=off1[j]/ddx;
+      if(off1[j]<0){off1[j]=-((-off1[j])%ddx);}
+      else{off1[j]%=ddx;}
+
+      last2[j]+=off2[j]/ddx;
+      if(off2[j]<0){off2[j]=-((-off2[j])%ddx);}
+      else{off2[j]%=ddx;}
+    }
+  }
+}
+
+
+
+void R3SparseGrid::
+RasterizeGridSphere(const R3Point& center, RNLength radius, RNScalar value, RNBoolean solid, int operation)
+{
+  // Figure out the min and max in each dimension
+  int mn[3], mx[3];
+  for (int i = 0; i < 3; i++) {
+    mx[i]= (int) (center[i]+radius);
+    if (mx[i] < 0) return;
+    if (mx[i] > Resolution(i)-1) mx[i] = Resolution(i)-1;
+    mn[i]= (int) (center[i]-radius);
+    if (mn[i] > Resolution(i)-1) return;
+    if (mn[i] < 0) mn[i] = 0;
+  }
+
+  // Rasterize sphere
+  RNScalar radius_squared = radius * radius;
+  for (int k = mn[2]; k <= mx[2]; k++) {
+    RNCoord z = (int) (k - center[2]);
+    RNCoord z_squared = z*z;
+    RNLength xy_radius_squared = radius_squared - z_squared;
+    RNLength y = sqrt(xy_radius_squared);
+    int y1 = (int) (center[1] - y + 0.5);
+    int y2 = (int) (center[1] + y + 0.5);
+    if (y1 < mn[1]) y1 = mn[1];
+    if (y2 > mx[1]) y2 = mx[1];
+    for (int j = y1; j <= y2; j++) {
+      RNCoord y = (int) (j - center[1]);
+      RNCoord y_squared = y*y;
+      RNLength x_squared = xy_radius_squared - y_squared;
+      RNLength x = sqrt(x_squared);
+      int x1 = (int) (center[0] - x + 0.5);
+      int x2 = (int) (center[0] + x + 0.5);
+      if (x1 < mn[0]) x1 = mn[0];
+      if (x2 > mx[0]) x2 = mx[0];
+      if (solid || (j == y1) || (j == y2)) {
+        for (int i = x1; i <= x2; i++) {
+          RasterizeGridValue(i, j, k, value, operation);
+        }
+      }
+      else {
+        RasterizeGridValue(x1, j, k, value, operation);
+        RasterizeGridValue(x2, j, k, value, operation);
+      }
+    }
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Transformation functions
+////////////////////////////////////////////////////////////////////////
+
+void R3SparseGrid::
+SetWorldToGridTransformation(const R3Affine& affine)
+{
+  // Set transformations
+  world_to_grid_transform = affine;
+  grid_to_world_transform = affine.Inverse();
+  world_to_grid_scale_factor = affine.ScaleFactor();
+  grid_to_world_scale_factor = (world_to_grid_scale_factor != 0) ? 1 / world_to_grid_scale_factor : 1.0;
+}
+
+
+
+void R3SparseGrid::
+SetWorldToGridTransformation(const R3Box& world_box)
+{
+  // Just checking
+  if ((grid_resolution[0] == 0) || (grid_resolution[1] == 0) || (grid_resolution[2] == 0)) return;
+  if (world_box.NDimensions() < 3) return;
+
+  // Compute grid origin
+  R3Vector grid_diagonal(XResolution()-1, YResolution()-1, ZResolution()-1);
+  R3Vector grid_origin = 0.5 * grid_diagonal;
+
+  // Compute world origin
+  R3Vector world_diagonal(world_box.XLength(), world_box.YLength(), world_box.ZLength());
+  R3Vector world_origin = world_box.Centroid().Vector();
+
+  // Compute scale
+  RNScalar scale = FLT_MAX;
+  RNScalar xscale = (world_diagonal[0] > 0) ? grid_diagonal[0] / world_diagonal[0] : FLT_MAX;
+  if (xscale < scale) scale = xscale;
+  RNScalar yscale = (world_diagonal[1] > 0) ? grid_diagonal[1] / world_diagonal[1] : FLT_MAX;
+  if (yscale < scale) scale = yscale;
+  RNScalar zscale = (world_diagonal[2] > 0) ? grid_diagonal[2] / world_diagonal[2] : FLT_MAX;
+  if (zscale < scale) scale = zscale;
+  if (scale == FLT_MAX) scale = 1;
+
+  // Compute world-to-grid transformation
+  R3Affine affine(R3identity_affine);
+  affine.Translate(grid_origin);
+  if (scale != 1) affine.Scale(scale);
+  affine.Translate(-world_origin);
+
+  // Set transformations
+  SetWorldToGridTransformation(affine);
+}
+
+
+
+R3Point R3SparseGrid::
+WorldPosition(RNCoord x, RNCoord y, RNCoord z) const
+{
+  // Transform point from grid coordinates to world coordinates
+  R3Point world_point(x, y, z);
+  world_point.Transform(grid_to_world_transform);
+  return world_point;
+}
+
+
+
+R3Point R3SparseGrid::
+GridPosition(RNCoord x, RNCoord y, RNCoord z) const
+{
+  // Transform point from world coordinates to grid coordinates
+  R3Point grid_point(x, y, z);
+  grid_point.Transform(world_to_grid_transform);
+  return grid_point;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Conversion functions
+////////////////////////////////////////////////////////////////////////
+
+R3Grid *R3SparseGrid::
+CreateDenseGrid(void) const
+{
+  // Check size of dense grid
+  RNInt64 nvalues = (RNInt64) grid_resolution[0] * grid_resolution[1] * grid_resolution[2];
+  if (nvalues > INT_MAX) {
+    RNFail("Sparse grid is too large to convert to dense grid: %d %d %d\n",
+      grid_resolution[0], grid_resolution[1], grid_resolution[2]);
+    return NULL;
+  }
+
+  // Allocate dense grid
+  R3Grid *grid = new R3Grid(grid_resolution[0], grid_resolution[1], grid_resolution[2]);
+  grid->SetWorldToGridTransformation(world_to_grid_transform);
+  grid->Clear(background_value);
+
+  // Copy values from blocks
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    const R3SparseGridBlock *block = blocks[b];
+    for (int lk = 0; lk < R3_SPARSE_GRID_BLOCK_SIZE; lk++) {
+      int k = block->origin[2] + lk;
+      if (k >= grid_resolution[2]) break;
+      for (int lj = 0; lj < R3_SPARSE_GRID_BLOCK_SIZE; lj++) {
+        int j = block->origin[1] + lj;
+        if (j >= grid_resolution[1]) break;
+        for (int li = 0; li < R3_SPARSE_GRID_BLOCK_SIZE; li++) {
+          int i = block->origin[0] + li;
+          if (i >= grid_resolution[0]) break;
+          grid->SetGridValue(i, j, k, block->values[BlockValueIndex(li, lj, lk)]);
+        }
+      }
+    }
+  }
+
+  // Return dense grid
+  return grid;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// I/O functions
+////////////////////////////////////////////////////////////////////////
+
+int R3SparseGrid::
+ReadFile(const char *filename)
+{
+  // Parse input filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    printf("Filename %s has no extension (e.g., .sgd)\n", filename);
+    return 0;
+  }
+
+  // Read sparse grid file
+  if (!strncmp(extension, ".sgd", 4)) return ReadSparseGridFile(filename);
+
+  // Read dense grid file and convert it
+  R3Grid grid;
+  if (!grid.ReadFile(filename)) return 0;
+  *this = R3SparseGrid(grid);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3SparseGrid::
+WriteFile(const char *filename) const
+{
+  // Parse output filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    printf("Filename %s has no extension (e.g., .sgd)\n", filename);
+    return 0;
+  }
+
+  // Write sparse grid file
+  if (!strncmp(extension, ".sgd", 4)) return WriteSparseGridFile(filename);
+
+  // Convert to dense grid and write it
+  R3Grid *grid = CreateDenseGrid();
+  if (!grid) return 0;
+  int status = grid->WriteFile(filename);
+  delete grid;
+
+  // Return status
+  return status;
+}
+
+
+
+int R3SparseGrid::
+ReadSparseGridFile(const char *filename)
+{
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    RNFail("Unable to open file %s", filename);
+    return 0;
+  }
+
+  // Read grid
+  int status = ReadSparseGrid(fp);
+
+  // Close file
+  fclose(fp);
+
+  // Return status
+  return status;
+}
+
+
+
+int R3SparseGrid::
+WriteSparseGridFile(const char *filename) const
+{
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open file %s", filename);
+    return 0;
+  }
+
+  // Write grid
+  int status = WriteSparseGrid(fp);
+
+  // Close file
+  fclose(fp);
+
+  // Return status
+  return status;
+}
+
+
+
+// Sparse grid file layout (.sgd, native byte order):
+//   char magic[8] ("R3SPGRID"), int version, int resolution[3], int block_size,
+//   int nblocks, float background_value, float world_to_grid[16],
+//   then for each block: int origin[3], float values[block_size^3] (x varies fastest)
+
+int R3SparseGrid::
+ReadSparseGrid(FILE *fp)
+{
+  // Check file
+  if (!fp) fp = stdin;
+
+  // Read header
+  char magic[8];
+  int header[6];
+  float background;
+  float m[16];
+  if ((fread(magic, sizeof(char), 8, fp) != 8) || (fread(header, sizeof(int), 6, fp) != 6) ||
+      (fread(&background, sizeof(float), 1, fp) != 1) || (fread(m, sizeof(float), 16, fp) != 16)) {
+    RNFail("Unable to read sparse grid header");
+    return 0;
+  }
+
+  // Check header
+  if (memcmp(magic, "R3SPGRID", 8) || (header[0] != 1)) {
+    RNFail("Invalid sparse grid header");
+    return 0;
+  }
+  if (header[4] != R3_SPARSE_GRID_BLOCK_SIZE) {
+    RNFail("Unsupported sparse grid block size: %d", header[4]);
+    return 0;
+  }
+  for (int dim = 0; dim < 3; dim++) {
+    if ((header[1+dim] < 0) || (header[1+dim] > R3_SPARSE_GRID_MAX_RESOLUTION)) {
+      RNFail("Invalid sparse grid resolution: %d", header[1+dim]);
+      return 0;
+    }
+  }
+
+  // Reset grid
+  Clear(background);
+  grid_resolution[0] = header[1];
+  grid_resolution[1] = header[2];
+  grid_resolution[2] = header[3];
+  R4Matrix matrix(m[0], m[1], m[2], m[3], m[4], m[5], m[6], m[7],
+    m[8], m[9], m[10], m[11], m[12], m[13], m[14], m[15]);
+  SetWorldToGridTransformation(R3Affine(matrix, 0));
+
+  // Check number of blocks
+  int nblocks = header[5];
+  long long max_nblocks = 1;
+  for (int dim = 0; dim < 3; dim++) {
+    max_nblocks *= (grid_resolution[dim] + R3_SPARSE_GRID_BLOCK_SIZE - 1) / R3_SPARSE_GRID_BLOCK_SIZE;
+  }
+  if ((nblocks < 0) || (nblocks > max_nblocks)) {
+    RNFail("Invalid number of sparse grid blocks: %d", nblocks);
+    return 0;
+  }
+
+  // Read blocks
+  blocks.reserve(nblocks);
+  for (int b = 0; b < nblocks; b++) {
+    int origin[3];
+    if (fread(origin, sizeof(int), 3, fp) != 3) {
+      RNFail("Unable to read origin of sparse grid block %d of %d", b, nblocks);
+      return 0;
+    }
+    for (int dim = 0; dim < 3; dim++) {
+      if ((origin[dim] < 0) || (origin[dim] >= grid_resolution[dim])) {
+        RNFail("Invalid origin of sparse grid block %d of %d", b, nblocks);
+        return 0;
+      }
+    }
+    R3SparseGridBlock *block = AllocateBlock(origin[0], origin[1], origin[2]);
+    if (fread(block->values, sizeof(float), R3_SPARSE_GRID_BLOCK_VOLUME, fp) != R3_SPARSE_GRID_BLOCK_VOLUME) {
+      RNFail("Unable to read values of sparse grid block %d of %d", b, nblocks);
+      return 0;
+    }
+  }
+
+  // Return number of blocks read
+  return (nblocks > 0) ? nblocks : 1;
+}
+
+
+
+int R3SparseGrid::
+WriteSparseGrid(FILE *fp) const
+{
+  // Check file
+  if (!fp) fp = stdout;
+
+  // Write header
+  int header[6] = { 1, grid_resolution[0], grid_resolution[1], grid_resolution[2],
+    R3_SPARSE_GRID_BLOCK_SIZE, (int) blocks.size() };
+  float m[16];
+  const RNScalar *matrix = &(world_to_grid_transform.Matrix()[0][0]);
+  for (int i = 0; i < 16; i++) m[i] = (float) matrix[i];
+  if ((fwrite("R3SPGRID", sizeof(char), 8, fp) != 8) || (fwrite(header, sizeof(int), 6, fp) != 6) ||
+      (fwrite(&background_value, sizeof(float), 1, fp) != 1) || (fwrite(m, sizeof(float), 16, fp) != 16)) {
+    RNFail("Unable to write sparse grid header");
+    return 0;
+  }
+
+  // Write blocks
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    const R3SparseGridBlock *block = blocks[b];
+    if ((fwrite(block->origin, sizeof(int), 3, fp) != 3) ||
+        (fwrite(block->values, sizeof(float), R3_SPARSE_GRID_BLOCK_VOLUME, fp) != R3_SPARSE_GRID_BLOCK_VOLUME)) {
+      RNFail("Unable to write sparse grid block %d", b);
+      return 0;
+    }
+  }
+
+  // Return number of blocks written
+  return (blocks.size() > 0) ? (int) blocks.size() : 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Isosurface extraction code
+////////////////////////////////////////////////////////////////////////
+
+// Isosurface vertices are created on grid edges leaving grid points in
+// each unit (an allocated block, or an unallocated block next to one),
+// and edge_keys lists the edges in order, so a vertex is found by binary search
+
+struct R3SparseGridIsoSurfaceUnit {
+  int origin[3];
+  int neighbors[8];
+  int first_vertex, first_index;
+  std::vector<float> positions;
+  std::vector<unsigned short> edge_keys;
+  std::vector<int> indices;
+};
+
+struct R3SparseGridIsoSurfaceData {
+  const R3SparseGrid *grid;
+  RNScalar isolevel;
+  std::vector<R3SparseGridIsoSurfaceUnit> units;
+  std::unordered_map<RNInt64, int> shell_indices;
+  R3PlyMesh *mesh;
+};
+
+
+
+// Edges of cell (offset of first grid point, dimension) in marching cubes order
+
+static const int isosurface_cell_edges[12][4] = {
+  {0,0,0,0}, {1,0,0,2}, {0,0,1,0}, {0,0,0,2}, {0,1,0,0}, {1,1,0,2},
+  {0,1,1,0}, {0,1,0,2}, {0,0,0,1}, {1,0,0,1}, {1,0,1,1}, {0,0,1,1} };
+
+
+
+static int
+FindIsoSurfaceUnit(const R3SparseGridIsoSurfaceData *iso, int bi, int bj, int bk)
+{
+  // Return index of unit with block coordinates, or -1
+  int block_index = iso->grid->FindBlockIndex(bi, bj, bk);
+  if (block_index >= 0) return block_index;
+  std::unordered_map<RNInt64, int>::const_iterator it = iso->shell_indices.find(BlockKey(bi, bj, bk));
+  return (it != iso->shell_indices.end()) ? it->second : -1;
+}
+
+
+
+static void
+GatherIsoSurfaceValues(const R3SparseGridIsoSurfaceData *iso, const R3SparseGridIsoSurfaceUnit *unit, float *values)
+{
+  // Fill (block_size+1)^3 values of unit and first layer of its neighbors in positive directions
+  const int block_size = R3_SPARSE_GRID_BLOCK_SIZE;
+  const int n = block_size + 1;
+  float background_value = iso->grid->BackgroundValue();
+  for (int c = 0; c < 8; c++) {
+    int unit_index = unit->neighbors[c];
+    const R3SparseGridBlock *block = ((unit_index >= 0) && (unit_index < iso->grid->NBlocks())) ? iso->grid->Block(unit_index) : NULL;
+    int lo[3], hi[3];
+    for (int dim = 0; dim < 3; dim++) {
+      lo[dim] = ((c >> dim) & 1) ? block_size : 0;
+      hi[dim] = ((c >> dim) & 1) ? block_size : block_size - 1;
+    }
+    for (int k = lo[2]; k <= hi[2]; k++) {
+      for (int j = lo[1]; j <= hi[1]; j++) {
+        for (int i = lo[0]; i <= hi[0]; i++) {
+          values[(k*n + j)*n + i] = (block) ? block->values[BlockValueIndex(i & R3_SPARSE_GRID_BLOCK_MASK,
+            j & R3_SPARSE_GRID_BLOCK_MASK, k & R3_SPARSE_GRID_BLOCK_MASK)] : background_value;
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+CreateIsoSurfaceUnitVertices(int unit_index, int, void *data)
+{
+  // Get convenient variables
+  R3SparseGridIsoSurfaceData *iso = (R3SparseGridIsoSurfaceData *) data;
+  R3SparseGridIsoSurfaceUnit *unit = &iso->units[unit_index];
+  const R3SparseGrid *grid = iso->grid;
+  RNScalar isolevel = iso->isolevel;
+  const int block_size = R3_SPARSE_GRID_BLOCK_SIZE;
+  const int n = block_size + 1;
+
+  // Find neighbor units in positive directions
+  for (int c = 0; c < 8; c++) {
+    unit->neighbors[c] = FindIsoSurfaceUnit(iso,
+      (unit->origin[0] >> R3_SPARSE_GRID_BLOCK_BITS) + (c & 1),
+      (unit->origin[1] >> R3_SPARSE_GRID_BLOCK_BITS) + ((c >> 1) & 1),
+      (unit->origin[2] >> R3_SPARSE_GRID_BLOCK_BITS) + ((c >> 2) & 1));
+  }
+
+  // Gather values
+  float values[n*n*n];
+  GatherIsoSurfaceValues(iso, unit, values);
+
+  // Create vertices on edges leaving grid points of unit
+  int strides[3] = { 1, n, n*n };
+  for (int lk = 0; lk < block_size; lk++) {
+    for (int lj = 0; lj < block_size; lj++) {
+      for (int li = 0; li < block_size; li++) {
+        int l[3] = { li, lj, lk };
+        int index = (lk*n + lj)*n + li;
+        RNBoolean inside = (values[index] < isolevel);
+        for (int dim = 0; dim < 3; dim++) {
+          if (unit->origin[dim] + l[dim] + 1 >= grid->Resolution(dim)) continue;
+          RNScalar value0 = values[index];
+          RNScalar value1 = values[index + strides[dim]];
+          if ((value1 < isolevel) == inside) continue;
+
+          // Compute interpolation parameter along edge
+          RNScalar delta0 = fabs(value0 - isolevel);
+          RNScalar delta1 = fabs(value1 - isolevel);
+          RNScalar t = delta0 / (delta0 + delta1);
+
+          // Create vertex (in grid coordinates)
+          for (int d = 0; d < 3; d++) {
+            unit->positions.push_back(unit->origin[d] + l[d] + ((d == dim) ? t : 0));
+          }
+          unit->edge_keys.push_back(3*BlockValueIndex(li, lj, lk) + dim);
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+CreateIsoSurfaceUnitTriangles(int unit_index, int, void *data)
+{
+  // Get convenient variables
+  R3SparseGridIsoSurfaceData *iso = (R3SparseGridIsoSurfaceData *) data;
+  R3SparseGridIsoSurfaceUnit *unit = &iso->units[unit_index];
+  const R3SparseGrid *grid = iso->grid;
+  RNScalar isolevel = iso->isolevel;
+  const int block_size = R3_SPARSE_GRID_BLOCK_SIZE;
+  const int n = block_size + 1;
+
+  // Gather values
+  float values[n*n*n];
+  GatherIsoSurfaceValues(iso, unit, values);
+
+  // Visit cells with first corner in unit
+  for (int lk = 0; lk < block_size; lk++) {
+    if (unit->origin[2] + lk + 1 >= grid->ZResolution()) break;
+    for (int lj = 0; lj < block_size; lj++) {
+      if (unit->origin[1] + lj + 1 >= grid->YResolution()) break;
+      for (int li = 0; li < block_size; li++) {
+        if (unit->origin[0] + li + 1 >= grid->XResolution()) break;
+        int index = (lk*n + lj)*n + li;
+
+        // Compute cube index
+        int cubeindex = 0;
+        if (values[index] < isolevel) cubeindex |= 1;
+        if (values[index + 1] < isolevel) cubeindex |= 2;
+        if (values[index + 1 + n*n] < isolevel) cubeindex |= 4;
+        if (values[index + n*n] < isolevel) cubeindex |= 8;
+        if (values[index + n] < isolevel) cubeindex |= 16;
+        if (values[index + 1 + n] < isolevel) cubeindex |= 32;
+        if (values[index + 1 + n + n*n] < isolevel) cubeindex |= 64;
+        if (values[index + n + n*n] < isolevel) cubeindex |= 128;
+        if ((cubeindex == 0) || (cubeindex == 255)) continue;
+
+        // Create triangles
+        const int *triangle_edges = R3grid_isosurface_triangle_table[cubeindex];
+        for (int t = 0; triangle_edges[t] != -1; t++) {
+          // Find unit that owns edge
+          const int *edge = isosurface_cell_edges[triangle_edges[t]];
+          int ei = li + edge[0], ej = lj + edge[1], ek = lk + edge[2];
+          int c = (ei >> R3_SPARSE_GRID_BLOCK_BITS) | ((ej >> R3_SPARSE_GRID_BLOCK_BITS) << 1) | ((ek >> R3_SPARSE_GRID_BLOCK_BITS) << 2);
+          assert(unit->neighbors[c] >= 0);
+          const R3SparseGridIsoSurfaceUnit *owner = &iso->units[unit->neighbors[c]];
+
+          // Find vertex on edge
+          unsigned short key = 3*BlockValueIndex(ei & R3_SPARSE_GRID_BLOCK_MASK,
+            ej & R3_SPARSE_GRID_BLOCK_MASK, ek & R3_SPARSE_GRID_BLOCK_MASK) + edge[3];
+          std::vector<unsigned short>::const_iterator it =
+            std::lower_bound(owner->edge_keys.begin(), owner->edge_keys.end(), key);
+          assert((it != owner->edge_keys.end()) && (*it == key));
+          unit->indices.push_back(owner->first_vertex + (int) (it - owner->edge_keys.begin()));
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+FinishIsoSurfaceUnit(int unit_index, int, void *data)
+{
+  // Get convenient variables
+  R3SparseGridIsoSurfaceData *iso = (R3SparseGridIsoSurfaceData *) data;
+  const R3SparseGridIsoSurfaceUnit *unit = &iso->units[unit_index];
+
+  // Copy vertex positions (in world coordinates)
+  float *positions = &iso->mesh->positions[3*unit->first_vertex];
+  for (unsigned int i = 0; i < unit->positions.size(); i += 3) {
+    R3Point position = iso->grid->WorldPosition(unit->positions[i], unit->positions[i+1], unit->positions[i+2]);
+    *(positions++) = position.X();
+    *(positions++) = position.Y();
+    *(positions++) = position.Z();
+  }
+
+  // Copy triangles
+  if (unit->indices.empty()) return;
+  memcpy(&iso->mesh->indices[unit->first_index], &unit->indices[0], unit->indices.size() * sizeof(int));
+}
+
+
+
+int R3SparseGrid::
+GenerateIsoSurface(RNScalar isolevel, R3PlyMesh *mesh) const
+{
+  // Initialize isosurface data
+  mesh->Empty();
+  R3SparseGridIsoSurfaceData iso;
+  iso.grid = this;
+  iso.isolevel = isolevel;
+  iso.mesh = mesh;
+
+  // Create units for allocated blocks (with the same indices)
+  iso.units.resize(blocks.size());
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    for (int dim = 0; dim < 3; dim++) iso.units[b].origin[dim] = blocks[b]->origin[dim];
+  }
+
+  // Create units for unallocated blocks whose cells touch allocated blocks
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    for (int c = 1; c < 8; c++) {
+      int bi = (blocks[b]->origin[0] >> R3_SPARSE_GRID_BLOCK_BITS) - (c & 1);
+      int bj = (blocks[b]->origin[1] >> R3_SPARSE_GRID_BLOCK_BITS) - ((c >> 1) & 1);
+      int bk = (blocks[b]->origin[2] >> R3_SPARSE_GRID_BLOCK_BITS) - ((c >> 2) & 1);
+      if ((bi < 0) || (bj < 0) || (bk < 0)) continue;
+      if (FindIsoSurfaceUnit(&iso, bi, bj, bk) >= 0) continue;
+      iso.shell_indices[BlockKey(bi, bj, bk)] = (int) iso.units.size();
+      R3SparseGridIsoSurfaceUnit unit;
+      for (int n = 0; n < 8; n++) unit.neighbors[n] = -1;
+      unit.first_vertex = unit.first_index = 0;
+      unit.origin[0] = bi << R3_SPARSE_GRID_BLOCK_BITS;
+      unit.origin[1] = bj << R3_SPARSE_GRID_BLOCK_BITS;
+      unit.origin[2] = bk << R3_SPARSE_GRID_BLOCK_BITS;
+      iso.units.push_back(unit);
+    }
+  }
+
+  // Create vertices of units in parallel
+  int nunits = (int) iso.units.size();
+  RNParallelFor(nunits, CreateIsoSurfaceUnitVertices, &iso, 16);
+
+  // Compute offsets of vertices of units in mesh
+  int nvertices = 0;
+  for (int u = 0; u < nunits; u++) {
+    iso.units[u].first_vertex = nvertices;
+    nvertices += (int) (iso.units[u].positions.size() / 3);
+  }
+
+  // Create triangles of units in parallel
+  RNParallelFor(nunits, CreateIsoSurfaceUnitTriangles, &iso, 16);
+
+  // Compute offsets of triangles of units in mesh
+  int nindices = 0;
+  for (int u = 0; u < nunits; u++) {
+    iso.units[u].first_index = nindices;
+    nindices += (int) iso.units[u].indices.size();
+  }
+
+  // Copy vertices and triangles into mesh in parallel
+  mesh->positions.resize(3 * nvertices);
+  mesh->indices.resize(nindices);
+  RNParallelFor(nunits, FinishIsoSurfaceUnit, &iso, 16);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3SparseGrid::
+GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const
+{
+  // Extract isosurface
+  R3PlyMesh isosurface;
+  if (!GenerateIsoSurface(isolevel, &isosurface)) return 0;
+  if (isosurface.NFaces() == 0) return 1;
+
+  // Create vertices
+  int first_vertex_id = mesh->CreateVertices(isosurface.NVertices(), &isosurface.positions[0]);
+  if (first_vertex_id > 0) {
+    for (unsigned int i = 0; i < isosurface.indices.size(); i++) isosurface.indices[i] += first_vertex_id;
+  }
+
+  // Create faces
+  mesh->CreateFaces(isosurface.NFaces(), &isosurface.indices[0]);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3SparseGrid::
+GenerateIsoSurface(RNScalar isolevel, R3IndexedMesh *mesh) const
+{
+  // Extract isosurface
+  R3PlyMesh isosurface;
+  if (!GenerateIsoSurface(isolevel, &isosurface)) return 0;
+
+  // Load mesh
+  return mesh->LoadPlyMesh(isosurface);
+}
+
+
+
+// End namespace
+}
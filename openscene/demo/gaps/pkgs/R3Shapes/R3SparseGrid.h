@@ -0,0 +1,441 @@
+// Header file for GAPS sparse scalar grid class
+#ifndef __R3__SPARSE__GRID__H__
+#define __R3__SPARSE__GRID__H__
+
+
+
+// Include files
+
+#include <vector>
+#include <unordered_map>
+
+
+
+/* Begin namespace */
+namespace gaps {
+
+
+
+// Block layout (values are stored in 8x8x8 blocks, which are allocated
+// on demand and found with a hash table keyed by block coordinates)
+
+#define R3_SPARSE_GRID_BLOCK_BITS      3
+#define R3_SPARSE_GRID_BLOCK_SIZE      8
+#define R3_SPARSE_GRID_BLOCK_VOLUME  512
+
+
+
+// Block definition
+
+struct R3SparseGridBlock {
+  int origin[3];
+  float values[R3_SPARSE_GRID_BLOCK_VOLUME];
+};
+
+
+
+// Class definition
+
+class R3SparseGrid {
+public:
+  // Constructors
+  R3SparseGrid(int xresolution = 0, int yresolution = 0, int zresolution = 0, RNScalar background_value = 0);
+  R3SparseGrid(const R3Box& bbox, RNLength spacing, int min_border = 0, RNScalar background_value = 0);
+  R3SparseGrid(const R3Grid& grid, RNScalar background_value = 0);
+  R3SparseGrid(const R3SparseGrid& grid);
+  ~R3SparseGrid(void);
+
+  // Grid property functions
+  int XResolution(void) const;
+  int YResolution(void) const;
+  int ZResolution(void) const;
+  int Resolution(RNDimension dim) const;
+  RNScalar BackgroundValue(void) const;
+  RNInterval Range(void) const;
+  R3Box GridBox(void) const;
+  R3Box WorldBox(void) const;
+
+  // Block property functions
+  int NBlocks(void) const;
+  const R3SparseGridBlock *Block(int block_index) const;
+  const R3SparseGridBlock *FindBlock(int i, int j, int k) const;
+  RNInt64 NAllocatedValues(void) const;
+  RNInt64 MemoryUsage(void) const;
+
+  // Transformation property functions
+  const R3Affine& WorldToGridTransformation(void) const;
+  const R3Affine& GridToWorldTransformation(void) const;
+  RNScalar WorldToGridScaleFactor(void) const;
+  RNScalar GridToWorldScaleFactor(void) const;
+
+  // Grid value access functions
+  RNScalar GridValue(int i, int j, int k) const;
+  RNScalar GridValue(RNCoord x, RNCoord y, RNCoord z) const;
+  RNScalar GridValue(const R3Point& grid_point) const;
+  RNScalar WorldValue(RNCoord x, RNCoord y, RNCoord z) const;
+  RNScalar WorldValue(const R3Point& world_point) const;
+
+  // Grid manipulation functions
+  void Clear(RNScalar background_value = 0);
+  void Prune(RNScalar tolerance = 0);
+  void Blur(RNScalar grid_sigma = 2);
+  void SquaredDistanceTransform(RNLength max_grid_distance);
+  void Threshold(RNScalar threshold, RNScalar low, RNScalar high);
+  void SetGridValue(int i, int j, int k, RNScalar value);
+  void AddGridValue(int i, int j, int k, RNScalar value);
+  R3SparseGrid& operator=(const R3SparseGrid& grid);
+
+  // Block manipulation functions
+  R3SparseGridBlock *AllocateBlock(int i, int j, int k);
+
+  // Rasterization functions
+  void RasterizeGridValue(int ix, int iy, int iz, RNScalar value, int operation = 0);
+  void RasterizeGridPoint(RNCoord x, RNCoord y, RNCoord z, RNScalar value, int operation = 0);
+  void RasterizeGridPoint(const R3Point& point, RNScalar value, int operation = 0);
+  void RasterizeWorldPoint(const R3Point& point, RNScalar value, int operation = 0);
+  void RasterizeGridSpan(const int p1[3], const int p2[3], RNScalar value, int operation = 0);
+  void RasterizeGridTriangle(const int p1[3], const int p2[3], const int p3[3], RNScalar value, int operation = 0);
+  void RasterizeGridTriangle(const R3Point& p1, const R3Point& p2, const R3Point& p3, RNScalar value, int operation = 0);
+  void RasterizeWorldTriangle(const R3Point& p1, const R3Point& p2, const R3Point& p3, RNScalar value, int operation = 0);
+  void RasterizeGridSphere(const R3Point& center, RNLength radius, RNScalar value, RNBoolean solid = TRUE, int operation = 0);
+  void RasterizeWorldSphere(const R3Point& center, RNLength radius, RNScalar value, RNBoolean solid = TRUE, int operation = 0);
+
+  // Transformation manipulation functions
+  void SetWorldToGridTransformation(const R3Affine& affine);
+  void SetWorldToGridTransformation(const R3Box& world_box);
+
+  // Transformation utility functions
+  R3Point WorldPosition(const R3Point& grid_point) const;
+  R3Point GridPosition(const R3Point& world_point) const;
+  R3Point WorldPosition(RNCoord x, RNCoord y, RNCoord z) const;
+  R3Point GridPosition(RNCoord x, RNCoord y, RNCoord z) const;
+
+  // Conversion functions
+  R3Grid *CreateDenseGrid(void) const;
+
+  // I/O functions
+  int ReadFile(const char *filename);
+  int WriteFile(const char *filename) const;
+  int ReadSparseGridFile(const char *filename);
+  int WriteSparseGridFile(const char *filename) const;
+  int ReadSparseGrid(FILE *fp = NULL);
+  int WriteSparseGrid(FILE *fp = NULL) const;
+
+  // Utility functions
+  int GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const;
+  int GenerateIsoSurface(RNScalar isolevel, R3IndexedMesh *mesh) const;
+  int GenerateIsoSurface(RNScalar isolevel, R3PlyMesh *mesh) const;
+
+public:
+  // Internal functions
+  int FindBlockIndex(int bi, int bj, int bk) const;
+
+private:
+  R3Affine grid_to_world_transform;
+  R3Affine world_to_grid_transform;
+  RNScalar world_to_grid_scale_factor;
+  RNScalar grid_to_world_scale_factor;
+  int grid_resolution[3];
+  float background_value;
+  std::vector<R3SparseGridBlock *> blocks;
+  std::unordered_map<RNInt64, int> block_indices;
+};
+
+
+
+// Inline functions
+
+inline int R3SparseGrid::
+XResolution(void) const
+{
+  // Return resolution in X dimension
+  return grid_resolution[RN_X];
+}
+
+
+
+inline int R3SparseGrid::
+YResolution(void) const
+{
+  // Return resolution in Y dimension
+  return grid_resolution[RN_Y];
+}
+
+
+
+inline int R3SparseGrid::
+ZResolution(void) const
+{
+  // Return resolution in Z dimension
+  return grid_resolution[RN_Z];
+}
+
+
+
+inline int R3SparseGrid::
+Resolution(RNDimension dim) const
+{
+  // Return resolution in dimension
+  assert((0 <= dim) && (dim <= 2));
+  return grid_resolution[dim];
+}
+
+
+
+inline RNScalar R3SparseGrid::
+BackgroundValue(void) const
+{
+  // Return value of grid points in unallocated blocks
+  return background_value;
+}
+
+
+
+inline R3Box R3SparseGrid::
+GridBox(void) const
+{
+  // Return bounding box in grid coordinates
+  return R3Box(0, 0, 0, grid_resolution[0]-1, grid_resolution[1]-1, grid_resolution[2]-1);
+}
+
+
+
+inline R3Box R3SparseGrid::
+WorldBox(void) const
+{
+  // Return bounding box in world coordinates
+  R3Point p1(0, 0, 0);
+  R3Point p2(grid_resolution[0]-1, grid_resolution[1]-1, grid_resolution[2]-1);
+  return R3Box(WorldPosition(p1), WorldPosition(p2));
+}
+
+
+
+inline int R3SparseGrid::
+NBlocks(void) const
+{
+  // Return number of allocated blocks
+  return (int) blocks.size();
+}
+
+
+
+inline const R3SparseGridBlock *R3SparseGrid::
+Block(int block_index) const
+{
+  // Return allocated block
+  assert((block_index >= 0) && (block_index < (int) blocks.size()));
+  return blocks[block_index];
+}
+
+
+
+inline RNInt64 R3SparseGrid::
+NAllocatedValues(void) const
+{
+  // Return number of values stored in allocated blocks
+  return (RNInt64) blocks.size() * R3_SPARSE_GRID_BLOCK_VOLUME;
+}
+
+
+
+inline const R3Affine& R3SparseGrid::
+WorldToGridTransformation(void) const
+{
+  // Return transformation from world coordinates to grid coordinates
+  return world_to_grid_transform;
+}
+
+
+
+inline const R3Affine& R3SparseGrid::
+GridToWorldTransformation(void) const
+{
+  // Return transformation from grid coordinates to world coordinates
+  return grid_to_world_transform;
+}
+
+
+
+inline RNScalar R3SparseGrid::
+WorldToGridScaleFactor(void) const
+{
+  // Return scale factor from world coordinates to grid coordinates
+  return world_to_grid_scale_factor;
+}
+
+
+
+inline RNScalar R3SparseGrid::
+GridToWorldScaleFactor(void) const
+{
+  // Return scale factor from grid coordinates to world coordinates
+  return grid_to_world_scale_factor;
+}
+
+
+
+inline int R3SparseGrid::
+FindBlockIndex(int bi, int bj, int bk) const
+{
+  // Return index of allocated block with block coordinates (bi, bj, bk), or -1
+  RNInt64 key = ((RNInt64) bk << 42) | ((RNInt64) bj << 21) | (RNInt64) bi;
+  std::unordered_map<RNInt64, int>::const_iterator it = block_indices.find(key);
+  return (it != block_indices.end()) ? it->second : -1;
+}
+
+
+
+inline const R3SparseGridBlock *R3SparseGrid::
+FindBlock(int i, int j, int k) const
+{
+  // Return allocated block containing grid point, or NULL
+  int block_index = FindBlockIndex(i >> R3_SPARSE_GRID_BLOCK_BITS,
+    j >> R3_SPARSE_GRID_BLOCK_BITS, k >> R3_SPARSE_GRID_BLOCK_BITS);
+  return (block_index >= 0) ? blocks[block_index] : NULL;
+}
+
+
+
+inline RNScalar R3SparseGrid::
+GridValue(int i, int j, int k) const
+{
+  // Return value at grid point
+  assert((0 <= i) && (i < XResolution()));
+  assert((0 <= j) && (j < YResolution()));
+  assert((0 <= k) && (k < ZResolution()));
+  const R3SparseGridBlock *block = FindBlock(i, j, k);
+  if (!block) return background_value;
+  const int mask = R3_SPARSE_GRID_BLOCK_SIZE - 1;
+  return block->values[(((k & mask) << R3_SPARSE_GRID_BLOCK_BITS) + (j & mask)) * R3_SPARSE_GRID_BLOCK_SIZE + (i & mask)];
+}
+
+
+
+inline RNScalar R3SparseGrid::
+GridValue(const R3Point& point) const
+{
+  // Return value at grid point
+  return GridValue(point[0], point[1], point[2]);
+}
+
+
+
+inline RNScalar R3SparseGrid::
+WorldValue(const R3Point& point) const
+{
+  // Return value at world point
+  return GridValue(GridPosition(point));
+}
+
+
+
+inline RNScalar R3SparseGrid::
+WorldValue(RNCoord x, RNCoord y, RNCoord z) const
+{
+  // Return value at world point
+  return GridValue(GridPosition(x, y, z));
+}
+
+
+
+inline void R3SparseGrid::
+SetGridValue(int i, int j, int k, RNScalar value)
+{
+  // Set value at grid point (allocating block if necessary)
+  assert((0 <= i) && (i < XResolution()));
+  assert((0 <= j) && (j < YResolution()));
+  assert((0 <= k) && (k < ZResolution()));
+  R3SparseGridBlock *block = AllocateBlock(i, j, k);
+  const int mask = R3_SPARSE_GRID_BLOCK_SIZE - 1;
+  block->values[(((k & mask) << R3_SPARSE_GRID_BLOCK_BITS) + (j & mask)) * R3_SPARSE_GRID_BLOCK_SIZE + (i & mask)] = value;
+}
+
+
+
+inline void R3SparseGrid::
+AddGridValue(int i, int j, int k, RNScalar value)
+{
+  // Add value at grid point (allocating block if necessary)
+  assert((0 <= i) && (i < XResolution()));
+  assert((0 <= j) && (j < YResolution()));
+  assert((0 <= k) && (k < ZResolution()));
+  R3SparseGridBlock *block = AllocateBlock(i, j, k);
+  const int mask = R3_SPARSE_GRID_BLOCK_SIZE - 1;
+  block->values[(((k & mask) << R3_SPARSE_GRID_BLOCK_BITS) + (j & mask)) * R3_SPARSE_GRID_BLOCK_SIZE + (i & mask)] += value;
+}
+
+
+
+inline void R3SparseGrid::
+RasterizeGridPoint(const R3Point& point, RNScalar value, int operation)
+{
+  // Splat value at grid point
+  RasterizeGridPoint(point[0], point[1], point[2], value, operation);
+}
+
+
+
+inline void R3SparseGrid::
+RasterizeWorldPoint(const R3Point& world_point, RNScalar value, int operation)
+{
+  // Splat value at world point
+  RasterizeGridPoint(GridPosition(world_point), value, operation);
+}
+
+
+
+inline void R3SparseGrid::
+RasterizeGridTriangle(const R3Point& p1, const R3Point& p2, const R3Point& p3, RNScalar value, int operation)
+{
+  // Splat value everywhere inside grid triangle
+  int i1[3] = { (int) (p1[0] + 0.5), (int) (p1[1] + 0.5), (int) (p1[2] + 0.5) };
+  int i2[3] = { (int) (p2[0] + 0.5), (int) (p2[1] + 0.5), (int) (p2[2] + 0.5) };
+  int i3[3] = { (int) (p3[0] + 0.5), (int) (p3[1] + 0.5), (int) (p3[2] + 0.5) };
+  RasterizeGridTriangle(i1, i2, i3, value, operation);
+}
+
+
+
+inline void R3SparseGrid::
+RasterizeWorldTriangle(const R3Point& p1, const R3Point& p2, const R3Point& p3, RNScalar value, int operation)
+{
+  // Splat value everywhere inside world triangle
+  RasterizeGridTriangle(GridPosition(p1), GridPosition(p2), GridPosition(p3), value, operation);
+}
+
+
+
+inline void R3SparseGrid::
+RasterizeWorldSphere(const R3Point& center, RNLength radius, RNScalar value, RNBoolean solid, int operation)
+{
+  // Splat value everywhere inside world sphere
+  RasterizeGridSphere(GridPosition(center), radius * WorldToGridScaleFactor(), value, solid, operation);
+}
+
+
+
+inline R3Point R3SparseGrid::
+WorldPosition(const R3Point& grid_point) const
+{
+  // Transform point from grid coordinates to world coordinates
+  return WorldPosition(grid_point[0], grid_point[1], grid_point[2]);
+}
+
+
+
+inline R3Point R3SparseGrid::
+GridPosition(const R3Point& world_point) const
+{
+  // Transform point from world coordinates to grid coordinates
+  return GridPosition(world_point[0], world_point[1], world_point[2]);
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -0,0 +1,447 @@
+// Source file for triangle bounding volume hierarchy class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes.h"
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructor/destructor functions
+////////////////////////////////////////////////////////////////////////
+
+R3TriangleBVH::
+R3TriangleBVH(void)
+  : positions(),
+    identifiers(),
+    order(),
+    nodes(),
+    bbox(R3null_box),
+    built(FALSE)
+{
+}
+
+
+
+R3TriangleBVH::
+~R3TriangleBVH(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Insert/build functions
+////////////////////////////////////////////////////////////////////////
+
+int R3TriangleBVH::
+InsertTriangle(const R3Point& p0, const R3Point& p1, const R3Point& p2, int identifier)
+{
+  // Insert vertex positions
+  const R3Point *p[3] = { &p0, &p1, &p2 };
+  for (int k = 0; k < 3; k++) {
+    for (int dim = 0; dim < 3; dim++) {
+      positions.push_back((float) (*p[k])[dim]);
+    }
+    bbox.Union(*p[k]);
+  }
+
+  // Insert identifier
+  identifiers.push_back(identifier);
+
+  // Hierarchy must be rebuilt
+  built = FALSE;
+
+  // Return index of triangle
+  return (int) identifiers.size() - 1;
+}
+
+
+
+void R3TriangleBVH::
+InsertMesh(const R3Mesh& mesh)
+{
+  // Insert all faces of mesh (identifier is face index)
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3MeshFace *face = mesh.Face(i);
+    const R3Point& p0 = mesh.VertexPosition(mesh.VertexOnFace(face, 0));
+    const R3Point& p1 = mesh.VertexPosition(mesh.VertexOnFace(face, 1));
+    const R3Point& p2 = mesh.VertexPosition(mesh.VertexOnFace(face, 2));
+    InsertTriangle(p0, p1, p2, i);
+  }
+}
+
+
+
+void R3TriangleBVH::
+InsertMesh(const R3IndexedMesh& mesh)
+{
+  // Insert all faces of mesh (identifier is face index)
+  for (int i = 0; i < mesh.NFaces(); i++) {
+    R3Point p0 = mesh.VertexPosition(mesh.VertexOnFace(i, 0));
+    R3Point p1 = mesh.VertexPosition(mesh.VertexOnFace(i, 1));
+    R3Point p2 = mesh.VertexPosition(mesh.VertexOnFace(i, 2));
+    InsertTriangle(p0, p1, p2, i);
+  }
+}
+
+
+
+void R3TriangleBVH::
+Empty(void)
+{
+  // Remove everything
+  positions.clear();
+  identifiers.clear();
+  order.clear();
+  nodes.clear();
+  bbox = R3null_box;
+  built = FALSE;
+}
+
+
+
+static void
+ComputeTriangleBounds(const float *p, float *bmin, float *bmax)
+{
+  // Compute bounding box of one triangle
+  for (int dim = 0; dim < 3; dim++) {
+    bmin[dim] = p[dim];
+    bmax[dim] = p[dim];
+    if (p[3+dim] < bmin[dim]) bmin[dim] = p[3+dim];
+    if (p[3+dim] > bmax[dim]) bmax[dim] = p[3+dim];
+    if (p[6+dim] < bmin[dim]) bmin[dim] = p[6+dim];
+    if (p[6+dim] > bmax[dim]) bmax[dim] = p[6+dim];
+  }
+}
+
+
+
+struct R3TriangleBVHCentroidCompare {
+  R3TriangleBVHCentroidCompare(const float *positions, int dim) : positions(positions), dim(dim) {};
+  bool operator()(int a, int b) const {
+    const float *pa = &positions[9*a + dim];
+    const float *pb = &positions[9*b + dim];
+    return (pa[0] + pa[3] + pa[6]) < (pb[0] + pb[3] + pb[6]);
+  }
+  const float *positions;
+  int dim;
+};
+
+
+
+int R3TriangleBVH::
+BuildNode(int start, int end, int max_triangles_per_leaf)
+{
+  // Create node
+  int node_index = (int) nodes.size();
+  nodes.push_back(R3TriangleBVHNode());
+
+  // Compute bounding boxes of triangles and of their centroids
+  float bmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float bmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  float cmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float cmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (int i = start; i < end; i++) {
+    float tmin[3], tmax[3];
+    const float *p = &positions[9*order[i]];
+    ComputeTriangleBounds(p, tmin, tmax);
+    for (int dim = 0; dim < 3; dim++) {
+      if (tmin[dim] < bmin[dim]) bmin[dim] = tmin[dim];
+      if (tmax[dim] > bmax[dim]) bmax[dim] = tmax[dim];
+      float c = p[dim] + p[3+dim] + p[6+dim];
+      if (c < cmin[dim]) cmin[dim] = c;
+      if (c > cmax[dim]) cmax[dim] = c;
+    }
+  }
+
+  // Fill in bounding box
+  for (int dim = 0; dim < 3; dim++) {
+    nodes[node_index].bmin[dim] = bmin[dim];
+    nodes[node_index].bmax[dim] = bmax[dim];
+  }
+
+  // Choose split dimension
+  int split_dim = 0;
+  for (int dim = 1; dim < 3; dim++) {
+    if ((cmax[dim] - cmin[dim]) > (cmax[split_dim] - cmin[split_dim])) split_dim = dim;
+  }
+
+  // Check if leaf
+  if ((end - start <= max_triangles_per_leaf) || (cmax[split_dim] <= cmin[split_dim])) {
+    nodes[node_index].first = start;
+    nodes[node_index].count = end - start;
+    return node_index;
+  }
+
+  // Partition triangles at median centroid
+  int middle = (start + end) / 2;
+  R3TriangleBVHCentroidCompare compare(&positions[0], split_dim);
+  std::nth_element(order.begin() + start, order.begin() + middle, order.begin() + end, compare);
+
+  // Create children (left child immediately follows its parent)
+  BuildNode(start, middle, max_triangles_per_leaf);
+  int right_index = BuildNode(middle, end, max_triangles_per_leaf);
+  nodes[node_index].first = right_index;
+  nodes[node_index].count = 0;
+
+  // Return node index
+  return node_index;
+}
+
+
+
+void R3TriangleBVH::
+Build(int max_triangles_per_leaf)
+{
+  // Initialize hierarchy
+  nodes.clear();
+  order.resize(identifiers.size());
+  for (unsigned int i = 0; i < order.size(); i++) order[i] = i;
+  built = TRUE;
+
+  // Check triangles
+  if (order.empty()) return;
+
+  // Build hierarchy
+  nodes.reserve(2 * order.size() / max_triangles_per_leaf + 1);
+  BuildNode(0, (int) order.size(), max_triangles_per_leaf);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Ray intersection functions
+////////////////////////////////////////////////////////////////////////
+
+static inline RNBoolean
+IntersectNodeBox(const R3TriangleBVHNode& node, const double origin[3], const double inverse_direction[3],
+  double min_t, double max_t, double *entry_t)
+{
+  // Slab test
+  double t0 = min_t, t1 = max_t;
+  for (int dim = 0; dim < 3; dim++) {
+    double ta = (node.bmin[dim] - origin[dim]) * inverse_direction[dim];
+    double tb = (node.bmax[dim] - origin[dim]) * inverse_direction[dim];
+    if (ta > tb) { double swap = ta; ta = tb; tb = swap; }
+    if (ta > t0) t0 = ta;
+    if (tb < t1) t1 = tb;
+    if (t0 > t1) return FALSE;
+  }
+
+  // Return entry parameter
+  *entry_t = t0;
+  return TRUE;
+}
+
+
+
+RNBoolean R3TriangleBVH::
+IntersectTriangle(int triangle_index, const double origin[3], const double direction[3],
+  double min_t, double max_t, double *hit_t) const
+{
+  // Moller-Trumbore intersection (double sided)
+  const float *p = &positions[9*triangle_index];
+  double e1[3], e2[3], s[3], pv[3], qv[3];
+  for (int dim = 0; dim < 3; dim++) {
+    e1[dim] = p[3+dim] - p[dim];
+    e2[dim] = p[6+dim] - p[dim];
+    s[dim] = origin[dim] - p[dim];
+  }
+  pv[0] = direction[1]*e2[2] - direction[2]*e2[1];
+  pv[1] = direction[2]*e2[0] - direction[0]*e2[2];
+  pv[2] = direction[0]*e2[1] - direction[1]*e2[0];
+  double det = e1[0]*pv[0] + e1[1]*pv[1] + e1[2]*pv[2];
+  if ((det > -1E-20) && (det < 1E-20)) return FALSE;
+  double inv_det = 1.0 / det;
+  double u = (s[0]*pv[0] + s[1]*pv[1] + s[2]*pv[2]) * inv_det;
+  if ((u < 0) || (u > 1)) return FALSE;
+  qv[0] = s[1]*e1[2] - s[2]*e1[1];
+  qv[1] = s[2]*e1[0] - s[0]*e1[2];
+  qv[2] = s[0]*e1[1] - s[1]*e1[0];
+  double v = (direction[0]*qv[0] + direction[1]*qv[1] + direction[2]*qv[2]) * inv_det;
+  if ((v < 0) || (u + v > 1)) return FALSE;
+  double t = (e2[0]*qv[0] + e2[1]*qv[1] + e2[2]*qv[2]) * inv_det;
+  if ((t < min_t) || (t > max_t)) return FALSE;
+
+  // Return intersection parameter
+  *hit_t = t;
+  return TRUE;
+}
+
+
+
+RNBoolean R3TriangleBVH::
+FindIntersection(const R3Ray& ray,
+  int *hit_identifier, int *hit_triangle_index,
+  R3Point *hit_point, R3Vector *hit_normal, RNScalar *hit_t,
+  RNScalar min_t, RNScalar max_t) const
+{
+  // Check hierarchy
+  assert(built);
+  if (nodes.empty()) return FALSE;
+
+  // Get ray data
+  double origin[3], direction[3], inverse_direction[3];
+  for (int dim = 0; dim < 3; dim++) {
+    origin[dim] = ray.Start()[dim];
+    direction[dim] = ray.Vector()[dim];
+    inverse_direction[dim] = (direction[dim] != 0) ? 1.0 / direction[dim] : 1.0E30;
+  }
+
+  // Traverse hierarchy front to back
+  int closest_triangle = -1;
+  double closest_t = max_t;
+  int stack[128];
+  int stack_size = 0;
+  double entry_t;
+  if (!IntersectNodeBox(nodes[0], origin, inverse_direction, min_t, closest_t, &entry_t)) return FALSE;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    int node_index = stack[--stack_size];
+    const R3TriangleBVHNode& node = nodes[node_index];
+    if (!IntersectNodeBox(node, origin, inverse_direction, min_t, closest_t, &entry_t)) continue;
+    if (node.count > 0) {
+      // Intersect triangles in leaf
+      for (int i = node.first; i < node.first + node.count; i++) {
+        double t;
+        if (IntersectTriangle(order[i], origin, direction, min_t, closest_t, &t)) {
+          closest_triangle = order[i];
+          closest_t = t;
+        }
+      }
+    }
+    else {
+      // Push children (nearest one last so that it is visited first)
+      int left_index = node_index + 1;
+      int right_index = node.first;
+      double left_t, right_t;
+      RNBoolean left_hit = IntersectNodeBox(nodes[left_index], origin, inverse_direction, min_t, closest_t, &left_t);
+      RNBoolean right_hit = IntersectNodeBox(nodes[right_index], origin, inverse_direction, min_t, closest_t, &right_t);
+      if (left_hit && right_hit) {
+        if (left_t < right_t) { stack[stack_size++] = right_index; stack[stack_size++] = left_index; }
+        else { stack[stack_size++] = left_index; stack[stack_size++] = right_index; }
+      }
+      else if (left_hit) stack[stack_size++] = left_index;
+      else if (right_hit) stack[stack_size++] = right_index;
+    }
+  }
+
+  // Check if found intersection
+  if (closest_triangle < 0) return FALSE;
+
+  // Fill in results
+  if (hit_identifier) *hit_identifier = identifiers[closest_triangle];
+  if (hit_triangle_index) *hit_triangle_index = closest_triangle;
+  if (hit_point) *hit_point = ray.Point(closest_t);
+  if (hit_t) *hit_t = closest_t;
+  if (hit_normal) {
+    R3Point p0 = TrianglePosition(closest_triangle, 0);
+    R3Point p1 = TrianglePosition(closest_triangle, 1);
+    R3Point p2 = TrianglePosition(closest_triangle, 2);
+    *hit_normal = (p1 - p0) % (p2 - p0);
+    hit_normal->Normalize();
+  }
+
+  // Return success
+  return TRUE;
+}
+
+
+
+RNBoolean R3TriangleBVH::
+IsOccluded(const R3Ray& ray, RNScalar min_t, RNScalar max_t) const
+{
+  // Check hierarchy
+  assert(built);
+  if (nodes.empty()) return FALSE;
+
+  // Get ray data
+  double origin[3], direction[3], inverse_direction[3];
+  for (int dim = 0; dim < 3; dim++) {
+    origin[dim] = ray.Start()[dim];
+    direction[dim] = ray.Vector()[dim];
+    inverse_direction[dim] = (direction[dim] != 0) ? 1.0 / direction[dim] : 1.0E30;
+  }
+
+  // Traverse hierarchy until find any hit
+  int stack[128];
+  int stack_size = 0;
+  double entry_t, t;
+  stack[stack_size++] = 0;
+  while (stack_size > 0) {
+    int node_index = stack[--stack_size];
+    const R3TriangleBVHNode& node = nodes[node_index];
+    if (!IntersectNodeBox(node, origin, inverse_direction, min_t, max_t, &entry_t)) continue;
+    if (node.count > 0) {
+      for (int i = node.first; i < node.first + node.count; i++) {
+        if (IntersectTriangle(order[i], origin, direction, min_t, max_t, &t)) return TRUE;
+      }
+    }
+    else {
+      stack[stack_size++] = node.first;
+      stack[stack_size++] = node_index + 1;
+    }
+  }
+
+  // No hit found
+  return FALSE;
+}
+
+
+
+struct R3TriangleBVHBatchData {
+  const R3TriangleBVH *bvh;
+  const R3Ray *rays;
+  int *hit_identifiers;
+  RNScalar *hit_ts;
+  RNScalar min_t, max_t;
+};
+
+
+
+static void
+FindIntersectionsCallback(int index, int thread_index, void *data)
+{
+  // Intersect one ray
+  R3TriangleBVHBatchData *batch = (R3TriangleBVHBatchData *) data;
+  int hit_identifier = -1;
+  RNScalar hit_t = RN_INFINITY;
+  if (!batch->bvh->FindIntersection(batch->rays[index], &hit_identifier, NULL, NULL, NULL,
+    &hit_t, batch->min_t, batch->max_t)) { hit_identifier = -1; hit_t = RN_INFINITY; }
+  if (batch->hit_identifiers) batch->hit_identifiers[index] = hit_identifier;
+  if (batch->hit_ts) batch->hit_ts[index] = hit_t;
+}
+
+
+
+void R3TriangleBVH::
+FindIntersections(int nrays, const R3Ray *rays,
+  int *hit_identifiers, RNScalar *hit_ts,
+  RNScalar min_t, RNScalar max_t) const
+{
+  // Intersect rays in parallel (misses get identifier -1 and t RN_INFINITY)
+  assert(built);
+  R3TriangleBVHBatchData batch;
+  batch.bvh = this;
+  batch.rays = rays;
+  batch.hit_identifiers = hit_identifiers;
+  batch.hit_ts = hit_ts;
+  batch.min_t = min_t;
+  batch.max_t = max_t;
+  RNParallelFor(nrays, FindIntersectionsCallback, &batch, 64);
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,138 @@
+// Include file for triangle bounding volume hierarchy
+#ifndef __R3__TRIANGLE__BVH__H__
+#define __R3__TRIANGLE__BVH__H__
+
+
+
+// Include files
+
+#include <vector>
+
+
+
+// Begin namespace
+
+namespace gaps {
+
+
+
+// Node definition
+
+struct R3TriangleBVHNode {
+  float bmin[3];
+  float bmax[3];
+  int first;      // index of right child (interior) or first entry in order (leaf)
+  int count;      // number of triangles (leaf) or zero (interior)
+};
+
+
+
+// Class definition
+
+class R3TriangleBVH {
+public:
+  // Constructor/deconstructor
+  R3TriangleBVH(void);
+  ~R3TriangleBVH(void);
+
+  // Property functions
+  int NTriangles(void) const;
+  int NNodes(void) const;
+  const R3Box& BBox(void) const;
+
+  // Triangle access functions
+  R3Point TrianglePosition(int triangle_index, int k) const;
+  int TriangleIdentifier(int triangle_index) const;
+
+  // Insert/build functions
+  int InsertTriangle(const R3Point& p0, const R3Point& p1, const R3Point& p2, int identifier = -1);
+  void InsertMesh(const R3Mesh& mesh);
+  void InsertMesh(const R3IndexedMesh& mesh);
+  void Build(int max_triangles_per_leaf = 4);
+  void Empty(void);
+
+  // Find closest ray intersection (thread safe after Build)
+  RNBoolean FindIntersection(const R3Ray& ray,
+    int *hit_identifier = NULL, int *hit_triangle_index = NULL,
+    R3Point *hit_point = NULL, R3Vector *hit_normal = NULL, RNScalar *hit_t = NULL,
+    RNScalar min_t = 0, RNScalar max_t = RN_INFINITY) const;
+
+  // Check whether any triangle intersects ray segment (thread safe after Build)
+  RNBoolean IsOccluded(const R3Ray& ray, RNScalar min_t, RNScalar max_t) const;
+
+  // Find closest intersections for many rays in parallel
+  void FindIntersections(int nrays, const R3Ray *rays,
+    int *hit_identifiers, RNScalar *hit_ts,
+    RNScalar min_t = 0, RNScalar max_t = RN_INFINITY) const;
+
+public:
+  // Internal functions
+  int BuildNode(int start, int end, int max_triangles_per_leaf);
+  RNBoolean IntersectTriangle(int triangle_index, const double origin[3], const double direction[3],
+    double min_t, double max_t, double *hit_t) const;
+
+private:
+  std::vector<float> positions;
+  std::vector<int> identifiers;
+  std::vector<int> order;
+  std::vector<R3TriangleBVHNode> nodes;
+  R3Box bbox;
+  RNBoolean built;
+};
+
+
+
+// Inline functions
+
+inline int R3TriangleBVH::
+NTriangles(void) const
+{
+  // Return number of triangles
+  return (int) identifiers.size();
+}
+
+
+
+inline int R3TriangleBVH::
+NNodes(void) const
+{
+  // Return number of nodes in hierarchy
+  return (int) nodes.size();
+}
+
+
+
+inline const R3Box& R3TriangleBVH::
+BBox(void) const
+{
+  // Return bounding box of all triangles
+  return bbox;
+}
+
+
+
+inline R3Point R3TriangleBVH::
+TrianglePosition(int triangle_index, int k) const
+{
+  // Return position of kth vertex of triangle
+  const float *p = &positions[9*triangle_index + 3*k];
+  return R3Point(p[0], p[1], p[2]);
+}
+
+
+
+inline int R3TriangleBVH::
+TriangleIdentifier(int triangle_index) const
+{
+  // Return identifier of triangle
+  return identifiers[triangle_index];
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
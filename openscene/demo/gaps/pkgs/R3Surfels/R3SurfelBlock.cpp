@@ -1714,16 +1714,76 @@ ReadPlyFile(const char *filename)
 int R3SurfelBlock::
 ReadPly(FILE *fp)
 {
-  // Read into mesh
-  R3Mesh mesh;
-  if (!mesh.ReadPlyStream(fp)) return 0;
+  // Read mesh arrays (binary files are decoded without building an R3Mesh)
+  R3PlyMesh mesh;
+  if (!R3ReadPlyMesh(fp, &mesh)) return 0;
 
   // Determine the number of surfels
   nsurfels = mesh.NVertices();
   if (nsurfels == 0) return 1;
+  int nfaces = mesh.NFaces();
+  const float *p = &mesh.positions[0];
+  const int *f = (nfaces > 0) ? &mesh.indices[0] : NULL;
+
+  // Determine position origin (area weighted centroid of faces, as in R3Mesh)
+  RNArea area = 0;
+  R3Point centroid(0, 0, 0);
+  for (int i = 0; i < nfaces; i++) {
+    R3Point p0(p[3*f[3*i+0]+0], p[3*f[3*i+0]+1], p[3*f[3*i+0]+2]);
+    R3Point p1(p[3*f[3*i+1]+0], p[3*f[3*i+1]+1], p[3*f[3*i+1]+2]);
+    R3Point p2(p[3*f[3*i+2]+0], p[3*f[3*i+2]+1], p[3*f[3*i+2]+2]);
+    RNArea face_area = 0.5 * ((p1 - p0) % (p2 - p0)).Length();
+    centroid += face_area * (p0 + p1 + p2) / 3.0;
+    area += face_area;
+  }
+  if (nfaces == 0) {
+    for (int i = 0; i < nsurfels; i++) centroid += R3Point(p[3*i+0], p[3*i+1], p[3*i+2]);
+    area = nsurfels;
+  }
+  position_origin = (area > 0) ? centroid / area : centroid;
+
+  // Compute vertex normals from faces if file has none
+  std::vector<R3Vector> face_normal_sums;
+  if (mesh.normals.empty()) {
+    face_normal_sums.assign(nsurfels, R3zero_vector);
+    for (int i = 0; i < nfaces; i++) {
+      R3Point p0(p[3*f[3*i+0]+0], p[3*f[3*i+0]+1], p[3*f[3*i+0]+2]);
+      R3Point p1(p[3*f[3*i+1]+0], p[3*f[3*i+1]+1], p[3*f[3*i+1]+2]);
+      R3Point p2(p[3*f[3*i+2]+0], p[3*f[3*i+2]+1], p[3*f[3*i+2]+2]);
+      R3Vector face_normal = (p1 - p0) % (p2 - p0);
+      face_normal.Normalize();
+      for (int k = 0; k < 3; k++) face_normal_sums[f[3*i+k]] += face_normal;
+    }
+  }
 
-  // Determine position origin
-  position_origin = mesh.Centroid();
+  // Sort edges to find unique edges and the number of faces on each
+  std::vector<unsigned long long> edge_keys;
+  edge_keys.reserve(3 * nfaces);
+  for (int i = 0; i < nfaces; i++) {
+    for (int k = 0; k < 3; k++) {
+      unsigned long long v0 = f[3*i+k], v1 = f[3*i+(k+1)%3];
+      if (v0 > v1) { unsigned long long swap = v0; v0 = v1; v1 = swap; }
+      edge_keys.push_back((v0 << 32) | v1);
+    }
+  }
+  std::sort(edge_keys.begin(), edge_keys.end());
+
+  // Accumulate edge lengths and boundary flags on vertices
+  std::vector<RNLength> edge_length_sums(nsurfels, 0.0);
+  std::vector<int> valences(nsurfels, 0);
+  std::vector<unsigned char> boundaries(nsurfels, 0);
+  for (size_t i = 0; i < edge_keys.size(); ) {
+    size_t j = i + 1;
+    while ((j < edge_keys.size()) && (edge_keys[j] == edge_keys[i])) j++;
+    int v0 = (int) (edge_keys[i] >> 32);
+    int v1 = (int) (edge_keys[i] & 0xFFFFFFFF);
+    R3Vector edge(p[3*v1+0] - p[3*v0+0], p[3*v1+1] - p[3*v0+1], p[3*v1+2] - p[3*v0+2]);
+    RNLength length = edge.Length();
+    edge_length_sums[v0] += length; valences[v0]++;
+    edge_length_sums[v1] += length; valences[v1]++;
+    if (j - i == 1) boundaries[v0] = boundaries[v1] = 1;
+    i = j;
+  }
 
   // Allocate array of surfels
   surfels = new R3Surfel [ nsurfels ];
@@ -1733,24 +1793,23 @@ ReadPly(FILE *fp)
   }
 
   // Fill array of surfels
-  for (int i = 0; i < mesh.NVertices(); i++) {
-    R3MeshVertex *vertex = mesh.Vertex(i);
-    const R3Point& position = mesh.VertexPosition(vertex);
-    R3Vector normal = mesh.VertexNormal(vertex);
+  for (int i = 0; i < nsurfels; i++) {
+    R3Vector normal = (mesh.normals.empty()) ? face_normal_sums[i] :
+      R3Vector(mesh.normals[3*i+0], mesh.normals[3*i+1], mesh.normals[3*i+2]);
+    normal.Normalize();
     if (normal.Length() == 0) normal = R3posz_vector;
-    const RNRgb& color = mesh.VertexColor(vertex);
-    RNLength radius = mesh.VertexAverageEdgeLength(vertex);
+    RNLength radius = (valences[i] > 0) ? edge_length_sums[i] / valences[i] : 0;
     if (radius == 0) radius = 0.01;
-    RNBoolean boundary = mesh.IsVertexOnBoundary(vertex);
-    float x = (float) (position.X() - position_origin.X());
-    float y = (float) (position.Y() - position_origin.Y());
-    float z = (float) (position.Z() - position_origin.Z());
+    float x = (float) (p[3*i+0] - position_origin.X());
+    float y = (float) (p[3*i+1] - position_origin.Y());
+    float z = (float) (p[3*i+2] - position_origin.Z());
     surfels[i].SetPosition(x, y, z);
     surfels[i].SetNormal(normal.X(), normal.Y(), normal.Z());
     surfels[i].SetRadius(radius);
     surfels[i].SetIdentifier(i+1);
-    surfels[i].SetColor(color);
-    surfels[i].SetBorderBoundary(boundary);
+    if (!mesh.colors.empty()) surfels[i].SetColor(&mesh.colors[3*i]);
+    else surfels[i].SetColor(RNblack_rgb);
+    surfels[i].SetBorderBoundary(boundaries[i]);
     surfels[i].SetAerial(FALSE);
   }
 
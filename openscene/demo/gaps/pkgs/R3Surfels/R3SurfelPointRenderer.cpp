@@ -0,0 +1,567 @@
+/* Source file for the R3 surfel point renderer class */
+
+
+
+////////////////////////////////////////////////////////////////////////
+// INCLUDE FILES
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Surfels.h"
+#include <queue>
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// CONSTANTS
+////////////////////////////////////////////////////////////////////////
+
+// Maximum depth of octree (number of bits per dimension in morton codes)
+static const int R3_SURFEL_POINT_RENDERER_MAX_LEVEL = 20;
+
+// Maximum number of points whose geometry or colors are uploaded per frame
+static const int R3_SURFEL_POINT_RENDERER_MAX_UPLOAD_POINTS = 2 * 1024 * 1024;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS/DESTRUCTORS
+////////////////////////////////////////////////////////////////////////
+
+R3SurfelPointRenderer::
+R3SurfelPointRenderer(void)
+  : origin(0, 0, 0),
+    bbox(R3null_box),
+    points(),
+    colors(),
+    identifiers(),
+    nodes(),
+    selected_nodes(),
+    culler(),
+    selection_valid(0),
+    color_callback(NULL),
+    color_callback_data(NULL),
+    color_stamp(0),
+    frame(0),
+    nresident_points(0),
+    screen_space_error(1),
+    point_budget(8 * 1024 * 1024),
+    frustum_culling(1)
+{
+}
+
+
+
+R3SurfelPointRenderer::
+~R3SurfelPointRenderer(void)
+{
+  // GPU buffers must be released with ReleaseBuffers while opengl context is current
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// BUILD FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+static unsigned long long
+SpreadBits(unsigned int x)
+{
+  // Insert two zero bits between each of the lowest 21 bits of x
+  unsigned long long v = x & 0x1FFFFF;
+  v = (v | (v << 32)) & 0x1F00000000FFFFULL;
+  v = (v | (v << 16)) & 0x1F0000FF0000FFULL;
+  v = (v | (v << 8)) & 0x100F00F00F00F00FULL;
+  v = (v | (v << 4)) & 0x10C30C30C30C30C3ULL;
+  v = (v | (v << 2)) & 0x1249249249249249ULL;
+  return v;
+}
+
+
+
+static unsigned int
+QuantizedCoordinate(RNScalar value)
+{
+  // Return coordinate clamped to range of morton codes
+  const unsigned int max_value = (1 << (R3_SURFEL_POINT_RENDERER_MAX_LEVEL + 1)) - 1;
+  if (value <= 0) return 0;
+  if (value >= max_value) return max_value;
+  return (unsigned int) value;
+}
+
+
+
+static int
+ChildOctant(unsigned long long code, int level)
+{
+  // Return octant of child containing code at level below root
+  return (int) ((code >> (3 * (R3_SURFEL_POINT_RENDERER_MAX_LEVEL - level))) & 7);
+}
+
+
+
+int R3SurfelPointRenderer::
+Build(R3SurfelScene *scene, RNBoolean object_identifiers, int max_points_per_node)
+{
+  // Empty previous points
+  Empty();
+
+  // Get convenient variables
+  R3SurfelTree *tree = scene->Tree();
+  if (!tree) return 0;
+  R3SurfelDatabase *database = tree->Database();
+  if (!database) return 0;
+  if (max_points_per_node < 1) max_points_per_node = 1;
+
+  // Check number of surfels
+  long long nsurfels = tree->NSurfels(TRUE);
+  if (nsurfels > INT_MAX) {
+    RNFail("Too many surfels for point renderer: %lld\n", nsurfels);
+    return 0;
+  }
+
+  // Allocate packed buffers
+  points.reserve(nsurfels);
+  colors.reserve(3 * nsurfels);
+  identifiers.reserve(nsurfels);
+
+  // Read surfels from leaf blocks directly into packed buffers
+  // (positions are stored as floats relative to origin to preserve precision)
+  origin = tree->BBox().Centroid();
+  for (int i = 0; i < tree->NNodes(); i++) {
+    R3SurfelNode *node = tree->Node(i);
+    if (node->NParts() > 0) continue;
+    R3SurfelObject *object = node->Object(TRUE, TRUE);
+    int object_identifier = (object) ? object->SceneIndex() : scene->NObjects();
+    for (int j = 0; j < node->NBlocks(); j++) {
+      R3SurfelBlock *block = node->Block(j);
+      if (!database->ReadBlock(block)) continue;
+      for (int k = 0; k < block->NSurfels(); k++) {
+        R3Point position = block->SurfelPosition(k);
+        R3Vector normal = block->SurfelNormal(k);
+        RNRgb color = block->SurfelColor(k);
+        PackedPoint point;
+        point.position[0] = position.X() - origin.X();
+        point.position[1] = position.Y() - origin.Y();
+        point.position[2] = position.Z() - origin.Z();
+        for (int dim = 0; dim < 3; dim++) point.normal[dim] = (signed char) floor(127.0 * normal[dim] + 0.5);
+        point.pad = 0;
+        points.push_back(point);
+        for (int c = 0; c < 3; c++) colors.push_back((unsigned char) (255.0 * color[c] + 0.5));
+        identifiers.push_back((object_identifiers) ? object_identifier : (int) block->SurfelIdentifier(k));
+        bbox.Union(position);
+      }
+      database->ReleaseBlock(block);
+    }
+  }
+
+  // Check points
+  int npoints = (int) points.size();
+  if (npoints == 0) return 1;
+
+  // Compute morton codes on cube enclosing points
+  R3Box local_bbox(bbox.Min() - origin.Vector(), bbox.Max() - origin.Vector());
+  RNLength extent = local_bbox.LongestAxisLength();
+  RNScalar scale = (extent > 0) ? ((1 << (R3_SURFEL_POINT_RENDERER_MAX_LEVEL + 1)) - 1) / extent : 0;
+  std::vector< std::pair<unsigned long long, int> > keys(npoints);
+  for (int i = 0; i < npoints; i++) {
+    const float *p = points[i].position;
+    unsigned int x = QuantizedCoordinate(scale * (p[0] - local_bbox.XMin()));
+    unsigned int y = QuantizedCoordinate(scale * (p[1] - local_bbox.YMin()));
+    unsigned int z = QuantizedCoordinate(scale * (p[2] - local_bbox.ZMin()));
+    keys[i].first = (SpreadBits(x) << 2) | (SpreadBits(y) << 1) | SpreadBits(z);
+    keys[i].second = i;
+  }
+
+  // Sort points in morton order
+  std::sort(keys.begin(), keys.end());
+
+  // Build octree (reorders keys so that points of each node are contiguous)
+  BuildNode(keys, 0, npoints, 0, max_points_per_node);
+
+  // Permute packed buffers into octree order
+  std::vector<PackedPoint> sorted_points(npoints);
+  std::vector<unsigned char> sorted_colors(3 * npoints);
+  std::vector<int> sorted_identifiers(npoints);
+  for (int i = 0; i < npoints; i++) {
+    int k = keys[i].second;
+    sorted_points[i] = points[k];
+    sorted_colors[3*i+0] = colors[3*k+0];
+    sorted_colors[3*i+1] = colors[3*k+1];
+    sorted_colors[3*i+2] = colors[3*k+2];
+    sorted_identifiers[i] = identifiers[k];
+  }
+  points.swap(sorted_points);
+  colors.swap(sorted_colors);
+  identifiers.swap(sorted_identifiers);
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3SurfelPointRenderer::
+BuildNode(std::vector< std::pair<unsigned long long, int> >& keys,
+  int start, int end, int level, int max_points_per_node)
+{
+  // Create node
+  int node_index = (int) nodes.size();
+  Node node;
+  node.bbox = R3null_box;
+  node.spacing = 0;
+  node.first = start;
+  node.count = end - start;
+  for (int c = 0; c < 8; c++) node.children[c] = -1;
+  node.geometry_buffer = 0;
+  node.color_buffer = 0;
+  node.color_stamp = -1;
+  node.last_frame = -1;
+
+  // Compute bounding box of all points in subtree
+  for (int i = start; i < end; i++) {
+    const float *p = points[keys[i].second].position;
+    node.bbox.Union(R3Point(origin.X() + p[0], origin.Y() + p[1], origin.Z() + p[2]));
+  }
+
+  // Move uniform subsample of points (in morton order) to front of range
+  int n = end - start;
+  if ((n > max_points_per_node) && (level < R3_SURFEL_POINT_RENDERER_MAX_LEVEL)) {
+    std::vector< std::pair<unsigned long long, int> > range(keys.begin() + start, keys.begin() + end);
+    int nsamples = max_points_per_node;
+    int sample_index = start;
+    int remainder_index = start + nsamples;
+    int j = 0;
+    for (int i = 0; i < n; i++) {
+      if ((j < nsamples) && (i == (int) ((j + 0.5) * n / nsamples))) { keys[sample_index++] = range[i]; j++; }
+      else keys[remainder_index++] = range[i];
+    }
+    node.count = nsamples;
+  }
+
+  // Compute average spacing between points of node
+  int dim = node.bbox.ShortestAxis();
+  RNArea area = node.bbox.AxisLength((dim+1)%3) * node.bbox.AxisLength((dim+2)%3);
+  node.spacing = sqrt(area / node.count);
+
+  // Insert node
+  nodes.push_back(node);
+
+  // Create children from remaining points (still in morton order)
+  int child_start = start + node.count;
+  while (child_start < end) {
+    int octant = ChildOctant(keys[child_start].first, level);
+    int child_end = child_start + 1;
+    while ((child_end < end) && (ChildOctant(keys[child_end].first, level) == octant)) child_end++;
+    int child_index = BuildNode(keys, child_start, child_end, level + 1, max_points_per_node);
+    nodes[node_index].children[octant] = child_index;
+    child_start = child_end;
+  }
+
+  // Return node index
+  return node_index;
+}
+
+
+
+void R3SurfelPointRenderer::
+Empty(void)
+{
+  // Release GPU buffers
+  if (nresident_points > 0) ReleaseBuffers();
+
+  // Empty points and octree
+  origin = R3zero_point;
+  bbox = R3null_box;
+  points.clear();
+  colors.clear();
+  identifiers.clear();
+  nodes.clear();
+  selected_nodes.clear();
+  selection_valid = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PARAMETER FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+void R3SurfelPointRenderer::
+SetColorCallback(R3SurfelPointRendererColorCallback callback, void *data)
+{
+  // Set color callback
+  color_callback = callback;
+  color_callback_data = data;
+
+  // Recompute colors
+  InvalidateColors();
+}
+
+
+
+void R3SurfelPointRenderer::
+InvalidateColors(void)
+{
+  // Mark colors of all resident nodes as out of date
+  color_stamp++;
+}
+
+
+
+void R3SurfelPointRenderer::
+SetScreenSpaceError(RNScalar pixels)
+{
+  // Set maximum spacing between drawn points
+  screen_space_error = pixels;
+  selection_valid = 0;
+}
+
+
+
+void R3SurfelPointRenderer::
+SetPointBudget(int max_points)
+{
+  // Set maximum number of points drawn per frame (0 means unlimited)
+  point_budget = max_points;
+  selection_valid = 0;
+}
+
+
+
+void R3SurfelPointRenderer::
+SetFrustumCulling(int frustum_culling)
+{
+  // Set whether nodes outside view frustum are skipped
+  this->frustum_culling = frustum_culling;
+  selection_valid = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// STREAMING FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+void R3SurfelPointRenderer::
+SelectNodes(const R3Viewer& viewer)
+{
+  // Set view for culling
+  culler.SetView(viewer);
+  selected_nodes.clear();
+  selection_valid = 1;
+  if (nodes.empty()) return;
+
+  // Select nodes in order of decreasing projected point spacing,
+  // refining until points are closer than screen space error or budget is reached
+  std::priority_queue< std::pair<RNScalar, int> > queue;
+  queue.push(std::pair<RNScalar, int>(RN_INFINITY, 0));
+  int npoints = 0;
+  while (!queue.empty()) {
+    int node_index = queue.top().second;
+    queue.pop();
+    const Node& node = nodes[node_index];
+    if (frustum_culling && (culler.FrustumClassification(node.bbox) == R3_VIEW_CULLER_OUTSIDE)) continue;
+    if ((point_budget > 0) && (npoints + node.count > point_budget)) break;
+    selected_nodes.push_back(node_index);
+    npoints += node.count;
+    if (culler.ProjectedLength(node.bbox, node.spacing) <= screen_space_error) continue;
+    for (int c = 0; c < 8; c++) {
+      int child_index = node.children[c];
+      if (child_index < 0) continue;
+      const Node& child = nodes[child_index];
+      RNScalar npixels = culler.ProjectedLength(child.bbox, child.spacing);
+      queue.push(std::pair<RNScalar, int>(npixels, child_index));
+    }
+  }
+}
+
+
+
+void R3SurfelPointRenderer::
+UploadGeometry(Node& node)
+{
+  // Create buffer
+  GLuint buffer = 0;
+  glGenBuffers(1, &buffer);
+  if (buffer == 0) return;
+
+  // Load packed points directly into buffer
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, node.count * sizeof(PackedPoint), &points[node.first], GL_STATIC_DRAW);
+  node.geometry_buffer = buffer;
+  nresident_points += node.count;
+}
+
+
+
+void R3SurfelPointRenderer::
+UploadColors(Node& node)
+{
+  // Compute colors
+  std::vector<unsigned char> rgb(3 * node.count);
+  if (color_callback) {
+    (*color_callback)(node.first, node.count, &rgb[0], color_callback_data);
+  }
+  else {
+    memcpy(&rgb[0], &colors[3*node.first], 3 * node.count);
+  }
+
+  // Create buffer
+  if (node.color_buffer == 0) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    if (buffer == 0) return;
+    node.color_buffer = buffer;
+  }
+
+  // Load colors into buffer
+  glBindBuffer(GL_ARRAY_BUFFER, node.color_buffer);
+  glBufferData(GL_ARRAY_BUFFER, 3 * node.count, &rgb[0], GL_STATIC_DRAW);
+  node.color_stamp = color_stamp;
+}
+
+
+
+void R3SurfelPointRenderer::
+ReleaseNode(Node& node)
+{
+  // Delete buffers
+  if (node.geometry_buffer > 0) {
+    GLuint buffer = node.geometry_buffer;
+    glDeleteBuffers(1, &buffer);
+    nresident_points -= node.count;
+  }
+  if (node.color_buffer > 0) {
+    GLuint buffer = node.color_buffer;
+    glDeleteBuffers(1, &buffer);
+  }
+
+  // Reset node
+  node.geometry_buffer = 0;
+  node.color_buffer = 0;
+  node.color_stamp = -1;
+}
+
+
+
+void R3SurfelPointRenderer::
+EvictNodes(void)
+{
+  // Check if resident points fit in twice the point budget
+  if (point_budget <= 0) return;
+  if (nresident_points <= 2 * point_budget) return;
+
+  // Find resident nodes not drawn in this frame
+  std::vector< std::pair<int, int> > candidates;
+  for (unsigned int i = 0; i < nodes.size(); i++) {
+    const Node& node = nodes[i];
+    if (node.geometry_buffer == 0) continue;
+    if (node.last_frame == frame) continue;
+    candidates.push_back(std::pair<int, int>(node.last_frame, i));
+  }
+
+  // Release least recently drawn nodes
+  std::sort(candidates.begin(), candidates.end());
+  for (unsigned int i = 0; i < candidates.size(); i++) {
+    if (nresident_points <= 2 * point_budget) break;
+    ReleaseNode(nodes[candidates[i].second]);
+  }
+}
+
+
+
+void R3SurfelPointRenderer::
+ReleaseBuffers(void)
+{
+  // Release buffers of all nodes
+  for (unsigned int i = 0; i < nodes.size(); i++) {
+    ReleaseNode(nodes[i]);
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// DISPLAY FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+RNBoolean R3SurfelPointRenderer::
+Draw(const R3Viewer& viewer, RNBoolean colors)
+{
+  // Check nodes
+  if (nodes.empty()) return TRUE;
+
+  // Select nodes (only when camera moves)
+  if (!selection_valid || culler.IsViewChanged(viewer)) SelectNodes(viewer);
+  frame++;
+
+  // Set opengl modes
+  glPushMatrix();
+  glTranslated(origin.X(), origin.Y(), origin.Z());
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  if (colors) glEnableClientState(GL_COLOR_ARRAY);
+  else glDisableClientState(GL_COLOR_ARRAY);
+
+  // Draw selected nodes, streaming a limited number of points to the GPU
+  // (ancestors of nodes still streaming are drawn, so coverage is coarser until complete)
+  RNBoolean complete = TRUE;
+  int nuploaded = 0;
+  for (unsigned int i = 0; i < selected_nodes.size(); i++) {
+    Node& node = nodes[selected_nodes[i]];
+
+    // Upload geometry
+    if (node.geometry_buffer == 0) {
+      if ((nuploaded > 0) && (nuploaded + node.count > R3_SURFEL_POINT_RENDERER_MAX_UPLOAD_POINTS)) { complete = FALSE; continue; }
+      UploadGeometry(node);
+      if (node.geometry_buffer == 0) continue;
+      nuploaded += node.count;
+    }
+
+    // Upload colors (out of date colors are drawn until their turn comes)
+    if (colors && (node.color_stamp != color_stamp)) {
+      if ((node.color_buffer == 0) || (nuploaded + node.count <= R3_SURFEL_POINT_RENDERER_MAX_UPLOAD_POINTS)) {
+        UploadColors(node);
+        nuploaded += node.count;
+      }
+      if (node.color_buffer == 0) continue;
+      if (node.color_stamp != color_stamp) complete = FALSE;
+    }
+
+    // Draw points
+    glBindBuffer(GL_ARRAY_BUFFER, node.geometry_buffer);
+    glVertexPointer(3, GL_FLOAT, sizeof(PackedPoint), (const GLvoid *) 0);
+    glNormalPointer(GL_BYTE, sizeof(PackedPoint), (const GLvoid *) (3 * sizeof(float)));
+    if (colors) {
+      glBindBuffer(GL_ARRAY_BUFFER, node.color_buffer);
+      glColorPointer(3, GL_UNSIGNED_BYTE, 0, (const GLvoid *) 0);
+    }
+    glDrawArrays(GL_POINTS, 0, node.count);
+    node.last_frame = frame;
+  }
+
+  // Reset opengl modes
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glPopMatrix();
+
+  // Release buffers of nodes not drawn recently
+  EvictNodes();
+
+  // Return whether all selected nodes were drawn
+  return complete;
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,327 @@
+/* Include file for the R3 surfel point renderer class */
+#ifndef __R3__SURFEL__POINT__RENDERER__H__
+#define __R3__SURFEL__POINT__RENDERER__H__
+
+
+
+////////////////////////////////////////////////////////////////////////
+// NAMESPACE
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// TYPE DEFINITIONS
+////////////////////////////////////////////////////////////////////////
+
+// Callback to compute colors of a range of points as they are streamed to the GPU
+
+typedef void (*R3SurfelPointRendererColorCallback)(int first_point_index, int npoints, unsigned char *rgb, void *data);
+
+
+
+////////////////////////////////////////////////////////////////////////
+// CLASS DEFINITION
+////////////////////////////////////////////////////////////////////////
+
+class R3SurfelPointRenderer {
+public:
+  //////////////////////////////////////////
+  //// CONSTRUCTOR/DESTRUCTOR FUNCTIONS ////
+  //////////////////////////////////////////
+
+  // Constructor functions
+  R3SurfelPointRenderer(void);
+
+  // Destructor functions
+  ~R3SurfelPointRenderer(void);
+
+
+  ////////////////////////////
+  //// PROPERTY FUNCTIONS ////
+  ////////////////////////////
+
+  // Geometric property functions
+  const R3Box& BBox(void) const;
+  const R3Point& Origin(void) const;
+
+  // Octree property functions
+  int NNodes(void) const;
+  int NResidentPoints(void) const;
+
+  // Rendering parameter functions
+  RNScalar ScreenSpaceError(void) const;
+  int PointBudget(void) const;
+  int FrustumCulling(void) const;
+
+
+  ////////////////////////////////
+  //// POINT ACCESS FUNCTIONS ////
+  ////////////////////////////////
+
+  // Point access functions (points are indexed in octree order)
+  int NPoints(void) const;
+  R3Point PointPosition(int point_index) const;
+  R3Vector PointNormal(int point_index) const;
+  RNRgb PointColor(int point_index) const;
+  int PointIdentifier(int point_index) const;
+  const float *PointPositionPtr(int point_index) const;
+  int PointPositionStride(void) const;
+
+  // Octree node access functions (points of each node are contiguous)
+  const R3Box& NodeBBox(int node_index) const;
+  int NodeFirstPoint(int node_index) const;
+  int NodeNPoints(int node_index) const;
+
+
+  ////////////////////////////////
+  //// MANIPULATION FUNCTIONS ////
+  ////////////////////////////////
+
+  // Build functions (identifiers are surfel identifiers, or scene indices of objects)
+  int Build(R3SurfelScene *scene, RNBoolean object_identifiers = FALSE, int max_points_per_node = 8192);
+  void Empty(void);
+
+  // Color functions (colors are computed only for points streamed to the GPU)
+  void SetColorCallback(R3SurfelPointRendererColorCallback callback, void *data);
+  void InvalidateColors(void);
+
+  // Rendering parameter functions
+  void SetScreenSpaceError(RNScalar pixels);
+  void SetPointBudget(int max_points);
+  void SetFrustumCulling(int frustum_culling);
+
+
+  ///////////////////////////
+  //// DISPLAY FUNCTIONS ////
+  ///////////////////////////
+
+  // Draw function (returns FALSE if some selected octree nodes are still streaming)
+  RNBoolean Draw(const R3Viewer& viewer, RNBoolean colors = TRUE);
+
+  // Release all GPU buffers (requires current opengl context)
+  void ReleaseBuffers(void);
+
+
+  ////////////////////////////////////////////////////////////////////////
+  // INTERNAL STUFF BELOW HERE
+  ////////////////////////////////////////////////////////////////////////
+
+  // Packed point layout (matches the layout of geometry buffers on the GPU)
+  struct PackedPoint {
+    float position[3];
+    signed char normal[3];
+    unsigned char pad;
+  };
+
+  // Octree node
+  struct Node {
+    R3Box bbox;
+    RNLength spacing;
+    int first, count;
+    int children[8];
+    unsigned int geometry_buffer;
+    unsigned int color_buffer;
+    int color_stamp;
+    int last_frame;
+  };
+
+private:
+  int BuildNode(std::vector< std::pair<unsigned long long, int> >& keys,
+    int start, int end, int level, int max_points_per_node);
+  void SelectNodes(const R3Viewer& viewer);
+  void UploadGeometry(Node& node);
+  void UploadColors(Node& node);
+  void ReleaseNode(Node& node);
+  void EvictNodes(void);
+
+private:
+  R3Point origin;
+  R3Box bbox;
+  std::vector<PackedPoint> points;
+  std::vector<unsigned char> colors;
+  std::vector<int> identifiers;
+  std::vector<Node> nodes;
+  std::vector<int> selected_nodes;
+  R3ViewCuller culler;
+  int selection_valid;
+  R3SurfelPointRendererColorCallback color_callback;
+  void *color_callback_data;
+  int color_stamp;
+  int frame;
+  int nresident_points;
+  RNScalar screen_space_error;
+  int point_budget;
+  int frustum_culling;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// INLINE FUNCTION DEFINITIONS
+////////////////////////////////////////////////////////////////////////
+
+inline const R3Box& R3SurfelPointRenderer::
+BBox(void) const
+{
+  // Return bounding box of all points
+  return bbox;
+}
+
+
+
+inline const R3Point& R3SurfelPointRenderer::
+Origin(void) const
+{
+  // Return point relative to which positions are stored
+  return origin;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+NNodes(void) const
+{
+  // Return number of octree nodes
+  return (int) nodes.size();
+}
+
+
+
+inline int R3SurfelPointRenderer::
+NResidentPoints(void) const
+{
+  // Return number of points currently stored in GPU buffers
+  return nresident_points;
+}
+
+
+
+inline RNScalar R3SurfelPointRenderer::
+ScreenSpaceError(void) const
+{
+  // Return maximum spacing between drawn points (in pixels)
+  return screen_space_error;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+PointBudget(void) const
+{
+  // Return maximum number of points drawn per frame
+  return point_budget;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+FrustumCulling(void) const
+{
+  // Return whether octree nodes outside view frustum are skipped
+  return frustum_culling;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+NPoints(void) const
+{
+  // Return number of points
+  return (int) points.size();
+}
+
+
+
+inline R3Point R3SurfelPointRenderer::
+PointPosition(int point_index) const
+{
+  // Return position of point (stored relative to origin)
+  const float *p = points[point_index].position;
+  return R3Point(origin.X() + p[0], origin.Y() + p[1], origin.Z() + p[2]);
+}
+
+
+
+inline R3Vector R3SurfelPointRenderer::
+PointNormal(int point_index) const
+{
+  // Return normal of point
+  const signed char *n = points[point_index].normal;
+  return R3Vector(n[0] / 127.0, n[1] / 127.0, n[2] / 127.0);
+}
+
+
+
+inline RNRgb R3SurfelPointRenderer::
+PointColor(int point_index) const
+{
+  // Return color of point
+  const unsigned char *c = &colors[3*point_index];
+  return RNRgb(c[0] / 255.0, c[1] / 255.0, c[2] / 255.0);
+}
+
+
+
+inline int R3SurfelPointRenderer::
+PointIdentifier(int point_index) const
+{
+  // Return identifier of point
+  return identifiers[point_index];
+}
+
+
+
+inline const float *R3SurfelPointRenderer::
+PointPositionPtr(int point_index) const
+{
+  // Return pointer to position of point (relative to origin)
+  return points[point_index].position;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+PointPositionStride(void) const
+{
+  // Return number of bytes between positions of consecutive points
+  return sizeof(PackedPoint);
+}
+
+
+
+inline const R3Box& R3SurfelPointRenderer::
+NodeBBox(int node_index) const
+{
+  // Return bounding box of all points in subtree of node
+  return nodes[node_index].bbox;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+NodeFirstPoint(int node_index) const
+{
+  // Return index of first point stored in node
+  return nodes[node_index].first;
+}
+
+
+
+inline int R3SurfelPointRenderer::
+NodeNPoints(int node_index) const
+{
+  // Return number of points stored in node (not including descendents)
+  return nodes[node_index].count;
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -104,6 +104,7 @@ class R3SurfelScene;
 #include "R3SurfelLabelRelationship.h"
 #include "R3SurfelLabelAssignment.h"
 #include "R3SurfelScene.h"
+#include "R3SurfelPointRenderer.h"
 
 
 
@@ -9,6 +9,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 #include "R3Utils/R3Utils.h"
+#include <vector>
 
 
 
@@ -710,6 +711,26 @@ RemovePoint(R3SegmentationPoint *point)
 
 
 
+struct R3SegmentationAffinityData {
+  const R3SegmentationCluster *cluster;
+  RNScalar *affinities;
+};
+
+
+
+static void
+ComputePointAffinity(int index, int thread_index, void *data)
+{
+  // Compute affinity of point to cluster
+  R3SegmentationAffinityData *affinity_data = (R3SegmentationAffinityData *) data;
+  const R3SegmentationCluster *cluster = affinity_data->cluster;
+  RNScalar affinity = cluster->Affinity(cluster->points.Kth(index));
+  if (affinity < 0) affinity = 0;
+  affinity_data->affinities[index] = affinity;
+}
+
+
+
 void R3SegmentationCluster::
 InsertChild(R3SegmentationCluster *child)
 {
@@ -756,10 +777,18 @@ InsertChild(R3SegmentationCluster *child)
 
   // Update affinities for current points
   if (points.NEntries() < 4 * child->points.NEntries()) {
+    // Compute affinities (in parallel for large clusters)
+    std::vector<RNScalar> affinities(points.NEntries());
+    R3SegmentationAffinityData affinity_data;
+    affinity_data.cluster = this;
+    affinity_data.affinities = (points.NEntries() > 0) ? &affinities[0] : NULL;
+    if (points.NEntries() >= 16384) RNParallelFor(points.NEntries(), ComputePointAffinity, &affinity_data, 1024);
+    else for (int i = 0; i < points.NEntries(); i++) ComputePointAffinity(i, 0, &affinity_data);
+
+    // Update affinity sums (in order)
     for (int i = 0; i < points.NEntries(); i++) {
       R3SegmentationPoint *point = points.Kth(i);
-      RNScalar affinity = Affinity(point);
-      if (affinity < 0) affinity = 0;
+      RNScalar affinity = affinities[i];
       possible_affinity += affinity - point->cluster_affinity;
       total_affinity += affinity - point->cluster_affinity;
       point->cluster_affinity = affinity;
@@ -1766,6 +1795,106 @@ CreateNeighbors(
 
 #else
 
+struct R3SegmentationNeighborData {
+  const R3Segmentation *segmentation;
+  int max_neighbor_count;
+  double max_neighbor_distance;
+  double max_neighbor_primitive_distance;
+  double max_neighbor_normal_angle;
+  double max_neighbor_color_difference;
+  double max_neighbor_distance_factor;
+  double max_neighbor_timestamp_difference;
+  double max_neighbor_category_difference;
+  RNBoolean partition_identifiers;
+  std::vector<std::vector<R3SegmentationPoint *> > thread_neighbors;
+  std::vector<std::vector<RNScalar> > thread_affinities;
+  std::vector<int> point_threads;
+  std::vector<int> point_offsets;
+  std::vector<int> point_counts;
+};
+
+
+
+static void
+FindPointNeighbors(int index, int thread_index, void *data)
+{
+  // Get convenient variables
+  R3SegmentationNeighborData *neighbor_data = (R3SegmentationNeighborData *) data;
+  const R3Segmentation *segmentation = neighbor_data->segmentation;
+  R3SegmentationPoint *point = segmentation->points.Kth(index);
+  int max_neighbor_count = neighbor_data->max_neighbor_count;
+
+  // Neighbors of point are appended to buffer of thread (with parallel array of affinities)
+  std::vector<R3SegmentationPoint *>& buffer = neighbor_data->thread_neighbors[thread_index];
+  std::vector<RNScalar>& affinities = neighbor_data->thread_affinities[thread_index];
+  int start = (int) buffer.size();
+  int count = 0;
+
+  // Refine maximum distance for this point
+  RNScalar max_d = neighbor_data->max_neighbor_distance;
+  if ((neighbor_data->max_neighbor_distance_factor > 0) && (point->radius1 > 0)) 
+    max_d = neighbor_data->max_neighbor_distance_factor * point->radius1;
+  if (max_d == 0) max_d = 10 * point->radius1;
+  if (max_d == 0) max_d = 1;
+
+  // Create neighbors
+  double min_affinity = 0;
+  RNArray<R3SegmentationPoint *> neighbors;
+  if (segmentation->kdtree->FindClosest(point, 0, max_d, max_neighbor_count, neighbors)) {
+    for (int j = 0; j < neighbors.NEntries(); j++) {
+      R3SegmentationPoint *neighbor = neighbors.Kth(j);
+      if (neighbor == point) continue;
+        
+      // Check identifier
+      if (neighbor_data->partition_identifiers) {
+        if (point->identifier != neighbor->identifier) continue;
+      }
+
+      // Compute affinity
+      RNScalar affinity = R3SegmentationPointAffinity(point, neighbor,
+        max_d, neighbor_data->max_neighbor_primitive_distance,
+        neighbor_data->max_neighbor_normal_angle, neighbor_data->max_neighbor_color_difference,
+        neighbor_data->max_neighbor_timestamp_difference,
+        neighbor_data->max_neighbor_category_difference, min_affinity);
+      if (affinity <= min_affinity) continue;
+        
+      // Insert neighbor
+      if ((max_neighbor_count > 0) &&
+          (neighbors.NEntries() - j > max_neighbor_count - count)) {
+        // Find slot for neighbor in list sorted by affinity
+        int slot = count;
+        while (slot > 0) {
+          if (affinities[start+slot-1] > affinity) break;
+          slot--;
+        }
+        if (slot < max_neighbor_count) {
+          buffer.insert(buffer.begin() + start + slot, neighbor);
+          affinities.insert(affinities.begin() + start + slot, affinity);
+          if (count < max_neighbor_count) count++;
+          buffer.resize(start + count);
+          affinities.resize(start + count);
+        }
+        if (count == max_neighbor_count) {
+          min_affinity = affinities[start+count-1];
+        }
+      }
+      else {
+        // Insert neighbor at end of unconstrained list
+        buffer.push_back(neighbor);
+        affinities.push_back(affinity);
+        count++;
+      }
+    }
+  }
+
+  // Remember where neighbors of point are
+  neighbor_data->point_threads[index] = thread_index;
+  neighbor_data->point_offsets[index] = start;
+  neighbor_data->point_counts[index] = count;
+}
+
+
+
 int R3Segmentation::
 CreateNeighbors(
   int max_neighbor_count,
@@ -1785,63 +1914,36 @@ CreateNeighbors(
     RNFail("Unable to create kdtree\n");
     return 0;
   }
-  
+
+  // Initialize neighbor search data
+  int nthreads = RNNThreads();
+  R3SegmentationNeighborData neighbor_data;
+  neighbor_data.segmentation = this;
+  neighbor_data.max_neighbor_count = max_neighbor_count;
+  neighbor_data.max_neighbor_distance = max_neighbor_distance;
+  neighbor_data.max_neighbor_primitive_distance = max_neighbor_primitive_distance;
+  neighbor_data.max_neighbor_normal_angle = max_neighbor_normal_angle;
+  neighbor_data.max_neighbor_color_difference = max_neighbor_color_difference;
+  neighbor_data.max_neighbor_distance_factor = max_neighbor_distance_factor;
+  neighbor_data.max_neighbor_timestamp_difference = max_neighbor_timestamp_difference;
+  neighbor_data.max_neighbor_category_difference = max_neighbor_category_difference;
+  neighbor_data.partition_identifiers = partition_identifiers;
+  neighbor_data.thread_neighbors.resize(nthreads);
+  neighbor_data.thread_affinities.resize(nthreads);
+  neighbor_data.point_threads.resize(points.NEntries());
+  neighbor_data.point_offsets.resize(points.NEntries());
+  neighbor_data.point_counts.resize(points.NEntries());
+
+  // Find neighbors of all points in parallel
+  RNParallelFor(points.NEntries(), FindPointNeighbors, &neighbor_data, 256);
+
   // Create arrays of neighbor points
   for (int i = 0; i < points.NEntries(); i++) {
     R3SegmentationPoint *point = points.Kth(i);
-
-    // Refine maximum distance for this point
-    RNScalar max_d = max_neighbor_distance;
-    if ((max_neighbor_distance_factor > 0) && (point->radius1 > 0)) 
-      max_d = max_neighbor_distance_factor * point->radius1;
-    if (max_d == 0) max_d = 10 * point->radius1;
-    if (max_d == 0) max_d = 1;
-
-    // Create neighbors
-    double min_affinity = 0;
-    RNArray<R3SegmentationPoint *> neighbors;
-    if (kdtree->FindClosest(point, 0, max_d, max_neighbor_count, neighbors)) {
-      for (int j = 0; j < neighbors.NEntries(); j++) {
-        R3SegmentationPoint *neighbor = neighbors.Kth(j);
-        if (neighbor == point) continue;
-        
-        // Check identifier
-        if (partition_identifiers) {
-          if (point->identifier != neighbor->identifier) continue;
-        }
-
-        // Compute affinity
-        RNScalar affinity = R3SegmentationPointAffinity(point, neighbor,
-          max_d, max_neighbor_primitive_distance,
-          max_neighbor_normal_angle, max_neighbor_color_difference,
-          max_neighbor_timestamp_difference,
-          max_neighbor_category_difference, min_affinity);
-        if (affinity <= min_affinity) continue;
-        
-        // Insert neighbor
-        if ((max_neighbor_count > 0) &&
-            (neighbors.NEntries() - j > max_neighbor_count - point->neighbors.NEntries())) {
-          // Find slot for neighbor in list sorted by affinity
-          int slot = point->neighbors.NEntries();
-          while (slot > 0) {
-            RNScalar s_affinity = point->neighbors[slot-1]->cluster_affinity;
-            if (s_affinity > affinity) break;
-            slot--;
-          }
-          if (slot < max_neighbor_count) {
-            neighbor->cluster_affinity = affinity;
-            point->neighbors.InsertKth(neighbor, slot);
-            point->neighbors.Truncate(max_neighbor_count);
-          }
-          if (point->neighbors.NEntries() == max_neighbor_count) {
-            min_affinity = point->neighbors[point->neighbors.NEntries()-1]->cluster_affinity;
-          }
-        }
-        else {
-          // Insert neighbor at end of unconstrained list
-          point->neighbors.Insert(neighbor);
-        }
-      }
+    const std::vector<R3SegmentationPoint *>& buffer = neighbor_data.thread_neighbors[neighbor_data.point_threads[i]];
+    int start = neighbor_data.point_offsets[i];
+    for (int j = 0; j < neighbor_data.point_counts[i]; j++) {
+      point->neighbors.Insert(buffer[start + j]);
     }
   }
 
@@ -1859,36 +1961,45 @@ CreateNeighbors(
 
 
 
-int R3Segmentation::
-UpdatePoints(void)
+static void
+UpdatePointFrame(int index, int thread_index, void *data)
 {
-  // Update normal, tangent, radii, and area from neighbors
-  for (int i = 0; i < points.NEntries(); i++) {
-    R3SegmentationPoint *point = points.Kth(i);
-    if (point->neighbors.NEntries() < 2) continue;
-    if (!point->normal.IsZero() && !point->tangent.IsZero() &&
-        (point->radius1 > 0) && (point->radius2 > 0)) continue;
-
-    // Create array of neighborhood positions
-    RNArray<R3Point *> positions;
-    positions.Insert(&point->position);
-    for (int j = 0; j < point->neighbors.NEntries(); j++) {
-      positions.Insert(&point->neighbors[j]->position);
-    }
+  // Get point
+  R3Segmentation *segmentation = (R3Segmentation *) data;
+  R3SegmentationPoint *point = segmentation->points.Kth(index);
+  if (point->neighbors.NEntries() < 2) return;
+  if (!point->normal.IsZero() && !point->tangent.IsZero() &&
+      (point->radius1 > 0) && (point->radius2 > 0)) return;
+
+  // Create array of neighborhood positions
+  RNArray<R3Point *> positions;
+  positions.Insert(&point->position);
+  for (int j = 0; j < point->neighbors.NEntries(); j++) {
+    positions.Insert(&point->neighbors[j]->position);
+  }
+
+  // Compute principle axes
+  RNScalar variances[3];
+  R3Point centroid = R3Centroid(positions);
+  R3Triad axes = R3PrincipleAxes(centroid, positions, NULL, variances);
+  if (RNIsZero(variances[1])) return;
+
+  // Update point
+  point->normal = axes[2];
+  point->tangent = axes[0];
+  point->radius1 = sqrt(variances[0]);
+  point->radius2 = sqrt(variances[1]);
+  point->area = point->radius1 * point->radius2;
+}
 
-    // Compute principle axes
-    RNScalar variances[3];
-    R3Point centroid = R3Centroid(positions);
-    R3Triad axes = R3PrincipleAxes(centroid, positions, NULL, variances);
-    if (RNIsZero(variances[1])) continue;
 
-    // Update point
-    point->normal = axes[2];
-    point->tangent = axes[0];
-    point->radius1 = sqrt(variances[0]);
-    point->radius2 = sqrt(variances[1]);
-    point->area = point->radius1 * point->radius2;
-  }
+
+int R3Segmentation::
+UpdatePoints(void)
+{
+  // Update normal, tangent, radii, and area from neighbors (in parallel,
+  // since each point only reads positions of its neighbors)
+  RNParallelFor(points.NEntries(), UpdatePointFrame, this, 256);
 
   // Return success
   return 1;
@@ -2095,6 +2206,76 @@ DeleteClusters(void)
 
 
 
+struct R3SegmentationPairData {
+  const R3Segmentation *segmentation;
+  std::vector<std::vector<R3SegmentationCluster *> > thread_clusters;
+  std::vector<std::vector<RNScalar> > thread_affinities;
+  std::vector<int> cluster_threads;
+  std::vector<int> cluster_offsets;
+  std::vector<int> cluster_counts;
+};
+
+
+
+static void
+FindClusterPairCandidates(int index, int thread_index, void *data)
+{
+  // Get convenient variables
+  R3SegmentationPairData *pair_data = (R3SegmentationPairData *) data;
+  R3SegmentationCluster *cluster0 = pair_data->segmentation->clusters.Kth(index);
+  std::vector<R3SegmentationCluster *>& buffer = pair_data->thread_clusters[thread_index];
+  std::vector<RNScalar>& affinities = pair_data->thread_affinities[thread_index];
+  int start = (int) buffer.size();
+
+  // Sample points
+  const int max_points = 64;
+  int jstep = cluster0->points.NEntries() / max_points;
+  if (jstep == 0) jstep = 1;
+  for (int j = 0; j < cluster0->points.NEntries(); j += jstep) {
+    R3SegmentationPoint *point0 = cluster0->points.Kth(j);
+
+    // Check neighbors
+    for (int k = 0; k < point0->neighbors.NEntries(); k++) {
+      R3SegmentationPoint *point1 = point0->neighbors.Kth(k);
+      if (point0 == point1) continue;
+      R3SegmentationCluster *cluster1 = point1->cluster;
+      if (!cluster1) continue;
+      if (cluster0 == cluster1) continue;
+
+      // Check if already found cluster
+      RNBoolean found = FALSE;
+      for (int m = start; m < (int) buffer.size(); m++) {
+        if (buffer[m] == cluster1) { found = TRUE; break; }
+      }
+      if (found) continue;
+
+      // Remember cluster and affinity (in order found)
+      buffer.push_back(cluster1);
+      affinities.push_back(cluster0->Affinity(cluster1));
+    }
+  }
+
+  // Remember where candidates of cluster are
+  pair_data->cluster_threads[index] = thread_index;
+  pair_data->cluster_offsets[index] = start;
+  pair_data->cluster_counts[index] = (int) buffer.size() - start;
+}
+
+
+
+static int
+FindClusterAncestor(std::vector<int>& ancestors, int cluster_index)
+{
+  // Find root of merged clusters (with path halving)
+  while (ancestors[cluster_index] != cluster_index) {
+    ancestors[cluster_index] = ancestors[ancestors[cluster_index]];
+    cluster_index = ancestors[cluster_index];
+  }
+  return cluster_index;
+}
+
+
+
 int R3Segmentation::
 MergeClusters(void)
 {
@@ -2105,40 +2286,40 @@ MergeClusters(void)
 
   //////////
 
+  // Find candidate clusters and affinities for every cluster in parallel
+  int nthreads = RNNThreads();
+  R3SegmentationPairData pair_data;
+  pair_data.segmentation = this;
+  pair_data.thread_clusters.resize(nthreads);
+  pair_data.thread_affinities.resize(nthreads);
+  pair_data.cluster_threads.resize(clusters.NEntries());
+  pair_data.cluster_offsets.resize(clusters.NEntries());
+  pair_data.cluster_counts.resize(clusters.NEntries());
+  RNParallelFor(clusters.NEntries(), FindClusterPairCandidates, &pair_data, 256);
+
   // Create pairs between clusters with neighbor points
   RNArray<R3SegmentationPair *> pairs;
   for (int i = 0; i < clusters.NEntries(); i++) {
     R3SegmentationCluster *cluster0 = clusters.Kth(i);
+    const std::vector<R3SegmentationCluster *>& candidate_clusters = pair_data.thread_clusters[pair_data.cluster_threads[i]];
+    const std::vector<RNScalar>& candidate_affinities = pair_data.thread_affinities[pair_data.cluster_threads[i]];
+    int start = pair_data.cluster_offsets[i];
+    for (int k = start; k < start + pair_data.cluster_counts[i]; k++) {
+      R3SegmentationCluster *cluster1 = candidate_clusters[k];
 
-    // Sample points
-    const int max_points = 64;
-    int jstep = cluster0->points.NEntries() / max_points;
-    if (jstep == 0) jstep = 1;
-    for (int j = 0; j < cluster0->points.NEntries(); j += jstep) {
-      R3SegmentationPoint *point0 = cluster0->points.Kth(j);
-
-      // Check neighbors
-      for (int k = 0; k < point0->neighbors.NEntries(); k++) {
-        R3SegmentationPoint *point1 = point0->neighbors.Kth(k);
-        if (point0 == point1) continue;
-        R3SegmentationCluster *cluster1 = point1->cluster;
-        if (!cluster1) continue;
-        if (cluster0 == cluster1) continue;
-
-        // Check if already have pair
-        if (FindR3SegmentationPair(cluster0, cluster1)) continue;
-
-        // Compute affinity
-        RNScalar affinity = cluster0->Affinity(cluster1);
-        if ((affinity < min_pair_affinity) && (cluster_count <= max_clusters) && (min_cluster_points == 0) && (min_cluster_area == 0)) continue;
-
-        // Create pair
-        R3SegmentationPair *pair = new R3SegmentationPair(cluster0, cluster1, affinity);
-        if (!pair) continue;
-
-        // Insert pair
-        pairs.Insert(pair);
-      }        
+      // Check if already have pair
+      if (FindR3SegmentationPair(cluster0, cluster1)) continue;
+
+      // Check affinity
+      RNScalar affinity = candidate_affinities[k];
+      if ((affinity < min_pair_affinity) && (cluster_count <= max_clusters) && (min_cluster_points == 0) && (min_cluster_area == 0)) continue;
+
+      // Create pair
+      R3SegmentationPair *pair = new R3SegmentationPair(cluster0, cluster1, affinity);
+      if (!pair) continue;
+
+      // Insert pair
+      pairs.Insert(pair);
     }
   }
 
@@ -2155,6 +2336,13 @@ MergeClusters(void)
     heap.Push(pair);
   }
 
+  // Initialize union-find forest of merged clusters
+  std::vector<int> ancestors(clusters.NEntries());
+  for (int i = 0; i < clusters.NEntries(); i++) {
+    clusters[i]->segmentation_index = i;
+    ancestors[i] = i;
+  }
+
   // Merge clusters hierarchically
   while (!heap.IsEmpty()) {
     // Get pair
@@ -2172,10 +2360,8 @@ MergeClusters(void)
     // Check if either cluster has already been merged
     if (cluster0->parent || cluster1->parent) {
       // Find ancestors
-      R3SegmentationCluster *ancestor0 = cluster0;
-      R3SegmentationCluster *ancestor1 = cluster1;
-      while (ancestor0->parent) ancestor0 = ancestor0->parent;
-      while (ancestor1->parent) ancestor1 = ancestor1->parent;
+      R3SegmentationCluster *ancestor0 = clusters[FindClusterAncestor(ancestors, cluster0->segmentation_index)];
+      R3SegmentationCluster *ancestor1 = clusters[FindClusterAncestor(ancestors, cluster1->segmentation_index)];
       if (ancestor0 != ancestor1) {
         if (!FindR3SegmentationPair(ancestor0, ancestor1)) {
           RNScalar affinity = ancestor0->Affinity(ancestor1);
@@ -2221,6 +2407,7 @@ MergeClusters(void)
       R3SegmentationCluster *parent = (cluster0->points.NEntries() > cluster1->points.NEntries()) ? cluster0 : cluster1;
       R3SegmentationCluster *child = (cluster0->points.NEntries() > cluster1->points.NEntries()) ? cluster1 : cluster0;
       parent->InsertChild(child);
+      ancestors[child->segmentation_index] = parent->segmentation_index;
       cluster_count--;
       merge_count++;
 #endif
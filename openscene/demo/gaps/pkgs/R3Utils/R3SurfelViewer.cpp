@@ -88,6 +88,9 @@ R3SurfelViewer(R3SurfelScene *scene)
     adapt_subsampling_automatically(0),
     subsampling_factor(1),
     subsampling_multiplier_when_mouse_down(1),
+    frustum_culling(1),
+    occlusion_culling(0),
+    screen_space_error(1),
     window_height(0),
     window_width(0),
     shift_down(0),
@@ -106,6 +109,12 @@ R3SurfelViewer(R3SurfelScene *scene)
     vbo_normal_buffer(0),
     vbo_color_buffer(0),
     vbo_nsurfels(0),
+    vbo_resident_node_offsets(),
+    draw_list_culler(),
+    draw_list_firsts(),
+    draw_list_counts(),
+    draw_list_lod_counts(),
+    draw_list_valid(FALSE),
     shader_program(0),
     vertex_shader(0),
     fragment_shader(0)
@@ -3027,13 +3036,17 @@ InvalidateVBO(void)
 {
   // Ensure VBO is updated
   vbo_nsurfels = 0;
+
+  // Ensure draw list is updated
+  InvalidateDrawList();
 }
 
 
 
 void R3SurfelViewer::
 ComputeVBOBuffers(std::vector<GLfloat>& surfel_positions,
-    std::vector<GLfloat>& surfel_normals, std::vector<GLubyte>& surfel_colors) const
+    std::vector<GLfloat>& surfel_normals, std::vector<GLubyte>& surfel_colors,
+    std::vector<int> *resident_node_offsets) const
 {
   // Count surfels
   int nsurfels = 0;
@@ -3052,49 +3065,76 @@ ComputeVBOBuffers(std::vector<GLfloat>& surfel_positions,
   surfel_normals.resize(3 * nsurfels);
   surfel_colors.resize(2 * 3 * nsurfels);
 
+  // Initialize offsets of resident nodes in buffers
+  if (resident_node_offsets) resident_node_offsets->assign(resident_nodes.NNodes() + 1, 0);
+
   // Fill in-memory buffers 
   int count = 0;
   unsigned int pick_color_offset = 3 * nsurfels;
+  std::vector<const R3Surfel *> node_surfels;
+  std::vector<int> node_surfel_blocks;
   for (int i = 0; i < resident_nodes.NNodes(); i++) {
     R3SurfelNode *node = resident_nodes.Node(i);
+    if (resident_node_offsets) (*resident_node_offsets)[i] = count;
     if (!NodeVisibility(node)) continue;
     R3SurfelObject *object = node->Object(TRUE, TRUE);
     while (object && object->Parent() && (object->Parent() != scene->RootObject())) object = object->Parent();
     R3SurfelLabel *label = (object) ? object->CurrentLabel() : NULL;
+
+    // Gather surfels of node
+    node_surfels.clear();
+    node_surfel_blocks.clear();
     for (int j = 0; j < node->NBlocks(); j++) {
       R3SurfelBlock *block = node->Block(j);
-      const R3Point& block_origin = block->PositionOrigin();
       for (int k = 0; k < block->NSurfels(); k += subsampling_factor) {
-        const R3Surfel *surfel = block->Surfel(k);
-
-        // Compute colors
-        GLubyte surfel_color[3], pick_color[3];
-        CreateColor(surfel_color, surfel_color_scheme,
-          surfel, block, node, object, label);
-        CreateColor(pick_color, R3_SURFEL_VIEWER_COLOR_BY_PICK_INDEX,
-          surfel, block, node, object, label);
-        assert(count < nsurfels);
-
-        // Fill buffers
-        int i0 = 3 * (count++);
-        int i1 = i0+1;
-        int i2 = i1+1;
-        surfel_positions[i0] = block_origin.X() + surfel->X();
-        surfel_positions[i1] = block_origin.Y() + surfel->Y();
-        surfel_positions[i2] = block_origin.Z() + surfel->Z();
-        surfel_normals[i0] = surfel->NX();
-        surfel_normals[i1] = surfel->NY();
-        surfel_normals[i2] = surfel->NZ();
-        surfel_colors[i0] = surfel_color[0];
-        surfel_colors[i1] = surfel_color[1];
-        surfel_colors[i2] = surfel_color[2];
-        surfel_colors[i0 + pick_color_offset] = pick_color[0];
-        surfel_colors[i1 + pick_color_offset] = pick_color[1];
-        surfel_colors[i2 + pick_color_offset] = pick_color[2];
+        node_surfels.push_back(block->Surfel(k));
+        node_surfel_blocks.push_back(j);
       }
     }
+
+    // Fill buffers in bit-reversed order, so that every prefix is a uniform subsample
+    // (this allows drawing a node at lower resolution by drawing fewer surfels)
+    int n = (int) node_surfels.size();
+    int nbits = 0;
+    while ((1 << nbits) < n) nbits++;
+    for (int index = 0; index < (1 << nbits); index++) {
+      int k = 0;
+      for (int b = 0; b < nbits; b++) if (index & (1 << b)) k |= 1 << (nbits - 1 - b);
+      if (k >= n) continue;
+      const R3Surfel *surfel = node_surfels[k];
+      R3SurfelBlock *block = node->Block(node_surfel_blocks[k]);
+      const R3Point& block_origin = block->PositionOrigin();
+
+      // Compute colors
+      GLubyte surfel_color[3], pick_color[3];
+      CreateColor(surfel_color, surfel_color_scheme,
+        surfel, block, node, object, label);
+      CreateColor(pick_color, R3_SURFEL_VIEWER_COLOR_BY_PICK_INDEX,
+        surfel, block, node, object, label);
+      assert(count < nsurfels);
+
+      // Fill buffers
+      int i0 = 3 * (count++);
+      int i1 = i0+1;
+      int i2 = i1+1;
+      surfel_positions[i0] = block_origin.X() + surfel->X();
+      surfel_positions[i1] = block_origin.Y() + surfel->Y();
+      surfel_positions[i2] = block_origin.Z() + surfel->Z();
+      surfel_normals[i0] = surfel->NX();
+      surfel_normals[i1] = surfel->NY();
+      surfel_normals[i2] = surfel->NZ();
+      surfel_colors[i0] = surfel_color[0];
+      surfel_colors[i1] = surfel_color[1];
+      surfel_colors[i2] = surfel_color[2];
+      surfel_colors[i0 + pick_color_offset] = pick_color[0];
+      surfel_colors[i1 + pick_color_offset] = pick_color[1];
+      surfel_colors[i2 + pick_color_offset] = pick_color[2];
+    }
   }
   
+  // Remember end of buffers
+  if (resident_node_offsets) (*resident_node_offsets)[resident_nodes.NNodes()] = count;
+
   // Just checking
   assert(count == nsurfels);
 }
@@ -3114,7 +3154,7 @@ UpdateVBO(void)
   std::vector<GLfloat> surfel_positions;
   std::vector<GLfloat> surfel_normals;
   std::vector<GLubyte> surfel_colors;
-  ComputeVBOBuffers(surfel_positions, surfel_normals, surfel_colors);
+  ComputeVBOBuffers(surfel_positions, surfel_normals, surfel_colors, &vbo_resident_node_offsets);
 
   // Get/check number of surfels
   vbo_nsurfels = surfel_positions.size() / 3;
@@ -3258,6 +3298,9 @@ DrawVBO(int color_scheme) const
   // Check VBO
   if (vbo_nsurfels == 0) return;
 
+  // Update draw list
+  ((R3SurfelViewer *) this)->UpdateDrawList();
+
   // Determine stride and point size
   int subsampling = 1;
   float pointSize = SurfelSize();
@@ -3271,6 +3314,19 @@ DrawVBO(int color_scheme) const
     }
   }
 
+  // Determine ranges of VBO to draw (all surfels of visible nodes when picking)
+  std::vector<GLint> firsts;
+  std::vector<GLsizei> counts;
+  const std::vector<GLsizei>& draw_counts = (color_scheme == R3_SURFEL_VIEWER_COLOR_BY_PICK_INDEX) ? draw_list_counts : draw_list_lod_counts;
+  for (unsigned int i = 0; i < draw_list_firsts.size(); i++) {
+    GLint first = (draw_list_firsts[i] + subsampling - 1) / subsampling;
+    GLint end = (draw_list_firsts[i] + draw_counts[i] + subsampling - 1) / subsampling;
+    if (end <= first) continue;
+    firsts.push_back(first);
+    counts.push_back(end - first);
+  }
+  if (firsts.empty()) return;
+
   // Assign shader and its variables
   if (shader_program > 0) {
     glUseProgram(shader_program);
@@ -3297,7 +3353,7 @@ DrawVBO(int color_scheme) const
     }
 
     // Draw points with pick color
-    glDrawArrays(GL_POINTS, 0, vbo_nsurfels);
+    glMultiDrawArrays(GL_POINTS, &firsts[0], &counts[0], firsts.size());
 
     // Reset color pointer to start of buffer where regular colors are
     if (vbo_color_buffer > 0) {
@@ -3316,7 +3372,7 @@ DrawVBO(int color_scheme) const
     // Draw points with shading
     glEnable(GL_LIGHTING);
     RNLoadRgb(0.8, 0.8, 0.8);
-    glDrawArrays(GL_POINTS, 0, vbo_nsurfels);
+    glMultiDrawArrays(GL_POINTS, &firsts[0], &counts[0], firsts.size());
     glDisable(GL_LIGHTING);
   }
   else {
@@ -3328,7 +3384,7 @@ DrawVBO(int color_scheme) const
     }
 
     // Draw points with color
-    glDrawArrays(GL_POINTS, 0, vbo_nsurfels);
+    glMultiDrawArrays(GL_POINTS, &firsts[0], &counts[0], firsts.size());
   }
 
   // Disable client state
@@ -3343,6 +3399,168 @@ DrawVBO(int color_scheme) const
 
 
 
+////////////////////////////////////////////////////////////////////////
+// DRAW LIST UPDATES
+////////////////////////////////////////////////////////////////////////
+
+void R3SurfelViewer::
+InvalidateDrawList(void)
+{
+  // Ensure draw list is updated
+  draw_list_valid = FALSE;
+}
+
+
+
+void R3SurfelViewer::
+UpdateDrawList(void)
+{
+  // Check if draw list is uptodate (it is rebuilt only when camera moves)
+  if (draw_list_valid && !draw_list_culler.IsViewChanged(viewer)) return;
+  draw_list_valid = TRUE;
+
+  // Empty draw list
+  draw_list_firsts.clear();
+  draw_list_counts.clear();
+  draw_list_lod_counts.clear();
+
+  // Check VBO
+  if (vbo_nsurfels == 0) return;
+  if ((int) vbo_resident_node_offsets.size() != resident_nodes.NNodes() + 1) return;
+
+  // Set view for culling
+  static const int occlusion_resolution = 128;
+  draw_list_culler.SetView(viewer, (occlusion_culling) ? occlusion_resolution : 0);
+
+  // Find resident nodes that intersect view frustum
+  std::vector<int> candidates;
+  R3SurfelTree *tree = (scene) ? scene->Tree() : NULL;
+  if (frustum_culling && tree && tree->RootNode()) {
+    // Mark resident nodes and their ancestors in tree
+    std::vector<int> resident_indices(tree->NNodes(), -1);
+    std::vector<unsigned char> ancestor_marks(tree->NNodes(), 0);
+    for (int i = 0; i < resident_nodes.NNodes(); i++) {
+      R3SurfelNode *node = resident_nodes.Node(i);
+      if (node->TreeIndex() < 0) { candidates.push_back(i); continue; }
+      resident_indices[node->TreeIndex()] = i;
+      for (R3SurfelNode *ancestor = node; ancestor; ancestor = ancestor->Parent()) {
+        if (ancestor_marks[ancestor->TreeIndex()]) break;
+        ancestor_marks[ancestor->TreeIndex()] = 1;
+      }
+    }
+
+    // Traverse tree, skipping subtrees outside frustum and testing nothing below subtrees inside it
+    std::vector<R3SurfelNode *> stack;
+    std::vector<int> stack_inside;
+    stack.push_back(tree->RootNode());
+    stack_inside.push_back(0);
+    while (!stack.empty()) {
+      R3SurfelNode *node = stack.back(); stack.pop_back();
+      int inside = stack_inside.back(); stack_inside.pop_back();
+      if (!ancestor_marks[node->TreeIndex()]) continue;
+      if (!inside) {
+        int classification = draw_list_culler.FrustumClassification(node->BBox());
+        if (classification == R3_VIEW_CULLER_OUTSIDE) continue;
+        if (classification == R3_VIEW_CULLER_INSIDE) inside = 1;
+      }
+      int resident_index = resident_indices[node->TreeIndex()];
+      if (resident_index >= 0) candidates.push_back(resident_index);
+      for (int i = 0; i < node->NParts(); i++) {
+        stack.push_back(node->Part(i));
+        stack_inside.push_back(inside);
+      }
+    }
+
+    // Sort candidates by position in VBO
+    std::sort(candidates.begin(), candidates.end());
+  }
+  else {
+    // Consider all resident nodes
+    for (int i = 0; i < resident_nodes.NNodes(); i++) candidates.push_back(i);
+  }
+
+  // Select number of surfels to draw for each node based on screen space distance between surfels
+  std::vector<int> lod_counts(candidates.size(), 0);
+  for (unsigned int c = 0; c < candidates.size(); c++) {
+    int i = candidates[c];
+    int count = vbo_resident_node_offsets[i+1] - vbo_resident_node_offsets[i];
+    lod_counts[c] = count;
+    if ((count == 0) || (screen_space_error <= 0)) continue;
+    R3SurfelNode *node = resident_nodes.Node(i);
+    RNScalar resolution = node->Resolution();
+    if (resolution <= 0) continue;
+    RNLength spacing = sqrt((RNScalar) subsampling_factor) / resolution;
+    RNScalar npixels = draw_list_culler.ProjectedLength(node->BBox(), spacing);
+    if (npixels >= screen_space_error) continue;
+    RNScalar fraction = (npixels * npixels) / (screen_space_error * screen_space_error);
+    lod_counts[c] = (int) (fraction * count + 0.5);
+    if (lod_counts[c] < 1) lod_counts[c] = 1;
+  }
+
+  // Remove nodes hidden behind other nodes
+  std::vector<unsigned char> occluded(candidates.size(), 0);
+  if (occlusion_culling) {
+    // Determine sampling rate for occluders
+    static const RNScalar max_occluder_samples = 256 * 1024;
+    RNScalar total_count = 0;
+    for (unsigned int c = 0; c < candidates.size(); c++) total_count += lod_counts[c];
+    int step = (int) (total_count / max_occluder_samples) + 1;
+
+    // Insert sampled surfels as occluders
+    for (unsigned int c = 0; c < candidates.size(); c++) {
+      if (lod_counts[c] == 0) continue;
+      R3SurfelNode *node = resident_nodes.Node(candidates[c]);
+      RNScalar resolution = node->Resolution();
+      if (resolution <= 0) continue;
+      int node_step = step * subsampling_factor;
+      RNLength radius = sqrt((RNScalar) node_step) / resolution;
+      for (int j = 0; j < node->NBlocks(); j++) {
+        R3SurfelBlock *block = node->Block(j);
+        const R3Point& block_origin = block->PositionOrigin();
+        for (int k = 0; k < block->NSurfels(); k += node_step) {
+          const R3Surfel *surfel = block->Surfel(k);
+          R3Point position(block_origin.X() + surfel->X(), block_origin.Y() + surfel->Y(), block_origin.Z() + surfel->Z());
+          draw_list_culler.InsertOccluder(position, radius);
+        }
+      }
+    }
+
+    // Build hierarchical depth buffer
+    draw_list_culler.UpdateOcclusionHierarchy();
+
+    // Mark nodes whose bounding boxes are hidden
+    for (unsigned int c = 0; c < candidates.size(); c++) {
+      if (lod_counts[c] == 0) continue;
+      R3SurfelNode *node = resident_nodes.Node(candidates[c]);
+      if (draw_list_culler.IsOccluded(node->BBox())) occluded[c] = 1;
+    }
+  }
+
+  // Fill draw list with ranges of VBO (merging adjacent ranges drawn completely)
+  for (unsigned int c = 0; c < candidates.size(); c++) {
+    if (occluded[c]) continue;
+    if (lod_counts[c] == 0) continue;
+    int i = candidates[c];
+    GLint first = vbo_resident_node_offsets[i];
+    GLsizei count = vbo_resident_node_offsets[i+1] - first;
+    GLsizei lod_count = lod_counts[c];
+    if (!draw_list_firsts.empty() &&
+        (draw_list_firsts.back() + draw_list_counts.back() == first) &&
+        (draw_list_lod_counts.back() == draw_list_counts.back()) &&
+        (lod_count == count)) {
+      draw_list_counts.back() += count;
+      draw_list_lod_counts.back() += count;
+    }
+    else {
+      draw_list_firsts.push_back(first);
+      draw_list_counts.push_back(count);
+      draw_list_lod_counts.push_back(lod_count);
+    }
+  }
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // SHADERS
 ////////////////////////////////////////////////////////////////////////
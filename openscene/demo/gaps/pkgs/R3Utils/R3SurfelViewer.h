@@ -114,6 +114,11 @@ public:
   RNScalar FocusRadius(void) const;
   int SubsamplingFactor(void) const;
 
+  // Culling parameters (0=off, 1=on, screen space error in pixels)
+  int FrustumCulling(void) const;
+  int OcclusionCulling(void) const;
+  RNScalar ScreenSpaceError(void) const;
+
   // Elevation properties
   RNScalar Elevation(const R3Point& position) const;
   RNCoord GroundZ(const R3Point& position) const;
@@ -195,6 +200,11 @@ public:
   virtual void SetFocusRadius(RNScalar radius);
   virtual void SetSubsamplingFactor(int subsampling_factor);
 
+  // Culling parameters (0=off, 1=on, -1=toggle)
+  virtual void SetFrustumCulling(int culling);
+  virtual void SetOcclusionCulling(int culling);
+  virtual void SetScreenSpaceError(RNScalar npixels);
+
   // Image input/output
   virtual int WriteImage(const char *filename);
 
@@ -289,7 +299,8 @@ public:
 
   // Buffer generation for surfel rendering
   virtual void ComputeVBOBuffers(std::vector<GLfloat>& surfel_positions,
-      std::vector<GLfloat>& surfel_normals, std::vector<GLubyte>& surfel_colors) const;
+      std::vector<GLfloat>& surfel_normals, std::vector<GLubyte>& surfel_colors,
+      std::vector<int> *resident_node_offsets = NULL) const;
 
 protected:
   // Scene manipulation functions
@@ -307,6 +318,10 @@ protected:
   virtual void InvalidateVBO(void);
   virtual void UpdateVBO(void);
 
+  // Draw list management functions
+  virtual void InvalidateDrawList(void);
+  virtual void UpdateDrawList(void);
+
   // Shader management functions
   virtual void CompileShaders(void);
   virtual void DeleteShaders(void);
@@ -380,6 +395,11 @@ protected:
   int subsampling_factor;
   int subsampling_multiplier_when_mouse_down;
 
+  // Culling parameters
+  int frustum_culling;
+  int occlusion_culling;
+  RNScalar screen_space_error;
+
   // UI state
   int window_height;
   int window_width;
@@ -413,6 +433,14 @@ protected:
   GLuint vbo_normal_buffer;
   GLuint vbo_color_buffer;
   unsigned int vbo_nsurfels;
+  std::vector<int> vbo_resident_node_offsets;
+
+  // Draw list (ranges of VBO drawn for visible resident nodes)
+  R3ViewCuller draw_list_culler;
+  std::vector<GLint> draw_list_firsts;
+  std::vector<GLsizei> draw_list_counts;
+  std::vector<GLsizei> draw_list_lod_counts;
+  RNBoolean draw_list_valid;
 
   // Shader objects
   GLuint shader_program;
@@ -874,6 +902,33 @@ SubsamplingFactor(void) const
 
 
 
+inline int R3SurfelViewer::
+FrustumCulling(void) const
+{
+  // Return whether nodes outside view frustum are culled
+  return frustum_culling;
+}
+
+
+
+inline int R3SurfelViewer::
+OcclusionCulling(void) const
+{
+  // Return whether occluded nodes are culled
+  return occlusion_culling;
+}
+
+
+
+inline RNScalar R3SurfelViewer::
+ScreenSpaceError(void) const
+{
+  // Return target screen space distance between surfels (in pixels)
+  return screen_space_error;
+}
+
+
+
 inline RNCoord R3SurfelViewer::
 GroundZ(const R2Point& position) const
 {
@@ -1408,6 +1463,47 @@ SetSubsamplingFactor(int subsampling_factor)
 
 
 
+inline void R3SurfelViewer::
+SetFrustumCulling(int culling)
+{
+  // Set whether nodes outside view frustum are culled
+  if (culling == -1) frustum_culling = 1 - frustum_culling;
+  else if (culling == 0) frustum_culling = 0;
+  else frustum_culling = 1;
+
+  // Invalidate draw list
+  InvalidateDrawList();
+}
+
+
+
+inline void R3SurfelViewer::
+SetOcclusionCulling(int culling)
+{
+  // Set whether occluded nodes are culled
+  if (culling == -1) occlusion_culling = 1 - occlusion_culling;
+  else if (culling == 0) occlusion_culling = 0;
+  else occlusion_culling = 1;
+
+  // Invalidate draw list
+  InvalidateDrawList();
+}
+
+
+
+inline void R3SurfelViewer::
+SetScreenSpaceError(RNScalar npixels)
+{
+  // Set target screen space distance between surfels (0 = draw all)
+  if (npixels < 0) npixels = 0;
+  this->screen_space_error = npixels;
+
+  // Invalidate draw list
+  InvalidateDrawList();
+}
+
+
+
 inline R3SurfelPoint *R3SurfelViewer::
 SelectedPoint(void) const
 {
@@ -32,6 +32,9 @@ namespace gaps {
 class RGBDImage;
 class RGBDSurface;
 class RGBDConfiguration;
+class RGBDFrameCache;
+class RGBDVolume;
+class RGBDFeatureFusion;
 }
 
 
@@ -62,6 +65,12 @@ class RGBDConfiguration;
 #define RGBD_IMAGE_SELECTION     1
 #define RGBD_SURFACE_SELECTION   2
 
+#define RGBD_READ_COLOR_CHANNELS     0x1
+#define RGBD_READ_DEPTH_CHANNEL      0x2
+#define RGBD_READ_CATEGORY_CHANNEL   0x4
+#define RGBD_READ_INSTANCE_CHANNEL   0x8
+#define RGBD_READ_ALL_CHANNELS       0xF
+
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -72,6 +81,9 @@ class RGBDConfiguration;
 #include "RGBDImage.h"
 #include "RGBDSurface.h"
 #include "RGBDConfiguration.h"
+#include "RGBDFrameCache.h"
+#include "RGBDVolume.h"
+#include "RGBDFeatureFusion.h"
 #include "RGBDTransform.h"
 #include "RGBDUtil.h"
 
@@ -24,6 +24,39 @@ namespace gaps {
 // Constructors/destructors
 ////////////////////////////////////////////////////////////////////////
 
+static R2PixelDatabase *
+OpenPixelDatabase(const char *directory)
+{
+  // Check if directory is an existing pixel database file
+  if (!directory) return NULL;
+  int length = strlen(directory);
+  if ((length < 3) || strcmp(&directory[length-3], ".pd")) return NULL;
+  if (!RNFileExists(directory)) return NULL;
+
+  // Open pixel database for reading
+  R2PixelDatabase *database = new R2PixelDatabase();
+  if (!database->OpenFile(directory, "r")) {
+    delete database;
+    return NULL;
+  }
+
+  // Return pixel database
+  return database;
+}
+
+
+
+static void
+ClosePixelDatabase(R2PixelDatabase *database)
+{
+  // Close and delete pixel database
+  if (!database) return;
+  database->CloseFile();
+  delete database;
+}
+
+
+
 RGBDConfiguration::
 RGBDConfiguration(void)
   : images(),
@@ -35,6 +68,9 @@ RGBDConfiguration(void)
     instance_directory(NULL),
     texture_directory(NULL),
     dataset_format(NULL),
+    color_pixel_database(NULL),
+    depth_pixel_database(NULL),
+    compact_channel_cache(FALSE),
     world_bbox(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX)
 {
 }
@@ -60,6 +96,10 @@ RGBDConfiguration::
 
   // Delete dataset format
   if (dataset_format) free(dataset_format);
+
+  // Close pixel databases
+  ClosePixelDatabase(color_pixel_database);
+  ClosePixelDatabase(depth_pixel_database);
 }
 
 
@@ -211,6 +251,10 @@ SetColorDirectory(const char *directory)
   if (color_directory) free(color_directory);
   if (directory && strcmp(directory, "-")) color_directory = RNStrdup(directory);
   else color_directory = NULL;
+
+  // Open pixel database if directory names one
+  ClosePixelDatabase(color_pixel_database);
+  color_pixel_database = OpenPixelDatabase(color_directory);
 }
 
 
@@ -222,6 +266,10 @@ SetDepthDirectory(const char *directory)
   if (depth_directory) free(depth_directory);
   if (directory && strcmp(directory, "-")) depth_directory = RNStrdup(directory);
   else depth_directory = NULL;
+
+  // Open pixel database if directory names one
+  ClosePixelDatabase(depth_pixel_database);
+  depth_pixel_database = OpenPixelDatabase(depth_directory);
 }
 
 
@@ -270,6 +318,16 @@ SetDatasetFormat(const char *format)
 
 
 
+void RGBDConfiguration::
+SetCompactChannelCache(RNBoolean enable)
+{
+  // Set whether images keep compact copies of released channels,
+  // so that they can be read again without accessing files
+  compact_channel_cache = enable;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // File input/output functions
 ////////////////////////////////////////////////////////////////////////
@@ -1340,15 +1398,62 @@ WriteObjFile(const char *filename) const
 // Read/release functions
 ////////////////////////////////////////////////////////////////////////
 
+// Images are read in parallel, since decoding color and depth files
+// dominates the time to load a configuration.  Each image only
+// modifies its own channels, so no locking is required.
+
+struct RGBDReadImageChannelsData {
+  RGBDConfiguration *configuration;
+  int channel_flags;
+};
+
+
+
+static void
+ReadImageChannelsCallback(int index, int, void *ptr)
+{
+  // Read channels of one image
+  RGBDReadImageChannelsData *data = (RGBDReadImageChannelsData *) ptr;
+  RGBDImage *image = data->configuration->Image(index);
+  if (data->channel_flags & RGBD_READ_COLOR_CHANNELS) image->ReadColorChannels();
+  if (data->channel_flags & RGBD_READ_DEPTH_CHANNEL) image->ReadDepthChannel();
+  if (data->channel_flags & RGBD_READ_CATEGORY_CHANNEL) image->ReadCategoryChannel();
+  if (data->channel_flags & RGBD_READ_INSTANCE_CHANNEL) image->ReadInstanceChannel();
+}
+
+
+
 int RGBDConfiguration::
-ReadChannels(void)
+ReadImageChannels(int channel_flags)
 {
-  // Read images
+  // Invalidate bounding box up front (so that images need not do it concurrently)
+  InvalidateWorldBBox();
+
+  // Read serially if some image has an opengl texture (which must be deleted in this thread)
+  RNBoolean serial = FALSE;
   for (int i = 0; i < NImages(); i++) {
-    RGBDImage *image = Image(i);
-    image->ReadChannels();
+    if (Image(i)->opengl_texture_id >= 0) { serial = TRUE; break; }
   }
 
+  // Read images
+  RGBDReadImageChannelsData data;
+  data.configuration = this;
+  data.channel_flags = channel_flags;
+  if (serial) for (int i = 0; i < NImages(); i++) ReadImageChannelsCallback(i, 0, &data);
+  else RNParallelFor(NImages(), ReadImageChannelsCallback, &data);
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDConfiguration::
+ReadChannels(void)
+{
+  // Read images
+  ReadImageChannels(RGBD_READ_ALL_CHANNELS);
+
   // Read surfaces
   for (int i = 0; i < NSurfaces(); i++) {
     RGBDSurface *surface = Surface(i);
@@ -1386,10 +1491,7 @@ int RGBDConfiguration::
 ReadColorChannels(void)
 {
   // Read images
-  for (int i = 0; i < NImages(); i++) {
-    RGBDImage *image = Image(i);
-    image->ReadColorChannels();
-  }
+  ReadImageChannels(RGBD_READ_COLOR_CHANNELS);
 
   // Read surfaces
   for (int i = 0; i < NSurfaces(); i++) {
@@ -1428,10 +1530,7 @@ int RGBDConfiguration::
 ReadDepthChannels(void)
 {
   // Read images
-  for (int i = 0; i < NImages(); i++) {
-    RGBDImage *image = Image(i);
-    image->ReadDepthChannel();
-  }
+  ReadImageChannels(RGBD_READ_DEPTH_CHANNEL);
 
   // Return success
   return 1;
@@ -1458,10 +1557,7 @@ int RGBDConfiguration::
 ReadCategoryChannels(void)
 {
   // Read images
-  for (int i = 0; i < NImages(); i++) {
-    RGBDImage *image = Image(i);
-    image->ReadCategoryChannel();
-  }
+  ReadImageChannels(RGBD_READ_CATEGORY_CHANNEL);
 
   // Return success
   return 1;
@@ -1488,10 +1584,7 @@ int RGBDConfiguration::
 ReadInstanceChannels(void)
 {
   // Read images
-  for (int i = 0; i < NImages(); i++) {
-    RGBDImage *image = Image(i);
-    image->ReadInstanceChannel();
-  }
+  ReadImageChannels(RGBD_READ_INSTANCE_CHANNEL);
 
   // Return success
   return 1;
@@ -1521,6 +1614,9 @@ ReleaseInstanceChannels(void)
 void RGBDConfiguration::
 InvalidateWorldBBox(void)
 {
+  // Check if already marked (empty boxes are recomputed anyway)
+  if (world_bbox.IsEmpty()) return;
+
   // Mark bounding box for recomputation
   world_bbox.Reset(R3Point(FLT_MAX, FLT_MAX, FLT_MAX), R3Point(-FLT_MAX, -FLT_MAX, -FLT_MAX));
 }
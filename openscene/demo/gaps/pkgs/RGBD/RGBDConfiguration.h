@@ -43,6 +43,13 @@ public:
   const char *InstanceDirectory(void) const;
   const char *TextureDirectory(void) const;
   const char *DatasetFormat(void) const;
+
+  // Pixel database access functions (non-NULL if directory is a .pd file)
+  R2PixelDatabase *ColorPixelDatabase(void) const;
+  R2PixelDatabase *DepthPixelDatabase(void) const;
+
+  // Channel cache access functions
+  RNBoolean CompactChannelCache(void) const;
   
   // Image and surface manipulation functions
   virtual void InsertImage(RGBDImage *image);
@@ -60,6 +67,9 @@ public:
   virtual void SetTextureDirectory(const char *directory);
   virtual void SetDatasetFormat(const char *format);
 
+  // Channel cache manipulation functions (keep compact copies of released channels)
+  virtual void SetCompactChannelCache(RNBoolean enable);
+
   // File input/output
   virtual int ReadFile(const char *filename, int read_every_kth_image = 1);
   virtual int ReadConfigurationFile(const char *filename, int read_every_kth_image = 1);
@@ -95,6 +105,7 @@ public:
   virtual int ReleaseCategoryChannels(void);
   virtual int ReadInstanceChannels(void);
   virtual int ReleaseInstanceChannels(void);
+  virtual int ReadImageChannels(int channel_flags = RGBD_READ_ALL_CHANNELS);
 
   // Update functions
   virtual void InvalidateWorldBBox(void);
@@ -111,6 +122,9 @@ private:
   char *instance_directory;
   char *texture_directory;
   char *dataset_format;
+  R2PixelDatabase *color_pixel_database;
+  R2PixelDatabase *depth_pixel_database;
+  RNBoolean compact_channel_cache;
   R3Box world_bbox;
 };
 
@@ -229,6 +243,33 @@ DatasetFormat(void) const
 
 
 
+inline R2PixelDatabase *RGBDConfiguration::
+ColorPixelDatabase(void) const
+{
+  // Return pixel database with color images
+  return color_pixel_database;
+}
+
+
+
+inline R2PixelDatabase *RGBDConfiguration::
+DepthPixelDatabase(void) const
+{
+  // Return pixel database with depth images
+  return depth_pixel_database;
+}
+
+
+
+inline RNBoolean RGBDConfiguration::
+CompactChannelCache(void) const
+{
+  // Return whether images keep compact copies of released channels
+  return compact_channel_cache;
+}
+
+
+
 // End namespace
 }
 
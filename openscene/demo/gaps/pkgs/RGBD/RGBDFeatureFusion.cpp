@@ -0,0 +1,557 @@
+////////////////////////////////////////////////////////////////////////
+// Source file for RGBDFeatureFusion class
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// NOTE:
+// Feature fusion averages per-pixel 2D features (e.g., from an image
+// segmentation network) over all images in which each 3D point is
+// visible.  A point is visible in an image if it projects inside the
+// image (minus a boundary) and its depth is within a threshold of the
+// depth at its pixel (relative to that depth).  Images are integrated
+// one at a time, so feature maps can be streamed from disk.
+//
+// Points are sorted along a space-filling curve and split into chunks,
+// so that chunks outside the view frustum of an image can be skipped.
+// Visible chunks are processed in parallel.  The running mean features
+// of each point are stored as float16 values (updated with float math).
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "RGBD.h"
+#include <algorithm>
+#include <vector>
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////////////////
+
+// Number of points in a chunk
+#define RGBD_FEATURE_FUSION_CHUNK_SIZE 256
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Utility functions
+////////////////////////////////////////////////////////////////////////
+
+static unsigned long long
+MortonCode(unsigned int i, unsigned int j, unsigned int k)
+{
+  // Interleave bits of three 21-bit coordinates
+  unsigned long long code = 0;
+  for (int b = 0; b < 21; b++) {
+    code |= (unsigned long long) ((i >> b) & 1) << (3*b);
+    code |= (unsigned long long) ((j >> b) & 1) << (3*b + 1);
+    code |= (unsigned long long) ((k >> b) & 1) << (3*b + 2);
+  }
+  return code;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+RGBDFeatureFusion::
+RGBDFeatureFusion(int npoints, const float *input_positions, int nfeatures)
+  : npoints(npoints),
+    nfeatures(nfeatures),
+    nintegrated_images(0),
+    positions(NULL),
+    point_indices(NULL),
+    nchunks(0),
+    chunk_boxes(NULL),
+    features(NULL),
+    observation_counts(NULL),
+    visibility_threshold(0.25),
+    boundary_width(0)
+{
+  // Check number of points
+  if (npoints <= 0) { this->npoints = 0; return; }
+
+  // Compute bounding box of points
+  R3Box bbox = R3null_box;
+  for (int i = 0; i < npoints; i++) {
+    bbox.Union(R3Point(input_positions[3*i], input_positions[3*i+1], input_positions[3*i+2]));
+  }
+
+  // Sort points along space-filling curve
+  std::vector<std::pair<unsigned long long, int> > codes(npoints);
+  RNLength scale = (bbox.LongestAxisLength() > 0) ? ((1 << 21) - 1) / bbox.LongestAxisLength() : 0;
+  for (int i = 0; i < npoints; i++) {
+    unsigned int qi = (unsigned int) (scale * (input_positions[3*i] - bbox.XMin()));
+    unsigned int qj = (unsigned int) (scale * (input_positions[3*i+1] - bbox.YMin()));
+    unsigned int qk = (unsigned int) (scale * (input_positions[3*i+2] - bbox.ZMin()));
+    codes[i] = std::pair<unsigned long long, int>(MortonCode(qi, qj, qk), i);
+  }
+  std::sort(codes.begin(), codes.end());
+
+  // Copy positions in sorted order
+  positions = new float [ 3 * npoints ];
+  point_indices = new int [ npoints ];
+  for (int i = 0; i < npoints; i++) {
+    int point_index = codes[i].second;
+    point_indices[i] = point_index;
+    for (int c = 0; c < 3; c++) positions[3*i+c] = input_positions[3*point_index+c];
+  }
+
+  // Compute bounding boxes of chunks
+  nchunks = (npoints + RGBD_FEATURE_FUSION_CHUNK_SIZE - 1) / RGBD_FEATURE_FUSION_CHUNK_SIZE;
+  chunk_boxes = new R3Box [ nchunks ];
+  for (int k = 0; k < nchunks; k++) {
+    chunk_boxes[k] = R3null_box;
+    int end = (k+1) * RGBD_FEATURE_FUSION_CHUNK_SIZE;
+    if (end > npoints) end = npoints;
+    for (int i = k * RGBD_FEATURE_FUSION_CHUNK_SIZE; i < end; i++) {
+      chunk_boxes[k].Union(R3Point(positions[3*i], positions[3*i+1], positions[3*i+2]));
+    }
+  }
+
+  // Allocate features and observation counts
+  features = new unsigned short [ (size_t) npoints * nfeatures ];
+  observation_counts = new int [ npoints ];
+  Reset();
+}
+
+
+
+RGBDFeatureFusion::
+~RGBDFeatureFusion(void)
+{
+  // Delete everything
+  if (positions) delete [] positions;
+  if (point_indices) delete [] point_indices;
+  if (chunk_boxes) delete [] chunk_boxes;
+  if (features) delete [] features;
+  if (observation_counts) delete [] observation_counts;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+void RGBDFeatureFusion::
+Reset(void)
+{
+  // Reset features and observation counts (zero is also zero in float16)
+  if (npoints == 0) return;
+  memset(features, 0, (size_t) npoints * nfeatures * sizeof(unsigned short));
+  memset(observation_counts, 0, npoints * sizeof(int));
+  nintegrated_images = 0;
+}
+
+
+
+void RGBDFeatureFusion::
+SetVisibilityThreshold(RNScalar threshold)
+{
+  // Set maximum depth difference (relative to pixel depth) for point to be visible
+  this->visibility_threshold = threshold;
+}
+
+
+
+void RGBDFeatureFusion::
+SetBoundaryWidth(int npixels)
+{
+  // Set number of pixels at image boundary whose features are ignored
+  this->boundary_width = npixels;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Integration functions
+////////////////////////////////////////////////////////////////////////
+
+struct RGBDFeatureFusionData {
+  const float *positions;
+  const int *point_indices;
+  const int *chunk_indices;
+  int npoints;
+  int nfeatures;
+  unsigned short *features;
+  int *observation_counts;
+  R4Matrix world_to_camera;
+  RNScalar fx, fy, cx, cy;
+  int width, height;
+  int boundary_width;
+  const RNScalar *depths;
+  int depth_width, depth_height;
+  RNScalar visibility_threshold;
+  const void *feature_values;
+  int feature_width, feature_height;
+  int value_type;
+  RNBoolean channels_first;
+};
+
+
+
+static RNBoolean
+IsChunkVisible(const RGBDFeatureFusionData *fusion, const R3Box& box)
+{
+  // Compute camera coordinates of box corners
+  R3Point corners[8];
+  for (int c = 0; c < 8; c++) {
+    R3Point corner(box[c & 1][RN_X], box[(c >> 1) & 1][RN_Y], box[(c >> 2) & 1][RN_Z]);
+    corners[c] = fusion->world_to_camera * corner;
+  }
+
+  // Compute bounds of rounded pixel coordinates
+  RNScalar xmin = fusion->boundary_width - 0.5;
+  RNScalar xmax = fusion->width - fusion->boundary_width - 0.5;
+  RNScalar ymin = fusion->boundary_width - 0.5;
+  RNScalar ymax = fusion->height - fusion->boundary_width - 0.5;
+
+  // Check halfspaces of view frustum (in camera coordinates, where depth is -z)
+  for (int h = 0; h < 5; h++) {
+    RNBoolean outside = TRUE;
+    for (int c = 0; c < 8; c++) {
+      const R3Point& p = corners[c];
+      RNScalar depth = -p.Z();
+      RNScalar value = 0;
+      switch (h) {
+      case 0: value = depth; break;
+      case 1: value = fusion->fx * p.X() + (fusion->cx - xmin) * depth; break;
+      case 2: value = (xmax - fusion->cx) * depth - fusion->fx * p.X(); break;
+      case 3: value = fusion->fy * p.Y() + (fusion->cy - ymin) * depth; break;
+      case 4: value = (ymax - fusion->cy) * depth - fusion->fy * p.Y(); break;
+      }
+      if (value >= 0) { outside = FALSE; break; }
+    }
+    if (outside) return FALSE;
+  }
+
+  // Return whether chunk may be visible
+  return TRUE;
+}
+
+
+
+static void
+IntegrateChunkFeatures(int index, int, void *data)
+{
+  // Get convenient variables
+  RGBDFeatureFusionData *fusion = (RGBDFeatureFusionData *) data;
+  const R4Matrix& m = fusion->world_to_camera;
+  int nfeatures = fusion->nfeatures;
+  int chunk_index = fusion->chunk_indices[index];
+  int start = chunk_index * RGBD_FEATURE_FUSION_CHUNK_SIZE;
+  int end = start + RGBD_FEATURE_FUSION_CHUNK_SIZE;
+  if (end > fusion->npoints) end = fusion->npoints;
+  size_t feature_stride = (fusion->channels_first) ? (size_t) fusion->feature_width * fusion->feature_height : 1;
+
+  // Visit points in chunk
+  for (int i = start; i < end; i++) {
+    // Compute camera coordinates (camera is looking down -z)
+    const float *p = &fusion->positions[3*i];
+    RNScalar x = m[0][0]*p[0] + m[0][1]*p[1] + m[0][2]*p[2] + m[0][3];
+    RNScalar y = m[1][0]*p[0] + m[1][1]*p[1] + m[1][2]*p[2] + m[1][3];
+    RNScalar depth = -(m[2][0]*p[0] + m[2][1]*p[1] + m[2][2]*p[2] + m[2][3]);
+    if (depth <= 0) continue;
+
+    // Compute pixel
+    int ix = (int) floor(fusion->cx + fusion->fx * x / depth + 0.5);
+    if ((ix < fusion->boundary_width) || (ix >= fusion->width - fusion->boundary_width)) continue;
+    int iy = (int) floor(fusion->cy + fusion->fy * y / depth + 0.5);
+    if ((iy < fusion->boundary_width) || (iy >= fusion->height - fusion->boundary_width)) continue;
+
+    // Check visibility
+    if (fusion->depths) {
+      int dx = ix * fusion->depth_width / fusion->width;
+      int dy = iy * fusion->depth_height / fusion->height;
+      RNScalar pixel_depth = fusion->depths[dy*fusion->depth_width + dx];
+      if ((pixel_depth == R2_GRID_UNKNOWN_VALUE) || (pixel_depth <= 0)) continue;
+      if (fabs(pixel_depth - depth) > fusion->visibility_threshold * pixel_depth) continue;
+    }
+
+    // Find feature pixel (first row of feature map is top of image)
+    int fx = (int) ((ix + 0.5) * fusion->feature_width / fusion->width);
+    int fy = (int) ((iy + 0.5) * fusion->feature_height / fusion->height);
+    if (fx >= fusion->feature_width) fx = fusion->feature_width - 1;
+    if (fy >= fusion->feature_height) fy = fusion->feature_height - 1;
+    size_t pixel_index = (size_t) (fusion->feature_height - 1 - fy) * fusion->feature_width + fx;
+    size_t first_value = (fusion->channels_first) ? pixel_index : pixel_index * nfeatures;
+
+    // Update running mean of features
+    int point_index = fusion->point_indices[i];
+    int count = ++fusion->observation_counts[point_index];
+    float weight = 1.0f / count;
+    unsigned short *mean = &fusion->features[(size_t) point_index * nfeatures];
+    if (fusion->value_type == RN_GRID_FLOAT16_VALUE_TYPE) {
+      const unsigned short *values = (const unsigned short *) fusion->feature_values + first_value;
+      for (int k = 0; k < nfeatures; k++) {
+        float m = RNHalfToFloat(mean[k]);
+        mean[k] = RNFloatToHalf(m + weight * (RNHalfToFloat(values[k*feature_stride]) - m));
+      }
+    }
+    else {
+      const float *values = (const float *) fusion->feature_values + first_value;
+      for (int k = 0; k < nfeatures; k++) {
+        float m = RNHalfToFloat(mean[k]);
+        mean[k] = RNFloatToHalf(m + weight * (values[k*feature_stride] - m));
+      }
+    }
+  }
+}
+
+
+
+int RGBDFeatureFusion::
+IntegrateFeatures(const RGBDImage *image, const void *feature_values,
+  int feature_width, int feature_height, int value_type, RNBoolean channels_first)
+{
+  // Check feature map
+  if ((feature_width <= 0) || (feature_height <= 0)) return 0;
+  if ((value_type != RN_GRID_FLOAT16_VALUE_TYPE) && (value_type != RN_GRID_FLOAT32_VALUE_TYPE)) {
+    RNFail("Unsupported value type for features\n");
+    return 0;
+  }
+
+  // Check intrinsics
+  const R3Matrix& intrinsics = image->Intrinsics();
+  if (RNIsZero(intrinsics[0][0]) || RNIsZero(intrinsics[1][1])) {
+    RNFail("Invalid intrinsics matrix for feature fusion\n");
+    return 0;
+  }
+
+  // Initialize fusion data
+  RGBDFeatureFusionData fusion;
+  fusion.positions = positions;
+  fusion.point_indices = point_indices;
+  fusion.chunk_indices = NULL;
+  fusion.npoints = npoints;
+  fusion.nfeatures = nfeatures;
+  fusion.features = features;
+  fusion.observation_counts = observation_counts;
+  fusion.world_to_camera = image->CameraToWorld().InverseMatrix();
+  fusion.fx = intrinsics[0][0];
+  fusion.fy = intrinsics[1][1];
+  fusion.cx = intrinsics[0][2];
+  fusion.cy = intrinsics[1][2];
+  fusion.width = image->NPixels(RN_X);
+  fusion.height = image->NPixels(RN_Y);
+  fusion.boundary_width = boundary_width;
+  fusion.depths = NULL;
+  fusion.depth_width = fusion.depth_height = 0;
+  R2Grid *depth_channel = image->DepthChannel();
+  if (depth_channel && (depth_channel->NEntries() > 0)) {
+    fusion.depths = depth_channel->GridValues();
+    fusion.depth_width = depth_channel->XResolution();
+    fusion.depth_height = depth_channel->YResolution();
+  }
+  fusion.visibility_threshold = visibility_threshold;
+  fusion.feature_values = feature_values;
+  fusion.feature_width = feature_width;
+  fusion.feature_height = feature_height;
+  fusion.value_type = value_type;
+  fusion.channels_first = channels_first;
+  if ((fusion.width <= 0) || (fusion.height <= 0)) return 0;
+
+  // Find chunks inside view frustum
+  std::vector<int> chunk_indices;
+  for (int k = 0; k < nchunks; k++) {
+    if (IsChunkVisible(&fusion, chunk_boxes[k])) chunk_indices.push_back(k);
+  }
+
+  // Integrate features of points in visible chunks (in parallel over chunks)
+  if (!chunk_indices.empty()) {
+    fusion.chunk_indices = &chunk_indices[0];
+    RNParallelFor((int) chunk_indices.size(), IntegrateChunkFeatures, &fusion, 4);
+  }
+
+  // Update number of integrated images
+  nintegrated_images++;
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+HasImageAspect(const RGBDImage *image, int feature_width, int feature_height)
+{
+  // Check whether feature map has aspect ratio of image (up to rounding of its size)
+  int image_width = image->NPixels(RN_X);
+  int image_height = image->NPixels(RN_Y);
+  if ((image_width <= 0) || (image_height <= 0)) return 0;
+  double error = fabs((double) feature_height * image_width - (double) feature_width * image_height);
+  return (error <= 0.5 * (image_width + image_height)) ? 1 : 0;
+}
+
+
+
+int RGBDFeatureFusion::
+IntegrateFeatureFile(const RGBDImage *image, const char *filename)
+{
+  // Map file
+  unsigned long long size = 0;
+  void *data = RNMapFile(filename, &size);
+  if (!data) {
+    RNFail("Unable to read feature file %s\n", filename);
+    return 0;
+  }
+
+  // Parse header
+  char value_kind = 0;
+  int value_size = 0, shape[8];
+  unsigned long long values_offset = 0;
+  int ndims = RNParseNumpyHeader(data, size, &value_kind, &value_size, shape, 8, &values_offset);
+  if ((ndims < 0) || (ndims > 8)) {
+    RNFail("Unable to parse header of feature file %s\n", filename);
+    RNUnmapFile(data, size);
+    return 0;
+  }
+
+  // Remove leading dimensions of size one (e.g., a batch dimension)
+  int first_dim = 0;
+  while ((ndims - first_dim > 3) && (shape[first_dim] == 1)) first_dim++;
+
+  // Determine layout of features (by aspect ratio of image if both first and last dimensions match)
+  const int *dims = &shape[first_dim];
+  RNBoolean channels_last = (ndims - first_dim == 3) && (dims[2] == nfeatures);
+  RNBoolean channels_first = (ndims - first_dim == 3) && (dims[0] == nfeatures);
+  if (!channels_last && !channels_first) {
+    RNFail("Feature file %s does not have %d features per pixel\n", filename, nfeatures);
+    RNUnmapFile(data, size);
+    return 0;
+  }
+  else if (channels_last && channels_first) {
+    channels_last = HasImageAspect(image, dims[1], dims[0]);
+    channels_first = HasImageAspect(image, dims[2], dims[1]);
+    if (channels_last == channels_first) {
+      RNFail("Layout of features in %s is ambiguous\n", filename);
+      RNUnmapFile(data, size);
+      return 0;
+    }
+  }
+
+  // Get size of feature map
+  int feature_height = (channels_first) ? dims[1] : dims[0];
+  int feature_width = (channels_first) ? dims[2] : dims[1];
+
+  // Determine value type
+  int value_type = -1;
+  if ((value_kind == 'f') && (value_size == 2)) value_type = RN_GRID_FLOAT16_VALUE_TYPE;
+  else if ((value_kind == 'f') && (value_size == 4)) value_type = RN_GRID_FLOAT32_VALUE_TYPE;
+  if (value_type < 0) {
+    RNFail("Feature file %s does not have float16 or float32 values\n", filename);
+    RNUnmapFile(data, size);
+    return 0;
+  }
+
+  // Check size
+  unsigned long long nvalues = (unsigned long long) feature_width * feature_height * nfeatures;
+  if (values_offset + nvalues * value_size > size) {
+    RNFail("Feature file %s is truncated\n", filename);
+    RNUnmapFile(data, size);
+    return 0;
+  }
+
+  // Integrate features
+  const unsigned char *values = (const unsigned char *) data + values_offset;
+  int status = IntegrateFeatures(image, values, feature_width, feature_height, value_type, channels_first);
+
+  // Unmap file
+  RNUnmapFile(data, size);
+
+  // Return status
+  return status;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// File output functions
+////////////////////////////////////////////////////////////////////////
+
+int RGBDFeatureFusion::
+WriteFeatureFile(const char *filename) const
+{
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open feature file %s\n", filename);
+    return 0;
+  }
+
+  // Write header
+  int shape[2] = { npoints, nfeatures };
+  if (!RNWriteNumpyHeader(fp, "<f2", shape, 2)) {
+    fclose(fp);
+    return 0;
+  }
+
+  // Write features
+  size_t nvalues = (size_t) npoints * nfeatures;
+  if ((nvalues > 0) && (fwrite(features, sizeof(unsigned short), nvalues, fp) != nvalues)) {
+    RNFail("Unable to write features to %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDFeatureFusion::
+WriteObservationCountFile(const char *filename) const
+{
+  // Open file
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    RNFail("Unable to open observation count file %s\n", filename);
+    return 0;
+  }
+
+  // Write header
+  int shape[1] = { npoints };
+  if (!RNWriteNumpyHeader(fp, "<i4", shape, 1)) {
+    fclose(fp);
+    return 0;
+  }
+
+  // Write observation counts
+  if ((npoints > 0) && (fwrite(observation_counts, sizeof(int), npoints, fp) != (size_t) npoints)) {
+    RNFail("Unable to write observation counts to %s\n", filename);
+    fclose(fp);
+    return 0;
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////
+// Include file for RGBDFeatureFusion class
+////////////////////////////////////////////////////////////////////////
+
+#ifndef __RGBD__FEATURE__FUSION__H__
+#define __RGBD__FEATURE__FUSION__H__
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Class definition
+////////////////////////////////////////////////////////////////////////
+
+class RGBDFeatureFusion {
+public:
+  // Constructors/destructors
+  RGBDFeatureFusion(int npoints, const float *positions, int nfeatures);
+  ~RGBDFeatureFusion(void);
+
+  // Property functions
+  int NPoints(void) const;
+  int NFeatures(void) const;
+  int NIntegratedImages(void) const;
+  RNScalar VisibilityThreshold(void) const;
+  int BoundaryWidth(void) const;
+
+  // Point access functions
+  int PointObservationCount(int point_index) const;
+  RNScalar PointFeature(int point_index, int feature_index) const;
+  const unsigned short *PointFeatures(int point_index) const;
+
+  // Manipulation functions
+  void Reset(void);
+  void SetVisibilityThreshold(RNScalar threshold);
+  void SetBoundaryWidth(int npixels);
+
+  // Integration functions (features are float16 or float32 values for
+  // each pixel of a feature map whose first row is the top of the image,
+  // stored with shape (height, width, nfeatures) or, if channels_first,
+  // (nfeatures, height, width); the depth channel of the image is used
+  // for visibility tests if it has been read)
+  int IntegrateFeatures(const RGBDImage *image, const void *features,
+    int feature_width, int feature_height, int value_type = RN_GRID_FLOAT16_VALUE_TYPE,
+    RNBoolean channels_first = FALSE);
+  int IntegrateFeatureFile(const RGBDImage *image, const char *filename);
+
+  // File output functions (features are written as float16 values with
+  // shape (npoints, nfeatures), and counts as int32 values with shape (npoints))
+  int WriteFeatureFile(const char *filename) const;
+  int WriteObservationCountFile(const char *filename) const;
+
+private:
+  // Internal variables
+  int npoints;
+  int nfeatures;
+  int nintegrated_images;
+  float *positions;
+  int *point_indices;
+  int nchunks;
+  R3Box *chunk_boxes;
+  unsigned short *features;
+  int *observation_counts;
+  RNScalar visibility_threshold;
+  int boundary_width;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Inline functions
+////////////////////////////////////////////////////////////////////////
+
+inline int RGBDFeatureFusion::
+NPoints(void) const
+{
+  // Return number of points
+  return npoints;
+}
+
+
+
+inline int RGBDFeatureFusion::
+NFeatures(void) const
+{
+  // Return number of features per point
+  return nfeatures;
+}
+
+
+
+inline int RGBDFeatureFusion::
+NIntegratedImages(void) const
+{
+  // Return number of images whose features have been integrated
+  return nintegrated_images;
+}
+
+
+
+inline RNScalar RGBDFeatureFusion::
+VisibilityThreshold(void) const
+{
+  // Return maximum depth difference (relative to pixel depth) for point to be visible
+  return visibility_threshold;
+}
+
+
+
+inline int RGBDFeatureFusion::
+BoundaryWidth(void) const
+{
+  // Return number of pixels at image boundary whose features are ignored
+  return boundary_width;
+}
+
+
+
+inline int RGBDFeatureFusion::
+PointObservationCount(int point_index) const
+{
+  // Return number of images in which point was visible
+  return observation_counts[point_index];
+}
+
+
+
+inline const unsigned short *RGBDFeatureFusion::
+PointFeatures(int point_index) const
+{
+  // Return mean features of point (as float16 values)
+  return &features[(size_t) point_index * nfeatures];
+}
+
+
+
+inline RNScalar RGBDFeatureFusion::
+PointFeature(int point_index, int feature_index) const
+{
+  // Return mean feature of point
+  return RNHalfToFloat(PointFeatures(point_index)[feature_index]);
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
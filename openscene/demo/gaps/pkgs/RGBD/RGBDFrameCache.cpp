@@ -0,0 +1,639 @@
+////////////////////////////////////////////////////////////////////////
+// Source file for RGBDFrameCache class
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// NOTE:
+// A frame cache keeps the channels of recently used images of a
+// configuration resident, up to a memory budget.  Prefetch reads
+// images (and computes their derived channels) in parallel, so that
+// programs that visit images in order can decode the next batch of
+// images at once and then process them one at a time.  When the
+// budget is exceeded, the least recently used images that are not
+// acquired (and not waiting to be acquired after the most recent
+// prefetch) are released.  Prefetch reads only as many images as
+// fit in the budget, and the rest are read when acquired.  Derived
+// channels can also be cached on disk (as pfm files named
+// <image>_<key>_<channel>.pfm, where key is a hash of the image
+// resolution, pose, and intrinsics, and of the parameters set by the
+// program), so that they are computed only once across runs.
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "RGBD.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Cache entry definition
+////////////////////////////////////////////////////////////////////////
+
+struct RGBDFrameCacheEntry {
+  int status;
+  int pin_count;
+  int prefetched;
+  int read_flags;
+  unsigned long long last_use;
+  size_t nbytes;
+  R2Grid *derived_channels;
+};
+
+// Entry status values
+#define RGBD_FRAME_NOT_LOADED   0
+#define RGBD_FRAME_LOADED       1
+#define RGBD_FRAME_FAILED      -1
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+RGBDFrameCache::
+RGBDFrameCache(RGBDConfiguration *configuration, int channel_flags, size_t memory_budget)
+  : configuration(configuration),
+    entries(NULL),
+    nentries(0),
+    channel_flags(channel_flags),
+    memory_budget(memory_budget),
+    memory_usage(0),
+    nresident_images(0),
+    use_counter(0),
+    nderived_channels(0),
+    derived_channel_names(NULL),
+    derived_channels_callback(NULL),
+    derived_channels_callback_data(NULL),
+    derived_channel_directory(NULL),
+    derived_channel_parameters(NULL)
+{
+  // Allocate entries (one per image in configuration)
+  nentries = (configuration) ? configuration->NImages() : 0;
+  if (nentries > 0) {
+    entries = new RGBDFrameCacheEntry [ nentries ];
+    for (int i = 0; i < nentries; i++) {
+      entries[i].status = RGBD_FRAME_NOT_LOADED;
+      entries[i].pin_count = 0;
+      entries[i].prefetched = FALSE;
+      entries[i].read_flags = 0;
+      entries[i].last_use = 0;
+      entries[i].nbytes = 0;
+      entries[i].derived_channels = NULL;
+    }
+  }
+}
+
+
+
+RGBDFrameCache::
+~RGBDFrameCache(void)
+{
+  // Release all resident frames
+  for (int i = 0; i < nentries; i++) {
+    if (entries[i].status == RGBD_FRAME_LOADED) UnloadFrame(i);
+  }
+
+  // Delete entries
+  if (entries) delete [] entries;
+
+  // Delete derived channel names
+  for (int i = 0; i < nderived_channels; i++) free(derived_channel_names[i]);
+  if (derived_channel_names) delete [] derived_channel_names;
+
+  // Delete directory name and parameters
+  if (derived_channel_directory) free(derived_channel_directory);
+  if (derived_channel_parameters) free(derived_channel_parameters);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Frame access functions
+////////////////////////////////////////////////////////////////////////
+
+RNBoolean RGBDFrameCache::
+IsResident(int image_index) const
+{
+  // Return whether frame is resident
+  if ((image_index < 0) || (image_index >= nentries)) return FALSE;
+  return (entries[image_index].status == RGBD_FRAME_LOADED);
+}
+
+
+
+RGBDImage *RGBDFrameCache::
+AcquireImage(int image_index)
+{
+  // Check image index
+  if ((image_index < 0) || (image_index >= nentries)) return NULL;
+  RGBDFrameCacheEntry& entry = entries[image_index];
+
+  // Load frame if not resident
+  if (entry.status == RGBD_FRAME_NOT_LOADED) {
+    if (LoadFrame(image_index)) {
+      memory_usage += entry.nbytes;
+      nresident_images++;
+    }
+  }
+
+  // Check status
+  if (entry.status != RGBD_FRAME_LOADED) return NULL;
+
+  // Mark frame as used (so that it is not evicted)
+  entry.pin_count++;
+  entry.prefetched = FALSE;
+  TouchFrame(image_index);
+
+  // Release other frames if over budget
+  EvictFrames();
+
+  // Return image
+  return configuration->Image(image_index);
+}
+
+
+
+void RGBDFrameCache::
+ReleaseImage(int image_index)
+{
+  // Check image index
+  if ((image_index < 0) || (image_index >= nentries)) return;
+  RGBDFrameCacheEntry& entry = entries[image_index];
+
+  // Update use count (frame stays resident until evicted)
+  if (entry.pin_count > 0) entry.pin_count--;
+
+  // Release frames if over budget
+  EvictFrames();
+}
+
+
+
+const R2Grid *RGBDFrameCache::
+DerivedChannel(int image_index, int derived_channel_index) const
+{
+  // Return derived channel of resident frame
+  if ((image_index < 0) || (image_index >= nentries)) return NULL;
+  if ((derived_channel_index < 0) || (derived_channel_index >= nderived_channels)) return NULL;
+  const RGBDFrameCacheEntry& entry = entries[image_index];
+  if (entry.status != RGBD_FRAME_LOADED) return NULL;
+  if (!entry.derived_channels) return NULL;
+  return &entry.derived_channels[derived_channel_index];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Frame loading functions
+////////////////////////////////////////////////////////////////////////
+
+struct RGBDFrameCachePrefetchData {
+  RGBDFrameCache *cache;
+  const int *image_indices;
+};
+
+
+
+void RGBDFrameCache::
+LoadFrameCallback(int index, int, void *ptr)
+{
+  // Load one frame
+  RGBDFrameCachePrefetchData *data = (RGBDFrameCachePrefetchData *) ptr;
+  data->cache->LoadFrame(data->image_indices[index]);
+}
+
+
+
+int RGBDFrameCache::
+Prefetch(const int *image_indices, int nimages)
+{
+  // Frames from previous prefetches need not be kept any longer
+  for (int i = 0; i < nentries; i++) entries[i].prefetched = FALSE;
+
+  // Gather frames that are not resident yet (and keep the ones that are)
+  int *load_indices = new int [ nimages + 1 ];
+  int nloads = 0;
+  for (int i = 0; i < nimages; i++) {
+    int image_index = image_indices[i];
+    if ((image_index < 0) || (image_index >= nentries)) continue;
+    RGBDFrameCacheEntry& entry = entries[image_index];
+    if (entry.status == RGBD_FRAME_LOADED) { entry.prefetched = TRUE; TouchFrame(image_index); }
+    if (entry.status != RGBD_FRAME_NOT_LOADED) continue;
+    entry.status = RGBD_FRAME_FAILED;
+    load_indices[nloads++] = image_index;
+  }
+  for (int i = 0; i < nloads; i++) entries[load_indices[i]].status = RGBD_FRAME_NOT_LOADED;
+
+  // Invalidate bounding box up front (so that images need not do it concurrently)
+  configuration->InvalidateWorldBBox();
+
+  // Read serially if some image has an opengl texture (which must be deleted in this thread)
+  RNBoolean serial = FALSE;
+  for (int i = 0; i < nloads; i++) {
+    if (configuration->Image(load_indices[i])->opengl_texture_id >= 0) { serial = TRUE; break; }
+  }
+
+  // Limit number of frames loaded to what fits in memory budget
+  int *loads = load_indices;
+  if ((memory_budget > 0) && (nloads > 0)) {
+    // Estimate memory used by one frame (loading one if none is resident)
+    size_t frame_size = 0;
+    for (int i = 0; i < nentries; i++) {
+      if (entries[i].status != RGBD_FRAME_LOADED) continue;
+      if (entries[i].nbytes > frame_size) frame_size = entries[i].nbytes;
+    }
+    if (frame_size == 0) {
+      RGBDFrameCacheEntry& entry = entries[loads[0]];
+      if (LoadFrame(loads[0])) {
+        memory_usage += entry.nbytes;
+        nresident_images++;
+        entry.prefetched = TRUE;
+        TouchFrame(loads[0]);
+        frame_size = entry.nbytes;
+      }
+      loads++;
+      nloads--;
+    }
+
+    // Clamp number of frames to memory not used by acquired or prefetched frames
+    if (frame_size > 0) {
+      size_t kept_size = 0;
+      for (int i = 0; i < nentries; i++) {
+        const RGBDFrameCacheEntry& entry = entries[i];
+        if (entry.status != RGBD_FRAME_LOADED) continue;
+        if ((entry.pin_count > 0) || entry.prefetched) kept_size += entry.nbytes;
+      }
+      size_t free_size = (memory_budget > kept_size) ? memory_budget - kept_size : 0;
+      if ((size_t) nloads > free_size / frame_size) nloads = (int) (free_size / frame_size);
+      EvictFrames(nloads * frame_size);
+    }
+  }
+
+  // Load frames in parallel (each only modifies its own entry and image)
+  RGBDFrameCachePrefetchData data;
+  data.cache = this;
+  data.image_indices = loads;
+  if (serial) for (int i = 0; i < nloads; i++) LoadFrameCallback(i, 0, &data);
+  else RNParallelFor(nloads, LoadFrameCallback, &data);
+
+  // Update cache statistics (in the order requested)
+  for (int i = 0; i < nloads; i++) {
+    RGBDFrameCacheEntry& entry = entries[loads[i]];
+    if (entry.status != RGBD_FRAME_LOADED) continue;
+    memory_usage += entry.nbytes;
+    nresident_images++;
+    entry.prefetched = TRUE;
+    TouchFrame(loads[i]);
+  }
+
+  // Delete temporary memory
+  delete [] load_indices;
+
+  // Release frames if over budget
+  EvictFrames();
+
+  // Return whether all requested frames are resident
+  for (int i = 0; i < nimages; i++) {
+    if (!IsResident(image_indices[i])) return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+void RGBDFrameCache::
+Flush(void)
+{
+  // Release all frames that are not acquired
+  for (int i = 0; i < nentries; i++) {
+    if (entries[i].pin_count > 0) continue;
+    if (entries[i].status == RGBD_FRAME_LOADED) UnloadFrame(i);
+    entries[i].status = RGBD_FRAME_NOT_LOADED;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+void RGBDFrameCache::
+SetMemoryBudget(size_t memory_budget)
+{
+  // Set memory budget in bytes (zero means no limit)
+  this->memory_budget = memory_budget;
+  EvictFrames();
+}
+
+
+
+void RGBDFrameCache::
+SetDerivedChannels(int nchannels, const char **channel_names,
+  RGBDDerivedChannelsCallback callback, void *callback_data)
+{
+  // Release frames computed with previous derived channels
+  Flush();
+
+  // Delete previous channel names
+  for (int i = 0; i < nderived_channels; i++) free(derived_channel_names[i]);
+  if (derived_channel_names) delete [] derived_channel_names;
+  derived_channel_names = NULL;
+
+  // Set derived channels
+  nderived_channels = (callback) ? nchannels : 0;
+  if (nderived_channels > 0) {
+    derived_channel_names = new char * [ nderived_channels ];
+    for (int i = 0; i < nderived_channels; i++) {
+      char buffer[64];
+      if (channel_names && channel_names[i]) derived_channel_names[i] = RNStrdup(channel_names[i]);
+      else { sprintf(buffer, "derived%d", i); derived_channel_names[i] = RNStrdup(buffer); }
+    }
+  }
+
+  // Set callback
+  derived_channels_callback = callback;
+  derived_channels_callback_data = callback_data;
+}
+
+
+
+void RGBDFrameCache::
+SetDerivedChannelDirectory(const char *directory)
+{
+  // Set directory in which derived channels are cached
+  if (derived_channel_directory) free(derived_channel_directory);
+  if (directory) derived_channel_directory = RNStrdup(directory);
+  else derived_channel_directory = NULL;
+}
+
+
+
+void RGBDFrameCache::
+SetDerivedChannelParameters(const char *parameters)
+{
+  // Set description of parameters used to compute derived channels
+  if (derived_channel_parameters) free(derived_channel_parameters);
+  if (parameters) derived_channel_parameters = RNStrdup(parameters);
+  else derived_channel_parameters = NULL;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Internal functions
+////////////////////////////////////////////////////////////////////////
+
+static size_t
+ChannelMemoryUsage(const R2Grid *grid)
+{
+  // Return bytes used by grid values
+  if (!grid) return 0;
+  return (size_t) grid->NEntries() * sizeof(RNScalar);
+}
+
+
+
+static void
+ReleaseImageChannels(RGBDImage *image, int read_flags)
+{
+  // Release channels that were read
+  if (read_flags & RGBD_READ_COLOR_CHANNELS) image->ReleaseColorChannels();
+  if (read_flags & RGBD_READ_DEPTH_CHANNEL) image->ReleaseDepthChannel();
+  if (read_flags & RGBD_READ_CATEGORY_CHANNEL) image->ReleaseCategoryChannel();
+  if (read_flags & RGBD_READ_INSTANCE_CHANNEL) image->ReleaseInstanceChannel();
+}
+
+
+
+int RGBDFrameCache::
+LoadFrame(int image_index)
+{
+  // Get entry and image (this is called in parallel for different frames)
+  RGBDFrameCacheEntry& entry = entries[image_index];
+  if (entry.status != RGBD_FRAME_NOT_LOADED) return (entry.status == RGBD_FRAME_LOADED);
+  RGBDImage *image = configuration->Image(image_index);
+
+  // Read channels
+  entry.read_flags = 0;
+  int status = 1;
+  if (status && (channel_flags & RGBD_READ_COLOR_CHANNELS)) {
+    if (image->ReadColorChannels()) entry.read_flags |= RGBD_READ_COLOR_CHANNELS;
+    else status = 0;
+  }
+  if (status && (channel_flags & RGBD_READ_DEPTH_CHANNEL)) {
+    if (image->ReadDepthChannel()) entry.read_flags |= RGBD_READ_DEPTH_CHANNEL;
+    else status = 0;
+  }
+  if (status && (channel_flags & RGBD_READ_CATEGORY_CHANNEL)) {
+    if (image->ReadCategoryChannel()) entry.read_flags |= RGBD_READ_CATEGORY_CHANNEL;
+    else status = 0;
+  }
+  if (status && (channel_flags & RGBD_READ_INSTANCE_CHANNEL)) {
+    if (image->ReadInstanceChannel()) entry.read_flags |= RGBD_READ_INSTANCE_CHANNEL;
+    else status = 0;
+  }
+
+  // Read or compute derived channels
+  if (status && (nderived_channels > 0)) {
+    entry.derived_channels = new R2Grid [ nderived_channels ];
+    if (!ReadDerivedChannels(image_index)) {
+      if ((*derived_channels_callback)(image, entry.derived_channels, derived_channels_callback_data)) {
+        if (derived_channel_directory) WriteDerivedChannels(image_index);
+      }
+      else {
+        RNFail("Unable to compute derived channels for image %d\n", image_index);
+        status = 0;
+      }
+    }
+  }
+
+  // Check status
+  if (!status) {
+    ReleaseImageChannels(image, entry.read_flags);
+    if (entry.derived_channels) delete [] entry.derived_channels;
+    entry.derived_channels = NULL;
+    entry.read_flags = 0;
+    entry.status = RGBD_FRAME_FAILED;
+    return 0;
+  }
+
+  // Compute memory usage
+  entry.nbytes = 0;
+  if (entry.read_flags & RGBD_READ_COLOR_CHANNELS) {
+    entry.nbytes += ChannelMemoryUsage(image->RedChannel());
+    entry.nbytes += ChannelMemoryUsage(image->GreenChannel());
+    entry.nbytes += ChannelMemoryUsage(image->BlueChannel());
+  }
+  if (entry.read_flags & RGBD_READ_DEPTH_CHANNEL) entry.nbytes += ChannelMemoryUsage(image->DepthChannel());
+  if (entry.read_flags & RGBD_READ_CATEGORY_CHANNEL) entry.nbytes += ChannelMemoryUsage(image->CategoryChannel());
+  if (entry.read_flags & RGBD_READ_INSTANCE_CHANNEL) entry.nbytes += ChannelMemoryUsage(image->InstanceChannel());
+  for (int i = 0; i < nderived_channels; i++) {
+    entry.nbytes += ChannelMemoryUsage(&entry.derived_channels[i]);
+  }
+
+  // Mark frame as loaded
+  entry.status = RGBD_FRAME_LOADED;
+
+  // Return success
+  return 1;
+}
+
+
+
+static unsigned long long
+HashBytes(unsigned long long hash, const void *bytes, size_t nbytes)
+{
+  // Update FNV-1a hash with bytes
+  const unsigned char *p = (const unsigned char *) bytes;
+  for (size_t i = 0; i < nbytes; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+
+
+static void
+DerivedChannelFilename(char *filename, const char *directory,
+  RGBDImage *image, int image_index, const char *parameters, const char *channel_name)
+{
+  // Compute key of everything derived channels depend on
+  unsigned long long key = 14695981039346656037ULL;
+  int resolution[2] = { image->NPixels(RN_X), image->NPixels(RN_Y) };
+  key = HashBytes(key, resolution, sizeof(resolution));
+  R4Matrix camera_to_world = image->CameraToWorld().Matrix();
+  for (int i = 0; i < 4; i++) key = HashBytes(key, camera_to_world[i], 4 * sizeof(RNScalar));
+  const R3Matrix& intrinsics = image->Intrinsics();
+  for (int i = 0; i < 3; i++) key = HashBytes(key, intrinsics[i], 3 * sizeof(RNScalar));
+  if (parameters) key = HashBytes(key, parameters, strlen(parameters));
+
+  // Build name of file in which derived channel is cached
+  if (image->Name()) sprintf(filename, "%s/%s_%016llx_%s.pfm", directory, image->Name(), key, channel_name);
+  else sprintf(filename, "%s/%06d_%016llx_%s.pfm", directory, image_index, key, channel_name);
+}
+
+
+
+int RGBDFrameCache::
+ReadDerivedChannels(int image_index)
+{
+  // Check directory
+  if (!derived_channel_directory) return 0;
+  RGBDImage *image = configuration->Image(image_index);
+  R2Grid *derived_channels = entries[image_index].derived_channels;
+
+  // Check if all files exist
+  char filename[4096];
+  for (int i = 0; i < nderived_channels; i++) {
+    DerivedChannelFilename(filename, derived_channel_directory, image, image_index,
+      derived_channel_parameters, derived_channel_names[i]);
+    if (!RNFileExists(filename)) return 0;
+  }
+
+  // Read files
+  for (int i = 0; i < nderived_channels; i++) {
+    DerivedChannelFilename(filename, derived_channel_directory, image, image_index,
+      derived_channel_parameters, derived_channel_names[i]);
+    if (!derived_channels[i].ReadFile(filename)) return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDFrameCache::
+WriteDerivedChannels(int image_index) const
+{
+  // Check directory
+  if (!derived_channel_directory) return 0;
+  RGBDImage *image = configuration->Image(image_index);
+  const R2Grid *derived_channels = entries[image_index].derived_channels;
+
+  // Write files
+  char filename[4096];
+  for (int i = 0; i < nderived_channels; i++) {
+    DerivedChannelFilename(filename, derived_channel_directory, image, image_index,
+      derived_channel_parameters, derived_channel_names[i]);
+    if (!derived_channels[i].WriteFile(filename)) return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+void RGBDFrameCache::
+UnloadFrame(int image_index)
+{
+  // Release channels
+  RGBDFrameCacheEntry& entry = entries[image_index];
+  assert(entry.status == RGBD_FRAME_LOADED);
+  ReleaseImageChannels(configuration->Image(image_index), entry.read_flags);
+  if (entry.derived_channels) delete [] entry.derived_channels;
+  entry.derived_channels = NULL;
+  entry.prefetched = FALSE;
+  entry.read_flags = 0;
+
+  // Update cache statistics
+  memory_usage -= entry.nbytes;
+  nresident_images--;
+  entry.nbytes = 0;
+  entry.status = RGBD_FRAME_NOT_LOADED;
+}
+
+
+
+void RGBDFrameCache::
+TouchFrame(int image_index)
+{
+  // Mark frame as most recently used
+  entries[image_index].last_use = ++use_counter;
+}
+
+
+
+void RGBDFrameCache::
+EvictFrames(size_t reserved_bytes)
+{
+  // Check memory budget
+  if (memory_budget == 0) return;
+
+  // Release least recently used frames until within budget (leaving room for reserved bytes)
+  while (memory_usage + reserved_bytes > memory_budget) {
+    int lru_index = -1;
+    for (int i = 0; i < nentries; i++) {
+      const RGBDFrameCacheEntry& entry = entries[i];
+      if (entry.status != RGBD_FRAME_LOADED) continue;
+      if (entry.pin_count > 0) continue;
+      if (entry.prefetched) continue;
+      if ((lru_index < 0) || (entry.last_use < entries[lru_index].last_use)) lru_index = i;
+    }
+    if (lru_index < 0) break;
+    UnloadFrame(lru_index);
+  }
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,194 @@
+////////////////////////////////////////////////////////////////////////
+// Include file for RGBDFrameCache class
+////////////////////////////////////////////////////////////////////////
+
+#ifndef __RGBD__FRAME__CACHE__H__
+#define __RGBD__FRAME__CACHE__H__
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Type definitions
+////////////////////////////////////////////////////////////////////////
+
+// Computes derived channels (e.g., positions or normals) for an image
+// whose channels have been read.  It is called from several threads at
+// once (for different images), so it must not modify shared state.
+typedef int (*RGBDDerivedChannelsCallback)(RGBDImage *image, R2Grid *derived_channels, void *data);
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Class definition
+////////////////////////////////////////////////////////////////////////
+
+class RGBDFrameCache {
+public:
+  // Constructors/destructors
+  RGBDFrameCache(RGBDConfiguration *configuration,
+    int channel_flags = RGBD_READ_COLOR_CHANNELS | RGBD_READ_DEPTH_CHANNEL,
+    size_t memory_budget = 0);
+  ~RGBDFrameCache(void);
+
+  // Property functions
+  RGBDConfiguration *Configuration(void) const;
+  int ChannelFlags(void) const;
+  size_t MemoryBudget(void) const;
+  size_t MemoryUsage(void) const;
+  int NResidentImages(void) const;
+  int NDerivedChannels(void) const;
+  const char *DerivedChannelDirectory(void) const;
+  const char *DerivedChannelParameters(void) const;
+
+  // Frame access functions
+  RNBoolean IsResident(int image_index) const;
+  RGBDImage *AcquireImage(int image_index);
+  void ReleaseImage(int image_index);
+  const R2Grid *DerivedChannel(int image_index, int derived_channel_index) const;
+
+  // Frame loading functions (prefetch reads images in parallel, as many as fit in the
+  // memory budget, and keeps them resident until they are acquired or the next prefetch)
+  int Prefetch(const int *image_indices, int nimages);
+  int Prefetch(int first_image_index, int nimages);
+  void Flush(void);
+
+  // Manipulation functions
+  void SetMemoryBudget(size_t memory_budget);
+  void SetDerivedChannels(int nchannels, const char **channel_names,
+    RGBDDerivedChannelsCallback callback, void *callback_data = NULL);
+  void SetDerivedChannelDirectory(const char *directory);
+  void SetDerivedChannelParameters(const char *parameters);
+
+private:
+  // Internal functions
+  static void LoadFrameCallback(int index, int thread_index, void *data);
+  int LoadFrame(int image_index);
+  int ReadDerivedChannels(int image_index);
+  int WriteDerivedChannels(int image_index) const;
+  void UnloadFrame(int image_index);
+  void TouchFrame(int image_index);
+  void EvictFrames(size_t reserved_bytes = 0);
+
+private:
+  // Internal variables
+  RGBDConfiguration *configuration;
+  struct RGBDFrameCacheEntry *entries;
+  int nentries;
+  int channel_flags;
+  size_t memory_budget;
+  size_t memory_usage;
+  int nresident_images;
+  unsigned long long use_counter;
+  int nderived_channels;
+  char **derived_channel_names;
+  RGBDDerivedChannelsCallback derived_channels_callback;
+  void *derived_channels_callback_data;
+  char *derived_channel_directory;
+  char *derived_channel_parameters;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Inline functions
+////////////////////////////////////////////////////////////////////////
+
+inline RGBDConfiguration *RGBDFrameCache::
+Configuration(void) const
+{
+  // Return configuration
+  return configuration;
+}
+
+
+
+inline int RGBDFrameCache::
+ChannelFlags(void) const
+{
+  // Return which channels are read for every frame
+  return channel_flags;
+}
+
+
+
+inline size_t RGBDFrameCache::
+MemoryBudget(void) const
+{
+  // Return memory budget in bytes (zero means no limit)
+  return memory_budget;
+}
+
+
+
+inline size_t RGBDFrameCache::
+MemoryUsage(void) const
+{
+  // Return bytes used by resident frames
+  return memory_usage;
+}
+
+
+
+inline int RGBDFrameCache::
+NResidentImages(void) const
+{
+  // Return number of resident frames
+  return nresident_images;
+}
+
+
+
+inline int RGBDFrameCache::
+NDerivedChannels(void) const
+{
+  // Return number of derived channels computed for every frame
+  return nderived_channels;
+}
+
+
+
+inline const char *RGBDFrameCache::
+DerivedChannelDirectory(void) const
+{
+  // Return directory in which derived channels are cached
+  return derived_channel_directory;
+}
+
+
+
+inline const char *RGBDFrameCache::
+DerivedChannelParameters(void) const
+{
+  // Return description of parameters used to compute derived channels
+  return derived_channel_parameters;
+}
+
+
+
+inline int RGBDFrameCache::
+Prefetch(int first_image_index, int nimages)
+{
+  // Prefetch consecutive images
+  int *image_indices = new int [ nimages ];
+  for (int i = 0; i < nimages; i++) image_indices[i] = first_image_index + i;
+  int status = Prefetch(image_indices, nimages);
+  delete [] image_indices;
+  return status;
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
@@ -29,6 +29,7 @@ RGBDImage(void)
   : configuration(NULL),
     configuration_index(-1),
     channels(),
+    compact_channels(),
     width(0), height(0),
     camera_to_world(R4Matrix(1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1), 0),
     intrinsics(1,0,0, 0,1,0, 0,0,1),
@@ -57,6 +58,7 @@ RGBDImage(const char *color_filename, const char *depth_filename,
   : configuration(NULL),
     configuration_index(-1),
     channels(),
+    compact_channels(),
     width(width), height(height),
     camera_to_world(camera_to_world_matrix, 0),
     intrinsics(intrinsics_matrix),
@@ -100,6 +102,11 @@ RGBDImage::
     if (channels[i]) delete channels[i];
   }
 
+  // Delete compact copies of channels
+  for (int i = 0; i < compact_channels.NEntries(); i++) {
+    if (compact_channels[i]) delete compact_channels[i];
+  }
+
   // Delete filenames
   if (name) free(name);
   if (color_filename) free(color_filename);
@@ -454,13 +461,27 @@ SetColorChannels(const R2Image& image)
     return;
   }
 
-  // Copy color values
+  // Build table mapping bytes to color values (same as PixelRGB)
+  RNScalar byte_to_value[256];
+  for (int i = 0; i < 256; i++) byte_to_value[i] = i / 255.0;
+
+  // Copy color values directly from pixel rows into channel values
+  int ncomponents = image.NComponents();
+  int rgb_offset = (ncomponents >= 3) ? 1 : 0;
+  RNScalar *red_values = (RNScalar *) channels[RGBD_RED_CHANNEL]->GridValues();
+  RNScalar *green_values = (RNScalar *) channels[RGBD_GREEN_CHANNEL]->GridValues();
+  RNScalar *blue_values = (RNScalar *) channels[RGBD_BLUE_CHANNEL]->GridValues();
+  int row_size = channels[RGBD_RED_CHANNEL]->XResolution();
   for (int iy = 0; iy < image.Height(); iy++) {
+    const unsigned char *p = image.Pixels(iy);
+    RNScalar *r = &red_values[iy * row_size];
+    RNScalar *g = &green_values[iy * row_size];
+    RNScalar *b = &blue_values[iy * row_size];
     for (int ix = 0; ix < image.Width(); ix++) {
-      RNRgb color = image.PixelRGB(ix, iy);
-      channels[RGBD_RED_CHANNEL]->SetGridValue(ix, iy, color.R());      
-      channels[RGBD_GREEN_CHANNEL]->SetGridValue(ix, iy, color.G());      
-      channels[RGBD_BLUE_CHANNEL]->SetGridValue(ix, iy, color.B());
+      r[ix] = byte_to_value[p[0]];
+      g[ix] = byte_to_value[p[rgb_offset]];
+      b[ix] = byte_to_value[p[2*rgb_offset]];
+      p += ncomponents;
     }
   }
 
@@ -1280,19 +1301,31 @@ ReadColorChannels(void)
     return 1;
   }
 
+  // Restore from compact copies if available
+  if (RestoreCompactChannel(RGBD_RED_CHANNEL) &&
+      RestoreCompactChannel(RGBD_GREEN_CHANNEL) &&
+      RestoreCompactChannel(RGBD_BLUE_CHANNEL)) return 1;
+
   // Initialize image
   R2Image color_image(width, height, 3);
 
   // Check filename
   if (color_filename) {
-    // Get full filename
-    char full_filename[4096];
-    const char *dirname = (configuration) ? configuration->ColorDirectory() : NULL;
-    if (dirname) sprintf(full_filename, "%s/%s", dirname, color_filename);
-    else sprintf(full_filename, "%s", color_filename);
-
-    // Read color image
-    if (!color_image.Read(full_filename)) return 0;
+    R2PixelDatabase *database = (configuration) ? configuration->ColorPixelDatabase() : NULL;
+    if (database) {
+      // Read color image from pixel database
+      if (!database->FindImage(color_filename, &color_image)) return 0;
+    }
+    else {
+      // Get full filename
+      char full_filename[4096];
+      const char *dirname = (configuration) ? configuration->ColorDirectory() : NULL;
+      if (dirname) sprintf(full_filename, "%s/%s", dirname, color_filename);
+      else sprintf(full_filename, "%s", color_filename);
+
+      // Read color image
+      if (!color_image.Read(full_filename)) return 0;
+    }
 
     // Resize color image if necessary
     if ((width > 0) && (height > 0) &&
@@ -1317,19 +1350,29 @@ ReadDepthChannel(void)
     return 1;
   }
 
+  // Restore from compact copy if available
+  if (RestoreCompactChannel(RGBD_DEPTH_CHANNEL)) return 1;
+
   // Initialize image
   R2Grid depth_image(width, height);
 
   // Check filename
   if (depth_filename) {
-    // Get full filename
-    char full_filename[4096];
-    const char *dirname = (configuration) ? configuration->DepthDirectory() : NULL;
-    if (dirname) sprintf(full_filename, "%s/%s", dirname, depth_filename);
-    else sprintf(full_filename, "%s", depth_filename);
-
-    // Read depth image
-    if (!depth_image.ReadFile(full_filename)) return 0;
+    R2PixelDatabase *database = (configuration) ? configuration->DepthPixelDatabase() : NULL;
+    if (database) {
+      // Read depth image from pixel database
+      if (!database->FindGrid(depth_filename, &depth_image)) return 0;
+    }
+    else {
+      // Get full filename
+      char full_filename[4096];
+      const char *dirname = (configuration) ? configuration->DepthDirectory() : NULL;
+      if (dirname) sprintf(full_filename, "%s/%s", dirname, depth_filename);
+      else sprintf(full_filename, "%s", depth_filename);
+
+      // Read depth image
+      if (!depth_image.ReadFile(full_filename)) return 0;
+    }
 
     // Shift 3 bits (to compensate for shift done by SUNRGBD capture)
     if (configuration && configuration->DatasetFormat()) {
@@ -1416,6 +1459,9 @@ ReadCategoryChannel(void)
     return 1;
   }
 
+  // Restore from compact copy if available
+  if (RestoreCompactChannel(RGBD_CATEGORY_CHANNEL)) return 1;
+
   // Initialize image
   R2Grid category_image(width, height);
 
@@ -1446,6 +1492,9 @@ ReadInstanceChannel(void)
     return 1;
   }
 
+  // Restore from compact copy if available
+  if (RestoreCompactChannel(RGBD_INSTANCE_CHANNEL)) return 1;
+
   // Initialize image
   R2Grid instance_image(width, height);
 
@@ -1617,6 +1666,7 @@ ReleaseColorChannels(void)
   for (int channel_index = RGBD_RED_CHANNEL; channel_index <= RGBD_BLUE_CHANNEL; channel_index++) {
     if (NChannels() <= channel_index) break;
     if (!channels[channel_index]) continue;
+    StoreCompactChannel(channel_index);
     delete channels[channel_index];
     channels[channel_index] = NULL;
   }
@@ -1639,6 +1689,7 @@ ReleaseDepthChannel(void)
   // Delete depth channel
   if (NChannels() <= RGBD_DEPTH_CHANNEL) return 0;
   if (!channels[RGBD_DEPTH_CHANNEL]) return 0;
+  StoreCompactChannel(RGBD_DEPTH_CHANNEL);
   delete channels[RGBD_DEPTH_CHANNEL];
   channels[RGBD_DEPTH_CHANNEL] = NULL;
 
@@ -1660,6 +1711,7 @@ ReleaseCategoryChannel(void)
   // Delete category channel
   if (NChannels() <= RGBD_CATEGORY_CHANNEL) return 0;
   if (!channels[RGBD_CATEGORY_CHANNEL]) return 0;
+  StoreCompactChannel(RGBD_CATEGORY_CHANNEL);
   delete channels[RGBD_CATEGORY_CHANNEL];
   channels[RGBD_CATEGORY_CHANNEL] = NULL;
 
@@ -1681,6 +1733,7 @@ ReleaseInstanceChannel(void)
   // Delete instance channel
   if (NChannels() <= RGBD_INSTANCE_CHANNEL) return 0;
   if (!channels[RGBD_INSTANCE_CHANNEL]) return 0;
+  StoreCompactChannel(RGBD_INSTANCE_CHANNEL);
   delete channels[RGBD_INSTANCE_CHANNEL];
   channels[RGBD_INSTANCE_CHANNEL] = NULL;
 
@@ -1709,6 +1762,11 @@ SetColorFilename(const char *filename)
   if (filename && strcmp(filename, "-")) color_filename = RNStrdup(filename);
   else color_filename = NULL;
 
+  // Delete compact copies of previous file
+  DeleteCompactChannel(RGBD_RED_CHANNEL);
+  DeleteCompactChannel(RGBD_GREEN_CHANNEL);
+  DeleteCompactChannel(RGBD_BLUE_CHANNEL);
+
   // Set name
   if (!name && filename) {
     char buffer[1024];
@@ -1732,6 +1790,9 @@ SetDepthFilename(const char *filename)
   if (filename && strcmp(filename, "-")) depth_filename = RNStrdup(filename);
   else depth_filename = NULL;
 
+  // Delete compact copy of previous file
+  DeleteCompactChannel(RGBD_DEPTH_CHANNEL);
+
   // Set name
   if (!name && filename && strcmp(filename, "-")) {
     char buffer[1024];
@@ -1755,6 +1816,9 @@ SetCategoryFilename(const char *filename)
   if (filename && strcmp(filename, "-")) category_filename = RNStrdup(filename);
   else category_filename = NULL;
 
+  // Delete compact copy of previous file
+  DeleteCompactChannel(RGBD_CATEGORY_CHANNEL);
+
   // Set name
   if (!name && filename && strcmp(filename, "-")) {
     char buffer[1024];
@@ -1777,6 +1841,9 @@ SetInstanceFilename(const char *filename)
   if (filename && strcmp(filename, "-")) instance_filename = RNStrdup(filename);
   else instance_filename = NULL;
 
+  // Delete compact copy of previous file
+  DeleteCompactChannel(RGBD_INSTANCE_CHANNEL);
+
   // Set name
   if (!name && filename) {
     char buffer[1024];
@@ -1791,6 +1858,86 @@ SetInstanceFilename(const char *filename)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Compact channel cache functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+CompactChannelValueType(const R2Grid& grid, RNScalar value_scale, int max_code)
+{
+  // Use integer codes only if every value is representable exactly
+  const RNScalar *values = grid.GridValues();
+  for (int i = 0; i < grid.NEntries(); i++) {
+    RNScalar code = values[i] / value_scale;
+    if ((code < 0) || (code > max_code)) return RN_GRID_FLOAT32_VALUE_TYPE;
+    if (RNIsNotEqual(code, floor(code + 0.5), 1E-6)) return RN_GRID_FLOAT32_VALUE_TYPE;
+  }
+
+  // Return smallest integer type
+  return (max_code == 255) ? RN_GRID_UINT8_VALUE_TYPE : RN_GRID_UINT16_VALUE_TYPE;
+}
+
+
+
+int RGBDImage::
+RestoreCompactChannel(int channel_index)
+{
+  // Check compact copy
+  if (channel_index >= compact_channels.NEntries()) return 0;
+  R2CompactGrid *compact_channel = compact_channels[channel_index];
+  if (!compact_channel) return 0;
+
+  // Decode channel
+  R2Grid image;
+  compact_channel->GetGrid(image);
+
+  // Create channel
+  return CreateChannel(channel_index, image);
+}
+
+
+
+void RGBDImage::
+StoreCompactChannel(int channel_index)
+{
+  // Check configuration
+  if (!configuration || !configuration->CompactChannelCache()) return;
+  if (channel_index >= channels.NEntries()) return;
+  R2Grid *channel = channels[channel_index];
+  if (!channel) return;
+
+  // Choose value encoding (color values are usually k/255, labels are small integers)
+  int value_type = RN_GRID_FLOAT32_VALUE_TYPE;
+  RNScalar value_scale = 1;
+  if (channel_index <= RGBD_BLUE_CHANNEL) {
+    value_scale = 1.0 / 255.0;
+    value_type = CompactChannelValueType(*channel, value_scale, 255);
+    if (value_type == RN_GRID_FLOAT32_VALUE_TYPE) value_scale = 1;
+  }
+  else if ((channel_index == RGBD_CATEGORY_CHANNEL) || (channel_index == RGBD_INSTANCE_CHANNEL)) {
+    value_type = CompactChannelValueType(*channel, value_scale, 65535);
+  }
+
+  // Store compact copy of channel
+  while (compact_channels.NEntries() <= channel_index) compact_channels.Insert(NULL);
+  if (!compact_channels[channel_index]) compact_channels[channel_index] = new R2CompactGrid();
+  compact_channels[channel_index]->SetGrid(*channel, value_type, value_scale);
+}
+
+
+
+void RGBDImage::
+DeleteCompactChannel(int channel_index)
+{
+  // Delete compact copy of channel
+  if (channel_index >= compact_channels.NEntries()) return;
+  if (!compact_channels[channel_index]) return;
+  delete compact_channels[channel_index];
+  compact_channels[channel_index] = NULL;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Update functions
 ////////////////////////////////////////////////////////////////////////
@@ -1881,6 +2028,14 @@ ComputeMesh(R3Mesh& mesh, RNLength max_depth, RNLength max_silhouette_factor)
   R2Grid boundary_image(NPixels(RN_X), NPixels(RN_Y));
   if (!RGBDCreateBoundaryChannel(this, boundary_image, max_silhouette_factor)) return 0;
   boundary_image.Substitute(R2_GRID_UNKNOWN_VALUE, 0);
+
+  // Compute world positions of all pixels (at pixel corners, as in PixelWorldPosition)
+  R2Grid px_image, py_image, pz_image;
+  R3Matrix corner_intrinsics = Intrinsics();
+  corner_intrinsics[0][2] += 0.5;
+  corner_intrinsics[1][2] += 0.5;
+  if (!RGBDCreatePositionChannels(*(DepthChannel()), px_image, py_image, pz_image,
+    corner_intrinsics, CameraToWorld().Matrix())) return 0;
          
   // Create vertices
   for (int j = 0; j < NPixels(RN_Y); j++) {
@@ -1897,7 +2052,7 @@ ComputeMesh(R3Mesh& mesh, RNLength max_depth, RNLength max_silhouette_factor)
       // if (b) continue; 
       
       // Compute vertex info
-      R3Point position = PixelWorldPosition(i, j);
+      R3Point position(px_image.GridValue(i, j), py_image.GridValue(i, j), pz_image.GridValue(i, j));
       RNRgb color = PixelColor(i, j);
       R2Point texcoords(i, j);
 
@@ -167,12 +167,20 @@ public:
   void *UserData(void) const;
   void SetUserData(void *data);
 
+private:
+  // Compact channel cache functions
+  int RestoreCompactChannel(int channel_index);
+  void StoreCompactChannel(int channel_index);
+  void DeleteCompactChannel(int channel_index);
+
 private:
   // Internal variables
   friend class RGBDConfiguration;
+  friend class RGBDFrameCache;
   RGBDConfiguration *configuration;
   int configuration_index;
   RNArray<R2Grid *> channels;
+  RNArray<R2CompactGrid *> compact_channels;
   int width, height;
   R3Affine camera_to_world;
   R3Matrix intrinsics;
@@ -80,31 +80,12 @@ int RGBDCreatePositionChannels(
   output_py_image = output_px_image;
   output_pz_image = output_px_image;
 
-  // Fill position images
-  for (int i = 0; i < input_undistorted_depth_image.XResolution(); i++) {
-    for (int j = 0; j < input_undistorted_depth_image.YResolution(); j++) {
-      // Get depth
-      RNScalar depth = input_undistorted_depth_image.GridValue(i, j);
-      if (RNIsNegativeOrZero(depth)) continue;
-
-      // Get position in camera coordinate system 
-      RNScalar x = ((i+0.5) - intrinsics_matrix[0][2]) * depth / intrinsics_matrix[0][0];
-      RNScalar y = ((j+0.5) - intrinsics_matrix[1][2]) * depth / intrinsics_matrix[1][1];
-      RNScalar z = -depth;
-      R3Point position(x, y, z);
-
-      // Transform by extrinsics matrix
-      position = camera_to_world_matrix * position;
-
-      // Fill position images
-      output_px_image.SetGridValue(i, j, position.X());
-      output_py_image.SetGridValue(i, j, position.Y());
-      output_pz_image.SetGridValue(i, j, position.Z());
-    }
-  }
-
-  // Return success 
-  return 1;
+  // Fill position images (one row at a time)
+  return RGBDBackProjectDepthValues(input_undistorted_depth_image.GridValues(),
+    input_undistorted_depth_image.XResolution(), input_undistorted_depth_image.YResolution(),
+    intrinsics_matrix, camera_to_world_matrix,
+    (RNScalar *) output_px_image.GridValues(), (RNScalar *) output_py_image.GridValues(),
+    (RNScalar *) output_pz_image.GridValues());
 }
 
 
@@ -426,6 +407,413 @@ int RGBDCreateTangentChannels(const R2Grid& input_depth_image,
 
 
 
+int RGBDCreateIntegralImageNormalChannels(const R2Grid& input_depth_image,
+  const R2Grid& input_px_image, const R2Grid& input_py_image, const R2Grid& input_pz_image,
+  R2Grid& output_nx_image, R2Grid& output_ny_image, R2Grid& output_nz_image,
+  const R3Point& viewpoint, int neighborhood_pixel_radius)
+{
+  // Initialize normal images
+  output_nx_image = input_depth_image;
+  output_nx_image.Clear(R2_GRID_UNKNOWN_VALUE);
+  output_ny_image = output_nx_image;
+  output_nz_image = output_nx_image;
+
+  // Compute pixel radius (scaled relative to 640 pixels wide)
+  int pixel_radius = neighborhood_pixel_radius * input_depth_image.XResolution() / 640.0 + 0.5;
+  if (pixel_radius == 0) pixel_radius = 1;
+
+  // Fill normal images
+  return RGBDEstimateIntegralImageNormals(
+    input_px_image.GridValues(), input_py_image.GridValues(), input_pz_image.GridValues(),
+    input_depth_image.XResolution(), input_depth_image.YResolution(), viewpoint, pixel_radius,
+    (RNScalar *) output_nx_image.GridValues(), (RNScalar *) output_ny_image.GridValues(),
+    (RNScalar *) output_nz_image.GridValues());
+}
+
+
+
+int RGBDCreateIntegralImageTangentChannels(const R2Grid& input_depth_image,
+  const R2Grid& input_px_image, const R2Grid& input_py_image, const R2Grid& input_pz_image,
+  R2Grid& output_nx_image, R2Grid& output_ny_image, R2Grid& output_nz_image,
+  R2Grid& output_tx_image, R2Grid& output_ty_image, R2Grid& output_tz_image,
+  R2Grid& output_r1_image, R2Grid& output_r2_image,
+  const R3Point& viewpoint, int neighborhood_pixel_radius)
+{
+  // Initialize normal, tangent, and radius images
+  output_nx_image = input_depth_image;
+  output_nx_image.Clear(R2_GRID_UNKNOWN_VALUE);
+  output_ny_image = output_nx_image;
+  output_nz_image = output_nx_image;
+  output_tx_image = output_nx_image;
+  output_ty_image = output_nx_image;
+  output_tz_image = output_nx_image;
+  output_r1_image = output_nx_image;
+  output_r2_image = output_nx_image;
+
+  // Compute pixel radius (scaled relative to 640 pixels wide)
+  int pixel_radius = neighborhood_pixel_radius * input_depth_image.XResolution() / 640.0 + 0.5;
+  if (pixel_radius == 0) pixel_radius = 1;
+
+  // Fill normal, tangent, and radius images
+  if (!RGBDEstimateIntegralImageNormals(
+    input_px_image.GridValues(), input_py_image.GridValues(), input_pz_image.GridValues(),
+    input_depth_image.XResolution(), input_depth_image.YResolution(), viewpoint, pixel_radius,
+    (RNScalar *) output_nx_image.GridValues(), (RNScalar *) output_ny_image.GridValues(),
+    (RNScalar *) output_nz_image.GridValues(), (RNScalar *) output_tx_image.GridValues(),
+    (RNScalar *) output_ty_image.GridValues(), (RNScalar *) output_tz_image.GridValues(),
+    (RNScalar *) output_r1_image.GridValues(), (RNScalar *) output_r2_image.GridValues())) return 0;
+
+  // Scale radius images (as in RGBDCreateTangentChannels)
+  if (neighborhood_pixel_radius > 1) {
+    RNScalar *r1_values = (RNScalar *) output_r1_image.GridValues();
+    RNScalar *r2_values = (RNScalar *) output_r2_image.GridValues();
+    for (int i = 0; i < output_r1_image.NEntries(); i++) {
+      if (r1_values[i] != R2_GRID_UNKNOWN_VALUE) r1_values[i] /= neighborhood_pixel_radius;
+      if (r2_values[i] != R2_GRID_UNKNOWN_VALUE) r2_values[i] /= neighborhood_pixel_radius;
+    }
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// LOW-LEVEL BATCHED BACK-PROJECTION AND NORMAL ESTIMATION FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+// NOTE:
+// These functions process images one row at a time (rows in parallel)
+// with inner loops over raw arrays that the compiler can vectorize.
+// Normals are estimated from the covariance of positions in a square
+// window around each pixel, which is computed in constant time per
+// pixel from integral images of first and second order moments.
+// Unlike the neighborhood search in RGBDCreateTangentChannels, windows
+// are not clipped at depth discontinuities.
+
+struct RGBDBackProjectionData {
+  const RNScalar *depths;
+  int width, height;
+  const RNScalar *column_offsets;
+  RNScalar fx, fy, cy;
+  R4Matrix camera_to_world;
+  RNScalar *px, *py, *pz;
+};
+
+
+
+static void
+BackProjectDepthRow(int iy, int, void *data)
+{
+  // Get convenient variables
+  RGBDBackProjectionData *projection = (RGBDBackProjectionData *) data;
+  const R4Matrix& m = projection->camera_to_world;
+  const RNScalar *column_offsets = projection->column_offsets;
+  const RNScalar *depths = &projection->depths[iy * projection->width];
+  RNScalar *px = &projection->px[iy * projection->width];
+  RNScalar *py = &projection->py[iy * projection->width];
+  RNScalar *pz = &projection->pz[iy * projection->width];
+  RNScalar row_offset = (iy + 0.5) - projection->cy;
+  RNScalar fx = projection->fx, fy = projection->fy;
+
+  // Compute positions of pixels in row (same arithmetic as per-pixel transforms)
+  for (int ix = 0; ix < projection->width; ix++) {
+    RNScalar depth = depths[ix];
+    RNScalar x = column_offsets[ix] * depth / fx;
+    RNScalar y = row_offset * depth / fy;
+    RNScalar z = -depth;
+    RNScalar wx = m[0][0]*x + m[0][1]*y + m[0][2]*z + m[0][3];
+    RNScalar wy = m[1][0]*x + m[1][1]*y + m[1][2]*z + m[1][3];
+    RNScalar wz = m[2][0]*x + m[2][1]*y + m[2][2]*z + m[2][3];
+    RNBoolean valid = (depth > RN_EPSILON);
+    px[ix] = (valid) ? wx : R2_GRID_UNKNOWN_VALUE;
+    py[ix] = (valid) ? wy : R2_GRID_UNKNOWN_VALUE;
+    pz[ix] = (valid) ? wz : R2_GRID_UNKNOWN_VALUE;
+  }
+}
+
+
+
+int RGBDBackProjectDepthValues(const RNScalar *depths, int width, int height,
+  const R3Matrix& intrinsics_matrix, const R4Matrix& camera_to_world_matrix,
+  RNScalar *px, RNScalar *py, RNScalar *pz)
+{
+  // Check intrinsics
+  if (RNIsZero(intrinsics_matrix[0][0]) || RNIsZero(intrinsics_matrix[1][1])) return 0;
+  if ((width <= 0) || (height <= 0)) return 1;
+
+  // Compute offsets of pixel centers from principal point
+  RNScalar *column_offsets = new RNScalar [ width ];
+  for (int ix = 0; ix < width; ix++) column_offsets[ix] = (ix + 0.5) - intrinsics_matrix[0][2];
+
+  // Back-project rows of pixels in parallel
+  RGBDBackProjectionData projection;
+  projection.depths = depths;
+  projection.width = width;
+  projection.height = height;
+  projection.column_offsets = column_offsets;
+  projection.fx = intrinsics_matrix[0][0];
+  projection.fy = intrinsics_matrix[1][1];
+  projection.cy = intrinsics_matrix[1][2];
+  projection.camera_to_world = camera_to_world_matrix;
+  projection.px = px;
+  projection.py = py;
+  projection.pz = pz;
+  RNParallelFor(height, BackProjectDepthRow, &projection, 16);
+
+  // Delete column offsets
+  delete [] column_offsets;
+
+  // Return success
+  return 1;
+}
+
+
+
+// Number of moments in each entry of integral image (count, first and second order)
+#define RGBD_INTEGRAL_IMAGE_NMOMENTS 10
+
+struct RGBDIntegralImageData {
+  const RNScalar *px, *py, *pz;
+  int width, height;
+  R3Point viewpoint;
+  int pixel_radius;
+  double *integrals;
+  RNScalar *nx, *ny, *nz;
+  RNScalar *tx, *ty, *tz;
+  RNScalar *r1, *r2;
+};
+
+
+
+static void
+AccumulateIntegralImageRow(int iy, int, void *data)
+{
+  // Get convenient variables
+  RGBDIntegralImageData *integral = (RGBDIntegralImageData *) data;
+  const int N = RGBD_INTEGRAL_IMAGE_NMOMENTS;
+  int width = integral->width;
+  const RNScalar *px = &integral->px[iy * width];
+  const RNScalar *py = &integral->py[iy * width];
+  const RNScalar *pz = &integral->pz[iy * width];
+  double *row = &integral->integrals[(size_t) (iy+1) * (width+1) * N];
+
+  // Compute prefix sums of moments along row (relative to viewpoint, for precision)
+  double sums[RGBD_INTEGRAL_IMAGE_NMOMENTS] = { 0 };
+  for (int k = 0; k < N; k++) row[k] = 0;
+  for (int ix = 0; ix < width; ix++) {
+    if (px[ix] != R2_GRID_UNKNOWN_VALUE) {
+      double x = px[ix] - integral->viewpoint[0];
+      double y = py[ix] - integral->viewpoint[1];
+      double z = pz[ix] - integral->viewpoint[2];
+      sums[0] += 1;
+      sums[1] += x; sums[2] += y; sums[3] += z;
+      sums[4] += x*x; sums[5] += x*y; sums[6] += x*z;
+      sums[7] += y*y; sums[8] += y*z; sums[9] += z*z;
+    }
+    double *entry = &row[(ix+1) * N];
+    for (int k = 0; k < N; k++) entry[k] = sums[k];
+  }
+}
+
+
+
+static void
+AccumulateIntegralImageColumns(int index, int, void *data)
+{
+  // Get convenient variables
+  RGBDIntegralImageData *integral = (RGBDIntegralImageData *) data;
+  const int N = RGBD_INTEGRAL_IMAGE_NMOMENTS;
+  size_t row_size = (size_t) (integral->width + 1) * N;
+  size_t start = (size_t) index * 64 * N;
+  size_t end = start + 64 * N;
+  if (end > row_size) end = row_size;
+
+  // Add previous row to each row (for a range of 64 columns)
+  for (int iy = 1; iy <= integral->height; iy++) {
+    double *row = &integral->integrals[iy * row_size];
+    const double *previous_row = row - row_size;
+    for (size_t k = start; k < end; k++) row[k] += previous_row[k];
+  }
+}
+
+
+
+static void
+DecomposeSymmetricMatrix(double a[3][3], double eigenvalues[3], double eigenvectors[3][3])
+{
+  // Initialize eigenvectors (in columns) to identity
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) eigenvectors[i][j] = (i == j) ? 1 : 0;
+  }
+
+  // Apply cyclic Jacobi rotations until off-diagonal entries vanish
+  for (int sweep = 0; sweep < 16; sweep++) {
+    double off = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+    double diagonal = a[0][0]*a[0][0] + a[1][1]*a[1][1] + a[2][2]*a[2][2];
+    if (off <= 1E-24 * diagonal) break;
+    for (int p = 0; p < 2; p++) {
+      for (int q = p+1; q < 3; q++) {
+        if (a[p][q] == 0) continue;
+        double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        double t = ((theta >= 0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1));
+        double c = 1 / sqrt(t*t + 1), s = t * c;
+        for (int k = 0; k < 3; k++) {
+          double akp = a[k][p], akq = a[k][q];
+          a[k][p] = c*akp - s*akq;
+          a[k][q] = s*akp + c*akq;
+        }
+        for (int k = 0; k < 3; k++) {
+          double apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c*apk - s*aqk;
+          a[q][k] = s*apk + c*aqk;
+        }
+        for (int k = 0; k < 3; k++) {
+          double vkp = eigenvectors[k][p], vkq = eigenvectors[k][q];
+          eigenvectors[k][p] = c*vkp - s*vkq;
+          eigenvectors[k][q] = s*vkp + c*vkq;
+        }
+      }
+    }
+  }
+
+  // Return eigenvalues
+  for (int i = 0; i < 3; i++) eigenvalues[i] = a[i][i];
+}
+
+
+
+static void
+EstimateIntegralImageNormalRow(int iy, int, void *data)
+{
+  // Get convenient variables
+  RGBDIntegralImageData *integral = (RGBDIntegralImageData *) data;
+  const int N = RGBD_INTEGRAL_IMAGE_NMOMENTS;
+  int width = integral->width;
+  int height = integral->height;
+  int r = integral->pixel_radius;
+  size_t row_size = (size_t) (width + 1) * N;
+  int y0 = (iy - r > 0) ? iy - r : 0;
+  int y1 = (iy + r + 1 < height) ? iy + r + 1 : height;
+  const double *row0 = &integral->integrals[y0 * row_size];
+  const double *row1 = &integral->integrals[y1 * row_size];
+
+  // Estimate normal at every pixel in row
+  for (int ix = 0; ix < width; ix++) {
+    int i = iy * width + ix;
+    if (integral->px[i] == R2_GRID_UNKNOWN_VALUE) continue;
+
+    // Sum moments in window
+    int x0 = (ix - r > 0) ? ix - r : 0;
+    int x1 = (ix + r + 1 < width) ? ix + r + 1 : width;
+    double m[RGBD_INTEGRAL_IMAGE_NMOMENTS];
+    for (int k = 0; k < N; k++) {
+      m[k] = row1[x1*N+k] - row1[x0*N+k] - row0[x1*N+k] + row0[x0*N+k];
+    }
+
+    // Check number of points
+    double count = m[0];
+    if (count < 3) continue;
+
+    // Compute covariance matrix
+    double cx = m[1] / count, cy = m[2] / count, cz = m[3] / count;
+    double a[3][3];
+    a[0][0] = m[4] / count - cx*cx;
+    a[0][1] = a[1][0] = m[5] / count - cx*cy;
+    a[0][2] = a[2][0] = m[6] / count - cx*cz;
+    a[1][1] = m[7] / count - cy*cy;
+    a[1][2] = a[2][1] = m[8] / count - cy*cz;
+    a[2][2] = m[9] / count - cz*cz;
+
+    // Compute eigenvectors of covariance matrix
+    double eigenvalues[3], eigenvectors[3][3];
+    DecomposeSymmetricMatrix(a, eigenvalues, eigenvectors);
+    int imax = 0, imin = 0;
+    for (int k = 1; k < 3; k++) {
+      if (eigenvalues[k] > eigenvalues[imax]) imax = k;
+      if (eigenvalues[k] < eigenvalues[imin]) imin = k;
+    }
+    if (imax == imin) { imax = 0; imin = 2; }
+    int imid = 3 - imax - imin;
+
+    // Fill normal (smallest axis, flipped to point towards viewpoint)
+    double nx = eigenvectors[0][imin], ny = eigenvectors[1][imin], nz = eigenvectors[2][imin];
+    double vx = integral->viewpoint[0] - integral->px[i];
+    double vy = integral->viewpoint[1] - integral->py[i];
+    double vz = integral->viewpoint[2] - integral->pz[i];
+    if (nx*vx + ny*vy + nz*vz < 0) { nx = -nx; ny = -ny; nz = -nz; }
+    integral->nx[i] = nx;
+    integral->ny[i] = ny;
+    integral->nz[i] = nz;
+
+    // Fill tangent (largest axis)
+    if (integral->tx) integral->tx[i] = eigenvectors[0][imax];
+    if (integral->ty) integral->ty[i] = eigenvectors[1][imax];
+    if (integral->tz) integral->tz[i] = eigenvectors[2][imax];
+
+    // Fill radii (three standard deviations along largest axes)
+    if (integral->r1) integral->r1[i] = 3 * sqrt((eigenvalues[imax] > 0) ? eigenvalues[imax] : 0);
+    if (integral->r2) integral->r2[i] = 3 * sqrt((eigenvalues[imid] > 0) ? eigenvalues[imid] : 0);
+  }
+}
+
+
+
+int RGBDEstimateIntegralImageNormals(const RNScalar *px, const RNScalar *py, const RNScalar *pz,
+  int width, int height, const R3Point& viewpoint, int pixel_radius,
+  RNScalar *nx, RNScalar *ny, RNScalar *nz,
+  RNScalar *tx, RNScalar *ty, RNScalar *tz,
+  RNScalar *r1, RNScalar *r2)
+{
+  // Check image
+  if ((width <= 0) || (height <= 0)) return 1;
+  if (pixel_radius < 1) pixel_radius = 1;
+
+  // Allocate integral image (with extra zero row and column)
+  size_t nentries = (size_t) (width + 1) * (height + 1) * RGBD_INTEGRAL_IMAGE_NMOMENTS;
+  double *integrals = new double [ nentries ];
+  if (!integrals) {
+    RNFail("Unable to allocate integral image\n");
+    return 0;
+  }
+  for (size_t k = 0; k < (size_t) (width + 1) * RGBD_INTEGRAL_IMAGE_NMOMENTS; k++) integrals[k] = 0;
+
+  // Initialize data
+  RGBDIntegralImageData integral;
+  integral.px = px;
+  integral.py = py;
+  integral.pz = pz;
+  integral.width = width;
+  integral.height = height;
+  integral.viewpoint = viewpoint;
+  integral.pixel_radius = pixel_radius;
+  integral.integrals = integrals;
+  integral.nx = nx;
+  integral.ny = ny;
+  integral.nz = nz;
+  integral.tx = tx;
+  integral.ty = ty;
+  integral.tz = tz;
+  integral.r1 = r1;
+  integral.r2 = r2;
+
+  // Compute integral image (prefix sums along rows, then down columns)
+  RNParallelFor(height, AccumulateIntegralImageRow, &integral, 16);
+  RNParallelFor((width + 1 + 63) / 64, AccumulateIntegralImageColumns, &integral, 1);
+
+  // Estimate normals from moments in window around each pixel
+  RNParallelFor(height, EstimateIntegralImageNormalRow, &integral, 8);
+
+  // Delete integral image
+  delete [] integrals;
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // LOW-LEVEL UNDISTORTION UTILITY FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
@@ -808,75 +1196,421 @@ int RGBDResampleColorImage(R2Image& image, R3Matrix& intrinsics_matrix, int xres
 // Alignment Functions
 ////////////////////////////////////////////////////////////////////////
 
-#if 0
+// NOTE:
+// Images are aligned with point-to-plane ICP using projective data
+// association: each pixel of image1 is transformed into the camera of
+// image0 and matched to the pixel of image0 that it projects onto.
+// Alignment proceeds coarse-to-fine over a pyramid of depth images.
+// Each iteration accumulates the normal equations of the linearized
+// point-to-plane error over blocks of rows in parallel, and then sums
+// the partial sums of the blocks in order (so that results do not
+// depend on the number of threads).  All computation happens in the
+// camera coordinates of image0 for numerical conditioning.
+
+// Number of rows per block of accumulated normal equations
+#define RGBD_ALIGNMENT_BLOCK_ROWS 8
+
+// Number of values in normal equations (21 for JtJ, 6 for Jtr, error, count), padded
+#define RGBD_ALIGNMENT_NSUMS 32
+
+struct RGBDAlignmentLevel {
+  R2Grid depth_image;
+  R3Matrix intrinsics;
+};
+
+struct RGBDAlignmentData {
+  // Target (image0) positions and normals in camera coordinates of image0
+  const RNScalar *px0, *py0, *pz0;
+  const RNScalar *nx0, *ny0, *nz0;
+  int width0, height0;
+  RNScalar fx0, fy0, cx0, cy0;
+
+  // Source (image1) positions in world coordinates of image1
+  const RNScalar *px1, *py1, *pz1;
+  int width1, height1;
+
+  // Current transformation from world coordinates of image1 to camera coordinates of image0
+  R4Matrix matrix;
+  RNScalar max_distance_squared;
+
+  // Partial sums of normal equations for each block of rows
+  double *sums;
+};
+
+
+
+static void
+CreateAlignmentPyramid(const RGBDImage *image, RGBDAlignmentLevel *levels, int nlevels)
+{
+  // Initialize finest level (scaling intrinsics to resolution of depth channel)
+  const R2Grid *depth_channel = image->DepthChannel();
+  levels[0].depth_image = *depth_channel;
+  levels[0].intrinsics = image->Intrinsics();
+  if ((image->NPixels(RN_X) > 0) && (image->NPixels(RN_Y) > 0)) {
+    RNScalar xscale = (RNScalar) depth_channel->XResolution() / (RNScalar) image->NPixels(RN_X);
+    RNScalar yscale = (RNScalar) depth_channel->YResolution() / (RNScalar) image->NPixels(RN_Y);
+    levels[0].intrinsics[0][0] *= xscale;
+    levels[0].intrinsics[0][2] *= xscale;
+    levels[0].intrinsics[1][1] *= yscale;
+    levels[0].intrinsics[1][2] *= yscale;
+  }
+
+  // Create coarser levels by averaging 2x2 blocks of similar depths
+  for (int level = 1; level < nlevels; level++) {
+    const R2Grid& fine_image = levels[level-1].depth_image;
+    int width = fine_image.XResolution() / 2;
+    int height = fine_image.YResolution() / 2;
+    R2Grid& coarse_image = levels[level].depth_image;
+    coarse_image = R2Grid(width, height);
+    coarse_image.Clear(R2_GRID_UNKNOWN_VALUE);
+    for (int iy = 0; iy < height; iy++) {
+      for (int ix = 0; ix < width; ix++) {
+        // Find nearest valid depth in block
+        RNScalar depths[4];
+        RNScalar min_depth = FLT_MAX;
+        for (int k = 0; k < 4; k++) {
+          depths[k] = fine_image.GridValue(2*ix + (k & 1), 2*iy + (k >> 1));
+          if ((depths[k] > RN_EPSILON) && (depths[k] < min_depth)) min_depth = depths[k];
+        }
+        if (min_depth == FLT_MAX) continue;
+
+        // Average depths close to nearest one (to avoid mixing across discontinuities)
+        RNScalar sum = 0;
+        int count = 0;
+        for (int k = 0; k < 4; k++) {
+          if ((depths[k] <= RN_EPSILON) || (depths[k] > 1.05 * min_depth)) continue;
+          sum += depths[k];
+          count++;
+        }
+        coarse_image.SetGridValue(ix, iy, sum / count);
+      }
+    }
+
+    // Scale intrinsics (pixel centers are at half-integer coordinates)
+    levels[level].intrinsics = levels[level-1].intrinsics;
+    levels[level].intrinsics[0][0] *= 0.5;
+    levels[level].intrinsics[0][2] *= 0.5;
+    levels[level].intrinsics[1][1] *= 0.5;
+    levels[level].intrinsics[1][2] *= 0.5;
+  }
+}
+
+
+
+static void
+AccumulateAlignmentBlock(int block_index, int, void *data)
+{
+  // Get convenient variables
+  RGBDAlignmentData *alignment = (RGBDAlignmentData *) data;
+  const R4Matrix& m = alignment->matrix;
+  int width0 = alignment->width0;
+  int height0 = alignment->height0;
+  int width1 = alignment->width1;
+  int start_row = block_index * RGBD_ALIGNMENT_BLOCK_ROWS;
+  int end_row = start_row + RGBD_ALIGNMENT_BLOCK_ROWS;
+  if (end_row > alignment->height1) end_row = alignment->height1;
+
+  // Initialize sums
+  double sums[RGBD_ALIGNMENT_NSUMS] = { 0 };
+
+  // Accumulate normal equations for pixels of source image
+  for (int i = start_row * width1; i < end_row * width1; i++) {
+    // Get source position
+    if (alignment->px1[i] == R2_GRID_UNKNOWN_VALUE) continue;
+    RNScalar x1 = alignment->px1[i], y1 = alignment->py1[i], z1 = alignment->pz1[i];
+
+    // Transform into camera coordinates of target
+    double x = m[0][0]*x1 + m[0][1]*y1 + m[0][2]*z1 + m[0][3];
+    double y = m[1][0]*x1 + m[1][1]*y1 + m[1][2]*z1 + m[1][3];
+    double z = m[2][0]*x1 + m[2][1]*y1 + m[2][2]*z1 + m[2][3];
+    if (z >= -RN_EPSILON) continue;
+
+    // Project into target image
+    int ix = (int) floor(alignment->cx0 + alignment->fx0 * x / -z);
+    if ((ix < 0) || (ix >= width0)) continue;
+    int iy = (int) floor(alignment->cy0 + alignment->fy0 * y / -z);
+    if ((iy < 0) || (iy >= height0)) continue;
+
+    // Get target position and normal
+    int k = iy * width0 + ix;
+    if (alignment->px0[k] == R2_GRID_UNKNOWN_VALUE) continue;
+    if (alignment->nx0[k] == R2_GRID_UNKNOWN_VALUE) continue;
+    double dx = x - alignment->px0[k];
+    double dy = y - alignment->py0[k];
+    double dz = z - alignment->pz0[k];
+    if (dx*dx + dy*dy + dz*dz > alignment->max_distance_squared) continue;
+    double nx = alignment->nx0[k], ny = alignment->ny0[k], nz = alignment->nz0[k];
+
+    // Compute residual and jacobian of point-to-plane distance
+    // with respect to (rotation, translation) of source point
+    double r = nx*dx + ny*dy + nz*dz;
+    double J[6] = { y*nz - z*ny, z*nx - x*nz, x*ny - y*nx, nx, ny, nz };
+
+    // Accumulate upper triangle of JtJ, Jtr, error, and count
+    int s = 0;
+    for (int a = 0; a < 6; a++) {
+      for (int b = a; b < 6; b++) sums[s++] += J[a] * J[b];
+    }
+    for (int a = 0; a < 6; a++) sums[21 + a] += J[a] * r;
+    sums[27] += r * r;
+    sums[28] += 1;
+  }
+
+  // Copy sums for block
+  double *block_sums = &alignment->sums[block_index * RGBD_ALIGNMENT_NSUMS];
+  for (int s = 0; s < RGBD_ALIGNMENT_NSUMS; s++) block_sums[s] = sums[s];
+}
+
+
+
+static int
+SolveAlignmentEquations(const double *sums, double *x)
+{
+  // Unpack symmetric matrix A = JtJ and vector b = -Jtr
+  double A[6][6], b[6];
+  int s = 0;
+  for (int i = 0; i < 6; i++) {
+    for (int j = i; j < 6; j++) A[i][j] = A[j][i] = sums[s++];
+    b[i] = -sums[21 + i];
+  }
+
+  // Compute Cholesky decomposition A = L Lt (in lower triangle of A)
+  for (int j = 0; j < 6; j++) {
+    double d = A[j][j];
+    for (int k = 0; k < j; k++) d -= A[j][k] * A[j][k];
+    if (d <= 1E-12 * (1 + fabs(A[j][j]))) return 0;
+    A[j][j] = sqrt(d);
+    for (int i = j+1; i < 6; i++) {
+      double v = A[i][j];
+      for (int k = 0; k < j; k++) v -= A[i][k] * A[j][k];
+      A[i][j] = v / A[j][j];
+    }
+  }
+
+  // Solve L y = b, then Lt x = y
+  double y[6];
+  for (int i = 0; i < 6; i++) {
+    double v = b[i];
+    for (int k = 0; k < i; k++) v -= A[i][k] * y[k];
+    y[i] = v / A[i][i];
+  }
+  for (int i = 5; i >= 0; i--) {
+    double v = y[i];
+    for (int k = i+1; k < 6; k++) v -= A[k][i] * x[k];
+    x[i] = v / A[i][i];
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static R4Matrix
+AlignmentUpdateMatrix(const double *x)
+{
+  // Create rigid transformation from rotation vector and translation (Rodrigues formula)
+  R4Matrix matrix = R4identity_matrix;
+  double angle = sqrt(x[0]*x[0] + x[1]*x[1] + x[2]*x[2]);
+  if (angle > 0) {
+    double kx = x[0] / angle, ky = x[1] / angle, kz = x[2] / angle;
+    double c = cos(angle), s = sin(angle), t = 1 - c;
+    matrix[0][0] = t*kx*kx + c;    matrix[0][1] = t*kx*ky - s*kz; matrix[0][2] = t*kx*kz + s*ky;
+    matrix[1][0] = t*kx*ky + s*kz; matrix[1][1] = t*ky*ky + c;    matrix[1][2] = t*ky*kz - s*kx;
+    matrix[2][0] = t*kx*kz - s*ky; matrix[2][1] = t*ky*kz + s*kx; matrix[2][2] = t*kz*kz + c;
+  }
+  matrix[0][3] = x[3];
+  matrix[1][3] = x[4];
+  matrix[2][3] = x[5];
+  return matrix;
+}
+
+
+
 R3Affine RGBDAlignmentTransformation(RGBDImage *image0, RGBDImage *image1, const R3Affine& initial_transformation,
-  RNLength start_max_distance, RNLength end_max_distance, int max_iterations)
+  RNLength start_max_distance, RNLength end_max_distance, int max_iterations,
+  int npyramid_levels, RNScalar *rms_error)
 {
   // Initialize transformation from world coordinates of image1 to world coordinates of image0
   R3Affine transformation = initial_transformation;
+  if (rms_error) *rms_error = -1;
 
   // Check max iterations
-  if (max_iterations == 0) return transformation;
-  
-  // Create points for image0
-  RNArray<R3Point *> points0;
-  for (int iy = 0; iy < image0->NPixels(RN_Y); iy++) {
-    for (int ix = 0; ix < image0->NPixels(RN_X); ix++) {
-      R3Point world_position = image0->PixelWorldPosition(ix, iy);
-      points0.Insert(new R3Point(world_position));
-    }
-  }
+  if (max_iterations <= 0) return transformation;
 
-  // Create points for image1
-  RNArray<R3Point *> points1;
-  for (int iy = 0; iy < image1->NPixels(RN_Y); iy++) {
-    for (int ix = 0; ix < image1->NPixels(RN_X); ix++) {
-      R3Point world_position = image1->PixelWorldPosition(ix, iy);
-      points1.Insert(new R3Point(world_position));
-    }
+  // Check depth channels
+  if (!image0->DepthChannel() || !image1->DepthChannel()) {
+    RNFail("Depth channels must be read to align images\n");
+    return transformation;
   }
 
-  // Check numbers of points
-  if ((points0.NEntries() > 128) && (points1.NEntries() > 128)) {
-    // Create kdtree for image0
-    R3Kdtree<R3Point *> kdtree0(points0);
-
-    // Iteratively align closest points
-    RNLength max_distance = start_max_distance;
-    RNLength max_distance_step_factor = pow(end_max_distance / start_max_distance, 1.0 / max_iterations);
-    for (int i = 0; i < max_iterations; i++) {
-      // Find correspondences
-      RNArray<R3Point *> correspondences0, correspondences1;
-      for (int j = 0; j < points1.NEntries(); j++) {
-        R3Point *point1 = points1.Kth(j);
-        R3Point transformed_point1 = *point1;
-        transformed_point1.Transform(transformation);
-        R3Point *point0 = kdtree0.FindClosest(&transformed_point1, 0, max_distance);
-        if (!point0) continue;
-        correspondences0.Insert(point0);
-        correspondences1.Insert(point1);
+  // Check intrinsics
+  if (RNIsZero(image0->Intrinsics()[0][0]) || RNIsZero(image0->Intrinsics()[1][1])) return transformation;
+  if (RNIsZero(image1->Intrinsics()[0][0]) || RNIsZero(image1->Intrinsics()[1][1])) return transformation;
+
+  // Determine number of pyramid levels (coarsest level at least 20 pixels wide)
+  int nlevels = (npyramid_levels > 0) ? npyramid_levels : 1;
+  while ((nlevels > 1) && ((image0->DepthChannel()->XResolution() >> (nlevels-1)) < 20)) nlevels--;
+  while ((nlevels > 1) && ((image1->DepthChannel()->XResolution() >> (nlevels-1)) < 20)) nlevels--;
+
+  // Create pyramids of depth images
+  RGBDAlignmentLevel *levels0 = new RGBDAlignmentLevel [ nlevels ];
+  RGBDAlignmentLevel *levels1 = new RGBDAlignmentLevel [ nlevels ];
+  CreateAlignmentPyramid(image0, levels0, nlevels);
+  CreateAlignmentPyramid(image1, levels1, nlevels);
+
+  // Initialize transformation from world coordinates of image1 to camera coordinates of image0
+  // (the inverse is computed here rather than cached in image, since images may be shared across threads)
+  R4Matrix camera_to_world0 = image0->CameraToWorld().Matrix();
+  R4Matrix world_to_camera0 = camera_to_world0.Inverse();
+  R4Matrix matrix = world_to_camera0 * transformation.Matrix();
+
+  // Iterate from coarse to fine levels
+  int iteration = 0;
+  int total_iterations = nlevels * max_iterations;
+  RNScalar max_distance_step_factor = pow(end_max_distance / start_max_distance, 1.0 / total_iterations);
+  RNLength max_distance = start_max_distance;
+  for (int level = nlevels-1; level >= 0; level--) {
+    const R2Grid& depth_image0 = levels0[level].depth_image;
+    const R2Grid& depth_image1 = levels1[level].depth_image;
+    const R3Matrix& intrinsics0 = levels0[level].intrinsics;
+    int width0 = depth_image0.XResolution(), height0 = depth_image0.YResolution();
+    int width1 = depth_image1.XResolution(), height1 = depth_image1.YResolution();
+
+    // Compute target positions and normals in camera coordinates of image0
+    RNScalar *target_values = new RNScalar [ 6 * width0 * height0 + 1 ];
+    RNScalar *px0 = &target_values[0 * width0 * height0], *nx0 = &target_values[3 * width0 * height0];
+    RNScalar *py0 = &target_values[1 * width0 * height0], *ny0 = &target_values[4 * width0 * height0];
+    RNScalar *pz0 = &target_values[2 * width0 * height0], *nz0 = &target_values[5 * width0 * height0];
+    for (int k = 0; k < 3 * width0 * height0; k++) nx0[k] = R2_GRID_UNKNOWN_VALUE;
+    RGBDBackProjectDepthValues(depth_image0.GridValues(), width0, height0,
+      intrinsics0, R4identity_matrix, px0, py0, pz0);
+    RGBDEstimateIntegralImageNormals(px0, py0, pz0, width0, height0,
+      R3zero_point, 2, nx0, ny0, nz0);
+
+    // Compute source positions in world coordinates of image1
+    RNScalar *source_values = new RNScalar [ 3 * width1 * height1 + 1 ];
+    RNScalar *px1 = &source_values[0 * width1 * height1];
+    RNScalar *py1 = &source_values[1 * width1 * height1];
+    RNScalar *pz1 = &source_values[2 * width1 * height1];
+    RGBDBackProjectDepthValues(depth_image1.GridValues(), width1, height1,
+      levels1[level].intrinsics, image1->CameraToWorld().Matrix(), px1, py1, pz1);
+
+    // Initialize alignment data
+    int nblocks = (height1 + RGBD_ALIGNMENT_BLOCK_ROWS - 1) / RGBD_ALIGNMENT_BLOCK_ROWS;
+    double *block_sums = new double [ nblocks * RGBD_ALIGNMENT_NSUMS + 1 ];
+    RGBDAlignmentData alignment;
+    alignment.px0 = px0; alignment.py0 = py0; alignment.pz0 = pz0;
+    alignment.nx0 = nx0; alignment.ny0 = ny0; alignment.nz0 = nz0;
+    alignment.width0 = width0;
+    alignment.height0 = height0;
+    alignment.fx0 = intrinsics0[0][0];
+    alignment.fy0 = intrinsics0[1][1];
+    alignment.cx0 = intrinsics0[0][2];
+    alignment.cy0 = intrinsics0[1][2];
+    alignment.px1 = px1; alignment.py1 = py1; alignment.pz1 = pz1;
+    alignment.width1 = width1;
+    alignment.height1 = height1;
+    alignment.sums = block_sums;
+
+    // Iteratively align points to planes
+    for (int i = 0; i < max_iterations; i++, iteration++) {
+      // Accumulate normal equations in blocks of rows (in parallel)
+      alignment.matrix = matrix;
+      alignment.max_distance_squared = max_distance * max_distance;
+      RNParallelFor(nblocks, AccumulateAlignmentBlock, &alignment, 1);
+
+      // Sum blocks (in order, so that result is deterministic)
+      double sums[RGBD_ALIGNMENT_NSUMS] = { 0 };
+      for (int b = 0; b < nblocks; b++) {
+        for (int s = 0; s < RGBD_ALIGNMENT_NSUMS; s++) sums[s] += block_sums[b * RGBD_ALIGNMENT_NSUMS + s];
       }
 
+      // Update max distance
+      max_distance *= max_distance_step_factor;
+
       // Check number of correspondences
-      if (correspondences0.NEntries() < 128) break;
-    
+      if (sums[28] < 128) break;
+      if (rms_error) *rms_error = sqrt(sums[27] / sums[28]);
+
+      // Solve for incremental rigid transformation
+      double x[6];
+      if (!SolveAlignmentEquations(sums, x)) break;
+
       // Update transformation
-      R4Matrix matrix = R3AlignPoints(correspondences0, correspondences1, NULL, TRUE, TRUE, FALSE);
-      transformation.Reset(matrix, 0);
+      matrix = AlignmentUpdateMatrix(x) * matrix;
 
-      // Update max distance
-      max_distance *= max_distance_step_factor;
+      // Check for convergence
+      double rotation = x[0]*x[0] + x[1]*x[1] + x[2]*x[2];
+      double translation = x[3]*x[3] + x[4]*x[4] + x[5]*x[5];
+      if ((rotation < 1E-12) && (translation < 1E-12)) break;
     }
+
+    // Advance max distance past skipped iterations
+    for ( ; iteration < (nlevels - level) * max_iterations; iteration++) max_distance *= max_distance_step_factor;
+
+    // Delete level data
+    delete [] target_values;
+    delete [] source_values;
+    delete [] block_sums;
   }
-  
-  // Delete points
-  for (int i = 0; i < points0.NEntries(); i++) delete points0[i];
-  for (int i = 0; i < points1.NEntries(); i++) delete points1[i];
+
+  // Delete pyramids
+  delete [] levels0;
+  delete [] levels1;
 
   // Return transformation from world coordinates of image1 to world coordinates of image0
-  return transformation;
+  return R3Affine(camera_to_world0 * matrix, 0);
+}
+
+
+
+struct RGBDAlignImagePairsData {
+  RGBDImage **images0;
+  RGBDImage **images1;
+  R3Affine *transformations;
+  RNScalar *rms_errors;
+  RNLength start_max_distance;
+  RNLength end_max_distance;
+  int max_iterations;
+  int npyramid_levels;
+};
+
+
+
+static void
+AlignImagePair(int index, int, void *data)
+{
+  // Align one pair of images (the loops inside run serially within this thread)
+  RGBDAlignImagePairsData *pairs = (RGBDAlignImagePairsData *) data;
+  RNScalar *rms_error = (pairs->rms_errors) ? &pairs->rms_errors[index] : NULL;
+  pairs->transformations[index] = RGBDAlignmentTransformation(
+    pairs->images0[index], pairs->images1[index], pairs->transformations[index],
+    pairs->start_max_distance, pairs->end_max_distance, pairs->max_iterations,
+    pairs->npyramid_levels, rms_error);
+}
+
+
+
+int RGBDAlignImagePairs(int npairs, RGBDImage **images0, RGBDImage **images1, R3Affine *transformations,
+  RNLength start_max_distance, RNLength end_max_distance, int max_iterations,
+  int npyramid_levels, RNScalar *rms_errors)
+{
+  // Align pairs of images concurrently
+  RGBDAlignImagePairsData pairs;
+  pairs.images0 = images0;
+  pairs.images1 = images1;
+  pairs.transformations = transformations;
+  pairs.rms_errors = rms_errors;
+  pairs.start_max_distance = start_max_distance;
+  pairs.end_max_distance = end_max_distance;
+  pairs.max_iterations = max_iterations;
+  pairs.npyramid_levels = npyramid_levels;
+  RNParallelFor(npairs, AlignImagePair, &pairs, 1);
+
+  // Return success
+  return 1;
 }
-#endif
 
 
 
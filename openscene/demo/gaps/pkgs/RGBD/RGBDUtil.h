@@ -70,6 +70,35 @@ int RGBDCreateBoundaryChannel(
   const R2Grid& input_depth_image, R2Grid& output_boundary_image,
   RNScalar depth_threshold = 0.1);
 
+int RGBDCreateIntegralImageNormalChannels(const R2Grid& input_depth_image,
+  const R2Grid& input_px_image, const R2Grid& input_py_image, const R2Grid& input_pz_image,
+  R2Grid& output_nx_image, R2Grid& output_ny_image, R2Grid& output_nz_image,
+  const R3Point& viewpoint, int neighborhood_pixel_radius = 2);
+
+int RGBDCreateIntegralImageTangentChannels(const R2Grid& input_depth_image,
+  const R2Grid& input_px_image, const R2Grid& input_py_image, const R2Grid& input_pz_image,
+  R2Grid& output_nx_image, R2Grid& output_ny_image, R2Grid& output_nz_image,
+  R2Grid& output_tx_image, R2Grid& output_ty_image, R2Grid& output_tz_image,
+  R2Grid& output_r1_image, R2Grid& output_r2_image,
+  const R3Point& viewpoint, int neighborhood_pixel_radius = 2);
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Low-level Batched Back-Projection and Normal Estimation Functions
+// (arrays have width*height values in row-major order, like R2Grid values)
+////////////////////////////////////////////////////////////////////////
+
+int RGBDBackProjectDepthValues(const RNScalar *depths, int width, int height,
+  const R3Matrix& intrinsics_matrix, const R4Matrix& camera_to_world_matrix,
+  RNScalar *px, RNScalar *py, RNScalar *pz);
+
+int RGBDEstimateIntegralImageNormals(const RNScalar *px, const RNScalar *py, const RNScalar *pz,
+  int width, int height, const R3Point& viewpoint, int pixel_radius,
+  RNScalar *nx, RNScalar *ny, RNScalar *nz,
+  RNScalar *tx = NULL, RNScalar *ty = NULL, RNScalar *tz = NULL,
+  RNScalar *r1 = NULL, RNScalar *r2 = NULL);
+
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -102,10 +131,17 @@ int RGBDResampleColorImage(R2Image& image, R3Matrix& intrinsics_matrix, int xres
 // Alignment Functions
 ////////////////////////////////////////////////////////////////////////
 
-#if 0
+// Returns transformation from world coordinates of image1 to world coordinates of image0
+// (depth channels must be read), computed with point-to-plane ICP on an image pyramid
 R3Affine RGBDAlignmentTransformation(RGBDImage *image0, RGBDImage *image1, 
-  RNLength start_max_distance = 0.25, RNLength end_max_distance = 0.05, int max_iterations = 16);
-#endif
+  const R3Affine& initial_transformation = R3identity_affine,
+  RNLength start_max_distance = 0.25, RNLength end_max_distance = 0.05, int max_iterations = 16,
+  int npyramid_levels = 3, RNScalar *rms_error = NULL);
+
+// Aligns many pairs of images concurrently (transformations are initial on input, final on output)
+int RGBDAlignImagePairs(int npairs, RGBDImage **images0, RGBDImage **images1, R3Affine *transformations,
+  RNLength start_max_distance = 0.25, RNLength end_max_distance = 0.05, int max_iterations = 16,
+  int npyramid_levels = 3, RNScalar *rms_errors = NULL);
 
 
 
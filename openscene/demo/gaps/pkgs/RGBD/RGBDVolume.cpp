@@ -0,0 +1,994 @@
+////////////////////////////////////////////////////////////////////////
+// Source file for RGBDVolume class
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// NOTE:
+// A volume fuses depth images into a truncated signed distance
+// function (TSDF) sampled at voxels with spacing voxel_size.  Voxels
+// are stored in 8x8x8 blocks, which are allocated only near observed
+// surfaces and found with a hash table keyed by block coordinates.
+// Each voxel stores the weighted average of truncated distances
+// (in units of the truncation distance, positive in front of the
+// surface), its weight, and a weighted average color.
+//
+// Integrating an image first finds the blocks within the truncation
+// band around its depth samples, and then updates those blocks in
+// parallel by projecting their voxels into the image.  The isosurface
+// is extracted with marching cubes per block, and the mesh of each
+// block is kept, so that only blocks changed since the last update
+// (and their neighbors) have to be remeshed.
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "RGBD.h"
+#include <algorithm>
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Block definition
+////////////////////////////////////////////////////////////////////////
+
+#define RGBD_VOLUME_BLOCK_BITS      3
+#define RGBD_VOLUME_BLOCK_SIZE      8
+#define RGBD_VOLUME_BLOCK_VOLUME  512
+#define RGBD_VOLUME_BLOCK_MASK      7
+
+struct RGBDVolumeBlock {
+  int origin[3];
+  float distances[RGBD_VOLUME_BLOCK_VOLUME];
+  float weights[RGBD_VOLUME_BLOCK_VOLUME];
+  unsigned char colors[3*RGBD_VOLUME_BLOCK_VOLUME];
+  int integration_stamp;
+  int mesh_flags;
+  std::vector<float> vertex_positions;
+  std::vector<unsigned char> vertex_colors;
+  std::vector<unsigned short> vertex_keys;
+  std::vector<int> triangle_vertices;
+};
+
+// Block mesh flags
+#define RGBD_VOLUME_BLOCK_UPDATED          0x1
+#define RGBD_VOLUME_BLOCK_VERTICES_DIRTY   0x2
+#define RGBD_VOLUME_BLOCK_TRIANGLES_DIRTY  0x4
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Utility functions
+////////////////////////////////////////////////////////////////////////
+
+static inline RNInt64
+BlockKey(int bi, int bj, int bk)
+{
+  // Return hash key for block coordinates (21 bits each, offset so that negative coordinates are allowed)
+  const int offset = 1 << 20;
+  return ((RNInt64) (bk + offset) << 42) | ((RNInt64) (bj + offset) << 21) | (RNInt64) (bi + offset);
+}
+
+
+
+static inline int
+BlockVoxelIndex(int li, int lj, int lk)
+{
+  // Return index of voxel at local coordinates within block
+  return ((lk << RGBD_VOLUME_BLOCK_BITS) + lj) * RGBD_VOLUME_BLOCK_SIZE + li;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+RGBDVolume::
+RGBDVolume(RNLength voxel_size, RNLength truncation_distance)
+  : voxel_size(voxel_size),
+    truncation_distance((truncation_distance > 0) ? truncation_distance : 4 * voxel_size),
+    max_weight(FLT_MAX),
+    min_depth(0),
+    max_depth(FLT_MAX),
+    nintegrated_images(0),
+    blocks(),
+    block_indices()
+{
+}
+
+
+
+RGBDVolume::
+~RGBDVolume(void)
+{
+  // Delete blocks
+  Empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Property functions
+////////////////////////////////////////////////////////////////////////
+
+R3Box RGBDVolume::
+WorldBBox(void) const
+{
+  // Return bounding box of allocated blocks
+  R3Box bbox = R3null_box;
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    const RGBDVolumeBlock *block = blocks[b];
+    R3Point corner0(block->origin[0], block->origin[1], block->origin[2]);
+    R3Point corner1 = corner0 + R3Vector(RGBD_VOLUME_BLOCK_SIZE - 1, RGBD_VOLUME_BLOCK_SIZE - 1, RGBD_VOLUME_BLOCK_SIZE - 1);
+    bbox.Union(voxel_size * corner0);
+    bbox.Union(voxel_size * corner1);
+  }
+  return bbox;
+}
+
+
+
+int RGBDVolume::
+NDirtyBlocks(void) const
+{
+  // Return number of blocks updated since mesh was last updated
+  int count = 0;
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    if (blocks[b]->mesh_flags & RGBD_VOLUME_BLOCK_UPDATED) count++;
+  }
+  return count;
+}
+
+
+
+RNInt64 RGBDVolume::
+MemoryUsage(void) const
+{
+  // Return bytes used by blocks and their meshes
+  RNInt64 nbytes = blocks.size() * (sizeof(RGBDVolumeBlock) + sizeof(RGBDVolumeBlock *));
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    const RGBDVolumeBlock *block = blocks[b];
+    nbytes += block->vertex_positions.capacity() * sizeof(float);
+    nbytes += block->vertex_colors.capacity() * sizeof(unsigned char);
+    nbytes += block->vertex_keys.capacity() * sizeof(unsigned short);
+    nbytes += block->triangle_vertices.capacity() * sizeof(int);
+  }
+  return nbytes;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Voxel access functions
+////////////////////////////////////////////////////////////////////////
+
+const RGBDVolumeBlock *RGBDVolume::
+FindVoxel(const R3Point& world_position, int& voxel_index) const
+{
+  // Find nearest voxel
+  int i = (int) floor(world_position.X() / voxel_size + 0.5);
+  int j = (int) floor(world_position.Y() / voxel_size + 0.5);
+  int k = (int) floor(world_position.Z() / voxel_size + 0.5);
+
+  // Find block containing voxel
+  int block_index = FindBlockIndex(i >> RGBD_VOLUME_BLOCK_BITS, j >> RGBD_VOLUME_BLOCK_BITS, k >> RGBD_VOLUME_BLOCK_BITS);
+  if (block_index < 0) return NULL;
+
+  // Return block and index of voxel within block
+  voxel_index = BlockVoxelIndex(i & RGBD_VOLUME_BLOCK_MASK, j & RGBD_VOLUME_BLOCK_MASK, k & RGBD_VOLUME_BLOCK_MASK);
+  return blocks[block_index];
+}
+
+
+
+RNScalar RGBDVolume::
+WorldDistance(const R3Point& world_position) const
+{
+  // Return signed distance at nearest voxel (truncation distance if unobserved)
+  int voxel_index;
+  const RGBDVolumeBlock *block = FindVoxel(world_position, voxel_index);
+  if (!block || (block->weights[voxel_index] == 0)) return truncation_distance;
+  return truncation_distance * block->distances[voxel_index];
+}
+
+
+
+RNScalar RGBDVolume::
+WorldWeight(const R3Point& world_position) const
+{
+  // Return weight at nearest voxel
+  int voxel_index;
+  const RGBDVolumeBlock *block = FindVoxel(world_position, voxel_index);
+  if (!block) return 0;
+  return block->weights[voxel_index];
+}
+
+
+
+RNRgb RGBDVolume::
+WorldColor(const R3Point& world_position) const
+{
+  // Return color at nearest voxel
+  int voxel_index;
+  const RGBDVolumeBlock *block = FindVoxel(world_position, voxel_index);
+  if (!block) return RNblack_rgb;
+  const unsigned char *color = &block->colors[3*voxel_index];
+  return RNRgb(color[0] / 255.0, color[1] / 255.0, color[2] / 255.0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Manipulation functions
+////////////////////////////////////////////////////////////////////////
+
+void RGBDVolume::
+Empty(void)
+{
+  // Delete blocks
+  for (unsigned int b = 0; b < blocks.size(); b++) delete blocks[b];
+  blocks.clear();
+  block_indices.clear();
+  nintegrated_images = 0;
+}
+
+
+
+void RGBDVolume::
+SetTruncationDistance(RNLength truncation_distance)
+{
+  // Check volume (stored distances are in units of the truncation distance)
+  if (!blocks.empty()) {
+    RNFail("Unable to change truncation distance after images have been integrated\n");
+    return;
+  }
+
+  // Set truncation distance
+  this->truncation_distance = truncation_distance;
+}
+
+
+
+void RGBDVolume::
+SetMaxWeight(RNScalar max_weight)
+{
+  // Set maximum weight accumulated by a voxel
+  this->max_weight = max_weight;
+}
+
+
+
+void RGBDVolume::
+SetDepthRange(RNLength min_depth, RNLength max_depth)
+{
+  // Set range of depths integrated
+  this->min_depth = min_depth;
+  this->max_depth = max_depth;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Block functions
+////////////////////////////////////////////////////////////////////////
+
+int RGBDVolume::
+FindBlockIndex(int bi, int bj, int bk) const
+{
+  // Return index of block with block coordinates, or -1
+  std::unordered_map<RNInt64, int>::const_iterator it = block_indices.find(BlockKey(bi, bj, bk));
+  return (it != block_indices.end()) ? it->second : -1;
+}
+
+
+
+int RGBDVolume::
+AllocateBlock(int bi, int bj, int bk)
+{
+  // Check if block is already allocated
+  int block_index = FindBlockIndex(bi, bj, bk);
+  if (block_index >= 0) return block_index;
+
+  // Create block of unobserved voxels
+  RGBDVolumeBlock *block = new RGBDVolumeBlock();
+  block->origin[0] = bi << RGBD_VOLUME_BLOCK_BITS;
+  block->origin[1] = bj << RGBD_VOLUME_BLOCK_BITS;
+  block->origin[2] = bk << RGBD_VOLUME_BLOCK_BITS;
+  for (int i = 0; i < RGBD_VOLUME_BLOCK_VOLUME; i++) block->distances[i] = 1;
+  memset(block->weights, 0, sizeof(block->weights));
+  memset(block->colors, 0, sizeof(block->colors));
+  block->integration_stamp = -1;
+  block->mesh_flags = 0;
+
+  // Insert block
+  block_index = (int) blocks.size();
+  block_indices[BlockKey(bi, bj, bk)] = block_index;
+  blocks.push_back(block);
+
+  // Return index of block
+  return block_index;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Integration functions
+////////////////////////////////////////////////////////////////////////
+
+struct RGBDVolumeIntegrationData {
+  RGBDVolume *volume;
+  const RGBDVolumeBlock * const *blocks;
+  const int *block_indices;
+  const RNScalar *depths;
+  const RNScalar *colors[3];
+  int width, height;
+  int color_width, color_height;
+  RNScalar fx, fy, cx, cy;
+  R4Matrix camera_to_world;
+  R4Matrix world_to_camera;
+  R3Point viewpoint;
+  RNLength voxel_size;
+  RNLength truncation_distance;
+  RNLength min_depth, max_depth;
+  RNScalar max_weight;
+  std::vector<RNInt64> *thread_block_keys;
+};
+
+
+
+static void
+FindImageRowBlocks(int iy, int thread_index, void *data)
+{
+  // Get convenient variables
+  RGBDVolumeIntegrationData *integration = (RGBDVolumeIntegrationData *) data;
+  std::vector<RNInt64>& block_keys = integration->thread_block_keys[thread_index];
+  RNLength block_size = RGBD_VOLUME_BLOCK_SIZE * integration->voxel_size;
+  RNLength truncation_distance = integration->truncation_distance;
+  int nsteps = (int) ceil(4 * truncation_distance / block_size) + 1;
+  const RNScalar *depths = &integration->depths[iy * integration->width];
+
+  // Visit pixels in row
+  for (int ix = 0; ix < integration->width; ix++) {
+    // Get/check depth
+    RNScalar depth = depths[ix];
+    if ((depth == R2_GRID_UNKNOWN_VALUE) || (depth <= 0)) continue;
+    if ((depth < integration->min_depth) || (depth > integration->max_depth)) continue;
+
+    // Compute world position (camera is looking down -Z)
+    R3Point camera_position((ix - integration->cx) * depth / integration->fx,
+      (iy - integration->cy) * depth / integration->fy, -depth);
+    R3Point world_position = integration->camera_to_world * camera_position;
+
+    // Insert keys of blocks along ray within truncation distance of world position
+    R3Vector ray = world_position - integration->viewpoint;
+    ray.Normalize();
+    R3Point start = world_position - truncation_distance * ray;
+    R3Vector step = (2 * truncation_distance / (nsteps - 1)) * ray;
+    RNInt64 previous_key = -1;
+    for (int s = 0; s < nsteps; s++) {
+      R3Point position = start + s * step;
+      int bi = ((int) floor(position.X() / integration->voxel_size)) >> RGBD_VOLUME_BLOCK_BITS;
+      int bj = ((int) floor(position.Y() / integration->voxel_size)) >> RGBD_VOLUME_BLOCK_BITS;
+      int bk = ((int) floor(position.Z() / integration->voxel_size)) >> RGBD_VOLUME_BLOCK_BITS;
+      RNInt64 key = BlockKey(bi, bj, bk);
+      if (key == previous_key) continue;
+      block_keys.push_back(key);
+      previous_key = key;
+    }
+  }
+}
+
+
+
+static void
+IntegrateBlock(int index, int, void *data)
+{
+  // Get convenient variables
+  RGBDVolumeIntegrationData *integration = (RGBDVolumeIntegrationData *) data;
+  RGBDVolumeBlock *block = (RGBDVolumeBlock *) integration->blocks[integration->block_indices[index]];
+  const R4Matrix& m = integration->world_to_camera;
+  const int width = integration->width;
+  const int height = integration->height;
+  const float fx = integration->fx, fy = integration->fy;
+  const float cx = integration->cx, cy = integration->cy;
+  const float voxel_size = integration->voxel_size;
+  const float truncation_distance = integration->truncation_distance;
+  const float min_depth = integration->min_depth;
+  const float max_depth = integration->max_depth;
+  const float max_weight = integration->max_weight;
+  const RNScalar *depths = integration->depths;
+  const RNBoolean same_color_resolution = (integration->color_width == width) && (integration->color_height == height);
+
+  // Compute camera coordinates of first voxel and of steps between voxels
+  R3Point origin(voxel_size * block->origin[0], voxel_size * block->origin[1], voxel_size * block->origin[2]);
+  R3Point camera_origin = m * origin;
+  float steps[3][3];
+  for (int dim = 0; dim < 3; dim++) {
+    for (int c = 0; c < 3; c++) steps[dim][c] = voxel_size * m[c][dim];
+  }
+
+  // Visit rows of voxels
+  for (int lk = 0; lk < RGBD_VOLUME_BLOCK_SIZE; lk++) {
+    for (int lj = 0; lj < RGBD_VOLUME_BLOCK_SIZE; lj++) {
+      float row[3];
+      for (int c = 0; c < 3; c++) row[c] = camera_origin[c] + lj * steps[1][c] + lk * steps[2][c];
+
+      // Project row of voxels into image (in a separate loop so that it vectorizes)
+      float voxel_depths[RGBD_VOLUME_BLOCK_SIZE];
+      int pixel_x[RGBD_VOLUME_BLOCK_SIZE], pixel_y[RGBD_VOLUME_BLOCK_SIZE];
+      for (int li = 0; li < RGBD_VOLUME_BLOCK_SIZE; li++) {
+        float x = row[0] + li * steps[0][0];
+        float y = row[1] + li * steps[0][1];
+        float depth = -(row[2] + li * steps[0][2]);
+        float inverse_depth = (depth > 0) ? 1.0f / depth : 0.0f;
+        voxel_depths[li] = depth;
+        pixel_x[li] = (int) floorf(cx + fx * x * inverse_depth + 0.5f);
+        pixel_y[li] = (int) floorf(cy + fy * y * inverse_depth + 0.5f);
+      }
+
+      // Update voxels in row
+      int voxel_index = BlockVoxelIndex(0, lj, lk);
+      for (int li = 0; li < RGBD_VOLUME_BLOCK_SIZE; li++, voxel_index++) {
+        // Check projection
+        float depth = voxel_depths[li];
+        if (depth <= 0) continue;
+        int ix = pixel_x[li], iy = pixel_y[li];
+        if ((ix < 0) || (ix >= width) || (iy < 0) || (iy >= height)) continue;
+
+        // Get/check pixel depth
+        RNScalar pixel_depth = depths[iy*width + ix];
+        if ((pixel_depth == R2_GRID_UNKNOWN_VALUE) || (pixel_depth <= 0)) continue;
+        if ((pixel_depth < min_depth) || (pixel_depth > max_depth)) continue;
+
+        // Compute truncated signed distance (skip voxels far behind surface)
+        float distance = pixel_depth - depth;
+        if (distance < -truncation_distance) continue;
+        float tsdf = (distance < truncation_distance) ? distance / truncation_distance : 1.0f;
+
+        // Update distance
+        float weight = block->weights[voxel_index];
+        float new_weight = weight + 1;
+        block->distances[voxel_index] = (weight * block->distances[voxel_index] + tsdf) / new_weight;
+
+        // Update color (only near surface)
+        if (integration->colors[0] && (tsdf < 1)) {
+          int color_pixel_index = iy*width + ix;
+          if (!same_color_resolution) {
+            int color_ix = ix * integration->color_width / width;
+            int color_iy = iy * integration->color_height / height;
+            color_pixel_index = color_iy*integration->color_width + color_ix;
+          }
+          unsigned char *color = &block->colors[3*voxel_index];
+          for (int c = 0; c < 3; c++) {
+            RNScalar value = integration->colors[c][color_pixel_index];
+            if (value == R2_GRID_UNKNOWN_VALUE) continue;
+            float pixel_value = (value > 0) ? ((value < 1) ? 255 * value : 255) : 0;
+            color[c] = (unsigned char) ((weight * color[c] + pixel_value) / new_weight + 0.5f);
+          }
+        }
+
+        // Update weight
+        block->weights[voxel_index] = (new_weight < max_weight) ? new_weight : max_weight;
+        block->mesh_flags |= RGBD_VOLUME_BLOCK_UPDATED;
+      }
+    }
+  }
+}
+
+
+
+int RGBDVolume::
+IntegrateImage(const R2Grid& depth_image,
+  const R2Grid *red_image, const R2Grid *green_image, const R2Grid *blue_image,
+  const R3Matrix& intrinsics, const R3Affine& camera_to_world)
+{
+  // Check intrinsics
+  if (RNIsZero(intrinsics[0][0]) || RNIsZero(intrinsics[1][1])) {
+    RNFail("Invalid intrinsics matrix for integration\n");
+    return 0;
+  }
+
+  // Initialize integration data
+  RGBDVolumeIntegrationData integration;
+  integration.volume = this;
+  integration.blocks = NULL;
+  integration.block_indices = NULL;
+  integration.depths = depth_image.GridValues();
+  integration.width = depth_image.XResolution();
+  integration.height = depth_image.YResolution();
+  integration.colors[0] = integration.colors[1] = integration.colors[2] = NULL;
+  integration.color_width = integration.color_height = 0;
+  if (red_image && green_image && blue_image &&
+      (green_image->XResolution() == red_image->XResolution()) && (green_image->YResolution() == red_image->YResolution()) &&
+      (blue_image->XResolution() == red_image->XResolution()) && (blue_image->YResolution() == red_image->YResolution())) {
+    integration.colors[0] = red_image->GridValues();
+    integration.colors[1] = green_image->GridValues();
+    integration.colors[2] = blue_image->GridValues();
+    integration.color_width = red_image->XResolution();
+    integration.color_height = red_image->YResolution();
+  }
+  integration.fx = intrinsics[0][0];
+  integration.fy = intrinsics[1][1];
+  integration.cx = intrinsics[0][2];
+  integration.cy = intrinsics[1][2];
+  integration.camera_to_world = camera_to_world.Matrix();
+  integration.world_to_camera = camera_to_world.InverseMatrix();
+  integration.viewpoint = integration.camera_to_world * R3zero_point;
+  integration.voxel_size = voxel_size;
+  integration.truncation_distance = truncation_distance;
+  integration.min_depth = min_depth;
+  integration.max_depth = max_depth;
+  integration.max_weight = max_weight;
+  if (integration.width * integration.height == 0) return 1;
+
+  // Find keys of blocks within truncation distance of depth samples (in parallel over rows)
+  std::vector<RNInt64> *thread_block_keys = new std::vector<RNInt64> [ RNNThreads() ];
+  integration.thread_block_keys = thread_block_keys;
+  RNParallelFor(integration.height, FindImageRowBlocks, &integration, 8);
+
+  // Merge and sort block keys
+  std::vector<RNInt64> block_keys;
+  for (int t = 0; t < RNNThreads(); t++) {
+    block_keys.insert(block_keys.end(), thread_block_keys[t].begin(), thread_block_keys[t].end());
+  }
+  delete [] thread_block_keys;
+  std::sort(block_keys.begin(), block_keys.end());
+  block_keys.erase(std::unique(block_keys.begin(), block_keys.end()), block_keys.end());
+
+  // Allocate blocks
+  const RNInt64 mask = (1 << 21) - 1;
+  const int offset = 1 << 20;
+  std::vector<int> image_block_indices;
+  image_block_indices.reserve(block_keys.size());
+  for (unsigned int i = 0; i < block_keys.size(); i++) {
+    int bi = (int) (block_keys[i] & mask) - offset;
+    int bj = (int) ((block_keys[i] >> 21) & mask) - offset;
+    int bk = (int) ((block_keys[i] >> 42) & mask) - offset;
+    int block_index = AllocateBlock(bi, bj, bk);
+    if (blocks[block_index]->integration_stamp == nintegrated_images) continue;
+    blocks[block_index]->integration_stamp = nintegrated_images;
+    image_block_indices.push_back(block_index);
+  }
+
+  // Update voxels of blocks (in parallel over blocks)
+  if (!image_block_indices.empty()) {
+    integration.blocks = &blocks[0];
+    integration.block_indices = &image_block_indices[0];
+    RNParallelFor((int) image_block_indices.size(), IntegrateBlock, &integration, 4);
+  }
+
+  // Update number of integrated images
+  nintegrated_images++;
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDVolume::
+IntegrateImage(RGBDImage *image)
+{
+  // Get/check depth channel
+  R2Grid *depth_channel = image->DepthChannel();
+  if (!depth_channel) {
+    RNFail("Depth channel of image %s has not been read\n", (image->Name()) ? image->Name() : "");
+    return 0;
+  }
+
+  // Integrate depth and color channels
+  return IntegrateImage(*depth_channel,
+    image->RedChannel(), image->GreenChannel(), image->BlueChannel(),
+    image->Intrinsics(), image->CameraToWorld());
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Mesh extraction functions
+////////////////////////////////////////////////////////////////////////
+
+// Mesh vertices are created on voxel edges leaving the voxels of each
+// block (keyed by 3*voxel_index + dimension, in increasing order),
+// and triangles refer to vertices as pairs (block index, vertex index)
+
+struct RGBDVolumeMeshData {
+  const RGBDVolume *volume;
+  RGBDVolumeBlock * const *blocks;
+  const int *block_indices;
+  const int *first_vertices;
+  const int *first_indices;
+  R3PlyMesh *mesh;
+};
+
+
+
+// Edges of cell (offset of first voxel, dimension) in marching cubes order
+
+static const int volume_cell_edges[12][4] = {
+  {0,0,0,0}, {1,0,0,2}, {0,0,1,0}, {0,0,0,2}, {0,1,0,0}, {1,1,0,2},
+  {0,1,1,0}, {0,1,0,2}, {0,0,0,1}, {1,0,0,1}, {1,0,1,1}, {0,0,1,1} };
+
+
+
+static void
+FindMeshNeighbors(const RGBDVolumeMeshData *meshing, const RGBDVolumeBlock *block, int *neighbors)
+{
+  // Find blocks in positive directions (neighbors[0] is block itself)
+  int bi = block->origin[0] >> RGBD_VOLUME_BLOCK_BITS;
+  int bj = block->origin[1] >> RGBD_VOLUME_BLOCK_BITS;
+  int bk = block->origin[2] >> RGBD_VOLUME_BLOCK_BITS;
+  for (int c = 0; c < 8; c++) {
+    neighbors[c] = meshing->volume->FindBlockIndex(bi + (c & 1), bj + ((c >> 1) & 1), bk + ((c >> 2) & 1));
+  }
+}
+
+
+
+static void
+GatherMeshVoxels(const RGBDVolumeMeshData *meshing, const int *neighbors,
+  float *distances, float *weights, const unsigned char **colors)
+{
+  // Fill (block_size+1)^3 voxels of block and first layer of its neighbors in positive directions
+  const int block_size = RGBD_VOLUME_BLOCK_SIZE;
+  const int n = block_size + 1;
+  for (int c = 0; c < 8; c++) {
+    const RGBDVolumeBlock *block = (neighbors[c] >= 0) ? meshing->blocks[neighbors[c]] : NULL;
+    int lo[3], hi[3];
+    for (int dim = 0; dim < 3; dim++) {
+      lo[dim] = ((c >> dim) & 1) ? block_size : 0;
+      hi[dim] = ((c >> dim) & 1) ? block_size : block_size - 1;
+    }
+    for (int k = lo[2]; k <= hi[2]; k++) {
+      for (int j = lo[1]; j <= hi[1]; j++) {
+        for (int i = lo[0]; i <= hi[0]; i++) {
+          int index = (k*n + j)*n + i;
+          if (block) {
+            int voxel_index = BlockVoxelIndex(i & RGBD_VOLUME_BLOCK_MASK, j & RGBD_VOLUME_BLOCK_MASK, k & RGBD_VOLUME_BLOCK_MASK);
+            distances[index] = block->distances[voxel_index];
+            weights[index] = block->weights[voxel_index];
+            colors[index] = &block->colors[3*voxel_index];
+          }
+          else {
+            distances[index] = 1;
+            weights[index] = 0;
+            colors[index] = NULL;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+CreateBlockVertices(int index, int, void *data)
+{
+  // Get convenient variables
+  RGBDVolumeMeshData *meshing = (RGBDVolumeMeshData *) data;
+  RGBDVolumeBlock *block = meshing->blocks[meshing->block_indices[index]];
+  RNLength voxel_size = meshing->volume->VoxelSize();
+  const int block_size = RGBD_VOLUME_BLOCK_SIZE;
+  const int n = block_size + 1;
+
+  // Gather voxels
+  int neighbors[8];
+  float distances[n*n*n], weights[n*n*n];
+  const unsigned char *colors[n*n*n];
+  FindMeshNeighbors(meshing, block, neighbors);
+  GatherMeshVoxels(meshing, neighbors, distances, weights, colors);
+
+  // Create vertices on edges between observed voxels with different signs
+  block->vertex_positions.clear();
+  block->vertex_colors.clear();
+  block->vertex_keys.clear();
+  int strides[3] = { 1, n, n*n };
+  for (int lk = 0; lk < block_size; lk++) {
+    for (int lj = 0; lj < block_size; lj++) {
+      for (int li = 0; li < block_size; li++) {
+        int index0 = (lk*n + lj)*n + li;
+        if (weights[index0] == 0) continue;
+        float distance0 = distances[index0];
+        int l[3] = { li, lj, lk };
+        for (int dim = 0; dim < 3; dim++) {
+          int index1 = index0 + strides[dim];
+          if (weights[index1] == 0) continue;
+          float distance1 = distances[index1];
+          if ((distance0 < 0) == (distance1 < 0)) continue;
+
+          // Create vertex at zero crossing
+          float t = distance0 / (distance0 - distance1);
+          for (int d = 0; d < 3; d++) {
+            float coordinate = block->origin[d] + l[d] + ((d == dim) ? t : 0);
+            block->vertex_positions.push_back(voxel_size * coordinate);
+          }
+          for (int c = 0; c < 3; c++) {
+            float color = (1 - t) * colors[index0][c] + t * colors[index1][c];
+            block->vertex_colors.push_back((unsigned char) (color + 0.5f));
+          }
+          block->vertex_keys.push_back(3*BlockVoxelIndex(li, lj, lk) + dim);
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+CreateBlockTriangles(int index, int, void *data)
+{
+  // Get convenient variables
+  RGBDVolumeMeshData *meshing = (RGBDVolumeMeshData *) data;
+  RGBDVolumeBlock *block = meshing->blocks[meshing->block_indices[index]];
+  const int block_size = RGBD_VOLUME_BLOCK_SIZE;
+  const int n = block_size + 1;
+
+  // Gather voxels
+  int neighbors[8];
+  float distances[n*n*n], weights[n*n*n];
+  const unsigned char *colors[n*n*n];
+  FindMeshNeighbors(meshing, block, neighbors);
+  GatherMeshVoxels(meshing, neighbors, distances, weights, colors);
+
+  // Visit cells with first voxel in block
+  block->triangle_vertices.clear();
+  static const int corner_offsets[8] = { 0, 1, 1 + n*n, n*n, n, 1 + n, 1 + n + n*n, n + n*n };
+  for (int lk = 0; lk < block_size; lk++) {
+    for (int lj = 0; lj < block_size; lj++) {
+      for (int li = 0; li < block_size; li++) {
+        int index = (lk*n + lj)*n + li;
+
+        // Compute cube index (skip cells with unobserved corners)
+        int cubeindex = 0;
+        RNBoolean observed = TRUE;
+        for (int c = 0; c < 8; c++) {
+          if (weights[index + corner_offsets[c]] == 0) { observed = FALSE; break; }
+          if (distances[index + corner_offsets[c]] < 0) cubeindex |= (1 << c);
+        }
+        if (!observed) continue;
+        if ((cubeindex == 0) || (cubeindex == 255)) continue;
+
+        // Create triangles
+        const int *triangle_edges = R3grid_isosurface_triangle_table[cubeindex];
+        for (int t = 0; triangle_edges[t] != -1; t++) {
+          // Find block that owns edge
+          const int *edge = volume_cell_edges[triangle_edges[t]];
+          int ei = li + edge[0], ej = lj + edge[1], ek = lk + edge[2];
+          int c = (ei >> RGBD_VOLUME_BLOCK_BITS) | ((ej >> RGBD_VOLUME_BLOCK_BITS) << 1) | ((ek >> RGBD_VOLUME_BLOCK_BITS) << 2);
+          assert(neighbors[c] >= 0);
+          const RGBDVolumeBlock *owner = meshing->blocks[neighbors[c]];
+
+          // Find vertex on edge
+          unsigned short key = 3*BlockVoxelIndex(ei & RGBD_VOLUME_BLOCK_MASK,
+            ej & RGBD_VOLUME_BLOCK_MASK, ek & RGBD_VOLUME_BLOCK_MASK) + edge[3];
+          std::vector<unsigned short>::const_iterator it =
+            std::lower_bound(owner->vertex_keys.begin(), owner->vertex_keys.end(), key);
+          assert((it != owner->vertex_keys.end()) && (*it == key));
+          block->triangle_vertices.push_back(neighbors[c]);
+          block->triangle_vertices.push_back((int) (it - owner->vertex_keys.begin()));
+        }
+      }
+    }
+  }
+}
+
+
+
+static void
+CopyBlockMesh(int block_index, int, void *data)
+{
+  // Get convenient variables
+  RGBDVolumeMeshData *meshing = (RGBDVolumeMeshData *) data;
+  const RGBDVolumeBlock *block = meshing->blocks[block_index];
+  R3PlyMesh *mesh = meshing->mesh;
+
+  // Copy vertices
+  int first_vertex = meshing->first_vertices[block_index];
+  if (!block->vertex_positions.empty()) {
+    memcpy(&mesh->positions[3*first_vertex], &block->vertex_positions[0], block->vertex_positions.size() * sizeof(float));
+    memcpy(&mesh->colors[3*first_vertex], &block->vertex_colors[0], block->vertex_colors.size());
+  }
+
+  // Copy triangles (converting pairs of block and vertex indices to mesh vertex indices)
+  int *indices = &mesh->indices[meshing->first_indices[block_index]];
+  for (unsigned int i = 0; i < block->triangle_vertices.size(); i += 2) {
+    *(indices++) = meshing->first_vertices[block->triangle_vertices[i]] + block->triangle_vertices[i+1];
+  }
+}
+
+
+
+static void
+MarkMeshNeighbors(const RGBDVolume *volume, const std::vector<RGBDVolumeBlock *>& blocks,
+  const RGBDVolumeBlock *block, int flag, std::vector<int>& marked_block_indices)
+{
+  // Mark block and its neighbors in negative directions (whose meshes depend on it)
+  int bi = block->origin[0] >> RGBD_VOLUME_BLOCK_BITS;
+  int bj = block->origin[1] >> RGBD_VOLUME_BLOCK_BITS;
+  int bk = block->origin[2] >> RGBD_VOLUME_BLOCK_BITS;
+  for (int c = 0; c < 8; c++) {
+    int neighbor_index = volume->FindBlockIndex(bi - (c & 1), bj - ((c >> 1) & 1), bk - ((c >> 2) & 1));
+    if (neighbor_index < 0) continue;
+    RGBDVolumeBlock *neighbor = blocks[neighbor_index];
+    if (neighbor->mesh_flags & flag) continue;
+    neighbor->mesh_flags |= flag;
+    marked_block_indices.push_back(neighbor_index);
+  }
+}
+
+
+
+int RGBDVolume::
+UpdateMesh(void)
+{
+  // Find blocks whose vertices depend on updated blocks
+  std::vector<int> vertex_block_indices;
+  for (unsigned int b = 0; b < blocks.size(); b++) {
+    if (!(blocks[b]->mesh_flags & RGBD_VOLUME_BLOCK_UPDATED)) continue;
+    MarkMeshNeighbors(this, blocks, blocks[b], RGBD_VOLUME_BLOCK_VERTICES_DIRTY, vertex_block_indices);
+  }
+
+  // Find blocks whose triangles depend on vertices of those blocks
+  std::vector<int> triangle_block_indices;
+  for (unsigned int i = 0; i < vertex_block_indices.size(); i++) {
+    const RGBDVolumeBlock *block = blocks[vertex_block_indices[i]];
+    MarkMeshNeighbors(this, blocks, block, RGBD_VOLUME_BLOCK_TRIANGLES_DIRTY, triangle_block_indices);
+  }
+
+  // Check if there is anything to do
+  if (triangle_block_indices.empty()) return 1;
+
+  // Initialize mesh data
+  RGBDVolumeMeshData meshing;
+  meshing.volume = this;
+  meshing.blocks = &blocks[0];
+  meshing.first_vertices = NULL;
+  meshing.first_indices = NULL;
+  meshing.mesh = NULL;
+
+  // Create vertices and then triangles of dirty blocks (in parallel over blocks)
+  meshing.block_indices = &vertex_block_indices[0];
+  RNParallelFor((int) vertex_block_indices.size(), CreateBlockVertices, &meshing, 4);
+  meshing.block_indices = &triangle_block_indices[0];
+  RNParallelFor((int) triangle_block_indices.size(), CreateBlockTriangles, &meshing, 4);
+
+  // Reset mesh flags (every updated block is also in the list of blocks whose triangles were created)
+  for (unsigned int i = 0; i < triangle_block_indices.size(); i++) {
+    blocks[triangle_block_indices[i]]->mesh_flags = 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDVolume::
+CreateMesh(R3PlyMesh *mesh)
+{
+  // Update meshes of dirty blocks
+  if (!UpdateMesh()) return 0;
+
+  // Compute offsets of vertices and triangle indices of blocks in mesh
+  int nblocks = (int) blocks.size();
+  std::vector<int> first_vertices(nblocks + 1), first_indices(nblocks + 1);
+  int nvertices = 0, nindices = 0;
+  for (int b = 0; b < nblocks; b++) {
+    first_vertices[b] = nvertices;
+    first_indices[b] = nindices;
+    nvertices += (int) (blocks[b]->vertex_positions.size() / 3);
+    nindices += (int) (blocks[b]->triangle_vertices.size() / 2);
+  }
+
+  // Allocate mesh
+  mesh->Empty();
+  mesh->positions.resize(3 * (size_t) nvertices);
+  mesh->colors.resize(3 * (size_t) nvertices);
+  mesh->indices.resize(nindices);
+  if (nblocks == 0) return 1;
+
+  // Copy vertices and triangles of blocks into mesh (in parallel over blocks)
+  RGBDVolumeMeshData meshing;
+  meshing.volume = this;
+  meshing.blocks = &blocks[0];
+  meshing.block_indices = NULL;
+  meshing.first_vertices = &first_vertices[0];
+  meshing.first_indices = &first_indices[0];
+  meshing.mesh = mesh;
+  RNParallelFor(nblocks, CopyBlockMesh, &meshing, 16);
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDVolume::
+CreateMesh(R3Mesh *mesh)
+{
+  // Extract mesh
+  R3PlyMesh isosurface;
+  if (!CreateMesh(&isosurface)) return 0;
+  if (isosurface.NFaces() == 0) return 1;
+
+  // Create vertices
+  int first_vertex_id = mesh->CreateVertices(isosurface.NVertices(), &isosurface.positions[0]);
+  for (int i = 0; i < isosurface.NVertices(); i++) {
+    const unsigned char *color = &isosurface.colors[3*i];
+    mesh->SetVertexColor(mesh->Vertex(first_vertex_id + i), RNRgb(color[0] / 255.0, color[1] / 255.0, color[2] / 255.0));
+  }
+  if (first_vertex_id > 0) {
+    for (unsigned int i = 0; i < isosurface.indices.size(); i++) isosurface.indices[i] += first_vertex_id;
+  }
+
+  // Create faces
+  mesh->CreateFaces(isosurface.NFaces(), &isosurface.indices[0]);
+
+  // Return success
+  return 1;
+}
+
+
+
+int RGBDVolume::
+WriteMeshFile(const char *filename)
+{
+  // Parse output filename extension
+  const char *extension;
+  if (!(extension = strrchr(filename, '.'))) {
+    RNFail("Filename %s has no extension (e.g., .ply)\n", filename);
+    return 0;
+  }
+
+  // Write ply files directly
+  if (!strncmp(extension, ".ply", 4)) {
+    // Extract mesh
+    R3PlyMesh mesh;
+    if (!CreateMesh(&mesh)) return 0;
+
+    // Open file
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+      RNFail("Unable to open mesh file %s\n", filename);
+      return 0;
+    }
+
+    // Write mesh
+    if (!R3WriteBinaryPlyMesh(fp, mesh)) {
+      RNFail("Unable to write mesh file %s\n", filename);
+      fclose(fp);
+      return 0;
+    }
+
+    // Close file
+    fclose(fp);
+
+    // Return success
+    return 1;
+  }
+
+  // Write other file types via R3Mesh
+  R3Mesh mesh;
+  if (!CreateMesh(&mesh)) return 0;
+  return mesh.WriteFile(filename);
+}
+
+
+
+} // namespace gaps
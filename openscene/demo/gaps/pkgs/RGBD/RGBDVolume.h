@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////
+// Include file for RGBDVolume class
+////////////////////////////////////////////////////////////////////////
+
+#ifndef __RGBD__VOLUME__H__
+#define __RGBD__VOLUME__H__
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+#include <unordered_map>
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Namespace
+////////////////////////////////////////////////////////////////////////
+
+namespace gaps {
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Type definitions
+////////////////////////////////////////////////////////////////////////
+
+struct RGBDVolumeBlock;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Class definition
+////////////////////////////////////////////////////////////////////////
+
+class RGBDVolume {
+public:
+  // Constructors/destructors
+  RGBDVolume(RNLength voxel_size = 0.01, RNLength truncation_distance = 0);
+  ~RGBDVolume(void);
+
+  // Property functions
+  RNLength VoxelSize(void) const;
+  RNLength TruncationDistance(void) const;
+  RNScalar MaxWeight(void) const;
+  RNLength MinDepth(void) const;
+  RNLength MaxDepth(void) const;
+  int NIntegratedImages(void) const;
+  R3Box WorldBBox(void) const;
+
+  // Block property functions
+  int NBlocks(void) const;
+  int NDirtyBlocks(void) const;
+  RNInt64 MemoryUsage(void) const;
+
+  // Voxel access functions (distance is in world units, zero weight means unobserved)
+  RNScalar WorldDistance(const R3Point& world_position) const;
+  RNScalar WorldWeight(const R3Point& world_position) const;
+  RNRgb WorldColor(const R3Point& world_position) const;
+
+  // Manipulation functions (truncation distance can be changed only while volume is empty)
+  void Empty(void);
+  void SetTruncationDistance(RNLength truncation_distance);
+  void SetMaxWeight(RNScalar max_weight);
+  void SetDepthRange(RNLength min_depth, RNLength max_depth);
+
+  // Integration functions (channels of image must be read)
+  int IntegrateImage(RGBDImage *image);
+  int IntegrateImage(const R2Grid& depth_image,
+    const R2Grid *red_image, const R2Grid *green_image, const R2Grid *blue_image,
+    const R3Matrix& intrinsics, const R3Affine& camera_to_world);
+
+  // Mesh extraction functions (only blocks changed since last update are remeshed)
+  int UpdateMesh(void);
+  int CreateMesh(R3PlyMesh *mesh);
+  int CreateMesh(R3Mesh *mesh);
+  int WriteMeshFile(const char *filename);
+
+public:
+  // Internal functions
+  int FindBlockIndex(int bi, int bj, int bk) const;
+  const RGBDVolumeBlock *Block(int block_index) const;
+
+private:
+  // Internal functions
+  int AllocateBlock(int bi, int bj, int bk);
+  const RGBDVolumeBlock *FindVoxel(const R3Point& world_position, int& voxel_index) const;
+
+private:
+  // Internal variables
+  RNLength voxel_size;
+  RNLength truncation_distance;
+  RNScalar max_weight;
+  RNLength min_depth;
+  RNLength max_depth;
+  int nintegrated_images;
+  std::vector<RGBDVolumeBlock *> blocks;
+  std::unordered_map<RNInt64, int> block_indices;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Inline functions
+////////////////////////////////////////////////////////////////////////
+
+inline RNLength RGBDVolume::
+VoxelSize(void) const
+{
+  // Return spacing between voxels in world units
+  return voxel_size;
+}
+
+
+
+inline RNLength RGBDVolume::
+TruncationDistance(void) const
+{
+  // Return distance at which signed distances are truncated
+  return truncation_distance;
+}
+
+
+
+inline RNScalar RGBDVolume::
+MaxWeight(void) const
+{
+  // Return maximum weight accumulated by a voxel
+  return max_weight;
+}
+
+
+
+inline RNLength RGBDVolume::
+MinDepth(void) const
+{
+  // Return minimum depth of pixels integrated
+  return min_depth;
+}
+
+
+
+inline RNLength RGBDVolume::
+MaxDepth(void) const
+{
+  // Return maximum depth of pixels integrated
+  return max_depth;
+}
+
+
+
+inline int RGBDVolume::
+NIntegratedImages(void) const
+{
+  // Return number of images integrated
+  return nintegrated_images;
+}
+
+
+
+inline int RGBDVolume::
+NBlocks(void) const
+{
+  // Return number of allocated blocks
+  return (int) blocks.size();
+}
+
+
+
+inline const RGBDVolumeBlock *RGBDVolume::
+Block(int block_index) const
+{
+  // Return block
+  return blocks[block_index];
+}
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif
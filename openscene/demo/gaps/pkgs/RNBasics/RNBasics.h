@@ -82,6 +82,7 @@
 /* OS utility include files */
 
 #include "RNBasics/RNTime.h"
+#include "RNBasics/RNThread.h"
 
 
 
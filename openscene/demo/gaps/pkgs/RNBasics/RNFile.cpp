@@ -3,6 +3,12 @@
 
 // Include files
 #include "RNBasics.h"
+#if (RN_OS != RN_WINDOWS)
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
 
 
 
@@ -54,6 +60,93 @@ RNFileSize(const char *filename)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// FILE MAPPING FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+void *
+RNMapFile(const char *filename, unsigned long long *size)
+{
+    // Initialize size
+    if (size) *size = 0;
+
+#if (RN_OS == RN_WINDOWS)
+    // Open file
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        RNFail("Unable to open file for mapping: %s\n", filename);
+        return NULL;
+    }
+
+    // Get file size
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || (file_size.QuadPart == 0)) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    // Map file (view stays valid after handles are closed)
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *data = (mapping) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (!data) {
+        RNFail("Unable to map file: %s\n", filename);
+        return NULL;
+    }
+
+    // Return mapped data
+    if (size) *size = file_size.QuadPart;
+    return data;
+#else
+    // Open file
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        RNFail("Unable to open file for mapping: %s\n", filename);
+        return NULL;
+    }
+
+    // Get file size
+    struct stat stat_buf;
+    if ((fstat(fd, &stat_buf) != 0) || (stat_buf.st_size == 0)) {
+        close(fd);
+        return NULL;
+    }
+
+    // Map file (mapping stays valid after file is closed)
+    void *data = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        RNFail("Unable to map file: %s\n", filename);
+        return NULL;
+    }
+
+    // Return mapped data
+    if (size) *size = stat_buf.st_size;
+    return data;
+#endif
+}
+
+
+
+void
+RNUnmapFile(void *data, unsigned long long size)
+{
+    // Check data
+    if (!data) return;
+
+#if (RN_OS == RN_WINDOWS)
+    // Unmap view of file
+    UnmapViewOfFile(data);
+#else
+    // Unmap file
+    munmap(data, size);
+#endif
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // FILE SEEK FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
@@ -477,6 +570,115 @@ RNWriteUnsignedLongLong(FILE *fp, const unsigned long long *ptr, int count, int
 
 
 
+////////////////////////////////////////////////////////////////////////
+// NUMPY ARRAY FILE FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+int
+RNParseNumpyHeader(const void *data, unsigned long long size,
+  char *value_kind, int *value_size, int *shape, int max_ndims,
+  unsigned long long *values_offset)
+{
+  // Check magic string
+  const unsigned char *bytes = (const unsigned char *) data;
+  if (!bytes || (size < 10) || (bytes[0] != 0x93) || memcmp(&bytes[1], "NUMPY", 5)) {
+    RNFail("Unrecognized format in npy data\n");
+    return -1;
+  }
+
+  // Read header length (two bytes in version 1, four bytes in later versions)
+  unsigned long long header_start = (bytes[6] == 1) ? 10 : 12;
+  unsigned long long header_length = bytes[8] | (bytes[9] << 8);
+  if (bytes[6] != 1) {
+    if (size < 12) return -1;
+    header_length |= ((unsigned long long) bytes[10] << 16) | ((unsigned long long) bytes[11] << 24);
+  }
+  if (header_start + header_length > size) {
+    RNFail("Invalid header length in npy data\n");
+    return -1;
+  }
+
+  // Copy header into string
+  char *header = new char [ header_length + 1 ];
+  memcpy(header, &bytes[header_start], header_length);
+  header[header_length] = '\0';
+
+  // Parse value type (e.g., '<f2')
+  int status = -1;
+  char *start = strstr(header, "'descr'");
+  if (start) start = strchr(start + 7, '\'');
+  if (start && ((start[1] == '<') || (start[1] == '|')) && start[2] && isdigit(start[3])) {
+    if (value_kind) *value_kind = start[2];
+    if (value_size) *value_size = atoi(&start[3]);
+    status = 0;
+  }
+
+  // Check order of values
+  start = strstr(header, "'fortran_order'");
+  if (!start || !strstr(start, "False")) status = -1;
+
+  // Parse shape (e.g., (240, 320, 768))
+  int ndims = 0;
+  start = strstr(header, "'shape'");
+  if (start) start = strchr(start, '(');
+  if ((status == 0) && start) {
+    start++;
+    while (*start && (*start != ')')) {
+      while ((*start == ' ') || (*start == ',')) start++;
+      if (!isdigit(*start)) break;
+      if (ndims < max_ndims) shape[ndims] = atoi(start);
+      ndims++;
+      while (isdigit(*start)) start++;
+    }
+  }
+  else {
+    status = -1;
+  }
+
+  // Delete header
+  delete [] header;
+
+  // Check status
+  if (status < 0) {
+    RNFail("Unsupported value type, order, or shape in npy data\n");
+    return -1;
+  }
+
+  // Return number of dimensions
+  if (values_offset) *values_offset = header_start + header_length;
+  return ndims;
+}
+
+
+
+int
+RNWriteNumpyHeader(FILE *fp, const char *descr, const int *shape, int ndims)
+{
+  // Create header dictionary
+  char header[1024];
+  int length = sprintf(header, "{'descr': '%s', 'fortran_order': False, 'shape': (", descr);
+  for (int i = 0; i < ndims; i++) length += sprintf(&header[length], (i > 0) ? ", %d" : "%d", shape[i]);
+  if (ndims == 1) length += sprintf(&header[length], ",");
+  length += sprintf(&header[length], "), }");
+
+  // Pad header with spaces and newline so that values are aligned to 64 bytes
+  while ((10 + length + 1) % 64 != 0) header[length++] = ' ';
+  header[length++] = '\n';
+
+  // Write magic string, version, header length, and header
+  unsigned char preamble[10] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+    (unsigned char) (length & 0xFF), (unsigned char) ((length >> 8) & 0xFF) };
+  if ((fwrite(preamble, 1, 10, fp) != 10) || (fwrite(header, 1, length, fp) != (size_t) length)) {
+    RNFail("Unable to write header to npy file\n");
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // ENDIAN BYTE-SWAPPING FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
@@ -25,6 +25,16 @@ unsigned long long RNFileSize(const char *filename);
 
 
 
+////////////////////////////////////////////////////////////////////////
+// File mapping functions
+////////////////////////////////////////////////////////////////////////
+
+// Map whole file read-only into memory (returns NULL on failure or if file is empty)
+void *RNMapFile(const char *filename, unsigned long long *size);
+void RNUnmapFile(void *data, unsigned long long size);
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // File seek functions
 ////////////////////////////////////////////////////////////////////////
@@ -61,6 +71,23 @@ int RNWriteUnsignedLongLong(FILE *fp, const unsigned long long *ptr, int count,
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Numpy array file functions
+////////////////////////////////////////////////////////////////////////
+
+// Parse header of numpy array (.npy) data, e.g., mapped with RNMapFile
+// (fills value kind, such as 'f', value size in bytes, and shape, and
+// returns number of dimensions, or -1 if data is not a little-endian
+// C-ordered array, with *values_offset set to the start of the values)
+int RNParseNumpyHeader(const void *data, unsigned long long size,
+  char *value_kind, int *value_size, int *shape, int max_ndims,
+  unsigned long long *values_offset);
+
+// Write header of numpy array (.npy) file with descr such as "<f2"
+int RNWriteNumpyHeader(FILE *fp, const char *descr, const int *shape, int ndims);
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Endian byteswapping functions
 ////////////////////////////////////////////////////////////////////////
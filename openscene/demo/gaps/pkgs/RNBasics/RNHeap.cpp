@@ -268,18 +268,20 @@ Pop(void)
   if (entry_offset >= 0) *((PtrType **) ((unsigned char *) entries[0] + entry_offset)) = NULL;
   if (entry_callback) *((PtrType **) (*entry_callback)(entries[0], callback_data)) = NULL;
 
-  // Remove head entry, by copying tail over it
-  entries[0] = entries[nentries-1];
+  // Remove head entry, by copying tail over it (unless head is the only entry)
+  if (nentries > 1) {
+    entries[0] = entries[nentries-1];
 
-  // Update new entry[0] backpointer
-  if (entry_offset >= 0) *((PtrType **) ((unsigned char *) entries[0] + entry_offset)) = &entries[0];
-  if (entry_callback) *((PtrType **) (*entry_callback)(entries[0], callback_data)) = &entries[0];
+    // Update new entry[0] backpointer
+    if (entry_offset >= 0) *((PtrType **) ((unsigned char *) entries[0] + entry_offset)) = &entries[0];
+    if (entry_callback) *((PtrType **) (*entry_callback)(entries[0], callback_data)) = &entries[0];
+  }
 
   // Decrement number of entries
   nentries--;
 
   // Bubble the head entry down to its rightful spot
-  BubbleDown(0);
+  if (nentries > 1) BubbleDown(0);
 
   // Return original head entry
   return result;
@@ -294,7 +296,7 @@ Update(PtrType entry)
   // Search for entry
   PtrType *entryp = NULL;
   if (entry_offset >= 0) entryp = *((PtrType **) ((unsigned char *) entry + entry_offset));
-  if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
+  else if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
   else {
     // Find entry in heap
     for (int i = 0; i < nentries; i++) {
@@ -321,7 +323,7 @@ Remove(PtrType entry)
   // Search for entry
   PtrType *entryp = NULL;
   if (entry_offset >= 0) entryp = *((PtrType **) ((unsigned char *) entry + entry_offset));
-  if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
+  else if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
   else {
     // Find entry in heap
     for (int i = 0; i < nentries; i++) {
@@ -341,18 +343,19 @@ Remove(PtrType entry)
   if (entry_offset >= 0) *((PtrType **) ((unsigned char *) entries[index] + entry_offset)) = NULL;
   if (entry_callback) *((PtrType **) (*entry_callback)(entries[index], callback_data)) = NULL;
 
+  // Decrement number of entries
+  nentries--;
+  if (index == nentries) return;
+
   // Remove entry, by copying tail over it
-  entries[index] = entries[nentries-1];
+  entries[index] = entries[nentries];
 
-  // Update new entry[0] backpointer
+  // Update new entry[index] backpointer
   if (entry_offset >= 0) *((PtrType **) ((unsigned char *) entries[index] + entry_offset)) = &entries[index];
   if (entry_callback) *((PtrType **) (*entry_callback)(entries[index], callback_data)) = &entries[index];
 
-  // Decrement number of entries
-  nentries--;
-
-  // Bubble the entry down to its rightful spot
-  BubbleDown(index);
+  // Move the tail entry up or down to its rightful spot
+  BubbleUp(BubbleDown(index));
 }
 
 
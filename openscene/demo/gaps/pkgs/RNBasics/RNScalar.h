@@ -323,6 +323,57 @@ RNIsLessOrEqual(RNScalar scalar1, RNScalar scalar2, RNMagnitude epsilon = RN_EPS
 
 
 
+/* Half precision conversion functions */
+
+inline unsigned short
+RNFloatToHalf(float value)
+{
+    // Return IEEE half precision bits of value (rounded to nearest even)
+    union { float f; unsigned int u; } bits;
+    bits.f = value;
+    unsigned int sign = (bits.u >> 16) & 0x8000;
+    unsigned int exponent = (bits.u >> 23) & 0xFF;
+    unsigned int mantissa = bits.u & 0x7FFFFF;
+    if (exponent == 0xFF) return (unsigned short) (sign | 0x7C00 | ((mantissa) ? 0x200 : 0));
+    int e = (int) exponent - 127 + 15;
+    if (e >= 31) return (unsigned short) (sign | 0x7C00);
+    if (e <= 0) {
+        // Denormalized (or zero)
+        if (e < -10) return (unsigned short) sign;
+        mantissa |= 0x800000;
+        int shift = 14 - e;
+        unsigned int half = mantissa >> shift;
+        unsigned int remainder = mantissa & ((1U << shift) - 1);
+        unsigned int halfway = 1U << (shift - 1);
+        if ((remainder > halfway) || ((remainder == halfway) && (half & 1))) half++;
+        return (unsigned short) (sign | half);
+    }
+    unsigned int half = ((unsigned int) e << 10) | (mantissa >> 13);
+    unsigned int remainder = mantissa & 0x1FFF;
+    if ((remainder > 0x1000) || ((remainder == 0x1000) && (half & 1))) half++;
+    return (unsigned short) (sign | half);
+}
+
+inline float
+RNHalfToFloat(unsigned short value)
+{
+    // Return float value of IEEE half precision bits
+    union { float f; unsigned int u; } bits;
+    unsigned int sign = ((unsigned int) value & 0x8000) << 16;
+    unsigned int exponent = (value >> 10) & 0x1F;
+    unsigned int mantissa = value & 0x3FF;
+    if (exponent == 0) {
+        // Denormalized (or zero)
+        bits.f = mantissa * (1.0F / 16777216.0F);
+        bits.u |= sign;
+    }
+    else if (exponent == 31) bits.u = sign | 0x7F800000 | (mantissa << 13);
+    else bits.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    return bits.f;
+}
+
+
+
 // End namespace
 }
 
@@ -0,0 +1,117 @@
+/* Source file for GAPS thread utility  */
+
+
+
+/* Include files */
+
+#include "RNBasics.h"
+#include <atomic>
+#include <thread>
+
+
+
+// Namespace
+
+namespace gaps {
+
+
+
+/* Private variables */
+
+static int RNnthreads = 0;
+static thread_local int RNthread_budget = 0;
+
+
+
+int RNNThreads(void)
+{
+    // Determine default number of threads
+    if (RNnthreads <= 0) {
+        const char *env = getenv("GAPS_NUM_THREADS");
+        if (env) RNnthreads = atoi(env);
+        if (RNnthreads <= 0) RNnthreads = (int) std::thread::hardware_concurrency();
+        if (RNnthreads <= 0) RNnthreads = 1;
+    }
+
+    // Return number of threads
+    return RNnthreads;
+}
+
+
+
+void RNSetNThreads(int nthreads)
+{
+    // Set number of threads (0 means use default)
+    RNnthreads = nthreads;
+}
+
+
+
+static void
+RNParallelForWorker(std::atomic<int> *counter, int n, int chunk_size, int thread_index,
+    void (*callback)(int, int, void *), void *data, int thread_budget)
+{
+    // Limit threads of parallel loops nested in callback
+    int saved_thread_budget = RNthread_budget;
+    RNthread_budget = thread_budget;
+
+    // Process chunks until none are left
+    while (TRUE) {
+        int start = counter->fetch_add(chunk_size);
+        if (start >= n) break;
+        int end = start + chunk_size;
+        if (end > n) end = n;
+        for (int i = start; i < end; i++) {
+            (*callback)(i, thread_index, data);
+        }
+    }
+
+    // Restore thread budget
+    RNthread_budget = saved_thread_budget;
+}
+
+
+
+void RNParallelFor(int n, void (*callback)(int index, int thread_index, void *data),
+    void *data, int chunk_size)
+{
+    // Check arguments
+    if (n <= 0) return;
+    if (chunk_size < 1) chunk_size = 1;
+
+    // Determine number of threads (within a parallel loop, use the share of its threads given to this one)
+    int budget = (RNthread_budget > 0) ? RNthread_budget : RNNThreads();
+    int nthreads = budget;
+    int nchunks = (n + chunk_size - 1) / chunk_size;
+    if (nthreads > nchunks) nthreads = nchunks;
+
+    // Run serially if only one thread
+    if (nthreads <= 1) {
+        std::atomic<int> counter(0);
+        RNParallelForWorker(&counter, n, n, 0, callback, data, budget);
+        return;
+    }
+
+    // Divide threads among loops nested in this one
+    int thread_budget = budget / nthreads;
+    if (thread_budget < 1) thread_budget = 1;
+
+    // Start worker threads (calling thread is thread zero)
+    std::atomic<int> counter(0);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < nthreads; t++) {
+        threads.push_back(std::thread(RNParallelForWorker, &counter, n, chunk_size, t, callback, data, thread_budget));
+    }
+
+    // Do work in calling thread too
+    RNParallelForWorker(&counter, n, chunk_size, 0, callback, data, thread_budget);
+
+    // Wait for worker threads
+    for (unsigned int t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+}
+
+
+
+} // namespace gaps
@@ -0,0 +1,38 @@
+/* Include file for GAPS thread utility */
+#ifndef __RN__THREAD__H__
+#define __RN__THREAD__H__
+
+
+
+/* Begin namespace */
+namespace gaps {
+
+
+
+/* Thread count functions */
+
+int RNNThreads(void);
+void RNSetNThreads(int nthreads);
+
+
+
+/* Parallel loop functions */
+
+// Calls callback(index, thread_index, data) for every index in [0, n).
+// Indices are handed out dynamically in chunks of chunk_size.
+// The thread_index is in [0, RNNThreads()), so that callers can
+// keep per-thread scratch buffers and reduce them afterwards.
+// Parallel loops nested inside another parallel loop share its threads:
+// each of the outer loop's threads runs nested loops with RNNThreads()
+// divided by the number of outer threads (serially if that is one).
+void RNParallelFor(int n, void (*callback)(int index, int thread_index, void *data),
+    void *data, int chunk_size = 1);
+
+
+
+// End namespace
+}
+
+
+// End include guard
+#endif